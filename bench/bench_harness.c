@@ -0,0 +1,249 @@
+/*
+ * Water Treatment Controller - Micro-benchmark Harness
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "bench_harness.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BASELINE_LINE_MAX       1024
+
+typedef struct {
+    const bench_case_t *bench;
+    const bench_params_t *params;
+    pthread_barrier_t *barrier;
+    int thread;
+    double *samples;            /* [params->repetitions] */
+} bench_thread_t;
+
+static volatile uint64_t consume_sink;
+
+void bench_consume(uint64_t value) {
+    consume_sink += value;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void *bench_thread(void *arg) {
+    bench_thread_t *t = arg;
+    const bench_case_t *bench = t->bench;
+    int total = t->params->warmup + t->params->repetitions;
+
+    for (int rep = 0; rep < total; rep++) {
+        if (t->barrier) {
+            pthread_barrier_wait(t->barrier);
+        }
+
+        uint64_t start = now_ns();
+        bench->body(bench->ctx, t->thread, bench->ops);
+        uint64_t elapsed = now_ns() - start;
+
+        if (rep >= t->params->warmup) {
+            t->samples[rep - t->params->warmup] = (double)elapsed / (double)bench->ops;
+        }
+    }
+    return NULL;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static double percentile(const double *sorted, int count, double fraction) {
+    int rank = (int)ceil(fraction * count);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+bool bench_run(const bench_case_t *bench, const bench_params_t *params,
+               bench_result_t *result) {
+    int threads = bench->threads > 0 ? bench->threads : 1;
+    if (threads > BENCH_MAX_THREADS || bench->ops <= 0 || params->repetitions <= 0) {
+        return false;
+    }
+
+    int samples = threads * params->repetitions;
+    double *data = calloc((size_t)samples, sizeof(double));
+    if (!data) {
+        return false;
+    }
+
+    bench_thread_t workers[BENCH_MAX_THREADS];
+    for (int i = 0; i < threads; i++) {
+        workers[i] = (bench_thread_t){
+            .bench = bench,
+            .params = params,
+            .thread = i,
+            .samples = &data[i * params->repetitions],
+        };
+    }
+
+    if (threads == 1) {
+        bench_thread(&workers[0]);
+    } else {
+        pthread_barrier_t barrier;
+        pthread_t ids[BENCH_MAX_THREADS];
+        int started = 0;
+
+        pthread_barrier_init(&barrier, NULL, (unsigned)threads);
+        for (int i = 0; i < threads; i++) {
+            workers[i].barrier = &barrier;
+        }
+        for (; started < threads; started++) {
+            if (pthread_create(&ids[started], NULL, bench_thread, &workers[started]) != 0) {
+                break;
+            }
+        }
+        if (started < threads) {
+            /* The barrier would never open; nothing can be salvaged */
+            fprintf(stderr, "Cannot start thread %d of %s\n", started, bench->name);
+            exit(1);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(ids[i], NULL);
+        }
+        pthread_barrier_destroy(&barrier);
+    }
+
+    memset(result, 0, sizeof(*result));
+    snprintf(result->name, sizeof(result->name), "%s", bench->name);
+    result->item = bench->item;
+    result->threads = threads;
+    result->ops = bench->ops;
+    result->items_per_op = bench->items_per_op > 0 ? bench->items_per_op : 1.0;
+    result->samples = samples;
+
+    double sum = 0.0;
+    for (int i = 0; i < samples; i++) {
+        sum += data[i];
+    }
+    qsort(data, (size_t)samples, sizeof(double), compare_doubles);
+
+    result->min_ns = data[0];
+    result->max_ns = data[samples - 1];
+    result->mean_ns = sum / samples;
+    result->p50_ns = percentile(data, samples, 0.50);
+    result->p90_ns = percentile(data, samples, 0.90);
+    result->p99_ns = percentile(data, samples, 0.99);
+
+    free(data);
+    return true;
+}
+
+void bench_write_json(FILE *out, const bench_params_t *params,
+                      const bench_result_t *results, int count) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"wtc_bench\",\n");
+    fprintf(out, "  \"config\": {\"warmup\": %d, \"repetitions\": %d},\n",
+            params->warmup, params->repetitions);
+    fprintf(out, "  \"results\": [\n");
+
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(out,
+                "    {\"name\": \"%s\", \"threads\": %d, \"ops\": %ld, "
+                "\"min_ns\": %.1f, \"mean_ns\": %.1f, \"p50_ns\": %.1f, "
+                "\"p90_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f",
+                r->name, r->threads, r->ops,
+                r->min_ns, r->mean_ns, r->p50_ns, r->p90_ns, r->p99_ns, r->max_ns);
+        if (r->item) {
+            fprintf(out, ", \"items_per_op\": %.0f, \"ns_per_%s\": %.3f",
+                    r->items_per_op, r->item, r->p50_ns / r->items_per_op);
+        }
+        if (r->has_baseline) {
+            fprintf(out, ", \"baseline_p50_ns\": %.1f, \"change_pct\": %.1f, \"regression\": %s",
+                    r->baseline_p50_ns, r->change_pct, r->regression ? "true" : "false");
+        }
+        fprintf(out, "}%s\n", i == count - 1 ? "" : ",");
+    }
+
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+/* Copy the string value of "key" from a result line */
+static bool find_string(const char *line, const char *key, char *value, size_t size) {
+    const char *p = strstr(line, key);
+    if (!p || !(p = strchr(p + strlen(key), '"'))) {
+        return false;
+    }
+    p++;
+
+    const char *end = strchr(p, '"');
+    if (!end || (size_t)(end - p) >= size) {
+        return false;
+    }
+    memcpy(value, p, (size_t)(end - p));
+    value[end - p] = '\0';
+    return true;
+}
+
+static bool find_number(const char *line, const char *key, double *value) {
+    const char *p = strstr(line, key);
+    if (!p || !(p = strchr(p + strlen(key), ':'))) {
+        return false;
+    }
+
+    char *end;
+    *value = strtod(p + 1, &end);
+    return end != p + 1;
+}
+
+int bench_load_baseline(const char *path, bench_baseline_t *entries, int max_count) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        return -1;
+    }
+
+    /* bench_write_json() puts every result on its own line */
+    char line[BASELINE_LINE_MAX];
+    int count = 0;
+    while (count < max_count && fgets(line, sizeof(line), in)) {
+        bench_baseline_t *entry = &entries[count];
+        if (find_string(line, "\"name\":", entry->name, sizeof(entry->name)) &&
+            find_number(line, "\"p50_ns\"", &entry->p50_ns)) {
+            count++;
+        }
+    }
+
+    fclose(in);
+    return count;
+}
+
+int bench_compare(bench_result_t *results, int count,
+                  const bench_baseline_t *baseline, int baseline_count,
+                  double threshold_pct) {
+    int regressions = 0;
+
+    for (int i = 0; i < count; i++) {
+        bench_result_t *r = &results[i];
+        for (int j = 0; j < baseline_count; j++) {
+            if (strcmp(r->name, baseline[j].name) != 0 || baseline[j].p50_ns <= 0.0) {
+                continue;
+            }
+            r->has_baseline = true;
+            r->baseline_p50_ns = baseline[j].p50_ns;
+            r->change_pct = (r->p50_ns - baseline[j].p50_ns) * 100.0 / baseline[j].p50_ns;
+            r->regression = r->change_pct > threshold_pct;
+            if (r->regression) {
+                regressions++;
+            }
+            break;
+        }
+    }
+    return regressions;
+}
@@ -0,0 +1,94 @@
+/*
+ * Water Treatment Controller - Micro-benchmark Harness
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Times a benchmark body over a number of repetitions, after untimed
+ * warm-up repetitions, and summarizes the time per call as percentiles.
+ * A case may run its body on several threads at once to measure lock
+ * contention; every thread starts each repetition together and its
+ * repetitions are pooled into one summary.
+ *
+ * Results are written as JSON, one result per line, and a previous
+ * results file can be loaded as a baseline to flag regressions of the
+ * median.
+ */
+
+#ifndef WTC_BENCH_HARNESS_H
+#define WTC_BENCH_HARNESS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define BENCH_MAX_NAME          64
+#define BENCH_MAX_THREADS       64
+
+/* Benchmark body: performs `ops` calls of the measured operation */
+typedef void (*bench_body_t)(void *ctx, int thread, long ops);
+
+typedef struct {
+    const char *name;
+    int threads;                /* Threads running the body at once */
+    long ops;                   /* Body calls per repetition and thread */
+    double items_per_op;        /* Work units per call (bytes, rules, ...) */
+    const char *item;           /* Name of the work unit */
+    bench_body_t body;
+    void *ctx;
+} bench_case_t;
+
+typedef struct {
+    int warmup;                 /* Untimed repetitions */
+    int repetitions;            /* Timed repetitions */
+} bench_params_t;
+
+/* Time per call, in ns */
+typedef struct {
+    char name[BENCH_MAX_NAME];
+    const char *item;
+    int threads;
+    long ops;
+    double items_per_op;
+    int samples;
+    double min_ns;
+    double mean_ns;
+    double p50_ns;
+    double p90_ns;
+    double p99_ns;
+    double max_ns;
+
+    /* Set by bench_compare() when the baseline has this result */
+    bool has_baseline;
+    double baseline_p50_ns;
+    double change_pct;
+    bool regression;
+} bench_result_t;
+
+/* Baseline entry, keyed by result name */
+typedef struct {
+    char name[BENCH_MAX_NAME];
+    double p50_ns;
+} bench_baseline_t;
+
+/* Run a case; returns false if the case is invalid or out of memory */
+bool bench_run(const bench_case_t *bench, const bench_params_t *params,
+               bench_result_t *result);
+
+/* Keep a value alive so the compiler cannot drop the work producing it */
+void bench_consume(uint64_t value);
+
+/* Write results as one JSON object */
+void bench_write_json(FILE *out, const bench_params_t *params,
+                      const bench_result_t *results, int count);
+
+/* Load the results of a previous run; returns the number of entries or
+ * -1 if the file cannot be read */
+int bench_load_baseline(const char *path, bench_baseline_t *entries, int max_count);
+
+/* Compare medians with the baseline; a result is a regression when its
+ * median is more than threshold_pct slower. Returns the regression count. */
+int bench_compare(bench_result_t *results, int count,
+                  const bench_baseline_t *baseline, int baseline_count,
+                  double threshold_pct);
+
+#endif /* WTC_BENCH_HARNESS_H */
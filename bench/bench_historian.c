@@ -0,0 +1,573 @@
+/*
+ * Water Treatment Controller - Historian Benchmark
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Drives the historian with a synthetic plant workload and measures:
+ *
+ *   - ingest rate of historian_record_sample()
+ *   - flush throughput into the segment store
+ *   - ratio and speed of each algorithm in compression.c
+ *   - latency percentiles of point, buffered, range and aggregate queries
+ *
+ * Each tag follows a random walk, a step sequence or a noisy sine, with
+ * occasional bursts of bad-quality samples. Generation is seeded, so two
+ * runs with the same options see the same data. Results are written as
+ * one JSON object for comparison between builds or machines.
+ *
+ * The historian is not started; flushes run inline on the calling
+ * thread so their cost is measured separately from ingest.
+ */
+
+#include <dirent.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/historian/compression.h"
+#include "../src/historian/historian.h"
+#include "../src/historian/historian_store.h"
+#include "../src/utils/logger.h"
+#include "../src/utils/time_utils.h"
+
+#define QUALITY_GOOD            192
+#define QUALITY_BAD             0
+#define COMPRESSION_TAG_LIMIT   64      /* Tags fed through each algorithm */
+#define AGGREGATE_INTERVAL_MS   60000
+
+typedef struct {
+    int tags;
+    uint32_t rate_ms;
+    uint32_t duration_s;
+    uint32_t flush_s;
+    uint32_t range_s;
+    int queries;
+    float dropout;                      /* Chance per sample of a bad burst */
+    float deadband;
+    uint64_t seed;
+    bool wal;
+    const char *dir;
+    const char *output;
+} bench_options_t;
+
+typedef enum {
+    SIGNAL_RANDOM_WALK = 0,
+    SIGNAL_STEP,
+    SIGNAL_SINE,
+    SIGNAL_KINDS
+} signal_kind_t;
+
+/* One synthetic process value */
+typedef struct {
+    signal_kind_t kind;
+    uint64_t rng;
+    float value;
+    float level;                        /* Walk centre, step target or sine offset */
+    float span;                         /* Walk bound, step size or amplitude */
+    float noise;
+    uint32_t period_ms;                 /* Step hold time or sine period */
+    uint64_t next_change_ms;
+    int bad_left;                       /* Remaining samples of a dropout */
+} signal_t;
+
+typedef struct {
+    uint64_t *us;
+    int count;
+} latency_set_t;
+
+/* ============== Workload ============== */
+
+static uint64_t rng_next(uint64_t *state) {
+    /* xorshift64* */
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+static float rng_uniform(uint64_t *state) {
+    return (float)(rng_next(state) >> 40) / (float)(1u << 24);
+}
+
+/* Roughly normal, mean 0 and unit variance */
+static float rng_gauss(uint64_t *state) {
+    float sum = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        sum += rng_uniform(state);
+    }
+    return (sum - 2.0f) * 1.7320508f;
+}
+
+static void signal_init(signal_t *sig, int tag, uint64_t seed) {
+    memset(sig, 0, sizeof(*sig));
+    sig->rng = (seed ^ ((uint64_t)(tag + 1) * 0x9E3779B97F4A7C15ULL)) | 1;
+    sig->kind = (signal_kind_t)(tag % SIGNAL_KINDS);
+    sig->level = 10.0f + 90.0f * rng_uniform(&sig->rng);
+    sig->span = 1.0f + 9.0f * rng_uniform(&sig->rng);
+    sig->noise = 0.02f + 0.2f * rng_uniform(&sig->rng);
+    sig->period_ms = 60000 + (uint32_t)(rng_uniform(&sig->rng) * 1740000.0f);
+    sig->value = sig->level;
+}
+
+static void signal_next(signal_t *sig, uint64_t t_ms, float dropout,
+                        float *value, uint8_t *quality) {
+    switch (sig->kind) {
+    case SIGNAL_RANDOM_WALK:
+        /* Mean-reverting so the walk stays within a plausible range */
+        sig->value += sig->noise * rng_gauss(&sig->rng) +
+                      0.01f * (sig->level - sig->value);
+        break;
+    case SIGNAL_STEP:
+        if (t_ms >= sig->next_change_ms) {
+            float steps = floorf(rng_uniform(&sig->rng) * 5.0f) - 2.0f;
+            sig->value = sig->level + steps * sig->span;
+            sig->next_change_ms = t_ms + sig->period_ms;
+        }
+        break;
+    case SIGNAL_SINE:
+    default: {
+        float phase = (float)(t_ms % sig->period_ms) / (float)sig->period_ms;
+        sig->value = sig->level + sig->span * sinf(6.2831853f * phase);
+        break;
+    }
+    }
+
+    *value = sig->value;
+    if (sig->kind != SIGNAL_RANDOM_WALK) {
+        *value += sig->noise * 0.1f * rng_gauss(&sig->rng);
+    }
+
+    /* Sensor faults hold the last value with bad quality */
+    if (sig->bad_left == 0 && rng_uniform(&sig->rng) < dropout) {
+        sig->bad_left = 1 + (int)(rng_uniform(&sig->rng) * 30.0f);
+    }
+    if (sig->bad_left > 0) {
+        sig->bad_left--;
+        *quality = QUALITY_BAD;
+    } else {
+        *quality = QUALITY_GOOD;
+    }
+}
+
+/* ============== Measurement ============== */
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static uint64_t percentile(const latency_set_t *set, double p) {
+    if (set->count == 0) return 0;
+    int i = (int)(p * (set->count - 1) + 0.5);
+    return set->us[i];
+}
+
+static void write_latency(FILE *out, const char *name, latency_set_t *set, bool last) {
+    qsort(set->us, set->count, sizeof(uint64_t), compare_u64);
+    fprintf(out,
+            "    \"%s\": {\"count\": %d, \"p50_us\": %llu, \"p90_us\": %llu, "
+            "\"p99_us\": %llu, \"max_us\": %llu}%s\n",
+            name, set->count,
+            (unsigned long long)percentile(set, 0.50),
+            (unsigned long long)percentile(set, 0.90),
+            (unsigned long long)percentile(set, 0.99),
+            (unsigned long long)(set->count ? set->us[set->count - 1] : 0),
+            last ? "" : ",");
+}
+
+static double rate(double amount, uint64_t us) {
+    return us > 0 ? amount * 1e6 / (double)us : 0.0;
+}
+
+static const char *compression_name(compression_t algorithm) {
+    switch (algorithm) {
+    case COMPRESSION_NONE:          return "none";
+    case COMPRESSION_SWINGING_DOOR: return "swinging_door";
+    case COMPRESSION_BOXCAR:        return "boxcar";
+    case COMPRESSION_DEADBAND:      return "deadband";
+    default:                        return "unknown";
+    }
+}
+
+/* Feed the same series through every algorithm */
+static void bench_compression(FILE *out, const bench_options_t *opt, uint64_t t0, int steps) {
+    static const compression_t algorithms[] = {
+        COMPRESSION_NONE, COMPRESSION_SWINGING_DOOR, COMPRESSION_BOXCAR, COMPRESSION_DEADBAND,
+    };
+    int tags = opt->tags < COMPRESSION_TAG_LIMIT ? opt->tags : COMPRESSION_TAG_LIMIT;
+
+    historian_sample_t *series = malloc((size_t)steps * sizeof(historian_sample_t));
+    if (!series) {
+        fprintf(stderr, "Out of memory generating compression input\n");
+        exit(1);
+    }
+
+    fprintf(out, "  \"compression\": [\n");
+    size_t n_alg = sizeof(algorithms) / sizeof(algorithms[0]);
+    for (size_t a = 0; a < n_alg; a++) {
+        uint64_t in = 0, kept = 0, elapsed_us = 0;
+
+        for (int tag = 0; tag < tags; tag++) {
+            signal_t sig;
+            signal_init(&sig, tag, opt->seed);
+            for (int i = 0; i < steps; i++) {
+                series[i].timestamp_ms = t0 + (uint64_t)i * opt->rate_ms;
+                series[i].tag_id = tag;
+                signal_next(&sig, series[i].timestamp_ms, opt->dropout,
+                            &series[i].value, &series[i].quality);
+            }
+
+            historian_sample_t *compressed = NULL;
+            int compressed_count = 0;
+            uint64_t start = time_get_monotonic_us();
+            wtc_result_t res = compression_compress_samples(series, steps, algorithms[a],
+                                                            opt->deadband, &compressed,
+                                                            &compressed_count);
+            elapsed_us += time_get_monotonic_us() - start;
+            free(compressed);
+            if (res != WTC_OK) {
+                fprintf(stderr, "Compression %s failed: %d\n", compression_name(algorithms[a]), res);
+                exit(1);
+            }
+
+            in += (uint64_t)steps;
+            kept += (uint64_t)compressed_count;
+        }
+
+        fprintf(out,
+                "    {\"algorithm\": \"%s\", \"samples_in\": %llu, \"samples_out\": %llu, "
+                "\"ratio\": %.3f, \"samples_per_sec\": %.0f}%s\n",
+                compression_name(algorithms[a]),
+                (unsigned long long)in, (unsigned long long)kept,
+                kept > 0 ? (double)in / (double)kept : 0.0,
+                rate((double)in, elapsed_us),
+                a + 1 < n_alg ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+    free(series);
+}
+
+/* min/max/avg per interval over a cursor, as a trend display asks for */
+static int aggregate_range(const char *dir, int tag, uint64_t start, uint64_t end) {
+    historian_cursor_t *cursor = NULL;
+    if (historian_cursor_open(&cursor, dir, tag, start, end) != WTC_OK) return 0;
+
+    int buckets = 0;
+    uint64_t bucket_end = 0;
+    float min = 0.0f, max = 0.0f;
+    double sum = 0.0;
+    int count = 0;
+    historian_sample_t sample;
+    while (historian_cursor_next(cursor, &sample) == WTC_OK) {
+        if (sample.timestamp_ms >= bucket_end) {
+            if (count > 0) buckets++;
+            bucket_end = sample.timestamp_ms - sample.timestamp_ms % AGGREGATE_INTERVAL_MS +
+                         AGGREGATE_INTERVAL_MS;
+            min = max = sample.value;
+            sum = 0.0;
+            count = 0;
+        }
+        if (sample.value < min) min = sample.value;
+        if (sample.value > max) max = sample.value;
+        sum += sample.value;
+        count++;
+    }
+    historian_cursor_close(cursor);
+
+    /* Keep the arithmetic from being optimized away */
+    volatile float sink = (float)(count > 0 ? sum / count : 0.0) + min + max;
+    (void)sink;
+    return buckets + (count > 0);
+}
+
+/* ============== Driver ============== */
+
+static void remove_dir(const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) return;
+    struct dirent *entry;
+    char file[512];
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        unlink(file);
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [options]\n\n", program);
+    printf("Options:\n");
+    printf("  -n, --tags <n>          Historian tags (default: 200)\n");
+    printf("  -r, --rate-ms <ms>      Sample period per tag (default: 1000)\n");
+    printf("  -d, --duration-s <s>    Simulated time span (default: 3600)\n");
+    printf("  -f, --flush-s <s>       Simulated time between flushes (default: 300)\n");
+    printf("  -R, --range-s <s>       Span of range queries (default: 300)\n");
+    printf("  -q, --queries <n>       Queries per kind (default: 500)\n");
+    printf("  -p, --dropout <p>       Chance per sample of a bad-quality burst (default: 0.001)\n");
+    printf("  -b, --deadband <v>      Deadband for the compression runs (default: 0.1)\n");
+    printf("  -s, --seed <n>          Workload seed (default: 1)\n");
+    printf("  -w, --wal               Enable the historian write-ahead log\n");
+    printf("  -D, --dir <path>        Data directory, kept afterwards (default: temporary)\n");
+    printf("  -o, --output <file>     Write JSON results to file (default: stdout)\n");
+    printf("  -h, --help              Show this help\n");
+}
+
+static void parse_options(int argc, char *argv[], bench_options_t *opt) {
+    static struct option long_options[] = {
+        {"tags",       required_argument, 0, 'n'},
+        {"rate-ms",    required_argument, 0, 'r'},
+        {"duration-s", required_argument, 0, 'd'},
+        {"flush-s",    required_argument, 0, 'f'},
+        {"range-s",    required_argument, 0, 'R'},
+        {"queries",    required_argument, 0, 'q'},
+        {"dropout",    required_argument, 0, 'p'},
+        {"deadband",   required_argument, 0, 'b'},
+        {"seed",       required_argument, 0, 's'},
+        {"wal",        no_argument,       0, 'w'},
+        {"dir",        required_argument, 0, 'D'},
+        {"output",     required_argument, 0, 'o'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:r:d:f:R:q:p:b:s:wD:o:h", long_options, NULL)) != -1) {
+        switch (c) {
+        case 'n': opt->tags = atoi(optarg); break;
+        case 'r': opt->rate_ms = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'd': opt->duration_s = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'f': opt->flush_s = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'R': opt->range_s = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'q': opt->queries = atoi(optarg); break;
+        case 'p': opt->dropout = strtof(optarg, NULL); break;
+        case 'b': opt->deadband = strtof(optarg, NULL); break;
+        case 's': opt->seed = strtoull(optarg, NULL, 10); break;
+        case 'w': opt->wal = true; break;
+        case 'D': opt->dir = optarg; break;
+        case 'o': opt->output = optarg; break;
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            exit(c == 'h' ? 0 : 1);
+        }
+    }
+
+    if (opt->tags <= 0 || opt->rate_ms == 0 || opt->duration_s == 0 ||
+        opt->flush_s == 0 || opt->queries < 0 ||
+        (uint64_t)opt->duration_s * 1000 < opt->rate_ms) {
+        fprintf(stderr, "Invalid options\n");
+        print_usage(argv[0]);
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bench_options_t opt = {
+        .tags = 200,
+        .rate_ms = 1000,
+        .duration_s = 3600,
+        .flush_s = 300,
+        .range_s = 300,
+        .queries = 500,
+        .dropout = 0.001f,
+        .deadband = 0.1f,
+        .seed = 1,
+    };
+    parse_options(argc, argv, &opt);
+    logger_set_level(LOG_LEVEL_WARN);
+
+    FILE *out = stdout;
+    if (opt.output && !(out = fopen(opt.output, "w"))) {
+        fprintf(stderr, "Cannot open %s\n", opt.output);
+        return 1;
+    }
+
+    char tmp_dir[] = "/tmp/wtc_bench_historianXXXXXX";
+    const char *dir = opt.dir;
+    if (!dir) {
+        if (!mkdtemp(tmp_dir)) {
+            fprintf(stderr, "Cannot create a temporary directory\n");
+            return 1;
+        }
+        dir = tmp_dir;
+    }
+
+    int steps = (int)((uint64_t)opt.duration_s * 1000 / opt.rate_ms);
+    int flush_steps = (int)((uint64_t)opt.flush_s * 1000 / opt.rate_ms);
+    if (flush_steps <= 0) flush_steps = 1;
+
+    /* Recent past, so retention would keep it all */
+    uint64_t span_ms = (uint64_t)steps * opt.rate_ms;
+    uint64_t t0 = time_get_ms() - span_ms;
+    t0 -= t0 % opt.rate_ms;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"historian\",\n");
+    fprintf(out,
+            "  \"config\": {\"tags\": %d, \"rate_ms\": %u, \"duration_s\": %u, "
+            "\"flush_s\": %u, \"range_s\": %u, \"queries\": %d, \"dropout\": %g, "
+            "\"deadband\": %g, \"seed\": %llu, \"wal\": %s},\n",
+            opt.tags, opt.rate_ms, opt.duration_s, opt.flush_s, opt.range_s, opt.queries,
+            opt.dropout, opt.deadband, (unsigned long long)opt.seed,
+            opt.wal ? "true" : "false");
+
+    bench_compression(out, &opt, t0, steps);
+
+    /* Buffers hold one flush period, so nothing spills or drops */
+    historian_config_t config = {
+        .database_path = dir,
+        .max_tags = opt.tags,
+        .buffer_size = flush_steps,
+        .default_sample_rate_ms = opt.rate_ms,
+        .retention_days = 36500,
+        .wal_enabled = opt.wal,
+    };
+    historian_t *hist = NULL;
+    if (historian_init(&hist, &config) != WTC_OK) {
+        fprintf(stderr, "historian_init failed\n");
+        return 1;
+    }
+
+    int *tag_ids = malloc((size_t)opt.tags * sizeof(int));
+    signal_t *signals = malloc((size_t)opt.tags * sizeof(signal_t));
+    if (!tag_ids || !signals) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < opt.tags; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "tag-%d", i);
+        if (historian_add_tag(hist, "bench-rtu", i, name, opt.rate_ms, 0.0f,
+                              COMPRESSION_NONE, &tag_ids[i]) != WTC_OK) {
+            fprintf(stderr, "historian_add_tag failed\n");
+            return 1;
+        }
+        signal_init(&signals[i], i, opt.seed);
+    }
+
+    /* Ingest, flushing every flush period; the tail stays buffered */
+    uint64_t ingest_us = 0, flush_us = 0;
+    int flushes = 0;
+    for (int step = 0; step < steps; step++) {
+        uint64_t ts = t0 + (uint64_t)step * opt.rate_ms;
+        uint64_t start = time_get_monotonic_us();
+        for (int i = 0; i < opt.tags; i++) {
+            float value;
+            uint8_t quality;
+            signal_next(&signals[i], ts, opt.dropout, &value, &quality);
+            historian_record_sample(hist, tag_ids[i], ts, value, quality);
+        }
+        ingest_us += time_get_monotonic_us() - start;
+
+        if ((step + 1) % flush_steps == 0 && step + 1 < steps) {
+            start = time_get_monotonic_us();
+            historian_flush(hist);
+            flush_us += time_get_monotonic_us() - start;
+            flushes++;
+        }
+    }
+
+    historian_stats_t stats;
+    historian_get_stats(hist, &stats);
+    uint64_t recorded = (uint64_t)steps * opt.tags;
+    double flushed_bytes = (double)stats.samples_flushed * HISTORIAN_RECORD_SIZE;
+
+    fprintf(out,
+            "  \"ingest\": {\"samples\": %llu, \"seconds\": %.3f, \"samples_per_sec\": %.0f, "
+            "\"dropped\": %llu},\n",
+            (unsigned long long)recorded, ingest_us / 1e6, rate((double)recorded, ingest_us),
+            (unsigned long long)stats.samples_dropped);
+    fprintf(out,
+            "  \"flush\": {\"flushes\": %d, \"samples\": %llu, \"bytes\": %.0f, "
+            "\"seconds\": %.3f, \"mb_per_sec\": %.2f},\n",
+            flushes, (unsigned long long)stats.samples_flushed, flushed_bytes,
+            flush_us / 1e6, rate(flushed_bytes / (1024.0 * 1024.0), flush_us));
+
+    /* Queries: random tags and windows over the flushed span */
+    latency_set_t point = {0}, recent = {0}, range = {0}, aggregate = {0};
+    uint64_t *lat = calloc((size_t)opt.queries * 4 + 4, sizeof(uint64_t));
+    historian_sample_t *window = malloc((size_t)flush_steps * sizeof(historian_sample_t));
+    if (!lat || !window) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    point.us = lat;
+    recent.us = lat + opt.queries + 1;
+    range.us = lat + 2 * (opt.queries + 1);
+    aggregate.us = lat + 3 * (opt.queries + 1);
+
+    uint64_t rng = opt.seed | 1;
+    uint64_t flushed_end = t0 + (uint64_t)flushes * flush_steps * opt.rate_ms;
+    uint64_t range_ms = (uint64_t)opt.range_s * 1000;
+    uint64_t tail_start = flushed_end;
+
+    for (int q = 0; q < opt.queries; q++) {
+        int tag = tag_ids[rng_next(&rng) % (uint64_t)opt.tags];
+
+        uint64_t start = time_get_monotonic_us();
+        float value;
+        uint64_t value_ms;
+        historian_get_current(hist, tag, &value, &value_ms, NULL);
+        point.us[point.count++] = time_get_monotonic_us() - start;
+
+        /* The unflushed tail, served from memory */
+        int count = 0;
+        start = time_get_monotonic_us();
+        historian_query(hist, tag, tail_start, UINT64_MAX, window, &count, flush_steps);
+        recent.us[recent.count++] = time_get_monotonic_us() - start;
+
+        if (flushes == 0) continue;
+
+        uint64_t flushed_ms = flushed_end - t0;
+        uint64_t span = range_ms < flushed_ms ? range_ms : flushed_ms;
+        uint64_t from = t0 + (flushed_ms > span ? rng_next(&rng) % (flushed_ms - span) : 0);
+
+        start = time_get_monotonic_us();
+        historian_cursor_t *cursor = NULL;
+        if (historian_cursor_open(&cursor, dir, tag, from, from + span - 1) == WTC_OK) {
+            historian_sample_t sample;
+            while (historian_cursor_next(cursor, &sample) == WTC_OK) {
+                count++;
+            }
+            historian_cursor_close(cursor);
+        }
+        range.us[range.count++] = time_get_monotonic_us() - start;
+
+        /* Aggregates cover a longer window at one-minute resolution */
+        uint64_t agg_span = span * 12 < flushed_ms ? span * 12 : flushed_ms;
+        from = t0 + (flushed_ms > agg_span ? rng_next(&rng) % (flushed_ms - agg_span) : 0);
+        start = time_get_monotonic_us();
+        aggregate_range(dir, tag, from, from + agg_span - 1);
+        aggregate.us[aggregate.count++] = time_get_monotonic_us() - start;
+    }
+
+    fprintf(out, "  \"queries\": {\n");
+    write_latency(out, "point", &point, false);
+    write_latency(out, "recent", &recent, false);
+    write_latency(out, "range", &range, false);
+    write_latency(out, "aggregate", &aggregate, true);
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+
+    free(window);
+    free(lat);
+    free(signals);
+    free(tag_ids);
+    historian_cleanup(hist);
+
+    if (!opt.dir) {
+        remove_dir(dir);
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,266 @@
+/*
+ * Water Treatment Controller - Sensor-to-Actuator Latency Benchmark
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Runs the control engine in closed loop against the simulator in real
+ * time, with latency tracing on, and reports per-loop histograms:
+ *
+ *   input    sensor published -> read by the control scan
+ *   compute  scan read -> output written to the registry
+ *   send     output written -> picked up by the simulated RTU
+ *   total    sensor published -> output picked up
+ *
+ * The simulator publishes from its own thread at --rate and the control
+ * engine scans from its own thread every --scan ms, as in the controller,
+ * so the figures include the polling delay between the two. Results are
+ * written as one JSON object.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/control/control_engine.h"
+#include "../src/core/latency_trace.h"
+#include "../src/registry/rtu_registry.h"
+#include "../src/simulation/simulator.h"
+#include "../src/utils/logger.h"
+#include "../src/utils/time_utils.h"
+
+/* Demo RTU of the simulator's normal scenario (registry slots) */
+#define DEMO_RTU        "demo-rtu-01"
+#define SLOT_FLOW       3
+#define SLOT_LEVEL      4
+#define SLOT_VALVE      5
+#define SLOT_PUMP       6
+
+typedef struct {
+    int duration_s;
+    int scan_ms;
+    int rate_hz;
+    const char *output;
+} bench_options_t;
+
+typedef struct {
+    simulator_t *sim;
+    uint32_t period_ms;
+    volatile bool running;
+} sim_runner_t;
+
+/* Publish sensor values at the configured rate */
+static void *simulator_thread(void *arg) {
+    sim_runner_t *runner = arg;
+    uint64_t next_ms = time_get_monotonic_ms();
+
+    while (runner->running) {
+        simulator_process(runner->sim);
+
+        next_ms += runner->period_ms;
+        uint64_t now_ms = time_get_monotonic_ms();
+        if (now_ms < next_ms) {
+            time_sleep_ms((uint32_t)(next_ms - now_ms));
+        } else {
+            next_ms = now_ms;
+        }
+    }
+    return NULL;
+}
+
+static void add_loop(control_engine_t *engine, const char *name, int input_slot,
+                     int output_slot, float setpoint) {
+    pid_loop_t loop = {0};
+    snprintf(loop.name, sizeof(loop.name), "%s", name);
+    loop.enabled = true;
+    loop.mode = PID_MODE_AUTO;
+    loop.kp = 2.0f;
+    loop.ki = 0.05f;
+    loop.setpoint = setpoint;
+    loop.output_max = 100.0f;
+    snprintf(loop.input_rtu, sizeof(loop.input_rtu), "%s", DEMO_RTU);
+    loop.input_slot = input_slot;
+    snprintf(loop.output_rtu, sizeof(loop.output_rtu), "%s", DEMO_RTU);
+    loop.output_slot = output_slot;
+
+    int loop_id;
+    if (control_engine_add_pid_loop(engine, &loop, &loop_id) != WTC_OK) {
+        fprintf(stderr, "Cannot add loop %s\n", name);
+        exit(1);
+    }
+}
+
+static void print_stage(FILE *out, latency_trace_t *trace, uint32_t id,
+                        latency_stage_t stage, bool last) {
+    latency_summary_t s;
+    latency_trace_get_summary(trace, id, stage, &s);
+    fprintf(out,
+            "        \"%s\": {\"count\": %llu, \"mean_us\": %llu, \"p50_us\": %llu, "
+            "\"p90_us\": %llu, \"p99_us\": %llu, \"max_us\": %llu}%s\n",
+            latency_trace_stage_name(stage),
+            (unsigned long long)s.count, (unsigned long long)s.mean_us,
+            (unsigned long long)s.p50_us, (unsigned long long)s.p90_us,
+            (unsigned long long)s.p99_us, (unsigned long long)s.max_us,
+            last ? "" : ",");
+}
+
+static void print_results(FILE *out, const bench_options_t *opt, latency_trace_t *trace) {
+    static const latency_stage_t stages[] = {
+        LATENCY_STAGE_INPUT, LATENCY_STAGE_COMPUTE, LATENCY_STAGE_SEND, LATENCY_STAGE_TOTAL,
+    };
+    const int stage_count = (int)(sizeof(stages) / sizeof(stages[0]));
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"latency\",\n");
+    fprintf(out, "  \"config\": {\"duration_s\": %d, \"scan_ms\": %d, \"rate_hz\": %d},\n",
+            opt->duration_s, opt->scan_ms, opt->rate_hz);
+    fprintf(out, "  \"loops\": [\n");
+
+    uint32_t ids[LATENCY_MAX_PATHS];
+    int count = latency_trace_list_paths(trace, ids, LATENCY_MAX_PATHS);
+    for (int i = 0; i < count; i++) {
+        char name[32];
+        latency_trace_path_name(ids[i], name, sizeof(name));
+        fprintf(out, "    {\n");
+        fprintf(out, "      \"loop\": \"%s\",\n", name);
+        fprintf(out, "      \"stages\": {\n");
+        for (int s = 0; s < stage_count; s++) {
+            print_stage(out, trace, ids[i], stages[s], s == stage_count - 1);
+        }
+        fprintf(out, "      }\n");
+        fprintf(out, "    }%s\n", i == count - 1 ? "" : ",");
+    }
+
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+/* ============== Main ============== */
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("\nOptions:\n");
+    printf("  -d, --duration SEC   Measured run time (default: 10)\n");
+    printf("  -s, --scan MS        Control scan period (default: 100)\n");
+    printf("  -r, --rate HZ        Simulator publish rate (default: 10)\n");
+    printf("  -o, --output FILE    Write JSON results to FILE (default: stdout)\n");
+    printf("  -h, --help           Show this help\n");
+}
+
+static void parse_options(int argc, char *argv[], bench_options_t *opt) {
+    static struct option long_options[] = {
+        {"duration",   required_argument, 0, 'd'},
+        {"scan",       required_argument, 0, 's'},
+        {"rate",       required_argument, 0, 'r'},
+        {"output",     required_argument, 0, 'o'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "d:s:r:o:h", long_options, NULL)) != -1) {
+        switch (c) {
+        case 'd': opt->duration_s = atoi(optarg); break;
+        case 's': opt->scan_ms = atoi(optarg); break;
+        case 'r': opt->rate_hz = atoi(optarg); break;
+        case 'o': opt->output = optarg; break;
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            exit(c == 'h' ? 0 : 1);
+        }
+    }
+
+    if (opt->duration_s <= 0 || opt->scan_ms <= 0 ||
+        opt->rate_hz <= 0 || opt->rate_hz > 1000) {
+        fprintf(stderr, "Invalid options\n");
+        print_usage(argv[0]);
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bench_options_t opt = {
+        .duration_s = 10,
+        .scan_ms = 100,
+        .rate_hz = 10,
+    };
+    parse_options(argc, argv, &opt);
+    /* The loops are not tuned to the plant; their watchdog warnings are noise here */
+    logger_set_level(LOG_LEVEL_ERROR);
+
+    FILE *out = stdout;
+    if (opt.output && !(out = fopen(opt.output, "w"))) {
+        fprintf(stderr, "Cannot open %s\n", opt.output);
+        return 1;
+    }
+
+    rtu_registry_t *registry = NULL;
+    registry_config_t reg_config = {0};
+    reg_config.max_devices = 4;
+
+    latency_trace_t *trace = NULL;
+    simulator_t *sim = NULL;
+    control_engine_t *engine = NULL;
+
+    simulator_config_t sim_config = {
+        .scenario = SIM_SCENARIO_NORMAL,
+        .update_rate_hz = (float)opt.rate_hz,
+        .enable_pid_response = true,
+        .time_scale = 1.0f,
+    };
+    control_engine_config_t ctrl_config = {
+        .scan_rate_ms = (uint32_t)opt.scan_ms,
+    };
+
+    if (rtu_registry_init(&registry, &reg_config) != WTC_OK ||
+        latency_trace_init(&trace) != WTC_OK ||
+        simulator_init(&sim, &sim_config) != WTC_OK ||
+        control_engine_init(&engine, &ctrl_config) != WTC_OK) {
+        fprintf(stderr, "Cannot create components\n");
+        return 1;
+    }
+
+    simulator_set_registry(sim, registry);
+    simulator_set_latency_trace(sim, trace);
+    simulator_start(sim);
+
+    control_engine_set_registry(engine, registry);
+    control_engine_set_latency_trace(engine, trace);
+    add_loop(engine, "level", SLOT_LEVEL, SLOT_PUMP, 50.0f);
+    add_loop(engine, "flow", SLOT_FLOW, SLOT_VALVE, 100.0f);
+
+    sim_runner_t runner = {
+        .sim = sim,
+        .period_ms = 1000u / (uint32_t)opt.rate_hz,
+        .running = true,
+    };
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, simulator_thread, &runner) != 0) {
+        fprintf(stderr, "Cannot start simulator thread\n");
+        return 1;
+    }
+    control_engine_start(engine);
+
+    /* Let both threads settle, then measure */
+    time_sleep_ms(1000);
+    latency_trace_reset(trace);
+    time_sleep_ms((uint32_t)opt.duration_s * 1000u);
+
+    control_engine_stop(engine);
+    runner.running = false;
+    pthread_join(thread, NULL);
+
+    print_results(out, &opt, trace);
+
+    control_engine_cleanup(engine);
+    simulator_cleanup(sim);
+    latency_trace_cleanup(trace);
+    rtu_registry_cleanup(registry);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
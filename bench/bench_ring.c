@@ -0,0 +1,437 @@
+/*
+ * Water Treatment Controller - Ring Buffer Benchmark
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Compares the lock-free rings in ring.h with the mutex-protected
+ * circular_buffer_t:
+ *
+ *   - uncontended cost of a push/pop pair on one thread
+ *   - one producer thread handing elements to one consumer thread
+ *   - several producer threads feeding one consumer thread
+ *
+ * Each ring is driven element by element, in batches, and with the
+ * consumer sleeping on the futex (blocking rings). Every element carries
+ * its producer and sequence number, and the consumer checks that each
+ * producer's elements arrive complete and in order, so a run doubles as
+ * a stress test; the exit status is non-zero if any check failed.
+ * Results are written as one JSON object.
+ *
+ * circular_buffer_t overwrites the oldest element when full, so its
+ * producers wait for room before pushing instead.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/utils/buffer.h"
+#include "../src/utils/logger.h"
+#include "../src/utils/ring.h"
+#include "../src/utils/time_utils.h"
+
+#define MAX_PRODUCERS           16
+#define MAX_BATCH               256
+#define MAX_ELEMENT_SIZE        256
+#define WAIT_TIMEOUT_MS         100
+
+typedef struct {
+    long items;                         /* Per producer */
+    int producers;
+    size_t element_size;
+    size_t capacity;
+    size_t batch;
+    long pairs;                         /* Uncontended push/pop pairs */
+    const char *output;
+} bench_options_t;
+
+typedef enum {
+    QUEUE_MUTEX = 0,
+    QUEUE_SPSC,
+    QUEUE_MPSC
+} queue_kind_t;
+
+typedef struct {
+    const char *name;
+    queue_kind_t kind;
+    bool batch;
+    bool blocking;
+    bool multi;                         /* Use opt.producers instead of one */
+} scenario_t;
+
+/* Element header; the rest of each element is payload */
+typedef struct {
+    uint32_t producer;
+    uint32_t seq;
+} element_header_t;
+
+typedef struct {
+    const bench_options_t *opt;
+    const scenario_t *scenario;
+    int producers;
+    union {
+        circular_buffer_t buffer;
+        spsc_ring_t spsc;
+        mpsc_ring_t mpsc;
+    } queue;
+    uint64_t full_retries;
+    uint64_t empty_retries;
+    uint64_t errors;
+} bench_run_t;
+
+typedef struct {
+    bench_run_t *run;
+    uint32_t id;
+} producer_arg_t;
+
+/* ============== Queue Operations ============== */
+
+static size_t queue_push(bench_run_t *run, const uint8_t *elements, size_t count) {
+    switch (run->scenario->kind) {
+    case QUEUE_MUTEX:
+        /* Leave room for the other producers' in-flight pushes */
+        if (buffer_count(&run->queue.buffer) + (size_t)run->producers >
+            run->queue.buffer.capacity) {
+            return 0;
+        }
+        buffer_push(&run->queue.buffer, elements);
+        return 1;
+    case QUEUE_SPSC:
+        if (count == 1) {
+            return spsc_ring_push(&run->queue.spsc, elements) == WTC_OK;
+        }
+        return spsc_ring_push_batch(&run->queue.spsc, elements, count);
+    case QUEUE_MPSC:
+    default:
+        if (count == 1) {
+            return mpsc_ring_push(&run->queue.mpsc, elements) == WTC_OK;
+        }
+        return mpsc_ring_push_batch(&run->queue.mpsc, elements, count);
+    }
+}
+
+static size_t queue_pop(bench_run_t *run, uint8_t *elements, size_t max_count) {
+    const scenario_t *s = run->scenario;
+
+    switch (s->kind) {
+    case QUEUE_MUTEX:
+        return buffer_pop(&run->queue.buffer, elements) == WTC_OK;
+    case QUEUE_SPSC:
+        if (s->blocking) {
+            return spsc_ring_pop_wait(&run->queue.spsc, elements, WAIT_TIMEOUT_MS) == WTC_OK;
+        }
+        if (max_count == 1) {
+            return spsc_ring_pop(&run->queue.spsc, elements) == WTC_OK;
+        }
+        return spsc_ring_pop_batch(&run->queue.spsc, elements, max_count);
+    case QUEUE_MPSC:
+    default:
+        if (s->blocking) {
+            return mpsc_ring_pop_wait(&run->queue.mpsc, elements, WAIT_TIMEOUT_MS) == WTC_OK;
+        }
+        if (max_count == 1) {
+            return mpsc_ring_pop(&run->queue.mpsc, elements) == WTC_OK;
+        }
+        return mpsc_ring_pop_batch(&run->queue.mpsc, elements, max_count);
+    }
+}
+
+static wtc_result_t queue_init(bench_run_t *run) {
+    const bench_options_t *opt = run->opt;
+
+    switch (run->scenario->kind) {
+    case QUEUE_MUTEX:
+        return buffer_init(&run->queue.buffer, opt->element_size, opt->capacity);
+    case QUEUE_SPSC:
+        return spsc_ring_init(&run->queue.spsc, opt->element_size, opt->capacity,
+                              run->scenario->blocking);
+    case QUEUE_MPSC:
+    default:
+        return mpsc_ring_init(&run->queue.mpsc, opt->element_size, opt->capacity,
+                              run->scenario->blocking);
+    }
+}
+
+static void queue_free(bench_run_t *run) {
+    switch (run->scenario->kind) {
+    case QUEUE_MUTEX: buffer_free(&run->queue.buffer); break;
+    case QUEUE_SPSC:  spsc_ring_free(&run->queue.spsc); break;
+    case QUEUE_MPSC:
+    default:          mpsc_ring_free(&run->queue.mpsc); break;
+    }
+}
+
+/* ============== Threads ============== */
+
+static void *producer_thread(void *arg) {
+    producer_arg_t *p = arg;
+    bench_run_t *run = p->run;
+    size_t size = run->opt->element_size;
+    size_t batch = run->scenario->batch ? run->opt->batch : 1;
+    uint8_t elements[MAX_BATCH * MAX_ELEMENT_SIZE];
+    uint64_t retries = 0;
+
+    memset(elements, 0xA5, batch * size);
+
+    long seq = 0;
+    while (seq < run->opt->items) {
+        size_t count = batch;
+        if ((long)count > run->opt->items - seq) {
+            count = (size_t)(run->opt->items - seq);
+        }
+        for (size_t i = 0; i < count; i++) {
+            element_header_t header = {p->id, (uint32_t)(seq + (long)i)};
+            memcpy(elements + i * size, &header, sizeof(header));
+        }
+
+        size_t sent = 0;
+        while (sent < count) {
+            size_t n = queue_push(run, elements + sent * size, count - sent);
+            if (n == 0) {
+                retries++;
+                sched_yield();
+            }
+            sent += n;
+        }
+        seq += (long)count;
+    }
+
+    __atomic_add_fetch(&run->full_retries, retries, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void consume(bench_run_t *run) {
+    size_t size = run->opt->element_size;
+    size_t batch = run->scenario->batch ? run->opt->batch : 1;
+    long total = run->opt->items * run->producers;
+    uint32_t next_seq[MAX_PRODUCERS] = {0};
+    uint8_t elements[MAX_BATCH * MAX_ELEMENT_SIZE];
+
+    long received = 0;
+    while (received < total) {
+        size_t n = queue_pop(run, elements, batch);
+        if (n == 0) {
+            run->empty_retries++;
+            if (!run->scenario->blocking) {
+                sched_yield();
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            element_header_t header;
+            memcpy(&header, elements + i * size, sizeof(header));
+            if (header.producer >= (uint32_t)run->producers ||
+                header.seq != next_seq[header.producer]) {
+                run->errors++;
+                if (header.producer < (uint32_t)run->producers) {
+                    next_seq[header.producer] = header.seq + 1;
+                }
+                continue;
+            }
+            next_seq[header.producer]++;
+        }
+        received += (long)n;
+    }
+}
+
+/* ============== Scenarios ============== */
+
+static double rate(double amount, uint64_t us) {
+    return us > 0 ? amount * 1e6 / (double)us : 0.0;
+}
+
+/* Push/pop pairs on one thread: the cost of the operations themselves */
+static void bench_uncontended(FILE *out, const bench_options_t *opt) {
+    static const scenario_t queues[] = {
+        {"mutex", QUEUE_MUTEX, false, false, false},
+        {"spsc",  QUEUE_SPSC,  false, false, false},
+        {"mpsc",  QUEUE_MPSC,  false, false, false},
+    };
+    int n = (int)(sizeof(queues) / sizeof(queues[0]));
+    uint8_t element[MAX_ELEMENT_SIZE] = {0};
+
+    fprintf(out, "  \"uncontended\": {\n");
+    for (int q = 0; q < n; q++) {
+        bench_run_t run = {.opt = opt, .scenario = &queues[q], .producers = 1};
+        if (queue_init(&run) != WTC_OK) {
+            fprintf(stderr, "Cannot create %s queue\n", queues[q].name);
+            exit(1);
+        }
+
+        uint64_t start = time_get_monotonic_us();
+        for (long i = 0; i < opt->pairs; i++) {
+            queue_push(&run, element, 1);
+            queue_pop(&run, element, 1);
+        }
+        uint64_t us = time_get_monotonic_us() - start;
+
+        fprintf(out, "    \"%s\": {\"pairs\": %ld, \"ns_per_pair\": %.1f}%s\n",
+                queues[q].name, opt->pairs,
+                opt->pairs > 0 ? (double)us * 1000.0 / (double)opt->pairs : 0.0,
+                q + 1 < n ? "," : "");
+        queue_free(&run);
+    }
+    fprintf(out, "  },\n");
+}
+
+static uint64_t bench_transfer(FILE *out, const bench_options_t *opt,
+                               const scenario_t *scenario, bool last) {
+    bench_run_t run = {
+        .opt = opt,
+        .scenario = scenario,
+        .producers = scenario->multi ? opt->producers : 1,
+    };
+    if (queue_init(&run) != WTC_OK) {
+        fprintf(stderr, "Cannot create %s queue\n", scenario->name);
+        exit(1);
+    }
+
+    pthread_t threads[MAX_PRODUCERS];
+    producer_arg_t args[MAX_PRODUCERS];
+
+    uint64_t start = time_get_monotonic_us();
+    for (int i = 0; i < run.producers; i++) {
+        args[i].run = &run;
+        args[i].id = (uint32_t)i;
+        if (pthread_create(&threads[i], NULL, producer_thread, &args[i]) != 0) {
+            fprintf(stderr, "pthread_create failed\n");
+            exit(1);
+        }
+    }
+    consume(&run);
+    for (int i = 0; i < run.producers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    uint64_t us = time_get_monotonic_us() - start;
+
+    double items = (double)opt->items * run.producers;
+    fprintf(out,
+            "    \"%s\": {\"producers\": %d, \"items\": %.0f, \"seconds\": %.3f, "
+            "\"items_per_sec\": %.0f, \"full_retries\": %llu, \"empty_retries\": %llu, "
+            "\"errors\": %llu}%s\n",
+            scenario->name, run.producers, items, us / 1e6, rate(items, us),
+            (unsigned long long)run.full_retries, (unsigned long long)run.empty_retries,
+            (unsigned long long)run.errors, last ? "" : ",");
+
+    queue_free(&run);
+    return run.errors;
+}
+
+/* ============== Main ============== */
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("\nOptions:\n");
+    printf("  -n, --items N        Elements per producer (default: 1000000)\n");
+    printf("  -p, --producers N    Producers in the MPSC scenarios (default: 4)\n");
+    printf("  -e, --element N      Element size in bytes (default: 32)\n");
+    printf("  -c, --capacity N     Queue capacity (default: 1024)\n");
+    printf("  -b, --batch N        Batch size (default: 32)\n");
+    printf("  -u, --pairs N        Uncontended push/pop pairs (default: 10000000)\n");
+    printf("  -o, --output FILE    Write JSON results to FILE (default: stdout)\n");
+    printf("  -h, --help           Show this help\n");
+}
+
+static void parse_options(int argc, char *argv[], bench_options_t *opt) {
+    static struct option long_options[] = {
+        {"items",      required_argument, 0, 'n'},
+        {"producers",  required_argument, 0, 'p'},
+        {"element",    required_argument, 0, 'e'},
+        {"capacity",   required_argument, 0, 'c'},
+        {"batch",      required_argument, 0, 'b'},
+        {"pairs",      required_argument, 0, 'u'},
+        {"output",     required_argument, 0, 'o'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:p:e:c:b:u:o:h", long_options, NULL)) != -1) {
+        switch (c) {
+        case 'n': opt->items = atol(optarg); break;
+        case 'p': opt->producers = atoi(optarg); break;
+        case 'e': opt->element_size = (size_t)strtoul(optarg, NULL, 10); break;
+        case 'c': opt->capacity = (size_t)strtoul(optarg, NULL, 10); break;
+        case 'b': opt->batch = (size_t)strtoul(optarg, NULL, 10); break;
+        case 'u': opt->pairs = atol(optarg); break;
+        case 'o': opt->output = optarg; break;
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            exit(c == 'h' ? 0 : 1);
+        }
+    }
+
+    if (opt->items <= 0 || opt->items > UINT32_MAX || opt->pairs < 0 ||
+        opt->producers <= 0 || opt->producers > MAX_PRODUCERS ||
+        opt->element_size < sizeof(element_header_t) ||
+        opt->element_size > MAX_ELEMENT_SIZE ||
+        opt->capacity < (size_t)opt->producers ||
+        opt->batch == 0 || opt->batch > MAX_BATCH) {
+        fprintf(stderr, "Invalid options\n");
+        print_usage(argv[0]);
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bench_options_t opt = {
+        .items = 1000000,
+        .producers = 4,
+        .element_size = 32,
+        .capacity = 1024,
+        .batch = 32,
+        .pairs = 10000000,
+    };
+    parse_options(argc, argv, &opt);
+    logger_set_level(LOG_LEVEL_WARN);
+
+    FILE *out = stdout;
+    if (opt.output && !(out = fopen(opt.output, "w"))) {
+        fprintf(stderr, "Cannot open %s\n", opt.output);
+        return 1;
+    }
+
+    static const scenario_t transfers[] = {
+        {"spsc_mutex",    QUEUE_MUTEX, false, false, false},
+        {"spsc",          QUEUE_SPSC,  false, false, false},
+        {"spsc_batch",    QUEUE_SPSC,  true,  false, false},
+        {"spsc_blocking", QUEUE_SPSC,  false, true,  false},
+        {"mpsc_mutex",    QUEUE_MUTEX, false, false, true},
+        {"mpsc",          QUEUE_MPSC,  false, false, true},
+        {"mpsc_batch",    QUEUE_MPSC,  true,  false, true},
+        {"mpsc_blocking", QUEUE_MPSC,  false, true,  true},
+    };
+    int n = (int)(sizeof(transfers) / sizeof(transfers[0]));
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"ring\",\n");
+    fprintf(out,
+            "  \"config\": {\"items\": %ld, \"producers\": %d, \"element_size\": %zu, "
+            "\"capacity\": %zu, \"batch\": %zu, \"pairs\": %ld},\n",
+            opt.items, opt.producers, opt.element_size, opt.capacity, opt.batch, opt.pairs);
+
+    bench_uncontended(out, &opt);
+
+    uint64_t errors = 0;
+    fprintf(out, "  \"transfer\": {\n");
+    for (int i = 0; i < n; i++) {
+        errors += bench_transfer(out, &opt, &transfers[i], i + 1 == n);
+        fflush(out);
+    }
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    if (errors > 0) {
+        fprintf(stderr, "%llu elements out of order or lost\n", (unsigned long long)errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,240 @@
+/*
+ * Water Treatment Controller - Simulator Fleet Benchmark
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Measures how fast the simulator's fleet scenario (N RTUs x M sensors,
+ * 256 x 32 = 8k points by default) can be updated into a registry:
+ *
+ *   - registry: the same points written with one rtu_registry_update_sensor
+ *     call each versus one rtu_registry_update_sensors call per RTU
+ *   - fleet: full simulator updates (waveforms + registry) on the calling
+ *     thread and with 1, 2, 4 ... worker threads
+ *
+ * Updates are stepped with simulator_advance(), so the run does not
+ * depend on the wall clock. Results are written as one JSON object.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/registry/rtu_registry.h"
+#include "../src/simulation/simulator.h"
+#include "../src/utils/logger.h"
+#include "../src/utils/time_utils.h"
+
+#define MAX_SENSORS             32
+#define MAX_THREADS             64
+
+typedef struct {
+    int rtus;
+    int sensors;
+    int max_threads;
+    int updates;
+    const char *output;
+} bench_options_t;
+
+static double rate(double amount, uint64_t us) {
+    return us > 0 ? amount * 1e6 / (double)us : 0.0;
+}
+
+static rtu_registry_t *create_registry(int rtus) {
+    rtu_registry_t *registry = NULL;
+    registry_config_t config = {0};
+    config.max_devices = rtus;
+
+    if (rtu_registry_init(&registry, &config) != WTC_OK) {
+        fprintf(stderr, "Cannot create registry\n");
+        exit(1);
+    }
+    return registry;
+}
+
+/* ============== Scenarios ============== */
+
+/* Per-sensor calls against one bulk call per RTU, same points */
+static void bench_registry(FILE *out, const bench_options_t *opt) {
+    rtu_registry_t *registry = create_registry(opt->rtus);
+    char name[64];
+
+    for (int i = 0; i < opt->rtus; i++) {
+        snprintf(name, sizeof(name), "bench-rtu-%04d", i + 1);
+        rtu_registry_add_device(registry, name, "10.0.0.1", NULL, 0);
+    }
+
+    int slots[MAX_SENSORS];
+    float values[MAX_SENSORS];
+    data_quality_t quality[MAX_SENSORS];
+    for (int j = 0; j < opt->sensors; j++) {
+        slots[j] = j + 1;
+        values[j] = (float)j;
+        quality[j] = QUALITY_GOOD;
+    }
+
+    double points = (double)opt->rtus * opt->sensors * opt->updates;
+
+    uint64_t start = time_get_monotonic_us();
+    for (int u = 0; u < opt->updates; u++) {
+        for (int i = 0; i < opt->rtus; i++) {
+            snprintf(name, sizeof(name), "bench-rtu-%04d", i + 1);
+            for (int j = 0; j < opt->sensors; j++) {
+                rtu_registry_update_sensor(registry, name, slots[j], values[j],
+                                           IOPS_GOOD, QUALITY_GOOD);
+            }
+        }
+    }
+    uint64_t single_us = time_get_monotonic_us() - start;
+
+    start = time_get_monotonic_us();
+    for (int u = 0; u < opt->updates; u++) {
+        for (int i = 0; i < opt->rtus; i++) {
+            snprintf(name, sizeof(name), "bench-rtu-%04d", i + 1);
+            rtu_registry_update_sensors(registry, name, slots, values, quality,
+                                        opt->sensors, IOPS_GOOD);
+        }
+    }
+    uint64_t bulk_us = time_get_monotonic_us() - start;
+
+    fprintf(out, "  \"registry\": {\n");
+    fprintf(out, "    \"per_sensor\": {\"points_per_sec\": %.0f, \"ns_per_point\": %.1f},\n",
+            rate(points, single_us), points > 0 ? single_us * 1000.0 / points : 0.0);
+    fprintf(out, "    \"bulk\": {\"points_per_sec\": %.0f, \"ns_per_point\": %.1f}\n",
+            rate(points, bulk_us), points > 0 ? bulk_us * 1000.0 / points : 0.0);
+    fprintf(out, "  },\n");
+
+    rtu_registry_cleanup(registry);
+}
+
+/* Full fleet updates with the given number of workers (0 = caller) */
+static void bench_fleet(FILE *out, const bench_options_t *opt, int threads, bool last) {
+    rtu_registry_t *registry = create_registry(opt->rtus);
+
+    simulator_config_t config = {
+        .scenario = SIM_SCENARIO_FLEET,
+        .update_rate_hz = 1.0f,
+        .time_scale = 1.0f,
+        .fleet = {
+            .rtu_count = opt->rtus,
+            .sensors_per_rtu = opt->sensors,
+        },
+        .worker_threads = threads,
+    };
+
+    simulator_t *sim = NULL;
+    if (simulator_init(&sim, &config) != WTC_OK) {
+        fprintf(stderr, "Cannot create simulator\n");
+        exit(1);
+    }
+    simulator_set_registry(sim, registry);
+    simulator_start(sim);
+
+    /* Warm-up: first touch of every registry slot */
+    simulator_advance(sim, 1.0);
+
+    uint64_t start = time_get_monotonic_us();
+    for (int u = 0; u < opt->updates; u++) {
+        simulator_advance(sim, 1.0);
+    }
+    uint64_t us = time_get_monotonic_us() - start;
+
+    double points = (double)opt->rtus * opt->sensors * opt->updates;
+    fprintf(out,
+            "    \"threads_%d\": {\"updates_per_sec\": %.1f, \"points_per_sec\": %.0f, "
+            "\"ms_per_update\": %.3f}%s\n",
+            threads, rate(opt->updates, us), rate(points, us),
+            opt->updates > 0 ? us / 1000.0 / opt->updates : 0.0, last ? "" : ",");
+
+    simulator_cleanup(sim);
+    rtu_registry_cleanup(registry);
+}
+
+/* ============== Main ============== */
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("\nOptions:\n");
+    printf("  -r, --rtus N         RTUs in the fleet (default: 256)\n");
+    printf("  -s, --sensors N      Sensors per RTU, at most %d (default: 32)\n", MAX_SENSORS);
+    printf("  -t, --threads N      Largest worker count tried (default: 4)\n");
+    printf("  -u, --updates N      Updates per measurement (default: 200)\n");
+    printf("  -o, --output FILE    Write JSON results to FILE (default: stdout)\n");
+    printf("  -h, --help           Show this help\n");
+}
+
+static void parse_options(int argc, char *argv[], bench_options_t *opt) {
+    static struct option long_options[] = {
+        {"rtus",       required_argument, 0, 'r'},
+        {"sensors",    required_argument, 0, 's'},
+        {"threads",    required_argument, 0, 't'},
+        {"updates",    required_argument, 0, 'u'},
+        {"output",     required_argument, 0, 'o'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "r:s:t:u:o:h", long_options, NULL)) != -1) {
+        switch (c) {
+        case 'r': opt->rtus = atoi(optarg); break;
+        case 's': opt->sensors = atoi(optarg); break;
+        case 't': opt->max_threads = atoi(optarg); break;
+        case 'u': opt->updates = atoi(optarg); break;
+        case 'o': opt->output = optarg; break;
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            exit(c == 'h' ? 0 : 1);
+        }
+    }
+
+    if (opt->rtus <= 0 || opt->rtus > SIM_MAX_FLEET_RTUS ||
+        opt->sensors <= 0 || opt->sensors > MAX_SENSORS ||
+        opt->max_threads < 0 || opt->max_threads > MAX_THREADS ||
+        opt->updates <= 0) {
+        fprintf(stderr, "Invalid options\n");
+        print_usage(argv[0]);
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bench_options_t opt = {
+        .rtus = 256,
+        .sensors = 32,
+        .max_threads = 4,
+        .updates = 200,
+    };
+    parse_options(argc, argv, &opt);
+    logger_set_level(LOG_LEVEL_WARN);
+
+    FILE *out = stdout;
+    if (opt.output && !(out = fopen(opt.output, "w"))) {
+        fprintf(stderr, "Cannot open %s\n", opt.output);
+        return 1;
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"simulator\",\n");
+    fprintf(out,
+            "  \"config\": {\"rtus\": %d, \"sensors\": %d, \"points\": %d, \"updates\": %d},\n",
+            opt.rtus, opt.sensors, opt.rtus * opt.sensors, opt.updates);
+
+    bench_registry(out, &opt);
+    fflush(out);
+
+    fprintf(out, "  \"fleet\": {\n");
+    bench_fleet(out, &opt, 0, opt.max_threads == 0);
+    for (int threads = 1; threads <= opt.max_threads; threads *= 2) {
+        fflush(out);
+        bench_fleet(out, &opt, threads, threads * 2 > opt.max_threads);
+    }
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
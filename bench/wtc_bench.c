@@ -0,0 +1,471 @@
+/*
+ * Water Treatment Controller - Hot Path Micro-benchmarks
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Times the per-call cost of the controller's hot paths with the harness
+ * in bench_harness.h:
+ *
+ *   registry      rtu_registry_get_sensor on 1, 2, 4 ... threads reading
+ *                 the same RTU, and rtu_registry_update_sensor
+ *   alarms        alarm_manager_process with WTC_MAX_ALARM_RULES rules
+ *   control       control_engine_process with WTC_MAX_PID_LOOPS loops; the
+ *                 PID calculation itself is internal to the engine, so it
+ *                 is measured as the cost per loop of a scan
+ *   compression   compression_should_store per sample, per algorithm
+ *   codecs        crc32 per byte and parsing of a cyclic RT frame
+ *
+ * Results are written as one JSON object. With --baseline, the medians
+ * are compared with a previous results file and the exit status is 2 if
+ * any result is more than --threshold percent slower.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_harness.h"
+#include "../src/alarms/alarm_manager.h"
+#include "../src/control/control_engine.h"
+#include "../src/historian/compression.h"
+#include "../src/profinet/profinet_frame.h"
+#include "../src/registry/rtu_registry.h"
+#include "../src/utils/crc.h"
+#include "../src/utils/logger.h"
+
+#define MAX_CASES               32
+#define RTU_SENSORS             32
+#define ALARM_RTUS              (WTC_MAX_ALARM_RULES / RTU_SENSORS)
+#define CONTROL_OUTPUT_BASE     100
+#define COMPRESSION_SAMPLES     4096
+#define CRC_BLOCK_SIZE          1500
+#define RT_PAYLOAD_SIZE         40
+
+typedef struct {
+    int warmup;
+    int repetitions;
+    int max_threads;
+    const char *filter;
+    const char *baseline;
+    double threshold_pct;
+    const char *output;
+} bench_options_t;
+
+/* ============== Registry ============== */
+
+static rtu_registry_t *create_registry(int rtus) {
+    rtu_registry_t *registry = NULL;
+    registry_config_t config = {0};
+    config.max_devices = rtus;
+
+    if (rtu_registry_init(&registry, &config) != WTC_OK) {
+        fprintf(stderr, "Cannot create registry\n");
+        exit(1);
+    }
+
+    char name[WTC_MAX_STATION_NAME];
+    for (int i = 0; i < rtus; i++) {
+        snprintf(name, sizeof(name), "bench-rtu-%04d", i + 1);
+        rtu_registry_add_device(registry, name, "10.0.0.1", NULL, 0);
+        for (int slot = 1; slot <= RTU_SENSORS * 2; slot++) {
+            rtu_registry_update_sensor(registry, name, slot, 50.0f, IOPS_GOOD, QUALITY_GOOD);
+        }
+    }
+    return registry;
+}
+
+static void body_registry_get(void *ctx, int thread, long ops) {
+    rtu_registry_t *registry = ctx;
+    sensor_data_t data;
+    uint64_t sum = 0;
+
+    for (long i = 0; i < ops; i++) {
+        int slot = (int)((i + thread) % RTU_SENSORS) + 1;
+        if (rtu_registry_get_sensor(registry, "bench-rtu-0001", slot, &data) == WTC_OK) {
+            sum += data.status;
+        }
+    }
+    bench_consume(sum);
+}
+
+static void body_registry_update(void *ctx, int thread, long ops) {
+    rtu_registry_t *registry = ctx;
+    (void)thread;
+
+    for (long i = 0; i < ops; i++) {
+        int slot = (int)(i % RTU_SENSORS) + 1;
+        rtu_registry_update_sensor(registry, "bench-rtu-0001", slot, (float)i,
+                                   IOPS_GOOD, QUALITY_GOOD);
+    }
+}
+
+/* ============== Alarms ============== */
+
+static alarm_manager_t *create_alarm_manager(rtu_registry_t *registry) {
+    alarm_manager_t *manager = NULL;
+    alarm_manager_config_t config = {0};
+    config.max_active_alarms = 100;
+    config.max_history_entries = 1000;
+
+    if (alarm_manager_init(&manager, &config) != WTC_OK) {
+        fprintf(stderr, "Cannot create alarm manager\n");
+        exit(1);
+    }
+    alarm_manager_set_registry(manager, registry);
+
+    /* One rule per sensor; none trips, so every pass is a full evaluation */
+    char name[WTC_MAX_STATION_NAME];
+    for (int i = 0; i < WTC_MAX_ALARM_RULES; i++) {
+        int rule_id;
+        snprintf(name, sizeof(name), "bench-rtu-%04d", i / RTU_SENSORS + 1);
+        if (alarm_manager_create_rule(manager, name, i % RTU_SENSORS + 1,
+                                      i % 2 ? ALARM_CONDITION_HIGH : ALARM_CONDITION_LOW,
+                                      i % 2 ? 1000.0f : -1000.0f, ALARM_SEVERITY_MEDIUM,
+                                      0, "bench", &rule_id) != WTC_OK) {
+            fprintf(stderr, "Cannot create alarm rule %d\n", i);
+            exit(1);
+        }
+    }
+    return manager;
+}
+
+static void body_alarm_process(void *ctx, int thread, long ops) {
+    alarm_manager_t *manager = ctx;
+    (void)thread;
+
+    for (long i = 0; i < ops; i++) {
+        alarm_manager_process(manager);
+    }
+}
+
+/* ============== Control ============== */
+
+static control_engine_t *create_control_engine(rtu_registry_t *registry) {
+    control_engine_t *engine = NULL;
+    control_engine_config_t config = {
+        .scan_rate_ms = 100,
+    };
+
+    if (control_engine_init(&engine, &config) != WTC_OK) {
+        fprintf(stderr, "Cannot create control engine\n");
+        exit(1);
+    }
+    control_engine_set_registry(engine, registry);
+
+    /* Loops settle inside their output range, clear of the watchdog */
+    for (int i = 0; i < WTC_MAX_PID_LOOPS; i++) {
+        pid_loop_t loop = {0};
+        snprintf(loop.name, sizeof(loop.name), "bench-%d", i);
+        loop.enabled = true;
+        loop.mode = PID_MODE_AUTO;
+        loop.kp = 1.0f;
+        loop.setpoint = 55.0f;
+        loop.output_max = 100.0f;
+        snprintf(loop.input_rtu, sizeof(loop.input_rtu), "bench-rtu-0001");
+        loop.input_slot = i + 1;
+        snprintf(loop.output_rtu, sizeof(loop.output_rtu), "bench-rtu-0001");
+        loop.output_slot = CONTROL_OUTPUT_BASE + i;
+
+        int loop_id;
+        if (control_engine_add_pid_loop(engine, &loop, &loop_id) != WTC_OK) {
+            fprintf(stderr, "Cannot add PID loop %d\n", i);
+            exit(1);
+        }
+    }
+    return engine;
+}
+
+static void body_control_scan(void *ctx, int thread, long ops) {
+    control_engine_t *engine = ctx;
+    (void)thread;
+
+    for (long i = 0; i < ops; i++) {
+        control_engine_process(engine);
+    }
+}
+
+/* ============== Compression ============== */
+
+typedef struct {
+    compression_t algorithm;
+    float values[COMPRESSION_SAMPLES];
+    compression_state_t state;
+    uint64_t timestamp_ms;
+} compression_ctx_t;
+
+/* Slow sine with measurement noise, as from a level transmitter */
+static void init_compression(compression_ctx_t *c, compression_t algorithm) {
+    memset(c, 0, sizeof(*c));
+    c->algorithm = algorithm;
+    srand(1);
+    for (int i = 0; i < COMPRESSION_SAMPLES; i++) {
+        float noise = ((float)rand() / (float)RAND_MAX - 0.5f) * 0.2f;
+        c->values[i] = 50.0f + 10.0f * sinf((float)i * 0.01f) + noise;
+    }
+    compression_init(&c->state, algorithm, 0.5f);
+}
+
+static void body_compression(void *ctx, int thread, long ops) {
+    compression_ctx_t *c = ctx;
+    uint64_t stored = 0;
+    (void)thread;
+
+    for (long i = 0; i < ops; i++) {
+        c->timestamp_ms += 1000;
+        stored += compression_should_store(&c->state, c->values[i % COMPRESSION_SAMPLES],
+                                           c->timestamp_ms);
+    }
+    bench_consume(stored);
+}
+
+/* ============== Codecs ============== */
+
+typedef struct {
+    uint8_t block[CRC_BLOCK_SIZE];
+    uint8_t frame[ETH_MIN_FRAME_LEN + RT_PAYLOAD_SIZE];
+    size_t frame_len;
+} codec_ctx_t;
+
+/* A block of bytes for crc32 and a cyclic input frame:
+ * Ethernet header, frame ID, IO data, cycle counter and status bytes */
+static void init_codecs(codec_ctx_t *c) {
+    static const uint8_t dst[ETH_ADDR_LEN] = {0x00, 0x1b, 0x1b, 0x00, 0x00, 0x01};
+    static const uint8_t src[ETH_ADDR_LEN] = {0x00, 0x1b, 0x1b, 0x00, 0x00, 0x02};
+
+    for (int i = 0; i < CRC_BLOCK_SIZE; i++) {
+        c->block[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    frame_builder_t builder;
+    uint8_t payload[RT_PAYLOAD_SIZE] = {0};
+    uint8_t trailer[4] = {0x00, 0x01, PROFINET_DATA_STATUS_VALID | PROFINET_DATA_STATUS_RUN, 0x00};
+
+    frame_builder_init(&builder, c->frame, sizeof(c->frame), src);
+    frame_build_ethernet(&builder, dst, PROFINET_ETHERTYPE);
+    frame_build_rt_header(&builder, PROFINET_FRAME_ID_RT_CLASS1);
+    frame_append_data(&builder, payload, sizeof(payload));
+    frame_append_data(&builder, trailer, sizeof(trailer));
+    frame_append_padding(&builder, ETH_MIN_FRAME_LEN);
+    c->frame_len = frame_builder_length(&builder);
+}
+
+static void body_crc32(void *ctx, int thread, long ops) {
+    codec_ctx_t *c = ctx;
+    uint64_t sum = 0;
+    (void)thread;
+
+    for (long i = 0; i < ops; i++) {
+        sum += crc32(c->block, sizeof(c->block));
+    }
+    bench_consume(sum);
+}
+
+static void body_frame_parse(void *ctx, int thread, long ops) {
+    codec_ctx_t *c = ctx;
+    uint8_t dst[ETH_ADDR_LEN], src[ETH_ADDR_LEN];
+    uint8_t payload[RT_PAYLOAD_SIZE];
+    uint64_t sum = 0;
+    (void)thread;
+
+    for (long i = 0; i < ops; i++) {
+        frame_parser_t parser;
+        uint16_t ethertype, frame_id, cycle_counter;
+        uint8_t data_status;
+
+        frame_parser_init(&parser, c->frame, c->frame_len);
+        if (frame_parse_ethernet(&parser, dst, src, &ethertype) != WTC_OK ||
+            frame_parse_rt_header(&parser, &frame_id) != WTC_OK ||
+            frame_read_bytes(&parser, payload, sizeof(payload)) != WTC_OK ||
+            frame_read_u16(&parser, &cycle_counter) != WTC_OK ||
+            frame_read_u8(&parser, &data_status) != WTC_OK) {
+            continue;
+        }
+        sum += frame_id + cycle_counter + data_status + payload[0];
+    }
+    bench_consume(sum);
+}
+
+/* ============== Main ============== */
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("\nOptions:\n");
+    printf("  -w, --warmup N         Untimed repetitions per case (default: 3)\n");
+    printf("  -r, --repetitions N    Timed repetitions per case and thread (default: 30)\n");
+    printf("  -t, --threads N        Largest contending thread count (default: 4)\n");
+    printf("  -f, --filter TEXT      Only run cases whose name contains TEXT\n");
+    printf("  -b, --baseline FILE    Compare with the results in FILE\n");
+    printf("  -T, --threshold PCT    Slowdown of the median counted as a regression\n");
+    printf("                         (default: 10)\n");
+    printf("  -o, --output FILE      Write JSON results to FILE (default: stdout)\n");
+    printf("  -h, --help             Show this help\n");
+    printf("\nExit status is 2 if any result regressed against the baseline.\n");
+}
+
+static void parse_options(int argc, char *argv[], bench_options_t *opt) {
+    static struct option long_options[] = {
+        {"warmup",      required_argument, 0, 'w'},
+        {"repetitions", required_argument, 0, 'r'},
+        {"threads",     required_argument, 0, 't'},
+        {"filter",      required_argument, 0, 'f'},
+        {"baseline",    required_argument, 0, 'b'},
+        {"threshold",   required_argument, 0, 'T'},
+        {"output",      required_argument, 0, 'o'},
+        {"help",        no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "w:r:t:f:b:T:o:h", long_options, NULL)) != -1) {
+        switch (c) {
+        case 'w': opt->warmup = atoi(optarg); break;
+        case 'r': opt->repetitions = atoi(optarg); break;
+        case 't': opt->max_threads = atoi(optarg); break;
+        case 'f': opt->filter = optarg; break;
+        case 'b': opt->baseline = optarg; break;
+        case 'T': opt->threshold_pct = atof(optarg); break;
+        case 'o': opt->output = optarg; break;
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            exit(c == 'h' ? 0 : 1);
+        }
+    }
+
+    if (opt->warmup < 0 || opt->repetitions <= 0 ||
+        opt->max_threads <= 0 || opt->max_threads > BENCH_MAX_THREADS ||
+        opt->threshold_pct < 0.0) {
+        fprintf(stderr, "Invalid options\n");
+        print_usage(argv[0]);
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bench_options_t opt = {
+        .warmup = 3,
+        .repetitions = 30,
+        .max_threads = 4,
+        .threshold_pct = 10.0,
+    };
+    parse_options(argc, argv, &opt);
+    logger_set_level(LOG_LEVEL_WARN);
+
+    bench_baseline_t *baseline = NULL;
+    int baseline_count = 0;
+    if (opt.baseline) {
+        baseline = calloc(MAX_CASES, sizeof(bench_baseline_t));
+        if (!baseline ||
+            (baseline_count = bench_load_baseline(opt.baseline, baseline, MAX_CASES)) < 0) {
+            fprintf(stderr, "Cannot read baseline %s\n", opt.baseline);
+            return 1;
+        }
+    }
+
+    FILE *out = stdout;
+    if (opt.output && !(out = fopen(opt.output, "w"))) {
+        fprintf(stderr, "Cannot open %s\n", opt.output);
+        return 1;
+    }
+
+    /* Fixtures; the alarm and control registries are private so that
+     * their writes do not disturb the registry cases */
+    rtu_registry_t *registry = create_registry(1);
+    rtu_registry_t *alarm_registry = create_registry(ALARM_RTUS);
+    rtu_registry_t *control_registry = create_registry(1);
+    alarm_manager_t *alarms = create_alarm_manager(alarm_registry);
+    control_engine_t *engine = create_control_engine(control_registry);
+
+    static compression_ctx_t swinging_door, deadband, boxcar;
+    static codec_ctx_t codecs;
+    init_compression(&swinging_door, COMPRESSION_SWINGING_DOOR);
+    init_compression(&deadband, COMPRESSION_DEADBAND);
+    init_compression(&boxcar, COMPRESSION_BOXCAR);
+    init_codecs(&codecs);
+
+    bench_case_t cases[MAX_CASES];
+    char names[MAX_CASES][BENCH_MAX_NAME];
+    int case_count = 0;
+
+    for (int threads = 1; threads <= opt.max_threads && case_count < MAX_CASES; threads *= 2) {
+        int n = case_count++;
+        snprintf(names[n], BENCH_MAX_NAME, "registry_get_sensor/threads_%d", threads);
+        cases[n] = (bench_case_t){
+            .name = names[n], .threads = threads, .ops = 20000,
+            .body = body_registry_get, .ctx = registry,
+        };
+    }
+
+    const bench_case_t fixed[] = {
+        {.name = "registry_update_sensor", .ops = 20000,
+         .body = body_registry_update, .ctx = registry},
+        {.name = "alarm_manager_process/rules_512", .ops = 20,
+         .items_per_op = WTC_MAX_ALARM_RULES, .item = "rule",
+         .body = body_alarm_process, .ctx = alarms},
+        {.name = "control_engine_process/loops_64", .ops = 50,
+         .items_per_op = WTC_MAX_PID_LOOPS, .item = "loop",
+         .body = body_control_scan, .ctx = engine},
+        {.name = "compression_should_store/swinging_door", .ops = COMPRESSION_SAMPLES,
+         .body = body_compression, .ctx = &swinging_door},
+        {.name = "compression_should_store/deadband", .ops = COMPRESSION_SAMPLES,
+         .body = body_compression, .ctx = &deadband},
+        {.name = "compression_should_store/boxcar", .ops = COMPRESSION_SAMPLES,
+         .body = body_compression, .ctx = &boxcar},
+        {.name = "crc32/bytes_1500", .ops = 200,
+         .items_per_op = CRC_BLOCK_SIZE, .item = "byte",
+         .body = body_crc32, .ctx = &codecs},
+        {.name = "frame_parse/rt_cyclic", .ops = 20000,
+         .items_per_op = (double)ETH_HEADER_LEN + 2 + RT_PAYLOAD_SIZE + 3, .item = "byte",
+         .body = body_frame_parse, .ctx = &codecs},
+    };
+    for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]) && case_count < MAX_CASES; i++) {
+        cases[case_count++] = fixed[i];
+    }
+
+    bench_params_t params = {
+        .warmup = opt.warmup,
+        .repetitions = opt.repetitions,
+    };
+    bench_result_t results[MAX_CASES];
+    int result_count = 0;
+
+    for (int i = 0; i < case_count; i++) {
+        if (opt.filter && !strstr(cases[i].name, opt.filter)) {
+            continue;
+        }
+        if (!bench_run(&cases[i], &params, &results[result_count])) {
+            fprintf(stderr, "Cannot run %s\n", cases[i].name);
+            return 1;
+        }
+        result_count++;
+    }
+
+    int regressions = 0;
+    if (baseline) {
+        regressions = bench_compare(results, result_count, baseline, baseline_count,
+                                    opt.threshold_pct);
+        for (int i = 0; i < result_count; i++) {
+            if (results[i].has_baseline) {
+                fprintf(stderr, "%-42s %10.1f ns -> %10.1f ns  %+6.1f%%%s\n",
+                        results[i].name, results[i].baseline_p50_ns, results[i].p50_ns,
+                        results[i].change_pct, results[i].regression ? "  REGRESSION" : "");
+            }
+        }
+    }
+
+    bench_write_json(out, &params, results, result_count);
+
+    control_engine_cleanup(engine);
+    alarm_manager_cleanup(alarms);
+    rtu_registry_cleanup(control_registry);
+    rtu_registry_cleanup(alarm_registry);
+    rtu_registry_cleanup(registry);
+    free(baseline);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return regressions > 0 ? 2 : 0;
+}
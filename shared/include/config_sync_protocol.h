@@ -13,6 +13,12 @@
  *   0xF843 - Actuator configuration
  *   0xF844 - RTU status (RTU → Controller, read-only)
  *   0xF845 - Enrollment/binding
+ *   0xF846 - Config version/hashes (RTU → Controller, read-only)
+ *   0xF847 - User sync state (see user_sync_protocol.h)
+ *
+ * Incremental sync: before writing, the controller reads 0xF846 and
+ * skips every section whose hash matches what the RTU last applied.
+ * RTUs that do not implement 0xF846 get every section, as before.
  *
  * Wire Format: All multi-byte values are big-endian (network byte order)
  * Checksum: CRC16-CCITT (polynomial 0x1021, init 0xFFFF)
@@ -38,6 +44,7 @@ extern "C" {
 #define CONFIG_SYNC_ACTUATOR_INDEX      0xF843
 #define CONFIG_SYNC_STATUS_INDEX        0xF844
 #define CONFIG_SYNC_ENROLLMENT_INDEX    0xF845
+#define CONFIG_SYNC_VERSION_INDEX       0xF846
 
 /* Maximum counts */
 #define CONFIG_SYNC_MAX_SENSORS         16
@@ -87,6 +94,24 @@ static inline uint16_t crc16_ccitt(const uint8_t *data, size_t len) {
 
 #endif /* CRC16_CCITT_DEFINED */
 
+/* ============== Section Hash ============== */
+
+/*
+ * Content hash of a config section (FNV-1a 32-bit over the payload as
+ * written). The RTU stores the hash of each section it applies and
+ * reports it in the version record. For the device section the
+ * config_timestamp and crc16 fields are zeroed before hashing so an unchanged
+ * config hashes the same on every sync.
+ */
+static inline uint32_t config_sync_hash(const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
 /* ============== Device Configuration (0xF841) ============== */
 
 /*
@@ -205,6 +230,27 @@ typedef struct __attribute__((packed)) {
     uint8_t reserved[12];                         /* Reserved for future use */
 } rtu_status_payload_t;
 
+/* ============== Config Version (0xF846) - Read by Controller ============== */
+
+/*
+ * Hashes of the config sections the RTU has applied (0 = none).
+ *
+ * Wire format (24 bytes):
+ *   version:u8 flags:u8 crc16:u16
+ *   device_hash:u32 sensor_hash:u32 actuator_hash:u32
+ *   config_timestamp:u32 reserved:u32
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;                              /* Protocol version (1) */
+    uint8_t flags;                                /* Reserved, 0 */
+    uint16_t crc16;                               /* CRC16 of payload (after this field) */
+    uint32_t device_hash;                         /* Hash of applied 0xF841 payload */
+    uint32_t sensor_hash;                         /* Hash of applied 0xF842 payload */
+    uint32_t actuator_hash;                       /* Hash of applied 0xF843 payload */
+    uint32_t config_timestamp;                    /* Applied config timestamp */
+    uint32_t reserved;
+} config_version_payload_t;
+
 /* ============== Enrollment (0xF845) ============== */
 
 /*
@@ -265,6 +311,30 @@ static inline void device_config_set_crc(device_config_payload_t *payload) {
     );
 }
 
+/*
+ * Validate config version payload.
+ */
+static inline bool config_version_validate(const config_version_payload_t *payload) {
+    if (payload->version != CONFIG_SYNC_PROTOCOL_VERSION) {
+        return false;
+    }
+    uint16_t expected_crc = crc16_ccitt(
+        (const uint8_t *)payload + 4,
+        sizeof(config_version_payload_t) - 4
+    );
+    return payload->crc16 == expected_crc;
+}
+
+/*
+ * Calculate and set CRC for config version payload (RTU side).
+ */
+static inline void config_version_set_crc(config_version_payload_t *payload) {
+    payload->crc16 = crc16_ccitt(
+        (const uint8_t *)payload + 4,
+        sizeof(config_version_payload_t) - 4
+    );
+}
+
 /*
  * Validate enrollment payload.
  */
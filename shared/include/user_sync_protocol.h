@@ -10,6 +10,21 @@
  * - RTU receives, validates magic/CRC, stores users in non-volatile memory
  * - RTU uses stored credentials for local TUI/HMI authentication
  *
+ * REVISIONS:
+ * - The controller numbers every user change with a store revision and
+ *   carries the revision a payload brings the RTU to in header.nonce,
+ *   together with a per-boot epoch (USER_SYNC_NONCE)
+ * - The RTU keeps the nonce of the last sync applied and reports it in
+ *   user_sync_state_t (record 0xF847, read-only)
+ * - The controller then sends only users changed after that revision
+ *   (USER_SYNC_OP_ADD_UPDATE / USER_SYNC_OP_DELETE); FULL_SYNC is used
+ *   when the RTU's revision is unknown, too old or from another epoch
+ * - A delta larger than one payload is split over several writes; only
+ *   the last carries the new nonce, the others repeat the RTU's own
+ * - Deltas are idempotent: the RTU accepts a nonce equal to its applied
+ *   one and rejects older ones of the same epoch as replays; a FULL_SYNC
+ *   from another epoch replaces the store whatever its nonce
+ *
  * HASH FORMAT:
  * - Algorithm: DJB2 (hash = 5381, hash = ((hash << 5) + hash) + c)
  * - Salt: "NaCl4Life" prepended to password before hashing
@@ -48,6 +63,17 @@ extern "C" {
 /** PROFINET record index for user sync (vendor-specific range 0xF000-0xFFFF) */
 #define USER_SYNC_RECORD_INDEX      0xF840
 
+/** PROFINET record index for the RTU's applied revision (read-only) */
+#define USER_SYNC_STATE_INDEX       0xF847
+
+/** Nonce layout: controller boot epoch (high 16 bits), store revision
+ *  (low 16 bits). Revisions restart under a new epoch when they wrap. */
+#define USER_SYNC_NONCE(epoch, revision) \
+    (((uint32_t)(epoch) << 16) | ((uint32_t)(revision) & 0xFFFFu))
+#define USER_SYNC_NONCE_EPOCH(nonce)     ((uint16_t)((nonce) >> 16))
+#define USER_SYNC_NONCE_REVISION(nonce)  ((uint16_t)((nonce) & 0xFFFFu))
+#define USER_SYNC_REVISION_MAX      0xFFFFu
+
 /** Maximum users per sync payload (RTU storage constraint) */
 #define USER_SYNC_MAX_USERS         16
 
@@ -158,7 +184,9 @@ typedef struct __attribute__((packed)) {
     /** Unix timestamp when sync was initiated (seconds since epoch) */
     uint32_t timestamp;
 
-    /** Random nonce for replay detection (RTU tracks last seen) */
+    /** Epoch and store revision this payload brings the RTU to
+     *  (USER_SYNC_NONCE); the RTU tracks the last applied for replay
+     *  detection */
     uint32_t nonce;
 
     /** CRC16-CCITT of user records (calculated over user data only) */
@@ -179,6 +207,28 @@ typedef struct __attribute__((packed)) {
     user_sync_record_t users[USER_SYNC_MAX_USERS];
 } user_sync_payload_t;
 
+/**
+ * @brief RTU sync state, read from USER_SYNC_STATE_INDEX
+ *
+ * Total size: 12 bytes
+ */
+typedef struct __attribute__((packed)) {
+    /** Magic number (USER_SYNC_MAGIC) */
+    uint32_t magic;
+
+    /** Protocol version (USER_SYNC_PROTOCOL_VERSION) */
+    uint8_t version;
+
+    /** Number of users stored on the RTU */
+    uint8_t user_count;
+
+    /** CRC16-CCITT of nonce */
+    uint16_t checksum;
+
+    /** Nonce (header.nonce) of the last sync applied */
+    uint32_t nonce;
+} user_sync_state_t;
+
 /* ============== Result Codes ============== */
 
 /**
@@ -382,6 +432,21 @@ static inline user_sync_result_t user_sync_validate_payload(
     return USER_SYNC_OK;
 }
 
+/**
+ * @brief Validate RTU sync state record
+ *
+ * @param state  State read from USER_SYNC_STATE_INDEX
+ * @return       true if magic, version and CRC match
+ */
+static inline bool user_sync_validate_state(const user_sync_state_t *state) {
+    if (!state || state->magic != USER_SYNC_MAGIC ||
+        state->version != USER_SYNC_PROTOCOL_VERSION) {
+        return false;
+    }
+    return state->checksum == user_sync_crc16_ccitt(
+        (const uint8_t *)&state->nonce, sizeof(state->nonce));
+}
+
 /**
  * @brief Initialize payload header with defaults
  *
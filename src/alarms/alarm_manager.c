@@ -436,14 +436,12 @@ wtc_result_t alarm_manager_acknowledge_all(alarm_manager_t *manager,
     return WTC_OK;
 }
 
-wtc_result_t alarm_manager_get_active(alarm_manager_t *manager,
+/* Copy active alarms into an array from the arena, or the heap without one */
+static wtc_result_t copy_active_alarms(alarm_manager_t *manager,
+                                       arena_t *arena,
                                        alarm_t **alarms,
                                        int *count,
                                        int max_count) {
-    if (!manager || !alarms || !count) {
-        return WTC_ERROR_INVALID_PARAM;
-    }
-
     pthread_mutex_lock(&manager->lock);
 
     int copy_count = manager->active_count;
@@ -451,15 +449,44 @@ wtc_result_t alarm_manager_get_active(alarm_manager_t *manager,
         copy_count = max_count;
     }
 
-    for (int i = 0; i < copy_count; i++) {
-        alarms[i] = &manager->active_alarms[i];
+    if (copy_count > 0) {
+        *alarms = arena ? arena_alloc(arena, copy_count * sizeof(alarm_t))
+                        : malloc(copy_count * sizeof(alarm_t));
+        if (!*alarms) {
+            pthread_mutex_unlock(&manager->lock);
+            return WTC_ERROR_NO_MEMORY;
+        }
+        memcpy(*alarms, manager->active_alarms, copy_count * sizeof(alarm_t));
+    } else {
+        *alarms = NULL;
     }
-    *count = copy_count;
 
+    *count = copy_count;
     pthread_mutex_unlock(&manager->lock);
     return WTC_OK;
 }
 
+wtc_result_t alarm_manager_get_active_copy(alarm_manager_t *manager,
+                                       alarm_t **alarms,
+                                       int *count,
+                                       int max_count) {
+    if (!manager || !alarms || !count) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    return copy_active_alarms(manager, NULL, alarms, count, max_count);
+}
+
+wtc_result_t alarm_manager_get_active_arena(alarm_manager_t *manager,
+                                             arena_t *arena,
+                                             alarm_t **alarms,
+                                             int *count,
+                                             int max_count) {
+    if (!manager || !arena || !alarms || !count) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    return copy_active_alarms(manager, arena, alarms, count, max_count);
+}
+
 int alarm_manager_get_active_count(alarm_manager_t *manager) {
     return manager ? manager->active_count : 0;
 }
@@ -1012,3 +1039,58 @@ wtc_result_t alarm_manager_get_history(alarm_manager_t *manager,
     pthread_mutex_unlock(&manager->lock);
     return WTC_OK;
 }
+
+wtc_result_t alarm_manager_restore_alarm(alarm_manager_t *manager,
+                                          const alarm_t *alarm) {
+    if (!manager || !alarm) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&manager->lock);
+
+    alarm_t *slot = NULL;
+    for (int i = 0; i < manager->active_count; i++) {
+        if (manager->active_alarms[i].alarm_id == alarm->alarm_id) {
+            slot = &manager->active_alarms[i];
+            break;
+        }
+    }
+    if (!slot) {
+        if (manager->active_count >= MAX_ACTIVE_ALARMS) {
+            pthread_mutex_unlock(&manager->lock);
+            return WTC_ERROR_FULL;
+        }
+        slot = &manager->active_alarms[manager->active_count++];
+    }
+
+    *slot = *alarm;
+    if (manager->next_alarm_id <= alarm->alarm_id) {
+        manager->next_alarm_id = alarm->alarm_id + 1;
+    }
+
+    pthread_mutex_unlock(&manager->lock);
+    return WTC_OK;
+}
+
+wtc_result_t alarm_manager_remove_alarm(alarm_manager_t *manager,
+                                         int alarm_id) {
+    if (!manager) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&manager->lock);
+
+    for (int i = 0; i < manager->active_count; i++) {
+        if (manager->active_alarms[i].alarm_id == alarm_id) {
+            for (int j = i; j < manager->active_count - 1; j++) {
+                manager->active_alarms[j] = manager->active_alarms[j + 1];
+            }
+            manager->active_count--;
+            pthread_mutex_unlock(&manager->lock);
+            return WTC_OK;
+        }
+    }
+
+    pthread_mutex_unlock(&manager->lock);
+    return WTC_ERROR_NOT_FOUND;
+}
@@ -8,6 +8,7 @@
 #define WTC_ALARM_MANAGER_H
 
 #include "types.h"
+#include "utils/arena.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -97,12 +98,19 @@ wtc_result_t alarm_manager_acknowledge(alarm_manager_t *manager,
 wtc_result_t alarm_manager_acknowledge_all(alarm_manager_t *manager,
                                             const char *user);
 
-/* Get active alarms */
-wtc_result_t alarm_manager_get_active(alarm_manager_t *manager,
+/* Get active alarms (copy - caller must free) */
+wtc_result_t alarm_manager_get_active_copy(alarm_manager_t *manager,
                                        alarm_t **alarms,
                                        int *count,
                                        int max_count);
 
+/* Get active alarms, copied into the arena */
+wtc_result_t alarm_manager_get_active_arena(alarm_manager_t *manager,
+                                             arena_t *arena,
+                                             alarm_t **alarms,
+                                             int *count,
+                                             int max_count);
+
 /* Get active alarm count */
 int alarm_manager_get_active_count(alarm_manager_t *manager);
 
@@ -215,6 +223,17 @@ wtc_result_t alarm_manager_raise_alarm(alarm_manager_t *manager,
 wtc_result_t alarm_manager_clear_alarm(alarm_manager_t *manager,
                                         int alarm_id);
 
+/* ============== Replication ============== */
+
+/* Insert or overwrite an active alarm as replicated from a primary
+ * controller. No callbacks fire and no history is written. */
+wtc_result_t alarm_manager_restore_alarm(alarm_manager_t *manager,
+                                          const alarm_t *alarm);
+
+/* Drop a replicated active alarm without recording it */
+wtc_result_t alarm_manager_remove_alarm(alarm_manager_t *manager,
+                                         int alarm_id);
+
 #ifdef __cplusplus
 }
 #endif
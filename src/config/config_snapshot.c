@@ -0,0 +1,423 @@
+/*
+ * Water Treatment Controller - Binary Configuration Snapshot Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config_snapshot.h"
+#include "crc.h"
+#include "logger.h"
+#include "time_utils.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Sections, in file order */
+enum {
+    SECTION_RTU = 0,
+    SECTION_SLOT,
+    SECTION_ALARM_RULE,
+    SECTION_PID_LOOP,
+    SECTION_INTERLOCK,
+    SECTION_HISTORIAN_TAG,
+    SECTION_COUNT
+};
+
+typedef struct {
+    uint32_t type;
+    uint32_t count;
+    uint32_t record_size;
+    uint32_t offset;            /* From start of file */
+} snapshot_section_t;
+
+/* The CRC covers the section table and every section */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t section_count;
+    uint64_t written_ms;
+    uint64_t size;              /* Whole file */
+    uint32_t checksum;
+    uint32_t reserved;
+    snapshot_section_t sections[SECTION_COUNT];
+} snapshot_header_t;
+
+#define CHECKED_OFFSET offsetof(snapshot_header_t, sections)
+
+struct config_snapshot {
+    uint8_t *data;
+    size_t size;
+    config_snapshot_view_t view;
+};
+
+static const uint32_t record_sizes[SECTION_COUNT] = {
+    [SECTION_RTU] = sizeof(config_snapshot_rtu_t),
+    [SECTION_SLOT] = sizeof(slot_config_t),
+    [SECTION_ALARM_RULE] = sizeof(alarm_rule_t),
+    [SECTION_PID_LOOP] = sizeof(pid_loop_t),
+    [SECTION_INTERLOCK] = sizeof(interlock_t),
+    [SECTION_HISTORIAN_TAG] = sizeof(historian_tag_t),
+};
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static int clamp_count(int count) {
+    return count > 0 ? count : 0;
+}
+
+/* Records keep only what the components are configured from, copied
+ * field by field into zeroed records so that struct padding and bytes
+ * past a string's terminator never reach the file. The same
+ * configuration always encodes to the same bytes. */
+
+static void put_slot(slot_config_t *dst, const slot_config_t *src) {
+    memset(dst, 0, sizeof(*dst));
+    dst->slot = src->slot;
+    dst->subslot = src->subslot;
+    dst->type = src->type;
+    snprintf(dst->name, sizeof(dst->name), "%s", src->name);
+    snprintf(dst->unit, sizeof(dst->unit), "%s", src->unit);
+    dst->measurement_type = src->measurement_type;
+    dst->actuator_type = src->actuator_type;
+    dst->scale_min = src->scale_min;
+    dst->scale_max = src->scale_max;
+    dst->alarm_low = src->alarm_low;
+    dst->alarm_high = src->alarm_high;
+    dst->alarm_low_low = src->alarm_low_low;
+    dst->alarm_high_high = src->alarm_high_high;
+    dst->warning_low = src->warning_low;
+    dst->warning_high = src->warning_high;
+    dst->deadband = src->deadband;
+    dst->enabled = src->enabled;
+}
+
+static void put_alarm_rule(alarm_rule_t *dst, const alarm_rule_t *src) {
+    memset(dst, 0, sizeof(*dst));
+    strncpy(dst->rtu_station, src->rtu_station, sizeof(dst->rtu_station) - 1);
+    dst->slot = src->slot;
+    dst->condition = src->condition;
+    dst->threshold = src->threshold;
+    dst->delay_ms = src->delay_ms;
+    dst->severity = src->severity;
+    strncpy(dst->message_template, src->message_template, sizeof(dst->message_template) - 1);
+}
+
+static void put_pid_loop(pid_loop_t *dst, const pid_loop_t *src) {
+    memset(dst, 0, sizeof(*dst));
+    strncpy(dst->name, src->name, sizeof(dst->name) - 1);
+    dst->enabled = src->enabled;
+    strncpy(dst->input_rtu, src->input_rtu, sizeof(dst->input_rtu) - 1);
+    dst->input_slot = src->input_slot;
+    strncpy(dst->output_rtu, src->output_rtu, sizeof(dst->output_rtu) - 1);
+    dst->output_slot = src->output_slot;
+    dst->kp = src->kp;
+    dst->ki = src->ki;
+    dst->kd = src->kd;
+    dst->setpoint = src->setpoint;
+    dst->output_min = src->output_min;
+    dst->output_max = src->output_max;
+    dst->deadband = src->deadband;
+    dst->integral_limit = src->integral_limit;
+    dst->derivative_filter = src->derivative_filter;
+    dst->mode = src->mode;
+}
+
+static void put_interlock(interlock_t *dst, const interlock_t *src) {
+    memset(dst, 0, sizeof(*dst));
+    strncpy(dst->name, src->name, sizeof(dst->name) - 1);
+    dst->enabled = src->enabled;
+    strncpy(dst->condition_rtu, src->condition_rtu, sizeof(dst->condition_rtu) - 1);
+    dst->condition_slot = src->condition_slot;
+    dst->condition = src->condition;
+    dst->threshold = src->threshold;
+    dst->delay_ms = src->delay_ms;
+    strncpy(dst->action_rtu, src->action_rtu, sizeof(dst->action_rtu) - 1);
+    dst->action_slot = src->action_slot;
+    dst->action = src->action;
+    dst->action_value = src->action_value;
+}
+
+static void put_historian_tag(historian_tag_t *dst, const historian_tag_t *src) {
+    memset(dst, 0, sizeof(*dst));
+    strncpy(dst->rtu_station, src->rtu_station, sizeof(dst->rtu_station) - 1);
+    dst->slot = src->slot;
+    strncpy(dst->tag_name, src->tag_name, sizeof(dst->tag_name) - 1);
+    dst->sample_rate_ms = src->sample_rate_ms;
+    dst->deadband = src->deadband;
+    dst->compression = src->compression;
+}
+
+/* Records are sorted so the components' list order does not move the
+ * checksum: by name where the record has one, then by content. RTUs are
+ * ordered by station name, their slots keep the device's order. */
+
+static int compare_rtu_ptrs(const void *a, const void *b) {
+    const rtu_device_t *ra = *(const rtu_device_t *const *)a;
+    const rtu_device_t *rb = *(const rtu_device_t *const *)b;
+    int cmp = strcmp(ra->station_name, rb->station_name);
+    return cmp ? cmp : strcmp(ra->ip_address, rb->ip_address);
+}
+
+static int compare_alarm_rules(const void *a, const void *b) {
+    return memcmp(a, b, sizeof(alarm_rule_t));
+}
+
+static int compare_pid_loops(const void *a, const void *b) {
+    int cmp = strcmp(((const pid_loop_t *)a)->name, ((const pid_loop_t *)b)->name);
+    return cmp ? cmp : memcmp(a, b, sizeof(pid_loop_t));
+}
+
+static int compare_interlocks(const void *a, const void *b) {
+    int cmp = strcmp(((const interlock_t *)a)->name, ((const interlock_t *)b)->name);
+    return cmp ? cmp : memcmp(a, b, sizeof(interlock_t));
+}
+
+static int compare_historian_tags(const void *a, const void *b) {
+    int cmp = strcmp(((const historian_tag_t *)a)->tag_name,
+                     ((const historian_tag_t *)b)->tag_name);
+    return cmp ? cmp : memcmp(a, b, sizeof(historian_tag_t));
+}
+
+wtc_result_t config_snapshot_encode(const config_snapshot_input_t *input,
+                                    uint8_t **data,
+                                    size_t *size,
+                                    uint32_t *checksum) {
+    if (!input || !data || !size) return WTC_ERROR_INVALID_PARAM;
+
+    uint32_t counts[SECTION_COUNT] = {0};
+    counts[SECTION_RTU] = clamp_count(input->rtu_count);
+    for (int i = 0; i < input->rtu_count; i++) {
+        if (input->rtus[i].slots) {
+            counts[SECTION_SLOT] += clamp_count(input->rtus[i].slot_count);
+        }
+    }
+    counts[SECTION_ALARM_RULE] = clamp_count(input->alarm_rule_count);
+    counts[SECTION_PID_LOOP] = clamp_count(input->pid_loop_count);
+    counts[SECTION_INTERLOCK] = clamp_count(input->interlock_count);
+    counts[SECTION_HISTORIAN_TAG] = clamp_count(input->historian_tag_count);
+
+    /* Lay out the sections */
+    snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CONFIG_SNAPSHOT_MAGIC;
+    header.version = CONFIG_SNAPSHOT_VERSION;
+    header.section_count = SECTION_COUNT;
+    header.written_ms = time_get_ms();
+
+    size_t pos = align8(sizeof(header));
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        header.sections[s].type = (uint32_t)s;
+        header.sections[s].count = counts[s];
+        header.sections[s].record_size = record_sizes[s];
+        header.sections[s].offset = (uint32_t)pos;
+        pos = align8(pos + (size_t)counts[s] * record_sizes[s]);
+    }
+    header.size = pos;
+
+    uint8_t *buf = calloc(1, pos);
+    if (!buf) return WTC_ERROR_NO_MEMORY;
+
+    const rtu_device_t **rtu_order = NULL;
+    if (counts[SECTION_RTU] > 0) {
+        rtu_order = malloc(counts[SECTION_RTU] * sizeof(*rtu_order));
+        if (!rtu_order) {
+            free(buf);
+            return WTC_ERROR_NO_MEMORY;
+        }
+        for (uint32_t i = 0; i < counts[SECTION_RTU]; i++) {
+            rtu_order[i] = &input->rtus[i];
+        }
+        qsort(rtu_order, counts[SECTION_RTU], sizeof(*rtu_order), compare_rtu_ptrs);
+    }
+
+    config_snapshot_rtu_t *rtus =
+        (config_snapshot_rtu_t *)(buf + header.sections[SECTION_RTU].offset);
+    slot_config_t *slots = (slot_config_t *)(buf + header.sections[SECTION_SLOT].offset);
+    uint32_t slot_pos = 0;
+    for (uint32_t i = 0; i < counts[SECTION_RTU]; i++) {
+        const rtu_device_t *rtu = rtu_order[i];
+        snprintf(rtus[i].station_name, sizeof(rtus[i].station_name), "%s", rtu->station_name);
+        snprintf(rtus[i].ip_address, sizeof(rtus[i].ip_address), "%s", rtu->ip_address);
+        rtus[i].first_slot = slot_pos;
+        if (rtu->slots && rtu->slot_count > 0) {
+            rtus[i].slot_count = (uint32_t)rtu->slot_count;
+            for (int s = 0; s < rtu->slot_count; s++) {
+                put_slot(&slots[slot_pos++], &rtu->slots[s]);
+            }
+        }
+    }
+    free(rtu_order);
+
+    alarm_rule_t *rules = (alarm_rule_t *)(buf + header.sections[SECTION_ALARM_RULE].offset);
+    for (uint32_t i = 0; i < counts[SECTION_ALARM_RULE]; i++) {
+        put_alarm_rule(&rules[i], &input->alarm_rules[i]);
+    }
+    qsort(rules, counts[SECTION_ALARM_RULE], sizeof(*rules), compare_alarm_rules);
+    pid_loop_t *loops = (pid_loop_t *)(buf + header.sections[SECTION_PID_LOOP].offset);
+    for (uint32_t i = 0; i < counts[SECTION_PID_LOOP]; i++) {
+        put_pid_loop(&loops[i], &input->pid_loops[i]);
+    }
+    qsort(loops, counts[SECTION_PID_LOOP], sizeof(*loops), compare_pid_loops);
+    interlock_t *interlocks = (interlock_t *)(buf + header.sections[SECTION_INTERLOCK].offset);
+    for (uint32_t i = 0; i < counts[SECTION_INTERLOCK]; i++) {
+        put_interlock(&interlocks[i], &input->interlocks[i]);
+    }
+    qsort(interlocks, counts[SECTION_INTERLOCK], sizeof(*interlocks), compare_interlocks);
+    historian_tag_t *tags =
+        (historian_tag_t *)(buf + header.sections[SECTION_HISTORIAN_TAG].offset);
+    for (uint32_t i = 0; i < counts[SECTION_HISTORIAN_TAG]; i++) {
+        put_historian_tag(&tags[i], &input->historian_tags[i]);
+    }
+    qsort(tags, counts[SECTION_HISTORIAN_TAG], sizeof(*tags), compare_historian_tags);
+
+    memcpy(buf, &header, sizeof(header));
+    header.checksum = crc32(buf + CHECKED_OFFSET, pos - CHECKED_OFFSET);
+    memcpy(buf + offsetof(snapshot_header_t, checksum), &header.checksum,
+           sizeof(header.checksum));
+
+    *data = buf;
+    *size = pos;
+    if (checksum) *checksum = header.checksum;
+    return WTC_OK;
+}
+
+wtc_result_t config_snapshot_decode(const uint8_t *data, size_t size,
+                                    config_snapshot_view_t *view) {
+    if (!data || !view) return WTC_ERROR_INVALID_PARAM;
+
+    snapshot_header_t header;
+    if (size < sizeof(header)) return WTC_ERROR_PROTOCOL;
+    memcpy(&header, data, sizeof(header));
+
+    if (header.magic != CONFIG_SNAPSHOT_MAGIC ||
+        header.version != CONFIG_SNAPSHOT_VERSION ||
+        header.section_count != SECTION_COUNT ||
+        header.size != size) {
+        return WTC_ERROR_PROTOCOL;
+    }
+
+    const void *base[SECTION_COUNT];
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        const snapshot_section_t *sec = &header.sections[s];
+        if (sec->type != (uint32_t)s || sec->record_size != record_sizes[s] ||
+            sec->offset % 8 != 0 || sec->offset > size ||
+            sec->count > (size - sec->offset) / sec->record_size) {
+            return WTC_ERROR_PROTOCOL;
+        }
+        base[s] = data + sec->offset;
+    }
+
+    if (crc32(data + CHECKED_OFFSET, size - CHECKED_OFFSET) != header.checksum) {
+        return WTC_ERROR_PROTOCOL;
+    }
+
+    memset(view, 0, sizeof(*view));
+    view->rtus = base[SECTION_RTU];
+    view->rtu_count = (int)header.sections[SECTION_RTU].count;
+    view->slots = base[SECTION_SLOT];
+    view->slot_count = (int)header.sections[SECTION_SLOT].count;
+    view->alarm_rules = base[SECTION_ALARM_RULE];
+    view->alarm_rule_count = (int)header.sections[SECTION_ALARM_RULE].count;
+    view->pid_loops = base[SECTION_PID_LOOP];
+    view->pid_loop_count = (int)header.sections[SECTION_PID_LOOP].count;
+    view->interlocks = base[SECTION_INTERLOCK];
+    view->interlock_count = (int)header.sections[SECTION_INTERLOCK].count;
+    view->historian_tags = base[SECTION_HISTORIAN_TAG];
+    view->historian_tag_count = (int)header.sections[SECTION_HISTORIAN_TAG].count;
+    view->checksum = header.checksum;
+    view->written_ms = header.written_ms;
+
+    /* RTU slot ranges must stay inside the slot section */
+    for (int i = 0; i < view->rtu_count; i++) {
+        if (view->rtus[i].first_slot > (uint32_t)view->slot_count ||
+            view->rtus[i].slot_count > (uint32_t)view->slot_count - view->rtus[i].first_slot) {
+            return WTC_ERROR_PROTOCOL;
+        }
+    }
+
+    return WTC_OK;
+}
+
+wtc_result_t config_snapshot_save(const char *path, const uint8_t *data, size_t size) {
+    if (!path || !data) return WTC_ERROR_INVALID_PARAM;
+
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Cannot write configuration snapshot: %s", tmp_path);
+        return WTC_ERROR_IO;
+    }
+
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(fd, data + written, size - written);
+        if (n <= 0) break;
+        written += (size_t)n;
+    }
+
+    bool ok = written == size && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp_path, path) != 0) {
+        LOG_ERROR("Failed to save configuration snapshot: %s", path);
+        unlink(tmp_path);
+        return WTC_ERROR_IO;
+    }
+
+    return WTC_OK;
+}
+
+wtc_result_t config_snapshot_open(config_snapshot_t **snapshot, const char *path) {
+    if (!snapshot || !path) return WTC_ERROR_INVALID_PARAM;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return WTC_ERROR_NOT_FOUND;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(snapshot_header_t)) {
+        close(fd);
+        return WTC_ERROR_PROTOCOL;
+    }
+    size_t size = (size_t)st.st_size;
+    uint8_t *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return WTC_ERROR_IO;
+    }
+
+    config_snapshot_t *snap = calloc(1, sizeof(config_snapshot_t));
+    if (!snap) {
+        munmap(data, size);
+        return WTC_ERROR_NO_MEMORY;
+    }
+    snap->data = data;
+    snap->size = size;
+
+    wtc_result_t res = config_snapshot_decode(data, size, &snap->view);
+    if (res != WTC_OK) {
+        config_snapshot_close(snap);
+        return res;
+    }
+
+    *snapshot = snap;
+    return WTC_OK;
+}
+
+const config_snapshot_view_t *config_snapshot_view(const config_snapshot_t *snapshot) {
+    return snapshot ? &snapshot->view : NULL;
+}
+
+void config_snapshot_close(config_snapshot_t *snapshot) {
+    if (!snapshot) return;
+    munmap(snapshot->data, snapshot->size);
+    free(snapshot);
+}
@@ -0,0 +1,108 @@
+/*
+ * Water Treatment Controller - Binary Configuration Snapshot
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * The runtime configuration (RTUs and their slots, alarm rules, PID
+ * loops, interlocks, historian tags) as one file that can be mapped and
+ * applied at startup without waiting for the database:
+ *
+ *   header (magic, version, section table, payload size, CRC-32)
+ *   sections of fixed-size records, each 8-byte aligned
+ *
+ * Records are the controller's own structs with ids and runtime fields
+ * cleared, so the file is tied to the build that wrote it: a version or
+ * record size mismatch rejects the snapshot and the controller falls
+ * back to the database. The payload CRC doubles as a content hash for
+ * telling whether the database or the live configuration has changed.
+ *
+ * Files are replaced atomically (write to a temporary file, fsync,
+ * rename), so a crash while saving leaves the previous snapshot intact.
+ */
+
+#ifndef WTC_CONFIG_SNAPSHOT_H
+#define WTC_CONFIG_SNAPSHOT_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONFIG_SNAPSHOT_MAGIC       0x53435457u     /* "WTCS" */
+#define CONFIG_SNAPSHOT_VERSION     1
+#define CONFIG_SNAPSHOT_DEFAULT_PATH "/var/lib/water-controller/config.snap"
+
+/* Snapshot handle (a mapped file) */
+typedef struct config_snapshot config_snapshot_t;
+
+/* RTU record; its slots are slots[first_slot .. first_slot+slot_count-1] */
+typedef struct {
+    char station_name[WTC_MAX_STATION_NAME];
+    char ip_address[WTC_MAX_IP_ADDRESS];
+    uint32_t first_slot;
+    uint32_t slot_count;
+} config_snapshot_rtu_t;
+
+/* Configuration to encode. RTU slots are read from rtus[i].slots. */
+typedef struct {
+    const rtu_device_t *rtus;
+    int rtu_count;
+    const alarm_rule_t *alarm_rules;
+    int alarm_rule_count;
+    const pid_loop_t *pid_loops;
+    int pid_loop_count;
+    const interlock_t *interlocks;
+    int interlock_count;
+    const historian_tag_t *historian_tags;
+    int historian_tag_count;
+} config_snapshot_input_t;
+
+/* Decoded snapshot; the arrays point into the encoded data */
+typedef struct {
+    const config_snapshot_rtu_t *rtus;
+    int rtu_count;
+    const slot_config_t *slots;
+    int slot_count;
+    const alarm_rule_t *alarm_rules;
+    int alarm_rule_count;
+    const pid_loop_t *pid_loops;
+    int pid_loop_count;
+    const interlock_t *interlocks;
+    int interlock_count;
+    const historian_tag_t *historian_tags;
+    int historian_tag_count;
+    uint32_t checksum;          /* Payload CRC-32 */
+    uint64_t written_ms;
+} config_snapshot_view_t;
+
+/* Encode configuration. *data is allocated with malloc and owned by the
+ * caller. Equal configurations encode to equal checksums, whatever
+ * order their records are listed in. */
+wtc_result_t config_snapshot_encode(const config_snapshot_input_t *input,
+                                    uint8_t **data,
+                                    size_t *size,
+                                    uint32_t *checksum);
+
+/* Validate encoded data and decode it in place */
+wtc_result_t config_snapshot_decode(const uint8_t *data, size_t size,
+                                    config_snapshot_view_t *view);
+
+/* Atomically replace the snapshot file at path */
+wtc_result_t config_snapshot_save(const char *path, const uint8_t *data, size_t size);
+
+/* Map and validate the snapshot file. WTC_ERROR_NOT_FOUND if there is
+ * none, WTC_ERROR_PROTOCOL if it is corrupt or from another version. */
+wtc_result_t config_snapshot_open(config_snapshot_t **snapshot, const char *path);
+
+/* Decoded contents of an open snapshot, valid until it is closed */
+const config_snapshot_view_t *config_snapshot_view(const config_snapshot_t *snapshot);
+
+/* Unmap the snapshot */
+void config_snapshot_close(config_snapshot_t *snapshot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_CONFIG_SNAPSHOT_H */
@@ -9,10 +9,14 @@
 #include "../registry/rtu_registry.h"
 #include "../utils/time_utils.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+#define MAX_SYNC_WORKERS        32
+#define SYNC_QUEUE_SIZE         WTC_MAX_RTUS
+
 /* ============== Manager Structure ============== */
 
 struct config_sync_manager {
@@ -23,16 +27,36 @@ struct config_sync_manager {
     void *callback_ctx;
     config_sync_stats_t stats;
     uint32_t controller_id;  /* Unique controller identifier */
+
+    /* Pending RTUs, synced by a bounded pool of workers */
+    char queue[SYNC_QUEUE_SIZE][WTC_MAX_STATION_NAME];
+    int queue_head;
+    int queue_count;
+    char in_flight[MAX_SYNC_WORKERS][WTC_MAX_STATION_NAME];
+    int in_flight_count;
+
+    pthread_t workers[MAX_SYNC_WORKERS];
+    int worker_count;
+    bool running;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t idle_cond;
 };
 
 /* ============== Helper Functions ============== */
 
 static uint64_t get_current_time_ms(void) {
-    return time_utils_get_monotonic_ms();
+    return time_get_ms();
 }
 
 static uint32_t get_unix_timestamp(void) {
-    return (uint32_t)time_utils_get_unix_seconds();
+    return (uint32_t)(time_get_ms() / 1000);
+}
+
+static void stats_add(config_sync_manager_t *manager, uint32_t *counter, uint32_t n) {
+    pthread_mutex_lock(&manager->lock);
+    *counter += n;
+    pthread_mutex_unlock(&manager->lock);
 }
 
 /* ============== Manager Lifecycle ============== */
@@ -56,15 +80,29 @@ wtc_result_t config_sync_manager_init(config_sync_manager_t **manager,
         mgr->config = default_config;
     }
 
+    if (mgr->config.max_in_flight <= 0) {
+        mgr->config.max_in_flight = 1;
+    } else if (mgr->config.max_in_flight > MAX_SYNC_WORKERS) {
+        mgr->config.max_in_flight = MAX_SYNC_WORKERS;
+    }
+
     /* Generate controller ID from timestamp + random */
     mgr->controller_id = get_unix_timestamp() ^ 0xC0DE;
 
+    pthread_mutex_init(&mgr->lock, NULL);
+    pthread_cond_init(&mgr->work_cond, NULL);
+    pthread_cond_init(&mgr->idle_cond, NULL);
+
     *manager = mgr;
     return WTC_OK;
 }
 
 void config_sync_manager_cleanup(config_sync_manager_t *manager) {
     if (manager) {
+        config_sync_manager_stop(manager);
+        pthread_cond_destroy(&manager->idle_cond);
+        pthread_cond_destroy(&manager->work_cond);
+        pthread_mutex_destroy(&manager->lock);
         free(manager);
     }
 }
@@ -128,7 +166,8 @@ static config_sync_result_t build_enrollment_packet(
 
 static config_sync_result_t build_device_config_packet(
     device_config_payload_t *payload,
-    const rtu_device_t *device
+    const rtu_device_t *device,
+    uint32_t *hash
 ) {
     if (!payload || !device) {
         return CONFIG_SYNC_ERROR_INVALID_PARAM;
@@ -138,7 +177,6 @@ static config_sync_result_t build_device_config_packet(
 
     payload->version = CONFIG_SYNC_PROTOCOL_VERSION;
     payload->flags = 0x01;  /* config_changed */
-    payload->config_timestamp = get_unix_timestamp();
 
     /* Copy station name */
     strncpy(payload->station_name, device->station_name, CONFIG_SYNC_MAX_STATION_NAME - 1);
@@ -163,6 +201,12 @@ static config_sync_result_t build_device_config_packet(
     payload->reserved = 0;
     payload->watchdog_ms = 3000;  /* 3 second watchdog */
 
+    /* Hash before the timestamp and CRC are filled in */
+    if (hash) {
+        *hash = config_sync_hash(payload, sizeof(*payload));
+    }
+    payload->config_timestamp = get_unix_timestamp();
+
     /* Calculate CRC */
     device_config_set_crc(payload);
 
@@ -359,7 +403,7 @@ config_sync_result_t config_sync_send_device_config(
     }
 
     device_config_payload_t payload;
-    config_sync_result_t result = build_device_config_packet(&payload, device);
+    config_sync_result_t result = build_device_config_packet(&payload, device, NULL);
     if (result != CONFIG_SYNC_OK) {
         return result;
     }
@@ -423,6 +467,45 @@ config_sync_result_t config_sync_send_actuator_config(
                        buffer, packet_size);
 }
 
+/* Read the section hashes the RTU has applied. Returns false for RTUs
+ * that do not implement the version record. */
+static bool read_rtu_version(config_sync_manager_t *manager,
+                             const char *station_name,
+                             config_version_payload_t *version) {
+    size_t len = sizeof(*version);
+    if (profinet_controller_read_record(manager->profinet, station_name,
+                                        0, 0, 1, CONFIG_SYNC_VERSION_INDEX,
+                                        version, &len) != WTC_OK) {
+        return false;
+    }
+    return len == sizeof(*version) && config_version_validate(version);
+}
+
+/* Write one section unless the RTU already has the same content */
+static config_sync_result_t sync_section(config_sync_manager_t *manager,
+                                         const char *station_name,
+                                         uint16_t index,
+                                         const void *data,
+                                         size_t len,
+                                         bool have_remote,
+                                         uint32_t remote_hash,
+                                         uint32_t local_hash) {
+    if (have_remote && remote_hash == local_hash) {
+        stats_add(manager, &manager->stats.sections_skipped, 1);
+        return CONFIG_SYNC_OK;
+    }
+
+    config_sync_result_t result = CONFIG_SYNC_ERROR_SEND;
+    for (uint32_t attempt = 0; attempt <= manager->config.retry_count; attempt++) {
+        result = send_packet(manager, station_name, index, data, len);
+        if (result == CONFIG_SYNC_OK) {
+            stats_add(manager, &manager->stats.sections_sent, 1);
+            break;
+        }
+    }
+    return result;
+}
+
 config_sync_result_t config_sync_to_rtu(
     config_sync_manager_t *manager,
     const char *station_name
@@ -440,72 +523,228 @@ config_sync_result_t config_sync_to_rtu(
     }
 
     /* Get RTU device from registry */
-    rtu_device_t *device = rtu_registry_find_device(manager->registry, station_name);
+    rtu_device_t *device = rtu_registry_get_device(manager->registry, station_name);
     if (!device) {
         return CONFIG_SYNC_ERROR_INVALID_PARAM;
     }
 
     /* Check RTU is connected */
     if (device->connection_state != PROFINET_STATE_RUNNING) {
+        rtu_registry_free_device_copy(device);
         return CONFIG_SYNC_ERROR_RTU_NOT_CONNECTED;
     }
 
-    config_sync_result_t result = CONFIG_SYNC_OK;
-    manager->stats.total_syncs++;
+    stats_add(manager, &manager->stats.total_syncs, 1);
 
     /* 1. Send enrollment (if enabled and we have a token) */
     /* Note: In a full implementation, we'd fetch the token from a database or config */
     /* For now, we skip enrollment if no token source is available */
 
+    /* Ask the RTU what it already has; unchanged sections are skipped */
+    config_version_payload_t remote;
+    bool have_remote = manager->config.skip_unchanged &&
+                       read_rtu_version(manager, station_name, &remote);
+
+    config_sync_result_t result = CONFIG_SYNC_OK;
+    bool has_slots = device->slots && device->slot_count > 0;
+
     /* 2. Send device config (if enabled) */
     if (manager->config.sync_device_config) {
-        result = config_sync_send_device_config(manager, station_name, device);
-        if (result != CONFIG_SYNC_OK) {
-            manager->stats.failed_syncs++;
-            if (manager->callback) {
-                manager->callback(station_name, result, manager->callback_ctx);
-            }
-            return result;
+        device_config_payload_t payload;
+        uint32_t hash = 0;
+        result = build_device_config_packet(&payload, device, &hash);
+        if (result == CONFIG_SYNC_OK) {
+            result = sync_section(manager, station_name, CONFIG_SYNC_DEVICE_INDEX,
+                                  &payload, sizeof(payload),
+                                  have_remote, have_remote ? remote.device_hash : 0, hash);
         }
     }
 
     /* 3. Send sensor config (if enabled and slots exist) */
-    if (manager->config.sync_sensor_config && device->slots && device->slot_count > 0) {
-        result = config_sync_send_sensor_config(manager, station_name,
-                                                 device->slots, device->slot_count);
-        if (result != CONFIG_SYNC_OK) {
-            manager->stats.failed_syncs++;
-            if (manager->callback) {
-                manager->callback(station_name, result, manager->callback_ctx);
-            }
-            return result;
+    if (result == CONFIG_SYNC_OK && manager->config.sync_sensor_config && has_slots) {
+        uint8_t buffer[sizeof(sensor_config_header_t) +
+                       (CONFIG_SYNC_MAX_SENSORS * sizeof(sensor_config_entry_t))];
+        size_t packet_size = 0;
+        result = build_sensor_config_packet(buffer, sizeof(buffer), &packet_size,
+                                            device->slots, device->slot_count);
+        if (result == CONFIG_SYNC_OK) {
+            result = sync_section(manager, station_name, CONFIG_SYNC_SENSOR_INDEX,
+                                  buffer, packet_size,
+                                  have_remote, have_remote ? remote.sensor_hash : 0,
+                                  config_sync_hash(buffer, packet_size));
         }
     }
 
     /* 4. Send actuator config (if enabled and slots exist) */
-    if (manager->config.sync_actuator_config && device->slots && device->slot_count > 0) {
-        result = config_sync_send_actuator_config(manager, station_name,
-                                                   device->slots, device->slot_count);
-        if (result != CONFIG_SYNC_OK) {
-            manager->stats.failed_syncs++;
-            if (manager->callback) {
-                manager->callback(station_name, result, manager->callback_ctx);
-            }
-            return result;
+    if (result == CONFIG_SYNC_OK && manager->config.sync_actuator_config && has_slots) {
+        uint8_t buffer[sizeof(actuator_config_header_t) +
+                       (CONFIG_SYNC_MAX_ACTUATORS * sizeof(actuator_config_entry_t))];
+        size_t packet_size = 0;
+        result = build_actuator_config_packet(buffer, sizeof(buffer), &packet_size,
+                                              device->slots, device->slot_count);
+        if (result == CONFIG_SYNC_OK) {
+            result = sync_section(manager, station_name, CONFIG_SYNC_ACTUATOR_INDEX,
+                                  buffer, packet_size,
+                                  have_remote, have_remote ? remote.actuator_hash : 0,
+                                  config_sync_hash(buffer, packet_size));
         }
     }
 
-    /* Success */
-    manager->stats.successful_syncs++;
-    manager->stats.last_sync_time_ms = get_current_time_ms();
-    strncpy(manager->stats.last_sync_rtu, station_name, WTC_MAX_STATION_NAME - 1);
-    manager->stats.last_sync_rtu[WTC_MAX_STATION_NAME - 1] = '\0';
+    rtu_registry_free_device_copy(device);
+
+    pthread_mutex_lock(&manager->lock);
+    if (result == CONFIG_SYNC_OK) {
+        manager->stats.successful_syncs++;
+        manager->stats.last_sync_time_ms = get_current_time_ms();
+        strncpy(manager->stats.last_sync_rtu, station_name, WTC_MAX_STATION_NAME - 1);
+        manager->stats.last_sync_rtu[WTC_MAX_STATION_NAME - 1] = '\0';
+    } else {
+        manager->stats.failed_syncs++;
+    }
+    pthread_mutex_unlock(&manager->lock);
 
     if (manager->callback) {
-        manager->callback(station_name, CONFIG_SYNC_OK, manager->callback_ctx);
+        manager->callback(station_name, result, manager->callback_ctx);
     }
 
-    return CONFIG_SYNC_OK;
+    return result;
+}
+
+/* ============== Fan-out ============== */
+
+/* Is the station waiting in the queue; lock held. A station being
+ * synced is not enough: it may have reconnected after its sync read
+ * the configuration, so it is queued again. */
+static bool sync_queued(config_sync_manager_t *manager, const char *station_name) {
+    for (int i = 0; i < manager->queue_count; i++) {
+        int slot = (manager->queue_head + i) % SYNC_QUEUE_SIZE;
+        if (strcmp(manager->queue[slot], station_name) == 0) return true;
+    }
+    return false;
+}
+
+static bool sync_in_flight(config_sync_manager_t *manager, const char *station_name) {
+    for (int i = 0; i < manager->in_flight_count; i++) {
+        if (strcmp(manager->in_flight[i], station_name) == 0) return true;
+    }
+    return false;
+}
+
+/* Take the oldest queued station not already being synced, so one RTU
+ * never has two syncs at once; lock held */
+static bool take_next_sync(config_sync_manager_t *manager, char *station_name) {
+    for (int i = 0; i < manager->queue_count; i++) {
+        int slot = (manager->queue_head + i) % SYNC_QUEUE_SIZE;
+        if (sync_in_flight(manager, manager->queue[slot])) continue;
+
+        memcpy(station_name, manager->queue[slot], WTC_MAX_STATION_NAME);
+        for (int j = i; j > 0; j--) {
+            int to = (manager->queue_head + j) % SYNC_QUEUE_SIZE;
+            int from = (manager->queue_head + j - 1) % SYNC_QUEUE_SIZE;
+            memcpy(manager->queue[to], manager->queue[from], WTC_MAX_STATION_NAME);
+        }
+        manager->queue_head = (manager->queue_head + 1) % SYNC_QUEUE_SIZE;
+        manager->queue_count--;
+        return true;
+    }
+    return false;
+}
+
+static void *sync_worker(void *arg) {
+    config_sync_manager_t *manager = arg;
+    char station_name[WTC_MAX_STATION_NAME];
+
+    pthread_mutex_lock(&manager->lock);
+    for (;;) {
+        while (manager->running && !take_next_sync(manager, station_name)) {
+            pthread_cond_wait(&manager->work_cond, &manager->lock);
+        }
+        if (!manager->running) break;
+
+        memcpy(manager->in_flight[manager->in_flight_count++], station_name,
+               sizeof(station_name));
+        pthread_mutex_unlock(&manager->lock);
+
+        config_sync_to_rtu(manager, station_name);
+
+        pthread_mutex_lock(&manager->lock);
+        for (int i = 0; i < manager->in_flight_count; i++) {
+            if (strcmp(manager->in_flight[i], station_name) == 0) {
+                memcpy(manager->in_flight[i],
+                       manager->in_flight[--manager->in_flight_count],
+                       sizeof(station_name));
+                break;
+            }
+        }
+        if (manager->queue_count == 0 && manager->in_flight_count == 0) {
+            pthread_cond_broadcast(&manager->idle_cond);
+        }
+    }
+    pthread_mutex_unlock(&manager->lock);
+    return NULL;
+}
+
+wtc_result_t config_sync_manager_start(config_sync_manager_t *manager) {
+    if (!manager) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    if (manager->running) {
+        return WTC_OK;
+    }
+
+    manager->running = true;
+    for (int i = 0; i < manager->config.max_in_flight; i++) {
+        if (pthread_create(&manager->workers[i], NULL, sync_worker, manager) != 0) {
+            break;
+        }
+        manager->worker_count++;
+    }
+
+    if (manager->worker_count == 0) {
+        manager->running = false;
+        return WTC_ERROR;
+    }
+    return WTC_OK;
+}
+
+wtc_result_t config_sync_manager_stop(config_sync_manager_t *manager) {
+    if (!manager) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&manager->lock);
+    manager->running = false;
+    pthread_cond_broadcast(&manager->work_cond);
+    pthread_cond_broadcast(&manager->idle_cond);
+    pthread_mutex_unlock(&manager->lock);
+
+    for (int i = 0; i < manager->worker_count; i++) {
+        pthread_join(manager->workers[i], NULL);
+    }
+    manager->worker_count = 0;
+    manager->queue_count = 0;
+    return WTC_OK;
+}
+
+wtc_result_t config_sync_wait_idle(config_sync_manager_t *manager, uint32_t timeout_ms) {
+    if (!manager) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    time_add_ms(&deadline, timeout_ms);
+
+    wtc_result_t res = WTC_OK;
+    pthread_mutex_lock(&manager->lock);
+    while (manager->running && (manager->queue_count > 0 || manager->in_flight_count > 0)) {
+        if (pthread_cond_timedwait(&manager->idle_cond, &manager->lock, &deadline) != 0) {
+            res = WTC_ERROR_TIMEOUT;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&manager->lock);
+    return res;
 }
 
 void config_sync_on_rtu_connect(config_sync_manager_t *manager,
@@ -514,9 +753,28 @@ void config_sync_on_rtu_connect(config_sync_manager_t *manager,
         return;
     }
 
-    if (manager->config.sync_on_connect) {
+    if (!manager->config.sync_on_connect) {
+        return;
+    }
+
+    /* Without workers, sync inline as before */
+    if (!manager->running) {
         config_sync_to_rtu(manager, station_name);
+        return;
+    }
+
+    pthread_mutex_lock(&manager->lock);
+    if (!sync_queued(manager, station_name)) {
+        if (manager->queue_count < SYNC_QUEUE_SIZE) {
+            int slot = (manager->queue_head + manager->queue_count) % SYNC_QUEUE_SIZE;
+            snprintf(manager->queue[slot], WTC_MAX_STATION_NAME, "%s", station_name);
+            manager->queue_count++;
+            pthread_cond_signal(&manager->work_cond);
+        } else {
+            manager->stats.failed_syncs++;
+        }
     }
+    pthread_mutex_unlock(&manager->lock);
 }
 
 wtc_result_t config_sync_get_stats(config_sync_manager_t *manager,
@@ -525,6 +783,9 @@ wtc_result_t config_sync_get_stats(config_sync_manager_t *manager,
         return WTC_ERROR_INVALID_PARAM;
     }
 
+    pthread_mutex_lock(&manager->lock);
     *stats = manager->stats;
+    stats->pending = (uint32_t)(manager->queue_count + manager->in_flight_count);
+    pthread_mutex_unlock(&manager->lock);
     return WTC_OK;
 }
@@ -6,6 +6,12 @@
  * Handles PROFINET acyclic synchronization of configuration
  * from Controller to RTUs. Triggered on AR_STATE_RUN.
  *
+ * Sync is incremental: the RTU's version record (0xF846) reports the
+ * hash of each section it applied and only changed sections are
+ * written. Once started, a pool of max_in_flight workers syncs
+ * connecting RTUs concurrently, so a reconnect storm is not serialized
+ * behind one RTU at a time.
+ *
  * Wire protocol definitions are in shared/include/config_sync_protocol.h
  */
 
@@ -42,6 +48,8 @@ typedef struct {
     bool sync_actuator_config;      /* Send actuator config (0xF843) */
     uint32_t sync_timeout_ms;       /* Timeout for each write operation */
     uint32_t retry_count;           /* Number of retries on failure */
+    bool skip_unchanged;            /* Skip sections the RTU reports as current */
+    int max_in_flight;              /* RTUs synced concurrently */
 } config_sync_config_t;
 
 /* Default configuration */
@@ -53,6 +61,8 @@ typedef struct {
     .sync_actuator_config = true, \
     .sync_timeout_ms = 5000, \
     .retry_count = 2, \
+    .skip_unchanged = true, \
+    .max_in_flight = 8, \
 }
 
 /* ============== Sync Manager ============== */
@@ -69,6 +79,9 @@ typedef struct {
     uint32_t total_syncs;
     uint32_t successful_syncs;
     uint32_t failed_syncs;
+    uint32_t sections_sent;
+    uint32_t sections_skipped;      /* Unchanged on the RTU */
+    uint32_t pending;               /* Queued or in flight */
     uint64_t last_sync_time_ms;
     char last_sync_rtu[WTC_MAX_STATION_NAME];
 } config_sync_stats_t;
@@ -90,6 +103,23 @@ wtc_result_t config_sync_manager_init(config_sync_manager_t **manager,
  */
 void config_sync_manager_cleanup(config_sync_manager_t *manager);
 
+/**
+ * Start the sync workers. Until started, connect events sync inline.
+ */
+wtc_result_t config_sync_manager_start(config_sync_manager_t *manager);
+
+/**
+ * Stop the sync workers; queued RTUs are dropped.
+ */
+wtc_result_t config_sync_manager_stop(config_sync_manager_t *manager);
+
+/**
+ * Wait until no RTU is queued or being synced.
+ *
+ * @return WTC_OK when idle, WTC_ERROR_TIMEOUT otherwise
+ */
+wtc_result_t config_sync_wait_idle(config_sync_manager_t *manager, uint32_t timeout_ms);
+
 /**
  * Set PROFINET controller for sync operations.
  */
@@ -117,7 +147,8 @@ void config_sync_set_callback(config_sync_manager_t *manager,
  * Sync all configuration to a specific RTU.
  * Called on AR_STATE_RUN transition.
  *
- * Sends packets in order:
+ * Reads the RTU's version record (0xF846) first when skip_unchanged is
+ * set, then sends the sections whose content differs, in order:
  *   1. Enrollment (0xF845) - if sync_enrollment enabled
  *   2. Device config (0xF841) - if sync_device_config enabled
  *   3. Sensor config (0xF842) - if sync_sensor_config enabled
@@ -188,7 +219,8 @@ config_sync_result_t config_sync_send_actuator_config(config_sync_manager_t *man
 
 /**
  * Handle RTU connection event (AR_STATE_RUN).
- * Triggers full config sync if sync_on_connect enabled.
+ * Queues a config sync if sync_on_connect enabled; inline when the
+ * workers are not started. Does not block once started.
  *
  * @param manager       Sync manager
  * @param station_name  RTU that connected
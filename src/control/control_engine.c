@@ -6,6 +6,7 @@
 
 #include "control_engine.h"
 #include "registry/rtu_registry.h"
+#include "core/latency_trace.h"
 #include "utils/logger.h"
 #include "utils/time_utils.h"
 
@@ -56,10 +57,41 @@ struct control_engine {
     uint64_t last_input_time_ms[WTC_MAX_PID_LOOPS];
     bool comm_loss[WTC_MAX_PID_LOOPS];
 
+    /* Latency tracing: receive time of the last input traced per loop,
+     * so an input is traced through the first output computed from it */
+    latency_trace_t *trace;
+    uint64_t traced_pid_rx_us[WTC_MAX_PID_LOOPS];
+    uint64_t traced_interlock_rx_us[WTC_MAX_INTERLOCKS];
+
     /* Statistics */
     control_stats_t stats;
 };
 
+/* Write an output, traced when the input it came from is new. The
+ * input stage is recorded against read_us, the time the scan read it. */
+static void write_output(control_engine_t *engine, const char *station, int slot,
+                         const actuator_output_t *output, const sensor_data_t *input,
+                         uint64_t *traced_rx_us, uint32_t trace_id, uint64_t read_us) {
+    if (!engine->trace || input->rx_time_us == 0 || input->rx_time_us == *traced_rx_us) {
+        rtu_registry_update_actuator(engine->registry, station, slot, output);
+        return;
+    }
+
+    *traced_rx_us = input->rx_time_us;
+    uint64_t write_us = time_get_monotonic_us();
+    if (rtu_registry_update_actuator_traced(engine->registry, station, slot, output,
+                                            input->rx_time_us, trace_id) != WTC_OK) {
+        return;
+    }
+
+    if (read_us >= input->rx_time_us) {
+        latency_trace_record(engine->trace, trace_id, LATENCY_STAGE_INPUT,
+                             read_us - input->rx_time_us);
+    }
+    latency_trace_record(engine->trace, trace_id, LATENCY_STAGE_COMPUTE,
+                         write_us - read_us);
+}
+
 /* Forward declarations */
 static void process_pid_loops(control_engine_t *engine);
 static void process_interlocks(control_engine_t *engine);
@@ -89,9 +121,12 @@ static void *control_thread_func(void *arg) {
         if (elapsed_us > engine->stats.scan_time_us_max) {
             engine->stats.scan_time_us_max = elapsed_us;
         }
+        engine->stats.scan_time_us_total += elapsed_us;
         engine->stats.scan_time_us_avg =
-            (engine->stats.scan_time_us_avg * (engine->stats.total_scans - 1) +
-             elapsed_us) / engine->stats.total_scans;
+            engine->stats.scan_time_us_total / engine->stats.total_scans;
+        if (elapsed_us > (uint64_t)engine->config.scan_rate_ms * 1000) {
+            engine->stats.scan_overruns++;
+        }
 
         /* Wait for next scan */
         next_scan_ms += engine->config.scan_rate_ms;
@@ -218,6 +253,7 @@ static void process_pid_loops(control_engine_t *engine) {
                                                     loop->input_rtu,
                                                     loop->input_slot,
                                                     &sensor);
+        uint64_t read_us = engine->trace ? time_get_monotonic_us() : 0;
 
         /* CE-H2 fix: Track communication status */
         if (res == WTC_OK && sensor.status == IOPS_GOOD) {
@@ -282,10 +318,9 @@ static void process_pid_loops(control_engine_t *engine) {
         actuator_out.reserved[0] = 0;
         actuator_out.reserved[1] = 0;
 
-        rtu_registry_update_actuator(engine->registry,
-                                     loop->output_rtu,
-                                     loop->output_slot,
-                                     &actuator_out);
+        write_output(engine, loop->output_rtu, loop->output_slot, &actuator_out,
+                     &sensor, &engine->traced_pid_rx_us[i],
+                     LATENCY_TRACE_ID(LATENCY_PATH_PID, loop->loop_id), read_us);
 
         /* Invoke callback */
         if (engine->config.on_pid_output) {
@@ -312,11 +347,12 @@ static void process_interlocks(control_engine_t *engine) {
         }
 
         /* Read condition value from RTU */
-        sensor_data_t sensor;
+        sensor_data_t sensor = {0};
         wtc_result_t res = rtu_registry_get_sensor(engine->registry,
                                                     interlock->condition_rtu,
                                                     interlock->condition_slot,
                                                     &sensor);
+        uint64_t read_us = engine->trace ? time_get_monotonic_us() : 0;
         if (res != WTC_OK || sensor.status != IOPS_GOOD) {
             /* Input fault - treat as condition met for safety */
             LOG_WARN("Interlock %d: input fault, assuming trip condition",
@@ -382,10 +418,10 @@ static void process_interlocks(control_engine_t *engine) {
                 break;
             }
 
-            rtu_registry_update_actuator(engine->registry,
-                                         interlock->action_rtu,
-                                         interlock->action_slot,
-                                         &actuator_out);
+            write_output(engine, interlock->action_rtu, interlock->action_slot,
+                         &actuator_out, &sensor, &engine->traced_interlock_rx_us[i],
+                         LATENCY_TRACE_ID(LATENCY_PATH_INTERLOCK, interlock->interlock_id),
+                         read_us);
         }
     }
 }
@@ -504,6 +540,21 @@ wtc_result_t control_engine_set_registry(control_engine_t *engine,
     return WTC_OK;
 }
 
+wtc_result_t control_engine_set_latency_trace(control_engine_t *engine,
+                                               struct latency_trace *trace) {
+    if (!engine) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+    engine->trace = trace;
+    memset(engine->traced_pid_rx_us, 0, sizeof(engine->traced_pid_rx_us));
+    memset(engine->traced_interlock_rx_us, 0, sizeof(engine->traced_interlock_rx_us));
+    pthread_mutex_unlock(&engine->lock);
+
+    return WTC_OK;
+}
+
 wtc_result_t control_engine_add_pid_loop(control_engine_t *engine,
                                           const pid_loop_t *config,
                                           int *loop_id) {
@@ -558,6 +609,66 @@ wtc_result_t control_engine_remove_pid_loop(control_engine_t *engine,
     return WTC_ERROR_NOT_FOUND;
 }
 
+/* Switch mode; caller holds the lock */
+static void change_pid_mode(pid_loop_t *loop, pid_mode_t mode) {
+    pid_mode_t old_mode = loop->mode;
+
+    /* CE-H1 fix: Bumpless transfer - preserve integral term and set output to current CV */
+    if (old_mode == PID_MODE_MANUAL && mode == PID_MODE_AUTO) {
+        /* Manual to Auto: Initialize integral to current output for bumpless transfer */
+        loop->integral = loop->cv;
+        loop->last_error = 0;
+        LOG_DEBUG("PID loop %d bumpless transfer: integral set to %.2f", loop->loop_id, loop->cv);
+    } else if (old_mode == PID_MODE_AUTO && mode == PID_MODE_MANUAL) {
+        /* Auto to Manual: Preserve current output */
+        /* cv is already the current output, nothing to do */
+        LOG_DEBUG("PID loop %d switched to manual, output preserved at %.2f", loop->loop_id, loop->cv);
+    }
+
+    loop->mode = mode;
+}
+
+wtc_result_t control_engine_update_pid_loop(control_engine_t *engine,
+                                             int loop_id,
+                                             const pid_loop_t *config) {
+    if (!engine || !config) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+
+    for (int i = 0; i < engine->pid_loop_count; i++) {
+        pid_loop_t *loop = &engine->pid_loops[i];
+        if (loop->loop_id == loop_id) {
+            /* Configuration only; pv, cv, integrator and derivative carry on */
+            memcpy(loop->name, config->name, sizeof(loop->name));
+            loop->name[sizeof(loop->name) - 1] = '\0';
+            loop->enabled = config->enabled;
+            memcpy(loop->input_rtu, config->input_rtu, sizeof(loop->input_rtu));
+            loop->input_rtu[sizeof(loop->input_rtu) - 1] = '\0';
+            loop->input_slot = config->input_slot;
+            memcpy(loop->output_rtu, config->output_rtu, sizeof(loop->output_rtu));
+            loop->output_rtu[sizeof(loop->output_rtu) - 1] = '\0';
+            loop->output_slot = config->output_slot;
+            loop->kp = config->kp;
+            loop->ki = config->ki;
+            loop->kd = config->kd;
+            loop->setpoint = config->setpoint;
+            loop->output_min = config->output_min;
+            loop->output_max = config->output_max;
+            loop->deadband = config->deadband;
+            loop->integral_limit = config->integral_limit;
+            loop->derivative_filter = config->derivative_filter;
+            change_pid_mode(loop, config->mode);
+            pthread_mutex_unlock(&engine->lock);
+            return WTC_OK;
+        }
+    }
+
+    pthread_mutex_unlock(&engine->lock);
+    return WTC_ERROR_NOT_FOUND;
+}
+
 wtc_result_t control_engine_get_pid_loop(control_engine_t *engine,
                                           int loop_id,
                                           pid_loop_t *loop) {
@@ -579,6 +690,35 @@ wtc_result_t control_engine_get_pid_loop(control_engine_t *engine,
     return WTC_ERROR_NOT_FOUND;
 }
 
+wtc_result_t control_engine_restore_pid_state(control_engine_t *engine,
+                                               const pid_loop_t *state) {
+    if (!engine || !state) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&engine->lock);
+
+    for (int i = 0; i < engine->pid_loop_count; i++) {
+        pid_loop_t *loop = &engine->pid_loops[i];
+        if (loop->loop_id == state->loop_id) {
+            loop->setpoint = state->setpoint;
+            loop->mode = state->mode;
+            loop->pv = state->pv;
+            loop->cv = state->cv;
+            loop->error = state->error;
+            loop->integral = state->integral;
+            loop->derivative = state->derivative;
+            loop->last_error = state->last_error;
+            loop->last_update_ms = state->last_update_ms;
+            pthread_mutex_unlock(&engine->lock);
+            return WTC_OK;
+        }
+    }
+
+    pthread_mutex_unlock(&engine->lock);
+    return WTC_ERROR_NOT_FOUND;
+}
+
 wtc_result_t control_engine_set_setpoint(control_engine_t *engine,
                                           int loop_id,
                                           float setpoint) {
@@ -614,20 +754,7 @@ wtc_result_t control_engine_set_pid_mode(control_engine_t *engine,
         if (engine->pid_loops[i].loop_id == loop_id) {
             pid_loop_t *loop = &engine->pid_loops[i];
             pid_mode_t old_mode = loop->mode;
-
-            /* CE-H1 fix: Bumpless transfer - preserve integral term and set output to current CV */
-            if (old_mode == PID_MODE_MANUAL && mode == PID_MODE_AUTO) {
-                /* Manual to Auto: Initialize integral to current output for bumpless transfer */
-                loop->integral = loop->cv;
-                loop->last_error = 0;
-                LOG_DEBUG("PID loop %d bumpless transfer: integral set to %.2f", loop_id, loop->cv);
-            } else if (old_mode == PID_MODE_AUTO && mode == PID_MODE_MANUAL) {
-                /* Auto to Manual: Preserve current output */
-                /* cv is already the current output, nothing to do */
-                LOG_DEBUG("PID loop %d switched to manual, output preserved at %.2f", loop_id, loop->cv);
-            }
-
-            loop->mode = mode;
+            change_pid_mode(loop, mode);
             pthread_mutex_unlock(&engine->lock);
             LOG_INFO("PID loop %d mode changed from %d to %d", loop_id, old_mode, mode);
             return WTC_OK;
@@ -684,14 +811,12 @@ wtc_result_t control_engine_get_pid_output(control_engine_t *engine,
     return WTC_ERROR_NOT_FOUND;
 }
 
-wtc_result_t control_engine_list_pid_loops(control_engine_t *engine,
-                                            pid_loop_t **loops,
-                                            int *count,
-                                            int max_count) {
-    if (!engine || !loops || !count) {
-        return WTC_ERROR_INVALID_PARAM;
-    }
-
+/* Copy PID loops into an array from the arena, or the heap without one */
+static wtc_result_t copy_pid_loops(control_engine_t *engine,
+                                   arena_t *arena,
+                                   pid_loop_t **loops,
+                                   int *count,
+                                   int max_count) {
     pthread_mutex_lock(&engine->lock);
 
     int copy_count = engine->pid_loop_count;
@@ -699,15 +824,44 @@ wtc_result_t control_engine_list_pid_loops(control_engine_t *engine,
         copy_count = max_count;
     }
 
-    for (int i = 0; i < copy_count; i++) {
-        loops[i] = &engine->pid_loops[i];
+    if (copy_count > 0) {
+        *loops = arena ? arena_alloc(arena, copy_count * sizeof(pid_loop_t))
+                       : malloc(copy_count * sizeof(pid_loop_t));
+        if (!*loops) {
+            pthread_mutex_unlock(&engine->lock);
+            return WTC_ERROR_NO_MEMORY;
+        }
+        memcpy(*loops, engine->pid_loops, copy_count * sizeof(pid_loop_t));
+    } else {
+        *loops = NULL;
     }
-    *count = copy_count;
 
+    *count = copy_count;
     pthread_mutex_unlock(&engine->lock);
     return WTC_OK;
 }
 
+wtc_result_t control_engine_list_pid_loops_copy(control_engine_t *engine,
+                                            pid_loop_t **loops,
+                                            int *count,
+                                            int max_count) {
+    if (!engine || !loops || !count) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    return copy_pid_loops(engine, NULL, loops, count, max_count);
+}
+
+wtc_result_t control_engine_list_pid_loops_arena(control_engine_t *engine,
+                                                  arena_t *arena,
+                                                  pid_loop_t **loops,
+                                                  int *count,
+                                                  int max_count) {
+    if (!engine || !arena || !loops || !count) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    return copy_pid_loops(engine, arena, loops, count, max_count);
+}
+
 wtc_result_t control_engine_add_interlock(control_engine_t *engine,
                                            const interlock_t *config,
                                            int *interlock_id) {
@@ -840,7 +994,7 @@ wtc_result_t control_engine_reset_interlock(control_engine_t *engine,
     return WTC_ERROR_NOT_FOUND;
 }
 
-wtc_result_t control_engine_list_interlocks(control_engine_t *engine,
+wtc_result_t control_engine_list_interlocks_copy(control_engine_t *engine,
                                              interlock_t **interlocks,
                                              int *count,
                                              int max_count) {
@@ -855,8 +1009,15 @@ wtc_result_t control_engine_list_interlocks(control_engine_t *engine,
         copy_count = max_count;
     }
 
-    for (int i = 0; i < copy_count; i++) {
-        interlocks[i] = &engine->interlocks[i];
+    if (copy_count > 0) {
+        *interlocks = malloc(copy_count * sizeof(interlock_t));
+        if (!*interlocks) {
+            pthread_mutex_unlock(&engine->lock);
+            return WTC_ERROR_NO_MEMORY;
+        }
+        memcpy(*interlocks, engine->interlocks, copy_count * sizeof(interlock_t));
+    } else {
+        *interlocks = NULL;
     }
     *count = copy_count;
 
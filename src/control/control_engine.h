@@ -8,6 +8,7 @@
 #define WTC_CONTROL_ENGINE_H
 
 #include "types.h"
+#include "utils/arena.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -53,6 +54,12 @@ struct rtu_registry;
 wtc_result_t control_engine_set_registry(control_engine_t *engine,
                                           struct rtu_registry *registry);
 
+/* Set latency tracer (NULL = off). Each loop records the input and
+ * compute stages and tags its outputs with the input's receive time. */
+struct latency_trace;
+wtc_result_t control_engine_set_latency_trace(control_engine_t *engine,
+                                               struct latency_trace *trace);
+
 /* ============== PID Loops ============== */
 
 /* Add PID loop */
@@ -64,11 +71,22 @@ wtc_result_t control_engine_add_pid_loop(control_engine_t *engine,
 wtc_result_t control_engine_remove_pid_loop(control_engine_t *engine,
                                              int loop_id);
 
+/* Replace the configuration of an existing loop (tuning, limits,
+ * setpoint, mode, I/O), keeping its runtime state */
+wtc_result_t control_engine_update_pid_loop(control_engine_t *engine,
+                                             int loop_id,
+                                             const pid_loop_t *config);
+
 /* Get PID loop */
 wtc_result_t control_engine_get_pid_loop(control_engine_t *engine,
                                           int loop_id,
                                           pid_loop_t *loop);
 
+/* Restore setpoint, mode and runtime state (integrator, last error, ...)
+ * of an existing loop, e.g. as replicated from a primary controller */
+wtc_result_t control_engine_restore_pid_state(control_engine_t *engine,
+                                               const pid_loop_t *state);
+
 /* Set PID setpoint */
 wtc_result_t control_engine_set_setpoint(control_engine_t *engine,
                                           int loop_id,
@@ -89,12 +107,19 @@ wtc_result_t control_engine_get_pid_output(control_engine_t *engine,
                                             int loop_id,
                                             float *output);
 
-/* List all PID loops */
-wtc_result_t control_engine_list_pid_loops(control_engine_t *engine,
+/* List all PID loops (copy - caller must free) */
+wtc_result_t control_engine_list_pid_loops_copy(control_engine_t *engine,
                                             pid_loop_t **loops,
                                             int *count,
                                             int max_count);
 
+/* List all PID loops, copied into the arena */
+wtc_result_t control_engine_list_pid_loops_arena(control_engine_t *engine,
+                                                  arena_t *arena,
+                                                  pid_loop_t **loops,
+                                                  int *count,
+                                                  int max_count);
+
 /* ============== Interlocks ============== */
 
 /* Add interlock */
@@ -120,8 +145,8 @@ wtc_result_t control_engine_enable_interlock(control_engine_t *engine,
 wtc_result_t control_engine_reset_interlock(control_engine_t *engine,
                                              int interlock_id);
 
-/* List all interlocks */
-wtc_result_t control_engine_list_interlocks(control_engine_t *engine,
+/* List all interlocks (copy - caller must free) */
+wtc_result_t control_engine_list_interlocks_copy(control_engine_t *engine,
                                              interlock_t **interlocks,
                                              int *count,
                                              int max_count);
@@ -153,6 +178,8 @@ typedef struct {
     uint64_t scan_time_us_min;
     uint64_t scan_time_us_max;
     uint64_t scan_time_us_avg;
+    uint64_t scan_time_us_total;    /* Sum over total_scans */
+    uint64_t scan_overruns;         /* Scans longer than the scan rate */
     int active_pid_loops;
     int active_interlocks;
     int tripped_interlocks;
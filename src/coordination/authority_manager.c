@@ -14,18 +14,21 @@
 
 /* Maximum tracked RTUs */
 #define MAX_AUTHORITY_ENTRIES 256
+#define STATION_INDEX_SIZE    512   /* Power of two, twice MAX_AUTHORITY_ENTRIES */
 
 /* Default configuration values */
 #define DEFAULT_HANDOFF_TIMEOUT_MS     5000
 #define DEFAULT_STALE_COMMAND_MS       10000
 #define DEFAULT_HEARTBEAT_INTERVAL_MS  1000
 
-/* Authority entry for a single RTU */
+/* Authority entry for a single RTU. Entries are never removed, so an
+ * entry's index is a stable handle. */
 typedef struct {
     char station_name[WTC_MAX_STATION_NAME];
     authority_context_t context;
+    uint64_t gate;              /* epoch << 32 | supervised; read without the lock */
     uint64_t last_heartbeat_ms;
-    bool in_use;
+    int held_pos;               /* Position in held[], -1 when not SUPERVISED */
 } authority_entry_t;
 
 /* Authority manager structure */
@@ -34,50 +37,113 @@ struct authority_manager {
     authority_entry_t entries[MAX_AUTHORITY_ENTRIES];
     int entry_count;
 
+    /* Station name -> entry index + 1 (0 = empty). Slots are published
+     * with release stores so lookups do not need the lock. */
+    int station_index[STATION_INDEX_SIZE];
+
+    /* Entries under controller authority, heartbeated together */
+    int held[MAX_AUTHORITY_ENTRIES];
+    int held_count;
+    int transitioning;          /* Entries in HANDOFF_PENDING or RELEASING */
+    uint64_t next_heartbeat_ms;
+    authority_heartbeat_t *heartbeat_batch;
+
     authority_callback_t callback;
     void *callback_ctx;
+    authority_heartbeat_fn heartbeat_fn;
+    void *heartbeat_ctx;
 
     pthread_mutex_t lock;
 };
 
-/* Find or create authority entry for RTU */
-static authority_entry_t *find_or_create_entry(authority_manager_t *manager,
-                                                 const char *station_name) {
-    /* First, look for existing entry */
-    for (int i = 0; i < MAX_AUTHORITY_ENTRIES; i++) {
-        if (manager->entries[i].in_use &&
-            strcmp(manager->entries[i].station_name, station_name) == 0) {
-            return &manager->entries[i];
-        }
+static uint32_t hash_station(const char *name) {
+    uint32_t h = 2166136261u;
+    for (const char *p = name; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
     }
+    return h;
+}
 
-    /* Create new entry */
-    for (int i = 0; i < MAX_AUTHORITY_ENTRIES; i++) {
-        if (!manager->entries[i].in_use) {
-            authority_entry_t *entry = &manager->entries[i];
-            memset(entry, 0, sizeof(*entry));
-            strncpy(entry->station_name, station_name,
-                    sizeof(entry->station_name) - 1);
-            authority_context_init(&entry->context);
-            entry->in_use = true;
-            manager->entry_count++;
-            return entry;
+/* Find entry index for RTU, or -1; safe without the lock */
+static int find_index(authority_manager_t *manager, const char *station_name) {
+    uint32_t i = hash_station(station_name) & (STATION_INDEX_SIZE - 1);
+    int slot;
+    while ((slot = __atomic_load_n(&manager->station_index[i], __ATOMIC_ACQUIRE)) != 0) {
+        if (strcmp(manager->entries[slot - 1].station_name, station_name) == 0) {
+            return slot - 1;
         }
+        i = (i + 1) & (STATION_INDEX_SIZE - 1);
     }
-
-    return NULL;
+    return -1;
 }
 
 /* Find authority entry for RTU */
 static authority_entry_t *find_entry(authority_manager_t *manager,
                                       const char *station_name) {
-    for (int i = 0; i < MAX_AUTHORITY_ENTRIES; i++) {
-        if (manager->entries[i].in_use &&
-            strcmp(manager->entries[i].station_name, station_name) == 0) {
-            return &manager->entries[i];
-        }
+    int index = find_index(manager, station_name);
+    return index >= 0 ? &manager->entries[index] : NULL;
+}
+
+/* Find or create authority entry for RTU; lock held */
+static authority_entry_t *find_or_create_entry(authority_manager_t *manager,
+                                                 const char *station_name) {
+    authority_entry_t *entry = find_entry(manager, station_name);
+    if (entry) {
+        return entry;
     }
-    return NULL;
+
+    if (manager->entry_count >= MAX_AUTHORITY_ENTRIES) {
+        return NULL;
+    }
+
+    int index = manager->entry_count;
+    entry = &manager->entries[index];
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->station_name, station_name, sizeof(entry->station_name) - 1);
+    authority_context_init(&entry->context);
+    entry->held_pos = -1;
+    entry->gate = (uint64_t)entry->context.epoch << 32;
+    __atomic_store_n(&manager->entry_count, index + 1, __ATOMIC_RELEASE);
+
+    uint32_t i = hash_station(station_name) & (STATION_INDEX_SIZE - 1);
+    while (manager->station_index[i] != 0) {
+        i = (i + 1) & (STATION_INDEX_SIZE - 1);
+    }
+    __atomic_store_n(&manager->station_index[i], index + 1, __ATOMIC_RELEASE);
+
+    return entry;
+}
+
+static bool is_transitioning(authority_state_t state) {
+    return state == AUTHORITY_HANDOFF_PENDING || state == AUTHORITY_RELEASING;
+}
+
+/* Publish an entry's state and epoch after changing them; lock held.
+ * Keeps the held set, the transition count and the lock-free gate in
+ * step with the context. */
+static void commit_entry(authority_manager_t *manager, authority_entry_t *entry,
+                         authority_state_t old_state) {
+    authority_state_t state = entry->context.state;
+
+    if (is_transitioning(old_state) != is_transitioning(state)) {
+        manager->transitioning += is_transitioning(state) ? 1 : -1;
+    }
+
+    bool held = state == AUTHORITY_SUPERVISED;
+    if (held && entry->held_pos < 0) {
+        entry->held_pos = manager->held_count;
+        manager->held[manager->held_count++] = (int)(entry - manager->entries);
+        entry->last_heartbeat_ms = 0;
+    } else if (!held && entry->held_pos >= 0) {
+        int last = manager->held[--manager->held_count];
+        manager->held[entry->held_pos] = last;
+        manager->entries[last].held_pos = entry->held_pos;
+        entry->held_pos = -1;
+    }
+
+    __atomic_store_n(&entry->gate,
+                     ((uint64_t)entry->context.epoch << 32) | (held ? 1u : 0u),
+                     __ATOMIC_RELEASE);
 }
 
 /* Notify callback of state change */
@@ -103,6 +169,12 @@ wtc_result_t authority_manager_init(authority_manager_t **manager,
         return WTC_ERROR_NO_MEMORY;
     }
 
+    mgr->heartbeat_batch = calloc(MAX_AUTHORITY_ENTRIES, sizeof(authority_heartbeat_t));
+    if (!mgr->heartbeat_batch) {
+        free(mgr);
+        return WTC_ERROR_NO_MEMORY;
+    }
+
     if (config) {
         mgr->config = *config;
     } else {
@@ -125,6 +197,7 @@ void authority_manager_cleanup(authority_manager_t *manager) {
     if (!manager) return;
 
     pthread_mutex_destroy(&manager->lock);
+    free(manager->heartbeat_batch);
     free(manager);
     LOG_DEBUG("Authority manager cleaned up");
 }
@@ -140,6 +213,34 @@ void authority_manager_set_callback(authority_manager_t *manager,
     pthread_mutex_unlock(&manager->lock);
 }
 
+void authority_manager_set_heartbeat_sender(authority_manager_t *manager,
+                                            authority_heartbeat_fn fn,
+                                            void *ctx) {
+    if (!manager) return;
+
+    pthread_mutex_lock(&manager->lock);
+    manager->heartbeat_fn = fn;
+    manager->heartbeat_ctx = ctx;
+    pthread_mutex_unlock(&manager->lock);
+}
+
+int authority_get_handle(authority_manager_t *manager, const char *station_name) {
+    if (!manager || !station_name) {
+        return -1;
+    }
+
+    int handle = find_index(manager, station_name);
+    if (handle >= 0) {
+        return handle;
+    }
+
+    pthread_mutex_lock(&manager->lock);
+    authority_entry_t *entry = find_or_create_entry(manager, station_name);
+    handle = entry ? (int)(entry - manager->entries) : -1;
+    pthread_mutex_unlock(&manager->lock);
+    return handle;
+}
+
 wtc_result_t authority_request(authority_manager_t *manager,
                                 const char *station_name,
                                 authority_context_t *ctx) {
@@ -184,6 +285,7 @@ wtc_result_t authority_request(authority_manager_t *manager,
 
     if (ctx) *ctx = entry->context;
 
+    commit_entry(manager, entry, old_state);
     notify_state_change(manager, station_name, old_state, entry->context.state);
 
     pthread_mutex_unlock(&manager->lock);
@@ -223,6 +325,7 @@ wtc_result_t authority_release(authority_manager_t *manager,
 
     if (ctx) *ctx = entry->context;
 
+    commit_entry(manager, entry, old_state);
     notify_state_change(manager, station_name, old_state, entry->context.state);
 
     pthread_mutex_unlock(&manager->lock);
@@ -268,6 +371,7 @@ wtc_result_t authority_handle_grant(authority_manager_t *manager,
 
     if (ctx) *ctx = entry->context;
 
+    commit_entry(manager, entry, old_state);
     notify_state_change(manager, station_name, old_state, entry->context.state);
 
     pthread_mutex_unlock(&manager->lock);
@@ -303,12 +407,36 @@ wtc_result_t authority_handle_released(authority_manager_t *manager,
 
     if (ctx) *ctx = entry->context;
 
+    commit_entry(manager, entry, old_state);
     notify_state_change(manager, station_name, old_state, entry->context.state);
 
     pthread_mutex_unlock(&manager->lock);
     return WTC_OK;
 }
 
+/* Lock-free check against an entry's published gate */
+static wtc_result_t validate_gate(authority_manager_t *manager, int handle,
+                                  uint32_t command_epoch) {
+    uint64_t gate = __atomic_load_n(&manager->entries[handle].gate, __ATOMIC_ACQUIRE);
+    uint32_t epoch = (uint32_t)(gate >> 32);
+
+    /* Check if we have authority */
+    if (!(gate & 1u)) {
+        LOG_WARN("Command rejected for %s: no authority",
+                 manager->entries[handle].station_name);
+        return WTC_ERROR_PERMISSION;
+    }
+
+    /* Check epoch - reject commands from old epochs */
+    if (command_epoch != 0 && command_epoch < epoch) {
+        LOG_WARN("Command rejected for %s: stale epoch (%u < %u)",
+                 manager->entries[handle].station_name, command_epoch, epoch);
+        return WTC_ERROR_PERMISSION;
+    }
+
+    return WTC_OK;
+}
+
 wtc_result_t authority_validate_command(authority_manager_t *manager,
                                          const char *station_name,
                                          uint32_t command_epoch,
@@ -319,32 +447,21 @@ wtc_result_t authority_validate_command(authority_manager_t *manager,
         return WTC_ERROR_INVALID_PARAM;
     }
 
-    pthread_mutex_lock(&manager->lock);
-
-    authority_entry_t *entry = find_entry(manager, station_name);
-    if (!entry) {
-        pthread_mutex_unlock(&manager->lock);
+    int handle = find_index(manager, station_name);
+    if (handle < 0) {
         return WTC_ERROR_NOT_FOUND;
     }
+    return validate_gate(manager, handle, command_epoch);
+}
 
-    /* Check if we have authority */
-    if (entry->context.state != AUTHORITY_SUPERVISED) {
-        LOG_WARN("Command rejected for %s: no authority (state=%d)",
-                 station_name, entry->context.state);
-        pthread_mutex_unlock(&manager->lock);
-        return WTC_ERROR_PERMISSION;
-    }
-
-    /* Check epoch - reject commands from old epochs */
-    if (command_epoch != 0 && command_epoch < entry->context.epoch) {
-        LOG_WARN("Command rejected for %s: stale epoch (%u < %u)",
-                 station_name, command_epoch, entry->context.epoch);
-        pthread_mutex_unlock(&manager->lock);
-        return WTC_ERROR_PERMISSION;
+wtc_result_t authority_validate_handle(authority_manager_t *manager,
+                                        int handle,
+                                        uint32_t command_epoch) {
+    if (!manager || handle < 0 ||
+        handle >= __atomic_load_n(&manager->entry_count, __ATOMIC_ACQUIRE)) {
+        return WTC_ERROR_INVALID_PARAM;
     }
-
-    pthread_mutex_unlock(&manager->lock);
-    return WTC_OK;
+    return validate_gate(manager, handle, command_epoch);
 }
 
 authority_state_t authority_get_state(authority_manager_t *manager,
@@ -377,6 +494,37 @@ uint32_t authority_get_epoch(authority_manager_t *manager,
     return epoch;
 }
 
+/* Time out handoffs and releases the RTU never answered; lock held */
+static void process_timeouts(authority_manager_t *manager, uint64_t now_ms) {
+    for (int i = 0; i < manager->entry_count && manager->transitioning > 0; i++) {
+        authority_entry_t *entry = &manager->entries[i];
+        if (!is_transitioning(entry->context.state)) continue;
+
+        uint64_t elapsed = now_ms - entry->context.request_time_ms;
+        if (elapsed <= manager->config.handoff_timeout_ms) continue;
+
+        authority_state_t old_state = entry->context.state;
+
+        /* Check for handoff timeout */
+        if (old_state == AUTHORITY_HANDOFF_PENDING) {
+            LOG_WARN("Authority handoff timeout for %s after %lums",
+                     entry->station_name, (unsigned long)elapsed);
+            entry->context.state = AUTHORITY_AUTONOMOUS;
+            entry->context.controller_online = false;
+        } else {
+            /* Release timeout */
+            LOG_WARN("Authority release timeout for %s, forcing release",
+                     entry->station_name);
+            entry->context.state = AUTHORITY_AUTONOMOUS;
+            entry->context.epoch++;
+        }
+
+        commit_entry(manager, entry, old_state);
+        notify_state_change(manager, entry->station_name,
+                           old_state, entry->context.state);
+    }
+}
+
 wtc_result_t authority_manager_process(authority_manager_t *manager,
                                         uint64_t now_ms) {
     if (!manager) {
@@ -385,41 +533,27 @@ wtc_result_t authority_manager_process(authority_manager_t *manager,
 
     pthread_mutex_lock(&manager->lock);
 
-    for (int i = 0; i < MAX_AUTHORITY_ENTRIES; i++) {
-        authority_entry_t *entry = &manager->entries[i];
-        if (!entry->in_use) continue;
+    if (manager->transitioning > 0) {
+        process_timeouts(manager, now_ms);
+    }
 
-        /* Check for handoff timeout */
-        if (entry->context.state == AUTHORITY_HANDOFF_PENDING) {
-            uint64_t elapsed = now_ms - entry->context.request_time_ms;
-            if (elapsed > manager->config.handoff_timeout_ms) {
-                LOG_WARN("Authority handoff timeout for %s after %lums",
-                         entry->station_name, (unsigned long)elapsed);
-
-                authority_state_t old_state = entry->context.state;
-                entry->context.state = AUTHORITY_AUTONOMOUS;
-                entry->context.controller_online = false;
-
-                notify_state_change(manager, entry->station_name,
-                                   old_state, entry->context.state);
-            }
+    /* One heartbeat batch per interval for every RTU we hold */
+    int count = 0;
+    if (now_ms >= manager->next_heartbeat_ms) {
+        manager->next_heartbeat_ms = now_ms + manager->config.heartbeat_interval_ms;
+        for (int i = 0; i < manager->held_count; i++) {
+            authority_entry_t *entry = &manager->entries[manager->held[i]];
+            memcpy(manager->heartbeat_batch[count].station_name, entry->station_name,
+                   WTC_MAX_STATION_NAME);
+            manager->heartbeat_batch[count].epoch = entry->context.epoch;
+            entry->last_heartbeat_ms = now_ms;
+            count++;
         }
+    }
 
-        /* Check for release timeout */
-        if (entry->context.state == AUTHORITY_RELEASING) {
-            uint64_t elapsed = now_ms - entry->context.request_time_ms;
-            if (elapsed > manager->config.handoff_timeout_ms) {
-                LOG_WARN("Authority release timeout for %s, forcing release",
-                         entry->station_name);
-
-                authority_state_t old_state = entry->context.state;
-                entry->context.state = AUTHORITY_AUTONOMOUS;
-                entry->context.epoch++;
-
-                notify_state_change(manager, entry->station_name,
-                                   old_state, entry->context.state);
-            }
-        }
+    /* Sent under the lock so the batch matches the current epochs */
+    if (count > 0 && manager->heartbeat_fn) {
+        manager->heartbeat_fn(manager->heartbeat_batch, count, manager->heartbeat_ctx);
     }
 
     pthread_mutex_unlock(&manager->lock);
@@ -452,6 +586,7 @@ wtc_result_t authority_force_release(authority_manager_t *manager,
     LOG_WARN("Forced authority release for %s (new epoch=%u)",
              station_name, entry->context.epoch);
 
+    commit_entry(manager, entry, old_state);
     notify_state_change(manager, station_name, old_state, entry->context.state);
 
     pthread_mutex_unlock(&manager->lock);
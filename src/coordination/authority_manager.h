@@ -6,6 +6,12 @@
  *
  * This module prevents split-brain scenarios by ensuring only one entity
  * (either Controller or RTU) has control authority at any given time.
+ *
+ * RTUs are kept in a dense table; authority_get_handle() resolves a
+ * station once and the handle stays valid for the manager's lifetime.
+ * Command validation reads a published epoch/state word without taking
+ * the lock, and heartbeats for every held RTU go out as one batch per
+ * heartbeat interval.
  */
 
 #ifndef WTC_AUTHORITY_MANAGER_H
@@ -34,6 +40,18 @@ typedef void (*authority_callback_t)(const char *station_name,
                                       authority_state_t new_state,
                                       void *ctx);
 
+/* One entry of a heartbeat batch */
+typedef struct {
+    char station_name[WTC_MAX_STATION_NAME];
+    uint32_t epoch;
+} authority_heartbeat_t;
+
+/* Sends a heartbeat batch; called from authority_manager_process() with
+ * the manager lock held, so it must not call back into the manager */
+typedef void (*authority_heartbeat_fn)(const authority_heartbeat_t *batch,
+                                       int count,
+                                       void *ctx);
+
 /* Initialize authority manager */
 wtc_result_t authority_manager_init(authority_manager_t **manager,
                                      const authority_manager_config_t *config);
@@ -46,6 +64,15 @@ void authority_manager_set_callback(authority_manager_t *manager,
                                      authority_callback_t callback,
                                      void *ctx);
 
+/* Set the heartbeat sender */
+void authority_manager_set_heartbeat_sender(authority_manager_t *manager,
+                                            authority_heartbeat_fn fn,
+                                            void *ctx);
+
+/* Resolve an RTU to its handle, adding it if needed. Returns -1 when
+ * the table is full. */
+int authority_get_handle(authority_manager_t *manager, const char *station_name);
+
 /* Request authority over an RTU (Controller -> RTU)
  * Initiates the handoff protocol:
  * 1. Controller sends AUTHORITY_REQUEST
@@ -88,6 +115,11 @@ wtc_result_t authority_validate_command(authority_manager_t *manager,
                                          uint32_t command_epoch,
                                          const authority_context_t *ctx);
 
+/* authority_validate_command() by handle; lock-free */
+wtc_result_t authority_validate_handle(authority_manager_t *manager,
+                                        int handle,
+                                        uint32_t command_epoch);
+
 /* Get current authority state for an RTU */
 authority_state_t authority_get_state(authority_manager_t *manager,
                                        const char *station_name);
@@ -96,7 +128,8 @@ authority_state_t authority_get_state(authority_manager_t *manager,
 uint32_t authority_get_epoch(authority_manager_t *manager,
                               const char *station_name);
 
-/* Process authority timeouts and heartbeats (call from main loop) */
+/* Process authority timeouts and heartbeats (call from main loop).
+ * Sends one heartbeat batch per heartbeat_interval_ms. */
 wtc_result_t authority_manager_process(authority_manager_t *manager,
                                         uint64_t now_ms);
 
@@ -2,17 +2,27 @@
  * Water Treatment Controller - Failover Management Implementation
  * Copyright (C) 2024
  * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * RTU health is event driven: connection state changes and AR watchdog
+ * misses update a station-indexed table and schedule a per-RTU
+ * evaluation. The main loop only pops due entries, so an idle plant
+ * costs a heap peek per pass regardless of RTU count.
  */
 
 #include "failover.h"
 #include "rtu_registry.h"
+#include "sample_scheduler.h"
 #include "logger.h"
 #include "time_utils.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define LOG_TAG "FAILOVER"
 #define MAX_MONITORED_RTUS 256
+#define STATION_INDEX_SIZE 512      /* Power of two, twice MAX_MONITORED_RTUS */
+#define DEFAULT_WATCHDOG_MISSES 2   /* The AR itself aborts at 3 */
+#define HEALTH_DUE_BATCH 32
 
 /* Backup mapping */
 typedef struct {
@@ -21,6 +31,15 @@ typedef struct {
     bool active;  /* Is failover currently active */
 } backup_mapping_t;
 
+/* Health tracking for one RTU */
+typedef struct {
+    rtu_health_t info;
+    profinet_state_t state;
+    bool watchdog_expired;
+    uint64_t down_since_ms;         /* Left RUNNING at; 0 while running */
+    uint64_t deadline_ms;           /* Pending evaluation; 0 = none */
+} health_entry_t;
+
 /* Failover manager structure */
 struct failover_manager {
     failover_config_t config;
@@ -28,8 +47,11 @@ struct failover_manager {
 
     struct rtu_registry *registry;
 
-    rtu_health_t *health;
+    health_entry_t *health;
     int health_count;
+    int station_index[STATION_INDEX_SIZE];
+
+    sample_scheduler_t *scheduler;  /* Keyed by health entry index */
 
     backup_mapping_t *backups;
     int backup_count;
@@ -38,6 +60,7 @@ struct failover_manager {
     failover_callback_t callback;
     void *callback_ctx;
 
+    pthread_mutex_t lock;
     uint64_t last_process_ms;
 };
 
@@ -51,17 +74,25 @@ wtc_result_t failover_init(failover_manager_t **mgr, const failover_config_t *co
     }
 
     memcpy(&fm->config, config, sizeof(failover_config_t));
+    if (fm->config.watchdog_misses <= 0) {
+        fm->config.watchdog_misses = DEFAULT_WATCHDOG_MISSES;
+    }
 
-    fm->health = calloc(MAX_MONITORED_RTUS, sizeof(rtu_health_t));
+    fm->health = calloc(MAX_MONITORED_RTUS, sizeof(health_entry_t));
     fm->backups = calloc(MAX_MONITORED_RTUS, sizeof(backup_mapping_t));
 
-    if (!fm->health || !fm->backups) {
+    if (!fm->health || !fm->backups ||
+        sample_scheduler_init(&fm->scheduler, MAX_MONITORED_RTUS) != WTC_OK) {
         free(fm->health);
         free(fm->backups);
         free(fm);
         return WTC_ERROR_NO_MEMORY;
     }
 
+    for (int i = 0; i < STATION_INDEX_SIZE; i++) {
+        fm->station_index[i] = -1;
+    }
+    pthread_mutex_init(&fm->lock, NULL);
     fm->running = false;
 
     LOG_INFO(LOG_TAG, "Failover manager initialized (mode: %d, timeout: %ums)",
@@ -73,17 +104,116 @@ wtc_result_t failover_init(failover_manager_t **mgr, const failover_config_t *co
 /* Cleanup failover manager */
 void failover_cleanup(failover_manager_t *mgr) {
     if (!mgr) return;
+    pthread_mutex_destroy(&mgr->lock);
     free(mgr->health);
     free(mgr->backups);
+    sample_scheduler_cleanup(mgr->scheduler);
     free(mgr);
     LOG_INFO(LOG_TAG, "Failover manager cleaned up");
 }
 
+/* ============== Health Table ============== */
+
+static uint32_t hash_station(const char *name) {
+    uint32_t h = 2166136261u;
+    for (const char *p = name; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    return h;
+}
+
+/* Find health entry; returns its index or -1 */
+static int find_health(failover_manager_t *mgr, const char *station_name) {
+    uint32_t i = hash_station(station_name) & (STATION_INDEX_SIZE - 1);
+    while (mgr->station_index[i] >= 0) {
+        int index = mgr->station_index[i];
+        if (strcmp(mgr->health[index].info.station_name, station_name) == 0) {
+            return index;
+        }
+        i = (i + 1) & (STATION_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+/* Find or create health entry */
+static health_entry_t *get_health_entry(failover_manager_t *mgr, const char *station_name) {
+    /* Find existing */
+    int index = find_health(mgr, station_name);
+    if (index >= 0) {
+        return &mgr->health[index];
+    }
+
+    /* Create new */
+    if (mgr->health_count >= MAX_MONITORED_RTUS) {
+        return NULL;
+    }
+
+    index = mgr->health_count++;
+    health_entry_t *e = &mgr->health[index];
+    memset(e, 0, sizeof(health_entry_t));
+    snprintf(e->info.station_name, sizeof(e->info.station_name), "%s", station_name);
+    e->info.healthy = true;
+    e->info.last_heartbeat_ms = time_get_ms();
+    e->state = PROFINET_STATE_OFFLINE;
+    e->down_since_ms = e->info.last_heartbeat_ms;
+
+    uint32_t i = hash_station(station_name) & (STATION_INDEX_SIZE - 1);
+    while (mgr->station_index[i] >= 0) {
+        i = (i + 1) & (STATION_INDEX_SIZE - 1);
+    }
+    mgr->station_index[i] = index;
+
+    return e;
+}
+
+/* ============== Health Schedule ============== */
+
+/* Evaluate an entry at deadline_ms; an earlier pending evaluation wins */
+static void schedule_health(failover_manager_t *mgr, health_entry_t *e, uint64_t deadline_ms) {
+    if (e->deadline_ms != 0 && e->deadline_ms <= deadline_ms) return;
+    if (sample_scheduler_set(mgr->scheduler, (int)(e - mgr->health), deadline_ms) != WTC_OK) {
+        LOG_ERROR(LOG_TAG, "Failed to schedule health check for %s", e->info.station_name);
+        return;
+    }
+    e->deadline_ms = deadline_ms;
+}
+
+/* ============== Lifecycle ============== */
+
 /* Start failover manager */
 wtc_result_t failover_start(failover_manager_t *mgr) {
     if (!mgr) return WTC_ERROR_INVALID_PARAM;
+
+    uint64_t now = time_get_ms();
+
+    pthread_mutex_lock(&mgr->lock);
+
+    /* Seed the table once; events keep it current from here on */
+    if (mgr->registry) {
+        rtu_device_t *devices = NULL;
+        int count = 0;
+
+        if (rtu_registry_list_devices(mgr->registry, &devices, &count,
+                                       MAX_MONITORED_RTUS) == WTC_OK && devices) {
+            for (int i = 0; i < count; i++) {
+                health_entry_t *e = get_health_entry(mgr, devices[i].station_name);
+                if (!e) continue;
+                e->state = devices[i].connection_state;
+                e->down_since_ms = e->state == PROFINET_STATE_RUNNING ? 0 : now;
+                e->info.packet_loss = devices[i].packet_loss_percent;
+            }
+            rtu_registry_free_device_list(devices, count);
+        }
+    }
+
+    for (int i = 0; i < mgr->health_count; i++) {
+        schedule_health(mgr, &mgr->health[i], now);
+    }
+
     mgr->running = true;
-    mgr->last_process_ms = time_get_ms();
+    mgr->last_process_ms = now;
+    pthread_mutex_unlock(&mgr->lock);
+
     LOG_INFO(LOG_TAG, "Failover manager started");
     return WTC_OK;
 }
@@ -103,28 +233,7 @@ wtc_result_t failover_set_registry(failover_manager_t *mgr, struct rtu_registry
     return WTC_OK;
 }
 
-/* Find or create health entry */
-static rtu_health_t *get_health_entry(failover_manager_t *mgr, const char *station_name) {
-    /* Find existing */
-    for (int i = 0; i < mgr->health_count; i++) {
-        if (strcmp(mgr->health[i].station_name, station_name) == 0) {
-            return &mgr->health[i];
-        }
-    }
-
-    /* Create new */
-    if (mgr->health_count >= MAX_MONITORED_RTUS) {
-        return NULL;
-    }
-
-    rtu_health_t *h = &mgr->health[mgr->health_count++];
-    memset(h, 0, sizeof(rtu_health_t));
-    snprintf(h->station_name, sizeof(h->station_name), "%s", station_name);
-    h->healthy = true;
-    h->last_heartbeat_ms = time_get_ms();
-
-    return h;
-}
+/* ============== Backups ============== */
 
 /* Configure backup for an RTU */
 wtc_result_t failover_set_backup(failover_manager_t *mgr,
@@ -134,10 +243,13 @@ wtc_result_t failover_set_backup(failover_manager_t *mgr,
         return WTC_ERROR_INVALID_PARAM;
     }
 
+    pthread_mutex_lock(&mgr->lock);
+
     /* Check for existing */
     for (int i = 0; i < mgr->backup_count; i++) {
         if (strcmp(mgr->backups[i].primary, primary_station) == 0) {
             snprintf(mgr->backups[i].backup, sizeof(mgr->backups[i].backup), "%s", backup_station);
+            pthread_mutex_unlock(&mgr->lock);
             LOG_INFO(LOG_TAG, "Updated backup for %s -> %s",
                      primary_station, backup_station);
             return WTC_OK;
@@ -145,6 +257,7 @@ wtc_result_t failover_set_backup(failover_manager_t *mgr,
     }
 
     if (mgr->backup_count >= MAX_MONITORED_RTUS) {
+        pthread_mutex_unlock(&mgr->lock);
         return WTC_ERROR_FULL;
     }
 
@@ -153,6 +266,14 @@ wtc_result_t failover_set_backup(failover_manager_t *mgr,
     snprintf(b->backup, sizeof(b->backup), "%s", backup_station);
     b->active = false;
 
+    /* A primary that is already down fails over on the next pass */
+    health_entry_t *e = get_health_entry(mgr, primary_station);
+    if (e && !e->info.healthy) {
+        schedule_health(mgr, e, time_get_ms());
+    }
+
+    pthread_mutex_unlock(&mgr->lock);
+
     LOG_INFO(LOG_TAG, "Configured backup for %s -> %s", primary_station, backup_station);
     return WTC_OK;
 }
@@ -162,16 +283,20 @@ wtc_result_t failover_remove_backup(failover_manager_t *mgr,
                                      const char *primary_station) {
     if (!mgr || !primary_station) return WTC_ERROR_INVALID_PARAM;
 
+    pthread_mutex_lock(&mgr->lock);
+
     for (int i = 0; i < mgr->backup_count; i++) {
         if (strcmp(mgr->backups[i].primary, primary_station) == 0) {
             memmove(&mgr->backups[i], &mgr->backups[i + 1],
                     (mgr->backup_count - i - 1) * sizeof(backup_mapping_t));
             mgr->backup_count--;
+            pthread_mutex_unlock(&mgr->lock);
             LOG_INFO(LOG_TAG, "Removed backup for %s", primary_station);
             return WTC_OK;
         }
     }
 
+    pthread_mutex_unlock(&mgr->lock);
     return WTC_ERROR_NOT_FOUND;
 }
 
@@ -181,24 +306,44 @@ wtc_result_t failover_get_health(failover_manager_t *mgr,
                                   rtu_health_t *health) {
     if (!mgr || !station_name || !health) return WTC_ERROR_INVALID_PARAM;
 
-    for (int i = 0; i < mgr->health_count; i++) {
-        if (strcmp(mgr->health[i].station_name, station_name) == 0) {
-            memcpy(health, &mgr->health[i], sizeof(rtu_health_t));
-            return WTC_OK;
-        }
+    pthread_mutex_lock(&mgr->lock);
+    int index = find_health(mgr, station_name);
+    if (index >= 0) {
+        memcpy(health, &mgr->health[index].info, sizeof(rtu_health_t));
     }
+    pthread_mutex_unlock(&mgr->lock);
 
-    return WTC_ERROR_NOT_FOUND;
+    return index >= 0 ? WTC_OK : WTC_ERROR_NOT_FOUND;
 }
 
 /* Get overall failover status */
 wtc_result_t failover_get_status(failover_manager_t *mgr, failover_status_t *status) {
     if (!mgr || !status) return WTC_ERROR_INVALID_PARAM;
+
+    pthread_mutex_lock(&mgr->lock);
     memcpy(status, &mgr->status, sizeof(failover_status_t));
+    status->healthy_count = 0;
+    status->failed_count = 0;
+    status->in_failover_count = 0;
+    for (int i = 0; i < mgr->health_count; i++) {
+        const rtu_health_t *h = &mgr->health[i].info;
+        if (h->healthy) {
+            status->healthy_count++;
+        } else {
+            status->failed_count++;
+        }
+        if (h->in_failover) {
+            status->in_failover_count++;
+        }
+    }
+    pthread_mutex_unlock(&mgr->lock);
+
     return WTC_OK;
 }
 
-/* Execute failover */
+/* ============== Failover Actions ============== */
+
+/* Execute failover; lock held */
 static void execute_failover(failover_manager_t *mgr, backup_mapping_t *mapping) {
     if (mapping->active) return;
 
@@ -210,10 +355,10 @@ static void execute_failover(failover_manager_t *mgr, backup_mapping_t *mapping)
     snprintf(mgr->status.last_failed_station, WTC_MAX_STATION_NAME, "%s", mapping->primary);
 
     /* Update health entry */
-    rtu_health_t *h = get_health_entry(mgr, mapping->primary);
-    if (h) {
-        h->in_failover = true;
-        snprintf(h->backup_station, sizeof(h->backup_station), "%s", mapping->backup);
+    health_entry_t *e = get_health_entry(mgr, mapping->primary);
+    if (e) {
+        e->info.in_failover = true;
+        snprintf(e->info.backup_station, sizeof(e->info.backup_station), "%s", mapping->backup);
     }
 
     /* Notify callback */
@@ -222,10 +367,8 @@ static void execute_failover(failover_manager_t *mgr, backup_mapping_t *mapping)
     }
 }
 
-/* Restore from failover */
-wtc_result_t failover_restore(failover_manager_t *mgr, const char *station_name) {
-    if (!mgr || !station_name) return WTC_ERROR_INVALID_PARAM;
-
+/* Restore from failover; lock held */
+static wtc_result_t restore_locked(failover_manager_t *mgr, const char *station_name) {
     for (int i = 0; i < mgr->backup_count; i++) {
         if (strcmp(mgr->backups[i].primary, station_name) == 0 &&
             mgr->backups[i].active) {
@@ -234,10 +377,10 @@ wtc_result_t failover_restore(failover_manager_t *mgr, const char *station_name)
 
             mgr->backups[i].active = false;
 
-            rtu_health_t *h = get_health_entry(mgr, station_name);
-            if (h) {
-                h->in_failover = false;
-                h->backup_station[0] = '\0';
+            health_entry_t *e = get_health_entry(mgr, station_name);
+            if (e) {
+                e->info.in_failover = false;
+                e->info.backup_station[0] = '\0';
             }
 
             if (mgr->callback) {
@@ -252,100 +395,187 @@ wtc_result_t failover_restore(failover_manager_t *mgr, const char *station_name)
     return WTC_ERROR_NOT_FOUND;
 }
 
+/* Fail over a mapping if its backup can take the load; lock held */
+static void try_failover(failover_manager_t *mgr, backup_mapping_t *mapping) {
+    health_entry_t *backup = get_health_entry(mgr, mapping->backup);
+
+    if (backup && backup->info.healthy) {
+        execute_failover(mgr, mapping);
+    } else {
+        LOG_ERROR(LOG_TAG, "Cannot failover %s: backup %s not healthy",
+                  mapping->primary, mapping->backup);
+    }
+}
+
+/* Restore from failover */
+wtc_result_t failover_restore(failover_manager_t *mgr, const char *station_name) {
+    if (!mgr || !station_name) return WTC_ERROR_INVALID_PARAM;
+
+    pthread_mutex_lock(&mgr->lock);
+    wtc_result_t res = restore_locked(mgr, station_name);
+    pthread_mutex_unlock(&mgr->lock);
+    return res;
+}
+
 /* Force failover for an RTU */
 wtc_result_t failover_force(failover_manager_t *mgr, const char *station_name) {
     if (!mgr || !station_name) return WTC_ERROR_INVALID_PARAM;
 
+    pthread_mutex_lock(&mgr->lock);
+
     for (int i = 0; i < mgr->backup_count; i++) {
         if (strcmp(mgr->backups[i].primary, station_name) == 0) {
             execute_failover(mgr, &mgr->backups[i]);
+            pthread_mutex_unlock(&mgr->lock);
             return WTC_OK;
         }
     }
 
+    pthread_mutex_unlock(&mgr->lock);
     return WTC_ERROR_NOT_FOUND;
 }
 
-/* Process failover logic */
-wtc_result_t failover_process(failover_manager_t *mgr) {
-    if (!mgr || !mgr->running) return WTC_ERROR_NOT_INITIALIZED;
+/* ============== Health Evaluation ============== */
 
-    uint64_t now = time_get_ms();
+/* Re-evaluate one RTU after an event or timeout; lock held */
+static void evaluate_health(failover_manager_t *mgr, health_entry_t *e, uint64_t now) {
+    rtu_health_t *h = &e->info;
+    bool was_healthy = h->healthy;
 
-    /* Update health from registry */
     if (mgr->registry) {
-        rtu_device_t *devices = NULL;
-        int count = 0;
+        rtu_device_t *device = rtu_registry_get_device(mgr->registry, h->station_name);
+        if (device) {
+            h->packet_loss = device->packet_loss_percent;
+            rtu_registry_free_device_copy(device);
+        }
+    }
 
-        if (rtu_registry_list_devices(mgr->registry, &devices, &count,
-                                       MAX_MONITORED_RTUS) == WTC_OK && devices) {
-            mgr->status.healthy_count = 0;
-            mgr->status.failed_count = 0;
-            mgr->status.in_failover_count = 0;
+    if (e->state == PROFINET_STATE_RUNNING && !e->watchdog_expired) {
+        h->healthy = true;
+        h->last_heartbeat_ms = now;
+        h->consecutive_failures = 0;
 
-            for (int i = 0; i < count; i++) {
-                rtu_health_t *h = get_health_entry(mgr, devices[i].station_name);
-                if (!h) continue;
-
-                bool was_healthy = h->healthy;
-
-                /* Check connection state */
-                if (devices[i].connection_state == PROFINET_STATE_RUNNING) {
-                    h->healthy = true;
-                    h->last_heartbeat_ms = now;
-                    h->consecutive_failures = 0;
-                    mgr->status.healthy_count++;
-
-                    /* Auto-restore if in failover and primary is back */
-                    if (h->in_failover &&
-                        mgr->config.mode == FAILOVER_MODE_AUTO) {
-                        failover_restore(mgr, h->station_name);
-                    }
-                } else {
-                    /* Check timeout */
-                    if ((now - h->last_heartbeat_ms) >= mgr->config.timeout_ms) {
-                        h->healthy = false;
-                        h->consecutive_failures++;
-                        mgr->status.failed_count++;
-
-                        if (was_healthy) {
-                            LOG_WARN(LOG_TAG, "RTU %s health check failed",
-                                     h->station_name);
-                        }
-                    }
-                }
+        /* Auto-restore if in failover and primary is back */
+        if (h->in_failover && mgr->config.mode == FAILOVER_MODE_AUTO) {
+            restore_locked(mgr, h->station_name);
+        }
 
-                h->packet_loss = devices[i].packet_loss_percent;
+        /* Primaries waiting on this RTU as their backup can fail over now */
+        if (!was_healthy && mgr->config.mode != FAILOVER_MODE_MANUAL) {
+            for (int i = 0; i < mgr->backup_count; i++) {
+                if (mgr->backups[i].active ||
+                    strcmp(mgr->backups[i].backup, h->station_name) != 0) continue;
 
-                if (h->in_failover) {
-                    mgr->status.in_failover_count++;
+                int primary = find_health(mgr, mgr->backups[i].primary);
+                if (primary >= 0 && !mgr->health[primary].info.healthy) {
+                    execute_failover(mgr, &mgr->backups[i]);
                 }
             }
-
-            free(devices);
         }
+        return;
+    }
+
+    bool failed = e->watchdog_expired || e->state == PROFINET_STATE_ERROR ||
+                  now - e->down_since_ms >= mgr->config.timeout_ms;
+    if (!failed) {
+        schedule_health(mgr, e, e->down_since_ms + mgr->config.timeout_ms);
+        return;
+    }
+
+    if (was_healthy) {
+        h->healthy = false;
+        h->consecutive_failures++;
+        LOG_WARN(LOG_TAG, "RTU %s health check failed (%s)", h->station_name,
+                 e->watchdog_expired ? "watchdog expired" :
+                 e->state == PROFINET_STATE_ERROR ? "connection error" : "timeout");
     }
 
     /* Check for failover conditions */
     if (mgr->config.mode != FAILOVER_MODE_MANUAL) {
         for (int i = 0; i < mgr->backup_count; i++) {
-            rtu_health_t *primary = get_health_entry(mgr, mgr->backups[i].primary);
-
-            if (primary && !primary->healthy && !mgr->backups[i].active) {
-                /* Check if backup is healthy */
-                rtu_health_t *backup = get_health_entry(mgr, mgr->backups[i].backup);
-
-                if (backup && backup->healthy) {
-                    execute_failover(mgr, &mgr->backups[i]);
-                } else {
-                    LOG_ERROR(LOG_TAG, "Cannot failover %s: backup %s not healthy",
-                              mgr->backups[i].primary, mgr->backups[i].backup);
-                }
+            if (!mgr->backups[i].active &&
+                strcmp(mgr->backups[i].primary, h->station_name) == 0) {
+                try_failover(mgr, &mgr->backups[i]);
             }
         }
     }
+}
+
+/* Process failover logic */
+wtc_result_t failover_process(failover_manager_t *mgr) {
+    if (!mgr || !mgr->running) return WTC_ERROR_NOT_INITIALIZED;
 
+    uint64_t now = time_get_ms();
+    sample_slot_t due[HEALTH_DUE_BATCH];
+    int n;
+
+    pthread_mutex_lock(&mgr->lock);
+    do {
+        n = sample_scheduler_pop_due(mgr->scheduler, now, due, HEALTH_DUE_BATCH);
+        for (int i = 0; i < n; i++) {
+            health_entry_t *e = &mgr->health[due[i].key];
+            e->deadline_ms = 0;
+            evaluate_health(mgr, e, now);
+        }
+    } while (n == HEALTH_DUE_BATCH);
     mgr->last_process_ms = now;
+    pthread_mutex_unlock(&mgr->lock);
+
+    return WTC_OK;
+}
+
+wtc_result_t failover_notify_state(failover_manager_t *mgr,
+                                    const char *station_name,
+                                    profinet_state_t state) {
+    if (!mgr || !station_name) return WTC_ERROR_INVALID_PARAM;
+
+    uint64_t now = time_get_ms();
+
+    pthread_mutex_lock(&mgr->lock);
+
+    health_entry_t *e = get_health_entry(mgr, station_name);
+    if (!e) {
+        pthread_mutex_unlock(&mgr->lock);
+        return WTC_ERROR_FULL;
+    }
+
+    e->state = state;
+    if (state == PROFINET_STATE_RUNNING) {
+        e->down_since_ms = 0;
+        e->watchdog_expired = false;
+        schedule_health(mgr, e, now);
+    } else {
+        if (e->down_since_ms == 0) {
+            e->down_since_ms = now;
+        }
+        schedule_health(mgr, e, state == PROFINET_STATE_ERROR ?
+                        now : e->down_since_ms + mgr->config.timeout_ms);
+    }
+
+    pthread_mutex_unlock(&mgr->lock);
+    return WTC_OK;
+}
+
+wtc_result_t failover_notify_watchdog(failover_manager_t *mgr,
+                                       const char *station_name,
+                                       int missed_cycles) {
+    if (!mgr || !station_name) return WTC_ERROR_INVALID_PARAM;
+
+    pthread_mutex_lock(&mgr->lock);
+
+    health_entry_t *e = get_health_entry(mgr, station_name);
+    if (!e) {
+        pthread_mutex_unlock(&mgr->lock);
+        return WTC_ERROR_FULL;
+    }
+
+    bool expired = missed_cycles >= mgr->config.watchdog_misses;
+    if (e->watchdog_expired != expired) {
+        e->watchdog_expired = expired;
+        schedule_health(mgr, e, time_get_ms());
+    }
+
+    pthread_mutex_unlock(&mgr->lock);
     return WTC_OK;
 }
 
@@ -22,6 +22,8 @@ typedef struct {
     uint32_t heartbeat_interval_ms;
     uint32_t timeout_ms;
     int max_retries;
+    int watchdog_misses;        /* Consecutive AR watchdog misses that fail
+                                 * an RTU (0 = default 2) */
 } failover_config_t;
 
 /* RTU health status */
@@ -77,16 +79,33 @@ wtc_result_t failover_get_health(failover_manager_t *mgr,
 /* Get overall failover status */
 wtc_result_t failover_get_status(failover_manager_t *mgr, failover_status_t *status);
 
-/* Process failover logic */
+/* Process failover logic: evaluates RTUs whose health timers expired.
+ * Cheap when nothing changed; call from the main loop. */
 wtc_result_t failover_process(failover_manager_t *mgr);
 
+/* ============== Health Events ============== */
+
+/* RTU connection state changed (e.g. registry or AR state callback).
+ * Leaving RUNNING starts the timeout_ms grace period; ERROR fails at once. */
+wtc_result_t failover_notify_state(failover_manager_t *mgr,
+                                    const char *station_name,
+                                    profinet_state_t state);
+
+/* AR watchdog missed (missed_cycles consecutive misses) or recovered (0).
+ * Reaching watchdog_misses marks the RTU failed without waiting for
+ * timeout_ms; one late frame does not. */
+wtc_result_t failover_notify_watchdog(failover_manager_t *mgr,
+                                       const char *station_name,
+                                       int missed_cycles);
+
 /* Force failover for an RTU */
 wtc_result_t failover_force(failover_manager_t *mgr, const char *station_name);
 
 /* Restore from failover */
 wtc_result_t failover_restore(failover_manager_t *mgr, const char *station_name);
 
-/* Callbacks */
+/* Callbacks; invoked with the failover lock held, so they must not call
+ * back into the failover manager */
 typedef void (*failover_callback_t)(const char *primary, const char *backup,
                                      bool failed_over, void *ctx);
 wtc_result_t failover_set_callback(failover_manager_t *mgr,
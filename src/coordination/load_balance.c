@@ -6,26 +6,124 @@
 
 #include "load_balance.h"
 #include "rtu_registry.h"
+#include "sample_scheduler.h"
 #include "logger.h"
 #include "time_utils.h"
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define LOG_TAG "LOAD_BAL"
 
+#define LB_DEFAULT_INTERVAL_MS      1000
+#define LB_DEFAULT_DEMAND_THRESHOLD 0.01f
+#define LB_DUE_BATCH                32
+
+_Static_assert(LOAD_BALANCE_MAX_MEMBERS <= 64, "member masks are 64 bits");
+
+/* Per-group balancing state, parallel to groups[] */
+typedef struct {
+    uint64_t next_due_ms;       /* Monotonic */
+    uint64_t last_run_ms;       /* Monotonic */
+    float applied_demand;       /* Demand of the last distribution */
+    uint64_t available_mask;    /* Member availability at last distribution */
+    uint64_t written_mask;      /* Members with a known actuator output */
+    actuator_output_t written[LOAD_BALANCE_MAX_MEMBERS];
+    bool dirty;                 /* Needs redistribution */
+} group_state_t;
+
 /* Load balancer structure */
 struct load_balancer {
     load_balance_config_t config;
     load_balance_group_t *groups;
+    group_state_t *state;
     int group_count;
+
+    /* group_id -> slot + 1, open addressing; 0 = empty */
+    int *index;
+    uint32_t index_mask;
+
+    /* Groups keyed by slot, ordered by next due time */
+    sample_scheduler_t *scheduler;
+
     bool running;
-    uint64_t last_process_ms;
     struct rtu_registry *registry;
 };
 
+static uint32_t group_hash(int group_id) {
+    uint32_t h = (uint32_t)group_id * 2654435761u;
+    return h ^ (h >> 16);
+}
+
+static void index_insert(load_balancer_t *lb, int slot) {
+    uint32_t h = group_hash(lb->groups[slot].group_id) & lb->index_mask;
+    while (lb->index[h] != 0) {
+        h = (h + 1) & lb->index_mask;
+    }
+    lb->index[h] = slot + 1;
+}
+
+static void index_rebuild(load_balancer_t *lb) {
+    memset(lb->index, 0, (lb->index_mask + 1) * sizeof(int));
+    for (int i = 0; i < lb->group_count; i++) {
+        index_insert(lb, i);
+    }
+}
+
+/* Find slot of a group by id, -1 if absent */
+static int find_group(load_balancer_t *lb, int group_id) {
+    uint32_t h = group_hash(group_id) & lb->index_mask;
+    while (lb->index[h] != 0) {
+        int slot = lb->index[h] - 1;
+        if (lb->groups[slot].group_id == group_id) {
+            return slot;
+        }
+        h = (h + 1) & lb->index_mask;
+    }
+    return -1;
+}
+
+static int member_count(const load_balance_group_t *group) {
+    if (group->member_count < 0) return 0;
+    return group->member_count > LOAD_BALANCE_MAX_MEMBERS ? LOAD_BALANCE_MAX_MEMBERS
+                                                          : group->member_count;
+}
+
+static float available_capacity(const load_balance_group_t *group) {
+    float total = 0;
+    for (int i = 0; i < member_count(group); i++) {
+        if (group->members[i].available) {
+            total += group->members[i].capacity;
+        }
+    }
+    return total;
+}
+
+/* Has demand moved far enough from the last distribution to redistribute? */
+static bool demand_changed(const load_balancer_t *lb, const load_balance_group_t *group,
+                           const group_state_t *st) {
+    float threshold = lb->config.demand_threshold * available_capacity(group);
+    return fabsf(group->total_demand - st->applied_demand) > threshold;
+}
+
+/* Mark a group for redistribution on the next process call */
+static void schedule_now(load_balancer_t *lb, int slot) {
+    group_state_t *st = &lb->state[slot];
+    st->dirty = true;
+    st->next_due_ms = time_get_monotonic_ms();
+    sample_scheduler_set(lb->scheduler, slot, st->next_due_ms);
+}
+
+static void reset_group_state(load_balancer_t *lb, int slot) {
+    group_state_t *st = &lb->state[slot];
+    memset(st, 0, sizeof(*st));
+    st->last_run_ms = time_get_monotonic_ms();
+    schedule_now(lb, slot);
+}
+
 /* Initialize load balancer */
 wtc_result_t load_balance_init(load_balancer_t **lb, const load_balance_config_t *config) {
-    if (!lb || !config) return WTC_ERROR_INVALID_PARAM;
+    if (!lb || !config || config->max_groups <= 0) return WTC_ERROR_INVALID_PARAM;
 
     load_balancer_t *bal = calloc(1, sizeof(load_balancer_t));
     if (!bal) {
@@ -33,9 +131,27 @@ wtc_result_t load_balance_init(load_balancer_t **lb, const load_balance_config_t
     }
 
     memcpy(&bal->config, config, sizeof(load_balance_config_t));
+    if (bal->config.rebalance_interval_ms == 0) {
+        bal->config.rebalance_interval_ms = LB_DEFAULT_INTERVAL_MS;
+    }
+    if (bal->config.demand_threshold <= 0) {
+        bal->config.demand_threshold = LB_DEFAULT_DEMAND_THRESHOLD;
+    }
+
+    uint32_t index_size = 16;
+    while (index_size < (uint32_t)config->max_groups * 2) {
+        index_size <<= 1;
+    }
+    bal->index_mask = index_size - 1;
 
     bal->groups = calloc(config->max_groups, sizeof(load_balance_group_t));
-    if (!bal->groups) {
+    bal->state = calloc(config->max_groups, sizeof(group_state_t));
+    bal->index = calloc(index_size, sizeof(int));
+    if (!bal->groups || !bal->state || !bal->index ||
+        sample_scheduler_init(&bal->scheduler, config->max_groups) != WTC_OK) {
+        free(bal->groups);
+        free(bal->state);
+        free(bal->index);
         free(bal);
         return WTC_ERROR_NO_MEMORY;
     }
@@ -51,6 +167,9 @@ wtc_result_t load_balance_init(load_balancer_t **lb, const load_balance_config_t
 /* Cleanup load balancer */
 void load_balance_cleanup(load_balancer_t *lb) {
     if (!lb) return;
+    sample_scheduler_cleanup(lb->scheduler);
+    free(lb->index);
+    free(lb->state);
     free(lb->groups);
     free(lb);
     LOG_INFO(LOG_TAG, "Load balancer cleaned up");
@@ -60,7 +179,6 @@ void load_balance_cleanup(load_balancer_t *lb) {
 wtc_result_t load_balance_start(load_balancer_t *lb) {
     if (!lb) return WTC_ERROR_INVALID_PARAM;
     lb->running = true;
-    lb->last_process_ms = time_get_ms();
     LOG_INFO(LOG_TAG, "Load balancer started");
     return WTC_OK;
 }
@@ -77,6 +195,9 @@ wtc_result_t load_balance_stop(load_balancer_t *lb) {
 wtc_result_t load_balance_set_registry(load_balancer_t *lb, struct rtu_registry *registry) {
     if (!lb) return WTC_ERROR_INVALID_PARAM;
     lb->registry = registry;
+    for (int i = 0; i < lb->group_count; i++) {
+        reset_group_state(lb, i);
+    }
     return WTC_OK;
 }
 
@@ -85,21 +206,23 @@ wtc_result_t load_balance_add_group(load_balancer_t *lb, const load_balance_grou
     if (!lb || !group) return WTC_ERROR_INVALID_PARAM;
 
     /* Check for existing */
-    for (int i = 0; i < lb->group_count; i++) {
-        if (lb->groups[i].group_id == group->group_id) {
-            memcpy(&lb->groups[i], group, sizeof(load_balance_group_t));
-            LOG_DEBUG(LOG_TAG, "Updated group %d: %s", group->group_id, group->name);
-            return WTC_OK;
-        }
+    int slot = find_group(lb, group->group_id);
+    if (slot >= 0) {
+        memcpy(&lb->groups[slot], group, sizeof(load_balance_group_t));
+        reset_group_state(lb, slot);
+        LOG_DEBUG(LOG_TAG, "Updated group %d: %s", group->group_id, group->name);
+        return WTC_OK;
     }
 
     if (lb->group_count >= lb->config.max_groups) {
         return WTC_ERROR_FULL;
     }
 
-    memcpy(&lb->groups[lb->group_count], group, sizeof(load_balance_group_t));
-    lb->groups[lb->group_count].last_rotation_ms = time_get_ms();
-    lb->group_count++;
+    slot = lb->group_count++;
+    memcpy(&lb->groups[slot], group, sizeof(load_balance_group_t));
+    lb->groups[slot].last_rotation_ms = time_get_ms();
+    index_insert(lb, slot);
+    reset_group_state(lb, slot);
 
     LOG_INFO(LOG_TAG, "Added load balance group %d: %s (%d members)",
              group->group_id, group->name, group->member_count);
@@ -110,32 +233,43 @@ wtc_result_t load_balance_add_group(load_balancer_t *lb, const load_balance_grou
 wtc_result_t load_balance_remove_group(load_balancer_t *lb, int group_id) {
     if (!lb) return WTC_ERROR_INVALID_PARAM;
 
-    for (int i = 0; i < lb->group_count; i++) {
-        if (lb->groups[i].group_id == group_id) {
-            memmove(&lb->groups[i], &lb->groups[i + 1],
-                    (lb->group_count - i - 1) * sizeof(load_balance_group_t));
-            lb->group_count--;
-            LOG_INFO(LOG_TAG, "Removed group %d", group_id);
-            return WTC_OK;
-        }
+    int slot = find_group(lb, group_id);
+    if (slot < 0) {
+        return WTC_ERROR_NOT_FOUND;
+    }
+
+    /* Move the last group into the freed slot */
+    int last = lb->group_count - 1;
+    sample_scheduler_remove(lb->scheduler, slot);
+    if (slot != last) {
+        sample_scheduler_remove(lb->scheduler, last);
+        lb->groups[slot] = lb->groups[last];
+        lb->state[slot] = lb->state[last];
+        sample_scheduler_set(lb->scheduler, slot, lb->state[slot].next_due_ms);
     }
+    lb->group_count--;
+    index_rebuild(lb);
 
-    return WTC_ERROR_NOT_FOUND;
+    LOG_INFO(LOG_TAG, "Removed group %d", group_id);
+    return WTC_OK;
 }
 
 /* Set demand for a group */
 wtc_result_t load_balance_set_demand(load_balancer_t *lb, int group_id, float demand) {
     if (!lb) return WTC_ERROR_INVALID_PARAM;
 
-    for (int i = 0; i < lb->group_count; i++) {
-        if (lb->groups[i].group_id == group_id) {
-            lb->groups[i].total_demand = demand;
-            LOG_DEBUG(LOG_TAG, "Set demand for group %d: %.2f", group_id, demand);
-            return WTC_OK;
-        }
+    int slot = find_group(lb, group_id);
+    if (slot < 0) {
+        return WTC_ERROR_NOT_FOUND;
     }
 
-    return WTC_ERROR_NOT_FOUND;
+    load_balance_group_t *group = &lb->groups[slot];
+    group->total_demand = demand;
+    if (demand_changed(lb, group, &lb->state[slot])) {
+        schedule_now(lb, slot);
+    }
+    LOG_DEBUG(LOG_TAG, "Set demand for group %d: %.2f", group_id, demand);
+    return WTC_OK;
 }
 
 /* Get group status */
@@ -143,14 +277,13 @@ wtc_result_t load_balance_get_group(load_balancer_t *lb, int group_id,
                                      load_balance_group_t *group) {
     if (!lb || !group) return WTC_ERROR_INVALID_PARAM;
 
-    for (int i = 0; i < lb->group_count; i++) {
-        if (lb->groups[i].group_id == group_id) {
-            memcpy(group, &lb->groups[i], sizeof(load_balance_group_t));
-            return WTC_OK;
-        }
+    int slot = find_group(lb, group_id);
+    if (slot < 0) {
+        return WTC_ERROR_NOT_FOUND;
     }
 
-    return WTC_ERROR_NOT_FOUND;
+    memcpy(group, &lb->groups[slot], sizeof(load_balance_group_t));
+    return WTC_OK;
 }
 
 /* Find member with lowest runtime */
@@ -158,7 +291,7 @@ static int find_lowest_runtime_member(load_balance_group_t *group) {
     int lowest_idx = -1;
     uint64_t lowest_runtime = UINT64_MAX;
 
-    for (int i = 0; i < group->member_count; i++) {
+    for (int i = 0; i < member_count(group); i++) {
         if (group->members[i].available &&
             group->members[i].runtime_ms < lowest_runtime) {
             lowest_runtime = group->members[i].runtime_ms;
@@ -169,61 +302,109 @@ static int find_lowest_runtime_member(load_balance_group_t *group) {
     return lowest_idx;
 }
 
-/* Distribute load across group members */
-static void distribute_load(load_balancer_t *lb, load_balance_group_t *group) {
-    if (!lb->registry || group->member_count == 0) return;
-
-    /* Calculate total available capacity */
-    float total_capacity = 0;
-    int available_count = 0;
+/* Distribute load across group members, writing only changed outputs */
+static void distribute_load(load_balancer_t *lb, int slot) {
+    load_balance_group_t *group = &lb->groups[slot];
+    group_state_t *st = &lb->state[slot];
+    int count = member_count(group);
 
-    for (int i = 0; i < group->member_count; i++) {
-        if (group->members[i].available) {
-            total_capacity += group->members[i].capacity;
-            available_count++;
-        }
-    }
+    if (count == 0) return;
 
-    if (available_count == 0 || total_capacity <= 0) {
+    /* Calculate total available capacity */
+    float total_capacity = available_capacity(group);
+    if (total_capacity <= 0) {
         LOG_WARN(LOG_TAG, "Group %d has no available capacity", group->group_id);
         return;
     }
 
-    /* Distribute demand proportionally */
+    /* Distribute demand proportionally, starting with lead member */
+    float shares[LOAD_BALANCE_MAX_MEMBERS] = {0};
     float remaining_demand = group->total_demand;
+    int current = group->lead_member % count;
 
-    /* Start with lead member */
-    int current = group->lead_member;
-    for (int i = 0; i < group->member_count && remaining_demand > 0; i++) {
-        if (!group->members[current].available) {
-            current = (current + 1) % group->member_count;
-            continue;
-        }
+    for (int i = 0; i < count && remaining_demand > 0; i++) {
+        if (group->members[current].available) {
+            float share = (group->members[current].capacity / total_capacity) *
+                          group->total_demand;
 
-        /* Calculate this member's share */
-        float share = (group->members[current].capacity / total_capacity) *
-                      group->total_demand;
+            /* Clamp to capacity */
+            if (share > group->members[current].capacity) {
+                share = group->members[current].capacity;
+            }
 
-        /* Clamp to capacity */
-        if (share > group->members[current].capacity) {
-            share = group->members[current].capacity;
+            shares[current] = share;
+            remaining_demand -= share;
         }
+        current = (current + 1) % count;
+    }
 
-        group->members[current].current_load = share;
-        remaining_demand -= share;
+    int writes = 0;
+    for (int i = 0; i < count; i++) {
+        uint64_t bit = 1ull << i;
+        group->members[i].current_load = shares[i];
 
-        /* Apply to actuator via registry */
+        if (!group->members[i].available) {
+            /* Output unknown once the RTU is back; rewrite it then */
+            st->written_mask &= ~bit;
+            continue;
+        }
+
+        float capacity = group->members[i].capacity;
         actuator_output_t output = {
-            .command = share > 0 ? ACTUATOR_CMD_PWM : ACTUATOR_CMD_OFF,
-            .pwm_duty = (uint8_t)((share / group->members[current].capacity) * 100),
+            .command = shares[i] > 0 ? ACTUATOR_CMD_PWM : ACTUATOR_CMD_OFF,
+            .pwm_duty = capacity > 0 ? (uint8_t)((shares[i] / capacity) * 100) : 0,
             .reserved = {0, 0}
         };
-        rtu_registry_update_actuator(lb->registry,
-                                      group->members[current].rtu_station,
-                                      group->members[current].slot,
-                                      &output);
 
-        current = (current + 1) % group->member_count;
+        if ((st->written_mask & bit) &&
+            st->written[i].command == output.command &&
+            st->written[i].pwm_duty == output.pwm_duty) {
+            continue;
+        }
+
+        /* Apply to actuator via registry */
+        if (rtu_registry_update_actuator(lb->registry,
+                                          group->members[i].rtu_station,
+                                          group->members[i].slot,
+                                          &output) == WTC_OK) {
+            st->written[i] = output;
+            st->written_mask |= bit;
+            writes++;
+        }
+    }
+
+    if (writes > 0) {
+        LOG_DEBUG(LOG_TAG, "Group %d redistributed %.2f (%d actuator writes)",
+                  group->group_id, group->total_demand, writes);
+    }
+}
+
+/* Rotate lead equipment of the group in a slot */
+static void rotate_group(load_balancer_t *lb, int slot) {
+    load_balance_group_t *group = &lb->groups[slot];
+    int count = member_count(group);
+    int new_lead;
+
+    if (count == 0) return;
+
+    if (group->wear_leveling) {
+        /* Find member with lowest runtime */
+        new_lead = find_lowest_runtime_member(group);
+    } else {
+        /* Simple round-robin */
+        new_lead = (group->lead_member + 1) % count;
+        while (!group->members[new_lead].available &&
+               new_lead != group->lead_member) {
+            new_lead = (new_lead + 1) % count;
+        }
+    }
+
+    group->last_rotation_ms = time_get_ms();
+    if (new_lead >= 0 && new_lead != group->lead_member) {
+        group->lead_member = new_lead;
+        lb->state[slot].dirty = true;
+        LOG_INFO(LOG_TAG, "Rotated group %d lead to member %d",
+                 group->group_id, new_lead);
     }
 }
 
@@ -231,81 +412,98 @@ static void distribute_load(load_balancer_t *lb, load_balance_group_t *group) {
 wtc_result_t load_balance_rotate(load_balancer_t *lb, int group_id) {
     if (!lb) return WTC_ERROR_INVALID_PARAM;
 
-    for (int i = 0; i < lb->group_count; i++) {
-        if (lb->groups[i].group_id == group_id) {
-            load_balance_group_t *group = &lb->groups[i];
-
-            if (group->wear_leveling) {
-                /* Find member with lowest runtime */
-                int new_lead = find_lowest_runtime_member(group);
-                if (new_lead >= 0 && new_lead != group->lead_member) {
-                    group->lead_member = new_lead;
-                    group->last_rotation_ms = time_get_ms();
-                    LOG_INFO(LOG_TAG, "Rotated group %d lead to member %d",
-                             group_id, new_lead);
-                }
-            } else {
-                /* Simple round-robin */
-                int new_lead = (group->lead_member + 1) % group->member_count;
-                while (!group->members[new_lead].available &&
-                       new_lead != group->lead_member) {
-                    new_lead = (new_lead + 1) % group->member_count;
-                }
-                group->lead_member = new_lead;
-                group->last_rotation_ms = time_get_ms();
-                LOG_INFO(LOG_TAG, "Rotated group %d lead to member %d",
-                         group_id, new_lead);
-            }
-
-            return WTC_OK;
-        }
+    int slot = find_group(lb, group_id);
+    if (slot < 0) {
+        return WTC_ERROR_NOT_FOUND;
     }
 
-    return WTC_ERROR_NOT_FOUND;
+    rotate_group(lb, slot);
+    if (lb->state[slot].dirty) {
+        schedule_now(lb, slot);
+    }
+    return WTC_OK;
 }
 
-/* Process load balancing */
-wtc_result_t load_balance_process(load_balancer_t *lb) {
-    if (!lb || !lb->running) return WTC_ERROR_NOT_INITIALIZED;
+/* Refresh member availability, returned as a bit mask */
+static uint64_t refresh_availability(load_balancer_t *lb, load_balance_group_t *group) {
+    uint64_t mask = 0;
+
+    for (int j = 0; j < member_count(group); j++) {
+        rtu_device_t *rtu = rtu_registry_get_device(lb->registry,
+                                                     group->members[j].rtu_station);
+        if (rtu) {
+            group->members[j].available =
+                (rtu->connection_state == PROFINET_STATE_RUNNING);
+            rtu_registry_free_device_copy(rtu);
+        }
+        if (group->members[j].available) {
+            mask |= 1ull << j;
+        }
+    }
 
-    uint64_t now = time_get_ms();
+    return mask;
+}
 
-    for (int i = 0; i < lb->group_count; i++) {
-        load_balance_group_t *group = &lb->groups[i];
-
-        if (!group->enabled) continue;
-
-        /* Update member availability from registry */
-        if (lb->registry) {
-            for (int j = 0; j < group->member_count; j++) {
-                rtu_device_t *rtu = rtu_registry_get_device(lb->registry,
-                                                             group->members[j].rtu_station);
-                if (rtu) {
-                    group->members[j].available =
-                        (rtu->connection_state == PROFINET_STATE_RUNNING);
-                    rtu_registry_free_device_copy(rtu);
-                }
-            }
+/* Run one due group and schedule its next check */
+static void process_group(load_balancer_t *lb, int slot, uint64_t now) {
+    load_balance_group_t *group = &lb->groups[slot];
+    group_state_t *st = &lb->state[slot];
+    uint64_t next = now + lb->config.rebalance_interval_ms;
+
+    /* Update runtime for active members */
+    uint64_t dt = now - st->last_run_ms;
+    st->last_run_ms = now;
+    for (int j = 0; j < member_count(group); j++) {
+        if (group->members[j].current_load > 0) {
+            group->members[j].runtime_ms += dt;
         }
+    }
 
-        /* Check for rotation */
-        if (group->rotation_interval_ms > 0 &&
-            (now - group->last_rotation_ms) >= group->rotation_interval_ms) {
-            load_balance_rotate(lb, group->group_id);
+    if (group->enabled && lb->registry) {
+        uint64_t mask = refresh_availability(lb, group);
+        if (mask != st->available_mask) {
+            st->available_mask = mask;
+            st->dirty = true;
         }
 
-        /* Update runtime for active members */
-        uint64_t dt = now - lb->last_process_ms;
-        for (int j = 0; j < group->member_count; j++) {
-            if (group->members[j].current_load > 0) {
-                group->members[j].runtime_ms += dt;
+        /* Check for rotation */
+        if (group->rotation_interval_ms > 0) {
+            uint64_t since = time_get_ms() - group->last_rotation_ms;
+            if (since >= group->rotation_interval_ms) {
+                rotate_group(lb, slot);
+                since = 0;
+            }
+            uint64_t rotation_due = now + (group->rotation_interval_ms - since);
+            if (rotation_due < next) {
+                next = rotation_due;
             }
         }
 
-        /* Distribute load */
-        distribute_load(lb, group);
+        if (st->dirty || demand_changed(lb, group, st)) {
+            distribute_load(lb, slot);
+            st->applied_demand = group->total_demand;
+            st->dirty = false;
+        }
     }
 
-    lb->last_process_ms = now;
+    st->next_due_ms = next;
+    sample_scheduler_set(lb->scheduler, slot, next);
+}
+
+/* Process load balancing */
+wtc_result_t load_balance_process(load_balancer_t *lb) {
+    if (!lb || !lb->running) return WTC_ERROR_NOT_INITIALIZED;
+
+    uint64_t now = time_get_monotonic_ms();
+    sample_slot_t due[LB_DUE_BATCH];
+    int n;
+
+    do {
+        n = sample_scheduler_pop_due(lb->scheduler, now, due, LB_DUE_BATCH);
+        for (int i = 0; i < n; i++) {
+            process_group(lb, due[i].key, now);
+        }
+    } while (n == LB_DUE_BATCH);
+
     return WTC_OK;
 }
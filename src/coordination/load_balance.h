@@ -13,13 +13,19 @@
 extern "C" {
 #endif
 
+/* Members per group; a large station runs dozens of pumps in one group */
+#define LOAD_BALANCE_MAX_MEMBERS 64
+
 /* Load balancer handle */
 typedef struct load_balancer load_balancer_t;
 
 /* Load balance configuration */
 typedef struct {
     int max_groups;
-    uint32_t rebalance_interval_ms;
+    uint32_t rebalance_interval_ms; /* Periodic re-check of each group */
+    float demand_threshold;         /* Demand change that triggers redistribution,
+                                       as a fraction of group capacity
+                                       (0 = default 1%) */
 } load_balance_config_t;
 
 /* Load balance group (e.g., pump group) */
@@ -36,7 +42,7 @@ typedef struct {
         float current_load;     /* Current load */
         uint64_t runtime_ms;    /* Total runtime for wear leveling */
         bool available;         /* Is this member available */
-    } members[16];
+    } members[LOAD_BALANCE_MAX_MEMBERS];
     int member_count;
 
     /* Load balance settings */
@@ -78,7 +84,9 @@ wtc_result_t load_balance_set_demand(load_balancer_t *lb, int group_id, float de
 wtc_result_t load_balance_get_group(load_balancer_t *lb, int group_id,
                                      load_balance_group_t *group);
 
-/* Process load balancing */
+/* Process groups that are due. A group is redistributed only when its
+ * demand, member availability or capacity changed, and only members
+ * whose actuator output changed are written. */
 wtc_result_t load_balance_process(load_balancer_t *lb);
 
 /* Force rotation of lead equipment */
@@ -0,0 +1,1532 @@
+/*
+ * Water Treatment Controller - Hot-Standby Replication Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "replication.h"
+#include "crc.h"
+#include "logger.h"
+#include "time_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+
+#define FRAME_MAGIC             0x52435457u     /* "WTCR" */
+#define FRAME_HEADER_SIZE       24
+#define FRAME_MAX_PAYLOAD       (REPLICATION_MAX_RECORD + REPLICATION_MAX_KEY + 16)
+#define MAX_APPEND_RECORD       64
+#define PATCH_GAP               4               /* Equal bytes worth bridging */
+#define NONCE_SIZE              8
+#define FLUSH_HISTORY           32              /* Send times kept for the lease */
+
+#define DEFAULT_BATCH_MS        10
+#define DEFAULT_HEARTBEAT_MS    50
+#define DEFAULT_TAKEOVER_MS     300
+#define DEFAULT_APPEND_QUEUE    16384
+
+/* Frame types */
+enum {
+    FRAME_SNAPSHOT_BEGIN = 1,
+    FRAME_SNAPSHOT_END,
+    FRAME_SET,                  /* Full value */
+    FRAME_PATCH,                /* Changed byte ranges of the previous value */
+    FRAME_REMOVE,
+    FRAME_APPEND,
+    FRAME_HEARTBEAT,
+    FRAME_ACK,                  /* Standby -> primary: seq = last applied */
+    FRAME_HELLO,                /* Role and nonce, first on a connection */
+    FRAME_AUTH,                 /* Keyed MAC of both nonces */
+    FRAME_BYE,                  /* Sender is stopping */
+};
+
+/* One keyed record. On the primary, sent holds what the standby has;
+ * on the standby it holds what was applied, as the base for patches. */
+typedef struct {
+    uint16_t kind;
+    char key[REPLICATION_MAX_KEY];
+    uint8_t *value;
+    size_t len;
+    uint8_t *sent;
+    size_t sent_len;
+    bool has_sent;
+    bool live;
+    bool dirty;
+    bool in_use;
+    uint32_t generation;
+    int next_free;
+} entry_t;
+
+typedef struct {
+    uint16_t kind;
+    uint16_t len;
+    uint8_t data[MAX_APPEND_RECORD];
+} append_slot_t;
+
+/* Growable byte buffer for outgoing frames */
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+} out_buffer_t;
+
+struct replication {
+    replication_config_t config;
+    replication_role_t role;
+
+    replication_apply_fn apply_fn;
+    void *apply_ctx;
+    replication_promote_fn promote_fn;
+    void *promote_ctx;
+    replication_demote_fn demote_fn;
+    void *demote_ctx;
+
+    /* MAC key derived from config.auth_key, which is then cleared */
+    uint64_t auth_key[2];
+
+    /* Keyed records; index is a linear-probe hash of entry indices */
+    entry_t *entries;
+    int entry_capacity;
+    int entry_limit;
+    int free_head;
+    int *index;
+    uint32_t index_mask;
+    uint32_t kind_generation[REPLICATION_KIND_COUNT];
+
+    /* Entries changed since the last batch */
+    int *dirty;
+    int dirty_count;
+
+    /* Appended records waiting to be sent */
+    append_slot_t *appends;
+    int append_head;
+    int append_count;
+
+    pthread_mutex_t lock;
+
+    /* Connection; touched only by the replication thread */
+    int listen_fd;
+    int peer_fd;
+    bool need_snapshot;
+    uint64_t next_seq;
+    uint64_t expect_seq;
+    uint64_t last_send_ms;
+    uint64_t last_contact_ms;
+    uint64_t last_connect_attempt_ms;
+    bool followed;              /* Standby: a primary was followed since the role began */
+
+    /* Primary lease; flushes remember when their last sequence was sent */
+    bool lease_held;
+    uint64_t lease_start_ms;
+    uint64_t flush_seq[FLUSH_HISTORY];
+    uint64_t flush_ms[FLUSH_HISTORY];
+    int flush_head;
+    int flush_count;
+    uint64_t flush_lost_seq;    /* Last sequence of the newest flush dropped */
+    uint32_t snapshot_generation;
+    out_buffer_t out;
+    uint8_t *in;
+    size_t in_len;
+
+    pthread_t thread;
+    volatile bool running;
+    bool promote_requested;
+
+    replication_stats_t stats;
+};
+
+/* ============== Record Table ============== */
+
+static uint32_t hash_key(uint16_t kind, const char *key) {
+    uint32_t h = 2166136261u ^ kind;
+    for (const char *p = key; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    return h;
+}
+
+static int find_entry(replication_t *repl, uint16_t kind, const char *key) {
+    uint32_t i = hash_key(kind, key) & repl->index_mask;
+    while (repl->index[i] >= 0) {
+        entry_t *e = &repl->entries[repl->index[i]];
+        if (e->kind == kind && strcmp(e->key, key) == 0) return repl->index[i];
+        i = (i + 1) & repl->index_mask;
+    }
+    return -1;
+}
+
+static void index_insert(replication_t *repl, int handle) {
+    entry_t *e = &repl->entries[handle];
+    uint32_t i = hash_key(e->kind, e->key) & repl->index_mask;
+    while (repl->index[i] >= 0) {
+        i = (i + 1) & repl->index_mask;
+    }
+    repl->index[i] = handle;
+}
+
+/* Remove from the index, shifting later probes back so no tombstones remain */
+static void index_erase(replication_t *repl, int handle) {
+    entry_t *e = &repl->entries[handle];
+    uint32_t i = hash_key(e->kind, e->key) & repl->index_mask;
+    while (repl->index[i] != handle) {
+        if (repl->index[i] < 0) return;
+        i = (i + 1) & repl->index_mask;
+    }
+
+    repl->index[i] = -1;
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & repl->index_mask;
+        if (repl->index[j] < 0) break;
+
+        entry_t *m = &repl->entries[repl->index[j]];
+        uint32_t k = hash_key(m->kind, m->key) & repl->index_mask;
+        bool movable = (i <= j) ? (k <= i || k > j) : (k <= i && k > j);
+        if (movable) {
+            repl->index[i] = repl->index[j];
+            repl->index[j] = -1;
+            i = j;
+        }
+    }
+}
+
+/* Double the table; lock held */
+static bool grow_entries(replication_t *repl) {
+    int capacity = repl->entry_capacity ? repl->entry_capacity * 2 : 256;
+    entry_t *entries = realloc(repl->entries, (size_t)capacity * sizeof(entry_t));
+    if (!entries) return false;
+    repl->entries = entries;
+
+    int *dirty = realloc(repl->dirty, (size_t)capacity * sizeof(int));
+    if (!dirty) return false;
+    repl->dirty = dirty;
+
+    uint32_t size = 16;
+    while (size < (uint32_t)capacity * 2) size <<= 1;
+    int *index = malloc(size * sizeof(int));
+    if (!index) return false;
+
+    free(repl->index);
+    repl->index = index;
+    repl->index_mask = size - 1;
+    for (uint32_t i = 0; i < size; i++) index[i] = -1;
+
+    repl->entry_capacity = capacity;
+    for (int h = 0; h < repl->entry_limit; h++) {
+        if (repl->entries[h].in_use) index_insert(repl, h);
+    }
+    return true;
+}
+
+static int create_entry(replication_t *repl, uint16_t kind, const char *key) {
+    int handle;
+    if (repl->free_head >= 0) {
+        handle = repl->free_head;
+        repl->free_head = repl->entries[handle].next_free;
+    } else {
+        if (repl->entry_limit == repl->entry_capacity && !grow_entries(repl)) {
+            return -1;
+        }
+        handle = repl->entry_limit++;
+    }
+
+    entry_t *e = &repl->entries[handle];
+    memset(e, 0, sizeof(*e));
+    e->kind = kind;
+    snprintf(e->key, sizeof(e->key), "%s", key);
+    e->in_use = true;
+    index_insert(repl, handle);
+    return handle;
+}
+
+static void destroy_entry(replication_t *repl, int handle) {
+    entry_t *e = &repl->entries[handle];
+    index_erase(repl, handle);
+    free(e->value);
+    free(e->sent);
+    e->value = e->sent = NULL;
+    e->in_use = false;
+    e->next_free = repl->free_head;
+    repl->free_head = handle;
+}
+
+static void mark_dirty(replication_t *repl, int handle) {
+    entry_t *e = &repl->entries[handle];
+    if (!e->dirty) {
+        e->dirty = true;
+        repl->dirty[repl->dirty_count++] = handle;
+    }
+}
+
+static bool copy_bytes(uint8_t **dst, size_t *dst_len, const void *src, size_t len) {
+    uint8_t *buf = realloc(*dst, len ? len : 1);
+    if (!buf) return false;
+    memcpy(buf, src, len);
+    *dst = buf;
+    *dst_len = len;
+    return true;
+}
+
+/* ============== Framing ============== */
+
+static bool out_reserve(out_buffer_t *out, size_t extra) {
+    if (out->len + extra <= out->capacity) return true;
+    size_t capacity = out->capacity ? out->capacity : 4096;
+    while (capacity < out->len + extra) capacity *= 2;
+    uint8_t *data = realloc(out->data, capacity);
+    if (!data) return false;
+    out->data = data;
+    out->capacity = capacity;
+    return true;
+}
+
+/* Start a frame; returns its offset in the buffer, or -1 */
+static long frame_begin(out_buffer_t *out, uint8_t type, uint64_t seq) {
+    if (!out_reserve(out, FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD)) return -1;
+    long at = (long)out->len;
+    uint8_t *h = out->data + at;
+    uint32_t magic = FRAME_MAGIC;
+    memcpy(h, &magic, 4);
+    h[4] = type;
+    h[5] = 0;
+    h[6] = h[7] = 0;
+    memcpy(h + 8, &seq, 8);
+    out->len += FRAME_HEADER_SIZE;
+    return at;
+}
+
+static void frame_put(out_buffer_t *out, const void *data, size_t len) {
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+}
+
+static void frame_end(out_buffer_t *out, long at) {
+    uint8_t *h = out->data + at;
+    uint32_t length = (uint32_t)(out->len - (size_t)at - FRAME_HEADER_SIZE);
+    uint32_t crc = 0;
+    memcpy(h + 16, &length, 4);
+    memcpy(h + 20, &crc, 4);
+    crc = crc32(h, out->len - (size_t)at);
+    memcpy(h + 20, &crc, 4);
+}
+
+static void put_record_key(out_buffer_t *out, uint16_t kind, const char *key) {
+    uint8_t key_len = (uint8_t)strlen(key);
+    frame_put(out, &kind, 2);
+    frame_put(out, &key_len, 1);
+    frame_put(out, key, key_len);
+}
+
+/* Encode new against old (same length) as ranges of changed bytes.
+ * Returns false when the patch would not be smaller than the value. */
+static bool put_patch(out_buffer_t *out, const uint8_t *old, const uint8_t *cur, size_t len) {
+    size_t mark = out->len;
+    uint16_t count = 0;
+    frame_put(out, &count, 2);
+
+    size_t i = 0;
+    while (i < len) {
+        if (old[i] == cur[i]) {
+            i++;
+            continue;
+        }
+        size_t start = i, end = i + 1, same = 0;
+        for (size_t j = end; j < len && same < PATCH_GAP; j++) {
+            if (old[j] == cur[j]) {
+                same++;
+            } else {
+                end = j + 1;
+                same = 0;
+            }
+        }
+
+        if (out->len - mark + 4 + (end - start) >= len) {
+            out->len = mark;
+            return false;
+        }
+        uint16_t off = (uint16_t)start, n = (uint16_t)(end - start);
+        frame_put(out, &off, 2);
+        frame_put(out, &n, 2);
+        frame_put(out, cur + start, n);
+        count++;
+        i = end;
+    }
+
+    memcpy(out->data + mark, &count, 2);
+    return true;
+}
+
+/* Emit the pending change of an entry; lock held */
+static void emit_entry(replication_t *repl, int handle) {
+    entry_t *e = &repl->entries[handle];
+    e->dirty = false;
+
+    if (!e->live) {
+        if (e->has_sent) {
+            long at = frame_begin(&repl->out, FRAME_REMOVE, repl->next_seq++);
+            if (at < 0) return;
+            put_record_key(&repl->out, e->kind, e->key);
+            frame_end(&repl->out, at);
+            repl->stats.records++;
+        }
+        destroy_entry(repl, handle);
+        return;
+    }
+
+    if (e->has_sent && e->sent_len == e->len && memcmp(e->sent, e->value, e->len) == 0) {
+        return;
+    }
+
+    size_t full = FRAME_HEADER_SIZE + 3 + strlen(e->key) + e->len;
+    long at = frame_begin(&repl->out, FRAME_PATCH, repl->next_seq++);
+    if (at < 0) return;
+    put_record_key(&repl->out, e->kind, e->key);
+
+    bool patched = e->has_sent && e->sent_len == e->len &&
+                   put_patch(&repl->out, e->sent, e->value, e->len);
+    if (patched) {
+        repl->stats.delta_records++;
+    } else {
+        repl->out.data[at + 4] = FRAME_SET;
+        frame_put(&repl->out, e->value, e->len);
+    }
+    frame_end(&repl->out, at);
+
+    if (copy_bytes(&e->sent, &e->sent_len, e->value, e->len)) {
+        e->has_sent = true;
+    }
+    repl->stats.records++;
+    repl->stats.full_bytes += full;
+}
+
+/* ============== Socket Helpers ============== */
+
+static void close_peer(replication_t *repl, const char *why) {
+    if (repl->peer_fd >= 0) {
+        LOG_WARN("Replication peer disconnected: %s", why);
+        close(repl->peer_fd);
+        repl->peer_fd = -1;
+    }
+    repl->in_len = 0;
+    pthread_mutex_lock(&repl->lock);
+    repl->stats.connected = false;
+    pthread_mutex_unlock(&repl->lock);
+}
+
+static void tune_socket(int fd, uint32_t timeout_ms) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static bool send_all(int fd, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* Remember when a flush ending at seq was sent. The time is taken
+ * before sending, so it never postdates the standby receiving it. */
+static void note_flush(replication_t *repl, uint64_t seq, uint64_t sent_ms) {
+    if (repl->flush_count == FLUSH_HISTORY) {
+        repl->flush_lost_seq = repl->flush_seq[repl->flush_head];
+        repl->flush_head = (repl->flush_head + 1) % FLUSH_HISTORY;
+        repl->flush_count--;
+    }
+    int at = (repl->flush_head + repl->flush_count) % FLUSH_HISTORY;
+    repl->flush_seq[at] = seq;
+    repl->flush_ms[at] = sent_ms;
+    repl->flush_count++;
+}
+
+/* Renew the lease from the send time of a newly acknowledged sequence */
+static void renew_lease(replication_t *repl, uint64_t acked) {
+    if (acked <= repl->flush_lost_seq) return;
+
+    while (repl->flush_count > 0) {
+        int at = repl->flush_head;
+        bool done = repl->flush_seq[at] == acked;
+        if (repl->flush_seq[at] >= acked) {
+            /* The flush holding the acknowledged sequence */
+            if (repl->flush_ms[at] > repl->lease_start_ms) {
+                repl->lease_start_ms = repl->flush_ms[at];
+            }
+            if (!done) return;
+        }
+        repl->flush_head = (at + 1) % FLUSH_HISTORY;
+        repl->flush_count--;
+        if (done) return;
+    }
+}
+
+static void reset_flushes(replication_t *repl) {
+    repl->flush_head = repl->flush_count = 0;
+    repl->flush_lost_seq = 0;
+}
+
+/* Send and clear the output buffer */
+static bool flush_out(replication_t *repl) {
+    if (repl->out.len == 0) return true;
+    uint64_t sent_ms = time_get_monotonic_ms();
+    bool ok = send_all(repl->peer_fd, repl->out.data, repl->out.len);
+    pthread_mutex_lock(&repl->lock);
+    repl->stats.bytes += repl->out.len;
+    if (repl->role == REPLICATION_PRIMARY) {
+        repl->stats.seq = repl->next_seq - 1;
+    }
+    pthread_mutex_unlock(&repl->lock);
+    if (ok && repl->role == REPLICATION_PRIMARY) {
+        note_flush(repl, repl->next_seq - 1, sent_ms);
+    }
+    repl->out.len = 0;
+    repl->last_send_ms = sent_ms;
+    if (!ok) close_peer(repl, strerror(errno));
+    return ok;
+}
+
+/* Read what is available into the input buffer. Returns false on EOF. */
+static bool read_peer(replication_t *repl) {
+    size_t room = 2 * (FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD) - repl->in_len;
+    ssize_t n = recv(repl->peer_fd, repl->in + repl->in_len, room, MSG_DONTWAIT);
+    if (n == 0) return false;
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    repl->in_len += (size_t)n;
+    pthread_mutex_lock(&repl->lock);
+    repl->stats.bytes += (uint64_t)n;
+    pthread_mutex_unlock(&repl->lock);
+    return true;
+}
+
+/* Complete frame at the start of a buffer. Returns 1 with the frame,
+ * 0 when more data is needed, -1 on a corrupt stream. */
+static int parse_frame(uint8_t *h, size_t avail, uint8_t *type, uint64_t *seq,
+                       const uint8_t **payload, uint32_t *length) {
+    if (avail < FRAME_HEADER_SIZE) return 0;
+
+    uint32_t magic, crc, expect = 0;
+    memcpy(&magic, h, 4);
+    memcpy(length, h + 16, 4);
+    memcpy(&crc, h + 20, 4);
+    if (magic != FRAME_MAGIC || *length > FRAME_MAX_PAYLOAD) return -1;
+    if (avail < FRAME_HEADER_SIZE + *length) return 0;
+
+    memset(h + 20, 0, 4);
+    if (crc32(h, FRAME_HEADER_SIZE + *length) != crc) return -1;
+    memcpy(h + 20, &expect, 4);
+
+    *type = h[4];
+    memcpy(seq, h + 8, 8);
+    *payload = h + FRAME_HEADER_SIZE;
+    return 1;
+}
+
+static int next_frame(replication_t *repl, uint8_t *type, uint64_t *seq,
+                      const uint8_t **payload, uint32_t *length) {
+    return parse_frame(repl->in, repl->in_len, type, seq, payload, length);
+}
+
+static void consume_frame(replication_t *repl, uint32_t length) {
+    size_t used = FRAME_HEADER_SIZE + length;
+    memmove(repl->in, repl->in + used, repl->in_len - used);
+    repl->in_len -= used;
+}
+
+/* ============== Authentication ============== */
+
+static uint64_t load_le64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t rotl64(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+static void sip_round(uint64_t v[4]) {
+    v[0] += v[1]; v[1] = rotl64(v[1], 13); v[1] ^= v[0]; v[0] = rotl64(v[0], 32);
+    v[2] += v[3]; v[3] = rotl64(v[3], 16); v[3] ^= v[2];
+    v[0] += v[3]; v[3] = rotl64(v[3], 21); v[3] ^= v[0];
+    v[2] += v[1]; v[1] = rotl64(v[1], 17); v[1] ^= v[2]; v[2] = rotl64(v[2], 32);
+}
+
+/* SipHash-2-4 keyed MAC */
+static uint64_t siphash(const uint64_t key[2], const uint8_t *data, size_t len) {
+    uint64_t v[4] = {
+        0x736f6d6570736575ull ^ key[0], 0x646f72616e646f6dull ^ key[1],
+        0x6c7967656e657261ull ^ key[0], 0x7465646279746573ull ^ key[1],
+    };
+    size_t whole = len - len % 8;
+    for (size_t i = 0; i < whole; i += 8) {
+        uint64_t m = load_le64(data + i);
+        v[3] ^= m;
+        sip_round(v);
+        sip_round(v);
+        v[0] ^= m;
+    }
+
+    uint64_t last = (uint64_t)len << 56;
+    for (size_t i = 0; i < len % 8; i++) {
+        last |= (uint64_t)data[whole + i] << (8 * i);
+    }
+    v[3] ^= last;
+    sip_round(v);
+    sip_round(v);
+    v[0] ^= last;
+
+    v[2] ^= 0xff;
+    for (int i = 0; i < 4; i++) sip_round(v);
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+/* Expand the shared secret into a MAC key */
+static void derive_key(const char *secret, uint64_t key[2]) {
+    static const uint64_t salt[2][2] = {
+        { 0x5754435245504c31ull, 0 },   /* "WTCREPL1" */
+        { 0x5754435245504c32ull, 0 },   /* "WTCREPL2" */
+    };
+    size_t len = strnlen(secret, sizeof(((replication_config_t *)0)->auth_key));
+    key[0] = siphash(salt[0], (const uint8_t *)secret, len);
+    key[1] = siphash(salt[1], (const uint8_t *)secret, len);
+}
+
+/* MAC a side sends: its role, its nonce, then the nonce it was sent.
+ * The role keeps a proof from being reflected back to its sender. */
+static uint64_t auth_mac(const replication_t *repl, uint8_t role,
+                         const uint8_t *own_nonce, const uint8_t *peer_nonce) {
+    uint8_t msg[1 + 2 * NONCE_SIZE];
+    msg[0] = role;
+    memcpy(msg + 1, own_nonce, NONCE_SIZE);
+    memcpy(msg + 1 + NONCE_SIZE, peer_nonce, NONCE_SIZE);
+    return siphash(repl->auth_key, msg, sizeof(msg));
+}
+
+/* Read one frame of at most max_payload bytes before the deadline */
+static bool recv_frame(int fd, uint8_t *buf, size_t max_payload, uint64_t deadline_ms,
+                       uint8_t *type, const uint8_t **payload, uint32_t *length) {
+    size_t have = 0, want = FRAME_HEADER_SIZE;
+    for (;;) {
+        uint64_t seq;
+        int r = parse_frame(buf, have, type, &seq, payload, length);
+        if (r < 0) return false;
+        if (r == 1) return true;
+        if (have >= FRAME_HEADER_SIZE) {
+            if (*length > max_payload) return false;
+            want = FRAME_HEADER_SIZE + *length;
+        }
+
+        uint64_t now = time_get_monotonic_ms();
+        if (now >= deadline_ms) return false;
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, (int)(deadline_ms - now)) <= 0) continue;
+
+        /* Exactly the frame, so stream data behind it stays queued */
+        ssize_t n = recv(fd, buf + have, want - have, MSG_DONTWAIT);
+        if (n == 0) return false;
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+            return false;
+        }
+        have += (size_t)n;
+    }
+}
+
+static bool send_handshake_frame(int fd, uint8_t type, const void *data, size_t len) {
+    out_buffer_t out = {0};
+    long at = frame_begin(&out, type, 0);
+    bool ok = at >= 0;
+    if (ok) {
+        frame_put(&out, data, len);
+        frame_end(&out, at);
+        ok = send_all(fd, out.data, out.len);
+    }
+    free(out.data);
+    return ok;
+}
+
+/* Prove the shared key to the peer and check its proof. The peer must
+ * hold the other role. On success *sent_ms is when this side sent its
+ * proof, which the peer receives afterwards. */
+static bool handshake(replication_t *repl, int fd, replication_role_t role,
+                      uint64_t *sent_ms, const char **why) {
+    uint8_t own_role = role == REPLICATION_PRIMARY ? 'P' : 'S';
+    uint8_t peer_role = role == REPLICATION_PRIMARY ? 'S' : 'P';
+    uint8_t hello[1 + NONCE_SIZE];
+    hello[0] = own_role;
+    if (getrandom(hello + 1, NONCE_SIZE, 0) != NONCE_SIZE) {
+        *why = "no random nonce";
+        return false;
+    }
+
+    uint8_t buf[FRAME_HEADER_SIZE + sizeof(hello)];
+    uint8_t type;
+    const uint8_t *payload;
+    uint32_t length;
+    uint64_t deadline = time_get_monotonic_ms() + 2 * (uint64_t)repl->config.heartbeat_ms;
+
+    *why = "no hello";
+    if (!send_handshake_frame(fd, FRAME_HELLO, hello, sizeof(hello)) ||
+        !recv_frame(fd, buf, sizeof(hello), deadline, &type, &payload, &length) ||
+        type != FRAME_HELLO || length != sizeof(hello)) {
+        return false;
+    }
+    if (payload[0] != peer_role) {
+        *why = "peer has the same role";
+        return false;
+    }
+    uint8_t peer_nonce[NONCE_SIZE];
+    memcpy(peer_nonce, payload + 1, NONCE_SIZE);
+
+    uint64_t mac = auth_mac(repl, own_role, hello + 1, peer_nonce);
+    *sent_ms = time_get_monotonic_ms();
+    *why = "no proof";
+    if (!send_handshake_frame(fd, FRAME_AUTH, &mac, sizeof(mac)) ||
+        !recv_frame(fd, buf, sizeof(mac), deadline, &type, &payload, &length) ||
+        type != FRAME_AUTH || length != sizeof(mac)) {
+        return false;
+    }
+
+    uint64_t expect = auth_mac(repl, peer_role, peer_nonce, hello + 1);
+    memcpy(&mac, payload, sizeof(mac));
+    if (mac != expect) {
+        *why = "wrong key";
+        return false;
+    }
+    return true;
+}
+
+/* ============== Primary ============== */
+
+static bool open_listener(replication_t *repl) {
+    uint16_t port = repl->config.listen_port ? repl->config.listen_port : REPLICATION_DEFAULT_PORT;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+
+    const char *host = repl->config.bind_addr[0] ? repl->config.bind_addr : "127.0.0.1";
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+    };
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1 ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 2) != 0) {
+        LOG_ERROR("Replication cannot listen on %s:%u: %s", host, port, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    repl->listen_fd = fd;
+    LOG_INFO("Replication serving standbys on %s:%u", host, port);
+    return true;
+}
+
+/* Send every live record in full; lock held */
+static void build_snapshot(replication_t *repl) {
+    long at = frame_begin(&repl->out, FRAME_SNAPSHOT_BEGIN, repl->next_seq++);
+    if (at < 0) return;
+    frame_end(&repl->out, at);
+
+    for (int i = 0; i < repl->dirty_count; i++) {
+        repl->entries[repl->dirty[i]].dirty = false;
+    }
+    repl->dirty_count = 0;
+
+    for (int h = 0; h < repl->entry_limit; h++) {
+        entry_t *e = &repl->entries[h];
+        if (!e->in_use) continue;
+        if (!e->live) {
+            destroy_entry(repl, h);
+            continue;
+        }
+        e->has_sent = false;
+        emit_entry(repl, h);
+    }
+
+    at = frame_begin(&repl->out, FRAME_SNAPSHOT_END, repl->next_seq++);
+    if (at >= 0) frame_end(&repl->out, at);
+    repl->stats.snapshots++;
+}
+
+/* Changes since the last batch; lock held */
+static void build_batch(replication_t *repl) {
+    for (int i = 0; i < repl->dirty_count; i++) {
+        if (repl->out.len > 256 * 1024) {
+            /* Keep the rest for the next batch */
+            memmove(repl->dirty, repl->dirty + i, (size_t)(repl->dirty_count - i) * sizeof(int));
+            repl->dirty_count -= i;
+            goto appends;
+        }
+        emit_entry(repl, repl->dirty[i]);
+    }
+    repl->dirty_count = 0;
+
+appends:
+    while (repl->append_count > 0 && repl->out.len <= 256 * 1024) {
+        append_slot_t *slot = &repl->appends[repl->append_head];
+        long at = frame_begin(&repl->out, FRAME_APPEND, repl->next_seq++);
+        if (at < 0) break;
+        put_record_key(&repl->out, slot->kind, "");
+        frame_put(&repl->out, slot->data, slot->len);
+        frame_end(&repl->out, at);
+        repl->stats.records++;
+        repl->stats.full_bytes += FRAME_HEADER_SIZE + 3 + slot->len;
+        repl->append_head = (repl->append_head + 1) % repl->config.append_queue;
+        repl->append_count--;
+    }
+}
+
+static void demote(replication_t *repl, const char *why);
+
+/* Take a standby connection, unless one is already attached */
+static void accept_standby(replication_t *repl) {
+    int fd = accept(repl->listen_fd, NULL, NULL);
+    if (fd < 0) return;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    if (repl->peer_fd >= 0) {
+        LOG_DEBUG("Replication refused a connection: standby already attached");
+        close(fd);
+        return;
+    }
+
+    tune_socket(fd, repl->config.takeover_ms);
+    uint64_t sent_ms;
+    const char *why;
+    if (!handshake(repl, fd, REPLICATION_PRIMARY, &sent_ms, &why)) {
+        close(fd);
+        pthread_mutex_lock(&repl->lock);
+        repl->stats.auth_failures++;
+        pthread_mutex_unlock(&repl->lock);
+        LOG_WARN("Replication rejected a standby: %s", why);
+        return;
+    }
+
+    repl->peer_fd = fd;
+    repl->need_snapshot = true;
+    if (!repl->lease_held || sent_ms > repl->lease_start_ms) {
+        repl->lease_start_ms = sent_ms;
+    }
+    repl->lease_held = true;
+    reset_flushes(repl);
+    repl->flush_lost_seq = repl->next_seq - 1;
+    pthread_mutex_lock(&repl->lock);
+    repl->stats.connected = true;
+    pthread_mutex_unlock(&repl->lock);
+    LOG_INFO("Replication standby connected");
+}
+
+static void primary_step(replication_t *repl) {
+    if (repl->lease_held &&
+        time_get_monotonic_ms() - repl->lease_start_ms >= repl->config.lease_ms) {
+        demote(repl, "standby stopped acknowledging");
+        return;
+    }
+
+    if (repl->listen_fd < 0) {
+        uint64_t now = time_get_monotonic_ms();
+        if (now - repl->last_connect_attempt_ms < 1000) {
+            time_sleep_ms(repl->config.batch_ms);
+            return;
+        }
+        repl->last_connect_attempt_ms = now;
+        if (!open_listener(repl)) return;
+    }
+
+    struct pollfd fds[2] = {
+        { .fd = repl->listen_fd, .events = POLLIN },
+        { .fd = repl->peer_fd, .events = POLLIN },
+    };
+    int nfds = repl->peer_fd >= 0 ? 2 : 1;
+    if (poll(fds, nfds, (int)repl->config.batch_ms) < 0 && errno != EINTR) {
+        return;
+    }
+
+    if (fds[0].revents & POLLIN) {
+        accept_standby(repl);
+    }
+
+    if (repl->peer_fd < 0) return;
+
+    /* Acknowledgements from the standby */
+    if (nfds == 2 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+        if (!read_peer(repl)) {
+            close_peer(repl, "connection closed");
+            return;
+        }
+        uint8_t type;
+        uint64_t seq;
+        const uint8_t *payload;
+        uint32_t length;
+        int r;
+        while ((r = next_frame(repl, &type, &seq, &payload, &length)) == 1) {
+            consume_frame(repl, length);
+            if (type == FRAME_ACK && seq > repl->stats.acked_seq) {
+                renew_lease(repl, seq);
+                pthread_mutex_lock(&repl->lock);
+                repl->stats.acked_seq = seq;
+                pthread_mutex_unlock(&repl->lock);
+            } else if (type == FRAME_BYE) {
+                /* A standby that stops cleanly gives the lease back */
+                repl->lease_held = false;
+                close_peer(repl, "standby stopped");
+                return;
+            }
+        }
+        if (r < 0) {
+            close_peer(repl, "corrupt frame");
+            return;
+        }
+    }
+
+    uint64_t now = time_get_monotonic_ms();
+
+    pthread_mutex_lock(&repl->lock);
+    if (repl->need_snapshot) {
+        build_snapshot(repl);
+        repl->need_snapshot = false;
+    } else {
+        build_batch(repl);
+    }
+    if (repl->out.len == 0 && now - repl->last_send_ms >= repl->config.heartbeat_ms) {
+        long at = frame_begin(&repl->out, FRAME_HEARTBEAT, repl->next_seq++);
+        if (at >= 0) frame_end(&repl->out, at);
+    }
+    pthread_mutex_unlock(&repl->lock);
+
+    flush_out(repl);
+}
+
+/* ============== Standby ============== */
+
+static bool connect_primary(replication_t *repl) {
+    char port[8];
+    snprintf(port, sizeof(port), "%u",
+             repl->config.peer_port ? repl->config.peer_port : REPLICATION_DEFAULT_PORT);
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(repl->config.peer_host, port, &hints, &res) != 0) return false;
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (fd < 0) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0 && errno != EINPROGRESS) {
+            close(fd);
+            fd = -1;
+            continue;
+        }
+
+        /* Bounded by the heartbeat so the takeover timer keeps running */
+        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+        int err = 0;
+        socklen_t err_len = sizeof(err);
+        if (poll(&pfd, 1, (int)repl->config.heartbeat_ms) != 1 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) != 0 || err != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd < 0) return false;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    tune_socket(fd, repl->config.takeover_ms);
+
+    uint64_t sent_ms;
+    const char *why;
+    if (!handshake(repl, fd, REPLICATION_STANDBY, &sent_ms, &why)) {
+        close(fd);
+        pthread_mutex_lock(&repl->lock);
+        repl->stats.auth_failures++;
+        pthread_mutex_unlock(&repl->lock);
+        LOG_WARN("Replication rejected primary %s:%s: %s", repl->config.peer_host, port, why);
+        return false;
+    }
+
+    repl->peer_fd = fd;
+    repl->expect_seq = 0;
+    repl->followed = true;
+    repl->last_contact_ms = time_get_monotonic_ms();
+    pthread_mutex_lock(&repl->lock);
+    repl->stats.connected = true;
+    pthread_mutex_unlock(&repl->lock);
+    LOG_INFO("Replication following primary %s:%s", repl->config.peer_host, port);
+    return true;
+}
+
+static void apply_record(replication_t *repl, uint16_t kind, const char *key,
+                         const void *data, size_t len, bool removed) {
+    if (repl->apply_fn && kind > 0 && kind < REPLICATION_KIND_COUNT) {
+        repl->apply_fn((replication_kind_t)kind, key, data, len, removed, repl->apply_ctx);
+    }
+}
+
+/* Apply one record frame. Returns false on a malformed record. */
+static bool apply_frame(replication_t *repl, uint8_t type, const uint8_t *p, uint32_t length) {
+    if (length < 3) return false;
+    uint16_t kind;
+    memcpy(&kind, p, 2);
+    uint8_t key_len = p[2];
+    if (key_len >= REPLICATION_MAX_KEY || 3u + key_len > length) return false;
+
+    char key[REPLICATION_MAX_KEY];
+    memcpy(key, p + 3, key_len);
+    key[key_len] = '\0';
+    const uint8_t *body = p + 3 + key_len;
+    size_t body_len = length - 3 - key_len;
+
+    if (type == FRAME_APPEND) {
+        apply_record(repl, kind, "", body, body_len, false);
+        return true;
+    }
+
+    pthread_mutex_lock(&repl->lock);
+    int h = find_entry(repl, kind, key);
+
+    if (type == FRAME_REMOVE) {
+        if (h >= 0) destroy_entry(repl, h);
+        pthread_mutex_unlock(&repl->lock);
+        apply_record(repl, kind, key, NULL, 0, true);
+        return true;
+    }
+
+    if (h < 0) {
+        if (type == FRAME_PATCH || (h = create_entry(repl, kind, key)) < 0) {
+            pthread_mutex_unlock(&repl->lock);
+            return false;
+        }
+    }
+    entry_t *e = &repl->entries[h];
+
+    if (type == FRAME_SET) {
+        if (!copy_bytes(&e->value, &e->len, body, body_len)) {
+            pthread_mutex_unlock(&repl->lock);
+            return false;
+        }
+    } else {
+        /* Patch the applied value in place */
+        if (body_len < 2) goto bad;
+        uint16_t count;
+        memcpy(&count, body, 2);
+        size_t at = 2;
+        for (uint16_t i = 0; i < count; i++) {
+            uint16_t off, n;
+            if (at + 4 > body_len) goto bad;
+            memcpy(&off, body + at, 2);
+            memcpy(&n, body + at + 2, 2);
+            at += 4;
+            if (at + n > body_len || (size_t)off + n > e->len) goto bad;
+            memcpy(e->value + off, body + at, n);
+            at += n;
+        }
+        repl->stats.delta_records++;
+    }
+    e->live = true;
+    e->has_sent = true;
+    e->generation = repl->snapshot_generation;
+
+    /* The callback gets a copy so the table can change meanwhile */
+    uint8_t value[REPLICATION_MAX_RECORD];
+    size_t value_len = e->len < sizeof(value) ? e->len : sizeof(value);
+    memcpy(value, e->value, value_len);
+    pthread_mutex_unlock(&repl->lock);
+
+    apply_record(repl, kind, key, value, value_len, false);
+    return true;
+
+bad:
+    pthread_mutex_unlock(&repl->lock);
+    return false;
+}
+
+/* Drop records the snapshot did not mention */
+static void finish_snapshot(replication_t *repl) {
+    for (int h = 0; h < repl->entry_limit; h++) {
+        pthread_mutex_lock(&repl->lock);
+        entry_t *e = &repl->entries[h];
+        if (!e->in_use || e->generation == repl->snapshot_generation) {
+            pthread_mutex_unlock(&repl->lock);
+            continue;
+        }
+        uint16_t kind = e->kind;
+        char key[REPLICATION_MAX_KEY];
+        memcpy(key, e->key, sizeof(key));
+        destroy_entry(repl, h);
+        pthread_mutex_unlock(&repl->lock);
+        apply_record(repl, kind, key, NULL, 0, true);
+    }
+}
+
+static void send_ack(replication_t *repl) {
+    long at = frame_begin(&repl->out, FRAME_ACK, repl->expect_seq ? repl->expect_seq - 1 : 0);
+    if (at < 0) return;
+    frame_end(&repl->out, at);
+    flush_out(repl);
+}
+
+static void promote(replication_t *repl, const char *why) {
+    if (repl->peer_fd >= 0) close_peer(repl, why);
+
+    pthread_mutex_lock(&repl->lock);
+    repl->role = REPLICATION_PRIMARY;
+    repl->stats.role = REPLICATION_PRIMARY;
+    repl->stats.promotions++;
+    repl->promote_requested = false;
+    repl->last_connect_attempt_ms = 0;
+    repl->followed = false;
+    repl->lease_held = false;
+    reset_flushes(repl);
+
+    /* What this side applied is what a new standby must be sent */
+    repl->dirty_count = 0;
+    for (int h = 0; h < repl->entry_limit; h++) {
+        repl->entries[h].dirty = false;
+        repl->entries[h].has_sent = false;
+    }
+    pthread_mutex_unlock(&repl->lock);
+
+    LOG_WARN("Replication standby promoted to primary: %s", why);
+    if (repl->promote_fn) {
+        repl->promote_fn(repl->promote_ctx);
+    }
+}
+
+/* Stop acting as primary: the standby may take over once takeover_ms
+ * of silence has passed, so the owner must stop its outputs now */
+static void demote(replication_t *repl, const char *why) {
+    if (repl->peer_fd >= 0) close_peer(repl, why);
+    if (repl->listen_fd >= 0) {
+        close(repl->listen_fd);
+        repl->listen_fd = -1;
+    }
+
+    pthread_mutex_lock(&repl->lock);
+    repl->role = REPLICATION_STANDBY;
+    repl->stats.role = REPLICATION_STANDBY;
+    repl->stats.demotions++;
+    repl->lease_held = false;
+    repl->followed = false;
+    repl->last_connect_attempt_ms = 0;
+    reset_flushes(repl);
+
+    /* Unsent changes and appends are moot; whatever the next snapshot
+     * does not mention is dropped when it ends */
+    repl->dirty_count = 0;
+    repl->append_head = repl->append_count = 0;
+    for (int h = 0; h < repl->entry_limit; h++) {
+        entry_t *e = &repl->entries[h];
+        e->dirty = false;
+        if (!e->in_use) continue;
+        if (!e->live) {
+            destroy_entry(repl, h);
+        } else {
+            e->generation = repl->snapshot_generation;
+        }
+    }
+    pthread_mutex_unlock(&repl->lock);
+
+    LOG_ERROR("Replication primary fenced: %s", why);
+    if (repl->demote_fn) {
+        repl->demote_fn(repl->demote_ctx);
+    }
+}
+
+static void standby_step(replication_t *repl) {
+    uint64_t now = time_get_monotonic_ms();
+
+    /* Only a followed primary holds a lease it will fence on */
+    if (repl->followed && now - repl->last_contact_ms >= repl->config.takeover_ms) {
+        promote(repl, "primary silent");
+        return;
+    }
+
+    if (repl->peer_fd < 0) {
+        if (now - repl->last_connect_attempt_ms < repl->config.heartbeat_ms) {
+            time_sleep_ms(repl->config.batch_ms);
+            return;
+        }
+        repl->last_connect_attempt_ms = now;
+        if (!connect_primary(repl)) return;
+    }
+
+    struct pollfd pfd = { .fd = repl->peer_fd, .events = POLLIN };
+    int r = poll(&pfd, 1, (int)repl->config.batch_ms);
+    if (r < 0 && errno != EINTR) return;
+
+    if (r > 0) {
+        if (!read_peer(repl)) {
+            close_peer(repl, "connection closed");
+            return;
+        }
+
+        uint8_t type;
+        uint64_t seq;
+        const uint8_t *payload;
+        uint32_t length;
+        bool applied = false;
+        int f;
+        while ((f = next_frame(repl, &type, &seq, &payload, &length)) == 1) {
+            if (type == FRAME_SNAPSHOT_BEGIN) {
+                repl->expect_seq = seq;
+                repl->snapshot_generation++;
+                pthread_mutex_lock(&repl->lock);
+                repl->stats.snapshots++;
+                pthread_mutex_unlock(&repl->lock);
+            }
+            if (repl->expect_seq == 0 || seq != repl->expect_seq) {
+                close_peer(repl, "sequence gap");
+                return;
+            }
+            repl->expect_seq = seq + 1;
+            repl->last_contact_ms = time_get_monotonic_ms();
+
+            bool ok = true;
+            switch (type) {
+            case FRAME_SET:
+            case FRAME_PATCH:
+            case FRAME_REMOVE:
+            case FRAME_APPEND:
+                ok = apply_frame(repl, type, payload, length);
+                pthread_mutex_lock(&repl->lock);
+                repl->stats.records++;
+                repl->stats.full_bytes += FRAME_HEADER_SIZE + length;
+                pthread_mutex_unlock(&repl->lock);
+                break;
+            case FRAME_SNAPSHOT_END:
+                finish_snapshot(repl);
+                break;
+            case FRAME_BYE:
+                /* The primary stopped its outputs before saying so */
+                promote(repl, "primary handed over");
+                return;
+            default:
+                break;
+            }
+            applied = true;
+            consume_frame(repl, length);
+            if (!ok) {
+                close_peer(repl, "malformed record");
+                return;
+            }
+        }
+        if (f < 0) {
+            close_peer(repl, "corrupt frame");
+            return;
+        }
+
+        pthread_mutex_lock(&repl->lock);
+        repl->stats.seq = repl->expect_seq - 1;
+        repl->stats.last_frame_ms = time_get_ms();
+        pthread_mutex_unlock(&repl->lock);
+
+        /* Acknowledge applied frames promptly; they renew the primary's lease */
+        if (applied && time_get_monotonic_ms() - repl->last_send_ms >= repl->config.batch_ms) {
+            send_ack(repl);
+            return;
+        }
+    }
+
+    if (repl->peer_fd >= 0 && time_get_monotonic_ms() - repl->last_send_ms >= repl->config.heartbeat_ms) {
+        send_ack(repl);
+    }
+}
+
+static void *replication_thread_func(void *arg) {
+    replication_t *repl = arg;
+
+    repl->last_contact_ms = time_get_monotonic_ms();
+    while (repl->running) {
+        if (repl->role == REPLICATION_STANDBY && repl->promote_requested) {
+            promote(repl, "promotion requested");
+        } else if (repl->role == REPLICATION_STANDBY && repl->config.peer_host[0]) {
+            standby_step(repl);
+        } else if (repl->role == REPLICATION_PRIMARY && repl->config.listen_port) {
+            primary_step(repl);
+        } else {
+            /* Promoted without a port to serve on, or fenced without a
+             * primary to follow */
+            time_sleep_ms(repl->config.heartbeat_ms);
+        }
+    }
+    return NULL;
+}
+
+/* ============== Public API ============== */
+
+wtc_result_t replication_init(replication_t **repl, const replication_config_t *config) {
+    if (!repl || !config) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    if (config->role == REPLICATION_STANDBY && !config->peer_host[0]) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    struct in_addr bind_addr;
+    if (!config->auth_key[0] ||
+        (config->bind_addr[0] && inet_pton(AF_INET, config->bind_addr, &bind_addr) != 1)) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    replication_t *r = calloc(1, sizeof(replication_t));
+    if (!r) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    r->config = *config;
+    if (r->config.batch_ms == 0) r->config.batch_ms = DEFAULT_BATCH_MS;
+    if (r->config.heartbeat_ms == 0) r->config.heartbeat_ms = DEFAULT_HEARTBEAT_MS;
+    if (r->config.takeover_ms == 0) r->config.takeover_ms = DEFAULT_TAKEOVER_MS;
+    if (r->config.lease_ms == 0 || r->config.lease_ms >= r->config.takeover_ms) {
+        r->config.lease_ms = r->config.takeover_ms / 2;
+    }
+    if (r->config.append_queue <= 0) r->config.append_queue = DEFAULT_APPEND_QUEUE;
+
+    derive_key(r->config.auth_key, r->auth_key);
+    memset(r->config.auth_key, 0, sizeof(r->config.auth_key));
+
+    r->role = config->role;
+    r->stats.role = config->role;
+    r->free_head = -1;
+    r->listen_fd = -1;
+    r->peer_fd = -1;
+    r->next_seq = 1;
+    pthread_mutex_init(&r->lock, NULL);
+
+    r->appends = calloc((size_t)r->config.append_queue, sizeof(append_slot_t));
+    r->in = malloc(2 * (FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD));
+    if (!r->appends || !r->in || !grow_entries(r)) {
+        replication_cleanup(r);
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    *repl = r;
+    LOG_INFO("Replication initialized as %s",
+             r->role == REPLICATION_PRIMARY ? "primary" : "standby");
+    return WTC_OK;
+}
+
+void replication_cleanup(replication_t *repl) {
+    if (!repl) return;
+
+    replication_stop(repl);
+    for (int h = 0; h < repl->entry_limit; h++) {
+        free(repl->entries[h].value);
+        free(repl->entries[h].sent);
+    }
+    free(repl->entries);
+    free(repl->index);
+    free(repl->dirty);
+    free(repl->appends);
+    free(repl->in);
+    free(repl->out.data);
+    pthread_mutex_destroy(&repl->lock);
+    free(repl);
+}
+
+wtc_result_t replication_start(replication_t *repl) {
+    if (!repl) return WTC_ERROR_INVALID_PARAM;
+    if (repl->running) return WTC_OK;
+
+    repl->running = true;
+    if (pthread_create(&repl->thread, NULL, replication_thread_func, repl) != 0) {
+        repl->running = false;
+        LOG_ERROR("Failed to create replication thread");
+        return WTC_ERROR;
+    }
+    return WTC_OK;
+}
+
+wtc_result_t replication_stop(replication_t *repl) {
+    if (!repl) return WTC_ERROR_INVALID_PARAM;
+    if (!repl->running) return WTC_OK;
+
+    repl->running = false;
+    pthread_join(repl->thread, NULL);
+
+    /* Tell the peer this side is going: a standby promotes at once, a
+     * primary gives up the lease without fencing itself */
+    if (repl->peer_fd >= 0) {
+        long at = frame_begin(&repl->out, FRAME_BYE,
+                              repl->role == REPLICATION_PRIMARY ? repl->next_seq++ : 0);
+        if (at >= 0) {
+            frame_end(&repl->out, at);
+            send_all(repl->peer_fd, repl->out.data, repl->out.len);
+        }
+        repl->out.len = 0;
+    }
+    if (repl->peer_fd >= 0) close(repl->peer_fd);
+    if (repl->listen_fd >= 0) close(repl->listen_fd);
+    repl->peer_fd = repl->listen_fd = -1;
+    repl->stats.connected = false;
+    return WTC_OK;
+}
+
+void replication_set_apply_callback(replication_t *repl, replication_apply_fn fn, void *ctx) {
+    if (!repl) return;
+    repl->apply_fn = fn;
+    repl->apply_ctx = ctx;
+}
+
+void replication_set_promote_callback(replication_t *repl, replication_promote_fn fn, void *ctx) {
+    if (!repl) return;
+    repl->promote_fn = fn;
+    repl->promote_ctx = ctx;
+}
+
+void replication_set_demote_callback(replication_t *repl, replication_demote_fn fn, void *ctx) {
+    if (!repl) return;
+    repl->demote_fn = fn;
+    repl->demote_ctx = ctx;
+}
+
+replication_role_t replication_get_role(replication_t *repl) {
+    if (!repl) return REPLICATION_PRIMARY;
+    pthread_mutex_lock(&repl->lock);
+    replication_role_t role = repl->role;
+    pthread_mutex_unlock(&repl->lock);
+    return role;
+}
+
+wtc_result_t replication_promote(replication_t *repl) {
+    if (!repl) return WTC_ERROR_INVALID_PARAM;
+
+    pthread_mutex_lock(&repl->lock);
+    bool standby = repl->role == REPLICATION_STANDBY;
+    repl->promote_requested = standby;
+    pthread_mutex_unlock(&repl->lock);
+
+    if (standby && !repl->running) {
+        promote(repl, "promotion requested");
+    }
+    return WTC_OK;
+}
+
+wtc_result_t replication_publish(replication_t *repl, replication_kind_t kind,
+                                 const char *key, const void *data, size_t len) {
+    if (!repl || !key || (!data && len) || kind <= 0 || kind >= REPLICATION_KIND_COUNT ||
+        strlen(key) >= REPLICATION_MAX_KEY || len > REPLICATION_MAX_RECORD) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&repl->lock);
+    if (repl->role != REPLICATION_PRIMARY) {
+        pthread_mutex_unlock(&repl->lock);
+        return WTC_ERROR_BUSY;
+    }
+
+    int h = find_entry(repl, (uint16_t)kind, key);
+    if (h < 0 && (h = create_entry(repl, (uint16_t)kind, key)) < 0) {
+        pthread_mutex_unlock(&repl->lock);
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    entry_t *e = &repl->entries[h];
+    e->generation = repl->kind_generation[kind];
+    if (e->live && e->len == len && memcmp(e->value, data, len) == 0) {
+        pthread_mutex_unlock(&repl->lock);
+        return WTC_OK;
+    }
+
+    if (!copy_bytes(&e->value, &e->len, data, len)) {
+        pthread_mutex_unlock(&repl->lock);
+        return WTC_ERROR_NO_MEMORY;
+    }
+    e->live = true;
+    mark_dirty(repl, h);
+    pthread_mutex_unlock(&repl->lock);
+    return WTC_OK;
+}
+
+wtc_result_t replication_remove(replication_t *repl, replication_kind_t kind,
+                                const char *key) {
+    if (!repl || !key) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&repl->lock);
+    int h = find_entry(repl, (uint16_t)kind, key);
+    if (h >= 0 && repl->entries[h].live) {
+        repl->entries[h].live = false;
+        mark_dirty(repl, h);
+    }
+    pthread_mutex_unlock(&repl->lock);
+    return h >= 0 ? WTC_OK : WTC_ERROR_NOT_FOUND;
+}
+
+void replication_expire(replication_t *repl, replication_kind_t kind) {
+    if (!repl || kind <= 0 || kind >= REPLICATION_KIND_COUNT) return;
+
+    pthread_mutex_lock(&repl->lock);
+    uint32_t current = repl->kind_generation[kind];
+    for (int h = 0; h < repl->entry_limit; h++) {
+        entry_t *e = &repl->entries[h];
+        if (e->in_use && e->live && e->kind == kind && e->generation != current) {
+            e->live = false;
+            mark_dirty(repl, h);
+        }
+    }
+    repl->kind_generation[kind] = current + 1;
+    pthread_mutex_unlock(&repl->lock);
+}
+
+wtc_result_t replication_append(replication_t *repl, replication_kind_t kind,
+                                const void *data, size_t len) {
+    if (!repl || !data || len > MAX_APPEND_RECORD) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&repl->lock);
+    if (repl->role != REPLICATION_PRIMARY) {
+        pthread_mutex_unlock(&repl->lock);
+        return WTC_ERROR_BUSY;
+    }
+
+    int queue = repl->config.append_queue;
+    if (repl->append_count == queue) {
+        repl->append_head = (repl->append_head + 1) % queue;
+        repl->append_count--;
+        if (repl->stats.connected) {
+            repl->stats.appends_dropped++;
+        }
+    }
+    append_slot_t *slot = &repl->appends[(repl->append_head + repl->append_count) % queue];
+    slot->kind = (uint16_t)kind;
+    slot->len = (uint16_t)len;
+    memcpy(slot->data, data, len);
+    repl->append_count++;
+    pthread_mutex_unlock(&repl->lock);
+    return WTC_OK;
+}
+
+wtc_result_t replication_get_stats(replication_t *repl, replication_stats_t *stats) {
+    if (!repl || !stats) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&repl->lock);
+    *stats = repl->stats;
+    stats->role = repl->role;
+    pthread_mutex_unlock(&repl->lock);
+    return WTC_OK;
+}
@@ -0,0 +1,175 @@
+/*
+ * Water Treatment Controller - Hot-Standby Replication
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Streams controller state from a primary to a standby controller over
+ * TCP so the standby can take over without a cold start.
+ *
+ * State is a set of keyed records (kind + key -> bytes) plus an append
+ * stream for data that is not keyed, such as historian samples. The
+ * primary publishes records as they change; a sender thread ships what
+ * changed since the last batch. A record the standby already holds is
+ * sent as a patch of the bytes that differ. Every frame carries a
+ * sequence number and a CRC; on any gap the standby reconnects and the
+ * primary starts the stream with a full snapshot.
+ *
+ * Both sides prove a shared key when they connect: each sends a nonce
+ * and a keyed MAC of both nonces. The primary serves one standby at a
+ * time and refuses further connections while it has one.
+ *
+ * Takeover is fenced by a lease. Each acknowledgement renews the
+ * primary's lease from the time it sent the frame acknowledged; when
+ * lease_ms passes without one, the primary demotes itself so its
+ * outputs stop before the standby, which waits the longer takeover_ms
+ * of silence, promotes. A standby only takes over by itself after it
+ * has followed a primary, and a primary that never had a standby holds
+ * no lease. Either side stopping says so first: a stopped primary hands
+ * over at once, a stopped standby releases the lease. A primary that
+ * loses its standby any other way cannot tell a crash from a partition
+ * and fences itself too.
+ *
+ * After promotion the standby serves replication on listen_port, and a
+ * demoted primary follows peer_host if set, so the old primary can
+ * rejoin as the new standby.
+ */
+
+#ifndef WTC_REPLICATION_H
+#define WTC_REPLICATION_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REPLICATION_DEFAULT_PORT        4850
+#define REPLICATION_MAX_KEY             64
+#define REPLICATION_MAX_RECORD          1024
+
+typedef struct replication replication_t;
+
+typedef enum {
+    REPLICATION_PRIMARY = 0,
+    REPLICATION_STANDBY,
+} replication_role_t;
+
+/* Record kinds used by the controller */
+typedef enum {
+    REPLICATION_KIND_SENSOR = 1,        /* key station/slot, replication_sensor_t */
+    REPLICATION_KIND_ACTUATOR,          /* key station/slot, replication_actuator_t */
+    REPLICATION_KIND_PID,               /* key loop id, pid_loop_t */
+    REPLICATION_KIND_ALARM,             /* key alarm id, alarm_t */
+    REPLICATION_KIND_HISTORIAN,         /* appended, historian_sample_t */
+    REPLICATION_KIND_COUNT
+} replication_kind_t;
+
+typedef struct {
+    char station[WTC_MAX_STATION_NAME];
+    int slot;
+    float value;
+    iops_t status;
+    data_quality_t quality;
+} replication_sensor_t;
+
+typedef struct {
+    char station[WTC_MAX_STATION_NAME];
+    int slot;
+    actuator_output_t output;
+} replication_actuator_t;
+
+typedef struct {
+    replication_role_t role;
+    uint16_t listen_port;           /* Primary: serve standbys here (0 = default) */
+    char bind_addr[64];             /* Primary: IPv4 address to serve on (empty = loopback) */
+    char peer_host[64];             /* Standby: primary to follow */
+    uint16_t peer_port;
+    char auth_key[64];              /* Shared secret of primary and standby; required */
+    uint32_t batch_ms;              /* Primary: send period for changes */
+    uint32_t heartbeat_ms;          /* Primary: idle keepalive period */
+    uint32_t takeover_ms;           /* Standby: silence before promotion */
+    uint32_t lease_ms;              /* Primary: unacknowledged time before fencing
+                                     * (0 = takeover_ms / 2; below takeover_ms) */
+    int append_queue;               /* Appended records held while behind */
+} replication_config_t;
+
+/* Standby: apply one record. removed is set when the key was deleted.
+ * Appended records have an empty key. */
+typedef void (*replication_apply_fn)(replication_kind_t kind, const char *key,
+                                     const void *data, size_t len, bool removed,
+                                     void *ctx);
+
+/* Standby: called once, from the replication thread, on promotion */
+typedef void (*replication_promote_fn)(void *ctx);
+
+/* Primary: called from the replication thread when the lease is lost.
+ * Outputs must stop within takeover_ms - lease_ms. */
+typedef void (*replication_demote_fn)(void *ctx);
+
+typedef struct {
+    replication_role_t role;
+    bool connected;
+    uint64_t seq;                   /* Last sequence sent or applied */
+    uint64_t acked_seq;             /* Primary: last sequence the standby applied */
+    uint64_t records;               /* Records sent or applied */
+    uint64_t delta_records;         /* Of which sent as patches */
+    uint64_t bytes;                 /* Frame bytes sent or received */
+    uint64_t full_bytes;            /* Bytes the same records take unpatched */
+    uint64_t snapshots;             /* Full snapshots sent or received */
+    uint64_t appends_dropped;       /* Appended records lost while behind */
+    uint64_t promotions;
+    uint64_t demotions;             /* Leases lost */
+    uint64_t auth_failures;         /* Peers that failed the key check */
+    uint64_t last_frame_ms;
+} replication_stats_t;
+
+/* Initialize replication */
+wtc_result_t replication_init(replication_t **repl, const replication_config_t *config);
+
+/* Cleanup replication */
+void replication_cleanup(replication_t *repl);
+
+/* Start the replication thread */
+wtc_result_t replication_start(replication_t *repl);
+
+/* Stop the replication thread */
+wtc_result_t replication_stop(replication_t *repl);
+
+/* Standby callbacks; set before start */
+void replication_set_apply_callback(replication_t *repl, replication_apply_fn fn, void *ctx);
+void replication_set_promote_callback(replication_t *repl, replication_promote_fn fn, void *ctx);
+void replication_set_demote_callback(replication_t *repl, replication_demote_fn fn, void *ctx);
+
+/* Current role; a standby becomes primary on promotion, a primary
+ * becomes standby when it loses its lease */
+replication_role_t replication_get_role(replication_t *repl);
+
+/* Take over now instead of waiting for the primary to go silent */
+wtc_result_t replication_promote(replication_t *repl);
+
+/* ============== Publishing (primary) ============== */
+
+/* Set the value of a keyed record; unchanged values cost a compare */
+wtc_result_t replication_publish(replication_t *repl, replication_kind_t kind,
+                                 const char *key, const void *data, size_t len);
+
+/* Delete a keyed record */
+wtc_result_t replication_remove(replication_t *repl, replication_kind_t kind,
+                                const char *key);
+
+/* Delete the records of a kind not published since the previous call.
+ * Lets callers publish a full list each pass without tracking removals. */
+void replication_expire(replication_t *repl, replication_kind_t kind);
+
+/* Queue an unkeyed record; the oldest are dropped when the queue is full */
+wtc_result_t replication_append(replication_t *repl, replication_kind_t kind,
+                                const void *data, size_t len);
+
+/* Get statistics */
+wtc_result_t replication_get_stats(replication_t *repl, replication_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_REPLICATION_H */
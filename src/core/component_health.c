@@ -187,8 +187,8 @@ void health_report_failure(health_monitor_t *monitor,
             LOG_WARN("Component %s is UNHEALTHY (%u consecutive failures)",
                      info->name, info->consecutive_failures);
 
-            /* Open circuit breaker */
-            if (info->circuit == CIRCUIT_CLOSED) {
+            /* Open circuit breaker; a failed half-open test reopens it */
+            if (info->circuit != CIRCUIT_OPEN) {
                 info->circuit = CIRCUIT_OPEN;
                 LOG_WARN("Circuit breaker for %s opened", info->name);
             }
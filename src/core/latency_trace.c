@@ -0,0 +1,296 @@
+/*
+ * Water Treatment Controller - Sensor-to-Actuator Latency Tracing
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "latency_trace.h"
+#include "utils/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+
+/* Highest octave with its own buckets; longer latencies share the last */
+#define MAX_OCTAVE  35
+
+/* One stage histogram */
+typedef struct {
+    uint32_t buckets[LATENCY_HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t min_us;
+    uint64_t max_us;
+} stage_hist_t;
+
+/* One path; histograms are allocated when the path is first recorded */
+typedef struct {
+    uint32_t trace_id;              /* 0 = free slot */
+    stage_hist_t *stages;           /* [LATENCY_STAGE_COUNT] */
+} trace_path_t;
+
+struct latency_trace {
+    trace_path_t paths[LATENCY_MAX_PATHS];   /* Open addressing on trace_id */
+    int path_count;
+    pthread_mutex_t lock;
+};
+
+static const char *stage_names[LATENCY_STAGE_COUNT] = {
+    [LATENCY_STAGE_INPUT] = "input",
+    [LATENCY_STAGE_COMPUTE] = "compute",
+    [LATENCY_STAGE_IMAGE] = "image",
+    [LATENCY_STAGE_SEND] = "send",
+    [LATENCY_STAGE_TOTAL] = "total",
+};
+
+int latency_trace_bucket(uint64_t latency_us) {
+    if (latency_us < 4) {
+        return (int)latency_us;
+    }
+
+    int octave = 63 - __builtin_clzll(latency_us);
+    if (octave > MAX_OCTAVE) {
+        return LATENCY_HIST_BUCKETS - 1;
+    }
+    int sub = (int)((latency_us >> (octave - 2)) & 3);
+    return 4 * (octave - 1) + sub;
+}
+
+uint64_t latency_trace_bucket_upper(int bucket) {
+    if (bucket < 4) {
+        return bucket < 0 ? 0 : (uint64_t)bucket;
+    }
+    if (bucket >= LATENCY_HIST_BUCKETS) {
+        bucket = LATENCY_HIST_BUCKETS - 1;
+    }
+
+    int octave = bucket / 4 + 1;
+    int sub = bucket % 4;
+    return ((uint64_t)(5 + sub) << (octave - 2)) - 1;
+}
+
+/* Find a path, or the free slot it would go in (lock held) */
+static trace_path_t *find_path_locked(latency_trace_t *trace, uint32_t trace_id) {
+    uint32_t hash = trace_id * 2654435761u;
+    for (int probe = 0; probe < LATENCY_MAX_PATHS; probe++) {
+        trace_path_t *path = &trace->paths[(hash + (uint32_t)probe) % LATENCY_MAX_PATHS];
+        if (path->trace_id == trace_id || path->trace_id == 0) {
+            return path;
+        }
+    }
+    return NULL;
+}
+
+static void summarize(const stage_hist_t *hist, latency_summary_t *summary) {
+    memset(summary, 0, sizeof(*summary));
+    if (hist->count == 0) {
+        return;
+    }
+
+    summary->count = hist->count;
+    summary->min_us = hist->min_us;
+    summary->max_us = hist->max_us;
+    summary->mean_us = hist->sum_us / hist->count;
+
+    const struct {
+        double fraction;
+        uint64_t *out;
+    } ranks[] = {
+        {0.50, &summary->p50_us},
+        {0.90, &summary->p90_us},
+        {0.99, &summary->p99_us},
+        {0.999, &summary->p999_us},
+    };
+
+    uint64_t seen = 0;
+    size_t next = 0;
+    for (int b = 0; b < LATENCY_HIST_BUCKETS && next < sizeof(ranks) / sizeof(ranks[0]); b++) {
+        seen += hist->buckets[b];
+        while (next < sizeof(ranks) / sizeof(ranks[0]) &&
+               (double)seen >= ranks[next].fraction * (double)hist->count) {
+            uint64_t upper = latency_trace_bucket_upper(b);
+            *ranks[next].out = upper < hist->max_us ? upper : hist->max_us;
+            next++;
+        }
+    }
+}
+
+wtc_result_t latency_trace_init(latency_trace_t **trace) {
+    if (!trace) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    latency_trace_t *lt = calloc(1, sizeof(latency_trace_t));
+    if (!lt) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    pthread_mutex_init(&lt->lock, NULL);
+
+    *trace = lt;
+    LOG_INFO("Latency tracing enabled");
+    return WTC_OK;
+}
+
+void latency_trace_cleanup(latency_trace_t *trace) {
+    if (!trace) return;
+
+    for (int i = 0; i < LATENCY_MAX_PATHS; i++) {
+        free(trace->paths[i].stages);
+    }
+    pthread_mutex_destroy(&trace->lock);
+    free(trace);
+}
+
+wtc_result_t latency_trace_record(latency_trace_t *trace,
+                                   uint32_t trace_id,
+                                   latency_stage_t stage,
+                                   uint64_t latency_us) {
+    if (!trace || trace_id == 0 || stage < 0 || stage >= LATENCY_STAGE_COUNT) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&trace->lock);
+
+    trace_path_t *path = find_path_locked(trace, trace_id);
+    if (!path) {
+        pthread_mutex_unlock(&trace->lock);
+        return WTC_ERROR_FULL;
+    }
+
+    if (path->trace_id == 0) {
+        path->stages = calloc(LATENCY_STAGE_COUNT, sizeof(stage_hist_t));
+        if (!path->stages) {
+            pthread_mutex_unlock(&trace->lock);
+            return WTC_ERROR_NO_MEMORY;
+        }
+        path->trace_id = trace_id;
+        trace->path_count++;
+    }
+
+    stage_hist_t *hist = &path->stages[stage];
+    hist->buckets[latency_trace_bucket(latency_us)]++;
+    if (hist->count == 0 || latency_us < hist->min_us) {
+        hist->min_us = latency_us;
+    }
+    if (latency_us > hist->max_us) {
+        hist->max_us = latency_us;
+    }
+    hist->count++;
+    hist->sum_us += latency_us;
+
+    pthread_mutex_unlock(&trace->lock);
+    return WTC_OK;
+}
+
+wtc_result_t latency_trace_get_summary(latency_trace_t *trace,
+                                        uint32_t trace_id,
+                                        latency_stage_t stage,
+                                        latency_summary_t *summary) {
+    if (!trace || !summary || trace_id == 0 ||
+        stage < 0 || stage >= LATENCY_STAGE_COUNT) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&trace->lock);
+
+    trace_path_t *path = find_path_locked(trace, trace_id);
+    if (!path || path->trace_id != trace_id) {
+        pthread_mutex_unlock(&trace->lock);
+        return WTC_ERROR_NOT_FOUND;
+    }
+    summarize(&path->stages[stage], summary);
+
+    pthread_mutex_unlock(&trace->lock);
+    return WTC_OK;
+}
+
+static int compare_ids(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+int latency_trace_list_paths(latency_trace_t *trace, uint32_t *trace_ids, int max_count) {
+    if (!trace || !trace_ids || max_count <= 0) {
+        return 0;
+    }
+
+    uint32_t ids[LATENCY_MAX_PATHS];
+    int count = 0;
+
+    pthread_mutex_lock(&trace->lock);
+    for (int i = 0; i < LATENCY_MAX_PATHS; i++) {
+        if (trace->paths[i].trace_id != 0) {
+            ids[count++] = trace->paths[i].trace_id;
+        }
+    }
+    pthread_mutex_unlock(&trace->lock);
+
+    qsort(ids, (size_t)count, sizeof(ids[0]), compare_ids);
+    if (count > max_count) {
+        count = max_count;
+    }
+    memcpy(trace_ids, ids, (size_t)count * sizeof(ids[0]));
+    return count;
+}
+
+void latency_trace_reset(latency_trace_t *trace) {
+    if (!trace) return;
+
+    pthread_mutex_lock(&trace->lock);
+    for (int i = 0; i < LATENCY_MAX_PATHS; i++) {
+        if (trace->paths[i].stages) {
+            memset(trace->paths[i].stages, 0, LATENCY_STAGE_COUNT * sizeof(stage_hist_t));
+        }
+    }
+    pthread_mutex_unlock(&trace->lock);
+}
+
+void latency_trace_log_summary(latency_trace_t *trace) {
+    if (!trace) return;
+
+    uint32_t ids[LATENCY_MAX_PATHS];
+    int count = latency_trace_list_paths(trace, ids, LATENCY_MAX_PATHS);
+
+    for (int i = 0; i < count; i++) {
+        latency_summary_t total;
+        if (latency_trace_get_summary(trace, ids[i], LATENCY_STAGE_TOTAL, &total) != WTC_OK ||
+            total.count == 0) {
+            continue;
+        }
+
+        char name[32];
+        latency_trace_path_name(ids[i], name, sizeof(name));
+        LOG_INFO("Latency %s: n=%llu p50=%lluus p99=%lluus max=%lluus",
+                 name,
+                 (unsigned long long)total.count,
+                 (unsigned long long)total.p50_us,
+                 (unsigned long long)total.p99_us,
+                 (unsigned long long)total.max_us);
+    }
+}
+
+void latency_trace_path_name(uint32_t trace_id, char *buf, size_t size) {
+    if (!buf || size == 0) return;
+
+    switch (LATENCY_TRACE_KIND(trace_id)) {
+    case LATENCY_PATH_PID:
+        snprintf(buf, size, "pid %d", LATENCY_TRACE_LOOP(trace_id));
+        break;
+    case LATENCY_PATH_INTERLOCK:
+        snprintf(buf, size, "interlock %d", LATENCY_TRACE_LOOP(trace_id));
+        break;
+    default:
+        snprintf(buf, size, "path 0x%08x", trace_id);
+        break;
+    }
+}
+
+const char *latency_trace_stage_name(latency_stage_t stage) {
+    if (stage >= 0 && stage < LATENCY_STAGE_COUNT) {
+        return stage_names[stage];
+    }
+    return "unknown";
+}
@@ -0,0 +1,114 @@
+/*
+ * Water Treatment Controller - Sensor-to-Actuator Latency Tracing
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Measures how long a sensor value takes to come back out as an
+ * actuator command. The receive, registry, control and cyclic threads
+ * are decoupled by polling, so the latency is carried as timestamps:
+ *
+ *   recv thread    stamps each input with its receive time (rx_time_us)
+ *   control scan   reads the input, computes the loop and writes the
+ *                  output with the input's receive time (source_time_us)
+ *   output image   copies the output into the AR's output IOCR buffer
+ *   cyclic thread  sends the frame and closes the trace
+ *
+ * Each control loop is one path (LATENCY_TRACE_ID). A path keeps one
+ * log-linear histogram per stage: four buckets per power of two, so
+ * percentiles are within 25 % up to hours of latency. All timestamps
+ * come from time_get_monotonic_us(). Tracing is off unless a tracer is
+ * attached to the control engine and the PROFINET controller or
+ * simulator.
+ */
+
+#ifndef WTC_LATENCY_TRACE_H
+#define WTC_LATENCY_TRACE_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_MAX_PATHS       256
+#define LATENCY_HIST_BUCKETS    140
+
+/* Path kinds; the trace id of a loop packs the kind with its id */
+typedef enum {
+    LATENCY_PATH_NONE = 0,
+    LATENCY_PATH_PID,
+    LATENCY_PATH_INTERLOCK,
+} latency_path_kind_t;
+
+#define LATENCY_TRACE_ID(kind, id)  (((uint32_t)(kind) << 24) | ((uint32_t)(id) & 0xFFFFFFu))
+#define LATENCY_TRACE_KIND(trace_id) ((latency_path_kind_t)((trace_id) >> 24))
+#define LATENCY_TRACE_LOOP(trace_id) ((int)((trace_id) & 0xFFFFFFu))
+
+/* Stages of a path, in pipeline order */
+typedef enum {
+    LATENCY_STAGE_INPUT = 0,    /* Input received -> read by the control scan */
+    LATENCY_STAGE_COMPUTE,      /* Scan read -> output written to the registry */
+    LATENCY_STAGE_IMAGE,        /* Registry output -> copied into the output image */
+    LATENCY_STAGE_SEND,         /* Output image -> cyclic frame sent */
+    LATENCY_STAGE_TOTAL,        /* Input received -> cyclic frame sent */
+    LATENCY_STAGE_COUNT
+} latency_stage_t;
+
+/* Summary of one stage histogram; percentiles are bucket upper bounds
+ * capped at the largest sample */
+typedef struct {
+    uint64_t count;
+    uint64_t min_us;
+    uint64_t max_us;
+    uint64_t mean_us;
+    uint64_t p50_us;
+    uint64_t p90_us;
+    uint64_t p99_us;
+    uint64_t p999_us;
+} latency_summary_t;
+
+/* Latency tracer handle */
+typedef struct latency_trace latency_trace_t;
+
+/* Initialize tracer */
+wtc_result_t latency_trace_init(latency_trace_t **trace);
+
+/* Cleanup tracer */
+void latency_trace_cleanup(latency_trace_t *trace);
+
+/* Record one latency sample. Thread-safe; the path is created on first
+ * use. Returns WTC_ERROR_FULL once LATENCY_MAX_PATHS paths exist. */
+wtc_result_t latency_trace_record(latency_trace_t *trace,
+                                   uint32_t trace_id,
+                                   latency_stage_t stage,
+                                   uint64_t latency_us);
+
+/* Summarize a stage of a path */
+wtc_result_t latency_trace_get_summary(latency_trace_t *trace,
+                                        uint32_t trace_id,
+                                        latency_stage_t stage,
+                                        latency_summary_t *summary);
+
+/* List traced paths in id order; returns the number copied */
+int latency_trace_list_paths(latency_trace_t *trace, uint32_t *trace_ids, int max_count);
+
+/* Drop all samples */
+void latency_trace_reset(latency_trace_t *trace);
+
+/* Log the end-to-end summary of every path */
+void latency_trace_log_summary(latency_trace_t *trace);
+
+/* Names for reports ("pid 3", "interlock 1"; "input", "send", ...) */
+void latency_trace_path_name(uint32_t trace_id, char *buf, size_t size);
+const char *latency_trace_stage_name(latency_stage_t stage);
+
+/* Histogram bucket of a latency and the bounds of a bucket, exposed for
+ * tests and reports */
+int latency_trace_bucket(uint64_t latency_us);
+uint64_t latency_trace_bucket_upper(int bucket);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_LATENCY_TRACE_H */
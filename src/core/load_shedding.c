@@ -0,0 +1,378 @@
+/*
+ * Water Treatment Controller - Load Shedding Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "load_shedding.h"
+#include "utils/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* Default configuration */
+#define DEFAULT_STEP_UP_MS      2000
+#define DEFAULT_STEP_DOWN_MS    10000
+#define DEFAULT_TRIP_WINDOWS    2
+
+/* Component entry */
+typedef struct {
+    load_shed_policy_t policy;
+    uint32_t latency_us;         /* EWMA, alpha 1/8 */
+    bool has_sample;
+    bool fresh;                  /* Sampled since the last evaluation */
+    int over_count;              /* Consecutive over-budget samples */
+    bool over;                   /* over_count reached trip_windows */
+    bool failing;                /* Failure reported to the health monitor */
+
+    /* Previous cumulative cycle statistics */
+    bool has_totals;
+    uint64_t last_count;
+    uint64_t last_total_us;
+    uint64_t last_overruns;
+
+    uint8_t step;                /* Read without the lock */
+} shed_entry_t;
+
+/* Load shedder structure */
+struct load_shedder {
+    load_shed_config_t config;
+    health_monitor_t *monitor;
+    shed_entry_t entries[COMPONENT_COUNT];
+
+    int level;
+    int max_level;
+    bool overloaded;
+    uint64_t last_change_ms;
+    uint64_t last_overload_ms;
+    uint32_t level_changes;
+
+    load_shed_callback_t callback;
+    void *callback_ctx;
+
+    pthread_mutex_t lock;
+};
+
+/* Default policy: protect I/O and control, shed the historian first */
+static const load_shed_policy_t default_policies[COMPONENT_COUNT] = {
+    [COMPONENT_PROFINET]       = { .priority = 0 },
+    [COMPONENT_REGISTRY]       = { .priority = 0 },
+    [COMPONENT_CONTROL_ENGINE] = { .priority = 0 },
+    [COMPONENT_ALARM_MANAGER]  = { .priority = 1 },
+    [COMPONENT_FAILOVER]       = { .priority = 1 },
+    [COMPONENT_MODBUS]         = { .priority = 2 },
+    [COMPONENT_IPC_SERVER]     = { .priority = 3, .budget_us = 20000 },
+    [COMPONENT_DATABASE]       = { .priority = 3, .budget_us = 50000, .stop_step = 1 },
+    [COMPONENT_HISTORIAN]      = { .priority = 4 },
+};
+
+static void update_max_level(load_shedder_t *shedder) {
+    shedder->max_level = 0;
+    for (int i = 0; i < COMPONENT_COUNT; i++) {
+        if (shedder->entries[i].policy.priority > shedder->max_level) {
+            shedder->max_level = shedder->entries[i].policy.priority;
+        }
+    }
+}
+
+/* Public API */
+
+wtc_result_t load_shed_init(load_shedder_t **shedder,
+                             health_monitor_t *monitor,
+                             const load_shed_config_t *config) {
+    if (!shedder) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    load_shedder_t *ls = calloc(1, sizeof(load_shedder_t));
+    if (!ls) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    if (config) {
+        ls->config = *config;
+    } else {
+        ls->config.step_up_ms = DEFAULT_STEP_UP_MS;
+        ls->config.step_down_ms = DEFAULT_STEP_DOWN_MS;
+        ls->config.trip_windows = DEFAULT_TRIP_WINDOWS;
+    }
+    if (ls->config.trip_windows < 1) {
+        ls->config.trip_windows = 1;
+    }
+
+    ls->monitor = monitor;
+    for (int i = 0; i < COMPONENT_COUNT; i++) {
+        ls->entries[i].policy = default_policies[i];
+    }
+    update_max_level(ls);
+    pthread_mutex_init(&ls->lock, NULL);
+
+    *shedder = ls;
+    LOG_INFO("Load shedder initialized (step_up=%ums, step_down=%ums)",
+             ls->config.step_up_ms, ls->config.step_down_ms);
+
+    return WTC_OK;
+}
+
+void load_shed_cleanup(load_shedder_t *shedder) {
+    if (!shedder) return;
+
+    pthread_mutex_destroy(&shedder->lock);
+    free(shedder);
+    LOG_DEBUG("Load shedder cleaned up");
+}
+
+wtc_result_t load_shed_set_policy(load_shedder_t *shedder,
+                                   component_id_t id,
+                                   const load_shed_policy_t *policy) {
+    if (!shedder || id >= COMPONENT_COUNT || !policy) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&shedder->lock);
+    shedder->entries[id].policy = *policy;
+    update_max_level(shedder);
+    pthread_mutex_unlock(&shedder->lock);
+
+    return WTC_OK;
+}
+
+void load_shed_set_callback(load_shedder_t *shedder,
+                             load_shed_callback_t callback,
+                             void *ctx) {
+    if (!shedder) return;
+
+    pthread_mutex_lock(&shedder->lock);
+    shedder->callback = callback;
+    shedder->callback_ctx = ctx;
+    pthread_mutex_unlock(&shedder->lock);
+}
+
+/* Fold one sample into a component's state; lock held */
+static void add_sample(load_shedder_t *shedder, shed_entry_t *entry,
+                       uint64_t latency_us, bool overrun) {
+    if (latency_us > UINT32_MAX) {
+        latency_us = UINT32_MAX;
+    }
+
+    if (entry->has_sample) {
+        int64_t diff = (int64_t)latency_us - (int64_t)entry->latency_us;
+        entry->latency_us = (uint32_t)((int64_t)entry->latency_us + diff / 8);
+    } else {
+        entry->latency_us = (uint32_t)latency_us;
+        entry->has_sample = true;
+    }
+    entry->fresh = true;
+
+    bool over_budget = overrun ||
+        (entry->policy.budget_us > 0 && entry->latency_us > entry->policy.budget_us);
+    entry->over_count = over_budget ? entry->over_count + 1 : 0;
+    entry->over = entry->over_count >= shedder->config.trip_windows;
+}
+
+void load_shed_report_latency(load_shedder_t *shedder,
+                               component_id_t id,
+                               uint64_t latency_us) {
+    if (!shedder || id >= COMPONENT_COUNT) return;
+
+    pthread_mutex_lock(&shedder->lock);
+    add_sample(shedder, &shedder->entries[id], latency_us, false);
+    pthread_mutex_unlock(&shedder->lock);
+}
+
+void load_shed_report_cycles(load_shedder_t *shedder,
+                              component_id_t id,
+                              uint64_t count,
+                              uint64_t total_us,
+                              uint64_t overruns) {
+    if (!shedder || id >= COMPONENT_COUNT) return;
+
+    pthread_mutex_lock(&shedder->lock);
+
+    shed_entry_t *entry = &shedder->entries[id];
+    /* A counter going backwards (restarted component) starts over */
+    if (entry->has_totals && count > entry->last_count &&
+        total_us >= entry->last_total_us && overruns >= entry->last_overruns) {
+        /* Average over the cycles since the previous report */
+        uint64_t window_avg = (total_us - entry->last_total_us) / (count - entry->last_count);
+        add_sample(shedder, entry, window_avg, overruns > entry->last_overruns);
+    }
+
+    entry->has_totals = true;
+    entry->last_count = count;
+    entry->last_total_us = total_us;
+    entry->last_overruns = overruns;
+
+    pthread_mutex_unlock(&shedder->lock);
+}
+
+/* Drive a sheddable component's circuit breaker; lock held */
+static void update_breaker(load_shedder_t *shedder, component_id_t id) {
+    shed_entry_t *entry = &shedder->entries[id];
+    circuit_state_t circuit = health_get_circuit(shedder->monitor, id);
+
+    if (circuit == CIRCUIT_OPEN) {
+        /* Judge the half-open test call on its own */
+        entry->has_sample = false;
+        entry->over_count = 0;
+        entry->over = false;
+        entry->fresh = false;
+        return;
+    }
+    if (!entry->fresh) {
+        return;
+    }
+    entry->fresh = false;
+
+    bool over = circuit == CIRCUIT_HALF_OPEN
+        ? entry->latency_us > entry->policy.budget_us
+        : entry->over;
+
+    if (over) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "latency %uus over budget %uus",
+                 entry->latency_us, entry->policy.budget_us);
+        health_report_failure(shedder->monitor, id, WTC_ERROR_TIMEOUT, msg);
+        entry->failing = true;
+    } else if (entry->failing || circuit == CIRCUIT_HALF_OPEN) {
+        health_report_success(shedder->monitor, id);
+        entry->failing = false;
+    }
+}
+
+/* Protected components are reported degraded, never failed, so running
+ * slow does not block control; lock held */
+static void update_protected(load_shedder_t *shedder, component_id_t id) {
+    shed_entry_t *entry = &shedder->entries[id];
+    if (entry->over != entry->failing) {
+        health_set_state(shedder->monitor, id,
+                         entry->over ? HEALTH_DEGRADED : HEALTH_HEALTHY);
+        entry->failing = entry->over;
+    }
+}
+
+wtc_result_t load_shed_evaluate(load_shedder_t *shedder, uint64_t now_ms) {
+    if (!shedder) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&shedder->lock);
+
+    bool overloaded = false;
+    for (int i = 0; i < COMPONENT_COUNT; i++) {
+        shed_entry_t *entry = &shedder->entries[i];
+        if (entry->policy.priority == 0) {
+            overloaded |= entry->over;
+            if (shedder->monitor) {
+                update_protected(shedder, (component_id_t)i);
+            }
+        } else if (shedder->monitor && entry->policy.budget_us > 0) {
+            update_breaker(shedder, (component_id_t)i);
+        }
+    }
+
+    /* Step up while overloaded, step down after a calm period */
+    int level = shedder->level;
+    if (overloaded) {
+        shedder->last_overload_ms = now_ms;
+        if (level < shedder->max_level &&
+            (level == 0 || now_ms - shedder->last_change_ms >= shedder->config.step_up_ms)) {
+            level++;
+        }
+    } else if (level > 0 &&
+               now_ms - shedder->last_overload_ms >= shedder->config.step_down_ms &&
+               now_ms - shedder->last_change_ms >= shedder->config.step_down_ms) {
+        level--;
+    }
+
+    if (overloaded != shedder->overloaded) {
+        shedder->overloaded = overloaded;
+        if (overloaded) {
+            LOG_WARN("Controller overloaded, shedding low-priority work");
+        }
+    }
+
+    int changed[COMPONENT_COUNT];
+    int changed_count = 0;
+
+    if (level != shedder->level) {
+        LOG_WARN("Load shed level %d -> %d", shedder->level, level);
+        shedder->level = level;
+        shedder->last_change_ms = now_ms;
+        shedder->level_changes++;
+
+        for (int i = 0; i < COMPONENT_COUNT; i++) {
+            shed_entry_t *entry = &shedder->entries[i];
+            int step = 0;
+            if (entry->policy.priority > 0) {
+                step = level - (shedder->max_level - entry->policy.priority);
+                if (step < 0) step = 0;
+            }
+            if (step != entry->step) {
+                __atomic_store_n(&entry->step, (uint8_t)step, __ATOMIC_RELAXED);
+                changed[changed_count++] = i;
+            }
+        }
+    }
+
+    load_shed_callback_t callback = shedder->callback;
+    void *callback_ctx = shedder->callback_ctx;
+
+    pthread_mutex_unlock(&shedder->lock);
+
+    for (int i = 0; i < changed_count; i++) {
+        int step = shedder->entries[changed[i]].step;
+        LOG_INFO("Component %s shed step %d", health_component_name(changed[i]), step);
+        if (callback) {
+            callback((component_id_t)changed[i], step, callback_ctx);
+        }
+    }
+
+    return WTC_OK;
+}
+
+bool load_shed_allow(load_shedder_t *shedder, component_id_t id) {
+    if (!shedder || id >= COMPONENT_COUNT) return true;
+
+    const shed_entry_t *entry = &shedder->entries[id];
+    uint8_t step = __atomic_load_n(&entry->step, __ATOMIC_RELAXED);
+    if (entry->policy.stop_step > 0 && step >= entry->policy.stop_step) {
+        return false;
+    }
+
+    if (shedder->monitor && entry->policy.priority > 0 && entry->policy.budget_us > 0) {
+        return health_circuit_allow(shedder->monitor, id);
+    }
+    return true;
+}
+
+uint32_t load_shed_divisor(load_shedder_t *shedder, component_id_t id) {
+    if (!shedder || id >= COMPONENT_COUNT) return 1;
+
+    uint8_t step = __atomic_load_n(&shedder->entries[id].step, __ATOMIC_RELAXED);
+    uint32_t divisor = 1u << (step < 8 ? step : 8);
+    return divisor < LOAD_SHED_MAX_DIVISOR ? divisor : LOAD_SHED_MAX_DIVISOR;
+}
+
+wtc_result_t load_shed_get_status(load_shedder_t *shedder,
+                                   load_shed_status_t *status) {
+    if (!shedder || !status) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&shedder->lock);
+
+    memset(status, 0, sizeof(*status));
+    status->level = shedder->level;
+    status->overloaded = shedder->overloaded;
+    status->last_change_ms = shedder->last_change_ms;
+    status->level_changes = shedder->level_changes;
+    for (int i = 0; i < COMPONENT_COUNT; i++) {
+        status->step[i] = shedder->entries[i].step;
+        status->latency_us[i] = shedder->entries[i].latency_us;
+    }
+
+    pthread_mutex_unlock(&shedder->lock);
+    return WTC_OK;
+}
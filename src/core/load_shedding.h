@@ -0,0 +1,116 @@
+/*
+ * Water Treatment Controller - Load Shedding
+ * Degrades low-priority work under overload
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Built on the health monitor. Each component has a priority and a
+ * latency budget, fed from the component's own timing statistics:
+ * - Protected components (priority 0: PROFINET cycle, control scan)
+ *   are never shed. When they run over budget the controller is
+ *   overloaded and the shed level rises one step at a time.
+ * - Other components are shed highest priority value first. Each step
+ *   halves a component's rate; at its stop step its work is skipped.
+ * - A sheddable component over its own budget trips its circuit breaker
+ *   in the health monitor, independently of the shed level.
+ * Once the protected components stay within budget, the level steps
+ * back down.
+ */
+
+#ifndef WTC_LOAD_SHEDDING_H
+#define WTC_LOAD_SHEDDING_H
+
+#include "types.h"
+#include "component_health.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOAD_SHED_MAX_DIVISOR   16
+
+/* Load shedder handle */
+typedef struct load_shedder load_shedder_t;
+
+/* Per-component policy */
+typedef struct {
+    uint8_t priority;            /* 0 = protected; higher is shed first */
+    uint32_t budget_us;          /* Latency budget (0 = not monitored) */
+    uint8_t stop_step;           /* Shed step at which work stops (0 = never) */
+} load_shed_policy_t;
+
+/* Load shedder configuration */
+typedef struct {
+    uint32_t step_up_ms;         /* Minimum time between degradation steps */
+    uint32_t step_down_ms;       /* Time within budget before each recovery step */
+    int trip_windows;            /* Consecutive over-budget reports to trip */
+} load_shed_config_t;
+
+/* Load shedding status */
+typedef struct {
+    int level;                   /* Current shed level, 0 = full service */
+    bool overloaded;             /* A protected component is over budget */
+    uint64_t last_change_ms;
+    uint32_t level_changes;
+    uint8_t step[COMPONENT_COUNT];       /* Shed step per component */
+    uint32_t latency_us[COMPONENT_COUNT]; /* Smoothed latency per component */
+} load_shed_status_t;
+
+/* Called from load_shed_evaluate() when a component's shed step changes */
+typedef void (*load_shed_callback_t)(component_id_t id, int step, void *ctx);
+
+/* Initialize load shedder (config NULL for defaults) */
+wtc_result_t load_shed_init(load_shedder_t **shedder,
+                             health_monitor_t *monitor,
+                             const load_shed_config_t *config);
+
+/* Cleanup load shedder */
+void load_shed_cleanup(load_shedder_t *shedder);
+
+/* Set policy for a component */
+wtc_result_t load_shed_set_policy(load_shedder_t *shedder,
+                                   component_id_t id,
+                                   const load_shed_policy_t *policy);
+
+/* Set callback for shed step changes */
+void load_shed_set_callback(load_shedder_t *shedder,
+                             load_shed_callback_t callback,
+                             void *ctx);
+
+/* ============== Timing Input ============== */
+
+/* Report the duration of one operation */
+void load_shed_report_latency(load_shedder_t *shedder,
+                               component_id_t id,
+                               uint64_t latency_us);
+
+/* Report a component's cumulative cycle statistics (count, total time,
+ * overruns). The average and overruns since the previous report are used
+ * as one sample. */
+void load_shed_report_cycles(load_shedder_t *shedder,
+                              component_id_t id,
+                              uint64_t count,
+                              uint64_t total_us,
+                              uint64_t overruns);
+
+/* ============== Policy ============== */
+
+/* Update overload state and shed level (call from main loop) */
+wtc_result_t load_shed_evaluate(load_shedder_t *shedder, uint64_t now_ms);
+
+/* Should the component do its work now? False when shed to its stop
+ * step or when its circuit breaker is open. */
+bool load_shed_allow(load_shedder_t *shedder, component_id_t id);
+
+/* Rate divisor for the component: 1 at full service, doubling per step */
+uint32_t load_shed_divisor(load_shedder_t *shedder, component_id_t id);
+
+/* Get status */
+wtc_result_t load_shed_get_status(load_shedder_t *shedder,
+                                   load_shed_status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_LOAD_SHEDDING_H */
@@ -5,6 +5,14 @@
  */
 
 #include "historian.h"
+#include "historian_store.h"
+#include "historian_export.h"
+#include "historian_import.h"
+#include "historian_retention.h"
+#include "historian_wal.h"
+#include "sample_scheduler.h"
+#include "historian_chunk.h"
+#include "tag_index.h"
 #include "registry/rtu_registry.h"
 #include "utils/logger.h"
 #include "utils/time_utils.h"
@@ -13,48 +21,179 @@
 #include <string.h>
 #include <stdio.h>
 #include <pthread.h>
+#include <sched.h>
 #include <math.h>
 
 /* Default buffer size */
 #define DEFAULT_BUFFER_SIZE 1000
 
-/* Tag buffer structure */
-typedef struct {
-    historian_sample_t *samples;
-    int capacity;
-    int count;
-    int write_pos;
-} tag_buffer_t;
+/* Longest the collector sleeps when no tag is due sooner */
+#define COLLECT_IDLE_MS 100
+
+/* Default retention sweep period */
+#define DEFAULT_RETENTION_INTERVAL_MS 3600000
 
-/* Internal tag structure */
+/* Default period between background flushes */
+#define DEFAULT_FLUSH_INTERVAL_MS 10000
+
+/* Default WAL group commit period */
+#define DEFAULT_WAL_COMMIT_MS 200
+
+/* Per-tag state read on every collection pass and id lookup. Names and
+ * statistics live in the parallel historian->tag_info array so this one
+ * stays small and dense. */
 typedef struct {
-    historian_tag_t info;
-    tag_buffer_t buffer;
+    int tag_id;
+    int station;                    /* Index into historian->stations */
+    int slot;
+    uint32_t sample_rate_ms;
+    float deadband;
     float last_stored_value;
-    uint64_t last_sample_time_ms;
+    compression_t compression;
     bool enabled;
+    uint8_t last_quality;           /* Of tag_info.last_value, under info_seq */
+    uint32_t info_seq;              /* Seqlock over the tag_info statistics */
+    historian_chunk_buffer_t buffer;
 } historian_tag_internal_t;
 
-/* Historian structure */
+/* RTU station referenced by one or more tags */
+typedef struct {
+    char name[WTC_MAX_STATION_NAME];
+    int refs;
+} station_entry_t;
+
+/* Sealed samples of one tag waiting for the I/O thread */
+typedef struct flush_job {
+    struct flush_job *next;
+    int tag_id;
+    historian_chunk_t *chunks;
+    int count;
+    uint64_t wal_seq;               /* WAL files <= this hold the samples */
+} flush_job_t;
+
+/* Tag popped off the schedule for the current collection pass */
+typedef struct {
+    int tag;
+    int station;
+    uint64_t due_ms;
+} due_tag_t;
+
+/* Historian structure
+ *
+ * lock serializes the writers: collection, record_sample and tag table
+ * changes. Readers never take it. They hold table_lock shared, which
+ * only tag table changes take exclusively, read per-tag state through
+ * the buffer and tag_info seqlocks, and copy queued samples under the
+ * short io_lock, so a query cannot stall a collection pass. Disk writes
+ * happen on the I/O thread, and queries read the store beside it. */
 struct historian {
     historian_config_t config;
     rtu_registry_t *registry;
+    historian_sample_observer_t observer;
+    void *observer_ctx;
+    uint32_t rate_divisor;          /* Sample periods are multiplied by this (0 = 1) */
 
-    /* Tags */
+    /* Tags: hot state and cold metadata, indexed by tag handle */
     historian_tag_internal_t *tags;
-    int tag_count;
+    historian_tag_t *tag_info;
+    tag_index_t *index;
+    historian_chunk_pool_t *chunk_pool;
     int tag_capacity;
     int next_tag_id;
 
+    /* Sampling schedule, keyed by tag handle */
+    sample_scheduler_t *scheduler;
+    station_entry_t *stations;
+    int station_count;
+
+    /* historian_process scratch, sized to tag_capacity */
+    sample_slot_t *due_slots;
+    due_tag_t *due;
+    int *due_sensor_slots;
+    sensor_data_t *due_sensors;
+    bool *due_found;
+
     /* Thread management */
     pthread_t collect_thread;
+    pthread_t retention_thread;
     volatile bool running;
     pthread_mutex_t lock;
+    pthread_rwlock_t table_lock;
+
+    /* Flush queue; io_write_lock is held by whoever is writing it out */
+    pthread_t io_thread;
+    pthread_mutex_t io_lock;
+    pthread_mutex_t io_write_lock;
+    pthread_cond_t io_cond;
+    pthread_cond_t io_done;
+    flush_job_t *io_head;
+    flush_job_t *io_tail;
+    uint64_t io_submitted;
+    uint64_t io_completed;
+    uint64_t io_pending;            /* Samples queued or being written */
+    bool io_draining;               /* Jobs taken off the queue, not yet stored */
+    bool io_running;
+
+    /* Write-ahead log; files up to wal_sealed_seq hold only sealed samples */
+    historian_wal_t *wal;
+    uint64_t wal_sealed_seq;
+
+    /* Serializes retention sweeps; retention_cond wakes the sweeper on stop */
+    pthread_mutex_t retention_lock;
+    pthread_cond_t retention_cond;
 
     /* Statistics */
     historian_stats_t stats;
 };
 
+/* Directory holding the segment files */
+static const char *historian_data_dir(const historian_t *historian) {
+    return historian->config.database_path ?
+           historian->config.database_path : HISTORIAN_DEFAULT_DATA_DIR;
+}
+
+/* Statistics are updated by the collector and the I/O thread and read
+ * without the writer lock */
+#define STAT_ADD(h, field, n) __atomic_fetch_add(&(h)->stats.field, (n), __ATOMIC_RELAXED)
+#define STAT_SUB(h, field, n) __atomic_fetch_sub(&(h)->stats.field, (n), __ATOMIC_RELAXED)
+#define STAT_GET(h, field)    __atomic_load_n(&(h)->stats.field, __ATOMIC_RELAXED)
+
+/* Writer side of a tag's tag_info seqlock; lock held */
+static void tag_info_begin(historian_tag_internal_t *tag) {
+    __atomic_store_n(&tag->info_seq, tag->info_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void tag_info_end(historian_tag_internal_t *tag) {
+    __atomic_store_n(&tag->info_seq, tag->info_seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Tag table changes exclude both the writers and the readers */
+static void table_write_lock(historian_t *historian) {
+    pthread_mutex_lock(&historian->lock);
+    pthread_rwlock_wrlock(&historian->table_lock);
+}
+
+static void table_write_unlock(historian_t *historian) {
+    pthread_rwlock_unlock(&historian->table_lock);
+    pthread_mutex_unlock(&historian->lock);
+}
+
+/* Consistent copy of a tag's metadata and statistics; table_lock held */
+static void read_tag_info(historian_t *historian, int handle, historian_tag_t *out) {
+    const historian_tag_internal_t *tag = &historian->tags[handle];
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&tag->info_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+        memcpy(out, &historian->tag_info[handle], sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&tag->info_seq, __ATOMIC_RELAXED) == seq) return;
+    }
+}
+
 /* Swinging door compression (reserved for batch compression) */
 __attribute__((unused))
 static bool swinging_door_compress(float last_value, float current_value,
@@ -70,70 +209,351 @@ static bool swinging_door_compress(float last_value, float current_value,
     return error <= deadband;
 }
 
-/* Initialize tag buffer */
-static wtc_result_t init_tag_buffer(tag_buffer_t *buffer, int capacity) {
-    buffer->samples = calloc(capacity, sizeof(historian_sample_t));
-    if (!buffer->samples) {
-        return WTC_ERROR_NO_MEMORY;
+static bool spill_tag(historian_t *historian, historian_tag_internal_t *tag);
+
+/* Add sample to a tag's buffer; lock held */
+static void buffer_add_sample(historian_t *historian, historian_tag_internal_t *tag,
+                              uint64_t timestamp_ms, float value, uint8_t quality) {
+    historian_sample_t sample = {
+        .timestamp_ms = timestamp_ms,
+        .tag_id = tag->tag_id,
+        .value = value,
+        .quality = quality,
+    };
+    if (historian->wal && historian_wal_append(historian->wal, &sample) != WTC_OK) {
+        LOG_ERROR("Historian WAL append failed for tag %d", tag->tag_id);
+    }
+    if (historian->observer) {
+        historian->observer(&sample, historian->observer_ctx);
     }
-    buffer->capacity = capacity;
-    buffer->count = 0;
-    buffer->write_pos = 0;
-    return WTC_OK;
-}
 
-/* Free tag buffer */
-static void free_tag_buffer(tag_buffer_t *buffer) {
-    free(buffer->samples);
-    buffer->samples = NULL;
-    buffer->capacity = 0;
-    buffer->count = 0;
-}
+    /* A full buffer goes to the writer rather than losing its oldest sample */
+    if (tag->buffer.count >= tag->buffer.capacity &&
+        historian->config.overflow == HISTORIAN_OVERFLOW_SPILL) {
+        spill_tag(historian, tag);
+    }
 
-/* Add sample to buffer */
-static void buffer_add_sample(tag_buffer_t *buffer, const historian_sample_t *sample,
-                               int tag_id) {
-    if (!buffer->samples) return;
+    bool overflow = false;
+    int before = tag->buffer.count;
+    if (historian_chunk_buffer_push(&tag->buffer, historian->chunk_pool, timestamp_ms,
+                                    value, quality, &overflow) != WTC_OK) {
+        LOG_ERROR("Out of memory buffering historian tag %d", tag->tag_id);
+        return;
+    }
+    if (tag->buffer.count > before) {
+        STAT_ADD(historian, samples_in_buffer, 1);
+    }
 
     /* HIST-H3 fix: Log warning when ring buffer overflows */
-    bool overflow = (buffer->count >= buffer->capacity);
     if (overflow) {
+        STAT_ADD(historian, samples_dropped, 1);
         static uint64_t last_overflow_log_ms = 0;
         uint64_t now_ms = time_get_ms();
         /* Rate-limit overflow logging to once per minute */
         if (now_ms - last_overflow_log_ms > 60000) {
             LOG_WARN("Historian ring buffer overflow for tag %d - oldest samples being dropped",
-                     tag_id);
+                     tag->tag_id);
             last_overflow_log_ms = now_ms;
         }
     }
+}
+
+/* Intern an RTU station name; returns its index or -1 if the table is full */
+static int station_acquire(historian_t *historian, const char *name) {
+    int free_slot = -1;
+    for (int i = 0; i < historian->station_count; i++) {
+        if (historian->stations[i].refs == 0) {
+            if (free_slot < 0) free_slot = i;
+        } else if (strcmp(historian->stations[i].name, name) == 0) {
+            historian->stations[i].refs++;
+            return i;
+        }
+    }
 
-    memcpy(&buffer->samples[buffer->write_pos], sample, sizeof(historian_sample_t));
-    buffer->write_pos = (buffer->write_pos + 1) % buffer->capacity;
-    if (buffer->count < buffer->capacity) {
-        buffer->count++;
+    if (free_slot < 0) {
+        if (historian->station_count >= historian->tag_capacity) return -1;
+        free_slot = historian->station_count++;
     }
+
+    station_entry_t *entry = &historian->stations[free_slot];
+    memset(entry->name, 0, sizeof(entry->name));
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    entry->refs = 1;
+    return free_slot;
+}
+
+/* Seal every non-empty buffer and queue it for writing. Returns the
+ * ticket that historian_flush waits on. */
+static uint64_t flush_submit(historian_t *historian) {
+    flush_job_t *head = NULL;
+    flush_job_t *tail = NULL;
+    uint64_t sealed = 0;
+
+    pthread_mutex_lock(&historian->lock);
+
+    /* Every sample logged so far is in a buffer sealed below */
+    uint64_t wal_seq = historian_wal_rotate(historian->wal);
+
+    for (int h = 0; h < tag_index_limit(historian->index); h++) {
+        historian_tag_internal_t *tag = &historian->tags[h];
+        if (!tag_index_in_use(historian->index, h) || tag->buffer.count == 0) continue;
+
+        flush_job_t *job = malloc(sizeof(flush_job_t));
+        if (!job) {
+            LOG_ERROR("Out of memory flushing historian tag %d", tag->tag_id);
+            continue;
+        }
+        job->next = NULL;
+        job->tag_id = tag->tag_id;
+        job->chunks = historian_chunk_buffer_seal(&tag->buffer, &job->count);
+        job->wal_seq = wal_seq;
+        sealed += job->count;
+
+        if (tail) {
+            tail->next = job;
+        } else {
+            head = job;
+        }
+        tail = job;
+    }
+    STAT_SUB(historian, samples_in_buffer, sealed);
+
+    /* Queue before unlocking so a spill cannot overtake these jobs */
+    pthread_mutex_lock(&historian->io_lock);
+    if (head) {
+        if (historian->io_tail) {
+            historian->io_tail->next = head;
+        } else {
+            historian->io_head = head;
+        }
+        historian->io_tail = tail;
+    }
+    historian->io_pending += sealed;
+    historian->wal_sealed_seq = wal_seq;
+    uint64_t ticket = ++historian->io_submitted;
+    pthread_cond_signal(&historian->io_cond);
+    pthread_mutex_unlock(&historian->io_lock);
+
+    pthread_mutex_unlock(&historian->lock);
+    return ticket;
+}
+
+/* Queue one full buffer for writing. Refused once the writer is this
+ * far behind, which leaves the caller to drop. lock held. */
+static bool spill_tag(historian_t *historian, historian_tag_internal_t *tag) {
+    uint64_t limit = (uint64_t)historian->config.buffer_size * historian->tag_capacity;
+
+    pthread_mutex_lock(&historian->io_lock);
+    if (historian->io_pending + (uint64_t)tag->buffer.count > limit) {
+        pthread_mutex_unlock(&historian->io_lock);
+        return false;
+    }
+
+    flush_job_t *job = malloc(sizeof(flush_job_t));
+    if (!job) {
+        pthread_mutex_unlock(&historian->io_lock);
+        return false;
+    }
+    job->next = NULL;
+    job->tag_id = tag->tag_id;
+    job->chunks = historian_chunk_buffer_seal(&tag->buffer, &job->count);
+    job->wal_seq = historian_wal_active_seq(historian->wal);
+
+    if (historian->io_tail) {
+        historian->io_tail->next = job;
+    } else {
+        historian->io_head = job;
+    }
+    historian->io_tail = job;
+    historian->io_pending += job->count;
+    historian->io_submitted++;
+    pthread_cond_signal(&historian->io_cond);
+    pthread_mutex_unlock(&historian->io_lock);
+
+    STAT_SUB(historian, samples_in_buffer, (uint64_t)job->count);
+    STAT_ADD(historian, samples_spilled, (uint64_t)job->count);
+    return true;
+}
+
+/* Write out everything queued so far. Jobs that fail stay queued for
+ * the next flush. */
+static void flush_drain(historian_t *historian) {
+    pthread_mutex_lock(&historian->io_write_lock);
+
+    pthread_mutex_lock(&historian->io_lock);
+    uint64_t ticket = historian->io_submitted;
+    flush_job_t *jobs = historian->io_head;
+    historian->io_head = NULL;
+    historian->io_tail = NULL;
+    historian->io_draining = true;
+    pthread_mutex_unlock(&historian->io_lock);
+
+    const char *data_dir = historian_data_dir(historian);
+    historian_sample_t *ordered = NULL;
+    int ordered_capacity = 0;
+    uint64_t total_flushed = 0;
+    uint64_t total_bytes = 0;
+    flush_job_t *written = NULL;
+    flush_job_t *retry = NULL;
+    flush_job_t *retry_last = NULL;
+
+    while (jobs) {
+        flush_job_t *job = jobs;
+        jobs = job->next;
+        job->next = NULL;
+
+        bool ok = false;
+        if (ordered_capacity < job->count) {
+            historian_sample_t *grown = realloc(ordered, job->count * sizeof(historian_sample_t));
+            if (grown) {
+                ordered = grown;
+                ordered_capacity = job->count;
+            }
+        }
+        if (ordered_capacity >= job->count) {
+            /* Sealed chunks are immutable, so no lock is needed */
+            historian_chunk_chain_copy(job->chunks, job->tag_id, ordered, job->count);
+
+            uint64_t bytes = 0;
+            if (historian_store_append(data_dir, job->tag_id, ordered,
+                                       job->count, &bytes) == WTC_OK) {
+                total_flushed += job->count;
+                total_bytes += bytes;
+                ok = true;
+            }
+        } else {
+            LOG_ERROR("Out of memory flushing historian tag %d", job->tag_id);
+        }
+
+        if (ok) {
+            job->next = written;
+            written = job;
+        } else {
+            if (retry_last) {
+                retry_last->next = job;
+            } else {
+                retry = job;
+            }
+            retry_last = job;
+        }
+    }
+    free(ordered);
+
+    /* Hand the chunks back to the pool */
+    if (written) {
+        pthread_mutex_lock(&historian->lock);
+        for (flush_job_t *job = written; job; job = job->next) {
+            historian_chunk_pool_release(historian->chunk_pool, job->chunks);
+        }
+        pthread_mutex_unlock(&historian->lock);
+        while (written) {
+            flush_job_t *next = written->next;
+            free(written);
+            written = next;
+        }
+    }
+
+    STAT_ADD(historian, samples_flushed, total_flushed);
+    STAT_ADD(historian, storage_bytes, total_bytes);
+
+    pthread_mutex_lock(&historian->io_lock);
+    if (retry) {
+        retry_last->next = historian->io_head;
+        if (!historian->io_head) {
+            historian->io_tail = retry_last;
+        }
+        historian->io_head = retry;
+    }
+    historian->io_pending -= total_flushed;
+    historian->io_completed = ticket;
+    historian->io_draining = false;
+
+    /* Log files are dropped once nothing they hold is still queued */
+    uint64_t wal_upto = historian->wal_sealed_seq;
+    for (flush_job_t *job = historian->io_head; job; job = job->next) {
+        if (job->wal_seq <= wal_upto) {
+            wal_upto = job->wal_seq - 1;
+        }
+    }
+    pthread_cond_broadcast(&historian->io_done);
+    pthread_mutex_unlock(&historian->io_lock);
+
+    historian_wal_release(historian->wal, wal_upto);
+
+    pthread_mutex_unlock(&historian->io_write_lock);
+
+    if (total_flushed > 0) {
+        LOG_INFO("Historian flushed %llu samples to disk", (unsigned long long)total_flushed);
+    }
+}
+
+/* I/O thread function */
+static void *io_thread_func(void *arg) {
+    historian_t *historian = (historian_t *)arg;
+
+    LOG_DEBUG("Historian I/O thread started");
+
+    pthread_mutex_lock(&historian->io_lock);
+    for (;;) {
+        /* Wake for queued work, and every commit period for the WAL */
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        time_add_ms(&deadline, historian->config.wal_commit_ms);
+        while (historian->io_running &&
+               historian->io_completed == historian->io_submitted) {
+            if (historian->wal) {
+                if (pthread_cond_timedwait(&historian->io_cond, &historian->io_lock,
+                                           &deadline) != 0) break;
+            } else {
+                pthread_cond_wait(&historian->io_cond, &historian->io_lock);
+            }
+        }
+        bool work = historian->io_completed != historian->io_submitted;
+        if (!work && !historian->io_running) break;
+
+        pthread_mutex_unlock(&historian->io_lock);
+        historian_wal_commit(historian->wal);
+        if (work) {
+            flush_drain(historian);
+        }
+        pthread_mutex_lock(&historian->io_lock);
+    }
+    pthread_mutex_unlock(&historian->io_lock);
+
+    LOG_DEBUG("Historian I/O thread stopped");
+    return NULL;
 }
 
 /* Collection thread function */
 static void *collect_thread_func(void *arg) {
     historian_t *historian = (historian_t *)arg;
-    uint64_t next_collect_ms = time_get_monotonic_ms();
 
     LOG_DEBUG("Historian collection thread started");
 
+    uint64_t next_flush = time_get_monotonic_ms() + historian->config.flush_interval_ms;
     while (historian->running) {
         pthread_mutex_lock(&historian->lock);
         historian_process(historian);
+        uint64_t next_due = 0;
+        bool scheduled = historian->registry &&
+                         sample_scheduler_next(historian->scheduler, &next_due);
         pthread_mutex_unlock(&historian->lock);
 
-        /* Sleep until next collection */
-        next_collect_ms += 100; /* 100ms base rate */
+        /* Sealing is cheap; the I/O thread does the writing */
+        if (time_get_monotonic_ms() >= next_flush) {
+            flush_submit(historian);
+            next_flush = time_get_monotonic_ms() + historian->config.flush_interval_ms;
+        }
+
+        /* Sleep until the next tag is due, but wake at least every
+         * COLLECT_IDLE_MS to notice new tags and stop requests */
         uint64_t now = time_get_monotonic_ms();
-        if (now < next_collect_ms) {
-            time_sleep_ms(next_collect_ms - now);
-        } else {
-            next_collect_ms = now + 100;
+        uint64_t wake = now + COLLECT_IDLE_MS;
+        if (scheduled && next_due < wake) {
+            wake = next_due;
+        }
+        if (wake > now) {
+            time_sleep_ms(wake - now);
         }
     }
 
@@ -141,6 +561,154 @@ static void *collect_thread_func(void *arg) {
     return NULL;
 }
 
+/* Sweep the store with the given raw retention; retention_lock held */
+static wtc_result_t run_retention_sweep(historian_t *historian, int retention_days) {
+    historian_retention_policy_t policy = {
+        .raw_days = retention_days,
+        .max_storage_bytes = historian->config.max_storage_bytes,
+    };
+    for (int t = 0; t < HISTORIAN_ROLLUP_TIERS; t++) {
+        policy.rollup_days[t] = historian->config.rollup_retention_days[t];
+    }
+
+    historian_retention_result_t result;
+    wtc_result_t res = historian_retention_sweep(historian_data_dir(historian), &policy,
+                                                 time_get_ms(), &result);
+    if (res != WTC_OK) {
+        LOG_ERROR("Historian retention sweep failed: %d", res);
+        return res;
+    }
+
+    /* Apply only the sweep's own change: batches flushed while it ran have
+     * already been added */
+    int64_t delta = result.rollup_bytes_added - (int64_t)result.bytes_reclaimed;
+    if (delta >= 0) {
+        STAT_ADD(historian, storage_bytes, (uint64_t)delta);
+    } else {
+        STAT_SUB(historian, storage_bytes, (uint64_t)-delta);
+    }
+    STAT_ADD(historian, bytes_reclaimed, result.bytes_reclaimed);
+    STAT_ADD(historian, segments_purged, (uint64_t)result.segments_removed);
+
+    if (result.segments_removed > 0 || result.rollups_written > 0) {
+        LOG_INFO("Historian retention: %d rollups written, %d files removed, %llu bytes reclaimed",
+                 result.rollups_written, result.segments_removed,
+                 (unsigned long long)result.bytes_reclaimed);
+    }
+    return WTC_OK;
+}
+
+/* Retention thread function */
+static void *retention_thread_func(void *arg) {
+    historian_t *historian = (historian_t *)arg;
+
+    LOG_DEBUG("Historian retention thread started");
+
+    pthread_mutex_lock(&historian->retention_lock);
+    while (historian->running) {
+        run_retention_sweep(historian, historian->config.retention_days);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        time_add_ms(&deadline, historian->config.retention_interval_ms);
+        while (historian->running &&
+               pthread_cond_timedwait(&historian->retention_cond,
+                                      &historian->retention_lock, &deadline) == 0) {
+        }
+    }
+    pthread_mutex_unlock(&historian->retention_lock);
+
+    LOG_DEBUG("Historian retention thread stopped");
+    return NULL;
+}
+
+static int compare_tag_time(const void *a, const void *b) {
+    const historian_sample_t *sa = a;
+    const historian_sample_t *sb = b;
+    if (sa->tag_id != sb->tag_id) return sa->tag_id < sb->tag_id ? -1 : 1;
+    if (sa->timestamp_ms != sb->timestamp_ms) return sa->timestamp_ms < sb->timestamp_ms ? -1 : 1;
+    return 0;
+}
+
+/* Write the samples left in the WAL by the previous run as sorted runs.
+ * Some may already be in their segments; readers drop the duplicates. */
+static wtc_result_t wal_replay(historian_t *historian, historian_sample_t *samples, int count) {
+    const char *data_dir = historian_data_dir(historian);
+    qsort(samples, count, sizeof(historian_sample_t), compare_tag_time);
+
+    for (int start = 0; start < count; ) {
+        uint64_t day = samples[start].timestamp_ms / HISTORIAN_MS_PER_DAY;
+        int end = start + 1;
+        while (end < count && samples[end].tag_id == samples[start].tag_id &&
+               samples[end].timestamp_ms / HISTORIAN_MS_PER_DAY == day) {
+            end++;
+        }
+
+        uint64_t bytes = 0;
+        wtc_result_t res = historian_store_write_run(data_dir, samples[start].tag_id,
+                                                     &samples[start], end - start, &bytes);
+        if (res != WTC_OK) {
+            return res;
+        }
+        STAT_ADD(historian, storage_bytes, bytes);
+        start = end;
+    }
+    return WTC_OK;
+}
+
+/* Open the WAL, replaying whatever the previous run left in it. The
+ * historian keeps running without a WAL if it cannot be opened. */
+static void wal_open_and_recover(historian_t *historian) {
+    const char *data_dir = historian_data_dir(historian);
+    if (historian_wal_open(&historian->wal, data_dir,
+                           historian->config.wal_file_bytes) != WTC_OK) {
+        LOG_ERROR("Failed to open historian WAL in %s, samples are not logged", data_dir);
+        historian->wal = NULL;
+        return;
+    }
+
+    historian_sample_t *samples = NULL;
+    int count = 0;
+    uint64_t last_seq = 0;
+    wtc_result_t res = historian_wal_recover(historian->wal, &samples, &count, &last_seq);
+    if (res == WTC_OK && count > 0) {
+        res = wal_replay(historian, samples, count);
+    }
+    free(samples);
+
+    if (res != WTC_OK) {
+        /* Leave the files for the next start rather than release them */
+        LOG_ERROR("Historian WAL replay failed: %d, samples are not logged", res);
+        historian_wal_close(historian->wal);
+        historian->wal = NULL;
+        return;
+    }
+
+    historian_wal_release(historian->wal, last_seq);
+    STAT_ADD(historian, samples_recovered, (uint64_t)count);
+    if (count > 0) {
+        LOG_INFO("Recovered %d historian samples from the WAL", count);
+    }
+}
+
+/* Start storage_bytes from what is already on disk; the flush and
+ * retention paths keep it current from there */
+static void seed_storage_bytes(historian_t *historian) {
+    historian_store_file_t *files = NULL;
+    int count = 0;
+    if (historian_store_scan(historian_data_dir(historian), &files, &count) != WTC_OK) {
+        LOG_WARN("Historian could not size the store; storage_bytes starts at 0");
+        return;
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += files[i].size;
+    }
+    free(files);
+    STAT_ADD(historian, storage_bytes, total);
+}
+
 /* Public functions */
 
 wtc_result_t historian_init(historian_t **historian,
@@ -171,17 +739,67 @@ wtc_result_t historian_init(historian_t **historian,
     if (hist->config.retention_days == 0) {
         hist->config.retention_days = 365;
     }
+    if (hist->config.rollup_retention_days[HISTORIAN_ROLLUP_MINUTE] == 0) {
+        hist->config.rollup_retention_days[HISTORIAN_ROLLUP_MINUTE] =
+            hist->config.retention_days * 2;
+    }
+    if (hist->config.rollup_retention_days[HISTORIAN_ROLLUP_HOUR] == 0) {
+        hist->config.rollup_retention_days[HISTORIAN_ROLLUP_HOUR] =
+            hist->config.retention_days * 5;
+    }
+    if (hist->config.retention_interval_ms == 0) {
+        hist->config.retention_interval_ms = DEFAULT_RETENTION_INTERVAL_MS;
+    }
+    if (hist->config.flush_interval_ms == 0) {
+        hist->config.flush_interval_ms = DEFAULT_FLUSH_INTERVAL_MS;
+    }
+    if (hist->config.wal_commit_ms == 0) {
+        hist->config.wal_commit_ms = DEFAULT_WAL_COMMIT_MS;
+    }
 
     /* Allocate tags array */
     hist->tag_capacity = hist->config.max_tags;
     hist->tags = calloc(hist->tag_capacity, sizeof(historian_tag_internal_t));
-    if (!hist->tags) {
+    hist->tag_info = calloc(hist->tag_capacity, sizeof(historian_tag_t));
+    hist->stations = calloc(hist->tag_capacity, sizeof(station_entry_t));
+    hist->due_slots = calloc(hist->tag_capacity, sizeof(sample_slot_t));
+    hist->due = calloc(hist->tag_capacity, sizeof(due_tag_t));
+    hist->due_sensor_slots = calloc(hist->tag_capacity, sizeof(int));
+    hist->due_sensors = calloc(hist->tag_capacity, sizeof(sensor_data_t));
+    hist->due_found = calloc(hist->tag_capacity, sizeof(bool));
+    if (!hist->tags || !hist->tag_info || !hist->stations || !hist->due_slots || !hist->due ||
+        !hist->due_sensor_slots || !hist->due_sensors || !hist->due_found ||
+        tag_index_init(&hist->index, hist->tag_capacity) != WTC_OK ||
+        sample_scheduler_init(&hist->scheduler, hist->tag_capacity) != WTC_OK ||
+        historian_chunk_pool_init(&hist->chunk_pool) != WTC_OK) {
+        tag_index_cleanup(hist->index);
+        sample_scheduler_cleanup(hist->scheduler);
+        free(hist->tags);
+        free(hist->tag_info);
+        free(hist->stations);
+        free(hist->due_slots);
+        free(hist->due);
+        free(hist->due_sensor_slots);
+        free(hist->due_sensors);
+        free(hist->due_found);
         free(hist);
         return WTC_ERROR_NO_MEMORY;
     }
 
     hist->next_tag_id = 1;
     pthread_mutex_init(&hist->lock, NULL);
+    pthread_rwlock_init(&hist->table_lock, NULL);
+    pthread_mutex_init(&hist->io_lock, NULL);
+    pthread_mutex_init(&hist->io_write_lock, NULL);
+    pthread_cond_init(&hist->io_cond, NULL);
+    pthread_cond_init(&hist->io_done, NULL);
+    pthread_mutex_init(&hist->retention_lock, NULL);
+    pthread_cond_init(&hist->retention_cond, NULL);
+
+    seed_storage_bytes(hist);
+    if (hist->config.wal_enabled) {
+        wal_open_and_recover(hist);
+    }
 
     *historian = hist;
     LOG_INFO("Historian initialized (max_tags=%d, buffer_size=%d)",
@@ -193,19 +811,54 @@ void historian_cleanup(historian_t *historian) {
     if (!historian) return;
 
     historian_stop(historian);
+    historian_wal_close(historian->wal);
 
     /* Free tag buffers */
-    for (int i = 0; i < historian->tag_count; i++) {
-        free_tag_buffer(&historian->tags[i].buffer);
+    for (int h = 0; h < tag_index_limit(historian->index); h++) {
+        if (!tag_index_in_use(historian->index, h)) continue;
+        historian_chunk_buffer_clear(&historian->tags[h].buffer, historian->chunk_pool);
+    }
+
+    /* Jobs whose writes kept failing; their chunks go with the pool */
+    while (historian->io_head) {
+        flush_job_t *next = historian->io_head->next;
+        free(historian->io_head);
+        historian->io_head = next;
     }
 
     pthread_mutex_destroy(&historian->lock);
+    pthread_rwlock_destroy(&historian->table_lock);
+    pthread_mutex_destroy(&historian->io_lock);
+    pthread_mutex_destroy(&historian->io_write_lock);
+    pthread_cond_destroy(&historian->io_cond);
+    pthread_cond_destroy(&historian->io_done);
+    pthread_mutex_destroy(&historian->retention_lock);
+    pthread_cond_destroy(&historian->retention_cond);
+    sample_scheduler_cleanup(historian->scheduler);
+    tag_index_cleanup(historian->index);
+    historian_chunk_pool_cleanup(historian->chunk_pool);
+    free(historian->tag_info);
+    free(historian->stations);
+    free(historian->due_slots);
+    free(historian->due);
+    free(historian->due_sensor_slots);
+    free(historian->due_sensors);
+    free(historian->due_found);
     free(historian->tags);
     free(historian);
 
     LOG_INFO("Historian cleaned up");
 }
 
+/* Let the I/O thread drain its queue and exit */
+static void stop_io_thread(historian_t *historian) {
+    pthread_mutex_lock(&historian->io_lock);
+    historian->io_running = false;
+    pthread_cond_signal(&historian->io_cond);
+    pthread_mutex_unlock(&historian->io_lock);
+    pthread_join(historian->io_thread, NULL);
+}
+
 wtc_result_t historian_start(historian_t *historian) {
     if (!historian) {
         return WTC_ERROR_INVALID_PARAM;
@@ -215,12 +868,29 @@ wtc_result_t historian_start(historian_t *historian) {
         return WTC_OK;
     }
 
+    historian->io_running = true;
+    if (pthread_create(&historian->io_thread, NULL, io_thread_func, historian) != 0) {
+        LOG_ERROR("Failed to create historian I/O thread");
+        historian->io_running = false;
+        return WTC_ERROR;
+    }
+
     historian->running = true;
 
     if (pthread_create(&historian->collect_thread, NULL,
                        collect_thread_func, historian) != 0) {
         LOG_ERROR("Failed to create historian thread");
         historian->running = false;
+        stop_io_thread(historian);
+        return WTC_ERROR;
+    }
+
+    if (pthread_create(&historian->retention_thread, NULL,
+                       retention_thread_func, historian) != 0) {
+        LOG_ERROR("Failed to create historian retention thread");
+        historian->running = false;
+        pthread_join(historian->collect_thread, NULL);
+        stop_io_thread(historian);
         return WTC_ERROR;
     }
 
@@ -233,11 +903,17 @@ wtc_result_t historian_stop(historian_t *historian) {
         return WTC_OK;
     }
 
+    pthread_mutex_lock(&historian->retention_lock);
     historian->running = false;
+    pthread_cond_signal(&historian->retention_cond);
+    pthread_mutex_unlock(&historian->retention_lock);
+
     pthread_join(historian->collect_thread, NULL);
+    pthread_join(historian->retention_thread, NULL);
 
     /* Flush remaining data */
     historian_flush(historian);
+    stop_io_thread(historian);
 
     LOG_INFO("Historian stopped");
     return WTC_OK;
@@ -256,6 +932,22 @@ wtc_result_t historian_set_registry(historian_t *historian,
     return WTC_OK;
 }
 
+void historian_set_sample_observer(historian_t *historian,
+                                   historian_sample_observer_t observer,
+                                   void *ctx) {
+    if (!historian) return;
+
+    pthread_mutex_lock(&historian->lock);
+    historian->observer = observer;
+    historian->observer_ctx = ctx;
+    pthread_mutex_unlock(&historian->lock);
+}
+
+void historian_set_rate_divisor(historian_t *historian, uint32_t divisor) {
+    if (!historian) return;
+    __atomic_store_n(&historian->rate_divisor, divisor, __ATOMIC_RELAXED);
+}
+
 wtc_result_t historian_add_tag(historian_t *historian,
                                 const char *rtu_station,
                                 int slot,
@@ -268,61 +960,69 @@ wtc_result_t historian_add_tag(historian_t *historian,
         return WTC_ERROR_INVALID_PARAM;
     }
 
-    pthread_mutex_lock(&historian->lock);
+    table_write_lock(historian);
 
-    if (historian->tag_count >= historian->tag_capacity) {
-        pthread_mutex_unlock(&historian->lock);
-        return WTC_ERROR_FULL;
+    /* Check for duplicate */
+    if (tag_index_find_point(historian->index, rtu_station, slot) >= 0) {
+        table_write_unlock(historian);
+        return WTC_ERROR_ALREADY_EXISTS;
     }
 
-    /* Check for duplicate */
-    for (int i = 0; i < historian->tag_count; i++) {
-        if (strcmp(historian->tags[i].info.rtu_station, rtu_station) == 0 &&
-            historian->tags[i].info.slot == slot) {
-            pthread_mutex_unlock(&historian->lock);
-            return WTC_ERROR_ALREADY_EXISTS;
-        }
+    int handle = tag_index_add(historian->index, historian->next_tag_id, rtu_station, slot);
+    if (handle < 0) {
+        table_write_unlock(historian);
+        return WTC_ERROR_FULL;
     }
 
-    historian_tag_internal_t *tag = &historian->tags[historian->tag_count];
+    historian_tag_internal_t *tag = &historian->tags[handle];
+    historian_tag_t *info = &historian->tag_info[handle];
     memset(tag, 0, sizeof(historian_tag_internal_t));
+    memset(info, 0, sizeof(historian_tag_t));
 
-    tag->info.tag_id = historian->next_tag_id++;
-    strncpy(tag->info.rtu_station, rtu_station, WTC_MAX_STATION_NAME - 1);
-    tag->info.slot = slot;
+    info->tag_id = historian->next_tag_id++;
+    strncpy(info->rtu_station, rtu_station, WTC_MAX_STATION_NAME - 1);
+    info->slot = slot;
 
     if (tag_name) {
-        strncpy(tag->info.tag_name, tag_name, sizeof(tag->info.tag_name) - 1);
+        strncpy(info->tag_name, tag_name, sizeof(info->tag_name) - 1);
     } else {
-        snprintf(tag->info.tag_name, sizeof(tag->info.tag_name),
+        snprintf(info->tag_name, sizeof(info->tag_name),
                  "%s.slot%d", rtu_station, slot);
     }
 
-    tag->info.sample_rate_ms = sample_rate_ms > 0 ?
-                               sample_rate_ms : historian->config.default_sample_rate_ms;
-    tag->info.deadband = deadband >= 0 ?
-                         deadband : historian->config.default_deadband;
-    tag->info.compression = compression;
+    info->sample_rate_ms = sample_rate_ms > 0 ?
+                           sample_rate_ms : historian->config.default_sample_rate_ms;
+    info->deadband = deadband >= 0 ?
+                     deadband : historian->config.default_deadband;
+    info->compression = compression;
 
-    /* Initialize buffer */
-    wtc_result_t res = init_tag_buffer(&tag->buffer, historian->config.buffer_size);
-    if (res != WTC_OK) {
-        pthread_mutex_unlock(&historian->lock);
-        return res;
+    tag->station = station_acquire(historian, info->rtu_station);
+    if (tag->station < 0) {
+        tag_index_remove(historian->index, handle);
+        table_write_unlock(historian);
+        return WTC_ERROR_FULL;
     }
 
+    tag->tag_id = info->tag_id;
+    tag->slot = info->slot;
+    tag->sample_rate_ms = info->sample_rate_ms;
+    tag->deadband = info->deadband;
+    tag->compression = info->compression;
+    historian_chunk_buffer_init(&tag->buffer, historian->config.buffer_size);
+
+    /* First sample is due immediately */
+    sample_scheduler_set(historian->scheduler, handle, time_get_monotonic_ms());
+
     tag->enabled = true;
-    historian->tag_count++;
 
     if (tag_id) {
-        *tag_id = tag->info.tag_id;
+        *tag_id = info->tag_id;
     }
 
-    pthread_mutex_unlock(&historian->lock);
-
     LOG_INFO("Added historian tag %d: %s (rate=%u ms, deadband=%.2f)",
-             tag->info.tag_id, tag->info.tag_name, tag->info.sample_rate_ms,
-             tag->info.deadband);
+             info->tag_id, info->tag_name, info->sample_rate_ms, info->deadband);
+
+    table_write_unlock(historian);
     return WTC_OK;
 }
 
@@ -331,26 +1031,24 @@ wtc_result_t historian_remove_tag(historian_t *historian, int tag_id) {
         return WTC_ERROR_INVALID_PARAM;
     }
 
-    pthread_mutex_lock(&historian->lock);
-
-    for (int i = 0; i < historian->tag_count; i++) {
-        if (historian->tags[i].info.tag_id == tag_id) {
-            free_tag_buffer(&historian->tags[i].buffer);
-
-            /* Shift remaining tags */
-            for (int j = i; j < historian->tag_count - 1; j++) {
-                historian->tags[j] = historian->tags[j + 1];
-            }
-            historian->tag_count--;
+    table_write_lock(historian);
 
-            pthread_mutex_unlock(&historian->lock);
-            LOG_INFO("Removed historian tag %d", tag_id);
-            return WTC_OK;
-        }
+    int h = tag_index_find_id(historian->index, tag_id);
+    if (h < 0) {
+        table_write_unlock(historian);
+        return WTC_ERROR_NOT_FOUND;
     }
 
-    pthread_mutex_unlock(&historian->lock);
-    return WTC_ERROR_NOT_FOUND;
+    /* The handle is released for reuse; other tags keep theirs */
+    STAT_SUB(historian, samples_in_buffer, (uint64_t)historian->tags[h].buffer.count);
+    historian_chunk_buffer_clear(&historian->tags[h].buffer, historian->chunk_pool);
+    historian->stations[historian->tags[h].station].refs--;
+    sample_scheduler_remove(historian->scheduler, h);
+    tag_index_remove(historian->index, h);
+
+    table_write_unlock(historian);
+    LOG_INFO("Removed historian tag %d", tag_id);
+    return WTC_OK;
 }
 
 wtc_result_t historian_get_tag(historian_t *historian,
@@ -360,18 +1058,95 @@ wtc_result_t historian_get_tag(historian_t *historian,
         return WTC_ERROR_INVALID_PARAM;
     }
 
-    pthread_mutex_lock(&historian->lock);
+    pthread_rwlock_rdlock(&historian->table_lock);
 
-    for (int i = 0; i < historian->tag_count; i++) {
-        if (historian->tags[i].info.tag_id == tag_id) {
-            memcpy(tag, &historian->tags[i].info, sizeof(historian_tag_t));
-            pthread_mutex_unlock(&historian->lock);
-            return WTC_OK;
-        }
+    int h = tag_index_find_id(historian->index, tag_id);
+    if (h >= 0) {
+        read_tag_info(historian, h, tag);
     }
 
-    pthread_mutex_unlock(&historian->lock);
-    return WTC_ERROR_NOT_FOUND;
+    pthread_rwlock_unlock(&historian->table_lock);
+    return h >= 0 ? WTC_OK : WTC_ERROR_NOT_FOUND;
+}
+
+wtc_result_t historian_find_tag(historian_t *historian,
+                                 const char *rtu_station,
+                                 int slot,
+                                 int *tag_id) {
+    if (!historian || !rtu_station || !tag_id) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_rwlock_rdlock(&historian->table_lock);
+
+    int h = tag_index_find_point(historian->index, rtu_station, slot);
+    if (h >= 0) {
+        *tag_id = historian->tags[h].tag_id;
+    }
+
+    pthread_rwlock_unlock(&historian->table_lock);
+    return h >= 0 ? WTC_OK : WTC_ERROR_NOT_FOUND;
+}
+
+wtc_result_t historian_list_tags(historian_t *historian,
+                                  historian_tag_t **tags,
+                                  int *count,
+                                  int max_count) {
+    if (!historian || !tags || !count) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_rwlock_rdlock(&historian->table_lock);
+
+    int n = tag_index_count(historian->index);
+    if (n > max_count) n = max_count;
+    *tags = n > 0 ? calloc(n, sizeof(historian_tag_t)) : NULL;
+    if (n > 0 && !*tags) {
+        pthread_rwlock_unlock(&historian->table_lock);
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    int i = 0;
+    for (int h = 0; i < n && h < tag_index_limit(historian->index); h++) {
+        if (!tag_index_in_use(historian->index, h)) continue;
+        read_tag_info(historian, h, &(*tags)[i++]);
+    }
+    *count = i;
+
+    pthread_rwlock_unlock(&historian->table_lock);
+    return WTC_OK;
+}
+
+wtc_result_t historian_update_tag(historian_t *historian,
+                                   int tag_id,
+                                   uint32_t sample_rate_ms,
+                                   float deadband,
+                                   compression_t compression) {
+    if (!historian) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    table_write_lock(historian);
+
+    int h = tag_index_find_id(historian->index, tag_id);
+    if (h < 0) {
+        table_write_unlock(historian);
+        return WTC_ERROR_NOT_FOUND;
+    }
+
+    historian_tag_internal_t *tag = &historian->tags[h];
+    historian_tag_t *info = &historian->tag_info[h];
+    info->sample_rate_ms = sample_rate_ms > 0 ?
+                           sample_rate_ms : historian->config.default_sample_rate_ms;
+    info->deadband = deadband >= 0 ?
+                     deadband : historian->config.default_deadband;
+    info->compression = compression;
+    tag->sample_rate_ms = info->sample_rate_ms;
+    tag->deadband = info->deadband;
+    tag->compression = info->compression;
+
+    table_write_unlock(historian);
+    return WTC_OK;
 }
 
 wtc_result_t historian_record_sample(historian_t *historian,
@@ -385,114 +1160,149 @@ wtc_result_t historian_record_sample(historian_t *historian,
 
     pthread_mutex_lock(&historian->lock);
 
-    /* Find tag */
-    historian_tag_internal_t *tag = NULL;
-    for (int i = 0; i < historian->tag_count; i++) {
-        if (historian->tags[i].info.tag_id == tag_id) {
-            tag = &historian->tags[i];
-            break;
-        }
-    }
-
-    if (!tag) {
+    int index = tag_index_find_id(historian->index, tag_id);
+    if (index < 0) {
         pthread_mutex_unlock(&historian->lock);
         return WTC_ERROR_NOT_FOUND;
     }
 
-    /* Create sample */
-    historian_sample_t sample;
-    sample.timestamp_ms = timestamp_ms;
-    sample.tag_id = tag_id;
-    sample.value = value;
-    sample.quality = quality;
+    historian_tag_internal_t *tag = &historian->tags[index];
+    historian_tag_t *info = &historian->tag_info[index];
 
     /* Add to buffer */
-    buffer_add_sample(&tag->buffer, &sample, tag_id);
+    buffer_add_sample(historian, tag, timestamp_ms, value, quality);
 
     /* Update tag stats */
-    tag->info.total_samples++;
-    tag->info.last_value = value;
-    tag->info.last_sample_ms = timestamp_ms;
+    tag_info_begin(tag);
+    info->total_samples++;
+    info->last_value = value;
+    info->last_sample_ms = timestamp_ms;
+    tag->last_quality = quality;
+    tag_info_end(tag);
     tag->last_stored_value = value;
 
-    historian->stats.total_samples++;
+    STAT_ADD(historian, total_samples, 1);
 
     pthread_mutex_unlock(&historian->lock);
     return WTC_OK;
 }
 
+/* Store a freshly read sensor value for a tag, applying compression */
+static void process_tag_sample(historian_t *historian, int index,
+                               const sensor_data_t *sensor, uint64_t now_ms) {
+    historian_tag_internal_t *tag = &historian->tags[index];
+    historian_tag_t *info = &historian->tag_info[index];
+
+    bool store = true;
+    if (tag->compression == COMPRESSION_DEADBAND) {
+        float diff = fabsf(sensor->value - tag->last_stored_value);
+        store = diff >= tag->deadband;
+    } else if (tag->compression == COMPRESSION_SWINGING_DOOR) {
+        /* Need previous values for swinging door */
+        /* Simplified: use deadband for now */
+        float diff = fabsf(sensor->value - tag->last_stored_value);
+        store = diff >= tag->deadband;
+    }
+
+    bool keep = store || info->total_samples == 0;
+    uint8_t quality = sensor->status == IOPS_GOOD ? 192 : 0;
+    if (keep) {
+        /* Add to buffer */
+        buffer_add_sample(historian, tag, now_ms, sensor->value, quality);
+    }
+
+    tag_info_begin(tag);
+    if (keep) {
+        /* Update tag stats */
+        info->total_samples++;
+        info->last_value = sensor->value;
+        info->last_sample_ms = now_ms;
+        tag->last_quality = quality;
+        tag->last_stored_value = sensor->value;
+
+        STAT_ADD(historian, total_samples, 1);
+    } else {
+        info->compressed_samples++;
+    }
+
+    /* Update compression ratio */
+    if (info->total_samples > 0) {
+        info->compression_ratio =
+            (float)(info->total_samples + info->compressed_samples) /
+            (float)info->total_samples;
+    }
+    tag_info_end(tag);
+}
+
+static int compare_due_station(const void *a, const void *b) {
+    const due_tag_t *da = a;
+    const due_tag_t *db = b;
+    if (da->station != db->station) return da->station < db->station ? -1 : 1;
+    return da->tag < db->tag ? -1 : (da->tag > db->tag);
+}
+
+/* Sample every tag whose time has come. Only due tags are touched: they
+ * are popped off the schedule, grouped by RTU so each RTU is read with a
+ * single registry call, and rescheduled one period later. */
 wtc_result_t historian_process(historian_t *historian) {
     if (!historian || !historian->registry) {
         return WTC_ERROR_INVALID_PARAM;
     }
 
     uint64_t now_ms = time_get_ms();
+    uint64_t now_mono = time_get_monotonic_ms();
 
-    for (int i = 0; i < historian->tag_count; i++) {
-        historian_tag_internal_t *tag = &historian->tags[i];
-        if (!tag->enabled) continue;
-
-        /* Check if it's time to sample */
-        if (now_ms - tag->last_sample_time_ms < (uint64_t)tag->info.sample_rate_ms) {
-            continue;
-        }
+    int due_count = sample_scheduler_pop_due(historian->scheduler, now_mono,
+                                             historian->due_slots, historian->tag_capacity);
+    if (due_count == 0) {
+        return WTC_OK;
+    }
 
-        /* Read sensor value */
-        sensor_data_t sensor;
-        wtc_result_t res = rtu_registry_get_sensor(historian->registry,
-                                                    tag->info.rtu_station,
-                                                    tag->info.slot,
-                                                    &sensor);
-
-        if (res != WTC_OK) continue;
-
-        /* Apply compression if enabled */
-        bool store = true;
-        if (tag->info.compression == COMPRESSION_DEADBAND) {
-            float diff = fabsf(sensor.value - tag->last_stored_value);
-            store = diff >= tag->info.deadband;
-        } else if (tag->info.compression == COMPRESSION_SWINGING_DOOR) {
-            /* Need previous values for swinging door */
-            /* Simplified: use deadband for now */
-            float diff = fabsf(sensor.value - tag->last_stored_value);
-            store = diff >= tag->info.deadband;
+    for (int i = 0; i < due_count; i++) {
+        int t = historian->due_slots[i].key;
+        historian->due[i].tag = t;
+        historian->due[i].station = historian->tags[t].station;
+        historian->due[i].due_ms = historian->due_slots[i].due_ms;
+    }
+    qsort(historian->due, due_count, sizeof(due_tag_t), compare_due_station);
+
+    uint32_t divisor = __atomic_load_n(&historian->rate_divisor, __ATOMIC_RELAXED);
+    if (divisor == 0) divisor = 1;
+
+    for (int start = 0; start < due_count; ) {
+        int station = historian->due[start].station;
+        int end = start;
+        while (end < due_count && historian->due[end].station == station) {
+            historian->due_sensor_slots[end - start] =
+                historian->tags[historian->due[end].tag].slot;
+            end++;
         }
 
-        if (store || tag->info.total_samples == 0) {
-            /* Create sample */
-            historian_sample_t sample;
-            sample.timestamp_ms = now_ms;
-            sample.tag_id = tag->info.tag_id;
-            sample.value = sensor.value;
-            sample.quality = sensor.status == IOPS_GOOD ? 192 : 0;
-
-            /* Add to buffer */
-            buffer_add_sample(&tag->buffer, &sample, tag->info.tag_id);
-
-            /* Update tag stats */
-            tag->info.total_samples++;
-            tag->info.last_value = sensor.value;
-            tag->info.last_sample_ms = now_ms;
-            tag->last_stored_value = sensor.value;
+        int n = end - start;
+        wtc_result_t res = rtu_registry_get_sensors(historian->registry,
+                                                    historian->stations[station].name,
+                                                    historian->due_sensor_slots, n,
+                                                    historian->due_sensors,
+                                                    historian->due_found);
 
-            historian->stats.total_samples++;
-        } else {
-            tag->info.compressed_samples++;
-        }
+        for (int i = 0; i < n; i++) {
+            const due_tag_t *due = &historian->due[start + i];
+            historian_tag_internal_t *tag = &historian->tags[due->tag];
 
-        tag->last_sample_time_ms = now_ms;
+            if (res == WTC_OK && historian->due_found[i]) {
+                process_tag_sample(historian, due->tag, &historian->due_sensors[i], now_ms);
+            }
 
-        /* Update compression ratio */
-        if (tag->info.total_samples > 0) {
-            tag->info.compression_ratio =
-                (float)(tag->info.total_samples + tag->info.compressed_samples) /
-                (float)tag->info.total_samples;
+            /* Next period; after an overrun resume from now rather than bursting */
+            uint64_t period = (uint64_t)tag->sample_rate_ms * divisor;
+            uint64_t next = due->due_ms + period;
+            if (next <= now_mono) {
+                next = now_mono + period;
+            }
+            sample_scheduler_set(historian->scheduler, due->tag, next);
         }
-    }
 
-    historian->stats.samples_in_buffer = 0;
-    for (int i = 0; i < historian->tag_count; i++) {
-        historian->stats.samples_in_buffer += historian->tags[i].buffer.count;
+        start = end;
     }
 
     return WTC_OK;
@@ -504,76 +1314,103 @@ wtc_result_t historian_flush(historian_t *historian) {
         return WTC_ERROR_INVALID_PARAM;
     }
 
-    pthread_mutex_lock(&historian->lock);
+    uint64_t ticket = flush_submit(historian);
 
-    const char *data_dir = historian->config.database_path;
-    if (!data_dir) {
-        data_dir = "/var/lib/water-controller/historian";
+    /* Wait for the I/O thread, or write inline when it is not running */
+    pthread_mutex_lock(&historian->io_lock);
+    bool threaded = historian->io_running;
+    while (threaded && historian->io_completed < ticket) {
+        pthread_cond_wait(&historian->io_done, &historian->io_lock);
     }
+    pthread_mutex_unlock(&historian->io_lock);
 
-    uint64_t now_ms = time_get_ms();
-    int total_flushed = 0;
-
-    /* Flush each tag's buffer to a binary file */
-    for (int t = 0; t < historian->tag_count; t++) {
-        historian_tag_internal_t *tag = &historian->tags[t];
-        if (tag->buffer.count == 0) continue;
-
-        /* Create filename based on tag ID and date */
-        char filename[256];
-        char date_str[16];
-        time_format_date(now_ms, date_str, sizeof(date_str));
-        snprintf(filename, sizeof(filename), "%s/%s_%d.dat",
-                 data_dir, date_str, tag->info.tag_id);
-
-        FILE *fp = fopen(filename, "ab"); /* Append binary */
-        if (!fp) {
-            /* Try to create directory first */
-            char mkdir_cmd[300];
-            snprintf(mkdir_cmd, sizeof(mkdir_cmd), "mkdir -p %s", data_dir);
-            system(mkdir_cmd);
-
-            fp = fopen(filename, "ab");
-            if (!fp) {
-                LOG_ERROR("Failed to open historian file: %s", filename);
-                continue;
-            }
-        }
-
-        /* Write samples from ring buffer */
-        for (int i = 0; i < tag->buffer.count; i++) {
-            int idx = (tag->buffer.write_pos - tag->buffer.count + i + tag->buffer.capacity)
-                      % tag->buffer.capacity;
-            historian_sample_t *sample = &tag->buffer.samples[idx];
+    if (!threaded) {
+        flush_drain(historian);
+    }
 
-            /* Write binary record: timestamp (8 bytes), value (4 bytes), quality (1 byte) */
-            fwrite(&sample->timestamp_ms, sizeof(uint64_t), 1, fp);
-            fwrite(&sample->value, sizeof(float), 1, fp);
-            fwrite(&sample->quality, sizeof(uint8_t), 1, fp);
+    return WTC_OK;
+}
 
-            total_flushed++;
-        }
+/* HIST-C2 fix: Return copies instead of pointers to avoid dangling references */
+static int compare_sample_time(const void *a, const void *b) {
+    uint64_t ta = ((const historian_sample_t *)a)->timestamp_ms;
+    uint64_t tb = ((const historian_sample_t *)b)->timestamp_ms;
+    return (ta > tb) - (ta < tb);
+}
 
-        fclose(fp);
+/* Samples of a tag that are not in the store yet, buffered or queued
+ * for the writer, within [start_time_ms, end_time_ms] and sorted by
+ * time. The buffer is copied first: a seal that moves samples on to the
+ * queue meanwhile leaves them in both copies rather than in neither.
+ * The queue is copied once no drain is in flight, so every sample
+ * missing from the copy has reached the store. */
+static wtc_result_t copy_unflushed(historian_t *historian, int tag_id,
+                                   uint64_t start_time_ms, uint64_t end_time_ms,
+                                   historian_sample_t **samples, int *count) {
+    *samples = NULL;
+    *count = 0;
+
+    pthread_rwlock_rdlock(&historian->table_lock);
+
+    int h = tag_index_find_id(historian->index, tag_id);
+    if (h < 0) {
+        pthread_rwlock_unlock(&historian->table_lock);
+        return WTC_ERROR_NOT_FOUND;
+    }
+    historian_tag_internal_t *tag = &historian->tags[h];
 
-        /* Clear buffer after successful flush */
-        tag->buffer.count = 0;
-        tag->buffer.write_pos = 0;
+    int capacity = tag->buffer.capacity;
+    historian_sample_t *out = malloc((size_t)(capacity > 0 ? capacity : 1) *
+                                     sizeof(historian_sample_t));
+    if (!out) {
+        pthread_rwlock_unlock(&historian->table_lock);
+        return WTC_ERROR_NO_MEMORY;
     }
+    int n = historian_chunk_buffer_copy(&tag->buffer, tag_id, start_time_ms, end_time_ms,
+                                        out, capacity);
 
-    historian->stats.samples_in_buffer = 0;
-    historian->stats.samples_flushed += total_flushed;
+    pthread_mutex_lock(&historian->io_lock);
+    while (historian->io_draining) {
+        pthread_cond_wait(&historian->io_done, &historian->io_lock);
+    }
 
-    pthread_mutex_unlock(&historian->lock);
+    int total = n;
+    for (flush_job_t *job = historian->io_head; job; job = job->next) {
+        if (job->tag_id == tag_id) total += job->count;
+    }
+    if (total > capacity) {
+        historian_sample_t *grown = realloc(out, (size_t)total * sizeof(historian_sample_t));
+        if (!grown) {
+            pthread_mutex_unlock(&historian->io_lock);
+            pthread_rwlock_unlock(&historian->table_lock);
+            free(out);
+            return WTC_ERROR_NO_MEMORY;
+        }
+        out = grown;
+    }
 
-    if (total_flushed > 0) {
-        LOG_INFO("Historian flushed %d samples to disk", total_flushed);
+    /* Queued chains are immutable until the writer takes them off */
+    for (flush_job_t *job = historian->io_head; job; job = job->next) {
+        if (job->tag_id != tag_id) continue;
+        int first = n;
+        int copied = historian_chunk_chain_copy(job->chunks, tag_id, out + first, total - first);
+        for (int i = first; i < first + copied; i++) {
+            if (out[i].timestamp_ms >= start_time_ms && out[i].timestamp_ms <= end_time_ms) {
+                out[n++] = out[i];
+            }
+        }
     }
+    pthread_mutex_unlock(&historian->io_lock);
+    pthread_rwlock_unlock(&historian->table_lock);
 
+    if (n > 1) {
+        qsort(out, (size_t)n, sizeof(historian_sample_t), compare_sample_time);
+    }
+    *samples = out;
+    *count = n;
     return WTC_OK;
 }
 
-/* HIST-C2 fix: Return copies instead of pointers to avoid dangling references */
 wtc_result_t historian_query(historian_t *historian,
                               int tag_id,
                               uint64_t start_time_ms,
@@ -581,44 +1418,44 @@ wtc_result_t historian_query(historian_t *historian,
                               historian_sample_t *samples_out,
                               int *count,
                               int max_count) {
-    if (!historian || !samples_out || !count) {
+    if (!historian || !samples_out || !count || end_time_ms < start_time_ms) {
         return WTC_ERROR_INVALID_PARAM;
     }
 
-    pthread_mutex_lock(&historian->lock);
-
-    /* Find tag */
-    historian_tag_internal_t *tag = NULL;
-    for (int i = 0; i < historian->tag_count; i++) {
-        if (historian->tags[i].info.tag_id == tag_id) {
-            tag = &historian->tags[i];
-            break;
-        }
-    }
-
-    if (!tag) {
-        pthread_mutex_unlock(&historian->lock);
-        return WTC_ERROR_NOT_FOUND;
+    historian_sample_t *pending = NULL;
+    int pending_count = 0;
+    wtc_result_t res = copy_unflushed(historian, tag_id, start_time_ms, end_time_ms,
+                                      &pending, &pending_count);
+    if (res != WTC_OK) {
+        return res;
     }
 
-    /* Query from buffer - copy samples to output array */
-    int result_count = 0;
-    for (int i = 0; i < tag->buffer.count && result_count < max_count; i++) {
-        int idx = (tag->buffer.write_pos - tag->buffer.count + i + tag->buffer.capacity)
-                  % tag->buffer.capacity;
-        historian_sample_t *sample = &tag->buffer.samples[idx];
-
-        if (sample->timestamp_ms >= start_time_ms &&
-            sample->timestamp_ms <= end_time_ms) {
-            /* Copy sample data instead of returning pointer */
-            memcpy(&samples_out[result_count], sample, sizeof(historian_sample_t));
-            result_count++;
+    /* Merge with the store by time. The writer may store copied samples
+     * meanwhile; the stored sample wins the tie and the copy is dropped. */
+    historian_cursor_t *cursor = NULL;
+    historian_sample_t stored;
+    bool has_stored =
+        historian_cursor_open(&cursor, historian_data_dir(historian), tag_id,
+                              start_time_ms, end_time_ms) == WTC_OK &&
+        historian_cursor_next(cursor, &stored) == WTC_OK;
+
+    int n = 0, p = 0;
+    while (n < max_count && (has_stored || p < pending_count)) {
+        historian_sample_t next;
+        if (has_stored && (p >= pending_count ||
+                           stored.timestamp_ms <= pending[p].timestamp_ms)) {
+            next = stored;
+            has_stored = historian_cursor_next(cursor, &stored) == WTC_OK;
+        } else {
+            next = pending[p++];
         }
+        if (n > 0 && next.timestamp_ms == samples_out[n - 1].timestamp_ms) continue;
+        samples_out[n++] = next;
     }
+    historian_cursor_close(cursor);
+    free(pending);
 
-    *count = result_count;
-
-    pthread_mutex_unlock(&historian->lock);
+    *count = n;
     return WTC_OK;
 }
 
@@ -631,24 +1468,94 @@ wtc_result_t historian_get_current(historian_t *historian,
         return WTC_ERROR_INVALID_PARAM;
     }
 
-    pthread_mutex_lock(&historian->lock);
+    pthread_rwlock_rdlock(&historian->table_lock);
 
-    for (int i = 0; i < historian->tag_count; i++) {
-        if (historian->tags[i].info.tag_id == tag_id) {
-            *value = historian->tags[i].info.last_value;
-            if (timestamp_ms) {
-                *timestamp_ms = historian->tags[i].info.last_sample_ms;
-            }
-            if (quality) {
-                *quality = 192; /* Good quality */
-            }
-            pthread_mutex_unlock(&historian->lock);
-            return WTC_OK;
+    int h = tag_index_find_id(historian->index, tag_id);
+    if (h < 0) {
+        pthread_rwlock_unlock(&historian->table_lock);
+        return WTC_ERROR_NOT_FOUND;
+    }
+
+    /* Value, timestamp and quality come from the same sample */
+    const historian_tag_internal_t *tag = &historian->tags[h];
+    const historian_tag_t *info = &historian->tag_info[h];
+    float last_value;
+    uint64_t last_sample_ms;
+    uint8_t last_quality;
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&tag->info_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            sched_yield();
+            continue;
         }
+        last_value = info->last_value;
+        last_sample_ms = info->last_sample_ms;
+        last_quality = tag->last_quality;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&tag->info_seq, __ATOMIC_RELAXED) == seq) break;
     }
 
-    pthread_mutex_unlock(&historian->lock);
-    return WTC_ERROR_NOT_FOUND;
+    pthread_rwlock_unlock(&historian->table_lock);
+
+    *value = last_value;
+    if (timestamp_ms) {
+        *timestamp_ms = last_sample_ms;
+    }
+    if (quality) {
+        *quality = last_quality;
+    }
+
+    return WTC_OK;
+}
+
+wtc_result_t historian_export(historian_t *historian,
+                               const int *tag_ids,
+                               int tag_count,
+                               uint64_t start_time_ms,
+                               uint64_t end_time_ms,
+                               const historian_export_options_t *options,
+                               const char *filename) {
+    if (!historian || !tag_ids || tag_count <= 0 || !options || !filename) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    /* Persist buffered samples so the store covers the whole range */
+    historian_flush(historian);
+
+    historian_tag_ref_t *columns = calloc(tag_count, sizeof(historian_tag_ref_t));
+    if (!columns) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    /* Resolve column names; unknown tags are skipped */
+    int column_count = 0;
+    for (int i = 0; i < tag_count; i++) {
+        historian_tag_t tag;
+        if (historian_get_tag(historian, tag_ids[i], &tag) == WTC_OK) {
+            columns[column_count].tag_id = tag.tag_id;
+            snprintf(columns[column_count].name, sizeof(columns[column_count].name),
+                     "%s", tag.tag_name);
+            column_count++;
+        }
+    }
+
+    if (column_count == 0) {
+        free(columns);
+        return WTC_ERROR_NOT_FOUND;
+    }
+
+    uint64_t rows = 0;
+    wtc_result_t res = historian_export_run(historian_data_dir(historian),
+                                            columns, column_count,
+                                            start_time_ms, end_time_ms,
+                                            options, filename, &rows);
+    free(columns);
+
+    if (res == WTC_OK) {
+        LOG_INFO("Exported %llu rows of historian data to %s",
+                 (unsigned long long)rows, filename);
+    }
+    return res;
 }
 
 wtc_result_t historian_export_csv(historian_t *historian,
@@ -657,54 +1564,93 @@ wtc_result_t historian_export_csv(historian_t *historian,
                                    uint64_t start_time_ms,
                                    uint64_t end_time_ms,
                                    const char *filename) {
-    if (!historian || !tag_ids || !filename) {
+    historian_export_options_t options = {
+        .align = HISTORIAN_ALIGN_RAW,
+        .format = HISTORIAN_EXPORT_CSV,
+        .decimals = -1,
+    };
+    return historian_export(historian, tag_ids, tag_count,
+                            start_time_ms, end_time_ms, &options, filename);
+}
+
+wtc_result_t historian_import(historian_t *historian,
+                               const char *filename,
+                               int threads,
+                               historian_import_result_t *result) {
+    if (!historian || !filename) {
         return WTC_ERROR_INVALID_PARAM;
     }
 
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
-        return WTC_ERROR_IO;
+    /* Snapshot the tag table; the import itself runs unlocked */
+    pthread_rwlock_rdlock(&historian->table_lock);
+    int tag_count = tag_index_count(historian->index);
+    historian_tag_ref_t *tags = tag_count > 0 ?
+                                calloc(tag_count, sizeof(historian_tag_ref_t)) : NULL;
+    for (int h = 0, i = 0; tags && h < tag_index_limit(historian->index); h++) {
+        if (!tag_index_in_use(historian->index, h)) continue;
+        tags[i].tag_id = historian->tag_info[h].tag_id;
+        snprintf(tags[i].name, sizeof(tags[i].name), "%s", historian->tag_info[h].tag_name);
+        i++;
     }
+    pthread_rwlock_unlock(&historian->table_lock);
 
-    /* Write header */
-    fprintf(fp, "timestamp");
-    for (int i = 0; i < tag_count; i++) {
-        historian_tag_t tag;
-        if (historian_get_tag(historian, tag_ids[i], &tag) == WTC_OK) {
-            fprintf(fp, ",%s", tag.tag_name);
-        }
+    if (tag_count == 0) {
+        return WTC_ERROR_NOT_FOUND;
+    }
+    if (!tags) {
+        return WTC_ERROR_NO_MEMORY;
     }
-    fprintf(fp, "\n");
 
-    /* Write data (simplified - would need proper time alignment) */
-    pthread_mutex_lock(&historian->lock);
+    historian_import_result_t local;
+    if (!result) result = &local;
 
-    for (int t = 0; t < tag_count; t++) {
-        for (int i = 0; i < historian->tag_count; i++) {
-            if (historian->tags[i].info.tag_id == tag_ids[t]) {
-                tag_buffer_t *buffer = &historian->tags[i].buffer;
-                for (int j = 0; j < buffer->count; j++) {
-                    int idx = (buffer->write_pos - buffer->count + j + buffer->capacity)
-                              % buffer->capacity;
-                    historian_sample_t *sample = &buffer->samples[idx];
-
-                    if (sample->timestamp_ms >= start_time_ms &&
-                        sample->timestamp_ms <= end_time_ms) {
-                        char ts[32];
-                        time_format_iso8601(sample->timestamp_ms, ts, sizeof(ts));
-                        fprintf(fp, "%s,%.4f\n", ts, sample->value);
-                    }
-                }
-                break;
-            }
-        }
+    uint64_t start_ms = time_get_monotonic_ms();
+    wtc_result_t res = historian_import_run(historian_data_dir(historian), tags, tag_count,
+                                            filename, threads, result);
+    free(tags);
+
+    STAT_ADD(historian, storage_bytes, result->bytes_written);
+
+    LOG_INFO("Imported %llu samples from %s in %llu ms (%llu duplicates, %llu parse errors)",
+             (unsigned long long)result->samples_imported, filename,
+             (unsigned long long)(time_get_monotonic_ms() - start_ms),
+             (unsigned long long)result->duplicates_skipped,
+             (unsigned long long)result->parse_errors);
+    return res;
+}
+
+wtc_result_t historian_import_csv(historian_t *historian,
+                                   const char *filename) {
+    return historian_import(historian, filename, 0, NULL);
+}
+
+wtc_result_t historian_purge_old_data(historian_t *historian, int retention_days) {
+    if (!historian) {
+        return WTC_ERROR_INVALID_PARAM;
     }
 
-    pthread_mutex_unlock(&historian->lock);
-    fclose(fp);
+    /* Buffered samples count towards today's raw data */
+    historian_flush(historian);
 
-    LOG_INFO("Exported historian data to %s", filename);
-    return WTC_OK;
+    pthread_mutex_lock(&historian->retention_lock);
+    wtc_result_t res = run_retention_sweep(historian, retention_days > 0 ?
+                                           retention_days : historian->config.retention_days);
+    pthread_mutex_unlock(&historian->retention_lock);
+    return res;
+}
+
+wtc_result_t historian_read_rollup(historian_t *historian,
+                                    int tag_id,
+                                    historian_rollup_tier_t tier,
+                                    uint64_t day_ms,
+                                    historian_aggregate_t *aggregates,
+                                    int *count,
+                                    int max_count) {
+    if (!historian) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    return historian_rollup_read(historian_data_dir(historian), tag_id, tier,
+                                 day_ms, aggregates, count, max_count);
 }
 
 wtc_result_t historian_get_stats(historian_t *historian, historian_stats_t *stats) {
@@ -712,20 +1658,30 @@ wtc_result_t historian_get_stats(historian_t *historian, historian_stats_t *stat
         return WTC_ERROR_INVALID_PARAM;
     }
 
-    pthread_mutex_lock(&historian->lock);
+    pthread_rwlock_rdlock(&historian->table_lock);
 
-    stats->total_tags = historian->tag_count;
-    stats->total_samples = historian->stats.total_samples;
-    stats->samples_in_buffer = historian->stats.samples_in_buffer;
+    int tag_count = tag_index_count(historian->index);
+    stats->total_tags = tag_count;
+    stats->total_samples = STAT_GET(historian, total_samples);
+    stats->samples_in_buffer = STAT_GET(historian, samples_in_buffer);
+    stats->samples_flushed = STAT_GET(historian, samples_flushed);
+    stats->samples_spilled = STAT_GET(historian, samples_spilled);
+    stats->samples_dropped = STAT_GET(historian, samples_dropped);
+    stats->samples_recovered = STAT_GET(historian, samples_recovered);
+    stats->storage_bytes = STAT_GET(historian, storage_bytes);
+    stats->bytes_reclaimed = STAT_GET(historian, bytes_reclaimed);
+    stats->segments_purged = STAT_GET(historian, segments_purged);
 
     /* Calculate average compression ratio */
     float total_ratio = 0;
-    for (int i = 0; i < historian->tag_count; i++) {
-        total_ratio += historian->tags[i].info.compression_ratio;
+    for (int h = 0; h < tag_index_limit(historian->index); h++) {
+        if (!tag_index_in_use(historian->index, h)) continue;
+        historian_tag_t info;
+        read_tag_info(historian, h, &info);
+        total_ratio += info.compression_ratio;
     }
-    stats->avg_compression_ratio = historian->tag_count > 0 ?
-                                   total_ratio / historian->tag_count : 1.0f;
+    stats->avg_compression_ratio = tag_count > 0 ? total_ratio / tag_count : 1.0f;
 
-    pthread_mutex_unlock(&historian->lock);
+    pthread_rwlock_unlock(&historian->table_lock);
     return WTC_OK;
 }
@@ -16,6 +16,19 @@ extern "C" {
 /* Historian handle */
 typedef struct historian historian_t;
 
+/* Rollup tiers kept by the retention manager, finest first */
+typedef enum {
+    HISTORIAN_ROLLUP_MINUTE = 0,    /* 1 minute min/max/avg */
+    HISTORIAN_ROLLUP_HOUR,          /* 1 hour min/max/avg */
+    HISTORIAN_ROLLUP_TIERS
+} historian_rollup_tier_t;
+
+/* What a full per-tag buffer does with the next sample */
+typedef enum {
+    HISTORIAN_OVERFLOW_SPILL = 0,   /* Hand the buffer to the writer early */
+    HISTORIAN_OVERFLOW_DROP_OLDEST, /* Discard the oldest buffered sample */
+} historian_overflow_t;
+
 /* Historian configuration */
 typedef struct {
     const char *database_path;
@@ -26,6 +39,14 @@ typedef struct {
     compression_t default_compression;
     int retention_days;             /* Data retention period */
     bool async_writes;              /* Use async database writes */
+    int rollup_retention_days[HISTORIAN_ROLLUP_TIERS]; /* 0 = 2x/5x retention_days */
+    uint64_t max_storage_bytes;     /* Disk high-water mark (0 = unlimited) */
+    uint32_t retention_interval_ms; /* Background retention sweep period */
+    uint32_t flush_interval_ms;     /* Background flush period */
+    historian_overflow_t overflow;  /* Full buffer policy */
+    bool wal_enabled;               /* Log samples to disk before buffering */
+    uint32_t wal_commit_ms;         /* WAL group commit period */
+    uint32_t wal_file_bytes;        /* Size of each WAL file */
 } historian_config_t;
 
 /* Initialize historian */
@@ -46,6 +67,19 @@ struct rtu_registry;
 wtc_result_t historian_set_registry(historian_t *historian,
                                      struct rtu_registry *registry);
 
+/* Called for every sample that enters a tag buffer, with the historian
+ * lock held; must not block or call back into the historian */
+typedef void (*historian_sample_observer_t)(const historian_sample_t *sample, void *ctx);
+
+/* Set sample observer (e.g. to replicate samples to a standby) */
+void historian_set_sample_observer(historian_t *historian,
+                                   historian_sample_observer_t observer,
+                                   void *ctx);
+
+/* Sample every tag divisor times less often (1 = configured rates), e.g.
+ * to shed load; takes effect as each tag next comes due */
+void historian_set_rate_divisor(historian_t *historian, uint32_t divisor);
+
 /* ============== Tag Management ============== */
 
 /* Add historian tag */
@@ -97,7 +131,7 @@ wtc_result_t historian_record_sample(historian_t *historian,
 /* Process (collect data from RTUs) */
 wtc_result_t historian_process(historian_t *historian);
 
-/* Flush buffers to database */
+/* Flush buffers to database; returns once the samples are written */
 wtc_result_t historian_flush(historian_t *historian);
 
 /* ============== Data Query ============== */
@@ -105,6 +139,8 @@ wtc_result_t historian_flush(historian_t *historian);
 /* Query data for a single tag
  * HIST-C2 fix: Returns copies to caller-provided array instead of pointers
  * to avoid dangling reference issues with ring buffer
+ * Merges the segment store with samples not yet flushed, oldest first,
+ * up to max_count.
  */
 wtc_result_t historian_query(historian_t *historian,
                               int tag_id,
@@ -155,7 +191,38 @@ wtc_result_t historian_get_current(historian_t *historian,
 
 /* ============== Export/Import ============== */
 
-/* Export data to CSV */
+/* Row alignment across tags */
+typedef enum {
+    HISTORIAN_ALIGN_RAW = 0,        /* Union of timestamps, empty cells where no sample */
+    HISTORIAN_ALIGN_CARRY_FORWARD,  /* Union of timestamps, last value held per tag */
+    HISTORIAN_ALIGN_INTERPOLATE,    /* Fixed interval grid, linear interpolation */
+} historian_align_t;
+
+/* Output format */
+typedef enum {
+    HISTORIAN_EXPORT_CSV = 0,
+    HISTORIAN_EXPORT_COLUMNAR,      /* Compact binary row groups, one column per tag */
+} historian_export_format_t;
+
+typedef struct {
+    historian_align_t align;
+    historian_export_format_t format;
+    uint32_t interval_ms;           /* Grid spacing for HISTORIAN_ALIGN_INTERPOLATE */
+    int decimals;                   /* CSV value precision, 0-9 (-1 = default 4) */
+} historian_export_options_t;
+
+/* Export time-aligned data for several tags from the persisted store.
+ * Buffered samples are flushed first; the export itself runs without
+ * holding the historian lock, so collection continues meanwhile. */
+wtc_result_t historian_export(historian_t *historian,
+                               const int *tag_ids,
+                               int tag_count,
+                               uint64_t start_time_ms,
+                               uint64_t end_time_ms,
+                               const historian_export_options_t *options,
+                               const char *filename);
+
+/* Export data to CSV (raw timestamp union) */
 wtc_result_t historian_export_csv(historian_t *historian,
                                    const int *tag_ids,
                                    int tag_count,
@@ -163,16 +230,48 @@ wtc_result_t historian_export_csv(historian_t *historian,
                                    uint64_t end_time_ms,
                                    const char *filename);
 
+/* Import statistics */
+typedef struct {
+    uint64_t rows_parsed;
+    uint64_t samples_imported;
+    uint64_t duplicates_skipped;    /* Same (tag, timestamp) in file or store */
+    uint64_t parse_errors;
+    uint64_t bytes_written;
+    int segments_written;
+} historian_import_result_t;
+
+/* Bulk-load a CSV file (historian_export layout, header names matching
+ * tag names) or a raw segment file (<date>_<tag_id>.dat). Parsing, sorting
+ * and writing run on worker threads (threads <= 0 picks one per CPU).
+ * Samples may arrive in any order and are merged into the store as
+ * sorted runs beside existing segments, without the historian lock. */
+wtc_result_t historian_import(historian_t *historian,
+                               const char *filename,
+                               int threads,
+                               historian_import_result_t *result);
+
 /* Import data from CSV */
 wtc_result_t historian_import_csv(historian_t *historian,
                                    const char *filename);
 
 /* ============== Maintenance ============== */
 
-/* Purge old data */
+/* Run a retention sweep now: roll completed days up into the rollup
+ * tiers, unlink raw day segments older than retention_days (<= 0 uses
+ * the configured period) and expired rollups, then enforce the disk
+ * high-water mark. The background sweep does the same periodically. */
 wtc_result_t historian_purge_old_data(historian_t *historian,
                                        int retention_days);
 
+/* Read one day of a rollup tier for a tag */
+wtc_result_t historian_read_rollup(historian_t *historian,
+                                    int tag_id,
+                                    historian_rollup_tier_t tier,
+                                    uint64_t day_ms,
+                                    historian_aggregate_t *aggregates,
+                                    int *count,
+                                    int max_count);
+
 /* Get tag statistics */
 wtc_result_t historian_get_tag_stats(historian_t *historian,
                                       int tag_id,
@@ -187,7 +286,12 @@ typedef struct {
     uint64_t total_samples;
     uint64_t samples_in_buffer;
     uint64_t samples_flushed;
+    uint64_t samples_spilled;       /* Written early because a buffer filled */
+    uint64_t samples_dropped;       /* Lost to overflow */
+    uint64_t samples_recovered;     /* Replayed from the WAL at startup */
     uint64_t storage_bytes;
+    uint64_t bytes_reclaimed;       /* Freed by retention since start */
+    uint64_t segments_purged;
     float avg_compression_ratio;
     uint64_t oldest_sample_ms;
     uint64_t newest_sample_ms;
@@ -0,0 +1,284 @@
+/*
+ * Water Treatment Controller - Historian Sample Chunks Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "historian_chunk.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(historian_chunk_t) <= HISTORIAN_CHUNK_BYTES,
+               "historian chunk exceeds its size class");
+
+/* Chunks carved from each slab (256 KB) */
+#define CHUNKS_PER_SLAB 64
+
+typedef struct chunk_slab {
+    struct chunk_slab *next;
+    void *memory;
+} chunk_slab_t;
+
+struct historian_chunk_pool {
+    historian_chunk_t *free_list;
+    chunk_slab_t *slabs;
+    size_t slab_count;
+};
+
+wtc_result_t historian_chunk_pool_init(historian_chunk_pool_t **pool) {
+    if (!pool) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    historian_chunk_pool_t *p = calloc(1, sizeof(historian_chunk_pool_t));
+    if (!p) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    *pool = p;
+    return WTC_OK;
+}
+
+void historian_chunk_pool_cleanup(historian_chunk_pool_t *pool) {
+    if (!pool) return;
+
+    chunk_slab_t *slab = pool->slabs;
+    while (slab) {
+        chunk_slab_t *next = slab->next;
+        free(slab->memory);
+        free(slab);
+        slab = next;
+    }
+    free(pool);
+}
+
+size_t historian_chunk_pool_bytes(const historian_chunk_pool_t *pool) {
+    return pool ? pool->slab_count * CHUNKS_PER_SLAB * HISTORIAN_CHUNK_BYTES : 0;
+}
+
+static bool pool_grow(historian_chunk_pool_t *pool) {
+    chunk_slab_t *slab = malloc(sizeof(chunk_slab_t));
+    if (!slab) return false;
+
+    slab->memory = aligned_alloc(HISTORIAN_CHUNK_BYTES,
+                                 CHUNKS_PER_SLAB * HISTORIAN_CHUNK_BYTES);
+    if (!slab->memory) {
+        free(slab);
+        return false;
+    }
+
+    for (int i = 0; i < CHUNKS_PER_SLAB; i++) {
+        historian_chunk_t *chunk =
+            (historian_chunk_t *)((uint8_t *)slab->memory + (size_t)i * HISTORIAN_CHUNK_BYTES);
+        chunk->next = pool->free_list;
+        pool->free_list = chunk;
+    }
+
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->slab_count++;
+    return true;
+}
+
+static historian_chunk_t *chunk_alloc(historian_chunk_pool_t *pool) {
+    if (!pool->free_list && !pool_grow(pool)) {
+        return NULL;
+    }
+
+    historian_chunk_t *chunk = pool->free_list;
+    pool->free_list = chunk->next;
+
+    /* A reader may still be walking a recycled chunk; its sequence check
+     * fails, but the fields it polls must not tear */
+    __atomic_store_n(&chunk->next, NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&chunk->start, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&chunk->count, 0, __ATOMIC_RELAXED);
+    return chunk;
+}
+
+static void chunk_free(historian_chunk_pool_t *pool, historian_chunk_t *chunk) {
+    __atomic_store_n(&chunk->next, pool->free_list, __ATOMIC_RELAXED);
+    pool->free_list = chunk;
+}
+
+void historian_chunk_pool_release(historian_chunk_pool_t *pool, historian_chunk_t *chain) {
+    if (!pool) return;
+    while (chain) {
+        historian_chunk_t *next = chain->next;
+        chunk_free(pool, chain);
+        chain = next;
+    }
+}
+
+/* Writer side of the buffer sequence; brackets unlinking chunks */
+static void seq_begin(historian_chunk_buffer_t *buffer) {
+    __atomic_store_n(&buffer->seq, buffer->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void seq_end(historian_chunk_buffer_t *buffer) {
+    __atomic_store_n(&buffer->seq, buffer->seq + 1, __ATOMIC_RELEASE);
+}
+
+void historian_chunk_buffer_init(historian_chunk_buffer_t *buffer, int capacity) {
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->capacity = capacity;
+}
+
+historian_chunk_t *historian_chunk_buffer_seal(historian_chunk_buffer_t *buffer, int *count) {
+    if (count) *count = buffer ? buffer->count : 0;
+    if (!buffer) return NULL;
+
+    historian_chunk_t *chain = buffer->head;
+    seq_begin(buffer);
+    __atomic_store_n(&buffer->head, NULL, __ATOMIC_RELAXED);
+    buffer->tail = NULL;
+    buffer->count = 0;
+    seq_end(buffer);
+    return chain;
+}
+
+void historian_chunk_buffer_clear(historian_chunk_buffer_t *buffer,
+                                  historian_chunk_pool_t *pool) {
+    historian_chunk_pool_release(pool, historian_chunk_buffer_seal(buffer, NULL));
+}
+
+/* Discard the oldest sample */
+static void buffer_drop_oldest(historian_chunk_buffer_t *buffer,
+                               historian_chunk_pool_t *pool) {
+    historian_chunk_t *head = buffer->head;
+    __atomic_store_n(&head->start, head->start + 1, __ATOMIC_RELAXED);
+    buffer->count--;
+
+    if (head->start == head->count && head != buffer->tail) {
+        seq_begin(buffer);
+        __atomic_store_n(&buffer->head, head->next, __ATOMIC_RELAXED);
+        seq_end(buffer);
+        chunk_free(pool, head);
+    }
+}
+
+wtc_result_t historian_chunk_buffer_push(historian_chunk_buffer_t *buffer,
+                                         historian_chunk_pool_t *pool,
+                                         uint64_t timestamp_ms,
+                                         float value,
+                                         uint8_t quality,
+                                         bool *dropped) {
+    if (!buffer || !pool || buffer->capacity <= 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    if (dropped) *dropped = false;
+
+    /* A fully drained tail chunk is reused from the start */
+    historian_chunk_t *tail = buffer->tail;
+    if (tail && tail->start == tail->count && buffer->count == 0) {
+        seq_begin(buffer);
+        __atomic_store_n(&tail->start, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&tail->count, 0, __ATOMIC_RELAXED);
+        seq_end(buffer);
+    }
+
+    /* Open a new chunk when the tail is full or the offset does not fit */
+    if (!tail || tail->count == HISTORIAN_CHUNK_SAMPLES ||
+        (tail->count > 0 && (timestamp_ms < tail->base_ms ||
+                             timestamp_ms - tail->base_ms > UINT32_MAX))) {
+        historian_chunk_t *chunk = chunk_alloc(pool);
+        if (!chunk) {
+            return WTC_ERROR_NO_MEMORY;
+        }
+        if (tail) {
+            __atomic_store_n(&tail->next, chunk, __ATOMIC_RELEASE);
+        } else {
+            __atomic_store_n(&buffer->head, chunk, __ATOMIC_RELEASE);
+        }
+        buffer->tail = chunk;
+        tail = chunk;
+    }
+
+    uint16_t n = tail->count;
+    if (n == 0) {
+        tail->base_ms = timestamp_ms;
+    }
+
+    tail->offset_ms[n] = (uint32_t)(timestamp_ms - tail->base_ms);
+    tail->value[n] = value;
+    tail->quality[n] = quality;
+    __atomic_store_n(&tail->count, n + 1, __ATOMIC_RELEASE);
+    buffer->count++;
+
+    if (buffer->count > buffer->capacity) {
+        buffer_drop_oldest(buffer, pool);
+        if (dropped) *dropped = true;
+    }
+
+    return WTC_OK;
+}
+
+int historian_chunk_chain_copy(const historian_chunk_t *chain,
+                               int tag_id,
+                               historian_sample_t *out,
+                               int max_count) {
+    if (!out) return 0;
+
+    int n = 0;
+    for (const historian_chunk_t *chunk = chain; chunk && n < max_count; chunk = chunk->next) {
+        for (int i = chunk->start; i < chunk->count && n < max_count; i++) {
+            out[n].timestamp_ms = chunk->base_ms + chunk->offset_ms[i];
+            out[n].tag_id = tag_id;
+            out[n].value = chunk->value[i];
+            out[n].quality = chunk->quality[i];
+            n++;
+        }
+    }
+    return n;
+}
+
+int historian_chunk_buffer_copy(const historian_chunk_buffer_t *buffer,
+                                int tag_id,
+                                uint64_t start_time_ms,
+                                uint64_t end_time_ms,
+                                historian_sample_t *out,
+                                int max_count) {
+    if (!buffer || !out) return 0;
+
+    /* A recycled chunk can link anywhere; bound the walk so a torn read
+     * ends in a retry rather than a loop */
+    int max_chunks = buffer->capacity / HISTORIAN_CHUNK_SAMPLES + 2;
+
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&buffer->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+
+        int n = 0;
+        const historian_chunk_t *chunk = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+        for (int c = 0; chunk && c < max_chunks && n < max_count; c++) {
+            uint16_t count = __atomic_load_n(&chunk->count, __ATOMIC_ACQUIRE);
+            uint16_t start = __atomic_load_n(&chunk->start, __ATOMIC_RELAXED);
+            if (count > HISTORIAN_CHUNK_SAMPLES) break;
+
+            uint64_t base_ms = chunk->base_ms;
+            for (int i = start; i < count && n < max_count; i++) {
+                uint64_t timestamp_ms = base_ms + chunk->offset_ms[i];
+                if (timestamp_ms < start_time_ms || timestamp_ms > end_time_ms) continue;
+
+                out[n].timestamp_ms = timestamp_ms;
+                out[n].tag_id = tag_id;
+                out[n].value = chunk->value[i];
+                out[n].quality = chunk->quality[i];
+                n++;
+            }
+            chunk = __atomic_load_n(&chunk->next, __ATOMIC_ACQUIRE);
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&buffer->seq, __ATOMIC_RELAXED) == seq) {
+            return n;
+        }
+    }
+}
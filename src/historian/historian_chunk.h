@@ -0,0 +1,112 @@
+/*
+ * Water Treatment Controller - Historian Sample Chunks
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * In-memory sample buffers are chains of fixed 4 KB chunks laid out as
+ * structure-of-arrays: 32-bit millisecond offsets from the chunk's base
+ * timestamp, float values and quality bytes. A sample costs 9 bytes
+ * instead of the 24 of a padded historian_sample_t, and the tag id is
+ * implied by the buffer that holds it.
+ *
+ * Chunks come from a pool that carves them out of larger slabs and
+ * keeps released chunks on a free list, so steady-state collection and
+ * flushing do not touch malloc. Pools are not thread-safe.
+ *
+ * A buffer has a single writer but may be copied by any number of
+ * concurrent readers without locking. Samples are published by a
+ * release-store of the chunk's count; the writer bumps the buffer's
+ * sequence around every change that takes a chunk out of the chain, and
+ * readers retry when the sequence moved while they copied. Sealing a
+ * buffer detaches its whole chain, which is then immutable and can be
+ * written out by another thread before going back to the pool.
+ */
+
+#ifndef WTC_HISTORIAN_CHUNK_H
+#define WTC_HISTORIAN_CHUNK_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTORIAN_CHUNK_BYTES   4096
+#define HISTORIAN_CHUNK_SAMPLES 452
+
+typedef struct historian_chunk historian_chunk_t;
+
+struct historian_chunk {
+    historian_chunk_t *next;
+    uint64_t base_ms;
+    uint16_t start;                 /* First live sample */
+    uint16_t count;                 /* Samples written */
+    uint32_t offset_ms[HISTORIAN_CHUNK_SAMPLES];
+    float value[HISTORIAN_CHUNK_SAMPLES];
+    uint8_t quality[HISTORIAN_CHUNK_SAMPLES];
+};
+
+typedef struct historian_chunk_pool historian_chunk_pool_t;
+
+/* Bounded FIFO of samples for one tag; oldest samples drop when full */
+typedef struct {
+    historian_chunk_t *head;
+    historian_chunk_t *tail;
+    int count;
+    int capacity;
+    uint32_t seq;                   /* Odd while chunks are being unlinked */
+} historian_chunk_buffer_t;
+
+/* Initialize chunk pool */
+wtc_result_t historian_chunk_pool_init(historian_chunk_pool_t **pool);
+
+/* Cleanup chunk pool, releasing every slab */
+void historian_chunk_pool_cleanup(historian_chunk_pool_t *pool);
+
+/* Bytes of slab memory the pool holds */
+size_t historian_chunk_pool_bytes(const historian_chunk_pool_t *pool);
+
+/* Return a sealed chain of chunks to the pool */
+void historian_chunk_pool_release(historian_chunk_pool_t *pool, historian_chunk_t *chain);
+
+void historian_chunk_buffer_init(historian_chunk_buffer_t *buffer, int capacity);
+
+/* Return all chunks of a buffer to the pool */
+void historian_chunk_buffer_clear(historian_chunk_buffer_t *buffer,
+                                  historian_chunk_pool_t *pool);
+
+/* Append a sample. Sets *dropped when the oldest sample was discarded
+ * to make room. */
+wtc_result_t historian_chunk_buffer_push(historian_chunk_buffer_t *buffer,
+                                         historian_chunk_pool_t *pool,
+                                         uint64_t timestamp_ms,
+                                         float value,
+                                         uint8_t quality,
+                                         bool *dropped);
+
+/* Detach all buffered samples, leaving the buffer empty. Returns the
+ * chain, oldest first, and stores its sample count in *count. */
+historian_chunk_t *historian_chunk_buffer_seal(historian_chunk_buffer_t *buffer, int *count);
+
+/* Copy the samples of a sealed chain, oldest first, into out. Returns
+ * the number copied. */
+int historian_chunk_chain_copy(const historian_chunk_t *chain,
+                               int tag_id,
+                               historian_sample_t *out,
+                               int max_count);
+
+/* Copy buffered samples within [start_time_ms, end_time_ms], oldest
+ * first, into out. Returns the number copied. Safe to call while the
+ * writer appends. */
+int historian_chunk_buffer_copy(const historian_chunk_buffer_t *buffer,
+                                int tag_id,
+                                uint64_t start_time_ms,
+                                uint64_t end_time_ms,
+                                historian_sample_t *out,
+                                int max_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_HISTORIAN_CHUNK_H */
@@ -0,0 +1,523 @@
+/*
+ * Water Treatment Controller - Historian Export Engine Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Columnar output layout (native byte order, like the segment files):
+ *
+ *   header:    u32 magic, u16 version, u16 column_count,
+ *              u8 align, u8 reserved[3], u32 interval_ms
+ *   columns:   column_count x { i32 tag_id, u16 name_len, name bytes }
+ *   row group: u32 rows, u64 timestamps[rows],
+ *              column_count x { f32 values[rows], u8 quality[rows] }
+ *   trailer:   u32 0
+ *
+ * Cells without a value are written as NaN with quality 0.
+ */
+
+#include "historian_export.h"
+#include "historian_store.h"
+#include "utils/logger.h"
+#include "utils/time_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#define EXPORT_WRITE_BUFFER_SIZE   (64 * 1024)
+#define EXPORT_ROW_GROUP_ROWS      1024
+#define EXPORT_DEFAULT_DECIMALS    4
+#define EXPORT_MAX_DECIMALS        9
+
+/* How far outside the range interpolation looks for neighbouring samples */
+#define EXPORT_INTERP_LOOKAROUND_MS 3600000ULL
+
+/* Buffered output; one fwrite per 64 KB instead of one fprintf per cell */
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t len;
+    bool failed;
+} export_writer_t;
+
+/* Per-tag input stream */
+typedef struct {
+    historian_cursor_t *cursor;
+    historian_sample_t next;
+    bool has_next;
+    historian_sample_t prev;
+    bool has_prev;
+} export_stream_t;
+
+/* Output cell for the row being assembled */
+typedef struct {
+    float value;
+    uint8_t quality;
+    bool present;
+} export_cell_t;
+
+/* Output sink state */
+typedef struct {
+    export_writer_t writer;
+    const historian_export_options_t *options;
+    int column_count;
+
+    /* CSV */
+    uint64_t ts_cache_sec;
+    char ts_cache_prefix[20];
+    bool ts_cache_valid;
+
+    /* Columnar row group */
+    uint64_t *group_ts;
+    float *group_values;
+    uint8_t *group_quality;
+    int group_rows;
+} export_sink_t;
+
+static const uint64_t pow10_table[EXPORT_MAX_DECIMALS + 1] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL,
+    1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+};
+
+/* ============== Buffered Writer ============== */
+
+static void writer_flush(export_writer_t *w) {
+    if (w->len > 0 && !w->failed) {
+        if (fwrite(w->buf, 1, w->len, w->fp) != w->len) {
+            w->failed = true;
+        }
+    }
+    w->len = 0;
+}
+
+static void writer_put(export_writer_t *w, const void *data, size_t len) {
+    if (w->len + len > EXPORT_WRITE_BUFFER_SIZE) {
+        writer_flush(w);
+    }
+    if (len > EXPORT_WRITE_BUFFER_SIZE) {
+        if (!w->failed && fwrite(data, 1, len, w->fp) != len) {
+            w->failed = true;
+        }
+        return;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+/* Reserve space for up to max_len bytes of formatted text */
+static char *writer_reserve(export_writer_t *w, size_t max_len) {
+    if (w->len + max_len > EXPORT_WRITE_BUFFER_SIZE) {
+        writer_flush(w);
+    }
+    return w->buf + w->len;
+}
+
+/* ============== Text Formatting ============== */
+
+static size_t format_uint(char *out, uint64_t v, int min_digits) {
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    while (n < min_digits) {
+        tmp[n++] = '0';
+    }
+    for (int i = 0; i < n; i++) {
+        out[i] = tmp[n - 1 - i];
+    }
+    return (size_t)n;
+}
+
+/* Fixed-point float formatting, equivalent to "%.*f" for the value ranges
+ * process data takes; falls back to snprintf when the scaled value would
+ * not fit in 64 bits. */
+static size_t format_value(char *out, float value, int decimals) {
+    if (isnan(value)) {
+        memcpy(out, "nan", 3);
+        return 3;
+    }
+    if (isinf(value)) {
+        if (value < 0) {
+            memcpy(out, "-inf", 4);
+            return 4;
+        }
+        memcpy(out, "inf", 3);
+        return 3;
+    }
+
+    double v = value;
+    bool negative = v < 0;
+    if (negative) v = -v;
+
+    uint64_t scale = pow10_table[decimals];
+    if (v * (double)scale >= 1e18) {
+        return (size_t)snprintf(out, 64, "%.*f", decimals, (double)value);
+    }
+
+    uint64_t scaled = (uint64_t)(v * (double)scale + 0.5);
+    size_t n = 0;
+
+    if (negative && scaled != 0) {
+        out[n++] = '-';
+    }
+    n += format_uint(out + n, scaled / scale, 1);
+    if (decimals > 0) {
+        out[n++] = '.';
+        n += format_uint(out + n, scaled % scale, decimals);
+    }
+    return n;
+}
+
+/* ISO 8601 with milliseconds; the date/time prefix is formatted once per second */
+static size_t format_timestamp(export_sink_t *sink, uint64_t ms, char *out) {
+    uint64_t sec = ms / 1000;
+    if (!sink->ts_cache_valid || sink->ts_cache_sec != sec) {
+        char full[32];
+        time_format_iso8601(ms, full, sizeof(full));
+        memcpy(sink->ts_cache_prefix, full, 19);
+        sink->ts_cache_prefix[19] = '\0';
+        sink->ts_cache_sec = sec;
+        sink->ts_cache_valid = true;
+    }
+
+    memcpy(out, sink->ts_cache_prefix, 19);
+    out[19] = '.';
+    format_uint(out + 20, ms % 1000, 3);
+    out[23] = 'Z';
+    return 24;
+}
+
+/* ============== Sinks ============== */
+
+static void columnar_flush_group(export_sink_t *sink) {
+    if (sink->group_rows == 0) return;
+
+    uint32_t rows = (uint32_t)sink->group_rows;
+    writer_put(&sink->writer, &rows, sizeof(rows));
+    writer_put(&sink->writer, sink->group_ts, rows * sizeof(uint64_t));
+    for (int c = 0; c < sink->column_count; c++) {
+        writer_put(&sink->writer, sink->group_values + (size_t)c * EXPORT_ROW_GROUP_ROWS,
+                   rows * sizeof(float));
+        writer_put(&sink->writer, sink->group_quality + (size_t)c * EXPORT_ROW_GROUP_ROWS,
+                   rows);
+    }
+    sink->group_rows = 0;
+}
+
+/* Write a CSV field, quoted as RFC 4180 asks when it holds a delimiter,
+ * a quote or a line break */
+static void writer_put_csv_field(export_writer_t *w, const char *text) {
+    size_t len = strlen(text);
+    if (strcspn(text, ",\"\r\n") == len) {
+        writer_put(w, text, len);
+        return;
+    }
+
+    writer_put(w, "\"", 1);
+    const char *p = text;
+    const char *quote;
+    while ((quote = strchr(p, '"')) != NULL) {
+        writer_put(w, p, (size_t)(quote - p) + 1);
+        writer_put(w, "\"", 1);
+        p = quote + 1;
+    }
+    writer_put(w, p, strlen(p));
+    writer_put(w, "\"", 1);
+}
+
+static void sink_header(export_sink_t *sink, const historian_tag_ref_t *columns) {
+    if (sink->options->format == HISTORIAN_EXPORT_COLUMNAR) {
+        uint32_t magic = HISTORIAN_COLUMNAR_MAGIC;
+        uint16_t version = HISTORIAN_COLUMNAR_VERSION;
+        uint16_t count = (uint16_t)sink->column_count;
+        uint8_t align[4] = { (uint8_t)sink->options->align, 0, 0, 0 };
+        uint32_t interval = sink->options->interval_ms;
+
+        writer_put(&sink->writer, &magic, sizeof(magic));
+        writer_put(&sink->writer, &version, sizeof(version));
+        writer_put(&sink->writer, &count, sizeof(count));
+        writer_put(&sink->writer, align, sizeof(align));
+        writer_put(&sink->writer, &interval, sizeof(interval));
+
+        for (int c = 0; c < sink->column_count; c++) {
+            int32_t tag_id = columns[c].tag_id;
+            uint16_t name_len = (uint16_t)strlen(columns[c].name);
+            writer_put(&sink->writer, &tag_id, sizeof(tag_id));
+            writer_put(&sink->writer, &name_len, sizeof(name_len));
+            writer_put(&sink->writer, columns[c].name, name_len);
+        }
+        return;
+    }
+
+    writer_put(&sink->writer, "timestamp", 9);
+    for (int c = 0; c < sink->column_count; c++) {
+        writer_put(&sink->writer, ",", 1);
+        writer_put_csv_field(&sink->writer, columns[c].name);
+    }
+    writer_put(&sink->writer, "\n", 1);
+}
+
+static void sink_row(export_sink_t *sink, uint64_t timestamp_ms,
+                     const export_cell_t *cells) {
+    if (sink->options->format == HISTORIAN_EXPORT_COLUMNAR) {
+        int r = sink->group_rows;
+        sink->group_ts[r] = timestamp_ms;
+        for (int c = 0; c < sink->column_count; c++) {
+            size_t idx = (size_t)c * EXPORT_ROW_GROUP_ROWS + r;
+            sink->group_values[idx] = cells[c].present ? cells[c].value : NAN;
+            sink->group_quality[idx] = cells[c].present ? cells[c].quality : 0;
+        }
+        if (++sink->group_rows == EXPORT_ROW_GROUP_ROWS) {
+            columnar_flush_group(sink);
+        }
+        return;
+    }
+
+    char *out = writer_reserve(&sink->writer, 32);
+    sink->writer.len += format_timestamp(sink, timestamp_ms, out);
+
+    for (int c = 0; c < sink->column_count; c++) {
+        out = writer_reserve(&sink->writer, 72);
+        size_t n = 0;
+        out[n++] = ',';
+        if (cells[c].present) {
+            n += format_value(out + n, cells[c].value, sink->options->decimals);
+        }
+        sink->writer.len += n;
+    }
+    writer_put(&sink->writer, "\n", 1);
+}
+
+static void sink_finish(export_sink_t *sink) {
+    if (sink->options->format == HISTORIAN_EXPORT_COLUMNAR) {
+        columnar_flush_group(sink);
+        uint32_t trailer = 0;
+        writer_put(&sink->writer, &trailer, sizeof(trailer));
+    }
+    writer_flush(&sink->writer);
+}
+
+/* ============== Merge ============== */
+
+static void stream_advance(export_stream_t *s) {
+    s->has_next = historian_cursor_next(s->cursor, &s->next) == WTC_OK;
+}
+
+/* Min-heap of stream indices keyed by next timestamp */
+static bool heap_less(const export_stream_t *streams, int a, int b) {
+    return streams[a].next.timestamp_ms < streams[b].next.timestamp_ms;
+}
+
+static void heap_push(int *heap, int *size, const export_stream_t *streams, int idx) {
+    int i = (*size)++;
+    heap[i] = idx;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!heap_less(streams, heap[i], heap[parent])) break;
+        int tmp = heap[i]; heap[i] = heap[parent]; heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+static int heap_pop(int *heap, int *size, const export_stream_t *streams) {
+    int top = heap[0];
+    heap[0] = heap[--(*size)];
+    int i = 0;
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < *size && heap_less(streams, heap[l], heap[m])) m = l;
+        if (r < *size && heap_less(streams, heap[r], heap[m])) m = r;
+        if (m == i) break;
+        int tmp = heap[i]; heap[i] = heap[m]; heap[m] = tmp;
+        i = m;
+    }
+    return top;
+}
+
+/* Union of timestamps (raw or carry-forward) via k-way merge */
+static uint64_t export_merge(export_sink_t *sink, export_stream_t *streams,
+                             export_cell_t *cells, int *heap) {
+    int n = sink->column_count;
+    int heap_size = 0;
+    uint64_t rows = 0;
+    bool carry = sink->options->align == HISTORIAN_ALIGN_CARRY_FORWARD;
+
+    for (int i = 0; i < n; i++) {
+        if (streams[i].has_next) {
+            heap_push(heap, &heap_size, streams, i);
+        }
+    }
+
+    while (heap_size > 0 && !sink->writer.failed) {
+        uint64_t ts = streams[heap[0]].next.timestamp_ms;
+
+        if (!carry) {
+            for (int c = 0; c < n; c++) cells[c].present = false;
+        }
+
+        /* Collect every stream positioned at this timestamp; duplicates
+         * within one tag collapse to the last value read. */
+        while (heap_size > 0 && streams[heap[0]].next.timestamp_ms == ts) {
+            int s = heap_pop(heap, &heap_size, streams);
+            cells[s].value = streams[s].next.value;
+            cells[s].quality = streams[s].next.quality;
+            cells[s].present = true;
+
+            stream_advance(&streams[s]);
+            if (streams[s].has_next) {
+                heap_push(heap, &heap_size, streams, s);
+            }
+        }
+
+        sink_row(sink, ts, cells);
+        rows++;
+    }
+
+    return rows;
+}
+
+/* Fixed-interval grid with linear interpolation between neighbours */
+static uint64_t export_interpolate(export_sink_t *sink, export_stream_t *streams,
+                                   export_cell_t *cells,
+                                   uint64_t start_time_ms, uint64_t end_time_ms) {
+    int n = sink->column_count;
+    uint32_t interval = sink->options->interval_ms;
+    uint64_t rows = 0;
+
+    for (uint64_t t = start_time_ms; t <= end_time_ms && !sink->writer.failed; t += interval) {
+        for (int c = 0; c < n; c++) {
+            export_stream_t *s = &streams[c];
+            while (s->has_next && s->next.timestamp_ms <= t) {
+                s->prev = s->next;
+                s->has_prev = true;
+                stream_advance(s);
+            }
+
+            cells[c].present = s->has_prev;
+            if (!s->has_prev) continue;
+
+            if (s->prev.timestamp_ms == t || !s->has_next) {
+                cells[c].value = s->prev.value;
+                cells[c].quality = s->prev.quality;
+            } else {
+                float dt = (float)(s->next.timestamp_ms - s->prev.timestamp_ms);
+                float ratio = (float)(t - s->prev.timestamp_ms) / dt;
+                cells[c].value = s->prev.value + ratio * (s->next.value - s->prev.value);
+                cells[c].quality = s->prev.quality < s->next.quality ?
+                                   s->prev.quality : s->next.quality;
+            }
+        }
+
+        sink_row(sink, t, cells);
+        rows++;
+
+        if (end_time_ms - t < interval) break;
+    }
+
+    return rows;
+}
+
+wtc_result_t historian_export_run(const char *data_dir,
+                                  const historian_tag_ref_t *columns,
+                                  int column_count,
+                                  uint64_t start_time_ms,
+                                  uint64_t end_time_ms,
+                                  const historian_export_options_t *options,
+                                  const char *filename,
+                                  uint64_t *rows_written) {
+    if (!data_dir || !columns || column_count <= 0 || column_count > UINT16_MAX ||
+        !options || !filename || end_time_ms < start_time_ms) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    if (options->align == HISTORIAN_ALIGN_INTERPOLATE && options->interval_ms == 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    historian_export_options_t opts = *options;
+    if (opts.decimals < 0) {
+        opts.decimals = EXPORT_DEFAULT_DECIMALS;
+    }
+    if (opts.decimals > EXPORT_MAX_DECIMALS) {
+        opts.decimals = EXPORT_MAX_DECIMALS;
+    }
+
+    wtc_result_t res = WTC_OK;
+    export_sink_t sink;
+    memset(&sink, 0, sizeof(sink));
+    sink.options = &opts;
+    sink.column_count = column_count;
+
+    export_stream_t *streams = calloc(column_count, sizeof(export_stream_t));
+    export_cell_t *cells = calloc(column_count, sizeof(export_cell_t));
+    int *heap = calloc(column_count, sizeof(int));
+    sink.writer.buf = malloc(EXPORT_WRITE_BUFFER_SIZE);
+    if (opts.format == HISTORIAN_EXPORT_COLUMNAR) {
+        sink.group_ts = calloc(EXPORT_ROW_GROUP_ROWS, sizeof(uint64_t));
+        sink.group_values = calloc((size_t)column_count * EXPORT_ROW_GROUP_ROWS, sizeof(float));
+        sink.group_quality = calloc((size_t)column_count * EXPORT_ROW_GROUP_ROWS, 1);
+    }
+
+    if (!streams || !cells || !heap || !sink.writer.buf ||
+        (opts.format == HISTORIAN_EXPORT_COLUMNAR &&
+         (!sink.group_ts || !sink.group_values || !sink.group_quality))) {
+        res = WTC_ERROR_NO_MEMORY;
+        goto out;
+    }
+
+    /* Interpolation needs the samples bracketing the range edges */
+    uint64_t read_start = start_time_ms;
+    uint64_t read_end = end_time_ms;
+    if (opts.align == HISTORIAN_ALIGN_INTERPOLATE) {
+        uint64_t margin = EXPORT_INTERP_LOOKAROUND_MS + opts.interval_ms;
+        read_start = start_time_ms > margin ? start_time_ms - margin : 0;
+        read_end = end_time_ms < UINT64_MAX - margin ? end_time_ms + margin : UINT64_MAX;
+    }
+
+    for (int i = 0; i < column_count; i++) {
+        res = historian_cursor_open(&streams[i].cursor, data_dir, columns[i].tag_id,
+                                    read_start, read_end);
+        if (res != WTC_OK) goto out;
+        stream_advance(&streams[i]);
+    }
+
+    sink.writer.fp = fopen(filename, opts.format == HISTORIAN_EXPORT_COLUMNAR ? "wb" : "w");
+    if (!sink.writer.fp) {
+        res = WTC_ERROR_IO;
+        goto out;
+    }
+
+    sink_header(&sink, columns);
+
+    uint64_t rows;
+    if (opts.align == HISTORIAN_ALIGN_INTERPOLATE) {
+        rows = export_interpolate(&sink, streams, cells, start_time_ms, end_time_ms);
+    } else {
+        rows = export_merge(&sink, streams, cells, heap);
+    }
+
+    sink_finish(&sink);
+    if (fclose(sink.writer.fp) != 0 || sink.writer.failed) {
+        LOG_ERROR("Write error while exporting historian data to %s", filename);
+        res = WTC_ERROR_IO;
+    }
+
+    if (rows_written) *rows_written = rows;
+
+out:
+    if (streams) {
+        for (int i = 0; i < column_count; i++) {
+            historian_cursor_close(streams[i].cursor);
+        }
+    }
+    free(streams);
+    free(cells);
+    free(heap);
+    free(sink.writer.buf);
+    free(sink.group_ts);
+    free(sink.group_values);
+    free(sink.group_quality);
+    return res;
+}
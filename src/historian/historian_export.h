@@ -0,0 +1,39 @@
+/*
+ * Water Treatment Controller - Historian Export Engine
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Streams persisted samples of several tags into a single time-aligned
+ * table. Each tag is read through its own segment cursor and the cursors
+ * are merged by timestamp, so memory use is independent of the range.
+ */
+
+#ifndef WTC_HISTORIAN_EXPORT_H
+#define WTC_HISTORIAN_EXPORT_H
+
+#include "historian.h"
+#include "historian_store.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Columnar binary export file magic ("WTCX") and version */
+#define HISTORIAN_COLUMNAR_MAGIC    0x58435457u
+#define HISTORIAN_COLUMNAR_VERSION  1
+
+/* Run an export over the segment store in data_dir */
+wtc_result_t historian_export_run(const char *data_dir,
+                                  const historian_tag_ref_t *columns,
+                                  int column_count,
+                                  uint64_t start_time_ms,
+                                  uint64_t end_time_ms,
+                                  const historian_export_options_t *options,
+                                  const char *filename,
+                                  uint64_t *rows_written);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_HISTORIAN_EXPORT_H */
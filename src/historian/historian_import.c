@@ -0,0 +1,668 @@
+/*
+ * Water Treatment Controller - Historian Bulk Import Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Two phases, both on the worker pool:
+ *   1. Parse: the memory-mapped input is cut into line-aligned (CSV) or
+ *      record-aligned (.dat) slices, one per worker, and each worker
+ *      appends samples to its own per-tag vectors.
+ *   2. Merge: workers claim whole tags, concatenate the per-worker
+ *      vectors in file order, stable-sort by timestamp, drop duplicates
+ *      (last occurrence in the file wins, existing store data wins over
+ *      the file) and write one sorted run per (tag, day).
+ */
+
+#include "historian_import.h"
+#include "utils/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define IMPORT_MAX_THREADS      8
+#define IMPORT_MIN_SLICE_BYTES  (256 * 1024)
+#define IMPORT_MAX_FIELD        63
+#define IMPORT_DEFAULT_QUALITY  192
+
+/* Growable sample vector */
+typedef struct {
+    historian_sample_t *items;
+    size_t count;
+    size_t capacity;
+} sample_vec_t;
+
+typedef struct import_ctx import_ctx_t;
+
+/* Per-worker state */
+typedef struct {
+    import_ctx_t *ctx;
+    const char *begin;
+    const char *end;
+    sample_vec_t *vecs;         /* One per tag */
+    uint64_t rows;
+    uint64_t errors;
+    uint64_t imported;
+    uint64_t duplicates;
+    uint64_t bytes;
+    int segments;
+    wtc_result_t result;
+} import_worker_t;
+
+struct import_ctx {
+    const char *data_dir;
+    const historian_tag_ref_t *tags;
+    int tag_count;
+
+    bool raw;
+    int raw_tag_index;
+    const int *column_tags;     /* CSV column -> tag index, -1 if ignored */
+    int column_count;
+
+    import_worker_t *workers;
+    int worker_count;
+
+    pthread_mutex_t claim_lock;
+    int next_tag;
+};
+
+static bool vec_push(sample_vec_t *vec, const historian_sample_t *sample) {
+    if (vec->count == vec->capacity) {
+        size_t new_capacity = vec->capacity ? vec->capacity * 2 : 1024;
+        historian_sample_t *grown = realloc(vec->items, new_capacity * sizeof(historian_sample_t));
+        if (!grown) return false;
+        vec->items = grown;
+        vec->capacity = new_capacity;
+    }
+    vec->items[vec->count++] = *sample;
+    return true;
+}
+
+/* ============== Parsing ============== */
+
+static int64_t days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = (int)(y - era * 400);
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static bool parse_digits(const char *p, int n, int *out) {
+    int v = 0;
+    for (int i = 0; i < n; i++) {
+        if (p[i] < '0' || p[i] > '9') return false;
+        v = v * 10 + (p[i] - '0');
+    }
+    *out = v;
+    return true;
+}
+
+/* Epoch milliseconds or YYYY-MM-DDTHH:MM:SS[.mmm][Z] (UTC) */
+static bool parse_timestamp(const char *field, size_t len, uint64_t *ms) {
+    if (len == 0) return false;
+
+    bool numeric = true;
+    for (size_t i = 0; i < len; i++) {
+        if (field[i] < '0' || field[i] > '9') {
+            numeric = false;
+            break;
+        }
+    }
+    if (numeric) {
+        uint64_t v = 0;
+        for (size_t i = 0; i < len; i++) v = v * 10 + (uint64_t)(field[i] - '0');
+        *ms = v;
+        return true;
+    }
+
+    int year, mon, day, hour, min, sec, millis = 0;
+    if (len < 19 || field[4] != '-' || field[7] != '-' ||
+        (field[10] != 'T' && field[10] != ' ') ||
+        field[13] != ':' || field[16] != ':' ||
+        !parse_digits(field, 4, &year) || !parse_digits(field + 5, 2, &mon) ||
+        !parse_digits(field + 8, 2, &day) || !parse_digits(field + 11, 2, &hour) ||
+        !parse_digits(field + 14, 2, &min) || !parse_digits(field + 17, 2, &sec)) {
+        return false;
+    }
+    if (len >= 23 && field[19] == '.' && !parse_digits(field + 20, 3, &millis)) {
+        return false;
+    }
+    if (mon < 1 || mon > 12 || day < 1 || day > 31 || year < 1970) {
+        return false;
+    }
+
+    int64_t days = days_from_civil(year, mon, day);
+    *ms = ((uint64_t)days * 86400ULL + (uint64_t)(hour * 3600 + min * 60 + sec)) * 1000ULL +
+          (uint64_t)millis;
+    return true;
+}
+
+static const char *line_end(const char *p, const char *end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    return nl ? nl : end;
+}
+
+/* Parse CSV data lines in [begin, end) */
+static void parse_csv_slice(import_worker_t *w) {
+    import_ctx_t *ctx = w->ctx;
+    const char *p = w->begin;
+
+    while (p < w->end) {
+        const char *eol = line_end(p, w->end);
+        const char *stop = (eol > p && eol[-1] == '\r') ? eol - 1 : eol;
+
+        if (stop == p) {
+            p = eol + 1;
+            continue;
+        }
+
+        const char *comma = memchr(p, ',', (size_t)(stop - p));
+        const char *ts_end = comma ? comma : stop;
+        historian_sample_t sample;
+
+        w->rows++;
+        if (!parse_timestamp(p, (size_t)(ts_end - p), &sample.timestamp_ms)) {
+            w->errors++;
+            p = eol + 1;
+            continue;
+        }
+
+        int column = 0;
+        const char *field = comma ? comma + 1 : stop;
+        while (comma && column < ctx->column_count) {
+            const char *next = memchr(field, ',', (size_t)(stop - field));
+            const char *field_end = next ? next : stop;
+            size_t len = (size_t)(field_end - field);
+            int tag_index = ctx->column_tags[column];
+
+            if (len > 0 && tag_index >= 0) {
+                char buf[IMPORT_MAX_FIELD + 1];
+                if (len > IMPORT_MAX_FIELD) len = IMPORT_MAX_FIELD;
+                memcpy(buf, field, len);
+                buf[len] = '\0';
+
+                char *parsed_end;
+                float value = strtof(buf, &parsed_end);
+                if (parsed_end == buf) {
+                    w->errors++;
+                } else {
+                    sample.value = value;
+                    sample.quality = IMPORT_DEFAULT_QUALITY;
+                    sample.tag_id = ctx->tags[tag_index].tag_id;
+                    if (!vec_push(&w->vecs[tag_index], &sample)) {
+                        w->result = WTC_ERROR_NO_MEMORY;
+                        return;
+                    }
+                }
+            }
+
+            column++;
+            if (!next) break;
+            field = next + 1;
+        }
+
+        p = eol + 1;
+    }
+}
+
+/* Parse raw segment records in [begin, end) */
+static void parse_raw_slice(import_worker_t *w) {
+    import_ctx_t *ctx = w->ctx;
+    int tag_id = ctx->tags[ctx->raw_tag_index].tag_id;
+    sample_vec_t *vec = &w->vecs[ctx->raw_tag_index];
+
+    for (const char *p = w->begin; p + HISTORIAN_RECORD_SIZE <= w->end;
+         p += HISTORIAN_RECORD_SIZE) {
+        historian_sample_t sample;
+        historian_record_decode((const uint8_t *)p, tag_id, &sample);
+        w->rows++;
+        if (!vec_push(vec, &sample)) {
+            w->result = WTC_ERROR_NO_MEMORY;
+            return;
+        }
+    }
+}
+
+/* ============== Merge ============== */
+
+/* Stable bottom-up merge sort by timestamp */
+static void sort_samples(historian_sample_t *a, size_t n, historian_sample_t *tmp) {
+    bool sorted = true;
+    for (size_t i = 1; i < n; i++) {
+        if (a[i].timestamp_ms < a[i - 1].timestamp_ms) {
+            sorted = false;
+            break;
+        }
+    }
+    if (sorted) return;
+
+    historian_sample_t *src = a, *dst = tmp;
+    for (size_t width = 1; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            size_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                dst[k++] = src[j].timestamp_ms < src[i].timestamp_ms ? src[j++] : src[i++];
+            }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        historian_sample_t *swap = src; src = dst; dst = swap;
+    }
+    if (src != a) {
+        memcpy(a, src, n * sizeof(historian_sample_t));
+    }
+}
+
+/* Drop samples already present in the store for this day */
+static size_t dedupe_against_store(import_worker_t *w, int tag_id,
+                                   historian_sample_t *day, size_t count) {
+    historian_cursor_t *cursor = NULL;
+    if (historian_cursor_open(&cursor, w->ctx->data_dir, tag_id,
+                              day[0].timestamp_ms, day[count - 1].timestamp_ms) != WTC_OK) {
+        return count;
+    }
+
+    size_t out = 0, i = 0;
+    historian_sample_t existing;
+    bool has_existing = historian_cursor_next(cursor, &existing) == WTC_OK;
+
+    while (i < count) {
+        while (has_existing && existing.timestamp_ms < day[i].timestamp_ms) {
+            has_existing = historian_cursor_next(cursor, &existing) == WTC_OK;
+        }
+        if (has_existing && existing.timestamp_ms == day[i].timestamp_ms) {
+            w->duplicates++;
+        } else {
+            day[out++] = day[i];
+        }
+        i++;
+    }
+
+    historian_cursor_close(cursor);
+    return out;
+}
+
+static void merge_tag(import_worker_t *w, int tag_index) {
+    import_ctx_t *ctx = w->ctx;
+    int tag_id = ctx->tags[tag_index].tag_id;
+
+    size_t total = 0;
+    for (int t = 0; t < ctx->worker_count; t++) {
+        total += ctx->workers[t].vecs[tag_index].count;
+    }
+    if (total == 0) return;
+
+    historian_sample_t *all = malloc(total * sizeof(historian_sample_t));
+    historian_sample_t *tmp = malloc(total * sizeof(historian_sample_t));
+    if (!all || !tmp) {
+        free(all);
+        free(tmp);
+        w->result = WTC_ERROR_NO_MEMORY;
+        return;
+    }
+
+    /* Concatenate in file order so the stable sort keeps it for equal keys */
+    size_t n = 0;
+    for (int t = 0; t < ctx->worker_count; t++) {
+        sample_vec_t *vec = &ctx->workers[t].vecs[tag_index];
+        memcpy(all + n, vec->items, vec->count * sizeof(historian_sample_t));
+        n += vec->count;
+
+        /* Each tag is merged by exactly one worker; release its input early */
+        free(vec->items);
+        vec->items = NULL;
+        vec->count = vec->capacity = 0;
+    }
+    sort_samples(all, n, tmp);
+
+    /* Collapse duplicate timestamps, keeping the last occurrence */
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (unique > 0 && all[unique - 1].timestamp_ms == all[i].timestamp_ms) {
+            all[unique - 1] = all[i];
+            w->duplicates++;
+        } else {
+            all[unique++] = all[i];
+        }
+    }
+
+    /* One run per day */
+    size_t start = 0;
+    while (start < unique && w->result == WTC_OK) {
+        uint64_t day = all[start].timestamp_ms / HISTORIAN_MS_PER_DAY;
+        size_t end = start + 1;
+        while (end < unique && all[end].timestamp_ms / HISTORIAN_MS_PER_DAY == day) {
+            end++;
+        }
+
+        size_t keep = dedupe_against_store(w, tag_id, all + start, end - start);
+        if (keep > 0) {
+            uint64_t bytes = 0;
+            wtc_result_t res = historian_store_write_run(ctx->data_dir, tag_id, all + start,
+                                                         (int)keep, &bytes);
+            if (res != WTC_OK) {
+                w->result = res;
+            } else {
+                w->imported += keep;
+                w->bytes += bytes;
+                w->segments++;
+            }
+        }
+        start = end;
+    }
+
+    free(all);
+    free(tmp);
+}
+
+static void *import_worker_func(void *arg) {
+    import_worker_t *w = (import_worker_t *)arg;
+    import_ctx_t *ctx = w->ctx;
+
+    for (;;) {
+        pthread_mutex_lock(&ctx->claim_lock);
+        int tag_index = ctx->next_tag < ctx->tag_count ? ctx->next_tag++ : -1;
+        pthread_mutex_unlock(&ctx->claim_lock);
+
+        if (tag_index < 0 || w->result != WTC_OK) break;
+        merge_tag(w, tag_index);
+    }
+    return NULL;
+}
+
+static void *parse_worker_func(void *arg) {
+    import_worker_t *w = (import_worker_t *)arg;
+    if (w->ctx->raw) {
+        parse_raw_slice(w);
+    } else {
+        parse_csv_slice(w);
+    }
+    return NULL;
+}
+
+/* Run fn on every worker; worker 0 runs on the calling thread */
+static void run_workers(import_ctx_t *ctx, void *(*fn)(void *)) {
+    pthread_t threads[IMPORT_MAX_THREADS];
+    bool started[IMPORT_MAX_THREADS] = {0};
+
+    for (int i = 1; i < ctx->worker_count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, fn, &ctx->workers[i]) == 0;
+    }
+    fn(&ctx->workers[0]);
+    for (int i = 1; i < ctx->worker_count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            fn(&ctx->workers[i]);
+        }
+    }
+}
+
+/* ============== Input Setup ============== */
+
+/* Tag id from a segment file name: <date>_<tag_id>.dat or .r<N>.dat */
+static int raw_file_tag_id(const char *filename) {
+    const char *base = strrchr(filename, '/');
+    base = base ? base + 1 : filename;
+
+    const char *underscore = strrchr(base, '_');
+    if (!underscore) return -1;
+
+    char *end;
+    long id = strtol(underscore + 1, &end, 10);
+    if (end == underscore + 1 || *end != '.') return -1;
+    return (int)id;
+}
+
+static int find_tag_by_name(const import_ctx_t *ctx, const char *name, size_t len) {
+    for (int i = 0; i < ctx->tag_count; i++) {
+        if (strlen(ctx->tags[i].name) == len && memcmp(ctx->tags[i].name, name, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* End of the header line; a line break inside a quoted name does not end it */
+static const char *header_end(const char *p, const char *end) {
+    bool quoted = false;
+    for (; p < end; p++) {
+        if (*p == '"') {
+            quoted = !quoted;
+        } else if (*p == '\n' && !quoted) {
+            return p;
+        }
+    }
+    return end;
+}
+
+/* Read the header field at p into name, removing RFC 4180 quoting.
+ * Returns the ',' or stop that ends the field. *name_len is name_size
+ * or more when the field did not fit. */
+static const char *read_header_field(const char *p, const char *stop,
+                                     char *name, size_t name_size, size_t *name_len) {
+    size_t len = 0;
+    if (p < stop && *p == '"') {
+        for (p++; p < stop; ) {
+            char ch = *p++;
+            if (ch == '"') {
+                if (p == stop || *p != '"') break;
+                p++;
+            }
+            if (len + 1 < name_size) name[len] = ch;
+            len++;
+        }
+        const char *comma = memchr(p, ',', (size_t)(stop - p));
+        p = comma ? comma : stop;
+    } else {
+        for (; p < stop && *p != ','; p++) {
+            if (len + 1 < name_size) name[len] = *p;
+            len++;
+        }
+    }
+    name[len < name_size ? len : name_size - 1] = '\0';
+    *name_len = len;
+    return p;
+}
+
+/* Map header columns to tags; returns the offset of the first data line */
+static wtc_result_t parse_csv_header(import_ctx_t *ctx, const char *data, size_t size,
+                                     int **column_tags, size_t *data_offset) {
+    const char *end = data + size;
+    const char *eol = header_end(data, end);
+    const char *stop = (eol > data && eol[-1] == '\r') ? eol - 1 : eol;
+    char name[sizeof(ctx->tags[0].name)];
+    size_t name_len;
+
+    /* The first field is the timestamp column */
+    const char *first = read_header_field(data, stop, name, sizeof(name), &name_len);
+    int columns = 0;
+    for (const char *p = first; p < stop; columns++) {
+        p = read_header_field(p + 1, stop, name, sizeof(name), &name_len);
+    }
+    if (columns == 0) {
+        LOG_ERROR("Historian import: header has no data columns");
+        return WTC_ERROR_PROTOCOL;
+    }
+
+    int *map = calloc(columns, sizeof(int));
+    if (!map) return WTC_ERROR_NO_MEMORY;
+
+    const char *p = first;
+    int matched = 0;
+    for (int c = 0; c < columns; c++) {
+        p = read_header_field(p + 1, stop, name, sizeof(name), &name_len);
+        map[c] = name_len < sizeof(name) ? find_tag_by_name(ctx, name, name_len) : -1;
+        if (map[c] >= 0) {
+            matched++;
+        } else {
+            LOG_WARN("Historian import: ignoring unknown column '%s'", name);
+        }
+    }
+
+    if (matched == 0) {
+        free(map);
+        return WTC_ERROR_NOT_FOUND;
+    }
+
+    *column_tags = map;
+    ctx->column_count = columns;
+    *data_offset = eol < end ? (size_t)(eol - data) + 1 : size;
+    return WTC_OK;
+}
+
+wtc_result_t historian_import_run(const char *data_dir,
+                                  const historian_tag_ref_t *tags,
+                                  int tag_count,
+                                  const char *filename,
+                                  int threads,
+                                  historian_import_result_t *result) {
+    if (!data_dir || !tags || tag_count <= 0 || !filename) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Historian import: cannot open %s", filename);
+        return WTC_ERROR_IO;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return WTC_ERROR_IO;
+    }
+
+    historian_import_result_t totals;
+    memset(&totals, 0, sizeof(totals));
+    if (st.st_size == 0) {
+        close(fd);
+        if (result) *result = totals;
+        return WTC_OK;
+    }
+
+    size_t size = (size_t)st.st_size;
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return WTC_ERROR_IO;
+    }
+    madvise((void *)data, size, MADV_SEQUENTIAL);
+
+    import_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.data_dir = data_dir;
+    ctx.tags = tags;
+    ctx.tag_count = tag_count;
+    pthread_mutex_init(&ctx.claim_lock, NULL);
+
+    int *column_tags = NULL;
+    size_t data_offset = 0;
+    wtc_result_t res = WTC_OK;
+
+    size_t name_len = strlen(filename);
+    ctx.raw = name_len > 4 && strcmp(filename + name_len - 4, ".dat") == 0;
+    if (ctx.raw) {
+        int tag_id = raw_file_tag_id(filename);
+        ctx.raw_tag_index = -1;
+        for (int i = 0; i < tag_count; i++) {
+            if (tags[i].tag_id == tag_id) ctx.raw_tag_index = i;
+        }
+        if (ctx.raw_tag_index < 0) {
+            LOG_ERROR("Historian import: %s does not belong to a known tag", filename);
+            res = WTC_ERROR_NOT_FOUND;
+        } else if (size % HISTORIAN_RECORD_SIZE != 0) {
+            totals.parse_errors++;
+        }
+    } else {
+        res = parse_csv_header(&ctx, data, size, &column_tags, &data_offset);
+        ctx.column_tags = column_tags;
+    }
+
+    /* Size the worker pool */
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > IMPORT_MAX_THREADS) threads = IMPORT_MAX_THREADS;
+    size_t body = size - data_offset;
+    if ((size_t)threads > body / IMPORT_MIN_SLICE_BYTES + 1) {
+        threads = (int)(body / IMPORT_MIN_SLICE_BYTES) + 1;
+    }
+
+    if (res == WTC_OK) {
+        ctx.worker_count = threads;
+        ctx.workers = calloc(threads, sizeof(import_worker_t));
+        if (!ctx.workers) res = WTC_ERROR_NO_MEMORY;
+    }
+
+    for (int i = 0; res == WTC_OK && i < ctx.worker_count; i++) {
+        ctx.workers[i].ctx = &ctx;
+        ctx.workers[i].vecs = calloc(tag_count, sizeof(sample_vec_t));
+        if (!ctx.workers[i].vecs) res = WTC_ERROR_NO_MEMORY;
+    }
+
+    if (res == WTC_OK) {
+        /* Slice the body on line (CSV) or record (.dat) boundaries */
+        const char *end = data + size;
+        const char *p = data + data_offset;
+        for (int i = 0; i < ctx.worker_count; i++) {
+            const char *slice_end = end;
+            if (i < ctx.worker_count - 1) {
+                size_t step = (size_t)(end - p) / (size_t)(ctx.worker_count - i);
+                if (ctx.raw) {
+                    step -= step % HISTORIAN_RECORD_SIZE;
+                    slice_end = p + step;
+                } else {
+                    slice_end = line_end(p + step, end);
+                    if (slice_end < end) slice_end++;
+                }
+            }
+            ctx.workers[i].begin = p;
+            ctx.workers[i].end = slice_end;
+            p = slice_end;
+        }
+
+        run_workers(&ctx, parse_worker_func);
+        for (int i = 0; i < ctx.worker_count; i++) {
+            if (ctx.workers[i].result != WTC_OK) res = ctx.workers[i].result;
+        }
+    }
+
+    munmap((void *)data, size);
+
+    if (res == WTC_OK) {
+        run_workers(&ctx, import_worker_func);
+    }
+
+    for (int i = 0; ctx.workers && i < ctx.worker_count; i++) {
+        import_worker_t *w = &ctx.workers[i];
+        if (w->result != WTC_OK && res == WTC_OK) res = w->result;
+        totals.rows_parsed += w->rows;
+        totals.parse_errors += w->errors;
+        totals.samples_imported += w->imported;
+        totals.duplicates_skipped += w->duplicates;
+        totals.bytes_written += w->bytes;
+        totals.segments_written += w->segments;
+
+        for (int t = 0; w->vecs && t < tag_count; t++) {
+            free(w->vecs[t].items);
+        }
+        free(w->vecs);
+    }
+    free(ctx.workers);
+    free(column_tags);
+    pthread_mutex_destroy(&ctx.claim_lock);
+
+    if (result) *result = totals;
+    return res;
+}
@@ -0,0 +1,35 @@
+/*
+ * Water Treatment Controller - Historian Bulk Import
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Loads backfill data (RTU SD-card logs, exports from another controller)
+ * into the segment store. The input is split across worker threads that
+ * parse into per-tag vectors; each tag is then sorted, de-duplicated
+ * against itself and the store, and written as one run per day.
+ */
+
+#ifndef WTC_HISTORIAN_IMPORT_H
+#define WTC_HISTORIAN_IMPORT_H
+
+#include "historian.h"
+#include "historian_store.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Run an import into the segment store in data_dir. CSV columns and raw
+ * segment files are matched against the given tags; others are ignored. */
+wtc_result_t historian_import_run(const char *data_dir,
+                                  const historian_tag_ref_t *tags,
+                                  int tag_count,
+                                  const char *filename,
+                                  int threads,
+                                  historian_import_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_HISTORIAN_IMPORT_H */
@@ -0,0 +1,421 @@
+/*
+ * Water Treatment Controller - Historian Retention Manager Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "historian_retention.h"
+#include "historian_store.h"
+#include "utils/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+
+#define MINUTES_PER_DAY 1440
+#define HOURS_PER_DAY   24
+
+static const uint32_t rollup_intervals_ms[HISTORIAN_ROLLUP_TIERS] = {
+    60000,      /* HISTORIAN_ROLLUP_MINUTE */
+    3600000,    /* HISTORIAN_ROLLUP_HOUR */
+};
+
+/* Everything the scan found for one (tag, day) */
+typedef struct {
+    int tag_id;
+    uint64_t day_ms;
+    bool has_raw;
+    int raw_files;
+    uint64_t raw_bytes;
+    uint64_t raw_mtime_ns;          /* Newest base segment or run */
+    bool has_rollup[HISTORIAN_ROLLUP_TIERS];
+    uint64_t rollup_bytes[HISTORIAN_ROLLUP_TIERS];
+    uint64_t rollup_mtime_ns[HISTORIAN_ROLLUP_TIERS];
+} day_group_t;
+
+/* A file the high-water mark may evict */
+typedef struct {
+    int rank;                       /* 0 = rolled-up raw, 1 + tier = rollup */
+    uint64_t day_ms;
+    int group;
+} evict_candidate_t;
+
+/* Running aggregate of one bucket */
+typedef struct {
+    float min;
+    float max;
+    double sum;
+    uint32_t count;
+} rollup_bucket_t;
+
+uint32_t historian_rollup_interval_ms(historian_rollup_tier_t tier) {
+    return tier < HISTORIAN_ROLLUP_TIERS ? rollup_intervals_ms[tier] : 0;
+}
+
+static int compare_files(const void *a, const void *b) {
+    const historian_store_file_t *fa = a;
+    const historian_store_file_t *fb = b;
+    if (fa->tag_id != fb->tag_id) return fa->tag_id < fb->tag_id ? -1 : 1;
+    if (fa->day_ms != fb->day_ms) return fa->day_ms < fb->day_ms ? -1 : 1;
+    return 0;
+}
+
+static int compare_candidates(const void *a, const void *b) {
+    const evict_candidate_t *ca = a;
+    const evict_candidate_t *cb = b;
+    if (ca->rank != cb->rank) return ca->rank < cb->rank ? -1 : 1;
+    if (ca->day_ms != cb->day_ms) return ca->day_ms < cb->day_ms ? -1 : 1;
+    return 0;
+}
+
+/* Collapse a scan into one entry per (tag, day) */
+static int group_files(historian_store_file_t *files, int file_count, day_group_t *groups) {
+    qsort(files, file_count, sizeof(*files), compare_files);
+
+    int n = 0;
+    for (int i = 0; i < file_count; i++) {
+        const historian_store_file_t *f = &files[i];
+        if (n == 0 || groups[n - 1].tag_id != f->tag_id || groups[n - 1].day_ms != f->day_ms) {
+            memset(&groups[n], 0, sizeof(groups[n]));
+            groups[n].tag_id = f->tag_id;
+            groups[n].day_ms = f->day_ms;
+            n++;
+        }
+
+        day_group_t *g = &groups[n - 1];
+        if (f->kind == HISTORIAN_FILE_ROLLUP) {
+            if (f->index < 0 || f->index >= HISTORIAN_ROLLUP_TIERS) continue;
+            g->has_rollup[f->index] = true;
+            g->rollup_bytes[f->index] = f->size;
+            g->rollup_mtime_ns[f->index] = f->mtime_ns;
+        } else {
+            g->has_raw = true;
+            g->raw_files++;
+            g->raw_bytes += f->size;
+            if (f->mtime_ns > g->raw_mtime_ns) g->raw_mtime_ns = f->mtime_ns;
+        }
+    }
+    return n;
+}
+
+static uint64_t rollup_total(const day_group_t *g) {
+    uint64_t total = 0;
+    for (int t = 0; t < HISTORIAN_ROLLUP_TIERS; t++) {
+        total += g->rollup_bytes[t];
+    }
+    return total;
+}
+
+static bool has_any_rollup(const day_group_t *g) {
+    for (int t = 0; t < HISTORIAN_ROLLUP_TIERS; t++) {
+        if (g->has_rollup[t]) return true;
+    }
+    return false;
+}
+
+/* All tiers exist and are at least as new as the raw data */
+static bool rollups_current(const day_group_t *g) {
+    for (int t = 0; t < HISTORIAN_ROLLUP_TIERS; t++) {
+        if (!g->has_rollup[t] || g->rollup_mtime_ns[t] < g->raw_mtime_ns) return false;
+    }
+    return true;
+}
+
+static void encode_aggregate(const historian_aggregate_t *agg, uint8_t *record) {
+    uint32_t count = (uint32_t)agg->count;
+    memcpy(record, &agg->timestamp_ms, sizeof(uint64_t));
+    memcpy(record + 8, &agg->min, sizeof(float));
+    memcpy(record + 12, &agg->max, sizeof(float));
+    memcpy(record + 16, &agg->avg, sizeof(float));
+    memcpy(record + 20, &count, sizeof(uint32_t));
+}
+
+static void decode_aggregate(const uint8_t *record, historian_aggregate_t *agg) {
+    uint32_t count;
+    memcpy(&agg->timestamp_ms, record, sizeof(uint64_t));
+    memcpy(&agg->min, record + 8, sizeof(float));
+    memcpy(&agg->max, record + 12, sizeof(float));
+    memcpy(&agg->avg, record + 16, sizeof(float));
+    memcpy(&count, record + 20, sizeof(uint32_t));
+    agg->count = (int)count;
+}
+
+/* Write a tier's non-empty buckets to a temporary file and rename it in */
+static wtc_result_t write_rollup_file(const char *path, uint64_t day_ms, uint32_t interval_ms,
+                                      const rollup_bucket_t *buckets, int bucket_count,
+                                      uint64_t *bytes_written) {
+    char tmp_path[280];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        LOG_ERROR("Failed to create historian rollup: %s", tmp_path);
+        return WTC_ERROR_IO;
+    }
+
+    wtc_result_t res = WTC_OK;
+    uint64_t written = 0;
+    for (int b = 0; b < bucket_count && res == WTC_OK; b++) {
+        if (buckets[b].count == 0) continue;
+
+        historian_aggregate_t agg = {
+            .timestamp_ms = day_ms + (uint64_t)b * interval_ms,
+            .min = buckets[b].min,
+            .max = buckets[b].max,
+            .avg = (float)(buckets[b].sum / buckets[b].count),
+            .count = (int)buckets[b].count,
+        };
+        uint8_t record[HISTORIAN_ROLLUP_RECORD_SIZE];
+        encode_aggregate(&agg, record);
+        if (fwrite(record, sizeof(record), 1, fp) != 1) {
+            res = WTC_ERROR_IO;
+        }
+        written += sizeof(record);
+    }
+
+    if (fclose(fp) != 0) {
+        res = WTC_ERROR_IO;
+    }
+    if (res == WTC_OK && rename(tmp_path, path) != 0) {
+        res = WTC_ERROR_IO;
+    }
+    if (res != WTC_OK) {
+        LOG_ERROR("Failed to write historian rollup: %s", path);
+        unlink(tmp_path);
+        return res;
+    }
+
+    *bytes_written = written;
+    return WTC_OK;
+}
+
+static void bucket_add(rollup_bucket_t *bucket, float value) {
+    if (bucket->count == 0 || value < bucket->min) bucket->min = value;
+    if (bucket->count == 0 || value > bucket->max) bucket->max = value;
+    bucket->sum += value;
+    bucket->count++;
+}
+
+/* Downsample one raw day into every tier in a single pass. Bad-quality
+ * and non-finite samples are left out of the aggregates. */
+static wtc_result_t build_rollups(const char *data_dir, day_group_t *g) {
+    rollup_bucket_t *minutes = calloc(MINUTES_PER_DAY + HOURS_PER_DAY, sizeof(rollup_bucket_t));
+    if (!minutes) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+    rollup_bucket_t *hours = minutes + MINUTES_PER_DAY;
+
+    historian_cursor_t *cursor = NULL;
+    wtc_result_t res = historian_cursor_open(&cursor, data_dir, g->tag_id, g->day_ms,
+                                             g->day_ms + HISTORIAN_MS_PER_DAY - 1);
+    if (res != WTC_OK) {
+        free(minutes);
+        return res;
+    }
+
+    historian_sample_t sample;
+    while (historian_cursor_next(cursor, &sample) == WTC_OK) {
+        if ((sample.quality & 0xC0) == 0 || !isfinite(sample.value)) continue;
+        uint64_t offset = sample.timestamp_ms - g->day_ms;
+        bucket_add(&minutes[offset / rollup_intervals_ms[HISTORIAN_ROLLUP_MINUTE]], sample.value);
+        bucket_add(&hours[offset / rollup_intervals_ms[HISTORIAN_ROLLUP_HOUR]], sample.value);
+    }
+    historian_cursor_close(cursor);
+
+    const rollup_bucket_t *tiers[HISTORIAN_ROLLUP_TIERS] = { minutes, hours };
+    const int tier_buckets[HISTORIAN_ROLLUP_TIERS] = { MINUTES_PER_DAY, HOURS_PER_DAY };
+
+    /* Coarsest first: a crash in between leaves the finest tier stale,
+     * which the next sweep notices and repairs */
+    for (int t = HISTORIAN_ROLLUP_TIERS - 1; t >= 0 && res == WTC_OK; t--) {
+        char path[256];
+        uint64_t bytes = 0;
+        historian_store_rollup_path(data_dir, g->day_ms, g->tag_id, t, path, sizeof(path));
+        res = write_rollup_file(path, g->day_ms, rollup_intervals_ms[t],
+                                tiers[t], tier_buckets[t], &bytes);
+        if (res == WTC_OK) {
+            g->has_rollup[t] = true;
+            g->rollup_bytes[t] = bytes;
+            g->rollup_mtime_ns[t] = UINT64_MAX;
+        }
+    }
+
+    free(minutes);
+    return res;
+}
+
+static void remove_raw(const char *data_dir, day_group_t *g,
+                       historian_retention_result_t *result) {
+    uint64_t freed = 0;
+    historian_store_remove_day(data_dir, g->day_ms, g->tag_id, &freed);
+    result->segments_removed += g->raw_files;
+    result->bytes_reclaimed += freed;
+    g->has_raw = false;
+    g->raw_files = 0;
+    g->raw_bytes = 0;
+}
+
+static void remove_rollup(const char *data_dir, day_group_t *g, int tier,
+                          historian_retention_result_t *result) {
+    char path[256];
+    historian_store_rollup_path(data_dir, g->day_ms, g->tag_id, tier, path, sizeof(path));
+    if (unlink(path) == 0) {
+        result->segments_removed++;
+        result->bytes_reclaimed += g->rollup_bytes[tier];
+    }
+    g->has_rollup[tier] = false;
+    g->rollup_bytes[tier] = 0;
+}
+
+/* Last day end (exclusive) that is past a retention of `days` */
+static uint64_t retention_cutoff(uint64_t now_ms, int days) {
+    uint64_t span = (uint64_t)days * HISTORIAN_MS_PER_DAY;
+    return now_ms > span ? now_ms - span : 0;
+}
+
+wtc_result_t historian_retention_sweep(const char *data_dir,
+                                       const historian_retention_policy_t *policy,
+                                       uint64_t now_ms,
+                                       historian_retention_result_t *result) {
+    if (!data_dir || !policy || !result) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    memset(result, 0, sizeof(*result));
+
+    historian_store_file_t *files = NULL;
+    int file_count = 0;
+    wtc_result_t res = historian_store_scan(data_dir, &files, &file_count);
+    if (res != WTC_OK || file_count == 0) {
+        free(files);
+        return res;
+    }
+
+    day_group_t *groups = malloc(file_count * sizeof(day_group_t));
+    if (!groups) {
+        free(files);
+        return WTC_ERROR_NO_MEMORY;
+    }
+    int group_count = group_files(files, file_count, groups);
+    free(files);
+
+    uint64_t raw_cutoff = policy->raw_days > 0 ? retention_cutoff(now_ms, policy->raw_days) : 0;
+
+    /* Roll up completed days, then drop whatever has expired */
+    for (int i = 0; i < group_count; i++) {
+        day_group_t *g = &groups[i];
+        uint64_t day_end = g->day_ms + HISTORIAN_MS_PER_DAY;
+
+        if (g->has_raw && day_end <= now_ms) {
+            bool expired = day_end <= raw_cutoff;
+            bool stale = expired ? !has_any_rollup(g) : !rollups_current(g);
+            if (stale) {
+                uint64_t replaced = rollup_total(g);
+                if (build_rollups(data_dir, g) == WTC_OK) {
+                    result->rollups_written++;
+                    result->rollup_bytes_added += (int64_t)rollup_total(g) - (int64_t)replaced;
+                } else {
+                    /* Keep the raw data until it has been summarized */
+                    continue;
+                }
+            }
+            if (expired) {
+                remove_raw(data_dir, g, result);
+            }
+        }
+
+        for (int t = 0; t < HISTORIAN_ROLLUP_TIERS; t++) {
+            if (g->has_rollup[t] && policy->rollup_days[t] > 0 &&
+                day_end <= retention_cutoff(now_ms, policy->rollup_days[t])) {
+                remove_rollup(data_dir, g, t, result);
+            }
+        }
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < group_count; i++) {
+        total += groups[i].raw_bytes + rollup_total(&groups[i]);
+    }
+
+    /* High-water mark: evict least valuable first */
+    if (policy->max_storage_bytes > 0 && total > policy->max_storage_bytes) {
+        uint64_t low_water = policy->max_storage_bytes / 100 * HISTORIAN_LOW_WATER_PERCENT;
+        evict_candidate_t *candidates =
+            malloc((size_t)group_count * (1 + HISTORIAN_ROLLUP_TIERS) * sizeof(evict_candidate_t));
+        int candidate_count = 0;
+
+        for (int i = 0; candidates && i < group_count; i++) {
+            const day_group_t *g = &groups[i];
+            if (g->has_raw && g->day_ms + HISTORIAN_MS_PER_DAY <= now_ms && rollups_current(g)) {
+                candidates[candidate_count++] = (evict_candidate_t){ 0, g->day_ms, i };
+            }
+            for (int t = 0; t < HISTORIAN_ROLLUP_TIERS; t++) {
+                if (g->has_rollup[t]) {
+                    candidates[candidate_count++] = (evict_candidate_t){ 1 + t, g->day_ms, i };
+                }
+            }
+        }
+
+        if (candidates) {
+            qsort(candidates, candidate_count, sizeof(*candidates), compare_candidates);
+        }
+
+        for (int c = 0; c < candidate_count && total > low_water; c++) {
+            day_group_t *g = &groups[candidates[c].group];
+            if (candidates[c].rank == 0) {
+                uint64_t bytes = g->raw_bytes;
+                remove_raw(data_dir, g, result);
+                total -= bytes;
+            } else {
+                int tier = candidates[c].rank - 1;
+                uint64_t bytes = g->rollup_bytes[tier];
+                remove_rollup(data_dir, g, tier, result);
+                total -= bytes;
+            }
+        }
+        free(candidates);
+
+        if (total > policy->max_storage_bytes) {
+            LOG_WARN("Historian store still at %llu bytes after eviction (limit %llu)",
+                     (unsigned long long)total,
+                     (unsigned long long)policy->max_storage_bytes);
+        }
+    }
+
+    free(groups);
+    result->bytes_on_disk = total;
+    return WTC_OK;
+}
+
+wtc_result_t historian_rollup_read(const char *data_dir,
+                                   int tag_id,
+                                   historian_rollup_tier_t tier,
+                                   uint64_t day_ms,
+                                   historian_aggregate_t *aggregates,
+                                   int *count,
+                                   int max_count) {
+    if (!data_dir || !aggregates || !count || tier >= HISTORIAN_ROLLUP_TIERS) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    char path[256];
+    historian_store_rollup_path(data_dir, day_ms, tag_id, tier, path, sizeof(path));
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        *count = 0;
+        return WTC_ERROR_NOT_FOUND;
+    }
+
+    int n = 0;
+    uint8_t record[HISTORIAN_ROLLUP_RECORD_SIZE];
+    while (n < max_count && fread(record, sizeof(record), 1, fp) == 1) {
+        decode_aggregate(record, &aggregates[n++]);
+    }
+    fclose(fp);
+
+    *count = n;
+    return WTC_OK;
+}
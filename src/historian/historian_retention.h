@@ -0,0 +1,72 @@
+/*
+ * Water Treatment Controller - Historian Retention Manager
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * A retention sweep works on whole files from a single directory scan:
+ *
+ *   1. Every completed day of raw data is downsampled into the rollup
+ *      tiers. A day is rolled up again when any of its raw files is newer
+ *      than its rollups (late flushes, bulk imports).
+ *   2. Raw days older than the raw retention and rollups older than their
+ *      tier's retention are unlinked.
+ *   3. While the store exceeds the disk high-water mark, files are dropped
+ *      least valuable first until it is back under the low-water mark:
+ *      raw days that are already rolled up, then minute rollups, then
+ *      hour rollups, oldest first within each class. Raw data that has no
+ *      rollup yet (the current day) is never evicted.
+ *
+ * A raw day past its retention is only rolled up if it has no rollup at
+ * all, so re-importing long-expired data cannot replace a full rollup
+ * with a partial one.
+ */
+
+#ifndef WTC_HISTORIAN_RETENTION_H
+#define WTC_HISTORIAN_RETENTION_H
+
+#include "historian.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Evict down to this share of max_storage_bytes once it is exceeded */
+#define HISTORIAN_LOW_WATER_PERCENT 90
+
+typedef struct {
+    int raw_days;
+    int rollup_days[HISTORIAN_ROLLUP_TIERS];
+    uint64_t max_storage_bytes;     /* 0 = no high-water mark */
+} historian_retention_policy_t;
+
+typedef struct {
+    int rollups_written;            /* (day, tag) pairs rolled up */
+    int segments_removed;           /* Files unlinked */
+    uint64_t bytes_reclaimed;
+    int64_t rollup_bytes_added;     /* Net of the rollups they replaced */
+    uint64_t bytes_on_disk;         /* Store size after the sweep */
+} historian_retention_result_t;
+
+/* Interval of each rollup tier */
+uint32_t historian_rollup_interval_ms(historian_rollup_tier_t tier);
+
+/* Run one sweep over data_dir as of now_ms */
+wtc_result_t historian_retention_sweep(const char *data_dir,
+                                       const historian_retention_policy_t *policy,
+                                       uint64_t now_ms,
+                                       historian_retention_result_t *result);
+
+/* Read a day's rollup file for a tag */
+wtc_result_t historian_rollup_read(const char *data_dir,
+                                   int tag_id,
+                                   historian_rollup_tier_t tier,
+                                   uint64_t day_ms,
+                                   historian_aggregate_t *aggregates,
+                                   int *count,
+                                   int max_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_HISTORIAN_RETENTION_H */
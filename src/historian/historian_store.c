@@ -0,0 +1,944 @@
+/*
+ * Water Treatment Controller - Historian Segment Store Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "historian_store.h"
+#include "utils/logger.h"
+#include "utils/time_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/* Records encoded per fwrite() when appending */
+#define APPEND_BATCH_RECORDS 256
+
+/* Segment appends, run writes and compactions of the same (tag, day)
+ * are serialized through a striped lock; unrelated segments proceed in
+ * parallel. */
+#define SEGMENT_LOCK_STRIPES 64
+
+static pthread_mutex_t segment_locks[SEGMENT_LOCK_STRIPES];
+static pthread_once_t segment_locks_once = PTHREAD_ONCE_INIT;
+
+/* Read-only mapping of one segment file, shared by cursors */
+typedef struct segment_map {
+    struct segment_map *prev;       /* LRU list, most recent first */
+    struct segment_map *next;
+    char path[256];
+    dev_t dev;
+    ino_t ino;
+    const uint8_t *data;
+    size_t size;                    /* Whole records mapped */
+    int refs;
+    bool stale;                     /* Replaced or removed on disk */
+} segment_map_t;
+
+static struct {
+    pthread_mutex_t lock;
+    segment_map_t *head;
+    segment_map_t *tail;
+    int count;
+    uint64_t bytes;
+    int max_maps;
+    uint64_t max_bytes;
+    uint64_t hits;
+    uint64_t misses;
+} map_cache = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .max_maps = HISTORIAN_MAP_CACHE_ENTRIES,
+    .max_bytes = HISTORIAN_MAP_CACHE_BYTES,
+};
+
+/* One file of the current day (base segment or a run), narrowed to
+ * the records inside the cursor's range */
+typedef struct {
+    segment_map_t *map;
+    const uint8_t *next;
+    const uint8_t *end;
+    historian_sample_t head;
+    bool has_head;
+} cursor_source_t;
+
+struct historian_cursor {
+    char data_dir[256];
+    int tag_id;
+    uint64_t start_time_ms;
+    uint64_t end_time_ms;
+
+    uint64_t day_ms;        /* Next day to open */
+    uint64_t last_day_ms;
+    bool days_done;         /* last_day_ms opened, or nothing to open */
+
+    cursor_source_t sources[1 + HISTORIAN_MAX_SEGMENT_RUNS];
+    int source_count;
+    bool segment_locked;    /* Opened by compaction, segment lock held */
+
+    uint64_t last_emitted_ms;
+    bool has_emitted;
+};
+
+static void init_segment_locks(void) {
+    for (int i = 0; i < SEGMENT_LOCK_STRIPES; i++) {
+        pthread_mutex_init(&segment_locks[i], NULL);
+    }
+}
+
+static pthread_mutex_t *segment_lock(int tag_id, uint64_t day_ms) {
+    pthread_once(&segment_locks_once, init_segment_locks);
+    uint64_t day = day_ms / HISTORIAN_MS_PER_DAY;
+    uint32_t h = (uint32_t)tag_id * 2654435761u ^ (uint32_t)day * 40503u;
+    return &segment_locks[h % SEGMENT_LOCK_STRIPES];
+}
+
+/* ============== Segment Mappings ============== */
+
+static void map_unlink_lru(segment_map_t *map) {
+    if (map->prev) map->prev->next = map->next; else map_cache.head = map->next;
+    if (map->next) map->next->prev = map->prev; else map_cache.tail = map->prev;
+    map->prev = map->next = NULL;
+}
+
+static void map_push_front(segment_map_t *map) {
+    map->prev = NULL;
+    map->next = map_cache.head;
+    if (map_cache.head) map_cache.head->prev = map; else map_cache.tail = map;
+    map_cache.head = map;
+}
+
+/* Unmap an unreferenced mapping; map_cache.lock held */
+static void map_destroy(segment_map_t *map) {
+    map_unlink_lru(map);
+    munmap((void *)map->data, map->size);
+    map_cache.count--;
+    map_cache.bytes -= map->size;
+    free(map);
+}
+
+/* Drop idle mappings, least recently used first, until back within
+ * limits. Mappings in use are never dropped, so limits can be exceeded
+ * while many cursors are open. map_cache.lock held. */
+static void map_evict(void) {
+    segment_map_t *map = map_cache.tail;
+    while (map && (map_cache.count > map_cache.max_maps ||
+                   map_cache.bytes > map_cache.max_bytes)) {
+        segment_map_t *prev = map->prev;
+        if (map->refs == 0) {
+            map_destroy(map);
+        }
+        map = prev;
+    }
+}
+
+/* Map a segment file, reusing a cached mapping while the file is
+ * unchanged. Files only grow by appends or are replaced by rename, so
+ * (inode, size) identifies a mapping's contents. */
+static segment_map_t *map_acquire(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return NULL;
+    size_t size = (size_t)st.st_size - (size_t)st.st_size % HISTORIAN_RECORD_SIZE;
+    if (size == 0) return NULL;
+
+    pthread_mutex_lock(&map_cache.lock);
+    for (segment_map_t *map = map_cache.head; map; map = map->next) {
+        if (map->stale || strcmp(map->path, path) != 0) continue;
+
+        if (map->dev == st.st_dev && map->ino == st.st_ino && map->size == size) {
+            map->refs++;
+            map_cache.hits++;
+            map_unlink_lru(map);
+            map_push_front(map);
+            pthread_mutex_unlock(&map_cache.lock);
+            return map;
+        }
+
+        /* Grown or replaced since it was mapped */
+        map->stale = true;
+        if (map->refs == 0) {
+            map_destroy(map);
+        }
+        break;
+    }
+    map_cache.misses++;
+    pthread_mutex_unlock(&map_cache.lock);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    /* The fd is not needed once mapped; cached mappings hold none */
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    size = (size_t)st.st_size - (size_t)st.st_size % HISTORIAN_RECORD_SIZE;
+    void *data = size > 0 ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    /* Merges walk each file front to back */
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    segment_map_t *map = calloc(1, sizeof(segment_map_t));
+    if (!map) {
+        munmap(data, size);
+        return NULL;
+    }
+    snprintf(map->path, sizeof(map->path), "%s", path);
+    map->dev = st.st_dev;
+    map->ino = st.st_ino;
+    map->data = data;
+    map->size = size;
+    map->refs = 1;
+
+    pthread_mutex_lock(&map_cache.lock);
+    map_push_front(map);
+    map_cache.count++;
+    map_cache.bytes += size;
+    map_evict();
+    pthread_mutex_unlock(&map_cache.lock);
+    return map;
+}
+
+static void map_release(segment_map_t *map) {
+    if (!map) return;
+
+    pthread_mutex_lock(&map_cache.lock);
+    map->refs--;
+    if (map->refs == 0 && map->stale) {
+        map_destroy(map);
+    } else {
+        map_evict();
+    }
+    pthread_mutex_unlock(&map_cache.lock);
+}
+
+/* Forget a file that is being removed or replaced, so its mapping does
+ * not keep the old blocks allocated */
+static void map_invalidate(const char *path) {
+    pthread_mutex_lock(&map_cache.lock);
+    for (segment_map_t *map = map_cache.head; map; map = map->next) {
+        if (map->stale || strcmp(map->path, path) != 0) continue;
+        map->stale = true;
+        if (map->refs == 0) {
+            map_destroy(map);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&map_cache.lock);
+}
+
+void historian_store_set_map_limits(int max_mappings, uint64_t max_bytes) {
+    pthread_mutex_lock(&map_cache.lock);
+    map_cache.max_maps = max_mappings > 0 ? max_mappings : HISTORIAN_MAP_CACHE_ENTRIES;
+    map_cache.max_bytes = max_bytes > 0 ? max_bytes : HISTORIAN_MAP_CACHE_BYTES;
+    map_evict();
+    pthread_mutex_unlock(&map_cache.lock);
+}
+
+void historian_store_get_map_stats(historian_map_stats_t *stats) {
+    if (!stats) return;
+
+    pthread_mutex_lock(&map_cache.lock);
+    stats->mappings = map_cache.count;
+    stats->mapped_bytes = map_cache.bytes;
+    stats->hits = map_cache.hits;
+    stats->misses = map_cache.misses;
+    pthread_mutex_unlock(&map_cache.lock);
+}
+
+static bool file_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+void historian_record_encode(const historian_sample_t *sample, uint8_t *record) {
+    memcpy(record, &sample->timestamp_ms, sizeof(uint64_t));
+    memcpy(record + 8, &sample->value, sizeof(float));
+    record[12] = sample->quality;
+}
+
+void historian_record_decode(const uint8_t *record, int tag_id,
+                             historian_sample_t *sample) {
+    memcpy(&sample->timestamp_ms, record, sizeof(uint64_t));
+    memcpy(&sample->value, record + 8, sizeof(float));
+    sample->quality = record[12];
+    sample->tag_id = tag_id;
+}
+
+wtc_result_t historian_store_ensure_dir(const char *data_dir) {
+    if (!data_dir || !data_dir[0]) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s", data_dir);
+
+    /* mkdir -p: create each component in turn */
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            LOG_ERROR("Failed to create historian directory %s", path);
+            return WTC_ERROR_IO;
+        }
+        *p = '/';
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        LOG_ERROR("Failed to create historian directory %s", path);
+        return WTC_ERROR_IO;
+    }
+
+    return WTC_OK;
+}
+
+void historian_store_segment_path(const char *data_dir, uint64_t day_ms,
+                                  int tag_id, char *buf, size_t buf_size) {
+    char date_str[16];
+    time_format_date(day_ms, date_str, sizeof(date_str));
+    snprintf(buf, buf_size, "%s/%s_%d.dat", data_dir, date_str, tag_id);
+}
+
+void historian_store_run_path(const char *data_dir, uint64_t day_ms,
+                              int tag_id, int run, char *buf, size_t buf_size) {
+    char date_str[16];
+    time_format_date(day_ms, date_str, sizeof(date_str));
+    snprintf(buf, buf_size, "%s/%s_%d.r%d.dat", data_dir, date_str, tag_id, run);
+}
+
+void historian_store_rollup_path(const char *data_dir, uint64_t day_ms,
+                                 int tag_id, int tier, char *buf, size_t buf_size) {
+    char date_str[16];
+    time_format_date(day_ms, date_str, sizeof(date_str));
+    snprintf(buf, buf_size, "%s/%s_%d.t%d.dat", data_dir, date_str, tag_id, tier + 1);
+}
+
+/* Encode and write samples to an open file */
+static wtc_result_t write_records(FILE *fp, const historian_sample_t *samples, int count) {
+    uint8_t batch[APPEND_BATCH_RECORDS * HISTORIAN_RECORD_SIZE];
+
+    for (int i = 0; i < count; i += APPEND_BATCH_RECORDS) {
+        int n = count - i;
+        if (n > APPEND_BATCH_RECORDS) n = APPEND_BATCH_RECORDS;
+
+        for (int j = 0; j < n; j++) {
+            historian_record_encode(&samples[i + j], batch + j * HISTORIAN_RECORD_SIZE);
+        }
+        if (fwrite(batch, HISTORIAN_RECORD_SIZE, n, fp) != (size_t)n) {
+            return WTC_ERROR_IO;
+        }
+    }
+    return WTC_OK;
+}
+
+/* Write samples to a temporary file and rename it into place */
+static wtc_result_t write_file_atomic(const char *path, const historian_sample_t *samples,
+                                      int count) {
+    char tmp_path[280];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        LOG_ERROR("Failed to create historian file: %s", tmp_path);
+        return WTC_ERROR_IO;
+    }
+
+    wtc_result_t res = write_records(fp, samples, count);
+    if (fclose(fp) != 0) {
+        res = WTC_ERROR_IO;
+    }
+    if (res == WTC_OK && rename(tmp_path, path) != 0) {
+        res = WTC_ERROR_IO;
+    }
+    if (res == WTC_OK) {
+        map_invalidate(path);
+    }
+    if (res != WTC_OK) {
+        LOG_ERROR("Failed to write historian file: %s", path);
+        unlink(tmp_path);
+    }
+    return res;
+}
+
+static int compare_samples(const void *a, const void *b) {
+    uint64_t ta = ((const historian_sample_t *)a)->timestamp_ms;
+    uint64_t tb = ((const historian_sample_t *)b)->timestamp_ms;
+    return (ta > tb) - (ta < tb);
+}
+
+/* Timestamp of the last whole record of a file; false if it has none */
+static bool last_record_time(const char *path, uint64_t *timestamp_ms) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    bool found = false;
+    if (fstat(fd, &st) == 0 && st.st_size >= HISTORIAN_RECORD_SIZE) {
+        off_t records = st.st_size / HISTORIAN_RECORD_SIZE;
+        found = pread(fd, timestamp_ms, sizeof(*timestamp_ms),
+                      (records - 1) * HISTORIAN_RECORD_SIZE) == (ssize_t)sizeof(*timestamp_ms);
+    }
+    close(fd);
+    return found;
+}
+
+static wtc_result_t compact_day_locked(const char *data_dir, uint64_t day_start, int tag_id);
+static wtc_result_t cursor_open(historian_cursor_t **cursor, const char *data_dir, int tag_id,
+                                uint64_t start_time_ms, uint64_t end_time_ms,
+                                bool segment_locked);
+
+/* Write sorted samples of one day as its next run; segment lock held */
+static wtc_result_t write_run_locked(const char *data_dir, int tag_id,
+                                     const historian_sample_t *samples, int count) {
+    uint64_t day_ms = samples[0].timestamp_ms;
+    char path[256];
+    wtc_result_t res = WTC_OK;
+
+    int run = 1;
+    while (run <= HISTORIAN_MAX_SEGMENT_RUNS) {
+        historian_store_run_path(data_dir, day_ms, tag_id, run, path, sizeof(path));
+        if (!file_exists(path)) break;
+        run++;
+    }
+    if (run > HISTORIAN_MAX_SEGMENT_RUNS) {
+        res = compact_day_locked(data_dir, (day_ms / HISTORIAN_MS_PER_DAY) * HISTORIAN_MS_PER_DAY,
+                                 tag_id);
+        run = 1;
+        historian_store_run_path(data_dir, day_ms, tag_id, run, path, sizeof(path));
+    }
+
+    if (res == WTC_OK) {
+        res = write_file_atomic(path, samples, count);
+    }
+    return res;
+}
+
+/* Append samples that all fall on the same day to that day's base
+ * segment. Readers binary-search the base, so a batch that is not in
+ * order or starts before the segment's last record is sorted and
+ * written as a run instead. */
+static wtc_result_t append_day_segment(const char *data_dir, int tag_id,
+                                   const historian_sample_t *samples, int count) {
+    char filename[256];
+    historian_store_segment_path(data_dir, samples[0].timestamp_ms, tag_id,
+                                 filename, sizeof(filename));
+
+    pthread_mutex_t *lock = segment_lock(tag_id, samples[0].timestamp_ms);
+    pthread_mutex_lock(lock);
+
+    bool in_order = true;
+    for (int i = 1; i < count && in_order; i++) {
+        in_order = samples[i].timestamp_ms >= samples[i - 1].timestamp_ms;
+    }
+    uint64_t last_ms;
+    if (in_order && last_record_time(filename, &last_ms)) {
+        in_order = samples[0].timestamp_ms >= last_ms;
+    }
+
+    if (!in_order) {
+        historian_sample_t *sorted = malloc((size_t)count * sizeof(historian_sample_t));
+        if (!sorted) {
+            pthread_mutex_unlock(lock);
+            return WTC_ERROR_NO_MEMORY;
+        }
+        memcpy(sorted, samples, (size_t)count * sizeof(historian_sample_t));
+        qsort(sorted, (size_t)count, sizeof(historian_sample_t), compare_samples);
+        wtc_result_t res = historian_store_ensure_dir(data_dir);
+        if (res == WTC_OK) {
+            res = write_run_locked(data_dir, tag_id, sorted, count);
+        }
+        pthread_mutex_unlock(lock);
+        free(sorted);
+        return res;
+    }
+
+    FILE *fp = fopen(filename, "ab");
+    if (!fp) {
+        if (historian_store_ensure_dir(data_dir) == WTC_OK) {
+            fp = fopen(filename, "ab");
+        }
+        if (!fp) {
+            pthread_mutex_unlock(lock);
+            LOG_ERROR("Failed to open historian file: %s", filename);
+            return WTC_ERROR_IO;
+        }
+    }
+
+    struct stat st;
+    off_t prev_size = fstat(fileno(fp), &st) == 0 ? st.st_size : -1;
+
+    wtc_result_t res = write_records(fp, samples, count);
+    if (fclose(fp) != 0) {
+        res = WTC_ERROR_IO;
+    }
+    if (res != WTC_OK) {
+        /* Cut a partial record off so the segment stays whole records */
+        LOG_ERROR("Short write to historian file: %s", filename);
+        if (prev_size >= 0 && truncate(filename, prev_size) != 0) {
+            LOG_ERROR("Failed to truncate historian file: %s", filename);
+        }
+    }
+
+    pthread_mutex_unlock(lock);
+    return res;
+}
+
+wtc_result_t historian_store_append(const char *data_dir, int tag_id,
+                                    const historian_sample_t *samples,
+                                    int count, uint64_t *bytes_written) {
+    if (!data_dir || !samples || count < 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t written = 0;
+    int run_start = 0;
+
+    while (run_start < count) {
+        uint64_t day = samples[run_start].timestamp_ms / HISTORIAN_MS_PER_DAY;
+        int run_end = run_start + 1;
+        while (run_end < count &&
+               samples[run_end].timestamp_ms / HISTORIAN_MS_PER_DAY == day) {
+            run_end++;
+        }
+
+        wtc_result_t res = append_day_segment(data_dir, tag_id, &samples[run_start],
+                                          run_end - run_start);
+        if (res != WTC_OK) {
+            if (bytes_written) *bytes_written = written;
+            return res;
+        }
+
+        written += (uint64_t)(run_end - run_start) * HISTORIAN_RECORD_SIZE;
+        run_start = run_end;
+    }
+
+    if (bytes_written) *bytes_written = written;
+    return WTC_OK;
+}
+
+wtc_result_t historian_store_compact_day(const char *data_dir, uint64_t day_ms,
+                                         int tag_id) {
+    if (!data_dir) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t day_start = (day_ms / HISTORIAN_MS_PER_DAY) * HISTORIAN_MS_PER_DAY;
+    pthread_mutex_t *lock = segment_lock(tag_id, day_start);
+    pthread_mutex_lock(lock);
+    wtc_result_t res = compact_day_locked(data_dir, day_start, tag_id);
+    pthread_mutex_unlock(lock);
+    return res;
+}
+
+/* Merge a day's runs into its base segment; segment lock held */
+static wtc_result_t compact_day_locked(const char *data_dir, uint64_t day_start, int tag_id) {
+    /* Read the merged, de-duplicated view of the day */
+    historian_cursor_t *cursor = NULL;
+    wtc_result_t res = cursor_open(&cursor, data_dir, tag_id, day_start,
+                                   day_start + HISTORIAN_MS_PER_DAY - 1, true);
+    historian_sample_t *merged = NULL;
+    int count = 0, capacity = 0;
+
+    while (res == WTC_OK) {
+        historian_sample_t sample;
+        if (historian_cursor_next(cursor, &sample) != WTC_OK) break;
+
+        if (count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 4096;
+            historian_sample_t *grown = realloc(merged, new_capacity * sizeof(historian_sample_t));
+            if (!grown) {
+                res = WTC_ERROR_NO_MEMORY;
+                break;
+            }
+            merged = grown;
+            capacity = new_capacity;
+        }
+        merged[count++] = sample;
+    }
+    historian_cursor_close(cursor);
+
+    char path[256];
+    if (res == WTC_OK) {
+        historian_store_segment_path(data_dir, day_start, tag_id, path, sizeof(path));
+        res = write_file_atomic(path, merged, count);
+    }
+    if (res == WTC_OK) {
+        for (int run = 1; run <= HISTORIAN_MAX_SEGMENT_RUNS; run++) {
+            historian_store_run_path(data_dir, day_start, tag_id, run, path, sizeof(path));
+            map_invalidate(path);
+            unlink(path);
+        }
+        LOG_DEBUG("Compacted historian segment for tag %d (%d samples)", tag_id, count);
+    }
+
+    free(merged);
+    return res;
+}
+
+wtc_result_t historian_store_write_run(const char *data_dir, int tag_id,
+                                       const historian_sample_t *samples,
+                                       int count, uint64_t *bytes_written) {
+    if (!data_dir || !samples || count <= 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    wtc_result_t res = historian_store_ensure_dir(data_dir);
+    if (res != WTC_OK) {
+        return res;
+    }
+
+    pthread_mutex_t *lock = segment_lock(tag_id, samples[0].timestamp_ms);
+    pthread_mutex_lock(lock);
+    res = write_run_locked(data_dir, tag_id, samples, count);
+    pthread_mutex_unlock(lock);
+
+    if (res == WTC_OK && bytes_written) {
+        *bytes_written = (uint64_t)count * HISTORIAN_RECORD_SIZE;
+    }
+    return res;
+}
+
+static void remove_file(const char *path, uint64_t *bytes_freed) {
+    struct stat st;
+    if (stat(path, &st) != 0) return;
+    map_invalidate(path);
+    if (unlink(path) == 0 && bytes_freed) {
+        *bytes_freed += (uint64_t)st.st_size;
+    }
+}
+
+wtc_result_t historian_store_remove_day(const char *data_dir, uint64_t day_ms,
+                                        int tag_id, uint64_t *bytes_freed) {
+    if (!data_dir) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_t *lock = segment_lock(tag_id, day_ms);
+    pthread_mutex_lock(lock);
+
+    char path[256];
+    historian_store_segment_path(data_dir, day_ms, tag_id, path, sizeof(path));
+    remove_file(path, bytes_freed);
+    for (int run = 1; run <= HISTORIAN_MAX_SEGMENT_RUNS; run++) {
+        historian_store_run_path(data_dir, day_ms, tag_id, run, path, sizeof(path));
+        remove_file(path, bytes_freed);
+    }
+
+    pthread_mutex_unlock(lock);
+    return WTC_OK;
+}
+
+/* ============== Directory Scan ============== */
+
+/* Parse "<YYYY-MM-DD>_<tag>[.r<N>|.t<N>].dat" */
+static bool parse_file_name(const char *name, historian_store_file_t *file) {
+    int year, mon, mday, tag, consumed = 0;
+    if (sscanf(name, "%4d-%2d-%2d_%d%n", &year, &mon, &mday, &tag, &consumed) != 4) {
+        return false;
+    }
+
+    const char *rest = name + consumed;
+    file->kind = HISTORIAN_FILE_SEGMENT;
+    file->index = 0;
+    if (rest[0] == '.' && (rest[1] == 'r' || rest[1] == 't')) {
+        char *end;
+        long index = strtol(rest + 2, &end, 10);
+        if (end == rest + 2 || index <= 0) return false;
+        file->kind = rest[1] == 'r' ? HISTORIAN_FILE_RUN : HISTORIAN_FILE_ROLLUP;
+        file->index = rest[1] == 'r' ? (int)index : (int)index - 1;
+        rest = end;
+    }
+    if (strcmp(rest, ".dat") != 0) {
+        return false;
+    }
+
+    struct tm tm_info = {0};
+    tm_info.tm_year = year - 1900;
+    tm_info.tm_mon = mon - 1;
+    tm_info.tm_mday = mday;
+    file->day_ms = (uint64_t)timegm(&tm_info) * 1000ULL;
+    file->tag_id = tag;
+    return true;
+}
+
+wtc_result_t historian_store_scan(const char *data_dir,
+                                  historian_store_file_t **files,
+                                  int *count) {
+    if (!data_dir || !files || !count) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    *files = NULL;
+    *count = 0;
+
+    DIR *dir = opendir(data_dir);
+    if (!dir) {
+        /* Nothing flushed yet */
+        return errno == ENOENT ? WTC_OK : WTC_ERROR_IO;
+    }
+
+    historian_store_file_t *list = NULL;
+    int n = 0, capacity = 0;
+    wtc_result_t res = WTC_OK;
+    struct dirent *entry;
+    char path[512];
+
+    while ((entry = readdir(dir)) != NULL) {
+        historian_store_file_t file;
+        if (!parse_file_name(entry->d_name, &file)) continue;
+
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", data_dir, entry->d_name);
+        if (stat(path, &st) != 0) continue;
+        file.size = (uint64_t)st.st_size;
+        file.mtime_ns = (uint64_t)st.st_mtim.tv_sec * 1000000000ULL +
+                        (uint64_t)st.st_mtim.tv_nsec;
+
+        if (n == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 256;
+            historian_store_file_t *grown = realloc(list, new_capacity * sizeof(*list));
+            if (!grown) {
+                res = WTC_ERROR_NO_MEMORY;
+                break;
+            }
+            list = grown;
+            capacity = new_capacity;
+        }
+        list[n++] = file;
+    }
+    closedir(dir);
+
+    if (res != WTC_OK) {
+        free(list);
+        return res;
+    }
+
+    *files = list;
+    *count = n;
+    return WTC_OK;
+}
+
+/* ============== Read Cursor ============== */
+
+/* One directory scan is cheaper than probing this many days one by one */
+#define CURSOR_PROBE_DAYS 366
+
+static void cursor_narrow_days(historian_cursor_t *cur) {
+    historian_store_file_t *files = NULL;
+    int count = 0;
+    if (historian_store_scan(cur->data_dir, &files, &count) != WTC_OK) {
+        return;
+    }
+
+    uint64_t first = UINT64_MAX, last = 0;
+    for (int i = 0; i < count; i++) {
+        if (files[i].tag_id != cur->tag_id || files[i].kind == HISTORIAN_FILE_ROLLUP) continue;
+        if (files[i].day_ms < first) first = files[i].day_ms;
+        if (files[i].day_ms > last) last = files[i].day_ms;
+    }
+    free(files);
+
+    if (first == UINT64_MAX) {
+        /* Nothing stored: an empty range */
+        cur->days_done = true;
+        return;
+    }
+    if (first > cur->day_ms) cur->day_ms = first;
+    if (last < cur->last_day_ms) cur->last_day_ms = last;
+    cur->days_done = cur->day_ms > cur->last_day_ms;
+}
+
+wtc_result_t historian_cursor_open(historian_cursor_t **cursor,
+                                   const char *data_dir,
+                                   int tag_id,
+                                   uint64_t start_time_ms,
+                                   uint64_t end_time_ms) {
+    return cursor_open(cursor, data_dir, tag_id, start_time_ms, end_time_ms, false);
+}
+
+static wtc_result_t cursor_open(historian_cursor_t **cursor, const char *data_dir, int tag_id,
+                                uint64_t start_time_ms, uint64_t end_time_ms,
+                                bool segment_locked) {
+    if (!cursor || !data_dir || end_time_ms < start_time_ms) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    historian_cursor_t *cur = calloc(1, sizeof(historian_cursor_t));
+    if (!cur) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    snprintf(cur->data_dir, sizeof(cur->data_dir), "%s", data_dir);
+    cur->tag_id = tag_id;
+    cur->start_time_ms = start_time_ms;
+    cur->end_time_ms = end_time_ms;
+    cur->segment_locked = segment_locked;
+    cur->day_ms = (start_time_ms / HISTORIAN_MS_PER_DAY) * HISTORIAN_MS_PER_DAY;
+    cur->last_day_ms = (end_time_ms / HISTORIAN_MS_PER_DAY) * HISTORIAN_MS_PER_DAY;
+    cur->days_done = cur->day_ms > cur->last_day_ms;
+
+    /* Rather than probing every day of a wide range, narrow it to the
+     * days the tag has files for */
+    if (!cur->days_done &&
+        cur->last_day_ms - cur->day_ms > CURSOR_PROBE_DAYS * HISTORIAN_MS_PER_DAY) {
+        cursor_narrow_days(cur);
+    }
+
+    *cursor = cur;
+    return WTC_OK;
+}
+
+/* Load the next record of a source into its head */
+static void source_advance(cursor_source_t *src, int tag_id) {
+    if (src->next >= src->end) {
+        src->has_head = false;
+        return;
+    }
+
+    historian_record_decode(src->next, tag_id, &src->head);
+    src->next += HISTORIAN_RECORD_SIZE;
+    src->has_head = true;
+}
+
+/* First record of a sorted file with timestamp >= t (fixed-size records
+ * make the file its own index) */
+static size_t lower_bound(const uint8_t *data, size_t records, uint64_t t) {
+    size_t lo = 0, hi = records;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint64_t ts;
+        memcpy(&ts, data + mid * HISTORIAN_RECORD_SIZE, sizeof(ts));
+        if (ts < t) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static bool cursor_add_source(historian_cursor_t *cur, const char *path) {
+    segment_map_t *map = map_acquire(path);
+    if (!map) return false;
+
+    size_t records = map->size / HISTORIAN_RECORD_SIZE;
+    size_t first = lower_bound(map->data, records, cur->start_time_ms);
+    size_t last = cur->end_time_ms == UINT64_MAX ?
+                  records : lower_bound(map->data, records, cur->end_time_ms + 1);
+
+    cursor_source_t *src = &cur->sources[cur->source_count];
+    src->map = map;
+    src->next = map->data + first * HISTORIAN_RECORD_SIZE;
+    src->end = map->data + last * HISTORIAN_RECORD_SIZE;
+
+    /* Start paging in the part of the file the range covers */
+    if (last > first) {
+        uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t lo = (uintptr_t)src->next & ~(page - 1);
+        madvise((void *)lo, (uintptr_t)src->end - lo, MADV_WILLNEED);
+    }
+
+    cur->source_count++;
+    source_advance(src, cur->tag_id);
+    return true;
+}
+
+static void cursor_close_sources(historian_cursor_t *cur) {
+    for (int i = 0; i < cur->source_count; i++) {
+        map_release(cur->sources[i].map);
+        cur->sources[i].map = NULL;
+        cur->sources[i].has_head = false;
+    }
+    cur->source_count = 0;
+}
+
+/* Open the base segment and runs of the next day in range that has data */
+static bool cursor_open_next_day(historian_cursor_t *cur) {
+    /* A flag rather than day_ms > last_day_ms, which wraps for the
+     * last representable day */
+    while (!cur->days_done) {
+        char path[256];
+        uint64_t day = cur->day_ms;
+        if (day >= cur->last_day_ms) {
+            cur->days_done = true;
+        } else {
+            cur->day_ms += HISTORIAN_MS_PER_DAY;
+        }
+
+        /* Map the day's files together, so a compaction folding runs
+         * into the base segment is seen entirely or not at all */
+        pthread_mutex_t *lock = segment_lock(cur->tag_id, day);
+        if (!cur->segment_locked) pthread_mutex_lock(lock);
+        historian_store_segment_path(cur->data_dir, day, cur->tag_id, path, sizeof(path));
+        cursor_add_source(cur, path);
+
+        for (int run = 1; run <= HISTORIAN_MAX_SEGMENT_RUNS; run++) {
+            historian_store_run_path(cur->data_dir, day, cur->tag_id, run, path, sizeof(path));
+            if (!cursor_add_source(cur, path)) break;
+        }
+        if (!cur->segment_locked) pthread_mutex_unlock(lock);
+
+        if (cur->source_count > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+wtc_result_t historian_cursor_next(historian_cursor_t *cursor,
+                                   historian_sample_t *sample) {
+    if (!cursor || !sample) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    for (;;) {
+        /* Pick the earliest head among the day's files */
+        cursor_source_t *min = NULL;
+        for (int i = 0; i < cursor->source_count; i++) {
+            cursor_source_t *src = &cursor->sources[i];
+            if (src->has_head &&
+                (!min || src->head.timestamp_ms < min->head.timestamp_ms)) {
+                min = src;
+            }
+        }
+
+        if (!min) {
+            cursor_close_sources(cursor);
+            if (!cursor_open_next_day(cursor)) {
+                return WTC_ERROR_EMPTY;
+            }
+            continue;
+        }
+
+        *sample = min->head;
+        source_advance(min, cursor->tag_id);
+
+        if (sample->timestamp_ms < cursor->start_time_ms ||
+            sample->timestamp_ms > cursor->end_time_ms) {
+            continue;
+        }
+        if (cursor->has_emitted && sample->timestamp_ms == cursor->last_emitted_ms) {
+            continue;
+        }
+
+        cursor->last_emitted_ms = sample->timestamp_ms;
+        cursor->has_emitted = true;
+        return WTC_OK;
+    }
+}
+
+void historian_cursor_close(historian_cursor_t *cursor) {
+    if (!cursor) return;
+    cursor_close_sources(cursor);
+    free(cursor);
+}
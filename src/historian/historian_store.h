@@ -0,0 +1,167 @@
+/*
+ * Water Treatment Controller - Historian Segment Store
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Persisted historian data lives in one file per (UTC day, tag):
+ *
+ *   <data_dir>/<YYYY-MM-DD>_<tag_id>.dat
+ *
+ * Each file is a sequence of fixed-size records in native byte order:
+ * timestamp (8 bytes), value (4 bytes), quality (1 byte). Samples are
+ * filed by their own timestamp, so a segment only ever holds samples
+ * from its day and can be read or dropped independently of the others.
+ *
+ * Out-of-order data (bulk imports, backfill) is never spliced into the
+ * base segment. Each batch is written as a sorted run beside it:
+ *
+ *   <data_dir>/<YYYY-MM-DD>_<tag_id>.r<N>.dat
+ *
+ * Readers merge the base segment and its runs by timestamp, keeping the
+ * first record seen for any duplicated timestamp. Once a day collects
+ * HISTORIAN_MAX_SEGMENT_RUNS runs they are compacted into the base.
+ *
+ * Completed days are downsampled into rollup tiers by the retention
+ * manager (historian_retention.h), one file per (day, tag, tier):
+ *
+ *   <data_dir>/<YYYY-MM-DD>_<tag_id>.t<N>.dat
+ *
+ * holding fixed-size aggregate records: bucket start (8 bytes), min,
+ * max and avg (4 bytes each) and sample count (4 bytes).
+ */
+
+#ifndef WTC_HISTORIAN_STORE_H
+#define WTC_HISTORIAN_STORE_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTORIAN_DEFAULT_DATA_DIR  "/var/lib/water-controller/historian"
+#define HISTORIAN_RECORD_SIZE       13
+#define HISTORIAN_MS_PER_DAY        86400000ULL
+#define HISTORIAN_MAX_SEGMENT_RUNS  16
+#define HISTORIAN_ROLLUP_RECORD_SIZE 24
+
+/* Tag id with its display name, as passed to the export/import engines */
+typedef struct {
+    int tag_id;
+    char name[WTC_MAX_NAME * 2];
+} historian_tag_ref_t;
+
+/* Encode/decode a single on-disk record */
+void historian_record_encode(const historian_sample_t *sample, uint8_t *record);
+void historian_record_decode(const uint8_t *record, int tag_id,
+                             historian_sample_t *sample);
+
+/* Create the data directory (and parents) if missing */
+wtc_result_t historian_store_ensure_dir(const char *data_dir);
+
+/* Build the segment path for the day containing day_ms */
+void historian_store_segment_path(const char *data_dir, uint64_t day_ms,
+                                  int tag_id, char *buf, size_t buf_size);
+
+/* Build the path of import run N (N >= 1) for the day containing day_ms */
+void historian_store_run_path(const char *data_dir, uint64_t day_ms,
+                              int tag_id, int run, char *buf, size_t buf_size);
+
+/* Build the path of a rollup tier (0 = finest, stored as .t1) */
+void historian_store_rollup_path(const char *data_dir, uint64_t day_ms,
+                                 int tag_id, int tier, char *buf, size_t buf_size);
+
+/* Append samples of one tag, split across day segments. A day's batch
+ * that is out of order, or older than the segment's last record, is
+ * sorted and written as a run so the base stays sorted. */
+wtc_result_t historian_store_append(const char *data_dir, int tag_id,
+                                    const historian_sample_t *samples,
+                                    int count, uint64_t *bytes_written);
+
+/* Write samples sorted by timestamp, all from one day, as a new run of
+ * that day's segment. Compacts the day first if it has no free run slot. */
+wtc_result_t historian_store_write_run(const char *data_dir, int tag_id,
+                                       const historian_sample_t *samples,
+                                       int count, uint64_t *bytes_written);
+
+/* Merge a day's runs into its base segment */
+wtc_result_t historian_store_compact_day(const char *data_dir, uint64_t day_ms,
+                                         int tag_id);
+
+/* Unlink a day's base segment and runs. Whole files only; nothing is
+ * rewritten. Adds the size of the removed files to bytes_freed. */
+wtc_result_t historian_store_remove_day(const char *data_dir, uint64_t day_ms,
+                                        int tag_id, uint64_t *bytes_freed);
+
+/* ============== Directory Scan ============== */
+
+typedef enum {
+    HISTORIAN_FILE_SEGMENT = 0,     /* Base segment */
+    HISTORIAN_FILE_RUN,             /* Import run, index = run number */
+    HISTORIAN_FILE_ROLLUP,          /* Rollup tier, index = tier (0 = finest) */
+} historian_file_kind_t;
+
+typedef struct {
+    uint64_t day_ms;
+    int tag_id;
+    historian_file_kind_t kind;
+    int index;
+    uint64_t size;
+    uint64_t mtime_ns;
+} historian_store_file_t;
+
+/* List the store's files (one stat per file, contents untouched).
+ * The array is allocated with malloc and owned by the caller. */
+wtc_result_t historian_store_scan(const char *data_dir,
+                                  historian_store_file_t **files,
+                                  int *count);
+
+/* ============== Segment Mappings ============== */
+
+/* Cursors read segment files through read-only mappings kept in a
+ * process-wide LRU and shared between cursors, so repeated queries over
+ * the same days are served from the page cache without reopening or
+ * copying. A mapping holds no file descriptor. Idle mappings beyond
+ * either limit are unmapped, least recently used first. */
+#define HISTORIAN_MAP_CACHE_ENTRIES 64
+#define HISTORIAN_MAP_CACHE_BYTES   (256ULL * 1024 * 1024)
+
+typedef struct {
+    int mappings;
+    uint64_t mapped_bytes;
+    uint64_t hits;
+    uint64_t misses;
+} historian_map_stats_t;
+
+/* Bound the mapping cache (0 = default) */
+void historian_store_set_map_limits(int max_mappings, uint64_t max_bytes);
+
+void historian_store_get_map_stats(historian_map_stats_t *stats);
+
+/* ============== Read Cursor ============== */
+
+/* Sequential reader over the persisted samples of one tag. Segments are
+ * mapped one day at a time; each file is binary searched for the range
+ * and records are decoded straight from the mapped pages. No historian
+ * lock is needed; flushes only ever append whole records and rewritten
+ * files appear atomically by rename, so an existing mapping stays
+ * valid. */
+typedef struct historian_cursor historian_cursor_t;
+
+wtc_result_t historian_cursor_open(historian_cursor_t **cursor,
+                                   const char *data_dir,
+                                   int tag_id,
+                                   uint64_t start_time_ms,
+                                   uint64_t end_time_ms);
+
+/* Fetch next sample in range. Returns WTC_ERROR_EMPTY when exhausted. */
+wtc_result_t historian_cursor_next(historian_cursor_t *cursor,
+                                   historian_sample_t *sample);
+
+void historian_cursor_close(historian_cursor_t *cursor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_HISTORIAN_STORE_H */
@@ -0,0 +1,418 @@
+/*
+ * Water Treatment Controller - Historian Write-Ahead Log Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "historian_wal.h"
+#include "historian_store.h"
+#include "utils/logger.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define WAL_MAGIC       "WTCWAL01"
+#define WAL_HEADER_SIZE 16
+#define WAL_DIR_MAX     256
+
+/* One mapped log file */
+typedef struct wal_file {
+    struct wal_file *next;          /* Oldest first */
+    uint64_t seq;
+    char path[PATH_MAX];
+    uint8_t *data;
+    size_t size;
+    size_t pos;                     /* Append offset */
+    size_t synced;                  /* Committed up to here */
+    int refs;                       /* Commits in progress */
+    bool released;
+} wal_file_t;
+
+/* Appends come from the historian's writers; commit and release from
+ * its I/O thread. lock is never held across msync. */
+struct historian_wal {
+    pthread_mutex_t lock;
+    char data_dir[WAL_DIR_MAX];
+    size_t file_bytes;
+    wal_file_t *files;
+    wal_file_t *active;
+    uint64_t leftover_first;        /* Files from a previous run, not mapped */
+    uint64_t leftover_last;
+};
+
+/* Paths fit a PATH_MAX buffer: data_dir is checked against its own
+ * buffer at open */
+static void wal_path(const char *data_dir, uint64_t seq, char *buf, size_t size) {
+    snprintf(buf, size, "%s/wal-%llu.log", data_dir, (unsigned long long)seq);
+}
+
+/* FNV-1a over the record body, salted with the file's sequence */
+static uint32_t record_check(const uint8_t *record, uint64_t seq) {
+    uint32_t h = 2166136261u ^ (uint32_t)seq;
+    for (int i = 0; i < HISTORIAN_WAL_RECORD_SIZE - 4; i++) {
+        h = (h ^ record[i]) * 16777619u;
+    }
+    return h;
+}
+
+static void encode_record(const historian_sample_t *sample, uint64_t seq, uint8_t *record) {
+    int32_t tag_id = sample->tag_id;
+    memcpy(record, &sample->timestamp_ms, 8);
+    memcpy(record + 8, &tag_id, 4);
+    memcpy(record + 12, &sample->value, 4);
+    record[16] = sample->quality;
+    record[17] = record[18] = record[19] = 0;
+    uint32_t check = record_check(record, seq);
+    memcpy(record + 20, &check, 4);
+}
+
+static bool decode_record(const uint8_t *record, uint64_t seq, historian_sample_t *sample) {
+    uint32_t check;
+    memcpy(&check, record + 20, 4);
+    if (check != record_check(record, seq)) return false;
+
+    int32_t tag_id;
+    memcpy(&sample->timestamp_ms, record, 8);
+    memcpy(&tag_id, record + 8, 4);
+    memcpy(&sample->value, record + 12, 4);
+    sample->quality = record[16];
+    sample->tag_id = tag_id;
+    return true;
+}
+
+static void file_destroy(wal_file_t *file) {
+    munmap(file->data, file->size);
+    free(file);
+}
+
+/* Create, size and map a new log file */
+static wal_file_t *file_create(historian_wal_t *wal, uint64_t seq) {
+    wal_file_t *file = calloc(1, sizeof(wal_file_t));
+    if (!file) return NULL;
+
+    wal_path(wal->data_dir, seq, file->path, sizeof(file->path));
+    int fd = open(file->path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        free(file);
+        return NULL;
+    }
+
+    void *data = MAP_FAILED;
+    if (ftruncate(fd, (off_t)wal->file_bytes) == 0) {
+        data = mmap(NULL, wal->file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        unlink(file->path);
+        free(file);
+        return NULL;
+    }
+
+    file->seq = seq;
+    file->data = data;
+    file->size = wal->file_bytes;
+    memcpy(file->data, WAL_MAGIC, 8);
+    memcpy(file->data + 8, &seq, 8);
+    file->pos = WAL_HEADER_SIZE;
+    return file;
+}
+
+/* Make a new file active; lock held */
+static bool wal_advance(historian_wal_t *wal) {
+    uint64_t seq = wal->active ? wal->active->seq + 1 : wal->leftover_last + 1;
+    wal_file_t *file = file_create(wal, seq);
+    if (!file) {
+        LOG_ERROR("Failed to create historian WAL file %llu", (unsigned long long)seq);
+        return false;
+    }
+
+    if (wal->active) {
+        wal->active->next = file;
+    } else {
+        wal->files = file;
+    }
+    wal->active = file;
+    return true;
+}
+
+wtc_result_t historian_wal_open(historian_wal_t **wal, const char *data_dir,
+                                size_t file_bytes) {
+    if (!wal || !data_dir) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    if (file_bytes == 0) {
+        file_bytes = HISTORIAN_WAL_DEFAULT_BYTES;
+    }
+    if (file_bytes < WAL_HEADER_SIZE + HISTORIAN_WAL_RECORD_SIZE ||
+        strlen(data_dir) >= WAL_DIR_MAX) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    wtc_result_t res = historian_store_ensure_dir(data_dir);
+    if (res != WTC_OK) {
+        return res;
+    }
+
+    historian_wal_t *w = calloc(1, sizeof(historian_wal_t));
+    if (!w) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+    snprintf(w->data_dir, sizeof(w->data_dir), "%s", data_dir);
+    w->file_bytes = file_bytes;
+    pthread_mutex_init(&w->lock, NULL);
+
+    /* Find the files a previous run left behind */
+    DIR *dir = opendir(data_dir);
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            unsigned long long seq;
+            char tail[8];
+            if (sscanf(entry->d_name, "wal-%llu.%7s", &seq, tail) != 2 ||
+                strcmp(tail, "log") != 0 || seq == 0) {
+                continue;
+            }
+            if (w->leftover_first == 0 || seq < w->leftover_first) w->leftover_first = seq;
+            if (seq > w->leftover_last) w->leftover_last = seq;
+        }
+        closedir(dir);
+    }
+
+    if (!wal_advance(w)) {
+        pthread_mutex_destroy(&w->lock);
+        free(w);
+        return WTC_ERROR_IO;
+    }
+
+    *wal = w;
+    return WTC_OK;
+}
+
+void historian_wal_close(historian_wal_t *wal) {
+    if (!wal) return;
+
+    historian_wal_commit(wal);
+    wal_file_t *file = wal->files;
+    while (file) {
+        wal_file_t *next = file->next;
+        file_destroy(file);
+        file = next;
+    }
+    pthread_mutex_destroy(&wal->lock);
+    free(wal);
+}
+
+wtc_result_t historian_wal_append(historian_wal_t *wal, const historian_sample_t *sample) {
+    if (!wal || !sample) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&wal->lock);
+    wal_file_t *file = wal->active;
+    if (file->pos + HISTORIAN_WAL_RECORD_SIZE > file->size) {
+        if (!wal_advance(wal)) {
+            pthread_mutex_unlock(&wal->lock);
+            return WTC_ERROR_IO;
+        }
+        file = wal->active;
+    }
+
+    encode_record(sample, file->seq, file->data + file->pos);
+    file->pos += HISTORIAN_WAL_RECORD_SIZE;
+    pthread_mutex_unlock(&wal->lock);
+    return WTC_OK;
+}
+
+wtc_result_t historian_wal_commit(historian_wal_t *wal) {
+    if (!wal) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    /* Pin the dirty files, then sync them unlocked */
+    wal_file_t *dirty[8];
+    size_t upto[8];
+    int n = 0;
+    wtc_result_t res = WTC_OK;
+
+    do {
+        n = 0;
+        pthread_mutex_lock(&wal->lock);
+        for (wal_file_t *file = wal->files; file && n < 8; file = file->next) {
+            if (file->released || file->synced >= file->pos) continue;
+            file->refs++;
+            dirty[n] = file;
+            upto[n] = file->pos;
+            n++;
+        }
+        pthread_mutex_unlock(&wal->lock);
+
+        long page = sysconf(_SC_PAGESIZE);
+        for (int i = 0; i < n; i++) {
+            size_t from = dirty[i]->synced & ~((size_t)page - 1);
+            if (msync(dirty[i]->data + from, upto[i] - from, MS_SYNC) != 0) {
+                res = WTC_ERROR_IO;
+            }
+        }
+
+        pthread_mutex_lock(&wal->lock);
+        for (int i = 0; i < n; i++) {
+            wal_file_t *file = dirty[i];
+            if (res == WTC_OK && upto[i] > file->synced) {
+                file->synced = upto[i];
+            }
+            file->refs--;
+        }
+        pthread_mutex_unlock(&wal->lock);
+    } while (n == 8 && res == WTC_OK);
+
+    return res;
+}
+
+uint64_t historian_wal_rotate(historian_wal_t *wal) {
+    if (!wal) return 0;
+
+    pthread_mutex_lock(&wal->lock);
+    /* An empty file is kept; everything before it is in older files */
+    uint64_t closed = wal->active->seq - 1;
+    if (wal->active->pos > WAL_HEADER_SIZE) {
+        if (wal_advance(wal)) {
+            closed++;
+        } else {
+            /* Keep appending to the old file; it is released later */
+            LOG_WARN("Historian WAL rotation failed, continuing in file %llu",
+                     (unsigned long long)wal->active->seq);
+        }
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return closed;
+}
+
+uint64_t historian_wal_active_seq(historian_wal_t *wal) {
+    if (!wal) return 0;
+
+    pthread_mutex_lock(&wal->lock);
+    uint64_t seq = wal->active->seq;
+    pthread_mutex_unlock(&wal->lock);
+    return seq;
+}
+
+void historian_wal_release(historian_wal_t *wal, uint64_t upto) {
+    if (!wal) return;
+
+    pthread_mutex_lock(&wal->lock);
+
+    /* Leftovers of a previous run */
+    char path[PATH_MAX];
+    while (wal->leftover_first != 0 && wal->leftover_first <= upto &&
+           wal->leftover_first <= wal->leftover_last) {
+        wal_path(wal->data_dir, wal->leftover_first, path, sizeof(path));
+        unlink(path);
+        wal->leftover_first++;
+    }
+    if (wal->leftover_first > wal->leftover_last) {
+        wal->leftover_first = 0;
+    }
+
+    /* Mapped files, except the active one */
+    wal_file_t **link = &wal->files;
+    while (*link && *link != wal->active && (*link)->seq <= upto) {
+        wal_file_t *file = *link;
+        unlink(file->path);
+        if (file->refs > 0) {
+            /* A commit is syncing it; unmapped on the next release */
+            file->released = true;
+            link = &file->next;
+            continue;
+        }
+        *link = file->next;
+        file_destroy(file);
+    }
+
+    pthread_mutex_unlock(&wal->lock);
+}
+
+/* Append the valid records of one leftover file */
+static wtc_result_t recover_file(const char *path, uint64_t seq,
+                                 historian_sample_t **samples, int *count, int *capacity) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return WTC_OK;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < WAL_HEADER_SIZE) {
+        close(fd);
+        return WTC_OK;
+    }
+    size_t size = (size_t)st.st_size;
+    uint8_t *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return WTC_ERROR_IO;
+    }
+
+    uint64_t header_seq;
+    memcpy(&header_seq, data + 8, 8);
+    wtc_result_t res = WTC_OK;
+    if (memcmp(data, WAL_MAGIC, 8) != 0 || header_seq != seq) {
+        LOG_WARN("Ignoring historian WAL file with bad header: %s", path);
+    } else {
+        for (size_t pos = WAL_HEADER_SIZE; pos + HISTORIAN_WAL_RECORD_SIZE <= size;
+             pos += HISTORIAN_WAL_RECORD_SIZE) {
+            historian_sample_t sample;
+            if (!decode_record(data + pos, seq, &sample)) break;
+
+            if (*count == *capacity) {
+                int new_capacity = *capacity ? *capacity * 2 : 4096;
+                historian_sample_t *grown = realloc(*samples,
+                                                    new_capacity * sizeof(historian_sample_t));
+                if (!grown) {
+                    res = WTC_ERROR_NO_MEMORY;
+                    break;
+                }
+                *samples = grown;
+                *capacity = new_capacity;
+            }
+            (*samples)[(*count)++] = sample;
+        }
+    }
+
+    munmap(data, size);
+    return res;
+}
+
+wtc_result_t historian_wal_recover(historian_wal_t *wal,
+                                   historian_sample_t **samples,
+                                   int *count,
+                                   uint64_t *last_seq) {
+    if (!wal || !samples || !count) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    *samples = NULL;
+    *count = 0;
+    if (last_seq) *last_seq = wal->leftover_last;
+    if (wal->leftover_first == 0) {
+        return WTC_OK;
+    }
+
+    int capacity = 0;
+    for (uint64_t seq = wal->leftover_first; seq <= wal->leftover_last; seq++) {
+        char path[PATH_MAX];
+        wal_path(wal->data_dir, seq, path, sizeof(path));
+        wtc_result_t res = recover_file(path, seq, samples, count, &capacity);
+        if (res != WTC_OK) {
+            free(*samples);
+            *samples = NULL;
+            *count = 0;
+            return res;
+        }
+    }
+    return WTC_OK;
+}
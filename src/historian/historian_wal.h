@@ -0,0 +1,78 @@
+/*
+ * Water Treatment Controller - Historian Write-Ahead Log
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Every buffered sample is first appended to a memory-mapped log file:
+ *
+ *   <data_dir>/wal-<seq>.log
+ *
+ * Files are preallocated and hold a 16-byte header (magic, sequence
+ * number) followed by fixed 24-byte records: timestamp (8), tag id (4),
+ * value (4), quality (1), padding (3) and a check word (4) that covers
+ * the record and the file's sequence number. Replay stops at the first
+ * record whose check fails, so a torn tail is ignored.
+ *
+ * Appends only write to the mapping; historian_wal_commit() msyncs what
+ * was appended since the last commit, so durability costs one sync per
+ * commit period rather than per sample. A process crash loses nothing
+ * since the pages live in the page cache; a power loss loses at most
+ * one commit period.
+ *
+ * The historian rotates to a new file whenever it seals its buffers and
+ * releases old files once their samples are in the segment store.
+ */
+
+#ifndef WTC_HISTORIAN_WAL_H
+#define WTC_HISTORIAN_WAL_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTORIAN_WAL_RECORD_SIZE   24
+#define HISTORIAN_WAL_DEFAULT_BYTES (8 * 1024 * 1024)
+
+typedef struct historian_wal historian_wal_t;
+
+/* Open the log in data_dir. Existing files are left for
+ * historian_wal_recover(); new samples go to a fresh file. */
+wtc_result_t historian_wal_open(historian_wal_t **wal, const char *data_dir,
+                                size_t file_bytes);
+
+/* Commit, unmap and close. Unreleased files stay on disk for replay. */
+void historian_wal_close(historian_wal_t *wal);
+
+/* Append one sample; moves to a new file when the active one is full */
+wtc_result_t historian_wal_append(historian_wal_t *wal, const historian_sample_t *sample);
+
+/* Make everything appended so far durable */
+wtc_result_t historian_wal_commit(historian_wal_t *wal);
+
+/* Start a new file unless the active one is empty. Every sample
+ * appended before the call lives in files <= the returned sequence
+ * number, which is always below the active file's. */
+uint64_t historian_wal_rotate(historian_wal_t *wal);
+
+/* Sequence number of the file being appended to */
+uint64_t historian_wal_active_seq(historian_wal_t *wal);
+
+/* Delete the files with sequence numbers <= upto (never the active one) */
+void historian_wal_release(historian_wal_t *wal, uint64_t upto);
+
+/* Read the samples of the files left over from a previous run, oldest
+ * file first. The array is allocated with malloc and owned by the
+ * caller; release the files once the samples are persisted. Returns the
+ * last leftover sequence number in *last_seq (0 if none). */
+wtc_result_t historian_wal_recover(historian_wal_t *wal,
+                                   historian_sample_t **samples,
+                                   int *count,
+                                   uint64_t *last_seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_HISTORIAN_WAL_H */
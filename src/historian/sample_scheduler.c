@@ -0,0 +1,140 @@
+/*
+ * Water Treatment Controller - Historian Sample Scheduler Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "sample_scheduler.h"
+
+#include <stdlib.h>
+
+struct sample_scheduler {
+    sample_slot_t *heap;
+    int *pos;               /* Heap index of each key, -1 if unscheduled */
+    int count;
+    int capacity;
+};
+
+static void heap_place(sample_scheduler_t *s, int i, sample_slot_t slot) {
+    s->heap[i] = slot;
+    s->pos[slot.key] = i;
+}
+
+static void sift_up(sample_scheduler_t *s, int i) {
+    sample_slot_t slot = s->heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (s->heap[parent].due_ms <= slot.due_ms) break;
+        heap_place(s, i, s->heap[parent]);
+        i = parent;
+    }
+    heap_place(s, i, slot);
+}
+
+static void sift_down(sample_scheduler_t *s, int i) {
+    sample_slot_t slot = s->heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= s->count) break;
+        if (child + 1 < s->count && s->heap[child + 1].due_ms < s->heap[child].due_ms) {
+            child++;
+        }
+        if (slot.due_ms <= s->heap[child].due_ms) break;
+        heap_place(s, i, s->heap[child]);
+        i = child;
+    }
+    heap_place(s, i, slot);
+}
+
+static void heap_remove_at(sample_scheduler_t *s, int i) {
+    s->pos[s->heap[i].key] = -1;
+    s->count--;
+    if (i == s->count) return;
+
+    heap_place(s, i, s->heap[s->count]);
+    if (i > 0 && s->heap[(i - 1) / 2].due_ms > s->heap[i].due_ms) {
+        sift_up(s, i);
+    } else {
+        sift_down(s, i);
+    }
+}
+
+wtc_result_t sample_scheduler_init(sample_scheduler_t **scheduler, int capacity) {
+    if (!scheduler || capacity <= 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    sample_scheduler_t *s = calloc(1, sizeof(sample_scheduler_t));
+    if (!s) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    s->heap = calloc(capacity, sizeof(sample_slot_t));
+    s->pos = malloc(capacity * sizeof(int));
+    if (!s->heap || !s->pos) {
+        free(s->heap);
+        free(s->pos);
+        free(s);
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    for (int i = 0; i < capacity; i++) {
+        s->pos[i] = -1;
+    }
+    s->capacity = capacity;
+
+    *scheduler = s;
+    return WTC_OK;
+}
+
+void sample_scheduler_cleanup(sample_scheduler_t *scheduler) {
+    if (!scheduler) return;
+    free(scheduler->heap);
+    free(scheduler->pos);
+    free(scheduler);
+}
+
+wtc_result_t sample_scheduler_set(sample_scheduler_t *scheduler, int key, uint64_t due_ms) {
+    if (!scheduler || key < 0 || key >= scheduler->capacity) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    int i = scheduler->pos[key];
+    if (i < 0) {
+        i = scheduler->count++;
+        heap_place(scheduler, i, (sample_slot_t){ due_ms, key });
+        sift_up(scheduler, i);
+    } else if (due_ms < scheduler->heap[i].due_ms) {
+        scheduler->heap[i].due_ms = due_ms;
+        sift_up(scheduler, i);
+    } else {
+        scheduler->heap[i].due_ms = due_ms;
+        sift_down(scheduler, i);
+    }
+    return WTC_OK;
+}
+
+void sample_scheduler_remove(sample_scheduler_t *scheduler, int key) {
+    if (!scheduler || key < 0 || key >= scheduler->capacity) return;
+    if (scheduler->pos[key] >= 0) {
+        heap_remove_at(scheduler, scheduler->pos[key]);
+    }
+}
+
+bool sample_scheduler_next(const sample_scheduler_t *scheduler, uint64_t *due_ms) {
+    if (!scheduler || scheduler->count == 0) return false;
+    if (due_ms) *due_ms = scheduler->heap[0].due_ms;
+    return true;
+}
+
+int sample_scheduler_pop_due(sample_scheduler_t *scheduler, uint64_t now_ms,
+                             sample_slot_t *slots, int max_slots) {
+    if (!scheduler || !slots) return 0;
+
+    int n = 0;
+    while (n < max_slots && scheduler->count > 0 && scheduler->heap[0].due_ms <= now_ms) {
+        slots[n++] = scheduler->heap[0];
+        heap_remove_at(scheduler, 0);
+    }
+    return n;
+}
@@ -0,0 +1,53 @@
+/*
+ * Water Treatment Controller - Historian Sample Scheduler
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Min-heap of tags keyed by their next sample time. Keys are the
+ * caller's dense tag indices (0 .. capacity-1); each key is in the heap
+ * at most once. Finding the due tags costs O(due * log n) instead of a
+ * pass over every tag.
+ */
+
+#ifndef WTC_SAMPLE_SCHEDULER_H
+#define WTC_SAMPLE_SCHEDULER_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sample_scheduler sample_scheduler_t;
+
+/* A scheduled tag */
+typedef struct {
+    uint64_t due_ms;
+    int key;
+} sample_slot_t;
+
+/* Initialize scheduler for keys 0 .. capacity-1 */
+wtc_result_t sample_scheduler_init(sample_scheduler_t **scheduler, int capacity);
+
+/* Cleanup scheduler */
+void sample_scheduler_cleanup(sample_scheduler_t *scheduler);
+
+/* Schedule a key, or move it if already scheduled */
+wtc_result_t sample_scheduler_set(sample_scheduler_t *scheduler, int key, uint64_t due_ms);
+
+/* Unschedule a key (no-op if not scheduled) */
+void sample_scheduler_remove(sample_scheduler_t *scheduler, int key);
+
+/* Earliest due time. Returns false when nothing is scheduled. */
+bool sample_scheduler_next(const sample_scheduler_t *scheduler, uint64_t *due_ms);
+
+/* Remove and return up to max_slots keys due at or before now_ms,
+ * earliest first. Callers reschedule them with sample_scheduler_set. */
+int sample_scheduler_pop_due(sample_scheduler_t *scheduler, uint64_t now_ms,
+                             sample_slot_t *slots, int max_slots);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_SAMPLE_SCHEDULER_H */
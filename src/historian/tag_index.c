@@ -0,0 +1,210 @@
+/*
+ * Water Treatment Controller - Tag Handle Index Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "tag_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define EMPTY_SLOT (-1)
+
+typedef struct {
+    int tag_id;
+    int slot;
+    char station[WTC_MAX_STATION_NAME];
+    bool in_use;
+    int next_free;
+} handle_entry_t;
+
+/* Both hash tables use linear probing and hold handles; keys are read
+ * back from the handle entries, so a table slot is a single int. */
+struct tag_index {
+    handle_entry_t *handles;
+    int capacity;
+    int limit;              /* Handles ever used */
+    int count;
+    int free_head;
+
+    int *id_table;
+    int *point_table;
+    uint32_t mask;
+};
+
+static uint32_t hash_id(int tag_id) {
+    return (uint32_t)tag_id * 2654435761u;
+}
+
+/* Hashes the station as stored, i.e. truncated to the entry's buffer */
+static uint32_t hash_point(const char *station, int slot) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < WTC_MAX_STATION_NAME - 1 && station[i]; i++) {
+        h = (h ^ (uint8_t)station[i]) * 16777619u;
+    }
+    return (h ^ (uint32_t)slot) * 2654435761u;
+}
+
+static uint32_t home_of(const tag_index_t *index, const int *table, int handle) {
+    const handle_entry_t *e = &index->handles[handle];
+    uint32_t h = table == index->id_table ? hash_id(e->tag_id) : hash_point(e->station, e->slot);
+    return h & index->mask;
+}
+
+static void table_insert(tag_index_t *index, int *table, uint32_t hash, int handle) {
+    uint32_t i = hash & index->mask;
+    while (table[i] != EMPTY_SLOT) {
+        i = (i + 1) & index->mask;
+    }
+    table[i] = handle;
+}
+
+/* Remove a handle, shifting later probes back so no tombstones remain */
+static void table_erase(tag_index_t *index, int *table, uint32_t hash, int handle) {
+    uint32_t i = hash & index->mask;
+    while (table[i] != handle) {
+        if (table[i] == EMPTY_SLOT) return;
+        i = (i + 1) & index->mask;
+    }
+
+    table[i] = EMPTY_SLOT;
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & index->mask;
+        if (table[j] == EMPTY_SLOT) break;
+
+        uint32_t k = home_of(index, table, table[j]);
+        bool movable = (i <= j) ? (k <= i || k > j) : (k <= i && k > j);
+        if (movable) {
+            table[i] = table[j];
+            table[j] = EMPTY_SLOT;
+            i = j;
+        }
+    }
+}
+
+wtc_result_t tag_index_init(tag_index_t **index, int capacity) {
+    if (!index || capacity <= 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    tag_index_t *ix = calloc(1, sizeof(tag_index_t));
+    if (!ix) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    /* Keep both tables at most half full */
+    uint32_t size = 16;
+    while (size < (uint32_t)capacity * 2) {
+        size <<= 1;
+    }
+
+    ix->handles = calloc(capacity, sizeof(handle_entry_t));
+    ix->id_table = malloc(size * sizeof(int));
+    ix->point_table = malloc(size * sizeof(int));
+    if (!ix->handles || !ix->id_table || !ix->point_table) {
+        tag_index_cleanup(ix);
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    for (uint32_t i = 0; i < size; i++) {
+        ix->id_table[i] = EMPTY_SLOT;
+        ix->point_table[i] = EMPTY_SLOT;
+    }
+    ix->mask = size - 1;
+    ix->capacity = capacity;
+    ix->free_head = -1;
+
+    *index = ix;
+    return WTC_OK;
+}
+
+void tag_index_cleanup(tag_index_t *index) {
+    if (!index) return;
+    free(index->handles);
+    free(index->id_table);
+    free(index->point_table);
+    free(index);
+}
+
+int tag_index_add(tag_index_t *index, int tag_id, const char *station, int slot) {
+    if (!index || !station) return -1;
+    if (tag_index_find_id(index, tag_id) >= 0 ||
+        tag_index_find_point(index, station, slot) >= 0) {
+        return -1;
+    }
+
+    int handle;
+    if (index->free_head >= 0) {
+        handle = index->free_head;
+        index->free_head = index->handles[handle].next_free;
+    } else if (index->limit < index->capacity) {
+        handle = index->limit++;
+    } else {
+        return -1;
+    }
+
+    handle_entry_t *e = &index->handles[handle];
+    memset(e, 0, sizeof(*e));
+    e->tag_id = tag_id;
+    e->slot = slot;
+    strncpy(e->station, station, sizeof(e->station) - 1);
+    e->in_use = true;
+
+    table_insert(index, index->id_table, hash_id(tag_id), handle);
+    table_insert(index, index->point_table, hash_point(e->station, slot), handle);
+    index->count++;
+    return handle;
+}
+
+void tag_index_remove(tag_index_t *index, int handle) {
+    if (!tag_index_in_use(index, handle)) return;
+
+    handle_entry_t *e = &index->handles[handle];
+    table_erase(index, index->id_table, hash_id(e->tag_id), handle);
+    table_erase(index, index->point_table, hash_point(e->station, e->slot), handle);
+
+    e->in_use = false;
+    e->next_free = index->free_head;
+    index->free_head = handle;
+    index->count--;
+}
+
+int tag_index_find_id(const tag_index_t *index, int tag_id) {
+    if (!index) return -1;
+
+    uint32_t i = hash_id(tag_id) & index->mask;
+    while (index->id_table[i] != EMPTY_SLOT) {
+        int handle = index->id_table[i];
+        if (index->handles[handle].tag_id == tag_id) return handle;
+        i = (i + 1) & index->mask;
+    }
+    return -1;
+}
+
+int tag_index_find_point(const tag_index_t *index, const char *station, int slot) {
+    if (!index || !station) return -1;
+
+    uint32_t i = hash_point(station, slot) & index->mask;
+    while (index->point_table[i] != EMPTY_SLOT) {
+        const handle_entry_t *e = &index->handles[index->point_table[i]];
+        if (e->slot == slot && strncmp(e->station, station, sizeof(e->station) - 1) == 0) {
+            return index->point_table[i];
+        }
+        i = (i + 1) & index->mask;
+    }
+    return -1;
+}
+
+int tag_index_limit(const tag_index_t *index) {
+    return index ? index->limit : 0;
+}
+
+bool tag_index_in_use(const tag_index_t *index, int handle) {
+    return index && handle >= 0 && handle < index->limit && index->handles[handle].in_use;
+}
+
+int tag_index_count(const tag_index_t *index) {
+    return index ? index->count : 0;
+}
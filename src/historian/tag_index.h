@@ -0,0 +1,56 @@
+/*
+ * Water Treatment Controller - Tag Handle Index
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Stable handles for tag tables plus O(1) lookups. A handle is a dense
+ * index into the owner's tag arrays; released handles go on a free list
+ * and are reused, so removing a tag never moves the others. Two hash
+ * indexes map tag_id and (station, slot) to handles.
+ *
+ * Not thread-safe; owners call it under their own lock.
+ */
+
+#ifndef WTC_TAG_INDEX_H
+#define WTC_TAG_INDEX_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tag_index tag_index_t;
+
+/* Initialize index for up to capacity handles */
+wtc_result_t tag_index_init(tag_index_t **index, int capacity);
+
+/* Cleanup index */
+void tag_index_cleanup(tag_index_t *index);
+
+/* Claim a handle and index it under tag_id and (station, slot).
+ * Returns the handle, or -1 when full or either key already exists. */
+int tag_index_add(tag_index_t *index, int tag_id, const char *station, int slot);
+
+/* Drop a handle and its keys; the handle is reused by a later add */
+void tag_index_remove(tag_index_t *index, int handle);
+
+/* Handle of tag_id, or -1 */
+int tag_index_find_id(const tag_index_t *index, int tag_id);
+
+/* Handle of (station, slot), or -1 */
+int tag_index_find_point(const tag_index_t *index, const char *station, int slot);
+
+/* Live handles lie below this bound; iterate with tag_index_in_use */
+int tag_index_limit(const tag_index_t *index);
+
+bool tag_index_in_use(const tag_index_t *index, int handle);
+
+/* Number of live handles */
+int tag_index_count(const tag_index_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_TAG_INDEX_H */
@@ -5,6 +5,8 @@
  */
 
 #include "tag_manager.h"
+#include "sample_scheduler.h"
+#include "tag_index.h"
 #include "logger.h"
 #include <stdlib.h>
 #include <string.h>
@@ -13,10 +15,12 @@
 
 /* Tag manager structure */
 struct tag_manager {
-    managed_tag_t *tags;
-    int tag_count;
+    managed_tag_t *tags;            /* Indexed by tag handle */
+    tag_index_t *index;
     int max_tags;
     int next_tag_id;
+    sample_scheduler_t *scheduler;  /* Enabled tags by next_sample_time */
+    sample_slot_t *due;             /* tag_manager_get_due_tags scratch */
 };
 
 /* Initialize tag manager */
@@ -31,13 +35,19 @@ wtc_result_t tag_manager_init(tag_manager_t **mgr, int max_tags) {
     }
 
     tm->tags = calloc(max_tags, sizeof(managed_tag_t));
-    if (!tm->tags) {
+    tm->due = calloc(max_tags, sizeof(sample_slot_t));
+    if (!tm->tags || !tm->due ||
+        tag_index_init(&tm->index, max_tags) != WTC_OK ||
+        sample_scheduler_init(&tm->scheduler, max_tags) != WTC_OK) {
+        sample_scheduler_cleanup(tm->scheduler);
+        tag_index_cleanup(tm->index);
+        free(tm->tags);
+        free(tm->due);
         free(tm);
         return WTC_ERROR_NO_MEMORY;
     }
 
     tm->max_tags = max_tags;
-    tm->tag_count = 0;
     tm->next_tag_id = 1;
 
     LOG_INFO(LOG_TAG, "Tag manager initialized (max %d tags)", max_tags);
@@ -48,48 +58,80 @@ wtc_result_t tag_manager_init(tag_manager_t **mgr, int max_tags) {
 /* Cleanup tag manager */
 void tag_manager_cleanup(tag_manager_t *mgr) {
     if (!mgr) return;
+    sample_scheduler_cleanup(mgr->scheduler);
+    tag_index_cleanup(mgr->index);
+    free(mgr->due);
     free(mgr->tags);
     free(mgr);
     LOG_INFO(LOG_TAG, "Tag manager cleaned up");
 }
 
+/* Tag by ID, or NULL */
+static managed_tag_t *find_tag(tag_manager_t *mgr, int tag_id) {
+    int h = tag_index_find_id(mgr->index, tag_id);
+    return h >= 0 ? &mgr->tags[h] : NULL;
+}
+
 /* Add a tag */
 wtc_result_t tag_manager_add(tag_manager_t *mgr, const historian_tag_t *tag) {
     if (!mgr || !tag) return WTC_ERROR_INVALID_PARAM;
 
     /* Check if tag already exists */
-    for (int i = 0; i < mgr->tag_count; i++) {
-        if (mgr->tags[i].config.tag_id == tag->tag_id) {
-            /* Update existing */
-            memcpy(&mgr->tags[i].config, tag, sizeof(historian_tag_t));
-            compression_init(&mgr->tags[i].compression,
-                             tag->compression, tag->deadband);
-            LOG_DEBUG(LOG_TAG, "Updated tag %d: %s", tag->tag_id, tag->tag_name);
-            return WTC_OK;
+    int h = tag_index_find_id(mgr->index, tag->tag_id);
+    if (h >= 0) {
+        managed_tag_t *mt = &mgr->tags[h];
+
+        /* Re-index if the tag moved to another point */
+        if (mt->config.slot != tag->slot ||
+            strcmp(mt->config.rtu_station, tag->rtu_station) != 0) {
+            if (tag_index_find_point(mgr->index, tag->rtu_station, tag->slot) >= 0) {
+                return WTC_ERROR_ALREADY_EXISTS;
+            }
+            /* The released handle is the first one reused */
+            tag_index_remove(mgr->index, h);
+            tag_index_add(mgr->index, tag->tag_id, tag->rtu_station, tag->slot);
         }
+
+        /* Update existing */
+        memcpy(&mt->config, tag, sizeof(historian_tag_t));
+        compression_init(&mt->compression, tag->compression, tag->deadband);
+        LOG_DEBUG(LOG_TAG, "Updated tag %d: %s", tag->tag_id, tag->tag_name);
+        return WTC_OK;
     }
 
-    if (mgr->tag_count >= mgr->max_tags) {
+    if (tag_index_count(mgr->index) >= mgr->max_tags) {
         LOG_ERROR(LOG_TAG, "Maximum tags reached (%d)", mgr->max_tags);
         return WTC_ERROR_FULL;
     }
 
-    managed_tag_t *mt = &mgr->tags[mgr->tag_count];
-    memcpy(&mt->config, tag, sizeof(historian_tag_t));
+    if (tag_index_find_point(mgr->index, tag->rtu_station, tag->slot) >= 0) {
+        LOG_WARN(LOG_TAG, "Point %s.%d already has a tag", tag->rtu_station, tag->slot);
+        return WTC_ERROR_ALREADY_EXISTS;
+    }
 
     /* Assign tag ID if not set */
-    if (mt->config.tag_id == 0) {
-        mt->config.tag_id = mgr->next_tag_id++;
-    } else if (mt->config.tag_id >= mgr->next_tag_id) {
-        mgr->next_tag_id = mt->config.tag_id + 1;
+    int tag_id = tag->tag_id;
+    if (tag_id == 0) {
+        tag_id = mgr->next_tag_id++;
+    } else if (tag_id >= mgr->next_tag_id) {
+        mgr->next_tag_id = tag_id + 1;
+    }
+
+    h = tag_index_add(mgr->index, tag_id, tag->rtu_station, tag->slot);
+    if (h < 0) {
+        return WTC_ERROR_FULL;
     }
 
+    managed_tag_t *mt = &mgr->tags[h];
+    memcpy(&mt->config, tag, sizeof(historian_tag_t));
+    mt->config.tag_id = tag_id;
+
     /* Initialize compression state */
     compression_init(&mt->compression, tag->compression, tag->deadband);
 
     mt->next_sample_time = 0;
     mt->enabled = true;
-    mgr->tag_count++;
+    sample_scheduler_set(mgr->scheduler, h, mt->next_sample_time);
 
     LOG_INFO(LOG_TAG, "Added tag %d: %s (%s.%d)",
              mt->config.tag_id, mt->config.tag_name,
@@ -102,32 +144,30 @@ wtc_result_t tag_manager_add(tag_manager_t *mgr, const historian_tag_t *tag) {
 wtc_result_t tag_manager_remove(tag_manager_t *mgr, int tag_id) {
     if (!mgr) return WTC_ERROR_INVALID_PARAM;
 
-    for (int i = 0; i < mgr->tag_count; i++) {
-        if (mgr->tags[i].config.tag_id == tag_id) {
-            /* Shift remaining tags */
-            memmove(&mgr->tags[i], &mgr->tags[i + 1],
-                    (mgr->tag_count - i - 1) * sizeof(managed_tag_t));
-            mgr->tag_count--;
-            LOG_INFO(LOG_TAG, "Removed tag %d", tag_id);
-            return WTC_OK;
-        }
+    int h = tag_index_find_id(mgr->index, tag_id);
+    if (h < 0) {
+        return WTC_ERROR_NOT_FOUND;
     }
 
-    return WTC_ERROR_NOT_FOUND;
+    /* Other tags keep their handles; this one is reused by a later add */
+    sample_scheduler_remove(mgr->scheduler, h);
+    tag_index_remove(mgr->index, h);
+    memset(&mgr->tags[h], 0, sizeof(managed_tag_t));
+    LOG_INFO(LOG_TAG, "Removed tag %d", tag_id);
+    return WTC_OK;
 }
 
 /* Get a tag by ID */
 wtc_result_t tag_manager_get(tag_manager_t *mgr, int tag_id, managed_tag_t *tag) {
     if (!mgr || !tag) return WTC_ERROR_INVALID_PARAM;
 
-    for (int i = 0; i < mgr->tag_count; i++) {
-        if (mgr->tags[i].config.tag_id == tag_id) {
-            memcpy(tag, &mgr->tags[i], sizeof(managed_tag_t));
-            return WTC_OK;
-        }
+    managed_tag_t *mt = find_tag(mgr, tag_id);
+    if (!mt) {
+        return WTC_ERROR_NOT_FOUND;
     }
 
-    return WTC_ERROR_NOT_FOUND;
+    memcpy(tag, mt, sizeof(managed_tag_t));
+    return WTC_OK;
 }
 
 /* Find tag by station and slot */
@@ -135,15 +175,13 @@ wtc_result_t tag_manager_find(tag_manager_t *mgr, const char *rtu_station, int s
                                int *tag_id) {
     if (!mgr || !rtu_station || !tag_id) return WTC_ERROR_INVALID_PARAM;
 
-    for (int i = 0; i < mgr->tag_count; i++) {
-        if (strcmp(mgr->tags[i].config.rtu_station, rtu_station) == 0 &&
-            mgr->tags[i].config.slot == slot) {
-            *tag_id = mgr->tags[i].config.tag_id;
-            return WTC_OK;
-        }
+    int h = tag_index_find_point(mgr->index, rtu_station, slot);
+    if (h < 0) {
+        return WTC_ERROR_NOT_FOUND;
     }
 
-    return WTC_ERROR_NOT_FOUND;
+    *tag_id = mgr->tags[h].config.tag_id;
+    return WTC_OK;
 }
 
 /* Update tag configuration */
@@ -152,37 +190,40 @@ wtc_result_t tag_manager_update(tag_manager_t *mgr, int tag_id,
                                  compression_t compression) {
     if (!mgr) return WTC_ERROR_INVALID_PARAM;
 
-    for (int i = 0; i < mgr->tag_count; i++) {
-        if (mgr->tags[i].config.tag_id == tag_id) {
-            mgr->tags[i].config.sample_rate_ms = sample_rate_ms;
-            mgr->tags[i].config.deadband = deadband;
-            mgr->tags[i].config.compression = compression;
+    managed_tag_t *mt = find_tag(mgr, tag_id);
+    if (!mt) {
+        return WTC_ERROR_NOT_FOUND;
+    }
 
-            /* Reinitialize compression with new settings */
-            compression_init(&mgr->tags[i].compression, compression, deadband);
+    mt->config.sample_rate_ms = sample_rate_ms;
+    mt->config.deadband = deadband;
+    mt->config.compression = compression;
 
-            LOG_INFO(LOG_TAG, "Updated tag %d: rate=%ums, deadband=%.2f",
-                     tag_id, sample_rate_ms, deadband);
-            return WTC_OK;
-        }
-    }
+    /* Reinitialize compression with new settings */
+    compression_init(&mt->compression, compression, deadband);
 
-    return WTC_ERROR_NOT_FOUND;
+    LOG_INFO(LOG_TAG, "Updated tag %d: rate=%ums, deadband=%.2f",
+             tag_id, sample_rate_ms, deadband);
+    return WTC_OK;
 }
 
 /* Enable/disable tag */
 wtc_result_t tag_manager_enable(tag_manager_t *mgr, int tag_id, bool enabled) {
     if (!mgr) return WTC_ERROR_INVALID_PARAM;
 
-    for (int i = 0; i < mgr->tag_count; i++) {
-        if (mgr->tags[i].config.tag_id == tag_id) {
-            mgr->tags[i].enabled = enabled;
-            LOG_INFO(LOG_TAG, "%s tag %d", enabled ? "Enabled" : "Disabled", tag_id);
-            return WTC_OK;
-        }
+    int h = tag_index_find_id(mgr->index, tag_id);
+    if (h < 0) {
+        return WTC_ERROR_NOT_FOUND;
     }
 
-    return WTC_ERROR_NOT_FOUND;
+    mgr->tags[h].enabled = enabled;
+    if (enabled) {
+        sample_scheduler_set(mgr->scheduler, h, mgr->tags[h].next_sample_time);
+    } else {
+        sample_scheduler_remove(mgr->scheduler, h);
+    }
+    LOG_INFO(LOG_TAG, "%s tag %d", enabled ? "Enabled" : "Disabled", tag_id);
+    return WTC_OK;
 }
 
 /* List all tags */
@@ -190,7 +231,7 @@ wtc_result_t tag_manager_list(tag_manager_t *mgr, historian_tag_t **tags,
                                int *count, int max_count) {
     if (!mgr || !tags || !count) return WTC_ERROR_INVALID_PARAM;
 
-    int copy_count = mgr->tag_count;
+    int copy_count = tag_index_count(mgr->index);
     if (copy_count > max_count) copy_count = max_count;
 
     *tags = calloc(copy_count, sizeof(historian_tag_t));
@@ -198,31 +239,28 @@ wtc_result_t tag_manager_list(tag_manager_t *mgr, historian_tag_t **tags,
         return WTC_ERROR_NO_MEMORY;
     }
 
-    for (int i = 0; i < copy_count; i++) {
-        memcpy(&(*tags)[i], &mgr->tags[i].config, sizeof(historian_tag_t));
+    int n = 0;
+    for (int h = 0; h < tag_index_limit(mgr->index) && n < copy_count; h++) {
+        if (!tag_index_in_use(mgr->index, h)) continue;
+        memcpy(&(*tags)[n++], &mgr->tags[h].config, sizeof(historian_tag_t));
     }
 
-    *count = copy_count;
+    *count = n;
     return WTC_OK;
 }
 
 /* Get tag count */
 int tag_manager_count(tag_manager_t *mgr) {
-    return mgr ? mgr->tag_count : 0;
+    return mgr ? tag_index_count(mgr->index) : 0;
 }
 
 /* Check if a tag needs sampling now */
 bool tag_manager_needs_sample(tag_manager_t *mgr, int tag_id, uint64_t now_ms) {
     if (!mgr) return false;
 
-    for (int i = 0; i < mgr->tag_count; i++) {
-        if (mgr->tags[i].config.tag_id == tag_id) {
-            if (!mgr->tags[i].enabled) return false;
-            return now_ms >= mgr->tags[i].next_sample_time;
-        }
-    }
-
-    return false;
+    managed_tag_t *mt = find_tag(mgr, tag_id);
+    if (!mt || !mt->enabled) return false;
+    return now_ms >= mt->next_sample_time;
 }
 
 /* Record that a sample was taken */
@@ -230,15 +268,16 @@ void tag_manager_record_sample(tag_manager_t *mgr, int tag_id,
                                 float value, uint64_t timestamp_ms) {
     if (!mgr) return;
 
-    for (int i = 0; i < mgr->tag_count; i++) {
-        if (mgr->tags[i].config.tag_id == tag_id) {
-            mgr->tags[i].config.last_value = value;
-            mgr->tags[i].config.last_sample_ms = timestamp_ms;
-            mgr->tags[i].config.total_samples++;
-            mgr->tags[i].next_sample_time = timestamp_ms +
-                                             mgr->tags[i].config.sample_rate_ms;
-            return;
-        }
+    int h = tag_index_find_id(mgr->index, tag_id);
+    if (h < 0) return;
+
+    managed_tag_t *mt = &mgr->tags[h];
+    mt->config.last_value = value;
+    mt->config.last_sample_ms = timestamp_ms;
+    mt->config.total_samples++;
+    mt->next_sample_time = timestamp_ms + mt->config.sample_rate_ms;
+    if (mt->enabled) {
+        sample_scheduler_set(mgr->scheduler, h, mt->next_sample_time);
     }
 }
 
@@ -247,13 +286,15 @@ wtc_result_t tag_manager_get_due_tags(tag_manager_t *mgr, uint64_t now_ms,
                                        int *tag_ids, int *count, int max_count) {
     if (!mgr || !tag_ids || !count) return WTC_ERROR_INVALID_PARAM;
 
-    *count = 0;
-
-    for (int i = 0; i < mgr->tag_count && *count < max_count; i++) {
-        if (mgr->tags[i].enabled && now_ms >= mgr->tags[i].next_sample_time) {
-            tag_ids[(*count)++] = mgr->tags[i].config.tag_id;
-        }
+    /* Take the due tags off the schedule, then put them back unchanged;
+     * they move once tag_manager_record_sample() is called for them */
+    int due = sample_scheduler_pop_due(mgr->scheduler, now_ms, mgr->due,
+                                       max_count < mgr->max_tags ? max_count : mgr->max_tags);
+    for (int i = 0; i < due; i++) {
+        tag_ids[i] = mgr->tags[mgr->due[i].key].config.tag_id;
+        sample_scheduler_set(mgr->scheduler, mgr->due[i].key, mgr->due[i].due_ms);
     }
 
+    *count = due;
     return WTC_OK;
 }
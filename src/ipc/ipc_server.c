@@ -13,6 +13,7 @@
 #include "user/user_sync.h"
 #include "logger.h"
 #include "time_utils.h"
+#include "arena.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -204,14 +205,14 @@ wtc_result_t ipc_server_set_user_sync(ipc_server_t *server,
 }
 
 /* Update RTU data in shared memory */
-static void update_rtu_data(ipc_server_t *server) {
+static void update_rtu_data(ipc_server_t *server, arena_t *scratch) {
     if (!server->registry) return;
 
     rtu_device_t *devices = NULL;
     int count = 0;
 
-    if (rtu_registry_list_devices(server->registry, &devices, &count,
-                                   WTC_MAX_SHM_RTUS) != WTC_OK) {
+    if (rtu_registry_list_devices_arena(server->registry, scratch, &devices, &count,
+                                         WTC_MAX_SHM_RTUS) != WTC_OK) {
         return;
     }
 
@@ -255,19 +256,17 @@ static void update_rtu_data(ipc_server_t *server) {
             shm_rtu->actuators[j].forced = rtu->actuators[j].forced;
         }
     }
-
-    free(devices);
 }
 
 /* Update alarm data in shared memory */
-static void update_alarm_data(ipc_server_t *server) {
+static void update_alarm_data(ipc_server_t *server, arena_t *scratch) {
     if (!server->alarms) return;
 
     alarm_t *alarms = NULL;
     int count = 0;
 
-    if (alarm_manager_get_active(server->alarms, &alarms, &count,
-                                  WTC_MAX_SHM_ALARMS) != WTC_OK) {
+    if (alarm_manager_get_active_arena(server->alarms, scratch, &alarms, &count,
+                                        WTC_MAX_SHM_ALARMS) != WTC_OK) {
         return;
     }
 
@@ -297,18 +296,17 @@ static void update_alarm_data(ipc_server_t *server) {
             server->shm->unack_alarms++;
         }
     }
-
-    free(alarms);
 }
 
 /* Update PID loop data in shared memory */
-static void update_pid_data(ipc_server_t *server) {
+static void update_pid_data(ipc_server_t *server, arena_t *scratch) {
     if (!server->control) return;
 
     pid_loop_t *loops = NULL;
     int count = 0;
 
-    if (control_engine_list_pid_loops(server->control, &loops, &count, 64) != WTC_OK) {
+    if (control_engine_list_pid_loops_arena(server->control, scratch, &loops, &count,
+                                             64) != WTC_OK) {
         return;
     }
 
@@ -333,8 +331,6 @@ static void update_pid_data(ipc_server_t *server) {
         shm_loop->cv = loop->cv;
         shm_loop->mode = loop->mode;
     }
-
-    free(loops);
 }
 
 /* Update shared memory */
@@ -345,9 +341,14 @@ wtc_result_t ipc_server_update(ipc_server_t *server) {
 
     server->shm->last_update_ms = time_get_ms();
 
-    update_rtu_data(server);
-    update_alarm_data(server);
-    update_pid_data(server);
+    /* Snapshots are copied into this thread's scratch arena, released below */
+    arena_t *scratch = arena_scratch();
+    if (scratch) {
+        update_rtu_data(server, scratch);
+        update_alarm_data(server, scratch);
+        update_pid_data(server, scratch);
+        arena_reset(scratch);
+    }
 
     /* Harvest DCP discovery results from PROFINET controller cache after timeout */
     if (server->shm->discovery_in_progress && server->profinet &&
@@ -683,6 +684,34 @@ static wtc_result_t handle_configure_slot(ipc_server_t *server, shm_command_t *c
     return result;
 }
 
+/* Sync the stored user list through the sync manager */
+static wtc_result_t sync_users_incremental(ipc_server_t *server, shm_command_t *cmd) {
+    if (cmd->command_type == SHM_CMD_USER_SYNC && cmd->user_sync_cmd.station_name[0]) {
+        return user_sync_to_rtu(server->user_sync, cmd->user_sync_cmd.station_name,
+                                NULL, 0) == 0 ? WTC_OK : WTC_ERROR;
+    }
+
+    int total_count = 0;
+    if (server->registry) {
+        rtu_device_t *devices = NULL;
+        int device_count = 0;
+        if (rtu_registry_list_devices(server->registry, &devices, &device_count,
+                                       WTC_MAX_RTUS) == WTC_OK) {
+            for (int i = 0; i < device_count; i++) {
+                if (devices[i].connection_state == PROFINET_STATE_RUNNING) {
+                    total_count++;
+                }
+            }
+            rtu_registry_free_device_list(devices, device_count);
+        }
+    }
+
+    int success_count = user_sync_to_all_rtus(server->user_sync, NULL, 0);
+    LOG_INFO(LOG_TAG, "User sync to all RTUs: %d/%d successful",
+             success_count, total_count);
+    return (success_count >= total_count) ? WTC_OK : WTC_ERROR;
+}
+
 /* Handle user sync command */
 static wtc_result_t handle_user_sync_command(ipc_server_t *server, shm_command_t *cmd) {
     if (!server->profinet) {
@@ -713,9 +742,21 @@ static wtc_result_t handle_user_sync_command(ipc_server_t *server, shm_command_t
         users[i].active = (cmd->user_sync_cmd.users[i].flags & 0x01) != 0;
     }
 
-    /* Serialize users for PROFINET transfer */
+    /* The sync manager diffs the list against what each RTU has and
+     * sends only the changes, to many RTUs at once */
+    if (server->user_sync) {
+        user_sync_update_users(server->user_sync, users, (int)user_count);
+        wtc_result_t result = sync_users_incremental(server, cmd);
+        server->shm->command_result = result;
+        return result;
+    }
+
+    /* Serialize users for PROFINET transfer. Without the manager there
+     * is no revisioned store: every list is revision 1 of this start, a
+     * full sync the RTU accepts again when the list changes. */
     user_sync_payload_t payload;
-    user_sync_result_t sync_result = user_sync_serialize(users, user_count, &payload);
+    user_sync_result_t sync_result = user_sync_serialize(
+        users, user_count, USER_SYNC_NONCE(user_sync_boot_epoch(), 1), &payload);
     if (sync_result != USER_SYNC_OK) {
         LOG_ERROR(LOG_TAG, "Failed to serialize users: %d", sync_result);
         server->shm->command_result = WTC_ERROR_INTERNAL;
@@ -725,11 +766,6 @@ static wtc_result_t handle_user_sync_command(ipc_server_t *server, shm_command_t
     size_t payload_size = sizeof(user_sync_header_t) +
                           (payload.header.user_count * sizeof(user_sync_record_t));
 
-    /* Cache users in sync manager for auto-sync on future RTU connections */
-    if (server->user_sync) {
-        user_sync_cache_users(server->user_sync, users, user_count);
-    }
-
     wtc_result_t result = WTC_OK;
 
     if (cmd->command_type == SHM_CMD_USER_SYNC && cmd->user_sync_cmd.station_name[0]) {
@@ -779,6 +815,7 @@ static wtc_result_t handle_user_sync_command(ipc_server_t *server, shm_command_t
                         }
                     }
                 }
+                rtu_registry_free_device_list(devices, device_count);
             }
         }
 
@@ -27,29 +27,38 @@
 
 #include "types.h"
 #include "generated/config_defaults.h"
+#include "core/component_health.h"
+#include "core/load_shedding.h"
 #include "profinet/profinet_controller.h"
 #include "profinet/profinet_identity.h"
 #include "registry/rtu_registry.h"
+#include "core/latency_trace.h"
 #include "control/control_engine.h"
 #include "alarms/alarm_manager.h"
 #include "historian/historian.h"
 #include "ipc/ipc_server.h"
 #include "modbus/modbus_gateway.h"
 #include "db/database.h"
+#include "config/config_snapshot.h"
 #include "coordination/failover.h"
+#include "coordination/replication.h"
 #include "simulation/simulator.h"
 #include "user/user_sync.h"
 #include "utils/logger.h"
 #include "utils/time_utils.h"
+#include "utils/arena.h"
+#include "utils/pool.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
 #include <signal.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <getopt.h>
 #include <dirent.h>
+#include <pthread.h>
 
 /* Global running flag */
 static volatile bool g_running = true;
@@ -66,6 +75,18 @@ static wtc_database_t *g_database = NULL;
 static failover_manager_t *g_failover = NULL;
 static simulator_t *g_simulator = NULL;
 static user_sync_manager_t *g_user_sync = NULL;
+static replication_t *g_replication = NULL;
+static health_monitor_t *g_health = NULL;
+static load_shedder_t *g_load_shed = NULL;
+static latency_trace_t *g_latency = NULL;
+
+/* Set by the replication thread when this standby takes over, or when
+ * this primary loses its lease and must stop its outputs */
+static volatile bool g_promoted = false;
+static volatile bool g_demoted = false;
+
+/* Period of publishing controller state to the standby */
+#define REPLICATION_PUBLISH_MS  250
 
 /* Configuration */
 typedef struct {
@@ -88,6 +109,7 @@ typedef struct {
     char db_user[64];
     char db_password[128];
     bool db_enabled;
+    char snapshot_path[256];        /* Binary config snapshot ("" = off) */
     /* Failover configuration */
     bool failover_enabled;
     uint32_t failover_timeout_ms;
@@ -99,6 +121,17 @@ typedef struct {
     /* Simulation mode */
     bool simulation_mode;
     char simulation_scenario[64];
+    float simulation_time_scale;
+    int simulation_threads;
+    /* Sensor-to-actuator latency histograms per control loop */
+    bool latency_trace;
+    /* Hot-standby replication */
+    uint16_t replicate_port;        /* Serve a standby on this port (0 = off) */
+    char replicate_bind[64];        /* Address to serve on (empty = loopback) */
+    char replicate_key[64];         /* Secret shared with the peer controller */
+    bool standby_mode;
+    char standby_host[64];          /* Primary to follow in standby mode */
+    uint16_t standby_port;
 } app_config_t;
 
 static app_config_t g_config = {
@@ -121,6 +154,7 @@ static app_config_t g_config = {
     .db_user = "wtc",
     .db_password = "",
     .db_enabled = true,
+    .snapshot_path = CONFIG_SNAPSHOT_DEFAULT_PATH,
     /* Failover defaults */
     .failover_enabled = true,
     .failover_timeout_ms = 5000,
@@ -132,6 +166,12 @@ static app_config_t g_config = {
     /* Simulation mode defaults */
     .simulation_mode = false,
     .simulation_scenario = "water_treatment_plant",
+    .simulation_time_scale = 1.0f,
+    /* Replication defaults */
+    .replicate_port = 0,
+    .standby_mode = false,
+    .standby_host = "",
+    .standby_port = REPLICATION_DEFAULT_PORT,
 };
 
 /* Signal handler */
@@ -140,6 +180,15 @@ static void signal_handler(int sig) {
     g_running = false;
 }
 
+/* Apply a component's new shed step */
+static void on_load_shed_step(component_id_t id, int step, void *ctx) {
+    (void)ctx;
+    (void)step;
+    if (id == COMPONENT_HISTORIAN && g_historian) {
+        historian_set_rate_divisor(g_historian, load_shed_divisor(g_load_shed, id));
+    }
+}
+
 /* Failover callback - notify when RTU goes offline/online */
 static void on_failover_event(const char *primary, const char *backup,
                                bool failed_over, void *ctx) {
@@ -162,83 +211,355 @@ static void on_failover_event(const char *primary, const char *backup,
     }
 }
 
-/* Load configuration from database */
-static wtc_result_t load_config_from_database(void) {
-    if (!g_database || !database_is_connected(g_database)) {
-        LOG_WARN("Database not connected, skipping config load");
-        return WTC_OK;
+/* ============== Configuration Snapshot ============== */
+
+/* Database connection and configuration load, run in the background so
+ * control starts from the snapshot without waiting for PostgreSQL */
+static struct {
+    pthread_t thread;
+    bool started;
+    bool done;                      /* Set by the thread when finished */
+    wtc_database_t *database;       /* Connected database, or NULL */
+    uint8_t *data;                  /* Encoded database configuration */
+    size_t size;
+} g_config_refresh;
+
+/* Checksum of the configuration last applied or saved */
+static uint32_t g_config_checksum = 0;
+
+/* Checksum of a configuration that could not be saved; not retried until
+ * the configuration changes again */
+static uint32_t g_config_failed_checksum = 0;
+
+/* Apply configuration. With replace, existing alarm rules and interlocks
+ * are removed first, PID loops are matched by name and updated in place
+ * so their integrators carry on, and loops no longer configured are
+ * removed. RTUs and historian tags are added or updated in place. */
+static void apply_config(const config_snapshot_view_t *config, bool replace) {
+    pid_loop_t *loops = NULL;
+    int loop_count = 0;
+    bool loop_kept[WTC_MAX_PID_LOOPS] = {false};
+
+    if (replace) {
+        alarm_rule_t *rules = NULL;
+        int rule_count = 0;
+        if (alarm_manager_list_rules(g_alarms, &rules, &rule_count, WTC_MAX_ALARM_RULES) == WTC_OK) {
+            for (int i = 0; i < rule_count; i++) {
+                alarm_manager_delete_rule(g_alarms, rules[i].rule_id);
+            }
+            free(rules);
+        }
+
+        if (control_engine_list_pid_loops_copy(g_control, &loops, &loop_count,
+                                               WTC_MAX_PID_LOOPS) != WTC_OK) {
+            loops = NULL;
+            loop_count = 0;
+        }
+
+        interlock_t *interlocks = NULL;
+        int interlock_count = 0;
+        if (control_engine_list_interlocks_copy(g_control, &interlocks, &interlock_count,
+                                           WTC_MAX_INTERLOCKS) == WTC_OK) {
+            for (int i = 0; i < interlock_count; i++) {
+                control_engine_remove_interlock(g_control, interlocks[i].interlock_id);
+            }
+            free(interlocks);
+        }
     }
 
-    LOG_INFO("Loading configuration from database...");
+    /* RTUs */
+    for (int i = 0; i < config->rtu_count; i++) {
+        const config_snapshot_rtu_t *rtu = &config->rtus[i];
+        const slot_config_t *slots = &config->slots[rtu->first_slot];
+        if (rtu_registry_add_device(g_registry, rtu->station_name, rtu->ip_address,
+                                    slots, (int)rtu->slot_count) == WTC_ERROR_ALREADY_EXISTS) {
+            rtu_registry_set_device_config(g_registry, rtu->station_name,
+                                           slots, (int)rtu->slot_count);
+        }
+    }
 
-    /* Load RTUs */
-    rtu_device_t *rtus = NULL;
-    int rtu_count = 0;
-    if (database_list_rtus(g_database, &rtus, &rtu_count, WTC_MAX_RTUS) == WTC_OK) {
-        for (int i = 0; i < rtu_count; i++) {
-            rtu_registry_add_device(g_registry,
-                                    rtus[i].station_name,
-                                    rtus[i].ip_address,
-                                    rtus[i].slots,
-                                    rtus[i].slot_count);
-            LOG_INFO("  Loaded RTU: %s", rtus[i].station_name);
+    /* Alarm rules */
+    for (int i = 0; i < config->alarm_rule_count; i++) {
+        const alarm_rule_t *rule = &config->alarm_rules[i];
+        int rule_id;
+        alarm_manager_create_rule(g_alarms,
+                                  rule->rtu_station,
+                                  rule->slot,
+                                  rule->condition,
+                                  rule->threshold,
+                                  rule->severity,
+                                  rule->delay_ms,
+                                  rule->message_template,
+                                  &rule_id);
+    }
+
+    /* PID loops and interlocks */
+    for (int i = 0; i < config->pid_loop_count; i++) {
+        const pid_loop_t *loop = &config->pid_loops[i];
+        int match = -1;
+        for (int j = 0; j < loop_count; j++) {
+            if (!loop_kept[j] && strcmp(loops[j].name, loop->name) == 0) {
+                match = j;
+                break;
+            }
         }
-        free(rtus);
+        if (match >= 0 &&
+            control_engine_update_pid_loop(g_control, loops[match].loop_id, loop) == WTC_OK) {
+            loop_kept[match] = true;
+            continue;
+        }
+        int loop_id;
+        control_engine_add_pid_loop(g_control, loop, &loop_id);
+    }
+    for (int j = 0; j < loop_count; j++) {
+        if (!loop_kept[j]) {
+            control_engine_remove_pid_loop(g_control, loops[j].loop_id);
+        }
+    }
+    free(loops);
+    for (int i = 0; i < config->interlock_count; i++) {
+        int interlock_id;
+        control_engine_add_interlock(g_control, &config->interlocks[i], &interlock_id);
     }
 
-    /* Load alarm rules */
-    alarm_rule_t *rules = NULL;
-    int rule_count = 0;
-    if (database_load_alarm_rules(g_database, &rules, &rule_count, WTC_MAX_ALARM_RULES) == WTC_OK) {
-        for (int i = 0; i < rule_count; i++) {
-            int rule_id;
-            alarm_manager_create_rule(g_alarms,
-                                      rules[i].rtu_station,
-                                      rules[i].slot,
-                                      rules[i].condition,
-                                      rules[i].threshold,
-                                      rules[i].severity,
-                                      rules[i].delay_ms,
-                                      rules[i].message_template,
-                                      &rule_id);
+    /* Historian tags */
+    for (int i = 0; i < config->historian_tag_count; i++) {
+        const historian_tag_t *tag = &config->historian_tags[i];
+        int tag_id;
+        if (historian_find_tag(g_historian, tag->rtu_station, tag->slot, &tag_id) == WTC_OK) {
+            historian_update_tag(g_historian, tag_id, tag->sample_rate_ms,
+                                 tag->deadband, tag->compression);
+            continue;
         }
-        LOG_INFO("  Loaded %d alarm rules", rule_count);
-        free(rules);
+        historian_add_tag(g_historian,
+                          tag->rtu_station,
+                          tag->slot,
+                          tag->tag_name,
+                          tag->sample_rate_ms,
+                          tag->deadband,
+                          tag->compression,
+                          &tag_id);
     }
 
-    /* Load PID loops */
+    LOG_INFO("  Applied %d RTUs, %d alarm rules, %d PID loops, %d interlocks, %d historian tags",
+             config->rtu_count, config->alarm_rule_count, config->pid_loop_count,
+             config->interlock_count, config->historian_tag_count);
+}
+
+/* Apply the configuration snapshot saved by the previous run */
+static void load_config_snapshot(void) {
+    if (!g_config.snapshot_path[0]) return;
+
+    uint64_t start_us = time_get_monotonic_us();
+    config_snapshot_t *snapshot = NULL;
+    wtc_result_t res = config_snapshot_open(&snapshot, g_config.snapshot_path);
+    if (res == WTC_ERROR_NOT_FOUND) {
+        LOG_INFO("No configuration snapshot at %s", g_config.snapshot_path);
+        return;
+    }
+    if (res != WTC_OK) {
+        LOG_WARN("Ignoring invalid configuration snapshot %s", g_config.snapshot_path);
+        return;
+    }
+
+    const config_snapshot_view_t *view = config_snapshot_view(snapshot);
+    LOG_INFO("Loading configuration snapshot %s...", g_config.snapshot_path);
+    apply_config(view, false);
+    g_config_checksum = view->checksum;
+    config_snapshot_close(snapshot);
+
+    LOG_INFO("Configuration snapshot loaded in %llu us",
+             (unsigned long long)(time_get_monotonic_us() - start_us));
+}
+
+/* Encode the configuration the components are running with */
+static wtc_result_t encode_live_config(uint8_t **data, size_t *size, uint32_t *checksum) {
+    config_snapshot_input_t input = {0};
+    rtu_device_t *rtus = NULL;
+    alarm_rule_t *rules = NULL;
     pid_loop_t *loops = NULL;
-    int loop_count = 0;
-    if (database_load_pid_loops(g_database, &loops, &loop_count, WTC_MAX_PID_LOOPS) == WTC_OK) {
-        for (int i = 0; i < loop_count; i++) {
-            int loop_id;
-            control_engine_add_pid_loop(g_control, &loops[i], &loop_id);
+    interlock_t *interlocks = NULL;
+    historian_tag_t *tags = NULL;
+
+    if (rtu_registry_list_devices(g_registry, &rtus, &input.rtu_count, WTC_MAX_RTUS) != WTC_OK) {
+        input.rtu_count = 0;
+    }
+    if (alarm_manager_list_rules(g_alarms, &rules, &input.alarm_rule_count,
+                                 WTC_MAX_ALARM_RULES) != WTC_OK) {
+        input.alarm_rule_count = 0;
+    }
+    if (control_engine_list_pid_loops_copy(g_control, &loops, &input.pid_loop_count,
+                                      WTC_MAX_PID_LOOPS) != WTC_OK) {
+        input.pid_loop_count = 0;
+    }
+    if (control_engine_list_interlocks_copy(g_control, &interlocks, &input.interlock_count,
+                                       WTC_MAX_INTERLOCKS) != WTC_OK) {
+        input.interlock_count = 0;
+    }
+    if (historian_list_tags(g_historian, &tags, &input.historian_tag_count,
+                            WTC_MAX_HISTORIAN_TAGS) != WTC_OK) {
+        input.historian_tag_count = 0;
+    }
+    input.rtus = rtus;
+    input.alarm_rules = rules;
+    input.pid_loops = loops;
+    input.interlocks = interlocks;
+    input.historian_tags = tags;
+
+    wtc_result_t res = config_snapshot_encode(&input, data, size, checksum);
+
+    if (rtus) rtu_registry_free_device_list(rtus, input.rtu_count);
+    free(rules);
+    free(loops);
+    free(interlocks);
+    free(tags);
+    return res;
+}
+
+/* Save the live configuration to the snapshot if it changed */
+static void save_config_snapshot(void) {
+    if (!g_config.snapshot_path[0] || !g_registry || !g_alarms ||
+        !g_control || !g_historian) {
+        return;
+    }
+
+    uint8_t *data = NULL;
+    size_t size = 0;
+    uint32_t checksum = 0;
+    if (encode_live_config(&data, &size, &checksum) != WTC_OK) {
+        return;
+    }
+    if (checksum != g_config_checksum && checksum != g_config_failed_checksum) {
+        if (config_snapshot_save(g_config.snapshot_path, data, size) == WTC_OK) {
+            g_config_checksum = checksum;
+            g_config_failed_checksum = 0;
+            LOG_INFO("Configuration snapshot saved (%zu bytes)", size);
+        } else {
+            g_config_failed_checksum = checksum;
+            LOG_WARN("Configuration snapshot not saved; retrying when the configuration changes");
         }
-        LOG_INFO("  Loaded %d PID loops", loop_count);
-        free(loops);
     }
+    free(data);
+}
 
-    /* Load historian tags */
-    historian_tag_t *tags = NULL;
-    int tag_count = 0;
-    if (database_load_historian_tags(g_database, &tags, &tag_count, WTC_MAX_HISTORIAN_TAGS) == WTC_OK) {
-        for (int i = 0; i < tag_count; i++) {
-            int tag_id;
-            historian_add_tag(g_historian,
-                              tags[i].rtu_station,
-                              tags[i].slot,
-                              tags[i].tag_name,
-                              tags[i].sample_rate_ms,
-                              tags[i].deadband,
-                              tags[i].compression,
-                              &tag_id);
+/* Connect to the database and encode its configuration */
+static void *config_refresh_thread(void *arg) {
+    (void)arg;
+
+    database_config_t db_config = {
+        .host = g_config.db_host,
+        .port = g_config.db_port,
+        .database = g_config.db_name,
+        .username = g_config.db_user,
+        .password = g_config.db_password,
+        .max_connections = 5,
+        .connection_timeout_ms = 5000,
+        .use_ssl = false,
+    };
+
+    wtc_database_t *db = NULL;
+    if (database_init(&db, &db_config) != WTC_OK) {
+        LOG_WARN("Failed to initialize database - running without persistence");
+        db = NULL;
+    } else if (database_connect(db) != WTC_OK) {
+        LOG_WARN("Failed to connect to database - running without persistence");
+        database_cleanup(db);
+        db = NULL;
+    } else {
+        LOG_INFO("Connected to PostgreSQL database");
+        /* Run schema migrations */
+        database_migrate(db);
+    }
+
+    if (db) {
+        config_snapshot_input_t input = {0};
+        rtu_device_t *rtus = NULL;
+        alarm_rule_t *rules = NULL;
+        pid_loop_t *loops = NULL;
+        interlock_t *interlocks = NULL;
+        historian_tag_t *tags = NULL;
+
+        if (database_list_rtus(db, &rtus, &input.rtu_count, WTC_MAX_RTUS) != WTC_OK) {
+            input.rtu_count = 0;
+        }
+        if (database_load_alarm_rules(db, &rules, &input.alarm_rule_count,
+                                      WTC_MAX_ALARM_RULES) != WTC_OK) {
+            input.alarm_rule_count = 0;
+        }
+        if (database_load_pid_loops(db, &loops, &input.pid_loop_count,
+                                    WTC_MAX_PID_LOOPS) != WTC_OK) {
+            input.pid_loop_count = 0;
         }
-        LOG_INFO("  Loaded %d historian tags", tag_count);
+        if (database_load_interlocks(db, &interlocks, &input.interlock_count,
+                                     WTC_MAX_INTERLOCKS) != WTC_OK) {
+            input.interlock_count = 0;
+        }
+        if (database_load_historian_tags(db, &tags, &input.historian_tag_count,
+                                         WTC_MAX_HISTORIAN_TAGS) != WTC_OK) {
+            input.historian_tag_count = 0;
+        }
+        input.rtus = rtus;
+        input.alarm_rules = rules;
+        input.pid_loops = loops;
+        input.interlocks = interlocks;
+        input.historian_tags = tags;
+
+        if (config_snapshot_encode(&input, &g_config_refresh.data,
+                                   &g_config_refresh.size, NULL) != WTC_OK) {
+            g_config_refresh.data = NULL;
+        }
+
+        free(rtus);
+        free(rules);
+        free(loops);
+        free(interlocks);
         free(tags);
     }
 
-    LOG_INFO("Configuration loaded successfully");
-    return WTC_OK;
+    g_config_refresh.database = db;
+    __atomic_store_n(&g_config_refresh.done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Start connecting to the database in the background */
+static void start_config_refresh(void) {
+    if (!g_config.db_enabled) return;
+
+    g_config_refresh.done = false;
+    if (pthread_create(&g_config_refresh.thread, NULL, config_refresh_thread, NULL) != 0) {
+        LOG_WARN("Failed to start database thread - running without persistence");
+        return;
+    }
+    g_config_refresh.started = true;
+}
+
+/* Pick up the database once connected and reconcile its configuration
+ * with the one applied from the snapshot. With wait, block until the
+ * connection attempt finishes. */
+static void finish_config_refresh(bool wait) {
+    if (!g_config_refresh.started) return;
+    if (!wait && !__atomic_load_n(&g_config_refresh.done, __ATOMIC_ACQUIRE)) return;
+
+    pthread_join(g_config_refresh.thread, NULL);
+    g_config_refresh.started = false;
+    g_database = g_config_refresh.database;
+
+    config_snapshot_view_t view;
+    if (g_config_refresh.data &&
+        config_snapshot_decode(g_config_refresh.data, g_config_refresh.size, &view) == WTC_OK) {
+        if (view.checksum == g_config_checksum) {
+            LOG_INFO("Configuration snapshot matches database");
+        } else {
+            LOG_INFO("Loading configuration from database...");
+            apply_config(&view, g_config_checksum != 0);
+            g_config_checksum = view.checksum;
+            LOG_INFO("Configuration loaded successfully");
+            save_config_snapshot();
+        }
+    }
+
+    free(g_config_refresh.data);
+    g_config_refresh.data = NULL;
 }
 
 /* Save configuration to database */
@@ -265,7 +586,7 @@ static wtc_result_t save_config_to_database(void) {
     if (g_control) {
         pid_loop_t *loops = NULL;
         int loop_count = 0;
-        if (control_engine_list_pid_loops(g_control, &loops, &loop_count, WTC_MAX_PID_LOOPS) == WTC_OK) {
+        if (control_engine_list_pid_loops_copy(g_control, &loops, &loop_count, WTC_MAX_PID_LOOPS) == WTC_OK) {
             for (int i = 0; i < loop_count; i++) {
                 database_save_pid_loop(g_database, &loops[i]);
             }
@@ -276,7 +597,7 @@ static wtc_result_t save_config_to_database(void) {
         /* Save interlocks */
         interlock_t *interlocks = NULL;
         int interlock_count = 0;
-        if (control_engine_list_interlocks(g_control, &interlocks, &interlock_count, WTC_MAX_INTERLOCKS) == WTC_OK) {
+        if (control_engine_list_interlocks_copy(g_control, &interlocks, &interlock_count, WTC_MAX_INTERLOCKS) == WTC_OK) {
             for (int i = 0; i < interlock_count; i++) {
                 database_save_interlock(g_database, &interlocks[i]);
             }
@@ -322,15 +643,36 @@ static void print_usage(const char *program) {
     printf("  --db-user <user>         Database user (default: wtc)\n");
     printf("  --db-password <pass>     Database password\n");
     printf("  --no-db                  Disable database persistence\n");
+    printf("  --config-snapshot <file> Binary config snapshot (default: %s)\n",
+           CONFIG_SNAPSHOT_DEFAULT_PATH);
     printf("  --log-forward <host:port> Forward logs to Elastic/Graylog\n");
     printf("  --log-forward-type <type> Log forward type: elastic, graylog, syslog\n");
     printf("  -s, --simulation         Run in simulation mode (no real hardware)\n");
     printf("  --scenario <name>        Simulation scenario (default: water_treatment_plant)\n");
     printf("                           Options: normal, startup, alarms, high_load,\n");
-    printf("                                    maintenance, water_treatment_plant\n");
+    printf("                                    maintenance, water_treatment_plant,\n");
+    printf("                                    fleet (256 RTUs x 32 sensors)\n");
+    printf("  --sim-speed <factor>     Simulated seconds per wall second (default: 1, e.g. 100)\n");
+    printf("  --sim-threads <n>        Simulator worker threads (default: 0 = main loop)\n");
+    printf("  --latency-trace          Record sensor-to-actuator latency per control loop\n");
+    printf("  --replicate-port <port>  Stream state to a hot standby on this port\n");
+    printf("  --replicate-bind <addr>  Address to serve the standby on (default: 127.0.0.1)\n");
+    printf("  --replicate-key <secret> Secret shared with the peer (or WTC_REPLICATION_KEY)\n");
+    printf("  --standby <host:port>    Run as hot standby of the given primary\n");
     printf("  -h, --help               Show this help\n");
 }
 
+/* Parse a simulation speed factor; only finite values above zero are valid */
+static bool parse_sim_speed(const char *text, float *speed) {
+    char *end = NULL;
+    double value = strtod(text, &end);
+    if (end == text || *end != '\0' || !(value > 0.0) || value > FLT_MAX) {
+        return false;
+    }
+    *speed = (float)value;
+    return true;
+}
+
 /* Parse command line arguments */
 static void parse_args(int argc, char *argv[]) {
     enum {
@@ -340,9 +682,17 @@ static void parse_args(int argc, char *argv[]) {
         OPT_DB_USER,
         OPT_DB_PASSWORD,
         OPT_NO_DB,
+        OPT_CONFIG_SNAPSHOT,
         OPT_LOG_FORWARD,
         OPT_LOG_FORWARD_TYPE,
         OPT_SCENARIO,
+        OPT_SIM_SPEED,
+        OPT_SIM_THREADS,
+        OPT_LATENCY_TRACE,
+        OPT_REPLICATE_PORT,
+        OPT_REPLICATE_BIND,
+        OPT_REPLICATE_KEY,
+        OPT_STANDBY,
     };
 
     static struct option long_options[] = {
@@ -360,10 +710,18 @@ static void parse_args(int argc, char *argv[]) {
         {"db-user",          required_argument, 0, OPT_DB_USER},
         {"db-password",      required_argument, 0, OPT_DB_PASSWORD},
         {"no-db",            no_argument,       0, OPT_NO_DB},
+        {"config-snapshot",  required_argument, 0, OPT_CONFIG_SNAPSHOT},
         {"log-forward",      required_argument, 0, OPT_LOG_FORWARD},
         {"log-forward-type", required_argument, 0, OPT_LOG_FORWARD_TYPE},
         {"simulation",       no_argument,       0, 's'},
         {"scenario",         required_argument, 0, OPT_SCENARIO},
+        {"sim-speed",        required_argument, 0, OPT_SIM_SPEED},
+        {"sim-threads",      required_argument, 0, OPT_SIM_THREADS},
+        {"latency-trace",    no_argument,       0, OPT_LATENCY_TRACE},
+        {"replicate-port",   required_argument, 0, OPT_REPLICATE_PORT},
+        {"replicate-bind",   required_argument, 0, OPT_REPLICATE_BIND},
+        {"replicate-key",    required_argument, 0, OPT_REPLICATE_KEY},
+        {"standby",          required_argument, 0, OPT_STANDBY},
         {"help",             no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
@@ -417,6 +775,9 @@ static void parse_args(int argc, char *argv[]) {
         case OPT_NO_DB:
             g_config.db_enabled = false;
             break;
+        case OPT_CONFIG_SNAPSHOT:
+            strncpy(g_config.snapshot_path, optarg, sizeof(g_config.snapshot_path) - 1);
+            break;
         case OPT_LOG_FORWARD:
             {
                 /* Parse host:port */
@@ -438,6 +799,39 @@ static void parse_args(int argc, char *argv[]) {
         case OPT_SCENARIO:
             strncpy(g_config.simulation_scenario, optarg, sizeof(g_config.simulation_scenario) - 1);
             break;
+        case OPT_SIM_SPEED:
+            if (!parse_sim_speed(optarg, &g_config.simulation_time_scale)) {
+                fprintf(stderr, "Invalid --sim-speed '%s': expected a number above 0\n", optarg);
+                exit(1);
+            }
+            break;
+        case OPT_SIM_THREADS:
+            g_config.simulation_threads = atoi(optarg);
+            break;
+        case OPT_LATENCY_TRACE:
+            g_config.latency_trace = true;
+            break;
+        case OPT_REPLICATE_PORT:
+            g_config.replicate_port = (uint16_t)atoi(optarg);
+            break;
+        case OPT_REPLICATE_BIND:
+            snprintf(g_config.replicate_bind, sizeof(g_config.replicate_bind), "%s", optarg);
+            break;
+        case OPT_REPLICATE_KEY:
+            snprintf(g_config.replicate_key, sizeof(g_config.replicate_key), "%s", optarg);
+            break;
+        case OPT_STANDBY:
+            {
+                /* Parse host[:port] */
+                char *colon = strchr(optarg, ':');
+                if (colon) {
+                    *colon = '\0';
+                    g_config.standby_port = (uint16_t)atoi(colon + 1);
+                }
+                strncpy(g_config.standby_host, optarg, sizeof(g_config.standby_host) - 1);
+                g_config.standby_mode = true;
+            }
+            break;
         case 'h':
         default:
             print_usage(argv[0]);
@@ -455,6 +849,17 @@ static void parse_args(int argc, char *argv[]) {
         strncpy(g_config.simulation_scenario, env_scenario,
                 sizeof(g_config.simulation_scenario) - 1);
     }
+    const char *env_speed = getenv("WTC_SIMULATION_SPEED");
+    if (env_speed && env_speed[0] &&
+        !parse_sim_speed(env_speed, &g_config.simulation_time_scale)) {
+        fprintf(stderr, "Invalid WTC_SIMULATION_SPEED '%s': expected a number above 0\n",
+                env_speed);
+        exit(1);
+    }
+    const char *env_repl_key = getenv("WTC_REPLICATION_KEY");
+    if (env_repl_key && env_repl_key[0] && !g_config.replicate_key[0]) {
+        snprintf(g_config.replicate_key, sizeof(g_config.replicate_key), "%s", env_repl_key);
+    }
 }
 
 /* Device added callback — from DCP discovery via PROFINET controller */
@@ -480,6 +885,20 @@ static void on_device_state_changed(const char *station_name,
     (void)ctx;
     (void)old_state;
     LOG_INFO("Device %s state changed to %d", station_name, new_state);
+
+    /* Failover tracks RTU health from these events rather than polling */
+    if (g_failover) {
+        failover_notify_state(g_failover, station_name, new_state);
+    }
+}
+
+/* AR watchdog callback — from the PROFINET controller on a missed or
+ * recovered watchdog of a running AR */
+static void on_profinet_watchdog(const char *station_name, int missed_cycles, void *ctx) {
+    (void)ctx;
+    if (g_failover) {
+        failover_notify_watchdog(g_failover, station_name, missed_cycles);
+    }
 }
 
 /* PROFINET state changed callback — from AR manager (3-param signature) */
@@ -503,7 +922,8 @@ static void on_profinet_state_changed(const char *station_name,
  * Parses the 5-byte sensor format (Float32 BE + Quality) and updates the
  * RTU registry so the historian, control engine, and HMI see live values. */
 static void on_data_received(const char *station_name, int slot,
-                              const void *data, size_t len, void *ctx) {
+                              const void *data, size_t len,
+                              uint64_t rx_time_us, void *ctx) {
     (void)ctx;
     if (!g_registry || !data || len < 5) return;
 
@@ -520,7 +940,7 @@ static void on_data_received(const char *station_name, int slot,
     data_quality_t dq = (data_quality_t)(quality & 0xC0);
     iops_t iops = (dq == QUALITY_GOOD) ? IOPS_GOOD : IOPS_BAD;
 
-    rtu_registry_update_sensor(g_registry, station_name, slot, value, iops, dq);
+    rtu_registry_update_sensor_at(g_registry, station_name, slot, value, iops, dq, rx_time_us);
 }
 
 /* Slot discovery callback — fired after PROFINET module discovery succeeds.
@@ -555,40 +975,160 @@ static void on_alarm_raised(const alarm_t *alarm, void *ctx) {
              alarm->alarm_id, alarm->rtu_station, alarm->message, alarm->severity);
 }
 
-/* Initialize all components */
-static wtc_result_t initialize_components(void) {
-    wtc_result_t res;
+/* Build the replication key of a station slot; false if the station
+ * name leaves no room for the slot */
+static bool replication_slot_key(char *key, size_t size, const char *station, int slot) {
+    int len = snprintf(key, size, "%s/%d", station, slot);
+    return len > 0 && (size_t)len < size;
+}
 
-    /* Initialize database (first, so we can load config) */
-    if (g_config.db_enabled) {
-        database_config_t db_config = {
-            .host = g_config.db_host,
-            .port = g_config.db_port,
-            .database = g_config.db_name,
-            .username = g_config.db_user,
-            .password = g_config.db_password,
-            .max_connections = 5,
-            .connection_timeout_ms = 5000,
-            .use_ssl = false,
-        };
+/* Replicated record callback — standby applies the primary's state */
+static void on_replicated_record(replication_kind_t kind, const char *key,
+                                 const void *data, size_t len, bool removed,
+                                 void *ctx) {
+    (void)ctx;
 
-        res = database_init(&g_database, &db_config);
-        if (res != WTC_OK) {
-            LOG_WARN("Failed to initialize database - running without persistence");
-            g_database = NULL;
-        } else {
-            res = database_connect(g_database);
-            if (res != WTC_OK) {
-                LOG_WARN("Failed to connect to database - running without persistence");
-                database_cleanup(g_database);
-                g_database = NULL;
-            } else {
-                LOG_INFO("Connected to PostgreSQL database");
-                /* Run schema migrations */
-                database_migrate(g_database);
+    switch (kind) {
+    case REPLICATION_KIND_SENSOR:
+        if (!removed && len == sizeof(replication_sensor_t)) {
+            const replication_sensor_t *sensor = data;
+            rtu_registry_update_sensor(g_registry, sensor->station, sensor->slot,
+                                       sensor->value, sensor->status, sensor->quality);
+        }
+        break;
+    case REPLICATION_KIND_ACTUATOR:
+        if (!removed && len == sizeof(replication_actuator_t)) {
+            const replication_actuator_t *actuator = data;
+            rtu_registry_update_actuator(g_registry, actuator->station, actuator->slot,
+                                         &actuator->output);
+        }
+        break;
+    case REPLICATION_KIND_PID:
+        if (!removed && len == sizeof(pid_loop_t)) {
+            control_engine_restore_pid_state(g_control, data);
+        }
+        break;
+    case REPLICATION_KIND_ALARM:
+        if (removed) {
+            alarm_manager_remove_alarm(g_alarms, atoi(key));
+        } else if (len == sizeof(alarm_t)) {
+            alarm_manager_restore_alarm(g_alarms, data);
+        }
+        break;
+    case REPLICATION_KIND_HISTORIAN:
+        if (len == sizeof(historian_sample_t)) {
+            const historian_sample_t *sample = data;
+            historian_record_sample(g_historian, sample->tag_id, sample->timestamp_ms,
+                                    sample->value, sample->quality);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Promotion callback — from the replication thread; the main loop
+ * starts the deferred components */
+static void on_replication_promoted(void *ctx) {
+    (void)ctx;
+    g_promoted = true;
+}
+
+/* Demotion callback — from the replication thread; the main loop stops
+ * the components driving outputs before the standby takes over */
+static void on_replication_demoted(void *ctx) {
+    (void)ctx;
+    g_demoted = true;
+}
+
+/* Historian sample observer — streams the historian tail to the standby */
+static void on_historian_sample(const historian_sample_t *sample, void *ctx) {
+    replication_append(ctx, REPLICATION_KIND_HISTORIAN, sample, sizeof(*sample));
+}
+
+/* Publish registry, PID and alarm state for the standby. Called every
+ * REPLICATION_PUBLISH_MS; unchanged records cost a compare. */
+static void publish_replicated_state(void) {
+    char key[REPLICATION_MAX_KEY];
+
+    /* Device copies go to this thread's scratch arena, released below */
+    arena_t *scratch = arena_scratch();
+    rtu_device_t *devices = NULL;
+    int device_count = 0;
+    if (scratch && rtu_registry_list_devices_arena(g_registry, scratch, &devices,
+                                                   &device_count, WTC_MAX_RTUS) == WTC_OK) {
+        for (int i = 0; i < device_count; i++) {
+            rtu_device_t *device = &devices[i];
+
+            for (int slot = 0; device->sensors && slot < device->sensor_capacity; slot++) {
+                const sensor_data_t *data = &device->sensors[slot];
+                if (data->timestamp_ms == 0) continue;
+
+                if (!replication_slot_key(key, sizeof(key), device->station_name, slot)) continue;
+
+                replication_sensor_t sensor = {
+                    .slot = slot,
+                    .value = data->value,
+                    .status = data->status,
+                    .quality = data->quality,
+                };
+                snprintf(sensor.station, sizeof(sensor.station), "%s", device->station_name);
+                replication_publish(g_replication, REPLICATION_KIND_SENSOR, key,
+                                    &sensor, sizeof(sensor));
+            }
+
+            for (int slot = 0; device->actuators && slot < device->actuator_capacity; slot++) {
+                const actuator_state_t *state = &device->actuators[slot];
+                if (state->last_change_ms == 0) continue;
+
+                if (!replication_slot_key(key, sizeof(key), device->station_name, slot)) continue;
+
+                replication_actuator_t actuator = {
+                    .slot = slot,
+                    .output = state->output,
+                };
+                snprintf(actuator.station, sizeof(actuator.station), "%s", device->station_name);
+                replication_publish(g_replication, REPLICATION_KIND_ACTUATOR, key,
+                                    &actuator, sizeof(actuator));
             }
         }
     }
+    if (scratch) {
+        arena_reset(scratch);
+    }
+
+    pid_loop_t *loops = NULL;
+    int loop_count = 0;
+    if (control_engine_list_pid_loops_copy(g_control, &loops, &loop_count, WTC_MAX_PID_LOOPS) == WTC_OK) {
+        for (int i = 0; i < loop_count; i++) {
+            snprintf(key, sizeof(key), "%d", loops[i].loop_id);
+            replication_publish(g_replication, REPLICATION_KIND_PID, key,
+                                &loops[i], sizeof(pid_loop_t));
+        }
+        free(loops);
+    }
+    replication_expire(g_replication, REPLICATION_KIND_PID);
+
+    alarm_t *alarms = NULL;
+    int alarm_count = 0;
+    if (alarm_manager_get_active_copy(g_alarms, &alarms, &alarm_count, 256) == WTC_OK) {
+        for (int i = 0; i < alarm_count; i++) {
+            snprintf(key, sizeof(key), "%d", alarms[i].alarm_id);
+            replication_publish(g_replication, REPLICATION_KIND_ALARM, key,
+                                &alarms[i], sizeof(alarm_t));
+        }
+        free(alarms);
+    }
+    replication_expire(g_replication, REPLICATION_KIND_ALARM);
+}
+
+/* Initialize all components */
+static wtc_result_t initialize_components(void) {
+    wtc_result_t res;
+
+    /* Connect to the database in the background; configuration comes
+     * from the snapshot until it is available */
+    start_config_refresh();
 
     /* Initialize RTU registry */
     registry_config_t reg_config = {
@@ -605,18 +1145,24 @@ static wtc_result_t initialize_components(void) {
         return res;
     }
 
+    if (g_config.latency_trace && latency_trace_init(&g_latency) != WTC_OK) {
+        LOG_WARN("Latency tracing unavailable");
+    }
+
     /* Initialize PROFINET controller or Simulator */
     if (g_config.simulation_mode) {
         /* Simulation mode - use virtual RTU simulator */
         LOG_INFO("*** SIMULATION MODE ENABLED ***");
-        LOG_INFO("Scenario: %s", g_config.simulation_scenario);
+        LOG_INFO("Scenario: %s (%gx real time)", g_config.simulation_scenario,
+                 g_config.simulation_time_scale);
 
         simulator_config_t sim_config = {
             .scenario = simulator_parse_scenario(g_config.simulation_scenario),
             .update_rate_hz = 1.0f,
             .enable_alarms = true,
             .enable_pid_response = true,
-            .time_scale = 1.0f,
+            .time_scale = g_config.simulation_time_scale,
+            .worker_threads = g_config.simulation_threads,
         };
 
         res = simulator_init(&g_simulator, &sim_config);
@@ -625,6 +1171,7 @@ static wtc_result_t initialize_components(void) {
             return res;
         }
         simulator_set_registry(g_simulator, g_registry);
+        simulator_set_latency_trace(g_simulator, g_latency);
     } else {
         /* Normal mode - use real PROFINET controller */
         profinet_config_t pn_config = {
@@ -639,6 +1186,7 @@ static wtc_result_t initialize_components(void) {
             .on_device_state_changed = on_profinet_state_changed,
             .on_data_received = on_data_received,
             .on_slots_discovered = on_slots_discovered,
+            .on_watchdog = on_profinet_watchdog,
             .callback_ctx = NULL,
         };
         strncpy(pn_config.interface_name, g_config.interface,
@@ -650,6 +1198,7 @@ static wtc_result_t initialize_components(void) {
             LOG_ERROR("Failed to initialize PROFINET controller");
             return res;
         }
+        profinet_controller_set_latency_trace(g_profinet, g_latency);
     }
 
     /* Initialize control engine */
@@ -663,6 +1212,7 @@ static wtc_result_t initialize_components(void) {
         return res;
     }
     control_engine_set_registry(g_control, g_registry);
+    control_engine_set_latency_trace(g_control, g_latency);
 
     /* Initialize alarm manager */
     alarm_manager_config_t alarm_config = {
@@ -687,6 +1237,7 @@ static wtc_result_t initialize_components(void) {
         .default_sample_rate_ms = 1000,
         .default_deadband = 0.1f,
         .retention_days = 365,
+        .wal_enabled = true,
     };
 
     res = historian_init(&g_historian, &hist_config);
@@ -767,15 +1318,71 @@ static wtc_result_t initialize_components(void) {
         }
     }
 
-    /* Load configuration from database */
-    load_config_from_database();
+    /* Initialize hot-standby replication */
+    if (g_config.replicate_port || g_config.standby_mode) {
+        replication_config_t repl_config = {
+            .role = g_config.standby_mode ? REPLICATION_STANDBY : REPLICATION_PRIMARY,
+            .listen_port = g_config.replicate_port,
+            .peer_port = g_config.standby_port,
+        };
+        snprintf(repl_config.bind_addr, sizeof(repl_config.bind_addr), "%s",
+                 g_config.replicate_bind);
+        snprintf(repl_config.peer_host, sizeof(repl_config.peer_host), "%s",
+                 g_config.standby_host);
+        snprintf(repl_config.auth_key, sizeof(repl_config.auth_key), "%s",
+                 g_config.replicate_key);
+
+        if (!repl_config.auth_key[0]) {
+            LOG_ERROR("Replication needs a shared key (--replicate-key or WTC_REPLICATION_KEY)");
+            return WTC_ERROR_INVALID_PARAM;
+        }
+        res = replication_init(&g_replication, &repl_config);
+        memset(&repl_config, 0, sizeof(repl_config));
+        if (res != WTC_OK) {
+            LOG_ERROR("Failed to initialize replication");
+            return res;
+        }
+        replication_set_apply_callback(g_replication, on_replicated_record, NULL);
+        replication_set_promote_callback(g_replication, on_replication_promoted, NULL);
+        replication_set_demote_callback(g_replication, on_replication_demoted, NULL);
+        historian_set_sample_observer(g_historian, on_historian_sample, g_replication);
+    }
+
+    /* Initialize health monitoring and load shedding */
+    if (health_monitor_init(&g_health) == WTC_OK &&
+        load_shed_init(&g_load_shed, g_health, NULL) == WTC_OK) {
+        static const component_id_t monitored[] = {
+            COMPONENT_PROFINET, COMPONENT_REGISTRY, COMPONENT_CONTROL_ENGINE,
+            COMPONENT_ALARM_MANAGER, COMPONENT_HISTORIAN, COMPONENT_IPC_SERVER,
+            COMPONENT_MODBUS,
+        };
+        for (size_t i = 0; i < sizeof(monitored) / sizeof(monitored[0]); i++) {
+            health_mark_initialized(g_health, monitored[i]);
+        }
+        /* Retry slow IPC updates sooner than the 30 s default */
+        health_register_component(g_health, COMPONENT_IPC_SERVER, NULL, false, 3, 5000);
+
+        /* Overrunning the PROFINET cycle or control scan period is overload */
+        load_shed_policy_t policy = { .priority = 0,
+                                      .budget_us = g_config.cycle_time_ms * 1000 };
+        load_shed_set_policy(g_load_shed, COMPONENT_PROFINET, &policy);
+        policy.budget_us = ctrl_config.scan_rate_ms * 1000;
+        load_shed_set_policy(g_load_shed, COMPONENT_CONTROL_ENGINE, &policy);
+        load_shed_set_callback(g_load_shed, on_load_shed_step, NULL);
+    } else {
+        LOG_WARN("Failed to initialize load shedding - running without it");
+    }
+
+    /* Load configuration from the snapshot */
+    load_config_snapshot();
 
     LOG_INFO("All components initialized successfully");
     return WTC_OK;
 }
 
-/* Start all components */
-static wtc_result_t start_components(void) {
+/* Start the components that own RTUs and outputs; deferred on a standby
+ * until it is promoted */
+static wtc_result_t start_control_components(void) {
     wtc_result_t res;
 
     if (g_config.simulation_mode) {
@@ -810,12 +1417,6 @@ static wtc_result_t start_components(void) {
         return res;
     }
 
-    res = ipc_server_start(g_ipc);
-    if (res != WTC_OK) {
-        LOG_ERROR("Failed to start IPC server");
-        return res;
-    }
-
     res = modbus_gateway_start(g_modbus);
     if (res != WTC_OK) {
         LOG_ERROR("Failed to start Modbus gateway");
@@ -830,27 +1431,69 @@ static wtc_result_t start_components(void) {
         }
     }
 
-    LOG_INFO("All components started successfully");
     return WTC_OK;
 }
 
-/* Stop all components */
-static void stop_components(void) {
-    LOG_INFO("Stopping components...");
+/* Start all components */
+static wtc_result_t start_components(void) {
+    wtc_result_t res;
+
+    res = ipc_server_start(g_ipc);
+    if (res != WTC_OK) {
+        LOG_ERROR("Failed to start IPC server");
+        return res;
+    }
+
+    if (g_replication) {
+        res = replication_start(g_replication);
+        if (res != WTC_OK) {
+            LOG_ERROR("Failed to start replication");
+            return res;
+        }
+    }
 
+    if (g_config.standby_mode) {
+        LOG_INFO("Hot standby following %s:%u", g_config.standby_host, g_config.standby_port);
+        return WTC_OK;
+    }
+
+    res = start_control_components();
+    if (res != WTC_OK) {
+        return res;
+    }
+
+    LOG_INFO("All components started successfully");
+    return WTC_OK;
+}
+
+/* Stop the components started by start_control_components() */
+static void stop_control_components(void) {
     /* Stop failover first */
     if (g_failover) failover_stop(g_failover);
 
     if (g_modbus) modbus_gateway_stop(g_modbus);
-    if (g_ipc) ipc_server_stop(g_ipc);
     if (g_historian) historian_stop(g_historian);
     if (g_alarms) alarm_manager_stop(g_alarms);
     if (g_control) control_engine_stop(g_control);
     if (g_simulator) simulator_stop(g_simulator);
     if (g_profinet) profinet_controller_stop(g_profinet);
+}
 
-    /* Save configuration to database before shutdown */
+/* Stop all components */
+static void stop_components(void) {
+    LOG_INFO("Stopping components...");
+
+    if (g_ipc) ipc_server_stop(g_ipc);
+    stop_control_components();
+    latency_trace_log_summary(g_latency);
+
+    /* Stop replication last so the standby only takes over once outputs stopped */
+    if (g_replication) replication_stop(g_replication);
+
+    /* Save configuration to database and snapshot before shutdown */
+    finish_config_refresh(true);
     save_config_to_database();
+    save_config_snapshot();
 }
 
 /* Cleanup all components */
@@ -858,6 +1501,8 @@ static void cleanup_components(void) {
     LOG_INFO("Cleaning up components...");
 
     /* Cleanup in reverse order of initialization */
+    if (g_load_shed) load_shed_cleanup(g_load_shed);
+    if (g_health) health_monitor_cleanup(g_health);
     if (g_failover) failover_cleanup(g_failover);
     modbus_gateway_cleanup(g_modbus);
     if (g_user_sync) user_sync_manager_cleanup(g_user_sync);
@@ -867,7 +1512,9 @@ static void cleanup_components(void) {
     control_engine_cleanup(g_control);
     if (g_simulator) simulator_cleanup(g_simulator);
     if (g_profinet) profinet_controller_cleanup(g_profinet);
+    if (g_replication) replication_cleanup(g_replication);
     rtu_registry_cleanup(g_registry);
+    latency_trace_cleanup(g_latency);
 
     /* Disconnect and cleanup database last */
     if (g_database) {
@@ -945,7 +1592,32 @@ static bool detect_network_interface(char *interface, size_t size) {
     return found;
 }
 
-/* Main function */
+/* Report PROFINET cycle and control scan timing, then re-evaluate */
+static void update_load_shedding(void) {
+    if (!g_load_shed) return;
+
+    cycle_stats_t cycle_stats;
+    if (g_profinet && profinet_controller_get_stats(g_profinet, &cycle_stats) == WTC_OK) {
+        load_shed_report_cycles(g_load_shed, COMPONENT_PROFINET, cycle_stats.cycle_count,
+                                cycle_stats.cycle_time_us_total, cycle_stats.overruns);
+    }
+
+    control_stats_t ctrl_stats;
+    if (g_control && control_engine_get_stats(g_control, &ctrl_stats) == WTC_OK) {
+        load_shed_report_cycles(g_load_shed, COMPONENT_CONTROL_ENGINE, ctrl_stats.total_scans,
+                                ctrl_stats.scan_time_us_total, ctrl_stats.scan_overruns);
+    }
+
+    load_shed_evaluate(g_load_shed, time_get_ms());
+}
+
+/* Run a shed component's main-loop work only every divisor-th pass */
+static bool shed_allow_pass(component_id_t id, uint32_t pass) {
+    if (!g_load_shed) return true;
+    return pass % load_shed_divisor(g_load_shed, id) == 0 &&
+           load_shed_allow(g_load_shed, id);
+}
+
 int main(int argc, char *argv[]) {
     /* Parse command line arguments */
     parse_args(argc, argv);
@@ -998,9 +1670,13 @@ int main(int argc, char *argv[]) {
     LOG_INFO("Controller running. Press Ctrl+C to stop.");
 
     /* Main loop */
+    uint32_t main_pass = 0;
     while (g_running) {
-        /* Main loop processing */
-        time_sleep_ms(100);
+        /* Main loop processing; a lost replication lease cuts the wait
+         * short, since outputs must stop before the standby takes over */
+        for (int slice = 0; slice < 10 && !g_demoted; slice++) {
+            time_sleep_ms(10);
+        }
 
         /* Process simulator if in simulation mode */
         if (g_simulator) {
@@ -1012,24 +1688,80 @@ int main(int argc, char *argv[]) {
             profinet_controller_process(g_profinet);
         }
 
-        /* Update IPC shared memory and process commands */
-        ipc_server_update(g_ipc);
+        /* Feed cycle timing to load shedding and update the shed level */
+        update_load_shedding();
+
+        /* Update IPC shared memory (shed under overload) and process commands */
+        main_pass++;
+        if (shed_allow_pass(COMPONENT_IPC_SERVER, main_pass)) {
+            uint64_t start_us = time_get_monotonic_us();
+            ipc_server_update(g_ipc);
+            load_shed_report_latency(g_load_shed, COMPONENT_IPC_SERVER,
+                                     time_get_monotonic_us() - start_us);
+        }
         ipc_server_process_commands(g_ipc);
 
         /* Process Modbus gateway (poll downstream devices) */
-        modbus_gateway_process(g_modbus);
+        if (shed_allow_pass(COMPONENT_MODBUS, main_pass)) {
+            modbus_gateway_process(g_modbus);
+        }
 
-        /* Process failover logic (check RTU health, trigger failovers) */
+        /* Process failover logic (expired RTU health timers, failovers) */
         if (g_failover) {
             failover_process(g_failover);
         }
 
+        /* Reconcile with the database once it is connected */
+        finish_config_refresh(false);
+
+        /* Hot-standby replication */
+        if (g_demoted) {
+            g_demoted = false;
+            g_config.standby_mode = true;
+            LOG_ERROR("Lost the replication lease - stopping outputs for the standby");
+            stop_control_components();
+        }
+        if (g_promoted) {
+            g_promoted = false;
+            g_config.standby_mode = false;
+            LOG_WARN("Taking over as primary controller");
+            if (start_control_components() != WTC_OK) {
+                LOG_ERROR("Failed to start components after promotion");
+            }
+        }
+        static uint64_t last_publish_ms = 0;
+        if (g_replication && !g_config.standby_mode) {
+            uint64_t publish_now_ms = time_get_ms();
+            if (publish_now_ms - last_publish_ms >= REPLICATION_PUBLISH_MS) {
+                last_publish_ms = publish_now_ms;
+                publish_replicated_state();
+            }
+        } else if (g_replication) {
+            /* Standby: the historian is not running, so write replicated samples here */
+            static uint64_t last_standby_flush_ms = 0;
+            uint64_t flush_now_ms = time_get_ms();
+            if (flush_now_ms - last_standby_flush_ms >= 10000) {
+                last_standby_flush_ms = flush_now_ms;
+                historian_flush(g_historian);
+            }
+        }
+
         /* Periodic status (every 10 seconds) */
         static uint64_t last_status_ms = 0;
         uint64_t now_ms = time_get_ms();
         if (now_ms - last_status_ms >= 10000) {
             last_status_ms = now_ms;
 
+            /* Keep the configuration snapshot current */
+            save_config_snapshot();
+
+            /* Control latency per loop, once a minute */
+            static uint64_t last_latency_ms = 0;
+            if (g_latency && now_ms - last_latency_ms >= 60000) {
+                last_latency_ms = now_ms;
+                latency_trace_log_summary(g_latency);
+            }
+
             registry_stats_t reg_stats;
             rtu_registry_get_stats(g_registry, &reg_stats);
 
@@ -1046,6 +1778,40 @@ int main(int argc, char *argv[]) {
                      reg_stats.connected_devices, reg_stats.total_devices,
                      alarm_stats.active_alarms, alarm_stats.unack_alarms);
 
+            pool_stats_t pools[POOL_MAX_REGISTERED];
+            int pool_count = pool_list_stats(pools, POOL_MAX_REGISTERED);
+            for (int i = 0; i < pool_count; i++) {
+                LOG_DEBUG("Pool %s: in_use=%d/%d (high=%d), allocs=%llu, fallbacks=%llu",
+                          pools[i].name, pools[i].in_use, pools[i].capacity,
+                          pools[i].high_water,
+                          (unsigned long long)pools[i].allocs,
+                          (unsigned long long)pools[i].fallbacks);
+            }
+
+            arena_stats_t scratch_stats;
+            int scratch_count = 0;
+            arena_scratch_stats(&scratch_stats, &scratch_count);
+            LOG_DEBUG("Scratch arenas: count=%d, reserved=%zu, high=%zu, "
+                      "allocs=%llu, chunk_allocs=%llu",
+                      scratch_count, scratch_stats.reserved, scratch_stats.high_water,
+                      (unsigned long long)scratch_stats.allocs,
+                      (unsigned long long)scratch_stats.chunk_allocs);
+
+            if (g_replication) {
+                replication_stats_t repl_stats;
+                replication_get_stats(g_replication, &repl_stats);
+                LOG_DEBUG("Replication [%s]: connected=%d, seq=%llu, acked=%llu, "
+                          "records=%llu (delta=%llu), bytes=%llu/%llu",
+                          repl_stats.role == REPLICATION_PRIMARY ? "primary" : "standby",
+                          repl_stats.connected,
+                          (unsigned long long)repl_stats.seq,
+                          (unsigned long long)repl_stats.acked_seq,
+                          (unsigned long long)repl_stats.records,
+                          (unsigned long long)repl_stats.delta_records,
+                          (unsigned long long)repl_stats.bytes,
+                          (unsigned long long)repl_stats.full_bytes);
+            }
+
             /* Log failover status if enabled - only at DEBUG level to avoid spam */
             if (g_failover) {
                 failover_status_t fo_status;
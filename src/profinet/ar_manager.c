@@ -12,6 +12,7 @@
 #include "profinet_rpc.h"
 #include "rpc_strategy.h"
 #include "gsdml_modules.h"
+#include "core/latency_trace.h"
 #include "utils/logger.h"
 #include "utils/time_utils.h"
 
@@ -63,6 +64,13 @@ struct ar_manager {
     /* State change notification */
     ar_state_change_callback_t state_callback;
     void *state_callback_ctx;
+
+    /* Watchdog notification */
+    ar_watchdog_callback_t watchdog_callback;
+    void *watchdog_callback_ctx;
+
+    /* Latency tracer (NULL = off) */
+    latency_trace_t *trace;
 };
 
 /* Notify state change if callback is registered */
@@ -77,6 +85,14 @@ static void notify_state_change(ar_manager_t *manager,
     }
 }
 
+/* Notify watchdog miss or recovery if callback is registered */
+static void notify_watchdog(ar_manager_t *manager, profinet_ar_t *ar, int missed_cycles) {
+    if (manager->watchdog_callback) {
+        manager->watchdog_callback(ar->device_station_name, missed_cycles,
+                                   manager->watchdog_callback_ctx);
+    }
+}
+
 /* Generate UUID */
 static void generate_uuid(uint32_t uuid[4]) {
     /* Simple UUID generation - in production use proper UUID library */
@@ -108,6 +124,22 @@ static wtc_result_t send_frame(ar_manager_t *manager,
     return WTC_OK;
 }
 
+/* Record send and end-to-end latency of the outputs a frame carried */
+static void close_output_traces(ar_manager_t *manager, profinet_ar_t *ar) {
+    uint64_t now_us = time_get_monotonic_us();
+
+    for (int i = 0; i < WTC_MAX_SLOTS && ar->output_trace_pending > 0; i++) {
+        if (ar->output_trace[i].source_time_us == 0) continue;
+
+        latency_trace_record(manager->trace, ar->output_trace[i].trace_id,
+                             LATENCY_STAGE_SEND, now_us - ar->output_trace[i].image_time_us);
+        latency_trace_record(manager->trace, ar->output_trace[i].trace_id,
+                             LATENCY_STAGE_TOTAL, now_us - ar->output_trace[i].source_time_us);
+        ar->output_trace[i].source_time_us = 0;
+        ar->output_trace_pending--;
+    }
+}
+
 /* Build and send cyclic output frame */
 static wtc_result_t send_cyclic_frame(ar_manager_t *manager, profinet_ar_t *ar) {
     if (!ar || ar->state != AR_STATE_RUN) {
@@ -190,7 +222,11 @@ static wtc_result_t send_cyclic_frame(ar_manager_t *manager, profinet_ar_t *ar)
         frame[pos++] = 0x00;
     }
 
-    return send_frame(manager, ar->device_mac, frame, pos);
+    wtc_result_t res = send_frame(manager, ar->device_mac, frame, pos);
+    if (res == WTC_OK && manager->trace && ar->output_trace_pending > 0) {
+        close_output_traces(manager, ar);
+    }
+    return res;
 }
 
 /* Public functions */
@@ -1341,6 +1377,7 @@ wtc_result_t ar_manager_check_health(ar_manager_t *manager) {
         /* Progressive watchdog: track consecutive misses */
         if (now_ms - ar->last_activity_ms > ar->watchdog_ms) {
             ar->missed_cycles++;
+            notify_watchdog(manager, ar, ar->missed_cycles);
 
             if (ar->missed_cycles == 1) {
                 LOG_WARN("AR %s watchdog miss (%d/%d)",
@@ -1370,6 +1407,7 @@ wtc_result_t ar_manager_check_health(ar_manager_t *manager) {
                 LOG_DEBUG("AR %s watchdog recovered after %d misses",
                           ar->device_station_name, ar->missed_cycles);
                 ar->missed_cycles = 0;
+                notify_watchdog(manager, ar, 0);
             }
         }
     }
@@ -1386,6 +1424,22 @@ void ar_manager_set_state_callback(ar_manager_t *manager,
     }
 }
 
+void ar_manager_set_watchdog_callback(ar_manager_t *manager,
+                                       ar_watchdog_callback_t callback,
+                                       void *ctx) {
+    if (manager) {
+        manager->watchdog_callback = callback;
+        manager->watchdog_callback_ctx = ctx;
+    }
+}
+
+void ar_manager_set_latency_trace(ar_manager_t *manager,
+                                  struct latency_trace *trace) {
+    if (manager) {
+        manager->trace = trace;
+    }
+}
+
 /* ============== Phase 2-4: Discovery Pipeline ============== */
 
 /**
@@ -23,6 +23,12 @@ typedef void (*ar_state_change_callback_t)(const char *station_name,
                                             ar_state_t new_state,
                                             void *ctx);
 
+/* AR watchdog callback - called on each watchdog miss of a running AR with
+ * the consecutive miss count, and with 0 when cyclic data resumes */
+typedef void (*ar_watchdog_callback_t)(const char *station_name,
+                                        int missed_cycles,
+                                        void *ctx);
+
 /* AR configuration
  * Note: device_ip is in HOST byte order (use htonl() for socket APIs).
  */
@@ -129,6 +135,17 @@ void ar_manager_set_state_callback(ar_manager_t *manager,
                                     ar_state_change_callback_t callback,
                                     void *ctx);
 
+/* Set callback for AR watchdog misses and recoveries */
+void ar_manager_set_watchdog_callback(ar_manager_t *manager,
+                                       ar_watchdog_callback_t callback,
+                                       void *ctx);
+
+/* Set latency tracer; send_cyclic_frame() closes the traces of the
+ * outputs it carries (NULL = off) */
+struct latency_trace;
+void ar_manager_set_latency_trace(ar_manager_t *manager,
+                                  struct latency_trace *trace);
+
 /* ============== RPC Context Access ============== */
 
 /* Get RPC context for direct acyclic operations.
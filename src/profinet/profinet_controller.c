@@ -12,6 +12,7 @@
 #include "profinet_frame.h"
 #include "ar_manager.h"
 #include "gsdml_modules.h"
+#include "core/latency_trace.h"
 #include "utils/logger.h"
 #include "utils/time_utils.h"
 
@@ -61,6 +62,9 @@ struct profinet_controller {
     cycle_stats_t stats;
     uint64_t last_stats_reset_ms;
 
+    /* Latency tracer (NULL = off) */
+    latency_trace_t *trace;
+
     /* Interface info */
     int if_index;
     uint8_t mac_address[6];
@@ -229,6 +233,15 @@ static void ar_state_change_callback(const char *station_name,
     }
 }
 
+/* AR watchdog callback - forwards to profinet_config_t callbacks */
+static void ar_watchdog_callback(const char *station_name, int missed_cycles, void *ctx) {
+    profinet_controller_t *ctrl = (profinet_controller_t *)ctx;
+
+    if (ctrl->config.on_watchdog) {
+        ctrl->config.on_watchdog(station_name, missed_cycles, ctrl->config.callback_ctx);
+    }
+}
+
 /* DCP discovery callback */
 static void dcp_callback(const dcp_device_info_t *device, void *ctx) {
     profinet_controller_t *ctrl = (profinet_controller_t *)ctx;
@@ -311,6 +324,7 @@ static void *recv_thread_func(void *arg) {
 
         if (pfd.revents & POLLIN) {
             ssize_t len = recv(ctrl->raw_socket, buffer, sizeof(buffer), 0);
+            uint64_t rx_time_us = time_get_monotonic_us();
             if (len < 0) {
                 if (errno == EINTR || errno == EAGAIN) continue;
                 LOG_ERROR("recv() failed: %s", strerror(errno));
@@ -395,6 +409,7 @@ static void *recv_thread_func(void *arg) {
                                             sensor_idx,
                                             ar->iocr[j].data_buffer + offset,
                                             GSDML_INPUT_DATA_SIZE,
+                                            rx_time_us,
                                             ctrl->config.callback_ctx);
                                     }
                                     /* Advance past data + IOPS byte */
@@ -466,10 +481,10 @@ static void *cyclic_thread_func(void *arg) {
             ctrl->stats.cycle_time_us_max = elapsed_us;
         }
 
-        /* Running average */
+        /* Average from the exact total, so windows can be taken from it */
+        ctrl->stats.cycle_time_us_total += elapsed_us;
         ctrl->stats.cycle_time_us_avg =
-            (ctrl->stats.cycle_time_us_avg * (ctrl->stats.cycle_count - 1) +
-             elapsed_us) / ctrl->stats.cycle_count;
+            ctrl->stats.cycle_time_us_total / ctrl->stats.cycle_count;
 
         if (elapsed_us > cycle_time_us) {
             ctrl->stats.overruns++;
@@ -580,6 +595,7 @@ wtc_result_t profinet_controller_init(profinet_controller_t **controller,
 
     /* Register AR state change callback for config sync and notifications */
     ar_manager_set_state_callback(ctrl->ar_manager, ar_state_change_callback, ctrl);
+    ar_manager_set_watchdog_callback(ctrl->ar_manager, ar_watchdog_callback, ctrl);
 
     /* Set controller IP for RPC communication
      * Priority: config->ip_address > auto-detected from interface > .1 heuristic (in ar_manager)
@@ -1141,6 +1157,82 @@ wtc_result_t profinet_controller_write_output(profinet_controller_t *controller,
     return WTC_ERROR_NOT_FOUND;
 }
 
+wtc_result_t profinet_controller_write_actuator(profinet_controller_t *controller,
+                                                 const char *station_name,
+                                                 int actuator_index,
+                                                 const actuator_state_t *state) {
+    if (!controller || !station_name || !state ||
+        actuator_index < 0 || actuator_index >= WTC_MAX_SLOTS) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&controller->lock);
+
+    profinet_ar_t *ar = ar_manager_get_ar(controller->ar_manager, station_name);
+    if (!ar) {
+        pthread_mutex_unlock(&controller->lock);
+        return WTC_ERROR_NOT_FOUND;
+    }
+
+    if (ar->state != AR_STATE_RUN) {
+        pthread_mutex_unlock(&controller->lock);
+        return WTC_ERROR_NOT_INITIALIZED;
+    }
+
+    int actuator_count = 0;
+    for (int s = 0; s < ar->slot_count; s++) {
+        if (ar->slot_info[s].type == SLOT_TYPE_ACTUATOR) {
+            actuator_count++;
+        }
+    }
+
+    /* Actuator slots are packed in slot order, GSDML_OUTPUT_DATA_SIZE each */
+    wtc_result_t res = WTC_ERROR_NOT_FOUND;
+    for (int i = 0; i < ar->iocr_count; i++) {
+        if (ar->iocr[i].type == IOCR_TYPE_OUTPUT && ar->iocr[i].data_buffer) {
+            uint32_t offset = (uint32_t)actuator_index * GSDML_OUTPUT_DATA_SIZE;
+            if (actuator_index < actuator_count &&
+                offset + GSDML_OUTPUT_DATA_SIZE <= ar->iocr[i].data_length) {
+                memcpy(ar->iocr[i].data_buffer + offset, &state->output,
+                       GSDML_OUTPUT_DATA_SIZE);
+                res = WTC_OK;
+            }
+            break;
+        }
+    }
+
+    /* Start tracing a new output; send_cyclic_frame() closes it */
+    if (res == WTC_OK && controller->trace && state->trace_id != 0 &&
+        state->source_time_us != ar->output_trace[actuator_index].last_source_us) {
+        uint64_t now_us = time_get_monotonic_us();
+        if (ar->output_trace[actuator_index].source_time_us == 0) {
+            ar->output_trace_pending++;
+        }
+        ar->output_trace[actuator_index].source_time_us = state->source_time_us;
+        ar->output_trace[actuator_index].image_time_us = now_us;
+        ar->output_trace[actuator_index].last_source_us = state->source_time_us;
+        ar->output_trace[actuator_index].trace_id = state->trace_id;
+
+        if (now_us >= state->output_time_us) {
+            latency_trace_record(controller->trace, state->trace_id, LATENCY_STAGE_IMAGE,
+                                 now_us - state->output_time_us);
+        }
+    }
+
+    pthread_mutex_unlock(&controller->lock);
+    return res;
+}
+
+void profinet_controller_set_latency_trace(profinet_controller_t *controller,
+                                           struct latency_trace *trace) {
+    if (!controller) return;
+
+    pthread_mutex_lock(&controller->lock);
+    controller->trace = trace;
+    ar_manager_set_latency_trace(controller->ar_manager, trace);
+    pthread_mutex_unlock(&controller->lock);
+}
+
 /* PROFINET RPC constants - use definitions from profinet_rpc.h:
  * - PNIO_RPC_PORT, RPC_VERSION_MAJOR
  * - RPC_PACKET_TYPE_REQUEST, RPC_PACKET_TYPE_RESPONSE
@@ -1244,54 +1336,6 @@ static wtc_result_t build_rpc_record_request(
     return WTC_OK;
 }
 
-/* Send RPC request and wait for response */
-static wtc_result_t send_rpc_request(
-    int socket_fd, uint32_t device_ip,
-    const uint8_t *request, size_t req_len,
-    uint8_t *response, size_t *resp_len)
-{
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(PNIO_RPC_PORT);
-    addr.sin_addr.s_addr = htonl(device_ip);  /* Convert host to network byte order */
-
-    /* Send request */
-    ssize_t sent = sendto(socket_fd, request, req_len, 0,
-                          (struct sockaddr *)&addr, sizeof(addr));
-    if (sent < 0) {
-        LOG_ERROR("Failed to send RPC request: %s", strerror(errno));
-        return WTC_ERROR_IO;
-    }
-
-    /* Wait for response with timeout */
-    struct pollfd pfd;
-    pfd.fd = socket_fd;
-    pfd.events = POLLIN;
-
-    int poll_result = poll(&pfd, 1, RPC_READ_TIMEOUT_MS);
-    if (poll_result < 0) {
-        LOG_ERROR("Poll failed: %s", strerror(errno));
-        return WTC_ERROR_IO;
-    }
-    if (poll_result == 0) {
-        LOG_WARN("RPC request timeout");
-        return WTC_ERROR_TIMEOUT;
-    }
-
-    /* Receive response */
-    socklen_t addr_len = sizeof(addr);
-    ssize_t received = recvfrom(socket_fd, response, *resp_len, 0,
-                                 (struct sockaddr *)&addr, &addr_len);
-    if (received < 0) {
-        LOG_ERROR("Failed to receive RPC response: %s", strerror(errno));
-        return WTC_ERROR_IO;
-    }
-
-    *resp_len = (size_t)received;
-    return WTC_OK;
-}
-
 wtc_result_t profinet_controller_read_record(profinet_controller_t *controller,
                                               const char *station_name,
                                               uint32_t api,
@@ -1332,13 +1376,6 @@ wtc_result_t profinet_controller_read_record(profinet_controller_t *controller,
 
     pthread_mutex_unlock(&controller->lock);
 
-    /* Get RPC socket from ar_manager (it owns the properly configured socket) */
-    rpc_context_t *rpc_ctx = ar_manager_get_rpc_context(controller->ar_manager);
-    if (!rpc_ctx) {
-        LOG_ERROR("RPC context not available for record read");
-        return WTC_ERROR_NOT_CONNECTED;
-    }
-
     /* Build RPC request from copied fields (no lock held) */
     uint8_t request[512];
     size_t req_len = sizeof(request);
@@ -1356,8 +1393,9 @@ wtc_result_t profinet_controller_read_record(profinet_controller_t *controller,
     uint8_t response[2048];
     size_t resp_len = sizeof(response);
 
-    result = send_rpc_request(rpc_ctx->socket_fd, device_ip_copy,
-                               request, req_len, response, &resp_len);
+    result = rpc_record_exchange(controller->config.interface_name, device_ip_copy,
+                                 request, req_len, response, &resp_len,
+                                 RPC_READ_TIMEOUT_MS);
 
     if (result != WTC_OK) {
         return result;
@@ -1444,13 +1482,6 @@ wtc_result_t profinet_controller_write_record(profinet_controller_t *controller,
 
     pthread_mutex_unlock(&controller->lock);
 
-    /* Get RPC socket from ar_manager (it owns the properly configured socket) */
-    rpc_context_t *rpc_ctx = ar_manager_get_rpc_context(controller->ar_manager);
-    if (!rpc_ctx) {
-        LOG_ERROR("RPC context not available for record write");
-        return WTC_ERROR_NOT_CONNECTED;
-    }
-
     /* Build RPC request from copied fields (no lock held) */
     uint8_t request[2048];
     size_t req_len = sizeof(request);
@@ -1468,8 +1499,9 @@ wtc_result_t profinet_controller_write_record(profinet_controller_t *controller,
     uint8_t response[512];
     size_t resp_len = sizeof(response);
 
-    result = send_rpc_request(rpc_ctx->socket_fd, device_ip_copy,
-                               request, req_len, response, &resp_len);
+    result = rpc_record_exchange(controller->config.interface_name, device_ip_copy,
+                                 request, req_len, response, &resp_len,
+                                 RPC_READ_TIMEOUT_MS);
 
     if (result != WTC_OK) {
         return result;
@@ -93,8 +93,10 @@ typedef struct {
     void (*on_device_added)(const rtu_device_t *device, void *ctx);
     void (*on_device_removed)(const char *station_name, void *ctx);
     void (*on_device_state_changed)(const char *station_name, profinet_state_t state, void *ctx);
-    void (*on_data_received)(const char *station_name, int sensor_index, const void *data, size_t len, void *ctx);
+    void (*on_data_received)(const char *station_name, int sensor_index, const void *data, size_t len,
+                             uint64_t rx_time_us, void *ctx);  /* rx_time_us: time_get_monotonic_us() at receive */
     void (*on_slots_discovered)(const char *station_name, const slot_config_t *slots, int slot_count, void *ctx);
+    void (*on_watchdog)(const char *station_name, int missed_cycles, void *ctx);  /* 0 = recovered */
     void *callback_ctx;
 } profinet_config_t;
 
@@ -161,6 +163,16 @@ typedef struct {
     /* Watchdog degradation */
     int missed_cycles;                  /* Consecutive missed watchdog cycles */
 
+    /* Latency tracing of outputs in the output image, per actuator
+     * index; closed when the next cyclic frame is sent */
+    struct {
+        uint64_t source_time_us;        /* Input receive time, 0 = nothing pending */
+        uint64_t image_time_us;         /* Copied into the output image */
+        uint64_t last_source_us;        /* Last source traced, to trace each once */
+        uint32_t trace_id;
+    } output_trace[WTC_MAX_SLOTS];
+    int output_trace_pending;
+
     /* Authority handoff - who has control of this device */
     authority_context_t authority;
 
@@ -226,6 +238,20 @@ wtc_result_t profinet_controller_write_output(profinet_controller_t *controller,
                                                const void *data,
                                                size_t len);
 
+/* Write an actuator output into the output image by actuator index (the
+ * order of the device's actuator slots, as for on_data_received). When
+ * the state carries a new latency trace, the image stage is recorded and
+ * the trace is closed by the cyclic frame that sends it. */
+wtc_result_t profinet_controller_write_actuator(profinet_controller_t *controller,
+                                                 const char *station_name,
+                                                 int actuator_index,
+                                                 const actuator_state_t *state);
+
+/* Set latency tracer (NULL = off) */
+struct latency_trace;
+void profinet_controller_set_latency_trace(profinet_controller_t *controller,
+                                           struct latency_trace *trace);
+
 /* Read record data (acyclic) */
 wtc_result_t profinet_controller_read_record(profinet_controller_t *controller,
                                               const char *station_name,
@@ -149,6 +149,7 @@ static void write_u8(uint8_t *buf, uint8_t val)
  * @param[out] buf              Output buffer
  * @param[in]  ctx              RPC context
  * @param[in]  object_uuid      AR UUID (object UUID)
+ * @param[in]  interface_uuid   Called interface (device or controller)
  * @param[in]  opnum            Operation number
  * @param[in]  fragment_length  Length of data after header
  * @param[out] pos              Position after header
@@ -158,12 +159,13 @@ static void write_u8(uint8_t *buf, uint8_t val)
  * @note Thread safety: SAFE
  * @note Memory: NO_ALLOC
  */
-static wtc_result_t build_rpc_header(uint8_t *buf,
-                                      rpc_context_t *ctx,
-                                      const uint8_t *object_uuid,
-                                      uint16_t opnum,
-                                      uint16_t fragment_length,
-                                      size_t *pos)
+static wtc_result_t build_rpc_request_header(uint8_t *buf,
+                                              rpc_context_t *ctx,
+                                              const uint8_t *object_uuid,
+                                              const uint8_t *interface_uuid,
+                                              uint16_t opnum,
+                                              uint16_t fragment_length,
+                                              size_t *pos)
 {
     profinet_rpc_header_t *hdr = (profinet_rpc_header_t *)buf;
 
@@ -213,7 +215,7 @@ static wtc_result_t build_rpc_header(uint8_t *buf,
      * Without the swap, p-net reads 0x0100A0DE instead of 0xDEA00001,
      * the UUID check fails, and the packet is silently dropped.
      */
-    memcpy(hdr->interface_uuid, PNIO_DEVICE_INTERFACE_UUID, 16);
+    memcpy(hdr->interface_uuid, interface_uuid, 16);
     uuid_swap_fields(hdr->interface_uuid);
 
     /* Activity UUID (unique per request) — swap to LE */
@@ -238,6 +240,86 @@ static wtc_result_t build_rpc_header(uint8_t *buf,
     return WTC_OK;
 }
 
+/* Build RPC header for a request to the IO device interface */
+static wtc_result_t build_rpc_header(uint8_t *buf,
+                                      rpc_context_t *ctx,
+                                      const uint8_t *object_uuid,
+                                      uint16_t opnum,
+                                      uint16_t fragment_length,
+                                      size_t *pos)
+{
+    return build_rpc_request_header(buf, ctx, object_uuid,
+                                    PNIO_DEVICE_INTERFACE_UUID, opnum,
+                                    fragment_length, pos);
+}
+
+/**
+ * @brief Build RPC header for a response.
+ *
+ * The response always uses DREP=LE.  Interface and activity UUIDs are
+ * echoed from the request; if the request was BE-encoded their first three
+ * fields are swapped so the peer decodes the same UUID values (p-net
+ * matches responses to its outgoing session by activity UUID).
+ *
+ * @param[out] buf              Output buffer
+ * @param[in]  object_uuid      AR UUID (BE storage)
+ * @param[in]  interface_uuid   Interface UUID from the request (wire format)
+ * @param[in]  activity_uuid    Activity UUID from the request (wire format)
+ * @param[in]  request_drep0    DREP byte 0 of the request
+ * @param[in]  sequence_number  Sequence number of the request
+ * @param[in]  opnum            Operation number of the request
+ * @param[in]  fragment_length  Length of data after header
+ *
+ * @note Thread safety: SAFE
+ * @note Memory: NO_ALLOC
+ */
+static void build_rpc_response_header(uint8_t *buf,
+                                       const uint8_t *object_uuid,
+                                       const uint8_t *interface_uuid,
+                                       const uint8_t *activity_uuid,
+                                       uint8_t request_drep0,
+                                       uint32_t sequence_number,
+                                       uint16_t opnum,
+                                       uint16_t fragment_length)
+{
+    profinet_rpc_header_t *hdr = (profinet_rpc_header_t *)buf;
+    memset(hdr, 0, sizeof(profinet_rpc_header_t));
+
+    hdr->version = RPC_VERSION_MAJOR;
+    hdr->packet_type = RPC_PACKET_TYPE_RESPONSE;
+    hdr->flags1 = RPC_FLAG1_LAST_FRAGMENT | RPC_FLAG1_IDEMPOTENT;
+    hdr->flags2 = 0;
+    hdr->drep[0] = RPC_DREP_LITTLE_ENDIAN;
+    hdr->drep[1] = RPC_DREP_ASCII;
+    hdr->drep[2] = 0;
+    hdr->serial_high = 0;
+
+    /* Object UUID (AR UUID) — swap to LE wire format */
+    memcpy(hdr->object_uuid, object_uuid, 16);
+    uuid_swap_fields(hdr->object_uuid);
+
+    memcpy(hdr->interface_uuid, interface_uuid, 16);
+    memcpy(hdr->activity_uuid, activity_uuid, 16);
+
+    if (request_drep0 != RPC_DREP_LITTLE_ENDIAN) {
+        /* Incoming was BE — swap to LE for our LE response */
+        uuid_swap_fields(hdr->interface_uuid);
+        uuid_swap_fields(hdr->activity_uuid);
+    }
+
+    /* All multi-byte header fields in LE (matching DREP=0x10) */
+    hdr->server_boot = 0;
+    hdr->interface_version = 1;
+    hdr->sequence_number = sequence_number;
+    hdr->opnum = opnum;
+    hdr->interface_hint = 0xFFFF;
+    hdr->activity_hint = 0xFFFF;
+    hdr->fragment_length = fragment_length;
+    hdr->fragment_number = 0;
+    hdr->auth_protocol = 0;
+    hdr->serial_low = 0;
+}
+
 /**
  * @brief Write block header to buffer.
  *
@@ -364,6 +446,36 @@ static void write_ndr_request_header(uint8_t *buf, size_t pos,
     buf[p++] = (uint8_t)(args_length >> 24);
 }
 
+/**
+ * @brief Write 20-byte NDR response header in little-endian format.
+ *
+ * Layout (all uint32 LE, matching response DREP=0x10):
+ *   PNIOStatus   — 0 on success (p-net v0.2.0 reads this as ArgsMaximum)
+ *   ArgsLength   — PNIO block payload length following this header
+ *   MaxCount     — NDR conformant array max (= ArgsLength)
+ *   Offset       — NDR array offset (always 0)
+ *   ActualCount  — NDR array actual count (= ArgsLength)
+ *
+ * @param[out] buf          Destination buffer
+ * @param[in]  pos          Byte offset where the header starts
+ * @param[in]  pnio_status  Packed PNIOStatus
+ * @param[in]  args_length  PNIO block payload length
+ */
+static void write_ndr_response_header(uint8_t *buf, size_t pos,
+                                       uint32_t pnio_status,
+                                       uint32_t args_length)
+{
+    uint32_t fields[5] = { pnio_status, args_length, args_length, 0, args_length };
+    size_t p = pos;
+
+    for (int i = 0; i < 5; i++) {
+        buf[p++] = (uint8_t)(fields[i]);
+        buf[p++] = (uint8_t)(fields[i] >> 8);
+        buf[p++] = (uint8_t)(fields[i] >> 16);
+        buf[p++] = (uint8_t)(fields[i] >> 24);
+    }
+}
+
 /**
  * @brief Detect whether an NDR header is present after the RPC header.
  *
@@ -1494,39 +1606,61 @@ wtc_result_t rpc_send_and_receive(rpc_context_t *ctx,
         LOG_INFO("RPC %s: sent %zd bytes OK", opnum_name, sent);
     }
 
-    /* Wait for response */
-    struct pollfd pfd;
-    pfd.fd = ctx->socket_fd;
-    pfd.events = POLLIN;
+    /*
+     * Wait for response.  Datagrams that were queued before connect()
+     * installed the peer filter (typically another device's
+     * ApplicationReady) are still delivered; skip incoming requests
+     * instead of taking them for the response.  The device repeats an
+     * unanswered ApplicationReady.
+     */
+    uint64_t deadline_ms = time_get_ms() + timeout_ms;
+    struct sockaddr_in recv_addr;
+    ssize_t received;
 
-    int poll_result = poll(&pfd, 1, (int)timeout_ms);
+    for (;;) {
+        uint64_t now_ms = time_get_ms();
+        int wait_ms = now_ms < deadline_ms ? (int)(deadline_ms - now_ms) : 0;
 
-    /* Log poll result with revents for debugging */
-    LOG_INFO("RPC %s POLL: result=%d, revents=0x%04X (POLLIN=%d, POLLERR=%d, POLLHUP=%d)",
-             opnum_name, poll_result, pfd.revents,
-             (pfd.revents & POLLIN) ? 1 : 0,
-             (pfd.revents & POLLERR) ? 1 : 0,
-             (pfd.revents & POLLHUP) ? 1 : 0);
+        struct pollfd pfd;
+        pfd.fd = ctx->socket_fd;
+        pfd.events = POLLIN;
 
-    if (poll_result < 0) {
-        LOG_ERROR("RPC poll failed: %s (errno=%d)", strerror(errno), errno);
-        return WTC_ERROR_IO;
-    }
-    if (poll_result == 0) {
-        LOG_WARN("RPC %s TIMEOUT after %u ms (no response received)", opnum_name, timeout_ms);
-        return WTC_ERROR_TIMEOUT;
-    }
+        int poll_result = poll(&pfd, 1, wait_ms);
 
-    /* Receive response */
-    struct sockaddr_in recv_addr;
-    socklen_t recv_addr_len = sizeof(recv_addr);
-    memset(&recv_addr, 0, sizeof(recv_addr));
+        /* Log poll result with revents for debugging */
+        LOG_INFO("RPC %s POLL: result=%d, revents=0x%04X (POLLIN=%d, POLLERR=%d, POLLHUP=%d)",
+                 opnum_name, poll_result, pfd.revents,
+                 (pfd.revents & POLLIN) ? 1 : 0,
+                 (pfd.revents & POLLERR) ? 1 : 0,
+                 (pfd.revents & POLLHUP) ? 1 : 0);
 
-    ssize_t received = recvfrom(ctx->socket_fd, response, *resp_len, 0,
-                                 (struct sockaddr *)&recv_addr, &recv_addr_len);
-    if (received < 0) {
-        LOG_ERROR("RPC receive failed: %s (errno=%d)", strerror(errno), errno);
-        return WTC_ERROR_IO;
+        if (poll_result < 0) {
+            LOG_ERROR("RPC poll failed: %s (errno=%d)", strerror(errno), errno);
+            return WTC_ERROR_IO;
+        }
+        if (poll_result == 0) {
+            LOG_WARN("RPC %s TIMEOUT after %u ms (no response received)", opnum_name, timeout_ms);
+            return WTC_ERROR_TIMEOUT;
+        }
+
+        /* Receive response */
+        socklen_t recv_addr_len = sizeof(recv_addr);
+        memset(&recv_addr, 0, sizeof(recv_addr));
+
+        received = recvfrom(ctx->socket_fd, response, *resp_len, 0,
+                            (struct sockaddr *)&recv_addr, &recv_addr_len);
+        if (received < 0) {
+            LOG_ERROR("RPC receive failed: %s (errno=%d)", strerror(errno), errno);
+            return WTC_ERROR_IO;
+        }
+
+        if ((size_t)received >= sizeof(profinet_rpc_header_t) &&
+            ((const profinet_rpc_header_t *)response)->packet_type == RPC_PACKET_TYPE_REQUEST) {
+            LOG_DEBUG("RPC %s: skipping queued request from %08X",
+                      opnum_name, ntohl(recv_addr.sin_addr.s_addr));
+            continue;
+        }
+        break;
     }
 
     /* Log response source for debugging */
@@ -1826,13 +1960,15 @@ wtc_result_t rpc_parse_incoming_control_request(const uint8_t *buffer,
         return WTC_ERROR_PROTOCOL;
     }
 
-    /* Check opnum — DREP-aware decode for ApplicationReady */
+    /* Check opnum — DREP-aware decode.  Control carries PrmEnd and
+     * ApplicationReady; Release (received by a device) has its own opnum. */
     uint16_t opnum = rpc_hdr_u16(hdr, hdr->opnum);
-    if (opnum != RPC_OPNUM_CONTROL) {
+    if (opnum != RPC_OPNUM_CONTROL && opnum != RPC_OPNUM_RELEASE) {
         LOG_DEBUG("Incoming RPC: unexpected opnum %u (expected CONTROL=%u)",
                   opnum, RPC_OPNUM_CONTROL);
         return WTC_ERROR_PROTOCOL;
     }
+    request->opnum = opnum;
 
     /* Save DREP for response UUID re-encoding */
     request->drep0 = hdr->drep[0];
@@ -1875,11 +2011,13 @@ wtc_result_t rpc_parse_incoming_control_request(const uint8_t *buffer,
      * CControl).  Per IEC 61158-6-10:
      *   - DControl (0x0110): Controller → Device (PrmEnd, Release)
      *   - CControl (0x0112): Device → Controller (ApplicationReady)
-     * ApplicationReady uses CControl (0x0112).
+     * ApplicationReady uses CControl (0x0112).  ReleaseBlockReq (0x0114)
+     * has the same layout and arrives with the Release opnum.
      */
     uint16_t block_type = read_u16_be(buffer, &pos);
     if (block_type != BLOCK_TYPE_IOD_CONTROL_REQ &&
-        block_type != BLOCK_TYPE_IOX_CONTROL_REQ) {
+        block_type != BLOCK_TYPE_IOX_CONTROL_REQ &&
+        block_type != BLOCK_TYPE_RELEASE_BLOCK_REQ) {
         LOG_ERROR("Incoming control request: unexpected block type 0x%04X "
                   "(expected 0x%04X or 0x%04X)",
                   block_type, BLOCK_TYPE_IOD_CONTROL_REQ,
@@ -1944,53 +2082,6 @@ wtc_result_t rpc_build_control_response(rpc_context_t *ctx,
         return WTC_ERROR_NO_MEMORY;
     }
 
-    /* Build RPC header for RESPONSE */
-    profinet_rpc_header_t *hdr = (profinet_rpc_header_t *)buffer;
-    memset(hdr, 0, sizeof(profinet_rpc_header_t));
-
-    hdr->version = RPC_VERSION_MAJOR;
-    hdr->packet_type = RPC_PACKET_TYPE_RESPONSE;
-    hdr->flags1 = RPC_FLAG1_LAST_FRAGMENT | RPC_FLAG1_IDEMPOTENT;
-    hdr->flags2 = 0;
-    hdr->drep[0] = RPC_DREP_LITTLE_ENDIAN;
-    hdr->drep[1] = RPC_DREP_ASCII;
-    hdr->drep[2] = 0;
-    hdr->serial_high = 0;
-
-    /* Object UUID (AR UUID) — swap to LE wire format */
-    memcpy(hdr->object_uuid, request->ar_uuid, 16);
-    uuid_swap_fields(hdr->object_uuid);
-
-    /*
-     * Interface UUID and Activity UUID — echo from incoming request.
-     *
-     * The raw bytes are in the incoming request's DREP encoding.  Our
-     * response uses DREP=LE (0x10).  If the incoming request used a
-     * different DREP (e.g. BE=0x00), we must swap UUID fields 1-3 so
-     * p-net parses the same UUID values when it reads our LE response.
-     *
-     * p-net matches the CControl response to the outgoing session by
-     * activity UUID.  A DREP mismatch causes "Unknown incoming activity
-     * UUID" and the response is silently dropped.
-     */
-    memcpy(hdr->interface_uuid, request->interface_uuid, 16);
-    memcpy(hdr->activity_uuid, request->activity_uuid, 16);
-
-    if (request->drep0 != RPC_DREP_LITTLE_ENDIAN) {
-        /* Incoming was BE — swap to LE for our LE response */
-        uuid_swap_fields(hdr->interface_uuid);
-        uuid_swap_fields(hdr->activity_uuid);
-    }
-
-    /* All multi-byte header fields in LE (matching DREP=0x10) */
-    hdr->server_boot = 0;
-    hdr->interface_version = 1;
-    hdr->sequence_number = request->sequence_number;
-
-    hdr->opnum = RPC_OPNUM_CONTROL;
-    hdr->interface_hint = 0xFFFF;
-    hdr->activity_hint = 0xFFFF;
-
     /*
      * NDR Response Header (20 bytes, all LE per DREP=0x10):
      *   ArgsMaximum(4) + ArgsLength(4) + MaxCount(4) + Offset(4) + ActualCount(4)
@@ -2009,11 +2100,21 @@ wtc_result_t rpc_build_control_response(rpc_context_t *ctx,
      * Determine response block type from request block type:
      *   IODControlReq (0x0110) → IODControlRes (0x8110) — DControl
      *   IOCControlReq (0x0112) → IOCControlRes (0x8112) — CControl
+     *   ReleaseBlockReq (0x0114) → ReleaseBlockRes (0x8114)
      * ApplicationReady from device uses CControl (0x0112/0x8112).
      */
-    uint16_t resp_block_type = (request->block_type == BLOCK_TYPE_IOX_CONTROL_REQ)
-                               ? BLOCK_TYPE_IOX_CONTROL_RES
-                               : BLOCK_TYPE_IOD_CONTROL_RES;
+    uint16_t resp_block_type;
+    switch (request->block_type) {
+    case BLOCK_TYPE_IOX_CONTROL_REQ:
+        resp_block_type = BLOCK_TYPE_IOX_CONTROL_RES;
+        break;
+    case BLOCK_TYPE_RELEASE_BLOCK_REQ:
+        resp_block_type = BLOCK_TYPE_RELEASE_BLOCK_RES;
+        break;
+    default:
+        resp_block_type = BLOCK_TYPE_IOD_CONTROL_RES;
+        break;
+    }
 
     /* Build Control Response block */
     size_t block_start = pos;
@@ -2032,35 +2133,18 @@ wtc_result_t rpc_build_control_response(rpc_context_t *ctx,
     size_t save_pos = block_start;
     write_block_header(buffer, resp_block_type, (uint16_t)block_len, &save_pos);
 
-    /* Fill NDR response header */
+    /* Fill NDR response header (PNIOStatus = 0) */
     uint32_t blocks_len = (uint32_t)(pos - blocks_start);
-    size_t p = ndr_pos;
-    /* ArgsMaximum = 0 (p-net reads PNIOStatus slot as ArgsMaximum, 4 bytes LE) */
-    buffer[p++] = 0; buffer[p++] = 0; buffer[p++] = 0; buffer[p++] = 0;
-    /* ArgsLength (4 bytes LE) */
-    buffer[p++] = (uint8_t)(blocks_len);
-    buffer[p++] = (uint8_t)(blocks_len >> 8);
-    buffer[p++] = (uint8_t)(blocks_len >> 16);
-    buffer[p++] = (uint8_t)(blocks_len >> 24);
-    /* MaxCount = blocks_len (4 bytes LE) */
-    buffer[p++] = (uint8_t)(blocks_len);
-    buffer[p++] = (uint8_t)(blocks_len >> 8);
-    buffer[p++] = (uint8_t)(blocks_len >> 16);
-    buffer[p++] = (uint8_t)(blocks_len >> 24);
-    /* Offset = 0 (4 bytes LE) */
-    buffer[p++] = 0; buffer[p++] = 0; buffer[p++] = 0; buffer[p++] = 0;
-    /* ActualCount = blocks_len (4 bytes LE) */
-    buffer[p++] = (uint8_t)(blocks_len);
-    buffer[p++] = (uint8_t)(blocks_len >> 8);
-    buffer[p++] = (uint8_t)(blocks_len >> 16);
-    buffer[p++] = (uint8_t)(blocks_len >> 24);
-
-    /* Update fragment length in RPC header (LE, matching DREP) */
+    write_ndr_response_header(buffer, ndr_pos, 0, blocks_len);
+
+    /* RPC header echoes the request's interface/activity UUID and opnum */
     uint16_t fragment_length = (uint16_t)(pos - sizeof(profinet_rpc_header_t));
-    hdr->fragment_length = fragment_length;
-    hdr->fragment_number = 0;
-    hdr->auth_protocol = 0;
-    hdr->serial_low = 0;
+    build_rpc_response_header(buffer, request->ar_uuid,
+                              request->interface_uuid,
+                              request->activity_uuid, request->drep0,
+                              request->sequence_number,
+                              request->opnum ? request->opnum : RPC_OPNUM_CONTROL,
+                              fragment_length);
 
     *buf_len = pos;
 
@@ -2425,3 +2509,507 @@ wtc_result_t rpc_read_record(rpc_context_t *ctx,
              response->index, response->module_count);
     return WTC_OK;
 }
+
+/* Record responses come back to the request's source port, so a socket
+ * per call keeps concurrent callers (config sync workers, user sync, the
+ * IPC thread) from receiving each other's responses, and keeps them off
+ * the AR manager's socket where devices send ApplicationReady. */
+wtc_result_t rpc_record_exchange(const char *interface_name,
+                                  uint32_t device_ip,
+                                  const uint8_t *request,
+                                  size_t req_len,
+                                  uint8_t *response,
+                                  size_t *resp_len,
+                                  uint32_t timeout_ms)
+{
+    if (!request || !response || !resp_len) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create record socket: %s", strerror(errno));
+        return WTC_ERROR_IO;
+    }
+
+    /* Same interface binding as the AR manager's RPC socket */
+    if (interface_name && interface_name[0] &&
+        setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, interface_name,
+                   strlen(interface_name) + 1) < 0) {
+        LOG_DEBUG("Record socket not bound to %s: %s", interface_name, strerror(errno));
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PNIO_RPC_PORT);
+    addr.sin_addr.s_addr = htonl(device_ip);
+
+    wtc_result_t res = WTC_OK;
+    if (sendto(fd, request, req_len, 0, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        LOG_ERROR("Failed to send RPC request: %s", strerror(errno));
+        res = WTC_ERROR_IO;
+    }
+
+    if (res == WTC_OK) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int poll_result = poll(&pfd, 1, (int)timeout_ms);
+        if (poll_result < 0) {
+            LOG_ERROR("Poll failed: %s", strerror(errno));
+            res = WTC_ERROR_IO;
+        } else if (poll_result == 0) {
+            LOG_WARN("RPC request timeout");
+            res = WTC_ERROR_TIMEOUT;
+        }
+    }
+
+    if (res == WTC_OK) {
+        ssize_t received = recv(fd, response, *resp_len, 0);
+        if (received < 0) {
+            LOG_ERROR("Failed to receive RPC response: %s", strerror(errno));
+            res = WTC_ERROR_IO;
+        } else {
+            *resp_len = (size_t)received;
+        }
+    }
+
+    close(fd);
+    return res;
+}
+
+/* ============== RPC Device Side (IO-device emulation) ============== */
+
+wtc_result_t rpc_peek_header(const uint8_t *buffer,
+                              size_t buf_len,
+                              uint8_t *packet_type,
+                              uint16_t *opnum)
+{
+    if (!buffer || !packet_type || !opnum) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    if (buf_len < sizeof(profinet_rpc_header_t)) {
+        return WTC_ERROR_PROTOCOL;
+    }
+
+    const profinet_rpc_header_t *hdr = (const profinet_rpc_header_t *)buffer;
+    if (hdr->version != RPC_VERSION_MAJOR) {
+        return WTC_ERROR_PROTOCOL;
+    }
+
+    *packet_type = hdr->packet_type;
+    *opnum = rpc_hdr_u16(hdr, hdr->opnum);
+    return WTC_OK;
+}
+
+/* Parse the IODataObjects/IOCS lists of one IOCR block (single API) */
+static wtc_result_t parse_iocr_api(const uint8_t *buffer, size_t *pos,
+                                    size_t block_end,
+                                    incoming_connect_request_t *request,
+                                    int iocr_idx)
+{
+    if (*pos + 2 > block_end) return WTC_ERROR_PROTOCOL;
+    uint16_t api_count = read_u16_be(buffer, pos);
+
+    for (int a = 0; a < api_count; a++) {
+        if (*pos + 6 > block_end) return WTC_ERROR_PROTOCOL;
+        *pos += 4;  /* API */
+
+        uint16_t iodata_count = read_u16_be(buffer, pos);
+        if (*pos + (size_t)iodata_count * 6 + 2 > block_end) {
+            return WTC_ERROR_PROTOCOL;
+        }
+        for (int j = 0; j < iodata_count; j++) {
+            int n = request->layout[iocr_idx].iodata_count;
+            uint16_t slot = read_u16_be(buffer, pos);
+            uint16_t subslot = read_u16_be(buffer, pos);
+            uint16_t offset = read_u16_be(buffer, pos);
+            if (n < WTC_MAX_SLOTS) {
+                request->layout[iocr_idx].iodata[n].slot = slot;
+                request->layout[iocr_idx].iodata[n].subslot = subslot;
+                request->layout[iocr_idx].iodata[n].frame_offset = offset;
+                request->layout[iocr_idx].iodata_count++;
+            }
+        }
+
+        uint16_t iocs_count = read_u16_be(buffer, pos);
+        if (*pos + (size_t)iocs_count * 6 > block_end) {
+            return WTC_ERROR_PROTOCOL;
+        }
+        for (int j = 0; j < iocs_count; j++) {
+            int n = request->layout[iocr_idx].iocs_count;
+            uint16_t slot = read_u16_be(buffer, pos);
+            uint16_t subslot = read_u16_be(buffer, pos);
+            uint16_t offset = read_u16_be(buffer, pos);
+            if (n < WTC_MAX_SLOTS) {
+                request->layout[iocr_idx].iocs[n].slot = slot;
+                request->layout[iocr_idx].iocs[n].subslot = subslot;
+                request->layout[iocr_idx].iocs[n].frame_offset = offset;
+                request->layout[iocr_idx].iocs_count++;
+            }
+        }
+    }
+
+    return WTC_OK;
+}
+
+/* Parse ExpectedSubmoduleBlockReq into params->expected_config[] */
+static wtc_result_t parse_expected_submodules(const uint8_t *buffer, size_t *pos,
+                                               size_t block_end,
+                                               connect_request_params_t *params)
+{
+    if (*pos + 2 > block_end) return WTC_ERROR_PROTOCOL;
+    uint16_t api_count = read_u16_be(buffer, pos);
+
+    for (int a = 0; a < api_count; a++) {
+        if (*pos + 14 > block_end) return WTC_ERROR_PROTOCOL;
+        *pos += 4;  /* API */
+        uint16_t slot = read_u16_be(buffer, pos);
+        uint32_t module_ident = read_u32_be(buffer, pos);
+        *pos += 2;  /* ModuleProperties */
+        uint16_t submodule_count = read_u16_be(buffer, pos);
+
+        for (int j = 0; j < submodule_count; j++) {
+            if (*pos + 8 > block_end) return WTC_ERROR_PROTOCOL;
+            uint16_t subslot = read_u16_be(buffer, pos);
+            uint32_t submodule_ident = read_u32_be(buffer, pos);
+            uint16_t props = read_u16_be(buffer, pos);
+
+            /* One DataDescription per direction: INPUT_OUTPUT (3) has two */
+            int desc_count = ((props & 0x0003) == 0x0003) ? 2 : 1;
+            if (*pos + (size_t)desc_count * 6 > block_end) {
+                return WTC_ERROR_PROTOCOL;
+            }
+            *pos += 2;  /* DataDirection */
+            uint16_t data_length = read_u16_be(buffer, pos);
+            *pos += 2;  /* LengthIOPS + LengthIOCS */
+            *pos += (size_t)(desc_count - 1) * 6;
+
+            if (params->expected_count < WTC_MAX_SLOTS) {
+                int n = params->expected_count++;
+                params->expected_config[n].slot = slot;
+                params->expected_config[n].subslot = subslot;
+                params->expected_config[n].module_ident = module_ident;
+                params->expected_config[n].submodule_ident = submodule_ident;
+                params->expected_config[n].data_length =
+                    ((props & 0x0003) == 0x0000) ? 0 : data_length;
+                params->expected_config[n].is_input = ((props & 0x0003) != 0x0002);
+            }
+        }
+    }
+
+    return WTC_OK;
+}
+
+wtc_result_t rpc_parse_connect_request(const uint8_t *buffer,
+                                        size_t buf_len,
+                                        incoming_connect_request_t *request)
+{
+    if (!buffer || !request || buf_len < sizeof(profinet_rpc_header_t)) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    memset(request, 0, sizeof(incoming_connect_request_t));
+
+    const profinet_rpc_header_t *hdr = (const profinet_rpc_header_t *)buffer;
+    if (hdr->packet_type != RPC_PACKET_TYPE_REQUEST ||
+        rpc_hdr_u16(hdr, hdr->opnum) != RPC_OPNUM_CONNECT) {
+        return WTC_ERROR_PROTOCOL;
+    }
+
+    request->drep0 = hdr->drep[0];
+    memcpy(request->activity_uuid, hdr->activity_uuid, 16);
+    memcpy(request->interface_uuid, hdr->interface_uuid, 16);
+    request->sequence_number = rpc_hdr_u32(hdr, hdr->sequence_number);
+
+    /* Ignore anything past the fragment (e.g. Ethernet padding) */
+    size_t pdu_end = sizeof(profinet_rpc_header_t) +
+                     rpc_hdr_u16(hdr, hdr->fragment_length);
+    if (pdu_end < buf_len) {
+        buf_len = pdu_end;
+    }
+
+    /* The NDR request header is present unless the PDU starts directly
+     * with the ARBlockReq. */
+    size_t pos = sizeof(profinet_rpc_header_t);
+    if (pos + 2 <= buf_len &&
+        ((buffer[pos] << 8) | buffer[pos + 1]) != BLOCK_TYPE_AR_BLOCK_REQ) {
+        pos += NDR_REQUEST_HEADER_SIZE;
+    }
+
+    connect_request_params_t *params = &request->params;
+    bool have_ar = false;
+
+    while (pos + 6 <= buf_len) {
+        size_t block_start = pos;
+        uint16_t block_type = read_u16_be(buffer, &pos);
+        uint16_t block_length = read_u16_be(buffer, &pos);
+        pos += 2;  /* Version */
+
+        if (block_length < 2 || block_start + 4 + block_length > buf_len) {
+            LOG_WARN("Connect request: bad length %u for block 0x%04X",
+                     block_length, block_type);
+            return WTC_ERROR_PROTOCOL;
+        }
+        size_t block_end = block_start + 4 + block_length;
+
+        switch (block_type) {
+        case BLOCK_TYPE_AR_BLOCK_REQ: {
+            if (pos + 62 > block_end) return WTC_ERROR_PROTOCOL;
+            params->ar_type = (ar_type_t)read_u16_be(buffer, &pos);
+            memcpy(params->ar_uuid, buffer + pos, 16);
+            pos += 16;
+            params->session_key = read_u16_be(buffer, &pos);
+            memcpy(params->controller_mac, buffer + pos, 6);
+            pos += 6;
+            memcpy(params->controller_uuid, buffer + pos, 16);
+            pos += 16;
+            params->ar_properties = read_u32_be(buffer, &pos);
+            params->activity_timeout = read_u16_be(buffer, &pos);
+            params->controller_port = read_u16_be(buffer, &pos);
+            uint16_t name_len = read_u16_be(buffer, &pos);
+            if (pos + name_len > block_end) return WTC_ERROR_PROTOCOL;
+            if (name_len >= sizeof(params->station_name)) {
+                name_len = sizeof(params->station_name) - 1;
+            }
+            memcpy(params->station_name, buffer + pos, name_len);
+            params->station_name[name_len] = '\0';
+            have_ar = true;
+            break;
+        }
+
+        case BLOCK_TYPE_IOCR_BLOCK_REQ: {
+            if (params->iocr_count >= 4) {
+                LOG_WARN("Connect request: more than 4 IOCRs, ignoring extra");
+                break;
+            }
+            if (pos + 38 > block_end) return WTC_ERROR_PROTOCOL;
+            int i = params->iocr_count++;
+            params->iocr[i].type = read_u16_be(buffer, &pos);
+            params->iocr[i].reference = read_u16_be(buffer, &pos);
+            pos += 2;  /* LT */
+            pos += 4;  /* IOCRProperties */
+            params->iocr[i].data_length = read_u16_be(buffer, &pos);
+            params->iocr[i].frame_id = read_u16_be(buffer, &pos);
+            params->iocr[i].send_clock_factor = read_u16_be(buffer, &pos);
+            params->iocr[i].reduction_ratio = read_u16_be(buffer, &pos);
+            pos += 2;  /* Phase */
+            pos += 2;  /* Sequence */
+            pos += 4;  /* FrameSendOffset */
+            params->iocr[i].watchdog_factor = read_u16_be(buffer, &pos);
+            params->data_hold_factor = read_u16_be(buffer, &pos);
+            pos += 2;  /* IOCRTagHeader */
+            pos += 6;  /* Multicast MAC */
+
+            wtc_result_t res = parse_iocr_api(buffer, &pos, block_end, request, i);
+            if (res != WTC_OK) return res;
+            break;
+        }
+
+        case BLOCK_TYPE_ALARM_CR_BLOCK_REQ:
+            if (pos + 18 > block_end) return WTC_ERROR_PROTOCOL;
+            pos += 2;  /* Alarm CR type */
+            pos += 2;  /* LT */
+            pos += 4;  /* Properties */
+            params->rta_timeout_factor = read_u16_be(buffer, &pos);
+            params->rta_retries = read_u16_be(buffer, &pos);
+            pos += 2;  /* Local alarm reference */
+            params->max_alarm_data_length = read_u16_be(buffer, &pos);
+            break;
+
+        case BLOCK_TYPE_EXPECTED_SUBMOD_BLOCK: {
+            wtc_result_t res = parse_expected_submodules(buffer, &pos,
+                                                         block_end, params);
+            if (res != WTC_OK) return res;
+            break;
+        }
+
+        default:
+            LOG_DEBUG("Connect request: skipping block 0x%04X", block_type);
+            break;
+        }
+
+        pos = block_end;
+    }
+
+    if (!have_ar) {
+        LOG_WARN("Connect request: no AR block");
+        return WTC_ERROR_PROTOCOL;
+    }
+
+    return WTC_OK;
+}
+
+wtc_result_t rpc_build_connect_response(const incoming_connect_request_t *request,
+                                         const connect_response_t *response,
+                                         uint8_t *buffer,
+                                         size_t *buf_len)
+{
+    if (!request || !response || !buffer || !buf_len) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    if (*buf_len < RPC_MAX_PDU_SIZE) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    const connect_request_params_t *params = &request->params;
+    size_t pos = sizeof(profinet_rpc_header_t);
+    size_t ndr_pos = pos;
+    pos += 20;  /* Reserve space for NDR response header */
+    size_t blocks_start = pos;
+    uint32_t pnio_status = 0;
+    size_t save_pos;
+
+    if (!response->success) {
+        pnio_status = ((uint32_t)response->error_code << 24) |
+                      ((uint32_t)response->error_decode << 16) |
+                      ((uint32_t)(response->error_code1 & 0xFF) << 8) |
+                      (uint32_t)(response->error_code2 & 0xFF);
+        goto finish;
+    }
+
+    /* ARBlockRes */
+    size_t block_start = pos;
+    pos += 6;
+    write_u16_be(buffer, (uint16_t)params->ar_type, &pos);
+    memcpy(buffer + pos, params->ar_uuid, 16);
+    pos += 16;
+    write_u16_be(buffer, params->session_key, &pos);
+    memcpy(buffer + pos, response->device_mac, 6);
+    pos += 6;
+    write_u16_be(buffer, response->device_port ? response->device_port : PNIO_RPC_PORT,
+                 &pos);
+    save_pos = block_start;
+    write_block_header(buffer, BLOCK_TYPE_AR_BLOCK_RES,
+                       (uint16_t)(pos - block_start - 4), &save_pos);
+
+    /* IOCRBlockRes, one per requested IOCR */
+    for (int i = 0; i < params->iocr_count; i++) {
+        block_start = pos;
+        pos += 6;
+        write_u16_be(buffer, params->iocr[i].type, &pos);
+        write_u16_be(buffer, params->iocr[i].reference, &pos);
+        write_u16_be(buffer, (i < response->frame_id_count)
+                             ? response->frame_ids[i].assigned
+                             : params->iocr[i].frame_id, &pos);
+        save_pos = block_start;
+        write_block_header(buffer, BLOCK_TYPE_IOCR_BLOCK_RES,
+                           (uint16_t)(pos - block_start - 4), &save_pos);
+    }
+
+    /* AlarmCRBlockRes */
+    block_start = pos;
+    pos += 6;
+    write_u16_be(buffer, 1, &pos);  /* Alarm CR type */
+    write_u16_be(buffer, response->device_alarm_ref, &pos);
+    write_u16_be(buffer, params->max_alarm_data_length, &pos);
+    save_pos = block_start;
+    write_block_header(buffer, BLOCK_TYPE_ALARM_CR_BLOCK_RES,
+                       (uint16_t)(pos - block_start - 4), &save_pos);
+
+    /* ModuleDiffBlock: one API, modules grouped by slot in list order.
+     * Module/submodule states are not tracked per entry; the block
+     * carries the device's real configuration. */
+    if (response->has_diff && response->discovered_count > 0) {
+        block_start = pos;
+        pos += 6;
+        write_u16_be(buffer, 1, &pos);  /* NumberOfAPIs */
+        write_u32_be(buffer, 0, &pos);  /* API */
+        size_t module_count_pos = pos;
+        pos += 2;
+
+        uint16_t module_count = 0;
+        int i = 0;
+        while (i < response->discovered_count) {
+            uint16_t slot = response->discovered_modules[i].slot;
+            int j = i;
+            while (j < response->discovered_count &&
+                   response->discovered_modules[j].slot == slot) {
+                j++;
+            }
+            if (pos + 10 + (size_t)(j - i) * 8 > RPC_MAX_PDU_SIZE) {
+                return WTC_ERROR_NO_MEMORY;
+            }
+
+            write_u16_be(buffer, slot, &pos);
+            write_u32_be(buffer, response->discovered_modules[i].module_ident, &pos);
+            write_u16_be(buffer, 0x0002, &pos);  /* ModuleState: proper module */
+            write_u16_be(buffer, (uint16_t)(j - i), &pos);
+            for (int k = i; k < j; k++) {
+                write_u16_be(buffer, response->discovered_modules[k].subslot, &pos);
+                write_u32_be(buffer, response->discovered_modules[k].submodule_ident, &pos);
+                write_u16_be(buffer, 0x0000, &pos);  /* SubmoduleState */
+            }
+            module_count++;
+            i = j;
+        }
+
+        save_pos = module_count_pos;
+        write_u16_be(buffer, module_count, &save_pos);
+        save_pos = block_start;
+        write_block_header(buffer, BLOCK_TYPE_MODULE_DIFF_BLOCK,
+                           (uint16_t)(pos - block_start - 4), &save_pos);
+    }
+
+finish:
+    write_ndr_response_header(buffer, ndr_pos, pnio_status,
+                              (uint32_t)(pos - blocks_start));
+    build_rpc_response_header(buffer, params->ar_uuid, request->interface_uuid,
+                              request->activity_uuid, request->drep0,
+                              request->sequence_number, RPC_OPNUM_CONNECT,
+                              (uint16_t)(pos - sizeof(profinet_rpc_header_t)));
+
+    *buf_len = pos;
+    LOG_DEBUG("Built Connect Response PDU: %zu bytes (status=0x%08X)",
+              pos, pnio_status);
+    return WTC_OK;
+}
+
+wtc_result_t rpc_build_app_ready_request(rpc_context_t *ctx,
+                                          const uint8_t *ar_uuid,
+                                          uint16_t session_key,
+                                          uint8_t *buffer,
+                                          size_t *buf_len)
+{
+    if (!ctx || !ar_uuid || !buffer || !buf_len) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    if (*buf_len < RPC_MAX_PDU_SIZE) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    size_t pos = sizeof(profinet_rpc_header_t);
+    size_t ndr_header_pos = pos;
+    pos += NDR_REQUEST_HEADER_SIZE;
+    size_t pnio_blocks_start = pos;
+
+    /* IOCControlReq — same layout as IODControlReq */
+    size_t block_start = pos;
+    pos += 6;
+    write_u16_be(buffer, 0, &pos);  /* Reserved */
+    memcpy(buffer + pos, ar_uuid, 16);
+    pos += 16;
+    write_u16_be(buffer, session_key, &pos);
+    write_u16_be(buffer, 0, &pos);  /* Reserved */
+    write_u16_be(buffer, CONTROL_CMD_APP_READY, &pos);
+    write_u16_be(buffer, 0, &pos);  /* Control block properties */
+
+    size_t save_pos = block_start;
+    write_block_header(buffer, BLOCK_TYPE_IOX_CONTROL_REQ,
+                       (uint16_t)(pos - block_start - 4), &save_pos);
+
+    uint32_t pnio_len = (uint32_t)(pos - pnio_blocks_start);
+    uint32_t args_max = (uint32_t)(RPC_MAX_PDU_SIZE - sizeof(profinet_rpc_header_t));
+    write_ndr_request_header(buffer, ndr_header_pos, args_max, pnio_len);
+
+    /* Addressed to the controller's interface, not the device's */
+    build_rpc_request_header(buffer, ctx, ar_uuid, PNIO_CONTROLLER_INTERFACE_UUID,
+                             RPC_OPNUM_CONTROL,
+                             (uint16_t)(pos - sizeof(profinet_rpc_header_t)),
+                             &save_pos);
+
+    *buf_len = pos;
+    return WTC_OK;
+}
@@ -581,6 +581,18 @@ wtc_result_t rpc_read_record(rpc_context_t *ctx,
                               const read_request_params_t *params,
                               read_response_t *response);
 
+/* Send one record read/write request from a private UDP socket and wait
+ * up to timeout_ms for the response. Each call gets its own source port,
+ * so concurrent callers never receive each other's responses.
+ * interface_name (may be empty) binds the socket like rpc_context_init. */
+wtc_result_t rpc_record_exchange(const char *interface_name,
+                                  uint32_t device_ip,
+                                  const uint8_t *request,
+                                  size_t req_len,
+                                  uint8_t *response,
+                                  size_t *resp_len,
+                                  uint32_t timeout_ms);
+
 /* ============== RPC Server (for incoming requests from device) ============== */
 
 /* Incoming Control Request info (parsed from device's ApplicationReady) */
@@ -593,7 +605,8 @@ typedef struct {
     uint8_t activity_uuid[16];  /* Activity UUID for response */
     uint32_t sequence_number;   /* Sequence number for response */
     uint8_t interface_uuid[16]; /* Interface UUID from RPC header (wire format) */
-    uint16_t block_type;        /* IODControlReq (0x0110) or IOCControlReq (0x0112) */
+    uint16_t block_type;        /* IODControlReq (0x0110), IOCControlReq (0x0112) or ReleaseReq (0x0114) */
+    uint16_t opnum;             /* RPC_OPNUM_CONTROL or RPC_OPNUM_RELEASE */
     uint8_t drep0;              /* DREP byte 0 from incoming request (0x10=LE, 0x00=BE) */
 } incoming_control_request_t;
 
@@ -662,6 +675,100 @@ wtc_result_t rpc_send_response(rpc_context_t *ctx,
                                 const uint8_t *response,
                                 size_t resp_len);
 
+/* ============== RPC Device Side (IO-device emulation) ============== */
+
+/* Connect Request as received by an IO device */
+typedef struct {
+    connect_request_params_t params;    /* AR, IOCRs and expected submodules */
+
+    /* Frame layout of each IOCR in params.iocr[] */
+    struct {
+        struct {
+            uint16_t slot;
+            uint16_t subslot;
+            uint16_t frame_offset;
+        } iodata[WTC_MAX_SLOTS], iocs[WTC_MAX_SLOTS];
+        int iodata_count;
+        int iocs_count;
+    } layout[4];
+
+    /* RPC header fields echoed in the response */
+    uint8_t activity_uuid[16];  /* Wire format */
+    uint8_t interface_uuid[16]; /* Wire format */
+    uint32_t sequence_number;
+    uint8_t drep0;
+} incoming_connect_request_t;
+
+/**
+ * @brief Get the opnum and packet type of a received RPC PDU.
+ *
+ * @param[in]  buffer       Received RPC packet
+ * @param[in]  buf_len      Length of received data
+ * @param[out] packet_type  RPC_PACKET_TYPE_*
+ * @param[out] opnum        Operation number (DREP-aware)
+ * @return WTC_OK, or WTC_ERROR_PROTOCOL if the PDU is not DCE/RPC
+ */
+wtc_result_t rpc_peek_header(const uint8_t *buffer,
+                              size_t buf_len,
+                              uint8_t *packet_type,
+                              uint16_t *opnum);
+
+/**
+ * @brief Parse Connect Request (device side).
+ *
+ * Inverse of rpc_build_connect_request(). The expected submodules are
+ * flattened into params.expected_config[] and the IODataObjects/IOCS
+ * entries of every IOCR into layout[].
+ *
+ * @param[in]  buffer    Received RPC packet
+ * @param[in]  buf_len   Length of received data
+ * @param[out] request   Parsed request
+ * @return WTC_OK on success, WTC_ERROR_PROTOCOL on malformed PDU
+ */
+wtc_result_t rpc_parse_connect_request(const uint8_t *buffer,
+                                        size_t buf_len,
+                                        incoming_connect_request_t *request);
+
+/**
+ * @brief Build Connect Response (device side).
+ *
+ * Inverse of rpc_parse_connect_response(). Uses response->device_mac,
+ * frame_ids[].assigned (one per request IOCR), device_alarm_ref and, when
+ * has_diff is set, discovered_modules[] as the ModuleDiffBlock. When
+ * success is false, only the PNIOStatus built from error_code,
+ * error_decode, error_code1 and error_code2 is returned.
+ *
+ * @param[in]     request   The Connect Request being answered
+ * @param[in]     response  Device's answer
+ * @param[out]    buffer    Output buffer
+ * @param[in,out] buf_len   Buffer size in, PDU length out
+ * @return WTC_OK on success, error code on failure
+ */
+wtc_result_t rpc_build_connect_response(const incoming_connect_request_t *request,
+                                         const connect_response_t *response,
+                                         uint8_t *buffer,
+                                         size_t *buf_len);
+
+/**
+ * @brief Build ApplicationReady request (device side).
+ *
+ * IOCControlReq (0x0112) addressed to the controller interface, as sent
+ * by a device once its parameterization is complete. Uses the activity
+ * UUID and sequence number in ctx.
+ *
+ * @param[in]     ctx          RPC context of the device
+ * @param[in]     ar_uuid      AR UUID from the Connect Request
+ * @param[in]     session_key  Session key from the Connect Request
+ * @param[out]    buffer       Output buffer
+ * @param[in,out] buf_len      Buffer size in, PDU length out
+ * @return WTC_OK on success, error code on failure
+ */
+wtc_result_t rpc_build_app_ready_request(rpc_context_t *ctx,
+                                          const uint8_t *ar_uuid,
+                                          uint16_t session_key,
+                                          uint8_t *buffer,
+                                          size_t *buf_len);
+
 #ifdef __cplusplus
 }
 #endif
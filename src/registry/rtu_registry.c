@@ -7,6 +7,7 @@
 #include "rtu_registry.h"
 #include "utils/logger.h"
 #include "utils/time_utils.h"
+#include "utils/pool.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -20,6 +21,18 @@ struct rtu_registry {
     pthread_mutex_t lock;
 };
 
+/* Device structs of get_device copies; their arrays come from the heap */
+#define DEVICE_COPY_POOL_SIZE 64
+static object_pool_t *g_copy_pool;
+static pthread_once_t g_copy_pool_once = PTHREAD_ONCE_INIT;
+
+static void copy_pool_create(void) {
+    if (pool_init(&g_copy_pool, "rtu_device", sizeof(rtu_device_t),
+                  DEVICE_COPY_POOL_SIZE) != WTC_OK) {
+        g_copy_pool = NULL;
+    }
+}
+
 /* Public functions */
 
 wtc_result_t rtu_registry_init(rtu_registry_t **registry,
@@ -239,19 +252,20 @@ static rtu_device_t *find_device_locked(rtu_registry_t *registry,
     return NULL;
 }
 
+/* Zeroed array from the arena, or from the heap without one */
+static void *copy_alloc(arena_t *arena, size_t count, size_t size) {
+    return arena ? arena_calloc(arena, count, size) : calloc(count, size);
+}
+
 /*
- * Deep-copy a single device (caller frees with rtu_registry_free_device_copy).
+ * Copy a device into dst, deep-copying its dynamic arrays.
  * Must be called while registry lock is held.
  */
-static rtu_device_t *deep_copy_device(const rtu_device_t *src) {
-    rtu_device_t *dst = calloc(1, sizeof(rtu_device_t));
-    if (!dst) return NULL;
-
+static void copy_device(rtu_device_t *dst, const rtu_device_t *src, arena_t *arena) {
     memcpy(dst, src, sizeof(rtu_device_t));
 
-    /* Deep copy dynamic arrays */
     if (src->slots && src->slot_capacity > 0) {
-        dst->slots = calloc(src->slot_capacity, sizeof(slot_config_t));
+        dst->slots = copy_alloc(arena, src->slot_capacity, sizeof(slot_config_t));
         if (dst->slots) {
             memcpy(dst->slots, src->slots, src->slot_count * sizeof(slot_config_t));
         } else {
@@ -263,7 +277,7 @@ static rtu_device_t *deep_copy_device(const rtu_device_t *src) {
     }
 
     if (src->sensors && src->sensor_capacity > 0) {
-        dst->sensors = calloc(src->sensor_capacity, sizeof(sensor_data_t));
+        dst->sensors = copy_alloc(arena, src->sensor_capacity, sizeof(sensor_data_t));
         if (dst->sensors) {
             memcpy(dst->sensors, src->sensors,
                    src->sensor_capacity * sizeof(sensor_data_t));
@@ -275,7 +289,7 @@ static rtu_device_t *deep_copy_device(const rtu_device_t *src) {
     }
 
     if (src->actuators && src->actuator_capacity > 0) {
-        dst->actuators = calloc(src->actuator_capacity, sizeof(actuator_state_t));
+        dst->actuators = copy_alloc(arena, src->actuator_capacity, sizeof(actuator_state_t));
         if (dst->actuators) {
             memcpy(dst->actuators, src->actuators,
                    src->actuator_capacity * sizeof(actuator_state_t));
@@ -285,7 +299,19 @@ static rtu_device_t *deep_copy_device(const rtu_device_t *src) {
     } else {
         dst->actuators = NULL;
     }
+}
 
+/*
+ * Deep-copy a single device (caller frees with rtu_registry_free_device_copy).
+ * Must be called while registry lock is held.
+ */
+static rtu_device_t *deep_copy_device(const rtu_device_t *src) {
+    pthread_once(&g_copy_pool_once, copy_pool_create);
+
+    rtu_device_t *dst = g_copy_pool ? pool_alloc(g_copy_pool) : calloc(1, sizeof(rtu_device_t));
+    if (!dst) return NULL;
+
+    copy_device(dst, src, NULL);
     return dst;
 }
 
@@ -351,48 +377,7 @@ wtc_result_t rtu_registry_list_devices(rtu_registry_t *registry,
 
     /* REG-C4 fix: Deep copy device data including dynamic arrays */
     for (int i = 0; i < copy_count; i++) {
-        rtu_device_t *src = registry->devices[i];
-        rtu_device_t *dst = &(*devices)[i];
-
-        /* Copy base struct */
-        memcpy(dst, src, sizeof(rtu_device_t));
-
-        /* Deep copy slots array */
-        if (src->slots && src->slot_capacity > 0) {
-            dst->slots = calloc(src->slot_capacity, sizeof(slot_config_t));
-            if (dst->slots) {
-                memcpy(dst->slots, src->slots, src->slot_count * sizeof(slot_config_t));
-            } else {
-                dst->slot_capacity = 0;
-                dst->slot_count = 0;
-            }
-        } else {
-            dst->slots = NULL;
-        }
-
-        /* Deep copy sensors array */
-        if (src->sensors && src->sensor_capacity > 0) {
-            dst->sensors = calloc(src->sensor_capacity, sizeof(sensor_data_t));
-            if (dst->sensors) {
-                memcpy(dst->sensors, src->sensors, src->sensor_capacity * sizeof(sensor_data_t));
-            } else {
-                dst->sensor_capacity = 0;
-            }
-        } else {
-            dst->sensors = NULL;
-        }
-
-        /* Deep copy actuators array */
-        if (src->actuators && src->actuator_capacity > 0) {
-            dst->actuators = calloc(src->actuator_capacity, sizeof(actuator_state_t));
-            if (dst->actuators) {
-                memcpy(dst->actuators, src->actuators, src->actuator_capacity * sizeof(actuator_state_t));
-            } else {
-                dst->actuator_capacity = 0;
-            }
-        } else {
-            dst->actuators = NULL;
-        }
+        copy_device(&(*devices)[i], registry->devices[i], NULL);
     }
     *count = copy_count;
 
@@ -418,7 +403,62 @@ void rtu_registry_free_device_copy(rtu_device_t *device) {
     free(device->slots);
     free(device->sensors);
     free(device->actuators);
-    free(device);
+    if (g_copy_pool) {
+        pool_free(g_copy_pool, device);
+    } else {
+        free(device);
+    }
+}
+
+rtu_device_t *rtu_registry_get_device_arena(rtu_registry_t *registry,
+                                             const char *station_name,
+                                             arena_t *arena) {
+    if (!registry || !station_name || !arena) return NULL;
+
+    pthread_mutex_lock(&registry->lock);
+
+    rtu_device_t *src = find_device_locked(registry, station_name);
+    rtu_device_t *copy = src ? arena_alloc(arena, sizeof(rtu_device_t)) : NULL;
+    if (copy) {
+        copy_device(copy, src, arena);
+    }
+
+    pthread_mutex_unlock(&registry->lock);
+    return copy;
+}
+
+wtc_result_t rtu_registry_list_devices_arena(rtu_registry_t *registry,
+                                              arena_t *arena,
+                                              rtu_device_t **devices,
+                                              int *count,
+                                              int max_count) {
+    if (!registry || !arena || !devices || !count) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&registry->lock);
+
+    int copy_count = registry->device_count;
+    if (copy_count > max_count) {
+        copy_count = max_count;
+    }
+
+    *devices = NULL;
+    *count = 0;
+    if (copy_count > 0) {
+        *devices = arena_alloc(arena, copy_count * sizeof(rtu_device_t));
+        if (!*devices) {
+            pthread_mutex_unlock(&registry->lock);
+            return WTC_ERROR_NO_MEMORY;
+        }
+        for (int i = 0; i < copy_count; i++) {
+            copy_device(&(*devices)[i], registry->devices[i], arena);
+        }
+        *count = copy_count;
+    }
+
+    pthread_mutex_unlock(&registry->lock);
+    return WTC_OK;
 }
 
 int rtu_registry_get_device_count(rtu_registry_t *registry) {
@@ -533,6 +573,17 @@ wtc_result_t rtu_registry_update_sensor(rtu_registry_t *registry,
                                          float value,
                                          iops_t status,
                                          data_quality_t quality) {
+    return rtu_registry_update_sensor_at(registry, station_name, slot, value,
+                                         status, quality, time_get_monotonic_us());
+}
+
+wtc_result_t rtu_registry_update_sensor_at(rtu_registry_t *registry,
+                                            const char *station_name,
+                                            int slot,
+                                            float value,
+                                            iops_t status,
+                                            data_quality_t quality,
+                                            uint64_t rx_time_us) {
     if (!registry || !station_name || slot < 0) {
         return WTC_ERROR_INVALID_PARAM;
     }
@@ -554,6 +605,7 @@ wtc_result_t rtu_registry_update_sensor(rtu_registry_t *registry,
     device->sensors[slot].status = status;
     device->sensors[slot].quality = quality;
     device->sensors[slot].timestamp_ms = time_get_ms();
+    device->sensors[slot].rx_time_us = rx_time_us;
     device->sensors[slot].stale = false;
 
     pthread_mutex_unlock(&registry->lock);
@@ -561,10 +613,61 @@ wtc_result_t rtu_registry_update_sensor(rtu_registry_t *registry,
     return WTC_OK;
 }
 
+wtc_result_t rtu_registry_update_sensors(rtu_registry_t *registry,
+                                          const char *station_name,
+                                          const int *slots,
+                                          const float *values,
+                                          const data_quality_t *quality,
+                                          int count,
+                                          iops_t status) {
+    if (!registry || !station_name || !slots || !values || !quality || count < 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    uint64_t now = time_get_ms();
+    uint64_t now_us = time_get_monotonic_us();
+    bool skipped = false;
+
+    pthread_mutex_lock(&registry->lock);
+
+    rtu_device_t *device = find_device_locked(registry, station_name);
+    if (!device) {
+        pthread_mutex_unlock(&registry->lock);
+        return WTC_ERROR_NOT_FOUND;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int slot = slots[i];
+        if (slot < 0 || slot >= device->sensor_capacity) {
+            skipped = true;
+            continue;
+        }
+        device->sensors[slot].value = values[i];
+        device->sensors[slot].status = status;
+        device->sensors[slot].quality = quality[i];
+        device->sensors[slot].timestamp_ms = now;
+        device->sensors[slot].rx_time_us = now_us;
+        device->sensors[slot].stale = false;
+    }
+
+    pthread_mutex_unlock(&registry->lock);
+
+    return skipped ? WTC_ERROR_INVALID_PARAM : WTC_OK;
+}
+
 wtc_result_t rtu_registry_update_actuator(rtu_registry_t *registry,
                                            const char *station_name,
                                            int slot,
                                            const actuator_output_t *output) {
+    return rtu_registry_update_actuator_traced(registry, station_name, slot, output, 0, 0);
+}
+
+wtc_result_t rtu_registry_update_actuator_traced(rtu_registry_t *registry,
+                                                  const char *station_name,
+                                                  int slot,
+                                                  const actuator_output_t *output,
+                                                  uint64_t source_time_us,
+                                                  uint32_t trace_id) {
     if (!registry || !station_name || !output || slot < 0) {
         return WTC_ERROR_INVALID_PARAM;
     }
@@ -582,11 +685,25 @@ wtc_result_t rtu_registry_update_actuator(rtu_registry_t *registry,
         return WTC_ERROR_INVALID_PARAM;
     }
 
-    memcpy(&device->actuators[slot].output, output, sizeof(actuator_output_t));
-    device->actuators[slot].last_change_ms = time_get_ms();
+    actuator_state_t *actuator = &device->actuators[slot];
+    memcpy(&actuator->output, output, sizeof(actuator_output_t));
+    actuator->last_change_ms = time_get_ms();
+    if (trace_id != 0) {
+        actuator->source_time_us = source_time_us;
+        actuator->output_time_us = time_get_monotonic_us();
+        actuator->trace_id = trace_id;
+    }
+
+    actuator_state_t state = *actuator;
 
     pthread_mutex_unlock(&registry->lock);
 
+    /* Invoke callback outside lock to avoid deadlocks */
+    if (registry->config.on_actuator_updated) {
+        registry->config.on_actuator_updated(station_name, slot, &state,
+                                             registry->config.callback_ctx);
+    }
+
     return WTC_OK;
 }
 
@@ -624,6 +741,44 @@ wtc_result_t rtu_registry_get_sensor(rtu_registry_t *registry,
     return WTC_OK;
 }
 
+wtc_result_t rtu_registry_get_sensors(rtu_registry_t *registry,
+                                       const char *station_name,
+                                       const int *slots,
+                                       int count,
+                                       sensor_data_t *data,
+                                       bool *found) {
+    if (!registry || !station_name || !slots || !data || !found || count < 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&registry->lock);
+
+    rtu_device_t *device = find_device_locked(registry, station_name);
+    if (!device) {
+        pthread_mutex_unlock(&registry->lock);
+        return WTC_ERROR_NOT_FOUND;
+    }
+
+    for (int i = 0; i < count; i++) {
+        found[i] = slots[i] >= 0 && slots[i] < device->sensor_capacity;
+        if (found[i]) {
+            memcpy(&data[i], &device->sensors[slots[i]], sizeof(sensor_data_t));
+        }
+    }
+
+    pthread_mutex_unlock(&registry->lock);
+
+    /* Check staleness (safe on the copies) */
+    uint64_t now = time_get_ms();
+    for (int i = 0; i < count; i++) {
+        if (found[i] && now - data[i].timestamp_ms > 5000) {
+            data[i].stale = true;
+        }
+    }
+
+    return WTC_OK;
+}
+
 wtc_result_t rtu_registry_get_actuator(rtu_registry_t *registry,
                                         const char *station_name,
                                         int slot,
@@ -8,6 +8,7 @@
 #define WTC_RTU_REGISTRY_H
 
 #include "types.h"
+#include "utils/arena.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,6 +29,10 @@ typedef struct {
                                     profinet_state_t old_state,
                                     profinet_state_t new_state,
                                     void *ctx);
+    /* Called outside the lock after every actuator update, e.g. to copy
+     * the output into the PROFINET output image */
+    void (*on_actuator_updated)(const char *station_name, int slot,
+                                const actuator_state_t *state, void *ctx);
     void *callback_ctx;
 } registry_config_t;
 
@@ -76,6 +81,19 @@ wtc_result_t rtu_registry_list_devices(rtu_registry_t *registry,
 /* Free device list returned by rtu_registry_list_devices */
 void rtu_registry_free_device_list(rtu_device_t *devices, int count);
 
+/* Arena variants of get_device and list_devices: the copies and their
+ * arrays are allocated from the arena and released by arena_reset().
+ * Never pass them to the free functions above. */
+rtu_device_t *rtu_registry_get_device_arena(rtu_registry_t *registry,
+                                             const char *station_name,
+                                             arena_t *arena);
+
+wtc_result_t rtu_registry_list_devices_arena(rtu_registry_t *registry,
+                                              arena_t *arena,
+                                              rtu_device_t **devices,
+                                              int *count,
+                                              int max_count);
+
 /* Get device count */
 int rtu_registry_get_device_count(rtu_registry_t *registry);
 
@@ -100,18 +118,61 @@ wtc_result_t rtu_registry_update_sensor(rtu_registry_t *registry,
                                          iops_t status,
                                          data_quality_t quality);
 
+/* Update sensor data, stamped with the monotonic time its frame was
+ * received (time_get_monotonic_us) for latency tracing. The other update
+ * functions stamp the time of the call. */
+wtc_result_t rtu_registry_update_sensor_at(rtu_registry_t *registry,
+                                            const char *station_name,
+                                            int slot,
+                                            float value,
+                                            iops_t status,
+                                            data_quality_t quality,
+                                            uint64_t rx_time_us);
+
+/* Update several sensors of one device under a single registry lock,
+ * all with the same IOPS and timestamp. Slots the device does not have
+ * are skipped; returns WTC_ERROR_INVALID_PARAM if any were. */
+wtc_result_t rtu_registry_update_sensors(rtu_registry_t *registry,
+                                          const char *station_name,
+                                          const int *slots,
+                                          const float *values,
+                                          const data_quality_t *quality,
+                                          int count,
+                                          iops_t status);
+
 /* Update actuator state */
 wtc_result_t rtu_registry_update_actuator(rtu_registry_t *registry,
                                            const char *station_name,
                                            int slot,
                                            const actuator_output_t *output);
 
+/* Update actuator state on behalf of a traced control loop: source_time_us
+ * is the rx_time_us of the input the output was computed from and
+ * trace_id the loop's LATENCY_TRACE_ID. Untraced updates (trace_id 0)
+ * leave the trace fields of the last traced one in place, so a reader
+ * closes each trace once per source_time_us. */
+wtc_result_t rtu_registry_update_actuator_traced(rtu_registry_t *registry,
+                                                  const char *station_name,
+                                                  int slot,
+                                                  const actuator_output_t *output,
+                                                  uint64_t source_time_us,
+                                                  uint32_t trace_id);
+
 /* Get sensor data */
 wtc_result_t rtu_registry_get_sensor(rtu_registry_t *registry,
                                       const char *station_name,
                                       int slot,
                                       sensor_data_t *data);
 
+/* Get several sensors of one device under a single registry lock.
+ * found[i] is false for slots the device does not have. */
+wtc_result_t rtu_registry_get_sensors(rtu_registry_t *registry,
+                                       const char *station_name,
+                                       const int *slots,
+                                       int count,
+                                       sensor_data_t *data,
+                                       bool *found);
+
 /* Get actuator state */
 wtc_result_t rtu_registry_get_actuator(rtu_registry_t *registry,
                                         const char *station_name,
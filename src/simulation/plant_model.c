@@ -0,0 +1,613 @@
+/*
+ * Water Treatment Controller - Simulated Process Plant Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "plant_model.h"
+#include "../utils/logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Pumps lose suction below this fraction of the tank height */
+#define PUMP_SUCTION_CUTOFF     0.02f
+
+/* Unit directory entry */
+typedef struct {
+    char name[32];
+    plant_unit_kind_t kind;
+    int index;                  /* Into the arrays of that kind */
+} plant_unit_t;
+
+/*
+ * States are kept as one array per quantity so each solver pass walks
+ * every unit of a kind in a single loop.
+ */
+struct plant_model {
+    float step_s;
+    double time_s;
+    double pending_s;           /* Simulated time not yet integrated */
+
+    plant_unit_t units[PLANT_MAX_UNITS];
+    int unit_count;
+
+    /* Tanks */
+    int tank_count;
+    float tank_area[PLANT_MAX_TANKS];
+    float tank_height[PLANT_MAX_TANKS];
+    float tank_decay[PLANT_MAX_TANKS];
+    double tank_volume[PLANT_MAX_TANKS];    /* m^3 */
+    double tank_mass[PLANT_MAX_TANKS];      /* g of species */
+    double tank_dv[PLANT_MAX_TANKS];        /* Per-step accumulators */
+    double tank_dm[PLANT_MAX_TANKS];
+
+    /* Pumps and valves */
+    int flow_count;
+    plant_flow_type_t flow_type[PLANT_MAX_FLOWS];
+    int flow_from[PLANT_MAX_FLOWS];         /* Tank index or PLANT_BOUNDARY */
+    int flow_to[PLANT_MAX_FLOWS];
+    float flow_max[PLANT_MAX_FLOWS];
+    float flow_alpha[PLANT_MAX_FLOWS];
+    float flow_source_conc[PLANT_MAX_FLOWS];
+    float flow_input[PLANT_MAX_FLOWS];
+    float flow_pos[PLANT_MAX_FLOWS];        /* Speed or opening actually reached */
+    float flow_q[PLANT_MAX_FLOWS];          /* m^3/s */
+
+    /* Dosing pumps */
+    int doser_count;
+    int doser_tank[PLANT_MAX_DOSERS];
+    float doser_max[PLANT_MAX_DOSERS];
+    float doser_conc[PLANT_MAX_DOSERS];
+    float doser_alpha[PLANT_MAX_DOSERS];
+    float doser_input[PLANT_MAX_DOSERS];
+    float doser_pos[PLANT_MAX_DOSERS];
+    float doser_q[PLANT_MAX_DOSERS];
+
+    /* Sensors */
+    int sensor_count;
+    int sensor_unit[PLANT_MAX_SENSORS];
+    plant_variable_t sensor_var[PLANT_MAX_SENSORS];
+    float sensor_gain[PLANT_MAX_SENSORS];
+    float sensor_offset[PLANT_MAX_SENSORS];
+    float sensor_alpha[PLANT_MAX_SENSORS];
+    float sensor_out[PLANT_MAX_SENSORS];
+    float *sensor_delay[PLANT_MAX_SENSORS]; /* Dead-time line, NULL if none */
+    int sensor_delay_len[PLANT_MAX_SENSORS];
+    int sensor_delay_pos[PLANT_MAX_SENSORS];
+};
+
+/* Per-step smoothing factor of a first-order lag */
+static float lag_alpha(float tau_s, float step_s) {
+    if (tau_s <= 0.0f) return 1.0f;
+    return 1.0f - expf(-step_s / tau_s);
+}
+
+static float clamp_unit(float value) {
+    if (value < 0.0f) return 0.0f;
+    if (value > 1.0f) return 1.0f;
+    return value;
+}
+
+static double tank_conc(const plant_model_t *model, int t) {
+    return model->tank_volume[t] > 1e-6 ? model->tank_mass[t] / model->tank_volume[t] : 0.0;
+}
+
+static float flow_rate(const plant_model_t *model, int f) {
+    float q = model->flow_max[f] * model->flow_pos[f];
+    int from = model->flow_from[f];
+    if (from == PLANT_BOUNDARY) return q;
+
+    float fill = (float)(model->tank_volume[from] /
+                         (model->tank_area[from] * model->tank_height[from]));
+    if (fill <= 0.0f) return 0.0f;
+
+    if (model->flow_type[f] == PLANT_FLOW_VALVE) {
+        return q * sqrtf(fill > 1.0f ? 1.0f : fill);
+    }
+    return fill < PUMP_SUCTION_CUTOFF ? q * fill / PUMP_SUCTION_CUTOFF : q;
+}
+
+/* Look up a unit id, optionally requiring a kind; returns the array index */
+static int unit_index(const plant_model_t *model, int unit, int kind) {
+    if (unit < 0 || unit >= model->unit_count) return -1;
+    if (kind >= 0 && model->units[unit].kind != (plant_unit_kind_t)kind) return -1;
+    return model->units[unit].index;
+}
+
+static bool read_variable(const plant_model_t *model, int unit,
+                          plant_variable_t variable, double *value) {
+    const plant_unit_t *u = &model->units[unit];
+    int i = u->index;
+
+    switch (u->kind) {
+    case PLANT_UNIT_TANK:
+        switch (variable) {
+        case PLANT_VAR_LEVEL:
+            *value = model->tank_volume[i] / model->tank_area[i];
+            return true;
+        case PLANT_VAR_LEVEL_PCT:
+            *value = 100.0 * model->tank_volume[i] /
+                     (model->tank_area[i] * model->tank_height[i]);
+            return true;
+        case PLANT_VAR_VOLUME:
+            *value = model->tank_volume[i];
+            return true;
+        case PLANT_VAR_CONCENTRATION:
+            *value = tank_conc(model, i);
+            return true;
+        default:
+            return false;
+        }
+    case PLANT_UNIT_FLOW:
+        if (variable != PLANT_VAR_FLOW) return false;
+        *value = model->flow_q[i];
+        return true;
+    case PLANT_UNIT_DOSING:
+        if (variable != PLANT_VAR_FLOW) return false;
+        *value = model->doser_q[i];
+        return true;
+    default:
+        return false;
+    }
+}
+
+static wtc_result_t add_unit(plant_model_t *model, const char *name,
+                             plant_unit_kind_t kind, int index, int *unit) {
+    if (model->unit_count >= PLANT_MAX_UNITS) return WTC_ERROR_FULL;
+
+    plant_unit_t *u = &model->units[model->unit_count];
+    snprintf(u->name, sizeof(u->name), "%s", name);
+    u->kind = kind;
+    u->index = index;
+
+    if (unit) *unit = model->unit_count;
+    model->unit_count++;
+    return WTC_OK;
+}
+
+/* One fixed step for the whole flowsheet */
+static void plant_step(plant_model_t *model) {
+    const float dt = model->step_s;
+
+    /* Actuators follow their inputs */
+    for (int f = 0; f < model->flow_count; f++) {
+        model->flow_pos[f] += (model->flow_input[f] - model->flow_pos[f]) * model->flow_alpha[f];
+    }
+    for (int d = 0; d < model->doser_count; d++) {
+        model->doser_pos[d] += (model->doser_input[d] - model->doser_pos[d]) * model->doser_alpha[d];
+    }
+
+    /* Flows from the start-of-step levels */
+    for (int f = 0; f < model->flow_count; f++) {
+        model->flow_q[f] = flow_rate(model, f);
+    }
+    for (int d = 0; d < model->doser_count; d++) {
+        model->doser_q[d] = model->doser_max[d] * model->doser_pos[d];
+    }
+
+    /* Volume and species balances */
+    for (int t = 0; t < model->tank_count; t++) {
+        model->tank_dv[t] = 0.0;
+        model->tank_dm[t] = -model->tank_decay[t] * model->tank_mass[t];
+    }
+    for (int f = 0; f < model->flow_count; f++) {
+        double q = model->flow_q[f];
+        int from = model->flow_from[f];
+        int to = model->flow_to[f];
+        double conc = model->flow_source_conc[f];
+
+        if (from != PLANT_BOUNDARY) {
+            conc = tank_conc(model, from);
+            model->tank_dv[from] -= q;
+            model->tank_dm[from] -= q * conc;
+        }
+        if (to != PLANT_BOUNDARY) {
+            model->tank_dv[to] += q;
+            model->tank_dm[to] += q * conc;
+        }
+    }
+    for (int d = 0; d < model->doser_count; d++) {
+        int t = model->doser_tank[d];
+        model->tank_dv[t] += model->doser_q[d];
+        model->tank_dm[t] += model->doser_q[d] * model->doser_conc[d];
+    }
+
+    for (int t = 0; t < model->tank_count; t++) {
+        double capacity = (double)model->tank_area[t] * model->tank_height[t];
+        double volume = model->tank_volume[t] + model->tank_dv[t] * dt;
+        double mass = model->tank_mass[t] + model->tank_dm[t] * dt;
+
+        if (volume <= 0.0) {
+            volume = 0.0;
+            mass = 0.0;
+        } else if (volume > capacity) {
+            /* Overflow spills mixed contents */
+            mass *= capacity / volume;
+            volume = capacity;
+        }
+        model->tank_volume[t] = volume;
+        model->tank_mass[t] = mass > 0.0 ? mass : 0.0;
+    }
+
+    /* Sensors: dead time, then first-order lag */
+    for (int s = 0; s < model->sensor_count; s++) {
+        double pv = 0.0;
+        read_variable(model, model->sensor_unit[s], model->sensor_var[s], &pv);
+        float raw = model->sensor_gain[s] * (float)pv + model->sensor_offset[s];
+
+        float *line = model->sensor_delay[s];
+        if (line) {
+            int pos = model->sensor_delay_pos[s];
+            float delayed = line[pos];
+            line[pos] = raw;
+            model->sensor_delay_pos[s] = (pos + 1) % model->sensor_delay_len[s];
+            raw = delayed;
+        }
+        model->sensor_out[s] += (raw - model->sensor_out[s]) * model->sensor_alpha[s];
+    }
+}
+
+wtc_result_t plant_model_create(plant_model_t **model, float step_s) {
+    if (!model || step_s < 0.0f) return WTC_ERROR_INVALID_PARAM;
+
+    plant_model_t *m = calloc(1, sizeof(plant_model_t));
+    if (!m) return WTC_ERROR_NO_MEMORY;
+
+    m->step_s = step_s > 0.0f ? step_s : PLANT_DEFAULT_STEP_S;
+    *model = m;
+    return WTC_OK;
+}
+
+void plant_model_destroy(plant_model_t *model) {
+    if (!model) return;
+
+    for (int s = 0; s < model->sensor_count; s++) {
+        free(model->sensor_delay[s]);
+    }
+    free(model);
+}
+
+wtc_result_t plant_model_add_tank(plant_model_t *model,
+                                  const plant_tank_config_t *config, int *unit) {
+    if (!model || !config || config->area_m2 <= 0.0f || config->height_m <= 0.0f) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    if (model->tank_count >= PLANT_MAX_TANKS) return WTC_ERROR_FULL;
+
+    int t = model->tank_count;
+    wtc_result_t res = add_unit(model, config->name, PLANT_UNIT_TANK, t, unit);
+    if (res != WTC_OK) return res;
+
+    float level = config->initial_level_m;
+    if (level < 0.0f) level = 0.0f;
+    if (level > config->height_m) level = config->height_m;
+
+    model->tank_area[t] = config->area_m2;
+    model->tank_height[t] = config->height_m;
+    model->tank_decay[t] = config->decay_per_s;
+    model->tank_volume[t] = (double)config->area_m2 * level;
+    model->tank_mass[t] = model->tank_volume[t] * config->initial_conc;
+    model->tank_count++;
+    return WTC_OK;
+}
+
+wtc_result_t plant_model_add_flow(plant_model_t *model,
+                                  const plant_flow_config_t *config, int *unit) {
+    if (!model || !config || config->max_flow_m3s < 0.0f) return WTC_ERROR_INVALID_PARAM;
+    if (model->flow_count >= PLANT_MAX_FLOWS) return WTC_ERROR_FULL;
+
+    int from = PLANT_BOUNDARY;
+    int to = PLANT_BOUNDARY;
+    if (config->from != PLANT_BOUNDARY &&
+        (from = unit_index(model, config->from, PLANT_UNIT_TANK)) < 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    if (config->to != PLANT_BOUNDARY &&
+        (to = unit_index(model, config->to, PLANT_UNIT_TANK)) < 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    int f = model->flow_count;
+    wtc_result_t res = add_unit(model, config->name, PLANT_UNIT_FLOW, f, unit);
+    if (res != WTC_OK) return res;
+
+    model->flow_type[f] = config->type;
+    model->flow_from[f] = from;
+    model->flow_to[f] = to;
+    model->flow_max[f] = config->max_flow_m3s;
+    model->flow_alpha[f] = lag_alpha(config->tau_s, model->step_s);
+    model->flow_source_conc[f] = config->source_conc;
+    model->flow_input[f] = clamp_unit(config->initial_input);
+    model->flow_pos[f] = model->flow_input[f];
+    model->flow_q[f] = flow_rate(model, f);
+    model->flow_count++;
+    return WTC_OK;
+}
+
+wtc_result_t plant_model_add_dosing(plant_model_t *model,
+                                    const plant_dosing_config_t *config, int *unit) {
+    if (!model || !config || config->max_flow_m3s < 0.0f) return WTC_ERROR_INVALID_PARAM;
+    if (model->doser_count >= PLANT_MAX_DOSERS) return WTC_ERROR_FULL;
+
+    int tank = unit_index(model, config->tank, PLANT_UNIT_TANK);
+    if (tank < 0) return WTC_ERROR_INVALID_PARAM;
+
+    int d = model->doser_count;
+    wtc_result_t res = add_unit(model, config->name, PLANT_UNIT_DOSING, d, unit);
+    if (res != WTC_OK) return res;
+
+    model->doser_tank[d] = tank;
+    model->doser_max[d] = config->max_flow_m3s;
+    model->doser_conc[d] = config->solution_conc;
+    model->doser_alpha[d] = lag_alpha(config->tau_s, model->step_s);
+    model->doser_input[d] = clamp_unit(config->initial_input);
+    model->doser_pos[d] = model->doser_input[d];
+    model->doser_q[d] = model->doser_max[d] * model->doser_pos[d];
+    model->doser_count++;
+    return WTC_OK;
+}
+
+wtc_result_t plant_model_add_sensor(plant_model_t *model,
+                                    const plant_sensor_config_t *config, int *unit) {
+    if (!model || !config) return WTC_ERROR_INVALID_PARAM;
+    if (config->dead_time_s < 0.0f || config->dead_time_s > PLANT_MAX_DEAD_TIME_S) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    if (model->sensor_count >= PLANT_MAX_SENSORS) return WTC_ERROR_FULL;
+
+    double pv;
+    if (config->unit < 0 || config->unit >= model->unit_count ||
+        !read_variable(model, config->unit, config->variable, &pv)) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    int s = model->sensor_count;
+    float initial = config->gain * (float)pv + config->offset;
+
+    int delay_len = (int)lroundf(config->dead_time_s / model->step_s);
+    float *line = NULL;
+    if (delay_len > 0) {
+        line = malloc((size_t)delay_len * sizeof(float));
+        if (!line) return WTC_ERROR_NO_MEMORY;
+        for (int i = 0; i < delay_len; i++) {
+            line[i] = initial;
+        }
+    }
+
+    wtc_result_t res = add_unit(model, config->name, PLANT_UNIT_SENSOR, s, unit);
+    if (res != WTC_OK) {
+        free(line);
+        return res;
+    }
+
+    model->sensor_unit[s] = config->unit;
+    model->sensor_var[s] = config->variable;
+    model->sensor_gain[s] = config->gain;
+    model->sensor_offset[s] = config->offset;
+    model->sensor_alpha[s] = lag_alpha(config->tau_s, model->step_s);
+    model->sensor_out[s] = initial;
+    model->sensor_delay[s] = line;
+    model->sensor_delay_len[s] = delay_len;
+    model->sensor_delay_pos[s] = 0;
+    model->sensor_count++;
+    return WTC_OK;
+}
+
+wtc_result_t plant_model_find(const plant_model_t *model, const char *name,
+                              int *unit, plant_unit_kind_t *kind) {
+    if (!model || !name || !unit) return WTC_ERROR_INVALID_PARAM;
+
+    for (int i = 0; i < model->unit_count; i++) {
+        if (strcmp(model->units[i].name, name) == 0) {
+            *unit = i;
+            if (kind) *kind = model->units[i].kind;
+            return WTC_OK;
+        }
+    }
+    return WTC_ERROR_NOT_FOUND;
+}
+
+wtc_result_t plant_model_set_input(plant_model_t *model, int unit, float input) {
+    if (!model || unit < 0 || unit >= model->unit_count) return WTC_ERROR_INVALID_PARAM;
+
+    const plant_unit_t *u = &model->units[unit];
+    switch (u->kind) {
+    case PLANT_UNIT_FLOW:
+        model->flow_input[u->index] = clamp_unit(input);
+        return WTC_OK;
+    case PLANT_UNIT_DOSING:
+        model->doser_input[u->index] = clamp_unit(input);
+        return WTC_OK;
+    default:
+        return WTC_ERROR_INVALID_PARAM;
+    }
+}
+
+wtc_result_t plant_model_read_sensor(const plant_model_t *model, int unit, float *value) {
+    if (!model || !value) return WTC_ERROR_INVALID_PARAM;
+
+    int s = unit_index(model, unit, PLANT_UNIT_SENSOR);
+    if (s < 0) return WTC_ERROR_INVALID_PARAM;
+
+    *value = model->sensor_out[s];
+    return WTC_OK;
+}
+
+wtc_result_t plant_model_get_value(const plant_model_t *model, int unit,
+                                   plant_variable_t variable, float *value) {
+    if (!model || !value || unit < 0 || unit >= model->unit_count) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    double v;
+    if (!read_variable(model, unit, variable, &v)) return WTC_ERROR_INVALID_PARAM;
+    *value = (float)v;
+    return WTC_OK;
+}
+
+uint32_t plant_model_advance(plant_model_t *model, double seconds) {
+    if (!model || !(seconds > 0.0)) return 0;
+
+    model->pending_s += seconds;
+    /* Tolerate rounding so 600 s at 0.1 s is 6000 steps, not 5999 */
+    uint32_t steps = (uint32_t)(model->pending_s / model->step_s + 1e-3);
+    model->pending_s -= steps * (double)model->step_s;
+
+    for (uint32_t i = 0; i < steps; i++) {
+        plant_step(model);
+    }
+    model->time_s += steps * (double)model->step_s;
+    return steps;
+}
+
+double plant_model_time(const plant_model_t *model) {
+    return model ? model->time_s : 0.0;
+}
+
+/* Builders for the simulator's scenarios. Each table entry only sets the
+ * fields that differ from zero. */
+
+static int add_tank(plant_model_t *model, wtc_result_t *res, plant_tank_config_t config) {
+    int unit = -1;
+    if (*res == WTC_OK) *res = plant_model_add_tank(model, &config, &unit);
+    return unit;
+}
+
+static int add_flow(plant_model_t *model, wtc_result_t *res, plant_flow_config_t config) {
+    int unit = -1;
+    if (*res == WTC_OK) *res = plant_model_add_flow(model, &config, &unit);
+    return unit;
+}
+
+static int add_dosing(plant_model_t *model, wtc_result_t *res, plant_dosing_config_t config) {
+    int unit = -1;
+    if (*res == WTC_OK) *res = plant_model_add_dosing(model, &config, &unit);
+    return unit;
+}
+
+static void add_sensor(plant_model_t *model, wtc_result_t *res, plant_sensor_config_t config) {
+    if (*res == WTC_OK) *res = plant_model_add_sensor(model, &config, NULL);
+}
+
+wtc_result_t plant_model_build_water_treatment(plant_model_t *model) {
+    if (!model) return WTC_ERROR_INVALID_PARAM;
+
+    wtc_result_t res = WTC_OK;
+
+    /* Chlorine demand gives ~1.8 mg/L in the clearwell at the scenario's
+     * 65/255 hypochlorite stroke and ~870 GPM plant flow */
+    int intake = add_tank(model, &res, (plant_tank_config_t){
+        .name = "INTAKE_WELL", .area_m2 = 50, .height_m = 5, .initial_level_m = 3.75f });
+    int clarifier = add_tank(model, &res, (plant_tank_config_t){
+        .name = "CLARIFIER", .area_m2 = 200, .height_m = 4, .initial_level_m = 3.0f });
+    int filter = add_tank(model, &res, (plant_tank_config_t){
+        .name = "FILTER", .area_m2 = 80, .height_m = 3, .initial_level_m = 2.0f });
+    int clearwell = add_tank(model, &res, (plant_tank_config_t){
+        .name = "CLEARWELL", .area_m2 = 300, .height_m = 6, .initial_level_m = 4.92f,
+        .initial_conc = 1.8f, .decay_per_s = 8.7e-5f });
+    int tower = add_tank(model, &res, (plant_tank_config_t){
+        .name = "DIST_TOWER", .area_m2 = 20, .height_m = 50, .initial_level_m = 38.7f,
+        .initial_conc = 0.8f, .decay_per_s = 8.7e-5f });
+
+    /* Valve ratings put every gravity stage in balance at the initial levels */
+    int raw_valve = add_flow(model, &res, (plant_flow_config_t){
+        .name = "INTAKE_VALVE", .type = PLANT_FLOW_VALVE, .from = PLANT_BOUNDARY, .to = intake,
+        .max_flow_m3s = 0.055f, .tau_s = 10, .initial_input = 1 });
+    add_flow(model, &res, (plant_flow_config_t){
+        .name = "INTAKE_PUMP", .type = PLANT_FLOW_PUMP, .from = intake, .to = clarifier,
+        .max_flow_m3s = 0.055f, .tau_s = 3, .initial_input = 1 });
+    add_flow(model, &res, (plant_flow_config_t){
+        .name = "FILT_INLET", .type = PLANT_FLOW_VALVE, .from = clarifier, .to = filter,
+        .max_flow_m3s = 0.0635f, .tau_s = 10, .initial_input = 1 });
+    add_flow(model, &res, (plant_flow_config_t){
+        .name = "SLUDGE_VALVE", .type = PLANT_FLOW_VALVE, .from = clarifier, .to = PLANT_BOUNDARY,
+        .max_flow_m3s = 0.004f, .tau_s = 5 });
+    int filt_outlet = add_flow(model, &res, (plant_flow_config_t){
+        .name = "FILT_OUTLET", .type = PLANT_FLOW_VALVE, .from = filter, .to = clearwell,
+        .max_flow_m3s = 0.0674f, .initial_input = 1 });
+    add_flow(model, &res, (plant_flow_config_t){
+        .name = "BACKWASH", .type = PLANT_FLOW_VALVE, .from = filter, .to = PLANT_BOUNDARY,
+        .max_flow_m3s = 0.03f, .tau_s = 10 });
+    add_flow(model, &res, (plant_flow_config_t){
+        .name = "HIGH_LIFT_1", .type = PLANT_FLOW_PUMP, .from = clearwell, .to = tower,
+        .max_flow_m3s = 0.0275f, .tau_s = 3, .initial_input = 1 });
+    add_flow(model, &res, (plant_flow_config_t){
+        .name = "HIGH_LIFT_2", .type = PLANT_FLOW_PUMP, .from = clearwell, .to = tower,
+        .max_flow_m3s = 0.0275f, .tau_s = 3, .initial_input = 1 });
+    int demand = add_flow(model, &res, (plant_flow_config_t){
+        .name = "DIST_VALVE", .type = PLANT_FLOW_VALVE, .from = tower, .to = PLANT_BOUNDARY,
+        .max_flow_m3s = 0.0625f, .tau_s = 10, .initial_input = 1 });
+
+    /* Coagulant carries no chlorine; hypochlorite is 12.5 % */
+    int coag = add_dosing(model, &res, (plant_dosing_config_t){
+        .name = "COAG_PUMP", .tank = clarifier, .max_flow_m3s = 15.0f / PLANT_M3S_TO_GPH,
+        .tau_s = 2, .initial_input = 1 });
+    int cl2 = add_dosing(model, &res, (plant_dosing_config_t){
+        .name = "CL2_PUMP", .tank = clearwell, .max_flow_m3s = 9.81f / PLANT_M3S_TO_GPH,
+        .solution_conc = 125000.0f, .tau_s = 2, .initial_input = 65.0f / 255.0f });
+
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "RAW_FLOW", .unit = raw_valve, .variable = PLANT_VAR_FLOW,
+        .gain = PLANT_M3S_TO_GPM, .tau_s = 2 });
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "INTAKE_LEVEL", .unit = intake, .variable = PLANT_VAR_LEVEL_PCT,
+        .gain = 1, .tau_s = 1 });
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "COAG_FLOW", .unit = coag, .variable = PLANT_VAR_FLOW,
+        .gain = PLANT_M3S_TO_GPH, .tau_s = 1 });
+    /* Metered on one of two filter cells */
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "FILT_FLOW", .unit = filt_outlet, .variable = PLANT_VAR_FLOW,
+        .gain = PLANT_M3S_TO_GPM / 2.0f, .tau_s = 2 });
+    /* Analyzer sample line adds a minute of transport delay */
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "CL2_RESIDUAL", .unit = clearwell, .variable = PLANT_VAR_CONCENTRATION,
+        .gain = 1, .tau_s = 30, .dead_time_s = 60 });
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "CL2_FLOW", .unit = cl2, .variable = PLANT_VAR_FLOW,
+        .gain = PLANT_M3S_TO_GPH, .tau_s = 1 });
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "CLEARWELL_LVL", .unit = clearwell, .variable = PLANT_VAR_LEVEL_PCT,
+        .gain = 1, .tau_s = 1 });
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "DIST_PRESS", .unit = tower, .variable = PLANT_VAR_LEVEL,
+        .gain = PLANT_M_TO_PSI, .tau_s = 1 });
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "DIST_FLOW", .unit = demand, .variable = PLANT_VAR_FLOW,
+        .gain = PLANT_M3S_TO_GPM, .tau_s = 2 });
+
+    if (res != WTC_OK) {
+        LOG_ERROR("[SIM] Failed to build water treatment flowsheet: %d", res);
+    }
+    return res;
+}
+
+wtc_result_t plant_model_build_demo(plant_model_t *model) {
+    if (!model) return WTC_ERROR_INVALID_PARAM;
+
+    wtc_result_t res = WTC_OK;
+
+    int tank = add_tank(model, &res, (plant_tank_config_t){
+        .name = "TANK_01", .area_m2 = 10, .height_m = 4, .initial_level_m = 3.0f });
+    add_flow(model, &res, (plant_flow_config_t){
+        .name = "VALVE_01", .type = PLANT_FLOW_VALVE, .from = PLANT_BOUNDARY, .to = tank,
+        .max_flow_m3s = 0.0063f, .tau_s = 5, .initial_input = 1 });
+    int pump = add_flow(model, &res, (plant_flow_config_t){
+        .name = "PUMP_01", .type = PLANT_FLOW_PUMP, .from = tank, .to = PLANT_BOUNDARY,
+        .max_flow_m3s = 0.0063f, .tau_s = 2, .initial_input = 1 });
+
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "FLOW_01", .unit = pump, .variable = PLANT_VAR_FLOW,
+        .gain = PLANT_M3S_TO_GPM, .tau_s = 1 });
+    add_sensor(model, &res, (plant_sensor_config_t){
+        .name = "LEVEL_01", .unit = tank, .variable = PLANT_VAR_LEVEL_PCT,
+        .gain = 1, .tau_s = 1 });
+
+    if (res != WTC_OK) {
+        LOG_ERROR("[SIM] Failed to build demo flowsheet: %d", res);
+    }
+    return res;
+}
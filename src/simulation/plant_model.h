@@ -0,0 +1,178 @@
+/*
+ * Water Treatment Controller - Simulated Process Plant
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Closed-loop process model behind the simulator. A flowsheet is built
+ * from four kinds of unit:
+ *
+ *   tank    - volume and one dissolved species (e.g. chlorine), with
+ *             first-order decay of the species
+ *   flow    - pump or valve moving water between two tanks, or between
+ *             a tank and the plant boundary (PLANT_BOUNDARY)
+ *   dosing  - chemical metering pump adding solution to a tank
+ *   sensor  - first-order-plus-dead-time view of a tank or flow variable
+ *
+ * Flows, dosers and actuators take an input in 0..1 (stopped..full) and
+ * follow it with their own time constant. Everything is integrated by a
+ * fixed-step solver that advances all units of one kind together, so a
+ * flowsheet with hundreds of units costs a few tight loops per step.
+ * The model has no clock of its own: plant_model_advance() runs as many
+ * steps as the simulated seconds it is given, so it runs faster than
+ * real time when the caller passes more simulated seconds than have
+ * passed on the wall clock.
+ *
+ * Units are SI (m, m^2, m^3/s, g/m^3 = mg/L); sensor gain and offset
+ * convert to engineering units.
+ */
+
+#ifndef WTC_PLANT_MODEL_H
+#define WTC_PLANT_MODEL_H
+
+#include "../types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PLANT_MAX_TANKS         64
+#define PLANT_MAX_FLOWS         128
+#define PLANT_MAX_DOSERS        32
+#define PLANT_MAX_SENSORS       256
+#define PLANT_MAX_UNITS         (PLANT_MAX_TANKS + PLANT_MAX_FLOWS + \
+                                 PLANT_MAX_DOSERS + PLANT_MAX_SENSORS)
+#define PLANT_MAX_DEAD_TIME_S   600.0f
+#define PLANT_DEFAULT_STEP_S    0.1f
+
+/* Flow end outside the plant (raw water source or distribution sink) */
+#define PLANT_BOUNDARY          (-1)
+
+/* Conversions for sensor gains */
+#define PLANT_M3S_TO_GPM        15850.32f
+#define PLANT_M3S_TO_GPH        951019.4f
+#define PLANT_M_TO_PSI          1.4219f     /* Water column */
+
+/* Unit kinds */
+typedef enum {
+    PLANT_UNIT_TANK = 0,
+    PLANT_UNIT_FLOW,
+    PLANT_UNIT_DOSING,
+    PLANT_UNIT_SENSOR,
+} plant_unit_kind_t;
+
+/* Flow element types */
+typedef enum {
+    PLANT_FLOW_PUMP = 0,        /* Flow = rating * speed, until suction runs dry */
+    PLANT_FLOW_VALVE,           /* Gravity: flow = rating * opening * sqrt(level / height) */
+} plant_flow_type_t;
+
+/* Process variables a sensor can measure */
+typedef enum {
+    PLANT_VAR_LEVEL = 0,        /* Tank level, m */
+    PLANT_VAR_LEVEL_PCT,        /* Tank level, % of height */
+    PLANT_VAR_VOLUME,           /* Tank volume, m^3 */
+    PLANT_VAR_CONCENTRATION,    /* Tank species concentration, mg/L */
+    PLANT_VAR_FLOW,             /* Flow or dosing rate, m^3/s */
+} plant_variable_t;
+
+/* Tank */
+typedef struct {
+    char name[32];
+    float area_m2;
+    float height_m;
+    float initial_level_m;
+    float initial_conc;         /* mg/L */
+    float decay_per_s;          /* First-order species demand */
+} plant_tank_config_t;
+
+/* Pump or valve */
+typedef struct {
+    char name[32];
+    plant_flow_type_t type;
+    int from;                   /* Tank unit or PLANT_BOUNDARY */
+    int to;                     /* Tank unit or PLANT_BOUNDARY */
+    float max_flow_m3s;         /* Pump rating, or valve flow fully open at full head */
+    float tau_s;                /* Spin-up / stroke time constant, 0 = instant */
+    float initial_input;        /* 0..1 */
+    float source_conc;          /* Species carried in from the boundary, mg/L */
+} plant_flow_config_t;
+
+/* Chemical dosing pump */
+typedef struct {
+    char name[32];
+    int tank;                   /* Tank unit dosed into */
+    float max_flow_m3s;         /* Solution flow at full stroke */
+    float solution_conc;        /* Species in the solution, mg/L */
+    float tau_s;
+    float initial_input;        /* 0..1 */
+} plant_dosing_config_t;
+
+/* First-order-plus-dead-time sensor: out = gain * pv + offset, delayed by
+ * dead_time_s and then lagged by tau_s */
+typedef struct {
+    char name[32];
+    int unit;                   /* Tank, flow or dosing unit measured */
+    plant_variable_t variable;
+    float gain;
+    float offset;
+    float tau_s;
+    float dead_time_s;          /* Up to PLANT_MAX_DEAD_TIME_S */
+} plant_sensor_config_t;
+
+/* Plant model handle */
+typedef struct plant_model plant_model_t;
+
+/* Create an empty flowsheet integrated with a fixed step of step_s
+ * (0 = PLANT_DEFAULT_STEP_S) */
+wtc_result_t plant_model_create(plant_model_t **model, float step_s);
+
+/* Free flowsheet */
+void plant_model_destroy(plant_model_t *model);
+
+/* Add units; unit receives the id used to connect, drive and read it.
+ * Tanks must be added before the flows and dosers that reference them,
+ * and measured units before their sensors. */
+wtc_result_t plant_model_add_tank(plant_model_t *model,
+                                  const plant_tank_config_t *config, int *unit);
+wtc_result_t plant_model_add_flow(plant_model_t *model,
+                                  const plant_flow_config_t *config, int *unit);
+wtc_result_t plant_model_add_dosing(plant_model_t *model,
+                                    const plant_dosing_config_t *config, int *unit);
+wtc_result_t plant_model_add_sensor(plant_model_t *model,
+                                    const plant_sensor_config_t *config, int *unit);
+
+/* Find a unit by name */
+wtc_result_t plant_model_find(const plant_model_t *model, const char *name,
+                              int *unit, plant_unit_kind_t *kind);
+
+/* Set the input of a flow or dosing unit (clamped to 0..1) */
+wtc_result_t plant_model_set_input(plant_model_t *model, int unit, float input);
+
+/* Read the current output of a sensor unit */
+wtc_result_t plant_model_read_sensor(const plant_model_t *model, int unit, float *value);
+
+/* Read a process variable of a tank, flow or dosing unit directly */
+wtc_result_t plant_model_get_value(const plant_model_t *model, int unit,
+                                   plant_variable_t variable, float *value);
+
+/* Advance the plant by seconds of simulated time. Whole steps are run;
+ * the remainder carries over to the next call. Returns steps run. */
+uint32_t plant_model_advance(plant_model_t *model, double seconds);
+
+/* Simulated seconds integrated so far */
+double plant_model_time(const plant_model_t *model);
+
+/* Populate an empty model with the flowsheet behind the simulator's
+ * water treatment scenario (intake, clarifier, filter, clearwell,
+ * distribution tower). Unit names match the RTU tags. */
+wtc_result_t plant_model_build_water_treatment(plant_model_t *model);
+
+/* Populate an empty model with the single-tank loop behind the
+ * simulator's demo RTU (VALVE_01 fills, PUMP_01 drains, LEVEL_01) */
+wtc_result_t plant_model_build_demo(plant_model_t *model);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_PLANT_MODEL_H */
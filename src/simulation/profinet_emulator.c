@@ -0,0 +1,1333 @@
+/*
+ * Water Treatment Controller - PROFINET IO-Device Emulator Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE     /* struct in_pktinfo */
+
+#include "profinet_emulator.h"
+#include "../profinet/profinet_frame.h"
+#include "../profinet/profinet_rpc.h"
+#include "../profinet/profinet_controller.h"
+#include "../profinet/dcp_discovery.h"
+#include "../profinet/gsdml_modules.h"
+#include "../profinet/profinet_identity.h"
+#include "../utils/logger.h"
+#include "../utils/time_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Input frame ID of device i is BASE + 2i + 1, output frame ID BASE + 2i + 2 */
+#define EMU_FRAME_ID_BASE           PROFINET_FRAME_ID_RT_CLASS1
+#define EMU_APP_READY_RETRY_US      2000000
+#define EMU_APP_READY_MAX_TRIES     15
+#define EMU_DCP_DELAY_UNIT_US       10000       /* ResponseDelay unit: 10 ms */
+#define EMU_VENDOR_NAME             "WTC-EMU"
+
+typedef enum {
+    EMU_AR_IDLE = 0,
+    EMU_AR_CONNECTED,           /* Connect accepted, input frames running */
+    EMU_AR_PRM_END,             /* PrmEnd done, ApplicationReady outstanding */
+    EMU_AR_RUNNING,             /* ApplicationReady acknowledged */
+} emu_ar_state_t;
+
+/* Plugged module (same set on every device) */
+typedef struct {
+    uint16_t slot;
+    uint32_t module_ident;
+    uint32_t submodule_ident;
+    bool is_input;
+    float base;
+    float amplitude;
+} emu_module_t;
+
+/* One IODataObject of the input IOCR */
+typedef struct {
+    uint16_t offset;
+    uint16_t length;            /* 0 = IOPS only (DAP submodules) */
+    int16_t module;             /* Index into modules[], -1 = none */
+} emu_io_entry_t;
+
+typedef struct {
+    int index;
+    uint8_t mac[6];
+    uint32_t ip;                /* Host order */
+    char station_name[64];
+    float phase;                /* Waveform phase offset, 0..1 */
+
+    pthread_mutex_t lock;
+    emu_ar_state_t state;
+    uint8_t ar_uuid[16];
+    uint16_t session_key;
+    uint8_t controller_mac[6];
+    struct sockaddr_in controller_addr;
+    rpc_context_t rpc;          /* Sequence/activity for ApplicationReady */
+
+    uint16_t input_frame_id;
+    uint16_t output_frame_id;
+    uint16_t input_length;
+    uint32_t period_us;
+    uint16_t cycle_step;        /* SCF * RR, in 31.25 us units */
+    uint16_t cycle_counter;
+    uint64_t next_nominal_us;
+    uint64_t next_tx_us;
+    emu_io_entry_t entries[WTC_MAX_SLOTS];
+    int entry_count;
+    uint16_t iocs_offsets[WTC_MAX_SLOTS];
+    int iocs_count;
+
+    uint64_t connect_rx_us;     /* First Connect of the current attempt */
+    uint64_t app_ready_next_us;
+    int app_ready_tries;
+
+    uint64_t dcp_due_us;        /* 0 = no Identify response pending */
+    uint32_t dcp_xid;
+    uint8_t dcp_dst[6];
+} emu_device_t;
+
+struct profinet_emulator {
+    emulator_config_t config;
+    emu_device_t *devices;
+    emu_module_t modules[EMU_MAX_SENSORS + EMU_MAX_ACTUATORS];
+    int module_count;
+
+    int if_index;
+    int raw_fd;
+    int rpc_fd;
+    int http_fd;
+
+    pthread_t l2_thread;
+    pthread_t rpc_thread;
+    pthread_t http_thread;
+    pthread_t cyclic_thread;
+    bool running;
+    bool threads_started;
+
+    /* RPC thread scratch (too large for the stack) */
+    incoming_connect_request_t connect_req;
+    connect_response_t connect_resp;
+
+    /* Statistics */
+    pthread_mutex_t stats_lock;
+    uint64_t start_us;
+    uint64_t first_connect_us;
+    uint64_t storm_done_us;
+    int devices_running;
+    int dcp_pending;
+    int app_ready_pending;
+    uint64_t latency_count;
+    double latency_sum_ms;
+    double latency_min_ms;
+    double latency_max_ms;
+
+    uint64_t frames_tx;
+    uint64_t frames_rx;
+    uint64_t frames_dropped;
+    uint64_t dcp_responses;
+    uint64_t http_requests;
+    uint64_t connects;
+    uint64_t connect_diffs;
+    uint64_t prm_ends;
+    uint64_t app_ready_sent;
+    uint64_t app_ready_acks;
+    uint64_t releases;
+    uint64_t rpc_errors;
+};
+
+#define EMU_COUNT(emu, field) __atomic_add_fetch(&(emu)->field, 1, __ATOMIC_RELAXED)
+
+static bool emu_running(profinet_emulator_t *emu) {
+    return __atomic_load_n(&emu->running, __ATOMIC_ACQUIRE);
+}
+
+/* xorshift32, one state per thread */
+static float rng_unit(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (float)(x >> 8) / 16777216.0f;
+}
+
+/* ============== Device Setup ============== */
+
+static void module_base_value(uint32_t module_ident, float *base, float *amplitude) {
+    switch (module_ident) {
+    case GSDML_MOD_PH:          *base = 7.0f;   *amplitude = 0.5f;  break;
+    case GSDML_MOD_TDS:         *base = 350.0f; *amplitude = 50.0f; break;
+    case GSDML_MOD_TURBIDITY:   *base = 1.2f;   *amplitude = 0.4f;  break;
+    case GSDML_MOD_TEMPERATURE: *base = 18.0f;  *amplitude = 3.0f;  break;
+    case GSDML_MOD_FLOW:        *base = 120.0f; *amplitude = 20.0f; break;
+    case GSDML_MOD_LEVEL:       *base = 65.0f;  *amplitude = 15.0f; break;
+    default:                    *base = 50.0f;  *amplitude = 10.0f; break;
+    }
+}
+
+static void build_module_list(profinet_emulator_t *emu) {
+    static const uint32_t sensor_mods[][2] = {
+        { GSDML_MOD_PH,          GSDML_SUBMOD_PH },
+        { GSDML_MOD_TDS,         GSDML_SUBMOD_TDS },
+        { GSDML_MOD_TURBIDITY,   GSDML_SUBMOD_TURBIDITY },
+        { GSDML_MOD_TEMPERATURE, GSDML_SUBMOD_TEMPERATURE },
+        { GSDML_MOD_FLOW,        GSDML_SUBMOD_FLOW },
+        { GSDML_MOD_LEVEL,       GSDML_SUBMOD_LEVEL },
+    };
+    static const uint32_t actuator_mods[][2] = {
+        { GSDML_MOD_PUMP,  GSDML_SUBMOD_PUMP },
+        { GSDML_MOD_VALVE, GSDML_SUBMOD_VALVE },
+    };
+    int n_sensor_types = (int)(sizeof(sensor_mods) / sizeof(sensor_mods[0]));
+    int n_actuator_types = (int)(sizeof(actuator_mods) / sizeof(actuator_mods[0]));
+
+    emu->module_count = 0;
+    uint16_t slot = 1;
+
+    for (int i = 0; i < emu->config.sensors_per_device; i++) {
+        emu_module_t *m = &emu->modules[emu->module_count++];
+        m->slot = slot++;
+        m->module_ident = sensor_mods[i % n_sensor_types][0];
+        m->submodule_ident = sensor_mods[i % n_sensor_types][1];
+        m->is_input = true;
+        module_base_value(m->module_ident, &m->base, &m->amplitude);
+    }
+
+    for (int i = 0; i < emu->config.actuators_per_device; i++) {
+        emu_module_t *m = &emu->modules[emu->module_count++];
+        m->slot = slot++;
+        m->module_ident = actuator_mods[i % n_actuator_types][0];
+        m->submodule_ident = actuator_mods[i % n_actuator_types][1];
+        m->is_input = false;
+    }
+}
+
+static int find_module(const profinet_emulator_t *emu, uint16_t slot) {
+    for (int i = 0; i < emu->module_count; i++) {
+        if (emu->modules[i].slot == slot) return i;
+    }
+    return -1;
+}
+
+static void init_devices(profinet_emulator_t *emu) {
+    const emulator_config_t *cfg = &emu->config;
+    uint32_t ip = cfg->base_ip;
+    uint32_t mac_low = ((uint32_t)cfg->base_mac[3] << 16) |
+                       ((uint32_t)cfg->base_mac[4] << 8) | cfg->base_mac[5];
+
+    for (int i = 0; i < cfg->device_count; i++) {
+        emu_device_t *dev = &emu->devices[i];
+        dev->index = i;
+
+        memcpy(dev->mac, cfg->base_mac, 3);
+        uint32_t low = (mac_low + (uint32_t)i) & 0xFFFFFF;
+        dev->mac[3] = (uint8_t)(low >> 16);
+        dev->mac[4] = (uint8_t)(low >> 8);
+        dev->mac[5] = (uint8_t)low;
+
+        /* Skip network, .1 (controller heuristic) and broadcast octets */
+        while ((ip & 0xFF) == 0 || (ip & 0xFF) == 1 || (ip & 0xFF) == 255) {
+            ip++;
+        }
+        dev->ip = ip++;
+
+        snprintf(dev->station_name, sizeof(dev->station_name), "%s%d",
+                 cfg->name_prefix, i + 1);
+        dev->phase = (float)i / (float)cfg->device_count;
+
+        pthread_mutex_init(&dev->lock, NULL);
+        dev->rpc.socket_fd = -1;
+        memcpy(dev->rpc.controller_mac, dev->mac, 6);
+        dev->rpc.controller_ip = dev->ip;
+    }
+}
+
+/* Devices are in ascending IP order */
+static emu_device_t *find_device_by_ip(profinet_emulator_t *emu, uint32_t ip) {
+    int lo = 0, hi = emu->config.device_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        uint32_t dev_ip = emu->devices[mid].ip;
+        if (dev_ip == ip) return &emu->devices[mid];
+        if (dev_ip < ip) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return NULL;
+}
+
+/* ============== DCP ============== */
+
+static void append_dcp_block(frame_builder_t *b, uint8_t option, uint8_t suboption,
+                             uint16_t block_info, const void *data, size_t len) {
+    uint8_t hdr[6];
+    hdr[0] = option;
+    hdr[1] = suboption;
+    hdr[2] = (uint8_t)((len + 2) >> 8);
+    hdr[3] = (uint8_t)(len + 2);
+    hdr[4] = (uint8_t)(block_info >> 8);
+    hdr[5] = (uint8_t)block_info;
+    frame_append_data(b, hdr, sizeof(hdr));
+    frame_append_data(b, data, len);
+    if (len & 1) {
+        uint8_t pad = 0;
+        frame_append_data(b, &pad, 1);
+    }
+}
+
+static void send_dcp_identify_response(profinet_emulator_t *emu, emu_device_t *dev) {
+    uint8_t buf[ETH_MAX_FRAME_LEN];
+    frame_builder_t b;
+    frame_builder_init(&b, buf, sizeof(buf), dev->mac);
+    frame_build_ethernet(&b, dev->dcp_dst, PROFINET_ETHERTYPE);
+    frame_build_rt_header(&b, PROFINET_FRAME_ID_DCP_IDENT_RESP);
+
+    size_t dcp_hdr_pos = b.position;
+    uint8_t dcp_hdr[10] = {
+        DCP_SERVICE_IDENTIFY, DCP_SERVICE_TYPE_RESPONSE_OK,
+        (uint8_t)(dev->dcp_xid >> 24), (uint8_t)(dev->dcp_xid >> 16),
+        (uint8_t)(dev->dcp_xid >> 8), (uint8_t)dev->dcp_xid,
+        0, 0,   /* Reserved */
+        0, 0,   /* DCPDataLength, filled below */
+    };
+    frame_append_data(&b, dcp_hdr, sizeof(dcp_hdr));
+    size_t blocks_start = b.position;
+
+    uint32_t ip_params[3] = {
+        htonl(dev->ip), htonl(emu->config.netmask), htonl(0),
+    };
+    append_dcp_block(&b, DCP_OPTION_IP, DCP_SUBOPTION_IP_PARAMETER, 0x0001,
+                     ip_params, sizeof(ip_params));
+    append_dcp_block(&b, DCP_OPTION_DEVICE, DCP_SUBOPTION_DEVICE_VENDOR, 0,
+                     EMU_VENDOR_NAME, strlen(EMU_VENDOR_NAME));
+    append_dcp_block(&b, DCP_OPTION_DEVICE, DCP_SUBOPTION_DEVICE_NAME, 0,
+                     dev->station_name, strlen(dev->station_name));
+    uint8_t device_id[4] = {
+        (uint8_t)(PN_VENDOR_ID >> 8), (uint8_t)PN_VENDOR_ID,
+        (uint8_t)(PN_DEVICE_ID >> 8), (uint8_t)PN_DEVICE_ID,
+    };
+    append_dcp_block(&b, DCP_OPTION_DEVICE, DCP_SUBOPTION_DEVICE_ID, 0,
+                     device_id, sizeof(device_id));
+    uint8_t role[2] = { 0x01, 0x00 };  /* IO device */
+    append_dcp_block(&b, DCP_OPTION_DEVICE, DCP_SUBOPTION_DEVICE_ROLE, 0,
+                     role, sizeof(role));
+
+    uint16_t data_length = (uint16_t)(b.position - blocks_start);
+    buf[dcp_hdr_pos + 8] = (uint8_t)(data_length >> 8);
+    buf[dcp_hdr_pos + 9] = (uint8_t)data_length;
+    frame_append_padding(&b, ETH_MIN_FRAME_LEN);
+
+    if (send(emu->raw_fd, buf, b.position, 0) < 0) {
+        LOG_WARN("DCP response for %s failed: %s", dev->station_name, strerror(errno));
+        return;
+    }
+    EMU_COUNT(emu, dcp_responses);
+}
+
+static void schedule_dcp_response(profinet_emulator_t *emu, emu_device_t *dev,
+                                  const uint8_t *dst, uint32_t xid,
+                                  uint16_t response_delay, uint64_t now_us) {
+    /* Spread responses over the requested window so a large fleet does not
+     * answer in one burst (IEC 61158-6-10 ResponseDelay) */
+    uint64_t delay_us = 0;
+    if (response_delay > 1) {
+        delay_us = (uint64_t)(dev->index % response_delay) * EMU_DCP_DELAY_UNIT_US;
+    }
+    if (dev->dcp_due_us == 0) {
+        emu->dcp_pending++;
+    }
+    dev->dcp_due_us = now_us + delay_us + 1;
+    dev->dcp_xid = xid;
+    memcpy(dev->dcp_dst, dst, 6);
+}
+
+static void handle_dcp_identify(profinet_emulator_t *emu, frame_parser_t *parser,
+                                const uint8_t *src_mac) {
+    profinet_dcp_header_t dcp;
+    if (frame_parse_dcp_header(parser, &dcp) != WTC_OK ||
+        dcp.service_id != DCP_SERVICE_IDENTIFY ||
+        dcp.service_type != DCP_SERVICE_TYPE_REQUEST) {
+        return;
+    }
+
+    /* One filter block: AllSelector or NameOfStation */
+    dcp_block_header_t block;
+    const uint8_t *data;
+    if (frame_parse_dcp_block(parser, &block, &data) != WTC_OK) {
+        return;
+    }
+
+    uint64_t now_us = time_get_monotonic_us();
+    if (block.option == DCP_OPTION_ALL) {
+        for (int i = 0; i < emu->config.device_count; i++) {
+            schedule_dcp_response(emu, &emu->devices[i], src_mac, dcp.xid,
+                                  dcp.response_delay, now_us);
+        }
+    } else if (block.option == DCP_OPTION_DEVICE &&
+               block.suboption == DCP_SUBOPTION_DEVICE_NAME) {
+        for (int i = 0; i < emu->config.device_count; i++) {
+            emu_device_t *dev = &emu->devices[i];
+            if (strlen(dev->station_name) == block.length &&
+                memcmp(dev->station_name, data, block.length) == 0) {
+                schedule_dcp_response(emu, dev, src_mac, dcp.xid,
+                                      dcp.response_delay, now_us);
+                break;
+            }
+        }
+    }
+}
+
+static void handle_output_frame(profinet_emulator_t *emu, uint16_t frame_id) {
+    uint32_t rel = (uint32_t)(frame_id - EMU_FRAME_ID_BASE);
+    if (rel < 2 || (rel & 1)) return;
+
+    uint32_t index = (rel - 2) / 2;
+    if (index >= (uint32_t)emu->config.device_count) return;
+
+    emu_device_t *dev = &emu->devices[index];
+    if (__atomic_load_n(&dev->state, __ATOMIC_RELAXED) != EMU_AR_IDLE) {
+        EMU_COUNT(emu, frames_rx);
+    }
+}
+
+static void *l2_thread_func(void *arg) {
+    profinet_emulator_t *emu = arg;
+    uint8_t buf[ETH_MAX_FRAME_LEN];
+
+    while (emu_running(emu)) {
+        struct pollfd pfd = { .fd = emu->raw_fd, .events = POLLIN };
+        int timeout_ms = emu->dcp_pending > 0 ? 1 : 20;
+
+        if (poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLIN)) {
+            struct sockaddr_ll from;
+            socklen_t from_len = sizeof(from);
+            ssize_t len = recvfrom(emu->raw_fd, buf, sizeof(buf), 0,
+                                   (struct sockaddr *)&from, &from_len);
+            /* On lo every frame is seen twice; ignore our own transmissions */
+            if (len > 0 && from.sll_pkttype != PACKET_OUTGOING) {
+                frame_parser_t parser;
+                uint8_t dst_mac[6], src_mac[6];
+                uint16_t ethertype, frame_id;
+
+                frame_parser_init(&parser, buf, (size_t)len);
+                if (frame_parse_ethernet(&parser, dst_mac, src_mac, &ethertype) == WTC_OK &&
+                    ethertype == PROFINET_ETHERTYPE &&
+                    frame_parse_rt_header(&parser, &frame_id) == WTC_OK) {
+                    if (frame_id == PROFINET_FRAME_ID_DCP_IDENT) {
+                        handle_dcp_identify(emu, &parser, src_mac);
+                    } else if (frame_id >= PROFINET_FRAME_ID_RT_CLASS1 &&
+                               frame_id <= PROFINET_FRAME_ID_RT_CLASS1_END) {
+                        handle_output_frame(emu, frame_id);
+                    }
+                }
+            }
+        }
+
+        if (emu->dcp_pending > 0) {
+            uint64_t now_us = time_get_monotonic_us();
+            for (int i = 0; i < emu->config.device_count; i++) {
+                emu_device_t *dev = &emu->devices[i];
+                if (dev->dcp_due_us != 0 && dev->dcp_due_us <= now_us) {
+                    send_dcp_identify_response(emu, dev);
+                    dev->dcp_due_us = 0;
+                    emu->dcp_pending--;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* ============== RPC ============== */
+
+/* Send from the device's own IP so the controller sees the right peer */
+static void rpc_send_from(profinet_emulator_t *emu, const emu_device_t *dev,
+                          const struct sockaddr_in *to,
+                          const uint8_t *data, size_t len) {
+    struct iovec iov = { .iov_base = (void *)data, .iov_len = len };
+    char cbuf[CMSG_SPACE(sizeof(struct in_pktinfo))];
+    memset(cbuf, 0, sizeof(cbuf));
+
+    struct msghdr msg = {
+        .msg_name = (void *)to,
+        .msg_namelen = sizeof(*to),
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = cbuf,
+        .msg_controllen = sizeof(cbuf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = IPPROTO_IP;
+    cmsg->cmsg_type = IP_PKTINFO;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+    struct in_pktinfo *pi = (struct in_pktinfo *)CMSG_DATA(cmsg);
+    pi->ipi_spec_dst.s_addr = htonl(dev->ip);
+
+    if (sendmsg(emu->rpc_fd, &msg, 0) < 0) {
+        LOG_WARN("RPC send from %s failed: %s", dev->station_name, strerror(errno));
+        EMU_COUNT(emu, rpc_errors);
+    }
+}
+
+/* Map the input IOCR's IODataObjects to what the cyclic thread writes */
+static void setup_input_layout(profinet_emulator_t *emu, emu_device_t *dev,
+                               const incoming_connect_request_t *req, int in) {
+    const connect_request_params_t *params = &req->params;
+    uint16_t data_length = params->iocr[in].data_length;
+
+    dev->entry_count = 0;
+    for (int i = 0; i < req->layout[in].iodata_count; i++) {
+        uint16_t slot = req->layout[in].iodata[i].slot;
+        uint16_t subslot = req->layout[in].iodata[i].subslot;
+        uint16_t length = 0;
+
+        for (int j = 0; j < params->expected_count; j++) {
+            if (params->expected_config[j].slot == slot &&
+                params->expected_config[j].subslot == subslot) {
+                length = params->expected_config[j].data_length;
+                break;
+            }
+        }
+
+        uint16_t offset = req->layout[in].iodata[i].frame_offset;
+        if ((uint32_t)offset + length + 1 > data_length) {
+            LOG_WARN("%s: IOData %u.%u at %u+%u exceeds C-SDU (%u bytes)",
+                     dev->station_name, slot, subslot, offset, length, data_length);
+            continue;
+        }
+
+        emu_io_entry_t *e = &dev->entries[dev->entry_count++];
+        e->offset = offset;
+        e->length = length;
+        int m = find_module(emu, slot);
+        e->module = (m >= 0 && emu->modules[m].is_input) ? (int16_t)m : -1;
+    }
+
+    dev->iocs_count = 0;
+    for (int i = 0; i < req->layout[in].iocs_count; i++) {
+        uint16_t offset = req->layout[in].iocs[i].frame_offset;
+        if (offset < data_length) {
+            dev->iocs_offsets[dev->iocs_count++] = offset;
+        }
+    }
+}
+
+/* True if the expected application modules match what is plugged */
+static bool expected_config_matches(const profinet_emulator_t *emu,
+                                    const connect_request_params_t *params) {
+    int app_count = 0;
+    for (int i = 0; i < params->expected_count; i++) {
+        if (params->expected_config[i].slot == 0) continue;
+        app_count++;
+
+        int m = find_module(emu, params->expected_config[i].slot);
+        if (m < 0 ||
+            emu->modules[m].module_ident != params->expected_config[i].module_ident ||
+            emu->modules[m].submodule_ident != params->expected_config[i].submodule_ident) {
+            return false;
+        }
+    }
+    return app_count == emu->module_count;
+}
+
+static void fill_module_diff(const profinet_emulator_t *emu, connect_response_t *resp) {
+    static const uint32_t dap[][2] = {
+        { 0x0001, GSDML_SUBMOD_DAP },
+        { 0x8000, GSDML_SUBMOD_INTERFACE },
+        { 0x8001, GSDML_SUBMOD_PORT },
+    };
+
+    resp->has_diff = true;
+    resp->discovered_count = 0;
+    for (int i = 0; i < 3; i++) {
+        resp->discovered_modules[i].slot = 0;
+        resp->discovered_modules[i].subslot = (uint16_t)dap[i][0];
+        resp->discovered_modules[i].module_ident = GSDML_MOD_DAP;
+        resp->discovered_modules[i].submodule_ident = dap[i][1];
+        resp->discovered_count++;
+    }
+    for (int i = 0; i < emu->module_count; i++) {
+        int n = resp->discovered_count++;
+        resp->discovered_modules[n].slot = emu->modules[i].slot;
+        resp->discovered_modules[n].subslot = 1;
+        resp->discovered_modules[n].module_ident = emu->modules[i].module_ident;
+        resp->discovered_modules[n].submodule_ident = emu->modules[i].submodule_ident;
+    }
+    resp->diff_count = resp->discovered_count;
+}
+
+static void handle_connect(profinet_emulator_t *emu, emu_device_t *dev,
+                           const uint8_t *buf, size_t len,
+                           const struct sockaddr_in *from) {
+    incoming_connect_request_t *req = &emu->connect_req;
+    connect_response_t *resp = &emu->connect_resp;
+
+    if (rpc_parse_connect_request(buf, len, req) != WTC_OK) {
+        LOG_WARN("%s: malformed Connect request", dev->station_name);
+        EMU_COUNT(emu, rpc_errors);
+        return;
+    }
+
+    uint64_t now_us = time_get_monotonic_us();
+    EMU_COUNT(emu, connects);
+
+    pthread_mutex_lock(&emu->stats_lock);
+    if (emu->first_connect_us == 0) {
+        emu->first_connect_us = now_us;
+    }
+    pthread_mutex_unlock(&emu->stats_lock);
+
+    memset(resp, 0, sizeof(*resp));
+    resp->success = true;
+    memcpy(resp->device_mac, dev->mac, 6);
+    resp->device_port = PNIO_RPC_PORT;
+    resp->device_alarm_ref = (uint16_t)(dev->index + 1);
+
+    uint16_t input_fid = (uint16_t)(EMU_FRAME_ID_BASE + 2 * dev->index + 1);
+    uint16_t output_fid = (uint16_t)(EMU_FRAME_ID_BASE + 2 * dev->index + 2);
+    int input_iocr = -1;
+    for (int i = 0; i < req->params.iocr_count; i++) {
+        bool is_input = req->params.iocr[i].type == IOCR_TYPE_INPUT;
+        resp->frame_ids[i].requested = req->params.iocr[i].frame_id;
+        resp->frame_ids[i].assigned = is_input ? input_fid : output_fid;
+        if (is_input && input_iocr < 0) {
+            input_iocr = i;
+        }
+    }
+    resp->frame_id_count = req->params.iocr_count;
+
+    pthread_mutex_lock(&dev->lock);
+
+    if (dev->state == EMU_AR_RUNNING) {
+        pthread_mutex_lock(&emu->stats_lock);
+        emu->devices_running--;
+        pthread_mutex_unlock(&emu->stats_lock);
+    }
+    if (dev->state == EMU_AR_PRM_END) {
+        emu->app_ready_pending--;
+    }
+    if (dev->connect_rx_us == 0) {
+        dev->connect_rx_us = now_us;
+    }
+
+    if (!expected_config_matches(emu, &req->params)) {
+        /* Controller retries with the real configuration */
+        fill_module_diff(emu, resp);
+        __atomic_store_n(&dev->state, EMU_AR_IDLE, __ATOMIC_RELEASE);
+        EMU_COUNT(emu, connect_diffs);
+    } else if (input_iocr < 0) {
+        LOG_WARN("%s: Connect without input IOCR", dev->station_name);
+        __atomic_store_n(&dev->state, EMU_AR_IDLE, __ATOMIC_RELEASE);
+    } else {
+        const connect_request_params_t *params = &req->params;
+        memcpy(dev->ar_uuid, params->ar_uuid, 16);
+        dev->session_key = params->session_key;
+        memcpy(dev->controller_mac, params->controller_mac, 6);
+        dev->controller_addr = *from;
+        dev->input_frame_id = input_fid;
+        dev->output_frame_id = output_fid;
+        dev->input_length = params->iocr[input_iocr].data_length;
+
+        uint32_t ticks = (uint32_t)params->iocr[input_iocr].send_clock_factor *
+                         params->iocr[input_iocr].reduction_ratio;
+        if (ticks == 0) ticks = 32;
+        dev->cycle_step = (uint16_t)ticks;
+        dev->period_us = emu->config.cycle_us ? emu->config.cycle_us
+                                              : (ticks * 3125) / 100;
+        setup_input_layout(emu, dev, req, input_iocr);
+
+        /* Provider starts right after Connect (IEC 61158-6-10 PPM) */
+        dev->cycle_counter = 0;
+        dev->next_nominal_us = now_us;
+        dev->next_tx_us = now_us;
+        __atomic_store_n(&dev->state, EMU_AR_CONNECTED, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&dev->lock);
+
+    uint8_t out[RPC_MAX_PDU_SIZE];
+    size_t out_len = sizeof(out);
+    if (rpc_build_connect_response(req, resp, out, &out_len) == WTC_OK) {
+        rpc_send_from(emu, dev, from, out, out_len);
+    }
+}
+
+static void send_app_ready(profinet_emulator_t *emu, emu_device_t *dev) {
+    uint8_t out[RPC_MAX_PDU_SIZE];
+    size_t out_len = sizeof(out);
+
+    if (dev->app_ready_tries == 0) {
+        rpc_generate_uuid(dev->rpc.activity_uuid);
+    }
+    if (rpc_build_app_ready_request(&dev->rpc, dev->ar_uuid, dev->session_key,
+                                    out, &out_len) == WTC_OK) {
+        rpc_send_from(emu, dev, &dev->controller_addr, out, out_len);
+        EMU_COUNT(emu, app_ready_sent);
+    }
+    dev->app_ready_tries++;
+    dev->app_ready_next_us = time_get_monotonic_us() + EMU_APP_READY_RETRY_US;
+}
+
+static void handle_control(profinet_emulator_t *emu, emu_device_t *dev,
+                           const uint8_t *buf, size_t len,
+                           const struct sockaddr_in *from) {
+    incoming_control_request_t req;
+    if (rpc_parse_incoming_control_request(buf, len, &req) != WTC_OK) {
+        EMU_COUNT(emu, rpc_errors);
+        return;
+    }
+
+    pthread_mutex_lock(&dev->lock);
+
+    if (dev->state == EMU_AR_IDLE ||
+        memcmp(req.ar_uuid, dev->ar_uuid, 16) != 0 ||
+        req.session_key != dev->session_key) {
+        pthread_mutex_unlock(&dev->lock);
+        LOG_DEBUG("%s: control request for unknown AR", dev->station_name);
+        EMU_COUNT(emu, rpc_errors);
+        return;
+    }
+
+    uint8_t out[RPC_MAX_PDU_SIZE];
+    size_t out_len = sizeof(out);
+    if (rpc_build_control_response(&dev->rpc, &req, out, &out_len) == WTC_OK) {
+        rpc_send_from(emu, dev, from, out, out_len);
+    }
+
+    if (req.opnum == RPC_OPNUM_RELEASE || (req.control_command & CONTROL_CMD_RELEASE)) {
+        if (dev->state == EMU_AR_RUNNING) {
+            pthread_mutex_lock(&emu->stats_lock);
+            emu->devices_running--;
+            pthread_mutex_unlock(&emu->stats_lock);
+        } else if (dev->state == EMU_AR_PRM_END) {
+            emu->app_ready_pending--;
+        }
+        dev->connect_rx_us = 0;
+        __atomic_store_n(&dev->state, EMU_AR_IDLE, __ATOMIC_RELEASE);
+        EMU_COUNT(emu, releases);
+    } else if ((req.control_command & CONTROL_CMD_PRM_END) &&
+               dev->state == EMU_AR_CONNECTED) {
+        EMU_COUNT(emu, prm_ends);
+        dev->controller_addr = *from;
+        dev->app_ready_tries = 0;
+        __atomic_store_n(&dev->state, EMU_AR_PRM_END, __ATOMIC_RELEASE);
+        emu->app_ready_pending++;
+        send_app_ready(emu, dev);
+    }
+
+    pthread_mutex_unlock(&dev->lock);
+}
+
+static void handle_app_ready_response(profinet_emulator_t *emu, emu_device_t *dev) {
+    uint64_t now_us = time_get_monotonic_us();
+
+    pthread_mutex_lock(&dev->lock);
+    if (dev->state != EMU_AR_PRM_END) {
+        pthread_mutex_unlock(&dev->lock);
+        return;
+    }
+    __atomic_store_n(&dev->state, EMU_AR_RUNNING, __ATOMIC_RELEASE);
+    emu->app_ready_pending--;
+    double latency_ms = (double)(now_us - dev->connect_rx_us) / 1000.0;
+    dev->connect_rx_us = 0;
+    pthread_mutex_unlock(&dev->lock);
+
+    EMU_COUNT(emu, app_ready_acks);
+
+    pthread_mutex_lock(&emu->stats_lock);
+    emu->devices_running++;
+    emu->latency_count++;
+    emu->latency_sum_ms += latency_ms;
+    if (emu->latency_count == 1 || latency_ms < emu->latency_min_ms) {
+        emu->latency_min_ms = latency_ms;
+    }
+    if (latency_ms > emu->latency_max_ms) {
+        emu->latency_max_ms = latency_ms;
+    }
+    if (emu->devices_running == emu->config.device_count && emu->storm_done_us == 0) {
+        emu->storm_done_us = now_us;
+        LOG_INFO("All %d devices running, %.1f ms after first Connect",
+                 emu->config.device_count,
+                 (double)(now_us - emu->first_connect_us) / 1000.0);
+    }
+    pthread_mutex_unlock(&emu->stats_lock);
+}
+
+static void retry_app_ready(profinet_emulator_t *emu) {
+    uint64_t now_us = time_get_monotonic_us();
+
+    for (int i = 0; i < emu->config.device_count; i++) {
+        emu_device_t *dev = &emu->devices[i];
+        if (__atomic_load_n(&dev->state, __ATOMIC_RELAXED) != EMU_AR_PRM_END) {
+            continue;
+        }
+
+        pthread_mutex_lock(&dev->lock);
+        if (dev->state == EMU_AR_PRM_END && dev->app_ready_next_us <= now_us) {
+            if (dev->app_ready_tries >= EMU_APP_READY_MAX_TRIES) {
+                LOG_WARN("%s: ApplicationReady never acknowledged", dev->station_name);
+                dev->connect_rx_us = 0;
+                emu->app_ready_pending--;
+                __atomic_store_n(&dev->state, EMU_AR_IDLE, __ATOMIC_RELEASE);
+            } else {
+                send_app_ready(emu, dev);
+            }
+        }
+        pthread_mutex_unlock(&dev->lock);
+    }
+}
+
+static void *rpc_thread_func(void *arg) {
+    profinet_emulator_t *emu = arg;
+    uint8_t buf[RPC_MAX_PDU_SIZE + 64];
+
+    while (emu_running(emu)) {
+        struct pollfd pfd = { .fd = emu->rpc_fd, .events = POLLIN };
+        if (poll(&pfd, 1, 50) > 0 && (pfd.revents & POLLIN)) {
+            struct sockaddr_in from;
+            char cbuf[CMSG_SPACE(sizeof(struct in_pktinfo))];
+            struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
+            struct msghdr msg = {
+                .msg_name = &from,
+                .msg_namelen = sizeof(from),
+                .msg_iov = &iov,
+                .msg_iovlen = 1,
+                .msg_control = cbuf,
+                .msg_controllen = sizeof(cbuf),
+            };
+
+            ssize_t len = recvmsg(emu->rpc_fd, &msg, 0);
+            if (len > 0) {
+                uint32_t local_ip = 0;
+                for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+                    if (c->cmsg_level == IPPROTO_IP && c->cmsg_type == IP_PKTINFO) {
+                        struct in_pktinfo *pi = (struct in_pktinfo *)CMSG_DATA(c);
+                        local_ip = ntohl(pi->ipi_addr.s_addr);
+                    }
+                }
+
+                emu_device_t *dev = find_device_by_ip(emu, local_ip);
+                uint8_t packet_type;
+                uint16_t opnum;
+                if (dev && rpc_peek_header(buf, (size_t)len, &packet_type, &opnum) == WTC_OK) {
+                    if (packet_type == RPC_PACKET_TYPE_REQUEST && opnum == RPC_OPNUM_CONNECT) {
+                        handle_connect(emu, dev, buf, (size_t)len, &from);
+                    } else if (packet_type == RPC_PACKET_TYPE_REQUEST &&
+                               (opnum == RPC_OPNUM_CONTROL || opnum == RPC_OPNUM_RELEASE)) {
+                        handle_control(emu, dev, buf, (size_t)len, &from);
+                    } else if (packet_type == RPC_PACKET_TYPE_RESPONSE &&
+                               opnum == RPC_OPNUM_CONTROL) {
+                        handle_app_ready_response(emu, dev);
+                    } else {
+                        LOG_DEBUG("%s: ignoring RPC type %u opnum %u",
+                                  dev->station_name, packet_type, opnum);
+                    }
+                }
+            }
+        }
+
+        if (emu->app_ready_pending > 0) {
+            retry_app_ready(emu);
+        }
+    }
+
+    return NULL;
+}
+
+/* ============== HTTP /slots ============== */
+
+static void serve_http_client(profinet_emulator_t *emu, int fd) {
+    char req[1024];
+    size_t req_len = 0;
+    struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    while (req_len < sizeof(req) - 1) {
+        ssize_t n = recv(fd, req + req_len, sizeof(req) - 1 - req_len, 0);
+        if (n <= 0) break;
+        req_len += (size_t)n;
+        req[req_len] = '\0';
+        if (strstr(req, "\r\n\r\n")) break;
+    }
+    req[req_len] = '\0';
+    EMU_COUNT(emu, http_requests);
+
+    struct sockaddr_in local;
+    socklen_t local_len = sizeof(local);
+    emu_device_t *dev = NULL;
+    if (getsockname(fd, (struct sockaddr *)&local, &local_len) == 0) {
+        dev = find_device_by_ip(emu, ntohl(local.sin_addr.s_addr));
+    }
+
+    char body[16384];
+    int body_len = 0;
+    const char *status = "404 Not Found";
+
+    if (dev && strncmp(req, "GET /slots ", 11) == 0) {
+        status = "200 OK";
+        body_len = snprintf(body, sizeof(body), "{\"slot_count\":%d,\"slots\":[",
+                            emu->module_count);
+        for (int i = 0; i < emu->module_count && body_len < (int)sizeof(body) - 160; i++) {
+            const emu_module_t *m = &emu->modules[i];
+            body_len += snprintf(body + body_len, sizeof(body) - (size_t)body_len,
+                                 "%s{\"slot\":%u,\"subslot\":1,\"module_ident\":%u,"
+                                 "\"submodule_ident\":%u,\"direction\":\"%s\","
+                                 "\"data_size\":%d}",
+                                 i ? "," : "", m->slot, m->module_ident,
+                                 m->submodule_ident, m->is_input ? "input" : "output",
+                                 m->is_input ? GSDML_INPUT_DATA_SIZE : GSDML_OUTPUT_DATA_SIZE);
+        }
+        body_len += snprintf(body + body_len, sizeof(body) - (size_t)body_len, "]}");
+    }
+
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 %s\r\nContent-Type: application/json\r\n"
+                              "Content-Length: %d\r\nConnection: close\r\n\r\n",
+                              status, body_len);
+    if (send(fd, header, (size_t)header_len, MSG_NOSIGNAL) > 0 && body_len > 0) {
+        send(fd, body, (size_t)body_len, MSG_NOSIGNAL);
+    }
+}
+
+static void *http_thread_func(void *arg) {
+    profinet_emulator_t *emu = arg;
+
+    while (emu_running(emu)) {
+        struct pollfd pfd = { .fd = emu->http_fd, .events = POLLIN };
+        if (poll(&pfd, 1, 100) <= 0 || !(pfd.revents & POLLIN)) {
+            continue;
+        }
+
+        int fd = accept(emu->http_fd, NULL, NULL);
+        if (fd < 0) continue;
+        serve_http_client(emu, fd);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+/* ============== Cyclic Input Frames ============== */
+
+static float waveform_value(const profinet_emulator_t *emu, const emu_module_t *m,
+                            const emu_device_t *dev, double t, uint32_t *rng) {
+    double x = t / emu->config.waveform_period_s + dev->phase;
+    double frac = x - floor(x);
+    float shape;
+
+    switch (emu->config.waveform) {
+    case EMU_WAVE_SINE:  shape = (float)sin(2.0 * M_PI * frac); break;
+    case EMU_WAVE_RAMP:  shape = (float)(2.0 * frac - 1.0); break;
+    case EMU_WAVE_NOISE: shape = 2.0f * rng_unit(rng) - 1.0f; break;
+    case EMU_WAVE_STEP:  shape = frac < 0.5 ? -1.0f : 1.0f; break;
+    default:             shape = 0.0f; break;
+    }
+
+    return m->base + m->amplitude * shape;
+}
+
+static void send_input_frame(profinet_emulator_t *emu, emu_device_t *dev,
+                             double t, uint32_t *rng) {
+    uint8_t buf[ETH_MAX_FRAME_LEN];
+    frame_builder_t b;
+    frame_builder_init(&b, buf, sizeof(buf), dev->mac);
+    frame_build_ethernet(&b, dev->controller_mac, PROFINET_ETHERTYPE);
+    frame_build_rt_header(&b, dev->input_frame_id);
+
+    if (b.position + dev->input_length + 4 > sizeof(buf)) {
+        return;
+    }
+
+    uint8_t *csdu = buf + b.position;
+    memset(csdu, 0, dev->input_length);
+
+    for (int i = 0; i < dev->entry_count; i++) {
+        const emu_io_entry_t *e = &dev->entries[i];
+        if (e->module >= 0 && e->length >= GSDML_INPUT_DATA_SIZE) {
+            float value = waveform_value(emu, &emu->modules[e->module], dev, t, rng);
+            uint32_t raw;
+            memcpy(&raw, &value, sizeof(raw));
+            raw = htonl(raw);
+            memcpy(csdu + e->offset, &raw, 4);
+            csdu[e->offset + 4] = QUALITY_GOOD;
+        }
+        csdu[e->offset + e->length] = IOPS_GOOD;
+    }
+    for (int i = 0; i < dev->iocs_count; i++) {
+        csdu[dev->iocs_offsets[i]] = IOPS_GOOD;
+    }
+    b.position += dev->input_length;
+
+    dev->cycle_counter = (uint16_t)(dev->cycle_counter + dev->cycle_step);
+    uint8_t trailer[4] = {
+        (uint8_t)(dev->cycle_counter >> 8), (uint8_t)dev->cycle_counter,
+        PROFINET_DATA_STATUS_STATE | PROFINET_DATA_STATUS_VALID | PROFINET_DATA_STATUS_RUN,
+        0,  /* Transfer status */
+    };
+    frame_append_data(&b, trailer, sizeof(trailer));
+    frame_append_padding(&b, ETH_MIN_FRAME_LEN);
+
+    if (send(emu->raw_fd, buf, b.position, 0) < 0) {
+        EMU_COUNT(emu, frames_dropped);
+        return;
+    }
+    EMU_COUNT(emu, frames_tx);
+}
+
+static void *cyclic_thread_func(void *arg) {
+    profinet_emulator_t *emu = arg;
+    uint32_t rng = 0x9E3779B9u;
+
+    while (emu_running(emu)) {
+        uint64_t now_us = time_get_monotonic_us();
+        uint64_t wake_us = now_us + 10000;
+        double t = (double)(now_us - emu->start_us) / 1e6;
+
+        for (int i = 0; i < emu->config.device_count; i++) {
+            emu_device_t *dev = &emu->devices[i];
+            if (__atomic_load_n(&dev->state, __ATOMIC_ACQUIRE) == EMU_AR_IDLE) {
+                continue;
+            }
+
+            pthread_mutex_lock(&dev->lock);
+            if (dev->state != EMU_AR_IDLE) {
+                if (dev->next_tx_us <= now_us) {
+                    if (emu->config.loss_percent > 0.0f &&
+                        rng_unit(&rng) * 100.0f < emu->config.loss_percent) {
+                        dev->cycle_counter = (uint16_t)(dev->cycle_counter + dev->cycle_step);
+                        EMU_COUNT(emu, frames_dropped);
+                    } else {
+                        send_input_frame(emu, dev, t, &rng);
+                    }
+
+                    dev->next_nominal_us += dev->period_us;
+                    if (dev->next_nominal_us < now_us) {
+                        dev->next_nominal_us = now_us + dev->period_us;  /* Fell behind */
+                    }
+                    dev->next_tx_us = dev->next_nominal_us;
+                    if (emu->config.jitter_us > 0) {
+                        dev->next_tx_us += (uint64_t)(rng_unit(&rng) * emu->config.jitter_us);
+                    }
+                }
+                if (dev->next_tx_us < wake_us) {
+                    wake_us = dev->next_tx_us;
+                }
+            }
+            pthread_mutex_unlock(&dev->lock);
+        }
+
+        struct timespec ts = {
+            .tv_sec = (time_t)(wake_us / 1000000),
+            .tv_nsec = (long)(wake_us % 1000000) * 1000,
+        };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+
+    return NULL;
+}
+
+/* ============== Sockets ============== */
+
+static wtc_result_t open_raw_socket(profinet_emulator_t *emu) {
+    emu->if_index = (int)if_nametoindex(emu->config.interface_name);
+    if (emu->if_index == 0) {
+        LOG_ERROR("Interface %s not found", emu->config.interface_name);
+        return WTC_ERROR_NOT_FOUND;
+    }
+
+    emu->raw_fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (emu->raw_fd < 0) {
+        LOG_ERROR("Failed to create raw socket: %s (needs CAP_NET_RAW)", strerror(errno));
+        return WTC_ERROR_IO;
+    }
+
+    struct sockaddr_ll sll = {
+        .sll_family = AF_PACKET,
+        .sll_protocol = htons(ETH_P_ALL),
+        .sll_ifindex = emu->if_index,
+    };
+    if (bind(emu->raw_fd, (struct sockaddr *)&sll, sizeof(sll)) < 0) {
+        LOG_ERROR("Failed to bind raw socket to %s: %s",
+                  emu->config.interface_name, strerror(errno));
+        return WTC_ERROR_IO;
+    }
+
+    /* Output frames are addressed to the emulated MACs, not ours */
+    struct packet_mreq mreq = {
+        .mr_ifindex = emu->if_index,
+        .mr_type = PACKET_MR_PROMISC,
+    };
+    if (setsockopt(emu->raw_fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP,
+                   &mreq, sizeof(mreq)) < 0) {
+        LOG_WARN("Promiscuous mode on %s failed: %s",
+                 emu->config.interface_name, strerror(errno));
+    }
+
+    return WTC_OK;
+}
+
+static int open_inet_socket(int type, uint16_t port) {
+    int fd = socket(AF_INET, type, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* ============== Public Functions ============== */
+
+void emulator_config_defaults(emulator_config_t *config) {
+    if (!config) return;
+
+    memset(config, 0, sizeof(*config));
+    strncpy(config->interface_name, "lo", sizeof(config->interface_name) - 1);
+    config->device_count = 64;
+    config->sensors_per_device = 4;
+    config->actuators_per_device = 2;
+    static const uint8_t mac[6] = { 0x02, 0x57, 0x54, 0x00, 0x00, 0x01 };
+    memcpy(config->base_mac, mac, 6);
+    config->base_ip = 0x7F000A02;       /* 127.0.10.2 */
+    config->netmask = 0xFFFFFF00;
+    strncpy(config->name_prefix, "rtu-emu-", sizeof(config->name_prefix) - 1);
+    config->waveform = EMU_WAVE_SINE;
+    config->waveform_period_s = 60.0f;
+    config->http_port = EMU_DEFAULT_HTTP_PORT;
+}
+
+wtc_result_t emulator_init(profinet_emulator_t **emulator,
+                           const emulator_config_t *config) {
+    if (!emulator || !config || config->device_count <= 0 ||
+        config->device_count > EMU_MAX_DEVICES ||
+        config->sensors_per_device < 0 || config->sensors_per_device > EMU_MAX_SENSORS ||
+        config->actuators_per_device < 0 || config->actuators_per_device > EMU_MAX_ACTUATORS) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    profinet_emulator_t *emu = calloc(1, sizeof(profinet_emulator_t));
+    if (!emu) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    memcpy(&emu->config, config, sizeof(emulator_config_t));
+    if (emu->config.waveform_period_s <= 0.0f) {
+        emu->config.waveform_period_s = 60.0f;
+    }
+    emu->raw_fd = -1;
+    emu->rpc_fd = -1;
+    emu->http_fd = -1;
+    pthread_mutex_init(&emu->stats_lock, NULL);
+
+    emu->devices = calloc((size_t)config->device_count, sizeof(emu_device_t));
+    if (!emu->devices) {
+        free(emu);
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    build_module_list(emu);
+    init_devices(emu);
+
+    wtc_result_t res = open_raw_socket(emu);
+    if (res != WTC_OK) {
+        emulator_cleanup(emu);
+        return res;
+    }
+
+    emu->rpc_fd = open_inet_socket(SOCK_DGRAM, PNIO_RPC_PORT);
+    int one = 1;
+    if (emu->rpc_fd < 0 ||
+        setsockopt(emu->rpc_fd, IPPROTO_IP, IP_PKTINFO, &one, sizeof(one)) < 0) {
+        LOG_ERROR("Failed to open RPC socket on port %d: %s", PNIO_RPC_PORT, strerror(errno));
+        emulator_cleanup(emu);
+        return WTC_ERROR_IO;
+    }
+
+    if (config->http_port != 0) {
+        emu->http_fd = open_inet_socket(SOCK_STREAM, config->http_port);
+        if (emu->http_fd < 0 || listen(emu->http_fd, 256) < 0) {
+            LOG_ERROR("Failed to open HTTP socket on port %u: %s",
+                      config->http_port, strerror(errno));
+            emulator_cleanup(emu);
+            return WTC_ERROR_IO;
+        }
+    }
+
+    char first_ip[16], last_ip[16];
+    ip_to_string(emu->devices[0].ip, first_ip, sizeof(first_ip));
+    ip_to_string(emu->devices[config->device_count - 1].ip, last_ip, sizeof(last_ip));
+    LOG_INFO("Emulating %d devices on %s (%s .. %s, %d modules each)",
+             config->device_count, config->interface_name, first_ip, last_ip,
+             emu->module_count);
+
+    *emulator = emu;
+    return WTC_OK;
+}
+
+void emulator_cleanup(profinet_emulator_t *emulator) {
+    if (!emulator) return;
+
+    emulator_stop(emulator);
+
+    if (emulator->raw_fd >= 0) close(emulator->raw_fd);
+    if (emulator->rpc_fd >= 0) close(emulator->rpc_fd);
+    if (emulator->http_fd >= 0) close(emulator->http_fd);
+
+    if (emulator->devices) {
+        for (int i = 0; i < emulator->config.device_count; i++) {
+            pthread_mutex_destroy(&emulator->devices[i].lock);
+        }
+        free(emulator->devices);
+    }
+    pthread_mutex_destroy(&emulator->stats_lock);
+    free(emulator);
+}
+
+wtc_result_t emulator_start(profinet_emulator_t *emulator) {
+    if (!emulator) return WTC_ERROR_INVALID_PARAM;
+    if (emulator->threads_started) return WTC_OK;
+
+    emulator->start_us = time_get_monotonic_us();
+    __atomic_store_n(&emulator->running, true, __ATOMIC_RELEASE);
+
+    if (pthread_create(&emulator->l2_thread, NULL, l2_thread_func, emulator) != 0 ||
+        pthread_create(&emulator->rpc_thread, NULL, rpc_thread_func, emulator) != 0 ||
+        pthread_create(&emulator->cyclic_thread, NULL, cyclic_thread_func, emulator) != 0) {
+        LOG_ERROR("Failed to start emulator threads");
+        __atomic_store_n(&emulator->running, false, __ATOMIC_RELEASE);
+        return WTC_ERROR;
+    }
+    if (emulator->http_fd >= 0 &&
+        pthread_create(&emulator->http_thread, NULL, http_thread_func, emulator) != 0) {
+        LOG_ERROR("Failed to start HTTP thread");
+    }
+
+    emulator->threads_started = true;
+    return WTC_OK;
+}
+
+void emulator_stop(profinet_emulator_t *emulator) {
+    if (!emulator || !emulator->threads_started) return;
+
+    __atomic_store_n(&emulator->running, false, __ATOMIC_RELEASE);
+    pthread_join(emulator->l2_thread, NULL);
+    pthread_join(emulator->rpc_thread, NULL);
+    pthread_join(emulator->cyclic_thread, NULL);
+    if (emulator->http_fd >= 0) {
+        pthread_join(emulator->http_thread, NULL);
+    }
+    emulator->threads_started = false;
+}
+
+void emulator_get_stats(profinet_emulator_t *emulator, emulator_stats_t *stats) {
+    if (!emulator || !stats) return;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->device_count = emulator->config.device_count;
+
+    stats->frames_tx = __atomic_load_n(&emulator->frames_tx, __ATOMIC_RELAXED);
+    stats->frames_rx = __atomic_load_n(&emulator->frames_rx, __ATOMIC_RELAXED);
+    stats->frames_dropped = __atomic_load_n(&emulator->frames_dropped, __ATOMIC_RELAXED);
+    stats->dcp_responses = __atomic_load_n(&emulator->dcp_responses, __ATOMIC_RELAXED);
+    stats->http_requests = __atomic_load_n(&emulator->http_requests, __ATOMIC_RELAXED);
+    stats->connects = __atomic_load_n(&emulator->connects, __ATOMIC_RELAXED);
+    stats->connect_diffs = __atomic_load_n(&emulator->connect_diffs, __ATOMIC_RELAXED);
+    stats->prm_ends = __atomic_load_n(&emulator->prm_ends, __ATOMIC_RELAXED);
+    stats->app_ready_sent = __atomic_load_n(&emulator->app_ready_sent, __ATOMIC_RELAXED);
+    stats->app_ready_acks = __atomic_load_n(&emulator->app_ready_acks, __ATOMIC_RELAXED);
+    stats->releases = __atomic_load_n(&emulator->releases, __ATOMIC_RELAXED);
+    stats->rpc_errors = __atomic_load_n(&emulator->rpc_errors, __ATOMIC_RELAXED);
+
+    uint64_t now_us = time_get_monotonic_us();
+    stats->elapsed_s = emulator->start_us ? (double)(now_us - emulator->start_us) / 1e6 : 0.0;
+
+    pthread_mutex_lock(&emulator->stats_lock);
+    stats->devices_running = emulator->devices_running;
+    if (emulator->storm_done_us) {
+        stats->storm_ms = (double)(emulator->storm_done_us - emulator->first_connect_us) / 1000.0;
+    }
+    if (emulator->latency_count > 0) {
+        stats->connect_ms_min = emulator->latency_min_ms;
+        stats->connect_ms_avg = emulator->latency_sum_ms / (double)emulator->latency_count;
+        stats->connect_ms_max = emulator->latency_max_ms;
+    }
+    pthread_mutex_unlock(&emulator->stats_lock);
+
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        stats->cpu_s = (double)ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+                       (double)ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    }
+    if (stats->elapsed_s > 0.0) {
+        stats->cycles_per_sec = (double)stats->frames_tx / stats->elapsed_s;
+        if (stats->devices_running > 0) {
+            stats->cpu_percent_per_ar = 100.0 * stats->cpu_s / stats->elapsed_s /
+                                        stats->devices_running;
+        }
+    }
+}
+
+int emulator_stats_to_json(const emulator_stats_t *stats, char *buffer, size_t size) {
+    if (!stats || !buffer || size == 0) return 0;
+
+    int len = snprintf(buffer, size,
+        "{\n"
+        "  \"devices\": %d,\n"
+        "  \"devices_running\": %d,\n"
+        "  \"elapsed_s\": %.3f,\n"
+        "  \"connect_storm_ms\": %.3f,\n"
+        "  \"connect_ms\": {\"min\": %.3f, \"avg\": %.3f, \"max\": %.3f},\n"
+        "  \"cycles_per_sec\": %.1f,\n"
+        "  \"cpu_s\": %.3f,\n"
+        "  \"cpu_percent_per_ar\": %.4f,\n"
+        "  \"frames\": {\"tx\": %llu, \"rx\": %llu, \"dropped\": %llu},\n"
+        "  \"rpc\": {\"connects\": %llu, \"connect_diffs\": %llu, \"prm_ends\": %llu, "
+        "\"app_ready_sent\": %llu, \"app_ready_acks\": %llu, \"releases\": %llu, "
+        "\"errors\": %llu},\n"
+        "  \"dcp_responses\": %llu,\n"
+        "  \"http_requests\": %llu\n"
+        "}\n",
+        stats->device_count, stats->devices_running, stats->elapsed_s,
+        stats->storm_ms,
+        stats->connect_ms_min, stats->connect_ms_avg, stats->connect_ms_max,
+        stats->cycles_per_sec, stats->cpu_s, stats->cpu_percent_per_ar,
+        (unsigned long long)stats->frames_tx, (unsigned long long)stats->frames_rx,
+        (unsigned long long)stats->frames_dropped,
+        (unsigned long long)stats->connects, (unsigned long long)stats->connect_diffs,
+        (unsigned long long)stats->prm_ends, (unsigned long long)stats->app_ready_sent,
+        (unsigned long long)stats->app_ready_acks, (unsigned long long)stats->releases,
+        (unsigned long long)stats->rpc_errors,
+        (unsigned long long)stats->dcp_responses,
+        (unsigned long long)stats->http_requests);
+
+    return (len < 0 || (size_t)len >= size) ? (int)size - 1 : len;
+}
@@ -0,0 +1,122 @@
+/*
+ * Water Treatment Controller - PROFINET IO-Device Emulator
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Impersonates N RTUs on the wire so the controller's DCP, RPC, AR
+ * manager and cyclic threads can be load-tested without hardware.
+ * Unlike simulator.c, nothing is written into the registry: every
+ * emulated device answers DCP Identify, accepts Connect / PrmEnd,
+ * sends ApplicationReady, serves HTTP /slots and produces RTC1 input
+ * frames from configurable waveforms.
+ *
+ * Devices get consecutive MACs, IPs and station names. On a veth/tap
+ * pair the device IPs must be routable to this host, e.g.
+ *   ip addr add 192.168.100.10/24 dev veth-emu   (one per device)
+ * On lo, every 127.0.0.0/8 address is already local.
+ */
+
+#ifndef WTC_PROFINET_EMULATOR_H
+#define WTC_PROFINET_EMULATOR_H
+
+#include "../types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EMU_MAX_DEVICES         4096
+#define EMU_MAX_SENSORS         64
+#define EMU_MAX_ACTUATORS       32
+#define EMU_DEFAULT_HTTP_PORT   9081
+
+/* Sensor waveform */
+typedef enum {
+    EMU_WAVE_SINE = 0,
+    EMU_WAVE_RAMP,
+    EMU_WAVE_NOISE,
+    EMU_WAVE_STEP,
+    EMU_WAVE_CONST,
+} emu_waveform_t;
+
+/* Emulator configuration */
+typedef struct {
+    char interface_name[32];
+    int device_count;
+    int sensors_per_device;         /* Input modules, slots 1..N */
+    int actuators_per_device;       /* Output modules after the sensors */
+
+    uint8_t base_mac[6];            /* MAC of device 0, incremented per device */
+    uint32_t base_ip;               /* IP of device 0 (host order) */
+    uint32_t netmask;
+    char name_prefix[48];           /* Station name = prefix + index */
+
+    emu_waveform_t waveform;
+    float waveform_period_s;
+    uint32_t cycle_us;              /* Input frame period, 0 = from the AR */
+    uint32_t jitter_us;             /* Random extra delay per frame */
+    float loss_percent;             /* Input frames silently not sent */
+
+    uint16_t http_port;             /* 0 = do not serve /slots */
+} emulator_config_t;
+
+/* Emulator statistics */
+typedef struct {
+    int device_count;
+    int devices_running;            /* ApplicationReady acknowledged */
+
+    uint64_t frames_tx;             /* Input frames sent */
+    uint64_t frames_rx;             /* Output frames received */
+    uint64_t frames_dropped;        /* Input frames lost on purpose */
+    uint64_t dcp_responses;
+    uint64_t http_requests;
+
+    uint64_t connects;
+    uint64_t connect_diffs;         /* Connects answered with a ModuleDiffBlock */
+    uint64_t prm_ends;
+    uint64_t app_ready_sent;
+    uint64_t app_ready_acks;
+    uint64_t releases;
+    uint64_t rpc_errors;
+
+    double elapsed_s;
+    double storm_ms;                /* First Connect to all devices running, 0 = not yet */
+    double connect_ms_min;          /* Connect to ApplicationReady acknowledged */
+    double connect_ms_avg;
+    double connect_ms_max;
+
+    double cpu_s;                   /* User + system time of the process */
+    double cpu_percent_per_ar;
+    double cycles_per_sec;          /* Input frames per second */
+} emulator_stats_t;
+
+/* Emulator handle */
+typedef struct profinet_emulator profinet_emulator_t;
+
+/* Fill configuration with defaults (64 devices, 4 sensors, 2 actuators) */
+void emulator_config_defaults(emulator_config_t *config);
+
+/* Initialize emulator; opens the raw, RPC and HTTP sockets */
+wtc_result_t emulator_init(profinet_emulator_t **emulator,
+                           const emulator_config_t *config);
+
+/* Stop and free emulator */
+void emulator_cleanup(profinet_emulator_t *emulator);
+
+/* Start the L2, RPC, HTTP and cyclic threads */
+wtc_result_t emulator_start(profinet_emulator_t *emulator);
+
+/* Stop all threads */
+void emulator_stop(profinet_emulator_t *emulator);
+
+/* Get statistics */
+void emulator_get_stats(profinet_emulator_t *emulator, emulator_stats_t *stats);
+
+/* Format statistics as JSON; returns the length written */
+int emulator_stats_to_json(const emulator_stats_t *stats, char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_PROFINET_EMULATOR_H */
@@ -0,0 +1,236 @@
+/*
+ * Water Treatment Controller - PROFINET IO-Device Emulator
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Standalone executable that impersonates N RTUs for load and latency
+ * testing of the controller. Typical single-host run:
+ *
+ *   ./profinet_emulator -i lo -n 256 --duration 60 -o emu.json &
+ *   ./water_treat_controller -i lo
+ *
+ * Statistics (cycles/sec, CPU per AR, connect-storm time) are written
+ * as JSON when the run ends.
+ */
+
+#include "profinet_emulator.h"
+#include "../profinet/profinet_frame.h"
+#include "../utils/logger.h"
+#include "../utils/time_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+
+static volatile sig_atomic_t g_running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    g_running = 0;
+}
+
+static void print_usage(const char *progname) {
+    printf("Usage: %s [options]\n", progname);
+    printf("\nOptions:\n");
+    printf("  -i, --interface IFACE   Interface to emulate on (default: lo)\n");
+    printf("  -n, --devices N         Number of emulated RTUs (default: 64)\n");
+    printf("      --sensors N         Input modules per RTU (default: 4)\n");
+    printf("      --actuators N       Output modules per RTU (default: 2)\n");
+    printf("      --base-ip IP        IP of the first RTU (default: 127.0.10.2)\n");
+    printf("      --base-mac MAC      MAC of the first RTU (default: 02:57:54:00:00:01)\n");
+    printf("      --name-prefix STR   Station name prefix (default: rtu-emu-)\n");
+    printf("      --waveform W        sine, ramp, noise, step or const (default: sine)\n");
+    printf("      --period S          Waveform period in seconds (default: 60)\n");
+    printf("      --cycle-us US       Input frame period, overrides the AR timing\n");
+    printf("      --jitter-us US      Random extra delay per input frame\n");
+    printf("      --loss PCT          Percentage of input frames not sent\n");
+    printf("      --http-port PORT    Port for /slots, 0 = off (default: %d)\n",
+           EMU_DEFAULT_HTTP_PORT);
+    printf("  -d, --duration S        Stop after S seconds (default: until SIGINT)\n");
+    printf("  -o, --output FILE       Write JSON statistics to FILE (default: stdout)\n");
+    printf("  -v, --verbose           Debug logging and per-second progress\n");
+    printf("  -h, --help              Show this help\n");
+}
+
+static bool parse_waveform(const char *name, emu_waveform_t *waveform) {
+    static const struct { const char *name; emu_waveform_t wave; } names[] = {
+        { "sine", EMU_WAVE_SINE }, { "ramp", EMU_WAVE_RAMP },
+        { "noise", EMU_WAVE_NOISE }, { "step", EMU_WAVE_STEP },
+        { "const", EMU_WAVE_CONST },
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(name, names[i].name) == 0) {
+            *waveform = names[i].wave;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    emulator_config_t config;
+    emulator_config_defaults(&config);
+    int duration_s = 0;
+    const char *output_file = NULL;
+    bool verbose = false;
+
+    enum {
+        OPT_SENSORS = 256, OPT_ACTUATORS, OPT_BASE_IP, OPT_BASE_MAC, OPT_NAME_PREFIX,
+        OPT_WAVEFORM, OPT_PERIOD, OPT_CYCLE_US, OPT_JITTER_US, OPT_LOSS, OPT_HTTP_PORT,
+    };
+    static struct option long_options[] = {
+        {"interface",   required_argument, 0, 'i'},
+        {"devices",     required_argument, 0, 'n'},
+        {"sensors",     required_argument, 0, OPT_SENSORS},
+        {"actuators",   required_argument, 0, OPT_ACTUATORS},
+        {"base-ip",     required_argument, 0, OPT_BASE_IP},
+        {"base-mac",    required_argument, 0, OPT_BASE_MAC},
+        {"name-prefix", required_argument, 0, OPT_NAME_PREFIX},
+        {"waveform",    required_argument, 0, OPT_WAVEFORM},
+        {"period",      required_argument, 0, OPT_PERIOD},
+        {"cycle-us",    required_argument, 0, OPT_CYCLE_US},
+        {"jitter-us",   required_argument, 0, OPT_JITTER_US},
+        {"loss",        required_argument, 0, OPT_LOSS},
+        {"http-port",   required_argument, 0, OPT_HTTP_PORT},
+        {"duration",    required_argument, 0, 'd'},
+        {"output",      required_argument, 0, 'o'},
+        {"verbose",     no_argument,       0, 'v'},
+        {"help",        no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:n:d:o:vh", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'i':
+            strncpy(config.interface_name, optarg, sizeof(config.interface_name) - 1);
+            break;
+        case 'n':
+            config.device_count = atoi(optarg);
+            break;
+        case OPT_SENSORS:
+            config.sensors_per_device = atoi(optarg);
+            break;
+        case OPT_ACTUATORS:
+            config.actuators_per_device = atoi(optarg);
+            break;
+        case OPT_BASE_IP:
+            config.base_ip = string_to_ip(optarg);
+            break;
+        case OPT_BASE_MAC:
+            if (!string_to_mac(optarg, config.base_mac)) {
+                fprintf(stderr, "Invalid MAC address: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_NAME_PREFIX:
+            strncpy(config.name_prefix, optarg, sizeof(config.name_prefix) - 1);
+            break;
+        case OPT_WAVEFORM:
+            if (!parse_waveform(optarg, &config.waveform)) {
+                fprintf(stderr, "Unknown waveform: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_PERIOD:
+            config.waveform_period_s = (float)atof(optarg);
+            break;
+        case OPT_CYCLE_US:
+            config.cycle_us = (uint32_t)atoi(optarg);
+            break;
+        case OPT_JITTER_US:
+            config.jitter_us = (uint32_t)atoi(optarg);
+            break;
+        case OPT_LOSS:
+            config.loss_percent = (float)atof(optarg);
+            break;
+        case OPT_HTTP_PORT:
+            config.http_port = (uint16_t)atoi(optarg);
+            break;
+        case 'd':
+            duration_s = atoi(optarg);
+            break;
+        case 'o':
+            output_file = optarg;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    logger_config_t log_config = {
+        .level = verbose ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO,
+        .output = stderr,
+        .include_timestamp = true,
+    };
+    logger_init(&log_config);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    profinet_emulator_t *emulator = NULL;
+    wtc_result_t res = emulator_init(&emulator, &config);
+    if (res != WTC_OK) {
+        fprintf(stderr, "Failed to initialize emulator: %d\n", res);
+        return 1;
+    }
+
+    res = emulator_start(emulator);
+    if (res != WTC_OK) {
+        emulator_cleanup(emulator);
+        return 1;
+    }
+
+    uint64_t end_ms = duration_s > 0 ? time_get_monotonic_ms() + (uint64_t)duration_s * 1000 : 0;
+    while (g_running && (end_ms == 0 || time_get_monotonic_ms() < end_ms)) {
+        time_sleep_ms(1000);
+
+        if (verbose) {
+            emulator_stats_t stats;
+            emulator_get_stats(emulator, &stats);
+            LOG_INFO("running %d/%d, %.0f frames/s, rx %llu, connects %llu",
+                     stats.devices_running, stats.device_count, stats.cycles_per_sec,
+                     (unsigned long long)stats.frames_rx,
+                     (unsigned long long)stats.connects);
+        }
+    }
+
+    emulator_stop(emulator);
+
+    emulator_stats_t stats;
+    emulator_get_stats(emulator, &stats);
+    char json[2048];
+    int len = emulator_stats_to_json(&stats, json, sizeof(json));
+
+    FILE *out = stdout;
+    if (output_file) {
+        out = fopen(output_file, "w");
+        if (!out) {
+            perror(output_file);
+            out = stdout;
+        }
+    }
+    fwrite(json, 1, (size_t)len, out);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    emulator_cleanup(emulator);
+    logger_cleanup();
+    return 0;
+}
@@ -5,6 +5,8 @@
  */
 
 #include "simulator.h"
+#include "plant_model.h"
+#include "../core/latency_trace.h"
 #include "../utils/logger.h"
 #include "../utils/time_utils.h"
 
@@ -17,7 +19,7 @@
 #define M_PI 3.14159265358979323846
 #endif
 
-/* Maximum simulated RTUs */
+/* RTUs in the built-in scenarios; the fleet scenario grows the table */
 #define SIM_MAX_RTUS 16
 #define SIM_MAX_SENSORS_PER_RTU 32
 #define SIM_MAX_ACTUATORS_PER_RTU 16
@@ -29,22 +31,72 @@ typedef struct {
     sim_actuator_state_t actuators[SIM_MAX_ACTUATORS_PER_RTU];
     float sensor_values[SIM_MAX_SENSORS_PER_RTU];
     data_quality_t sensor_quality[SIM_MAX_SENSORS_PER_RTU];
+    int plant_sensor[SIM_MAX_SENSORS_PER_RTU];      /* Plant unit, -1 = waveform */
+    int plant_actuator[SIM_MAX_ACTUATORS_PER_RTU];  /* Plant unit, -1 = no effect */
+    uint64_t traced_source_us[SIM_MAX_ACTUATORS_PER_RTU]; /* Last trace closed */
     bool fault_injected;
     int fault_type;
+
+    /* Sensor slots and waveform parameters laid out for batch evaluation */
+    int slots[SIM_MAX_SENSORS_PER_RTU];
+    float wave_base[SIM_MAX_SENSORS_PER_RTU];
+    float wave_amp[SIM_MAX_SENSORS_PER_RTU];
+    double wave_freq[SIM_MAX_SENSORS_PER_RTU];  /* Trend cycles per second */
+    float wave_phase[SIM_MAX_SENSORS_PER_RTU];
+    float wave_noise[SIM_MAX_SENSORS_PER_RTU];
+    float wave_min[SIM_MAX_SENSORS_PER_RTU];
+    float wave_max[SIM_MAX_SENSORS_PER_RTU];
 } sim_rtu_t;
 
+/* xoshiro128+ generator state, one per thread */
+typedef struct {
+    uint32_t s[4];
+} sim_rng_t;
+
+/* Worker updating a contiguous range of RTUs */
+typedef struct {
+    simulator_t *sim;
+    pthread_t thread;
+    int index;
+    sim_rng_t rng;
+} sim_worker_t;
+
 /* Simulator internal state */
 struct simulator {
     simulator_config_t config;
-    sim_rtu_t rtus[SIM_MAX_RTUS];
+    sim_rtu_t *rtus;
     int rtu_count;
+    int rtu_capacity;
     rtu_registry_t *registry;
     bool running;
     uint64_t start_time_ms;
     uint32_t update_count;
     pthread_mutex_t lock;
+
+    /* Closed-loop process model (enable_pid_response) */
+    plant_model_t *plant;
+    bool plant_owned;               /* Built from the scenario, freed by us */
+    double virtual_time_s;          /* Simulated seconds since start */
+    uint64_t last_process_ms;
+
+    sim_rng_t rng;                  /* For updates on the calling thread */
+    latency_trace_t *trace;         /* Closed when the plant takes an output */
+
+    /* Worker pool (worker_threads > 0) */
+    sim_worker_t *workers;
+    int worker_count;
+    pthread_mutex_t work_lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    uint32_t work_generation;
+    int work_pending;
+    double work_time_s;
+    bool work_exit;
 };
 
+#define SIM_DEFAULT_SEED        0x5713EEDu
+#define SIM_FLEET_DEFAULT_RTUS  256
+
 /* Scenario names for lookup */
 static const char *scenario_names[] = {
     [SIM_SCENARIO_NORMAL] = "normal",
@@ -53,6 +105,7 @@ static const char *scenario_names[] = {
     [SIM_SCENARIO_HIGH_LOAD] = "high_load",
     [SIM_SCENARIO_MAINTENANCE] = "maintenance",
     [SIM_SCENARIO_WATER_TREATMENT] = "water_treatment_plant",
+    [SIM_SCENARIO_FLEET] = "fleet",
 };
 
 const char *simulator_scenario_name(sim_scenario_t scenario) {
@@ -78,28 +131,115 @@ sim_scenario_t simulator_parse_scenario(const char *name) {
     return SIM_SCENARIO_NORMAL;
 }
 
+static inline uint32_t rng_rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+static uint32_t rng_next(sim_rng_t *rng) {
+    uint32_t *st = rng->s;
+    uint32_t result = st[0] + st[3];
+    uint32_t t = st[1] << 9;
+
+    st[2] ^= st[0];
+    st[3] ^= st[1];
+    st[1] ^= st[2];
+    st[0] ^= st[3];
+    st[2] ^= t;
+    st[3] = rng_rotl(st[3], 11);
+
+    return result;
+}
+
+/* Seed through splitmix64 so neighbouring seeds give unrelated streams */
+static void rng_seed(sim_rng_t *rng, uint64_t seed) {
+    for (int i = 0; i < 4; i += 2) {
+        seed += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+        rng->s[i] = (uint32_t)z;
+        rng->s[i + 1] = (uint32_t)(z >> 32);
+    }
+}
+
+/* Uniform in [-1, 1) */
+static float rng_signed(sim_rng_t *rng) {
+    return (float)(rng_next(rng) >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
 /* Generate random noise in range [-amplitude, +amplitude] */
-static float random_noise(float amplitude) {
-    return ((float)rand() / RAND_MAX * 2.0f - 1.0f) * amplitude;
+static float random_noise(sim_rng_t *rng, float amplitude) {
+    return rng_signed(rng) * amplitude;
+}
+
+/* sin(2*pi*turns) for turns >= 0, without a libm call so the batch loop
+ * below vectorizes; absolute error below 4e-6 */
+static inline float sin_turns(float turns) {
+    float y = turns - (float)(int32_t)turns - 0.5f;    /* [-0.5, 0.5) */
+    float a = fabsf(y);
+    a = a > 0.25f ? 0.5f - a : a;                       /* Fold to [0, 0.25] */
+
+    float z = 2.0f * (float)M_PI * a;
+    float z2 = z * z;
+    float sin_z = z * (1.0f + z2 * (-1.0f / 6.0f + z2 * (1.0f / 120.0f +
+                  z2 * (-1.0f / 5040.0f + z2 * (1.0f / 362880.0f)))));
+
+    /* sin(2*pi*(y + 0.5)) = -sin(2*pi*y) */
+    return y < 0.0f ? sin_z : -sin_z;
 }
 
-/* Calculate sensor value at time t */
-static float calculate_sensor_value(const sim_sensor_config_t *sensor, float t) {
-    /* Base value with sinusoidal trend */
-    float trend = 0.0f;
-    if (sensor->trend_period_sec > 0) {
-        trend = sensor->trend_amplitude * sinf(2.0f * M_PI * t / sensor->trend_period_sec);
+/* Copy one RTU's sensor configuration into the batch layout */
+static void prepare_waveforms(sim_rtu_t *rtu) {
+    for (int j = 0; j < rtu->config.sensor_count; j++) {
+        const sim_sensor_config_t *sensor = &rtu->sensors[j];
+        bool periodic = sensor->trend_period_sec > 0;
+
+        rtu->slots[j] = sensor->slot;
+        rtu->wave_base[j] = sensor->base_value;
+        rtu->wave_amp[j] = periodic ? sensor->trend_amplitude : 0.0f;
+        rtu->wave_freq[j] = periodic ? 1.0 / sensor->trend_period_sec : 0.0;
+        rtu->wave_phase[j] = sensor->trend_phase - floorf(sensor->trend_phase);
+        rtu->wave_noise[j] = sensor->noise_amplitude;
+        rtu->wave_min[j] = sensor->min_value;
+        rtu->wave_max[j] = sensor->max_value;
     }
+}
 
-    /* Add random noise */
-    float noise = random_noise(sensor->noise_amplitude);
+/* Base value + sinusoidal trend + noise for every sensor of one RTU at
+ * time t, evaluated as one batch. The trend phase is reduced in double,
+ * so long runs keep their resolution; only the reduced turn is float. */
+static void compute_waveforms(sim_rtu_t *rtu, double t, sim_rng_t *rng) {
+    int n = rtu->config.sensor_count;
+    float noise[SIM_MAX_SENSORS_PER_RTU];
 
-    /* Combine and clamp */
-    float value = sensor->base_value + trend + noise;
-    if (value < sensor->min_value) value = sensor->min_value;
-    if (value > sensor->max_value) value = sensor->max_value;
+    /* The generator is serial; the waveform pass is not */
+    for (int j = 0; j < n; j++) {
+        noise[j] = rng_signed(rng);
+    }
 
-    return value;
+    for (int j = 0; j < n; j++) {
+        double turns = rtu->wave_phase[j] + rtu->wave_freq[j] * t;
+        float turn = (float)(turns - (double)(int64_t)turns);
+        float value = rtu->wave_base[j] +
+                      rtu->wave_amp[j] * sin_turns(turn) +
+                      rtu->wave_noise[j] * noise[j];
+        value = value < rtu->wave_min[j] ? rtu->wave_min[j] : value;
+        value = value > rtu->wave_max[j] ? rtu->wave_max[j] : value;
+        rtu->sensor_values[j] = value;
+    }
+}
+
+/* Grow the RTU table (simulator stopped, lock held) */
+static bool ensure_rtu_capacity(simulator_t *sim, int count) {
+    if (count <= sim->rtu_capacity) return true;
+
+    sim_rtu_t *rtus = realloc(sim->rtus, (size_t)count * sizeof(sim_rtu_t));
+    if (!rtus) return false;
+
+    sim->rtus = rtus;
+    sim->rtu_capacity = count;
+    return true;
 }
 
 /* Set up water treatment plant scenario */
@@ -380,6 +520,176 @@ static void setup_startup_scenario(simulator_t *sim) {
     LOG_INFO("[SIM] Loaded startup scenario");
 }
 
+/* Sensor mix the fleet cycles through when no template is given */
+static const sim_sensor_config_t fleet_template[] = {
+    { .tag = "FLOW", .base_value = 400.0f, .unit = "GPM",
+      .noise_amplitude = 8.0f, .trend_amplitude = 40.0f, .trend_period_sec = 900.0f,
+      .min_value = 0, .max_value = 1000, .alarm_high = 900 },
+    { .tag = "LEVEL", .base_value = 60.0f, .unit = "%",
+      .noise_amplitude = 1.0f, .trend_amplitude = 10.0f, .trend_period_sec = 1800.0f,
+      .min_value = 0, .max_value = 100, .alarm_low = 10, .alarm_high = 95 },
+    { .tag = "PH", .base_value = 7.2f, .unit = "pH",
+      .noise_amplitude = 0.05f, .trend_amplitude = 0.2f, .trend_period_sec = 1200.0f,
+      .min_value = 0, .max_value = 14, .alarm_low = 6.5f, .alarm_high = 8.5f },
+    { .tag = "TURB", .base_value = 1.5f, .unit = "NTU",
+      .noise_amplitude = 0.2f, .trend_amplitude = 0.5f, .trend_period_sec = 2400.0f,
+      .min_value = 0, .max_value = 50, .alarm_high = 5 },
+    { .tag = "PRESS", .base_value = 55.0f, .unit = "PSI",
+      .noise_amplitude = 1.0f, .trend_amplitude = 5.0f, .trend_period_sec = 600.0f,
+      .min_value = 0, .max_value = 100, .alarm_low = 35, .alarm_high = 80 },
+    { .tag = "TEMP", .base_value = 18.0f, .unit = "C",
+      .noise_amplitude = 0.1f, .trend_amplitude = 2.0f, .trend_period_sec = 3600.0f,
+      .min_value = 0, .max_value = 40 },
+    { .tag = "CL2", .base_value = 1.5f, .unit = "mg/L",
+      .noise_amplitude = 0.05f, .trend_amplitude = 0.3f, .trend_period_sec = 900.0f,
+      .min_value = 0, .max_value = 5, .alarm_low = 0.5f, .alarm_high = 4.0f },
+    { .tag = "COND", .base_value = 450.0f, .unit = "uS/cm",
+      .noise_amplitude = 5.0f, .trend_amplitude = 30.0f, .trend_period_sec = 1800.0f,
+      .min_value = 0, .max_value = 2000 },
+};
+
+/* Set up parametric fleet scenario: N RTUs x M sensors from a template,
+ * with trend phase and period spread so RTUs do not move in lockstep */
+static void setup_fleet_scenario(simulator_t *sim) {
+    const sim_fleet_config_t *fleet = &sim->config.fleet;
+
+    int rtu_count = fleet->rtu_count > 0 ? fleet->rtu_count : SIM_FLEET_DEFAULT_RTUS;
+    if (rtu_count > SIM_MAX_FLEET_RTUS) rtu_count = SIM_MAX_FLEET_RTUS;
+    int sensor_count = fleet->sensors_per_rtu > 0 ? fleet->sensors_per_rtu : SIM_MAX_SENSORS_PER_RTU;
+    if (sensor_count > SIM_MAX_SENSORS_PER_RTU) sensor_count = SIM_MAX_SENSORS_PER_RTU;
+    int actuator_count = fleet->actuators_per_rtu > 0 ? fleet->actuators_per_rtu : 4;
+    if (actuator_count > SIM_MAX_ACTUATORS_PER_RTU) actuator_count = SIM_MAX_ACTUATORS_PER_RTU;
+    const char *prefix = fleet->name_prefix[0] ? fleet->name_prefix : "fleet-rtu-";
+
+    const sim_sensor_config_t *template = fleet_template;
+    int template_count = (int)(sizeof(fleet_template) / sizeof(fleet_template[0]));
+    if (fleet->sensor_template && fleet->template_count > 0) {
+        template = fleet->sensor_template;
+        template_count = fleet->template_count;
+    }
+
+    if (!ensure_rtu_capacity(sim, rtu_count)) {
+        LOG_ERROR("[SIM] No memory for a fleet of %d RTUs", rtu_count);
+        setup_normal_scenario(sim);
+        return;
+    }
+
+    sim_rng_t rng;
+    rng_seed(&rng, (sim->config.seed ? sim->config.seed : SIM_DEFAULT_SEED) ^ 0xF1EE7ULL);
+
+    sim->rtu_count = 0;
+    for (int i = 0; i < rtu_count; i++) {
+        sim_rtu_t *rtu = &sim->rtus[sim->rtu_count++];
+        memset(rtu, 0, sizeof(*rtu));
+        snprintf(rtu->config.station_name, sizeof(rtu->config.station_name),
+                 "%.40s%04d", prefix, i + 1);
+        int host = i + 1;
+        snprintf(rtu->config.ip_address, sizeof(rtu->config.ip_address), "10.%u.%u.%u",
+                 (unsigned)(100 + host / 65536) & 0xFF, (unsigned)(host / 256) & 0xFF,
+                 (unsigned)host & 0xFF);
+        rtu->config.vendor_id = 0x0493;
+        rtu->config.device_id = 0x0001;
+        rtu->config.state = PROFINET_STATE_RUNNING;
+        rtu->config.slot_count = sensor_count + actuator_count;
+
+        rtu->config.sensor_count = sensor_count;
+        for (int j = 0; j < sensor_count; j++) {
+            const sim_sensor_config_t *base = &template[j % template_count];
+            sim_sensor_config_t *sensor = &rtu->sensors[j];
+
+            *sensor = *base;
+            sensor->slot = j + 1;
+            snprintf(sensor->tag, sizeof(sensor->tag), "%.24s_%02u",
+                     base->tag, (unsigned)(j / template_count + 1) % 100);
+            sensor->trend_phase = 0.5f * (rng_signed(&rng) + 1.0f);
+            if (sensor->trend_period_sec > 0) {
+                sensor->trend_period_sec *= 1.0f + 0.2f * rng_signed(&rng);
+            }
+        }
+
+        rtu->config.actuator_count = actuator_count;
+        for (int k = 0; k < actuator_count; k++) {
+            sim_actuator_state_t *actuator = &rtu->actuators[k];
+            actuator->slot = sensor_count + k + 1;
+            snprintf(actuator->tag, sizeof(actuator->tag), "PUMP_%02u", (unsigned)(k + 1) % 100);
+            actuator->command = ACTUATOR_CMD_ON;
+        }
+    }
+
+    LOG_INFO("[SIM] Loaded fleet scenario: %d RTUs x %d sensors (%d points)",
+             rtu_count, sensor_count, rtu_count * sensor_count);
+}
+
+/* Build the flowsheet behind a scenario. A plant supplied through
+ * simulator_set_plant() is kept across scenario changes. */
+static void build_scenario_plant(simulator_t *sim, sim_scenario_t scenario) {
+    if (sim->plant && !sim->plant_owned) return;
+
+    plant_model_destroy(sim->plant);
+    sim->plant = NULL;
+    sim->plant_owned = false;
+
+    if (!sim->config.enable_pid_response || scenario == SIM_SCENARIO_FLEET) return;
+
+    plant_model_t *plant = NULL;
+    if (plant_model_create(&plant, 0.0f) != WTC_OK) return;
+
+    wtc_result_t res;
+    switch (scenario) {
+    case SIM_SCENARIO_WATER_TREATMENT:
+    case SIM_SCENARIO_HIGH_LOAD:
+    case SIM_SCENARIO_MAINTENANCE:
+        res = plant_model_build_water_treatment(plant);
+        break;
+    default:
+        res = plant_model_build_demo(plant);
+        break;
+    }
+
+    if (res != WTC_OK) {
+        plant_model_destroy(plant);
+        return;
+    }
+    sim->plant = plant;
+    sim->plant_owned = true;
+}
+
+/* Map RTU tags onto plant units; sensors without a unit keep their
+ * waveform and actuators without one have no process effect */
+static void bind_plant(simulator_t *sim) {
+    int bound = 0;
+
+    for (int i = 0; i < sim->rtu_count; i++) {
+        sim_rtu_t *rtu = &sim->rtus[i];
+        int unit;
+        plant_unit_kind_t kind;
+
+        for (int j = 0; j < rtu->config.sensor_count; j++) {
+            rtu->plant_sensor[j] = -1;
+            if (sim->plant &&
+                plant_model_find(sim->plant, rtu->sensors[j].tag, &unit, &kind) == WTC_OK &&
+                kind == PLANT_UNIT_SENSOR) {
+                rtu->plant_sensor[j] = unit;
+                bound++;
+            }
+        }
+
+        for (int j = 0; j < rtu->config.actuator_count; j++) {
+            rtu->plant_actuator[j] = -1;
+            if (sim->plant &&
+                plant_model_find(sim->plant, rtu->actuators[j].tag, &unit, &kind) == WTC_OK &&
+                (kind == PLANT_UNIT_FLOW || kind == PLANT_UNIT_DOSING)) {
+                rtu->plant_actuator[j] = unit;
+                bound++;
+            }
+        }
+    }
+
+    if (sim->plant) {
+        LOG_INFO("[SIM] Process model bound to %d sensor/actuator tags", bound);
+    }
+}
+
 /* Load scenario configuration */
 static void load_scenario(simulator_t *sim, sim_scenario_t scenario) {
     pthread_mutex_lock(&sim->lock);
@@ -400,20 +710,182 @@ static void load_scenario(simulator_t *sim, sim_scenario_t scenario) {
     case SIM_SCENARIO_STARTUP:
         setup_startup_scenario(sim);
         break;
+    case SIM_SCENARIO_FLEET:
+        setup_fleet_scenario(sim);
+        break;
     case SIM_SCENARIO_NORMAL:
     default:
         setup_normal_scenario(sim);
         break;
     }
 
+    build_scenario_plant(sim, scenario);
+    bind_plant(sim);
+
     sim->config.scenario = scenario;
     pthread_mutex_unlock(&sim->lock);
 }
 
+/* Sensor value from the plant plus the configured measurement noise */
+static float plant_sensor_value(simulator_t *sim, const sim_rtu_t *rtu, int j, sim_rng_t *rng) {
+    const sim_sensor_config_t *sensor = &rtu->sensors[j];
+    float value = 0.0f;
+
+    plant_model_read_sensor(sim->plant, rtu->plant_sensor[j], &value);
+    value += random_noise(rng, sensor->noise_amplitude);
+    if (value < sensor->min_value) value = sensor->min_value;
+    if (value > sensor->max_value) value = sensor->max_value;
+
+    return value;
+}
+
+/* Update RTUs [first, last) at time t and publish each to the registry in
+ * one call. Only touches those RTUs, so ranges can run in parallel. */
+static void update_rtus(simulator_t *sim, int first, int last, double t, sim_rng_t *rng) {
+    for (int i = first; i < last; i++) {
+        sim_rtu_t *rtu = &sim->rtus[i];
+        int n = rtu->config.sensor_count;
+
+        /* Skip offline RTUs */
+        if (rtu->config.state != PROFINET_STATE_RUNNING) {
+            for (int j = 0; j < n; j++) {
+                rtu->sensor_quality[j] = QUALITY_NOT_CONNECTED;
+            }
+            continue;
+        }
+
+        /* Check for injected faults */
+        if (rtu->fault_injected) {
+            for (int j = 0; j < n; j++) {
+                rtu->sensor_quality[j] = QUALITY_BAD;
+            }
+            continue;
+        }
+
+        /* Update sensor values; plant-bound sensors replace the waveform */
+        compute_waveforms(rtu, t, rng);
+        for (int j = 0; j < n; j++) {
+            if (rtu->plant_sensor[j] >= 0) {
+                rtu->sensor_values[j] = plant_sensor_value(sim, rtu, j, rng);
+            }
+            rtu->sensor_quality[j] = QUALITY_GOOD;
+        }
+
+        rtu->config.total_cycles++;
+
+        /* Update registry with new values */
+        if (sim->registry) {
+            rtu_registry_update_sensors(sim->registry, rtu->config.station_name,
+                                        rtu->slots, rtu->sensor_values,
+                                        rtu->sensor_quality, n, IOPS_GOOD);
+        }
+    }
+}
+
+static void *worker_thread(void *arg) {
+    sim_worker_t *worker = arg;
+    simulator_t *sim = worker->sim;
+    uint32_t seen = 0;
+
+    pthread_mutex_lock(&sim->work_lock);
+    for (;;) {
+        while (!sim->work_exit && sim->work_generation == seen) {
+            pthread_cond_wait(&sim->work_cond, &sim->work_lock);
+        }
+        if (sim->work_exit) break;
+
+        seen = sim->work_generation;
+        double t = sim->work_time_s;
+        pthread_mutex_unlock(&sim->work_lock);
+
+        /* Contiguous share of the fleet; the caller holds sim->lock, so
+         * rtu_count and the RTU table are stable */
+        int first = (int)((int64_t)sim->rtu_count * worker->index / sim->worker_count);
+        int last = (int)((int64_t)sim->rtu_count * (worker->index + 1) / sim->worker_count);
+        update_rtus(sim, first, last, t, &worker->rng);
+
+        pthread_mutex_lock(&sim->work_lock);
+        if (--sim->work_pending == 0) {
+            pthread_cond_signal(&sim->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&sim->work_lock);
+
+    return NULL;
+}
+
+/* Run one update across the pool and wait for every range */
+static void dispatch_workers(simulator_t *sim, double t) {
+    pthread_mutex_lock(&sim->work_lock);
+    sim->work_time_s = t;
+    sim->work_pending = sim->worker_count;
+    sim->work_generation++;
+    pthread_cond_broadcast(&sim->work_cond);
+    while (sim->work_pending > 0) {
+        pthread_cond_wait(&sim->done_cond, &sim->work_lock);
+    }
+    pthread_mutex_unlock(&sim->work_lock);
+}
+
+static void start_workers(simulator_t *sim) {
+    int count = sim->config.worker_threads;
+    if (count > sim->rtu_count) count = sim->rtu_count;
+    if (count <= 0 || sim->workers) return;
+
+    sim->workers = calloc((size_t)count, sizeof(sim_worker_t));
+    if (!sim->workers) {
+        LOG_WARN("[SIM] No memory for workers, updating on the caller");
+        return;
+    }
+
+    uint64_t seed = sim->config.seed ? sim->config.seed : SIM_DEFAULT_SEED;
+    sim->work_exit = false;
+    sim->work_generation = 0;
+
+    int started = 0;
+    for (int i = 0; i < count; i++) {
+        sim_worker_t *worker = &sim->workers[i];
+        worker->sim = sim;
+        worker->index = i;
+        rng_seed(&worker->rng, seed + (uint64_t)i + 1);
+        if (pthread_create(&worker->thread, NULL, worker_thread, worker) != 0) {
+            LOG_WARN("[SIM] Started only %d of %d workers", started, count);
+            break;
+        }
+        started++;
+    }
+
+    /* Read by the workers only once the first update is dispatched */
+    sim->worker_count = started;
+    if (started == 0) {
+        free(sim->workers);
+        sim->workers = NULL;
+        return;
+    }
+    LOG_INFO("[SIM] %d workers updating %d RTUs", started, sim->rtu_count);
+}
+
+static void stop_workers(simulator_t *sim) {
+    if (!sim->workers) return;
+
+    pthread_mutex_lock(&sim->work_lock);
+    sim->work_exit = true;
+    pthread_cond_broadcast(&sim->work_cond);
+    pthread_mutex_unlock(&sim->work_lock);
+
+    for (int i = 0; i < sim->worker_count; i++) {
+        pthread_join(sim->workers[i].thread, NULL);
+    }
+    free(sim->workers);
+    sim->workers = NULL;
+    sim->worker_count = 0;
+}
+
 /* Register simulated RTUs with registry */
 static void register_rtus_with_registry(simulator_t *sim) {
     if (!sim->registry) return;
 
+    int registered = 0;
     for (int i = 0; i < sim->rtu_count; i++) {
         sim_rtu_t *rtu = &sim->rtus[i];
 
@@ -449,13 +921,28 @@ static void register_rtus_with_registry(simulator_t *sim) {
             slot_idx
         );
 
-        if (res == WTC_OK) {
+        /* Seed the output image so the plant starts from the scenario's
+         * commands, also when the device was already in the registry */
+        for (int j = 0; j < rtu->config.actuator_count; j++) {
+            actuator_output_t output = {
+                .command = (uint8_t)rtu->actuators[j].command,
+                .pwm_duty = rtu->actuators[j].pwm_duty,
+            };
+            rtu_registry_update_actuator(sim->registry, rtu->config.station_name,
+                                         rtu->actuators[j].slot, &output);
+        }
+
+        /* Devices restored from a saved topology are already present */
+        if (res == WTC_OK || res == WTC_ERROR_ALREADY_EXISTS) {
             /* Set connection state */
             rtu_registry_set_device_state(sim->registry, rtu->config.station_name, rtu->config.state);
-            LOG_INFO("[SIM] Registered RTU: %s (%s)",
-                     rtu->config.station_name, rtu->config.ip_address);
+            LOG_DEBUG("[SIM] Registered RTU: %s (%s)",
+                      rtu->config.station_name, rtu->config.ip_address);
+            registered++;
         }
     }
+
+    LOG_INFO("[SIM] Registered %d of %d RTUs", registered, sim->rtu_count);
 }
 
 wtc_result_t simulator_init(simulator_t **simulator, const simulator_config_t *config) {
@@ -475,8 +962,22 @@ wtc_result_t simulator_init(simulator_t **simulator, const simulator_config_t *c
         sim->config.enable_pid_response = true;
         sim->config.time_scale = 1.0f;
     }
+    if (sim->config.time_scale <= 0.0f) {
+        sim->config.time_scale = 1.0f;
+    }
+
+    sim->rtus = calloc(SIM_MAX_RTUS, sizeof(sim_rtu_t));
+    if (!sim->rtus) {
+        free(sim);
+        return WTC_ERROR_NO_MEMORY;
+    }
+    sim->rtu_capacity = SIM_MAX_RTUS;
+    rng_seed(&sim->rng, sim->config.seed ? sim->config.seed : SIM_DEFAULT_SEED);
 
     pthread_mutex_init(&sim->lock, NULL);
+    pthread_mutex_init(&sim->work_lock, NULL);
+    pthread_cond_init(&sim->work_cond, NULL);
+    pthread_cond_init(&sim->done_cond, NULL);
 
     /* Load scenario */
     load_scenario(sim, sim->config.scenario);
@@ -492,7 +993,14 @@ void simulator_cleanup(simulator_t *simulator) {
     if (!simulator) return;
 
     simulator_stop(simulator);
+    if (simulator->plant_owned) {
+        plant_model_destroy(simulator->plant);
+    }
+    pthread_cond_destroy(&simulator->done_cond);
+    pthread_cond_destroy(&simulator->work_cond);
+    pthread_mutex_destroy(&simulator->work_lock);
     pthread_mutex_destroy(&simulator->lock);
+    free(simulator->rtus);
     free(simulator);
 
     LOG_INFO("[SIM] Simulator cleaned up");
@@ -504,6 +1012,8 @@ wtc_result_t simulator_start(simulator_t *simulator) {
     pthread_mutex_lock(&simulator->lock);
     simulator->running = true;
     simulator->start_time_ms = time_get_ms();
+    simulator->last_process_ms = simulator->start_time_ms;
+    simulator->virtual_time_s = 0.0;
     simulator->update_count = 0;
 
     /* Initialize sensor values */
@@ -513,11 +1023,14 @@ wtc_result_t simulator_start(simulator_t *simulator) {
             rtu->sensor_values[j] = rtu->sensors[j].base_value;
             rtu->sensor_quality[j] = QUALITY_GOOD;
         }
+        prepare_waveforms(rtu);
     }
 
     /* Register with RTU registry */
     register_rtus_with_registry(simulator);
 
+    start_workers(simulator);
+
     pthread_mutex_unlock(&simulator->lock);
 
     LOG_INFO("[SIM] Simulator started");
@@ -529,67 +1042,122 @@ wtc_result_t simulator_stop(simulator_t *simulator) {
 
     pthread_mutex_lock(&simulator->lock);
     simulator->running = false;
+    stop_workers(simulator);
     pthread_mutex_unlock(&simulator->lock);
 
     LOG_INFO("[SIM] Simulator stopped");
     return WTC_OK;
 }
 
+/* Actuator command as plant input (0..1) */
+static float actuator_input(const sim_actuator_state_t *actuator) {
+    switch (actuator->command) {
+    case ACTUATOR_CMD_ON:
+        return 1.0f;
+    case ACTUATOR_CMD_PWM:
+        return actuator->pwm_duty / 255.0f;
+    default:
+        return 0.0f;
+    }
+}
+
+/* Feed the output image to the plant. Commands come from the registry
+ * when one is connected, so control loops close through the model; an
+ * offline or faulted RTU drops its outputs. */
+static void drive_plant(simulator_t *sim) {
+    for (int i = 0; i < sim->rtu_count; i++) {
+        sim_rtu_t *rtu = &sim->rtus[i];
+        bool live = rtu->config.state == PROFINET_STATE_RUNNING && !rtu->fault_injected;
+
+        for (int j = 0; j < rtu->config.actuator_count; j++) {
+            if (rtu->plant_actuator[j] < 0) continue;
+
+            sim_actuator_state_t *actuator = &rtu->actuators[j];
+            actuator_state_t state;
+            if (sim->registry &&
+                rtu_registry_get_actuator(sim->registry, rtu->config.station_name,
+                                          actuator->slot, &state) == WTC_OK) {
+                actuator->command = (actuator_cmd_t)state.output.command;
+                actuator->pwm_duty = state.output.pwm_duty;
+
+                if (sim->trace && state.trace_id != 0 &&
+                    state.source_time_us != rtu->traced_source_us[j]) {
+                    uint64_t now_us = time_get_monotonic_us();
+                    rtu->traced_source_us[j] = state.source_time_us;
+                    latency_trace_record(sim->trace, state.trace_id, LATENCY_STAGE_SEND,
+                                         now_us - state.output_time_us);
+                    latency_trace_record(sim->trace, state.trace_id, LATENCY_STAGE_TOTAL,
+                                         now_us - state.source_time_us);
+                }
+            }
+
+            plant_model_set_input(sim->plant, rtu->plant_actuator[j],
+                                  live ? actuator_input(actuator) : 0.0f);
+        }
+    }
+}
+
+/* Advance simulated time by dt_s and publish new sensor values */
+static void simulate_locked(simulator_t *simulator, double dt_s) {
+    simulator->virtual_time_s += dt_s;
+
+    if (simulator->plant) {
+        drive_plant(simulator);
+        plant_model_advance(simulator->plant, dt_s);
+    }
+
+    if (simulator->worker_count > 0) {
+        dispatch_workers(simulator, simulator->virtual_time_s);
+    } else {
+        update_rtus(simulator, 0, simulator->rtu_count, simulator->virtual_time_s,
+                    &simulator->rng);
+    }
+
+    simulator->update_count++;
+}
+
 wtc_result_t simulator_process(simulator_t *simulator) {
     if (!simulator || !simulator->running) return WTC_ERROR_INVALID_PARAM;
 
     pthread_mutex_lock(&simulator->lock);
 
     uint64_t now_ms = time_get_ms();
-    float elapsed_sec = (now_ms - simulator->start_time_ms) / 1000.0f;
-    elapsed_sec *= simulator->config.time_scale;
+    double dt_s = (now_ms - simulator->last_process_ms) / 1000.0 * simulator->config.time_scale;
+    simulator->last_process_ms = now_ms;
+    simulate_locked(simulator, dt_s);
 
-    /* Update all sensor values */
-    for (int i = 0; i < simulator->rtu_count; i++) {
-        sim_rtu_t *rtu = &simulator->rtus[i];
+    pthread_mutex_unlock(&simulator->lock);
 
-        /* Skip offline RTUs */
-        if (rtu->config.state != PROFINET_STATE_RUNNING) {
-            for (int j = 0; j < rtu->config.sensor_count; j++) {
-                rtu->sensor_quality[j] = QUALITY_NOT_CONNECTED;
-            }
-            continue;
-        }
+    return WTC_OK;
+}
 
-        /* Check for injected faults */
-        if (rtu->fault_injected) {
-            for (int j = 0; j < rtu->config.sensor_count; j++) {
-                rtu->sensor_quality[j] = QUALITY_BAD;
-            }
-            continue;
-        }
+wtc_result_t simulator_advance(simulator_t *simulator, double seconds) {
+    if (!simulator || !simulator->running || seconds < 0.0) return WTC_ERROR_INVALID_PARAM;
 
-        /* Update sensor values */
-        for (int j = 0; j < rtu->config.sensor_count; j++) {
-            rtu->sensor_values[j] = calculate_sensor_value(&rtu->sensors[j], elapsed_sec);
-            rtu->sensor_quality[j] = QUALITY_GOOD;
-        }
+    pthread_mutex_lock(&simulator->lock);
+    simulate_locked(simulator, seconds);
+    pthread_mutex_unlock(&simulator->lock);
 
-        rtu->config.total_cycles++;
+    return WTC_OK;
+}
 
-        /* Update registry with new values */
-        if (simulator->registry) {
-            for (int j = 0; j < rtu->config.sensor_count; j++) {
-                rtu_registry_update_sensor(
-                    simulator->registry,
-                    rtu->config.station_name,
-                    rtu->sensors[j].slot,
-                    rtu->sensor_values[j],
-                    IOPS_GOOD,
-                    rtu->sensor_quality[j]
-                );
-            }
-        }
+wtc_result_t simulator_set_plant(simulator_t *simulator, plant_model_t *plant) {
+    if (!simulator) return WTC_ERROR_INVALID_PARAM;
+
+    pthread_mutex_lock(&simulator->lock);
+
+    if (simulator->plant_owned) {
+        plant_model_destroy(simulator->plant);
     }
+    simulator->plant = plant;
+    simulator->plant_owned = false;
 
-    simulator->update_count++;
-    pthread_mutex_unlock(&simulator->lock);
+    if (!plant) {
+        build_scenario_plant(simulator, simulator->config.scenario);
+    }
+    bind_plant(simulator);
 
+    pthread_mutex_unlock(&simulator->lock);
     return WTC_OK;
 }
 
@@ -608,6 +1176,15 @@ wtc_result_t simulator_set_registry(simulator_t *simulator, rtu_registry_t *regi
     return WTC_OK;
 }
 
+wtc_result_t simulator_set_latency_trace(simulator_t *simulator, struct latency_trace *trace) {
+    if (!simulator) return WTC_ERROR_INVALID_PARAM;
+
+    pthread_mutex_lock(&simulator->lock);
+    simulator->trace = trace;
+    pthread_mutex_unlock(&simulator->lock);
+    return WTC_OK;
+}
+
 wtc_result_t simulator_get_sensor(simulator_t *simulator,
                                    const char *station_name,
                                    int slot,
@@ -656,6 +1233,14 @@ wtc_result_t simulator_command_actuator(simulator_t *simulator,
                 if (rtu->actuators[j].slot == slot) {
                     rtu->actuators[j].command = command;
                     rtu->actuators[j].pwm_duty = pwm_duty;
+                    if (simulator->registry) {
+                        actuator_output_t output = {
+                            .command = (uint8_t)command,
+                            .pwm_duty = pwm_duty,
+                        };
+                        rtu_registry_update_actuator(simulator->registry, station_name,
+                                                     slot, &output);
+                    }
                     LOG_INFO("[SIM] Actuator command: %s/%d = %d (duty=%d)",
                              station_name, slot, command, pwm_duty);
                     result = WTC_OK;
@@ -679,6 +1264,7 @@ wtc_result_t simulator_get_stats(simulator_t *simulator, simulator_stats_t *stat
     stats->update_count = simulator->update_count;
     stats->start_time_ms = simulator->start_time_ms;
     stats->elapsed_time_ms = time_get_ms() - simulator->start_time_ms;
+    stats->virtual_time_ms = (uint64_t)(simulator->virtual_time_s * 1000.0);
     stats->scenario = simulator->config.scenario;
     stats->running = simulator->running;
 
@@ -7,6 +7,19 @@
  * Generates realistic water treatment plant sensor data and responds
  * to actuator commands.
  *
+ * With enable_pid_response, sensors whose tag names a unit in the
+ * scenario's process model (plant_model.h) follow the simulated process
+ * instead of a waveform, and actuator commands read back from the
+ * registry drive the model, so control loops run closed. Simulated time
+ * runs at time_scale times the wall clock, or is stepped explicitly with
+ * simulator_advance().
+ *
+ * The "fleet" scenario generates N RTUs x M sensors from a template for
+ * sizing and load tests (256 x 32 = 8k points by default). Each update
+ * evaluates one RTU's waveforms as a batch and hands them to the
+ * registry in one call; with worker_threads > 0 the RTUs are split into
+ * contiguous ranges, one per worker, each with its own random generator.
+ *
  * Usage:
  *   Start controller with --simulation flag:
  *     ./wtc_controller --simulation
@@ -20,6 +33,7 @@
 
 #include "../types.h"
 #include "../registry/rtu_registry.h"
+#include "plant_model.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -33,6 +47,7 @@ typedef enum {
     SIM_SCENARIO_HIGH_LOAD,            /* System under stress, near limits */
     SIM_SCENARIO_MAINTENANCE,          /* Some RTUs offline for maintenance */
     SIM_SCENARIO_WATER_TREATMENT,      /* Full water treatment plant demo */
+    SIM_SCENARIO_FLEET,                /* Parametric fleet from a sensor template */
     SIM_SCENARIO_COUNT
 } sim_scenario_t;
 
@@ -49,6 +64,7 @@ typedef struct {
     float max_value;
     float alarm_low;            /* Low alarm threshold (0 = disabled) */
     float alarm_high;           /* High alarm threshold (0 = disabled) */
+    float trend_phase;          /* Trend offset as a fraction of the period */
 } sim_sensor_config_t;
 
 /* Simulated actuator state */
@@ -76,14 +92,29 @@ typedef struct {
     uint32_t total_cycles;
 } sim_rtu_config_t;
 
+#define SIM_MAX_FLEET_RTUS      4096
+
+/* Parametric fleet for SIM_SCENARIO_FLEET (zero fields take the default) */
+typedef struct {
+    int rtu_count;              /* Default 256 */
+    int sensors_per_rtu;        /* Default 32, at most 32 */
+    int actuators_per_rtu;      /* Default 4, at most 16 */
+    char name_prefix[32];       /* Default "fleet-rtu-" */
+    const sim_sensor_config_t *sensor_template;   /* Read when the scenario loads, NULL = built-in mix */
+    int template_count;         /* Sensor j uses template[j % template_count] */
+} sim_fleet_config_t;
+
 /* Simulator configuration */
 typedef struct {
     sim_scenario_t scenario;
     float update_rate_hz;       /* How often to update values (default: 1.0) */
     bool enable_alarms;         /* Generate alarm conditions */
-    bool enable_pid_response;   /* Simulate process response to PID output */
-    float time_scale;           /* Speed up/slow down simulation (1.0 = real-time) */
+    bool enable_pid_response;   /* Drive the process model from actuator outputs */
+    float time_scale;           /* Simulated seconds per wall second (1.0 = real-time) */
     void *user_data;
+    sim_fleet_config_t fleet;
+    int worker_threads;         /* 0 = update on the calling thread */
+    uint32_t seed;              /* Noise and fleet generator seed, 0 = fixed default */
 } simulator_config_t;
 
 /* Simulator handle */
@@ -97,6 +128,7 @@ typedef struct {
     uint32_t update_count;
     uint64_t start_time_ms;
     uint64_t elapsed_time_ms;
+    uint64_t virtual_time_ms;   /* Simulated time since start */
     sim_scenario_t scenario;
     bool running;
 } simulator_stats_t;
@@ -143,6 +175,28 @@ wtc_result_t simulator_stop(simulator_t *simulator);
  */
 wtc_result_t simulator_process(simulator_t *simulator);
 
+/*
+ * Advance simulated time by a fixed amount, independent of the wall
+ * clock. Lets tests and benchmarks run the closed loop faster than real
+ * time and reproducibly; do not mix with simulator_process().
+ *
+ * @param simulator Simulator handle
+ * @param seconds   Simulated seconds to advance
+ * @return WTC_OK on success
+ */
+wtc_result_t simulator_advance(simulator_t *simulator, double seconds);
+
+/*
+ * Replace the scenario's process model with a custom flowsheet.
+ * Units are bound to RTU sensors and actuators by tag name. The caller
+ * keeps ownership of the plant; NULL restores the scenario's model.
+ *
+ * @param simulator Simulator handle
+ * @param plant     Flowsheet to drive, or NULL
+ * @return WTC_OK on success
+ */
+wtc_result_t simulator_set_plant(simulator_t *simulator, plant_model_t *plant);
+
 /*
  * Connect simulator to RTU registry.
  * Simulator will populate registry with virtual RTUs.
@@ -153,6 +207,19 @@ wtc_result_t simulator_process(simulator_t *simulator);
  */
 wtc_result_t simulator_set_registry(simulator_t *simulator, rtu_registry_t *registry);
 
+/*
+ * Close latency traces in simulation. The simulated RTUs stand in for the
+ * PROFINET cyclic frame: a traced output is "sent" when the plant picks it
+ * up from the registry, which records the send and total stages. Sensor
+ * values are stamped as received when they are published.
+ *
+ * @param simulator Simulator handle
+ * @param trace     Latency tracer, or NULL to stop tracing
+ * @return WTC_OK on success
+ */
+struct latency_trace;
+wtc_result_t simulator_set_latency_trace(simulator_t *simulator, struct latency_trace *trace);
+
 /*
  * Get current sensor value for a simulated RTU.
  *
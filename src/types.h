@@ -267,6 +267,7 @@ typedef struct {
     iops_t status;
     data_quality_t quality;      /* Application-level quality from 5-byte format */
     uint64_t timestamp_ms;
+    uint64_t rx_time_us;         /* Monotonic receive time, for latency tracing */
     bool stale;
 } sensor_data_t;
 
@@ -284,6 +285,11 @@ typedef struct {
     uint64_t last_change_ms;
     uint64_t total_on_time_ms;
     uint32_t cycle_count;
+
+    /* Last traced write (see core/latency_trace.h), 0 = never traced */
+    uint64_t source_time_us;     /* Receive time of the input it was computed from */
+    uint64_t output_time_us;     /* Monotonic time the output was written */
+    uint32_t trace_id;           /* Control loop that wrote it */
 } actuator_state_t;
 
 /* Slot configuration */
@@ -501,6 +507,7 @@ typedef struct {
     uint64_t cycle_time_us_min;
     uint64_t cycle_time_us_max;
     uint64_t cycle_time_us_avg;
+    uint64_t cycle_time_us_total;   /* Sum over cycle_count */
     uint64_t overruns;
     float cpu_usage_percent;
 } cycle_stats_t;
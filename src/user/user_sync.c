@@ -11,12 +11,18 @@
 #include "utils/logger.h"
 #include "utils/time_utils.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
 
 #define LOG_TAG "USER_SYNC"
 
+/* Live users plus tombstones of deleted ones */
+#define USER_STORE_SIZE         (USER_SYNC_MAX_USERS * 2)
+#define MAX_SYNC_THREADS        32
+
 /* Default configuration */
 static const user_sync_config_t default_config = {
     .auto_sync_on_connect = true,
@@ -24,8 +30,23 @@ static const user_sync_config_t default_config = {
     .sync_timeout_ms = 5000,
     .retry_count = 3,
     .retry_delay_ms = 1000,
+    .max_in_flight = 8,
 };
 
+/* A user as last set, with the store revision of its last change */
+typedef struct {
+    user_t user;
+    uint32_t revision;
+    bool deleted;           /* Tombstone, sent to RTUs as a delete */
+} user_entry_t;
+
+/* What an RTU has applied */
+typedef struct {
+    char station_name[WTC_MAX_STATION_NAME];
+    uint32_t acked_nonce;   /* USER_SYNC_NONCE of the last sync applied */
+    bool known;             /* acked_nonce is valid */
+} rtu_sync_state_t;
+
 /* User sync manager structure */
 struct user_sync_manager {
     user_sync_config_t config;
@@ -37,10 +58,21 @@ struct user_sync_manager {
 
     user_sync_stats_t stats;
 
-    /* Cached user list for auto-sync on RTU connect.
-     * Updated each time a sync command is processed via IPC. */
-    user_t cached_users[USER_SYNC_MAX_USERS];
-    int cached_user_count;
+    /* Revisioned user store. Updated each time a sync command is
+     * processed via IPC; revision 0 means no list was ever set.
+     * Revisions live in memory only, so they are qualified by an
+     * epoch that changes on every start. */
+    user_entry_t entries[USER_STORE_SIZE];
+    int entry_count;
+    uint16_t epoch;
+    uint32_t revision;
+    uint32_t purged_revision;   /* Newest tombstone dropped from the store */
+    int next_user_id;
+
+    rtu_sync_state_t rtus[WTC_MAX_RTUS];
+    int rtu_count;
+
+    pthread_mutex_t lock;
 };
 
 /* ============== Constant-Time Comparison ============== */
@@ -111,8 +143,63 @@ uint16_t user_sync_crc16(const uint8_t *data, size_t len) {
 
 /* ============== Serialization ============== */
 
+static void fill_record(user_sync_record_t *record, const user_t *user) {
+    memset(record, 0, sizeof(*record));
+
+    /* Set user ID from controller database */
+    record->user_id = (uint32_t)user->user_id;
+
+    /* Copy username (truncate if needed) */
+    strncpy(record->username, user->username, USER_SYNC_USERNAME_LEN - 1);
+
+    /* Copy password hash (v2: 24 bytes max) */
+    strncpy(record->password_hash, user->password_hash, USER_SYNC_HASH_LEN - 1);
+
+    /* Set role */
+    record->role = (uint8_t)user->role;
+
+    /* Set flags */
+    if (user->active) {
+        record->flags |= USER_FLAG_ACTIVE;
+    }
+    record->flags |= USER_FLAG_SYNC_TO_RTUS; /* Mark for RTU sync */
+}
+
+static void finish_payload(user_sync_payload_t *payload, uint8_t operation,
+                           int user_count, uint32_t nonce) {
+    user_sync_init_header(&payload->header, operation, (uint8_t)user_count,
+                          (uint32_t)(time_get_ms() / 1000));
+    payload->header.nonce = nonce;
+    payload->header.checksum = user_sync_crc16(
+        (const uint8_t *)payload->users,
+        (size_t)user_count * sizeof(user_sync_record_t));
+}
+
+/* ============== Epoch ============== */
+
+static pthread_once_t epoch_once = PTHREAD_ONCE_INIT;
+static uint16_t boot_epoch;
+
+static void init_boot_epoch(void) {
+    /* Mix start time and pid so two starts are unlikely to collide */
+    uint64_t seed = time_get_us() ^ ((uint64_t)getpid() << 32);
+    seed ^= seed >> 33;
+    seed *= 0xff51afd7ed558ccdull;
+    seed ^= seed >> 33;
+    boot_epoch = (uint16_t)(seed ^ (seed >> 16) ^ (seed >> 32) ^ (seed >> 48));
+    if (boot_epoch == 0) {
+        boot_epoch = 1;
+    }
+}
+
+uint16_t user_sync_boot_epoch(void) {
+    pthread_once(&epoch_once, init_boot_epoch);
+    return boot_epoch;
+}
+
 int user_sync_serialize(const user_t *users,
                         int user_count,
+                        uint32_t nonce,
                         user_sync_payload_t *payload) {
     if (!users || !payload || user_count < 0) {
         return WTC_USER_SYNC_ERROR_INVALID_PARAM;
@@ -132,34 +219,11 @@ int user_sync_serialize(const user_t *users,
     payload->header.operation = USER_SYNC_OP_FULL_SYNC;
     payload->header.user_count = (uint8_t)user_count;
     payload->header.timestamp = (uint32_t)(time_get_ms() / 1000);
-    payload->header.nonce = (uint32_t)time_get_ms(); /* Simple nonce */
+    payload->header.nonce = nonce;
 
     /* Fill user records */
     for (int i = 0; i < user_count; i++) {
-        user_sync_record_t *record = &payload->users[i];
-
-        /* Set user ID from controller database */
-        record->user_id = users[i].user_id;
-
-        /* Copy username (truncate if needed) */
-        strncpy(record->username, users[i].username,
-                USER_SYNC_USERNAME_LEN - 1);
-        record->username[USER_SYNC_USERNAME_LEN - 1] = '\0';
-
-        /* Copy password hash (v2: 24 bytes max) */
-        strncpy(record->password_hash, users[i].password_hash,
-                USER_SYNC_HASH_LEN - 1);
-        record->password_hash[USER_SYNC_HASH_LEN - 1] = '\0';
-
-        /* Set role */
-        record->role = (uint8_t)users[i].role;
-
-        /* Set flags */
-        record->flags = 0;
-        if (users[i].active) {
-            record->flags |= USER_FLAG_ACTIVE;
-        }
-        record->flags |= USER_FLAG_SYNC_TO_RTUS; /* Mark for RTU sync */
+        fill_record(&payload->users[i], &users[i]);
     }
 
     /* Calculate checksum over user records */
@@ -254,6 +318,14 @@ wtc_result_t user_sync_manager_init(user_sync_manager_t **manager,
     } else {
         memcpy(&mgr->config, &default_config, sizeof(user_sync_config_t));
     }
+    if (mgr->config.max_in_flight <= 0) {
+        mgr->config.max_in_flight = 1;
+    } else if (mgr->config.max_in_flight > MAX_SYNC_THREADS) {
+        mgr->config.max_in_flight = MAX_SYNC_THREADS;
+    }
+
+    mgr->epoch = user_sync_boot_epoch();
+    pthread_mutex_init(&mgr->lock, NULL);
 
     *manager = mgr;
     LOG_INFO(LOG_TAG, "User sync manager initialized");
@@ -263,6 +335,7 @@ wtc_result_t user_sync_manager_init(user_sync_manager_t **manager,
 
 void user_sync_manager_cleanup(user_sync_manager_t *manager) {
     if (manager) {
+        pthread_mutex_destroy(&manager->lock);
         free(manager);
         LOG_INFO(LOG_TAG, "User sync manager cleaned up");
     }
@@ -295,64 +368,294 @@ void user_sync_set_callback(user_sync_manager_t *manager,
     }
 }
 
-int user_sync_to_rtu(user_sync_manager_t *manager,
-                     const char *station_name,
-                     const user_t *users,
-                     int user_count) {
-    if (!manager || !station_name || !users) {
-        return WTC_USER_SYNC_ERROR_INVALID_PARAM;
+/* ============== Revisioned Store ============== */
+
+static user_entry_t *find_entry(user_sync_manager_t *manager, const char *username) {
+    for (int i = 0; i < manager->entry_count; i++) {
+        if (strcmp(manager->entries[i].user.username, username) == 0) {
+            return &manager->entries[i];
+        }
+    }
+    return NULL;
+}
+
+/* Make room by dropping the oldest tombstone; RTUs behind it need a
+ * full sync. Lock held. */
+static bool purge_tombstone(user_sync_manager_t *manager, bool *seen) {
+    int oldest = -1;
+    for (int i = 0; i < manager->entry_count; i++) {
+        if (manager->entries[i].deleted &&
+            (oldest < 0 ||
+             manager->entries[i].revision < manager->entries[oldest].revision)) {
+            oldest = i;
+        }
+    }
+    if (oldest < 0) {
+        return false;
     }
+    if (manager->entries[oldest].revision > manager->purged_revision) {
+        manager->purged_revision = manager->entries[oldest].revision;
+    }
+    manager->entry_count--;
+    manager->entries[oldest] = manager->entries[manager->entry_count];
+    seen[oldest] = seen[manager->entry_count];
+    return true;
+}
 
-    if (!manager->profinet) {
-        LOG_ERROR(LOG_TAG, "PROFINET controller not set");
-        return WTC_USER_SYNC_ERROR_SEND;
+/* Next store revision. Revisions are 16 bits on the wire; when they run
+ * out, a new epoch restarts them and every RTU gets a full sync. Lock held. */
+static uint32_t next_revision(user_sync_manager_t *manager) {
+    if (manager->revision >= USER_SYNC_REVISION_MAX) {
+        manager->epoch = manager->epoch == UINT16_MAX ? 1 : (uint16_t)(manager->epoch + 1);
+        manager->revision = 0;
+        manager->purged_revision = 0;
+        for (int i = 0; i < manager->entry_count; i++) {
+            manager->entries[i].revision = 0;
+        }
+        LOG_INFO(LOG_TAG, "User store revisions wrapped, new epoch %u", manager->epoch);
+    }
+    return ++manager->revision;
+}
+
+static bool user_changed(const user_t *a, const user_t *b) {
+    return strcmp(a->password_hash, b->password_hash) != 0 ||
+           a->role != b->role || a->active != b->active;
+}
+
+/* Diff a full user list into the store. Lock held. Returns the number
+ * of users added, changed or deleted. */
+static int store_update(user_sync_manager_t *manager, const user_t *users, int user_count) {
+    if (user_count > USER_SYNC_MAX_USERS) {
+        LOG_WARN(LOG_TAG, "User count %d exceeds max %d, truncating",
+                 user_count, USER_SYNC_MAX_USERS);
+        user_count = USER_SYNC_MAX_USERS;
     }
 
-    /* Serialize users */
-    user_sync_payload_t payload;
-    int result = user_sync_serialize(users, user_count, &payload);
-    if (result != 0) {
-        LOG_ERROR(LOG_TAG, "Failed to serialize users: %d", result);
-        return result;
+    int changes = 0;
+    bool seen[USER_STORE_SIZE] = {false};
+
+    for (int i = 0; i < user_count; i++) {
+        user_entry_t *entry = find_entry(manager, users[i].username);
+        if (entry) {
+            seen[entry - manager->entries] = true;
+            if (!entry->deleted && !user_changed(&entry->user, &users[i])) {
+                continue;
+            }
+        } else {
+            if (manager->entry_count == USER_STORE_SIZE && !purge_tombstone(manager, seen)) {
+                continue;
+            }
+            entry = &manager->entries[manager->entry_count++];
+            memset(entry, 0, sizeof(*entry));
+            entry->user.user_id = ++manager->next_user_id;
+            seen[entry - manager->entries] = true;
+        }
+
+        /* user_id is assigned by the store so it stays stable on RTUs */
+        int user_id = entry->user.user_id;
+        entry->user = users[i];
+        entry->user.user_id = user_id;
+        entry->deleted = false;
+        entry->revision = next_revision(manager);
+        changes++;
+    }
+
+    for (int i = 0; i < manager->entry_count; i++) {
+        user_entry_t *entry = &manager->entries[i];
+        if (!seen[i] && !entry->deleted) {
+            entry->deleted = true;
+            entry->revision = next_revision(manager);
+            changes++;
+        }
     }
 
-    /* Calculate actual payload size */
-    size_t payload_size = user_sync_payload_size(payload.header.user_count);
+    /* An empty first list still counts as set */
+    if (manager->revision == 0) {
+        manager->revision = 1;
+    }
+    return changes;
+}
+
+static rtu_sync_state_t *rtu_state(user_sync_manager_t *manager, const char *station_name) {
+    for (int i = 0; i < manager->rtu_count; i++) {
+        if (strcmp(manager->rtus[i].station_name, station_name) == 0) {
+            return &manager->rtus[i];
+        }
+    }
+    if (manager->rtu_count == WTC_MAX_RTUS) {
+        return NULL;
+    }
+    rtu_sync_state_t *st = &manager->rtus[manager->rtu_count++];
+    memset(st, 0, sizeof(*st));
+    snprintf(st->station_name, sizeof(st->station_name), "%s", station_name);
+    return st;
+}
+
+/* Ask the RTU which nonce it has applied */
+static bool read_rtu_nonce(user_sync_manager_t *manager, const char *station_name,
+                           uint32_t *nonce) {
+    user_sync_state_t state;
+    size_t len = sizeof(state);
+    if (profinet_controller_read_record(manager->profinet, station_name,
+                                        0, 0, 1, USER_SYNC_STATE_INDEX,
+                                        &state, &len) != WTC_OK) {
+        return false;
+    }
+    if (len != sizeof(state) || !user_sync_validate_state(&state)) {
+        return false;
+    }
+    *nonce = state.nonce;
+    return true;
+}
 
-    LOG_INFO(LOG_TAG, "Syncing %d users to RTU %s (%zu bytes)",
-             user_count, station_name, payload_size);
+static wtc_result_t write_payload(user_sync_manager_t *manager, const char *station_name,
+                                  const user_sync_payload_t *payload) {
+    size_t payload_size = user_sync_payload_size(payload->header.user_count);
+    LOG_DEBUG(LOG_TAG, "%s to %s: %d users, nonce %u:%u (%zu bytes)",
+              user_sync_op_str(payload->header.operation), station_name,
+              payload->header.user_count,
+              USER_SYNC_NONCE_EPOCH(payload->header.nonce),
+              USER_SYNC_NONCE_REVISION(payload->header.nonce), payload_size);
 
     /* Send via PROFINET acyclic write */
-    wtc_result_t send_result = profinet_controller_write_record(
+    return profinet_controller_write_record(
         manager->profinet,
         station_name,
         0,                          /* API */
         0,                          /* Slot (DAP) */
         1,                          /* Subslot */
         USER_SYNC_RECORD_INDEX,     /* Index */
-        &payload,
+        payload,
         payload_size
     );
+}
+
+/* Whether nonce a is newer than b: another epoch always counts as newer */
+static bool nonce_newer(uint32_t a, uint32_t b) {
+    return USER_SYNC_NONCE_EPOCH(a) != USER_SYNC_NONCE_EPOCH(b) ||
+           USER_SYNC_NONCE_REVISION(a) > USER_SYNC_NONCE_REVISION(b);
+}
+
+/* Bring one RTU up to the store revision */
+static int sync_station(user_sync_manager_t *manager, const char *station_name) {
+    pthread_mutex_lock(&manager->lock);
+    rtu_sync_state_t *st = rtu_state(manager, station_name);
+    bool known = st && st->known;
+    uint32_t acked = st ? st->acked_nonce : 0;
+    pthread_mutex_unlock(&manager->lock);
+
+    if (!known) {
+        known = read_rtu_nonce(manager, station_name, &acked);
+    }
+
+    /* Build the payloads from the store, then send without the lock.
+     * Tombstones can outnumber one payload, so removals are collected
+     * here and split below. */
+    user_sync_payload_t update;
+    user_sync_record_t removals[USER_STORE_SIZE];
+    int update_count = 0;
+    int removal_count = 0;
+    bool full;
+
+    pthread_mutex_lock(&manager->lock);
+    uint32_t nonce = USER_SYNC_NONCE(manager->epoch, manager->revision);
+    uint32_t acked_revision = USER_SYNC_NONCE_REVISION(acked);
+    full = !known || USER_SYNC_NONCE_EPOCH(acked) != manager->epoch ||
+           acked_revision < manager->purged_revision || acked_revision > manager->revision;
+
+    if (!full && acked_revision == manager->revision) {
+        manager->stats.up_to_date_syncs++;
+        pthread_mutex_unlock(&manager->lock);
+        return 0;
+    }
+
+    for (int i = 0; i < manager->entry_count; i++) {
+        const user_entry_t *entry = &manager->entries[i];
+        if (entry->deleted) {
+            if (!full && entry->revision > acked_revision) {
+                fill_record(&removals[removal_count++], &entry->user);
+            }
+        } else if ((full || entry->revision > acked_revision) &&
+                   update_count < USER_SYNC_MAX_USERS) {
+            /* The store keeps at most USER_SYNC_MAX_USERS live users */
+            fill_record(&update.users[update_count++], &entry->user);
+        }
+    }
+    pthread_mutex_unlock(&manager->lock);
+
+    wtc_result_t send_result = WTC_OK;
+    if (full) {
+        finish_payload(&update, USER_SYNC_OP_FULL_SYNC, update_count, nonce);
+        send_result = write_payload(manager, station_name, &update);
+    } else {
+        /* Only the last write carries the new nonce. The ones before it
+         * repeat the RTU's own, so if a later write fails the RTU still
+         * reports the old revision and the whole delta is sent again. */
+        int writes = (removal_count + USER_SYNC_MAX_USERS - 1) / USER_SYNC_MAX_USERS +
+                     (update_count > 0 ? 1 : 0);
+        user_sync_payload_t removal;
+
+        for (int sent = 0; sent < removal_count && send_result == WTC_OK;) {
+            int count = removal_count - sent;
+            if (count > USER_SYNC_MAX_USERS) {
+                count = USER_SYNC_MAX_USERS;
+            }
+            memcpy(removal.users, &removals[sent], (size_t)count * sizeof(removals[0]));
+            finish_payload(&removal, USER_SYNC_OP_DELETE, count,
+                           --writes == 0 ? nonce : acked);
+            send_result = write_payload(manager, station_name, &removal);
+            sent += count;
+        }
+        if (send_result == WTC_OK && update_count > 0) {
+            finish_payload(&update, USER_SYNC_OP_ADD_UPDATE, update_count, nonce);
+            send_result = write_payload(manager, station_name, &update);
+        }
+    }
+
+    int result;
+    pthread_mutex_lock(&manager->lock);
 
     /* Update statistics */
     manager->stats.total_syncs++;
 
     if (send_result == WTC_OK) {
+        st = rtu_state(manager, station_name);
+        if (st && (!st->known || nonce_newer(nonce, st->acked_nonce))) {
+            st->acked_nonce = nonce;
+            st->known = true;
+        }
         manager->stats.successful_syncs++;
+        if (full) {
+            manager->stats.full_syncs++;
+        } else {
+            manager->stats.delta_syncs++;
+        }
         manager->stats.last_sync_time_ms = time_get_ms();
-        strncpy(manager->stats.last_sync_rtu, station_name,
-                WTC_MAX_STATION_NAME - 1);
-        LOG_INFO(LOG_TAG, "User sync to %s successful", station_name);
+        snprintf(manager->stats.last_sync_rtu, sizeof(manager->stats.last_sync_rtu),
+                 "%s", station_name);
         result = 0;
-    } else if (send_result == WTC_ERROR_NOT_CONNECTED) {
+    } else {
+        /* Re-read the RTU's revision next time */
+        st = rtu_state(manager, station_name);
+        if (st) {
+            st->known = false;
+        }
         manager->stats.failed_syncs++;
+        result = (send_result == WTC_ERROR_NOT_CONNECTED)
+                     ? WTC_USER_SYNC_ERROR_RTU_NOT_CONNECTED
+                     : WTC_USER_SYNC_ERROR_SEND;
+    }
+    pthread_mutex_unlock(&manager->lock);
+
+    if (send_result == WTC_OK) {
+        LOG_INFO(LOG_TAG, "User sync to %s successful (%s, revision %u:%u)",
+                 station_name, full ? "full" : "delta",
+                 USER_SYNC_NONCE_EPOCH(nonce), USER_SYNC_NONCE_REVISION(nonce));
+    } else if (send_result == WTC_ERROR_NOT_CONNECTED) {
         LOG_WARN(LOG_TAG, "RTU %s not connected", station_name);
-        result = WTC_USER_SYNC_ERROR_RTU_NOT_CONNECTED;
     } else {
-        manager->stats.failed_syncs++;
         LOG_ERROR(LOG_TAG, "Failed to send user sync to %s: %d",
                   station_name, send_result);
-        result = WTC_USER_SYNC_ERROR_SEND;
     }
 
     /* Invoke callback */
@@ -363,14 +666,76 @@ int user_sync_to_rtu(user_sync_manager_t *manager,
     return result;
 }
 
+/* ============== Sync ============== */
+
+int user_sync_update_users(user_sync_manager_t *manager,
+                           const user_t *users,
+                           int user_count) {
+    if (!manager || (!users && user_count > 0) || user_count < 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&manager->lock);
+    int changes = store_update(manager, users, user_count);
+    uint32_t revision = manager->revision;
+    pthread_mutex_unlock(&manager->lock);
+
+    if (changes > 0) {
+        LOG_INFO(LOG_TAG, "User store: %d change(s), revision %u", changes, revision);
+    }
+    return changes;
+}
+
+int user_sync_to_rtu(user_sync_manager_t *manager,
+                     const char *station_name,
+                     const user_t *users,
+                     int user_count) {
+    if (!manager || !station_name) {
+        return WTC_USER_SYNC_ERROR_INVALID_PARAM;
+    }
+
+    if (!manager->profinet) {
+        LOG_ERROR(LOG_TAG, "PROFINET controller not set");
+        return WTC_USER_SYNC_ERROR_SEND;
+    }
+
+    if (users) {
+        user_sync_update_users(manager, users, user_count);
+    }
+
+    return sync_station(manager, station_name);
+}
+
+typedef struct {
+    user_sync_manager_t *manager;
+    char (*stations)[WTC_MAX_STATION_NAME];
+    int count;
+    int next;
+    int successes;
+} fan_out_t;
+
+static void *fan_out_worker(void *arg) {
+    fan_out_t *fan = arg;
+    int i;
+    while ((i = __atomic_fetch_add(&fan->next, 1, __ATOMIC_RELAXED)) < fan->count) {
+        if (sync_station(fan->manager, fan->stations[i]) == 0) {
+            __atomic_fetch_add(&fan->successes, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
 int user_sync_to_all_rtus(user_sync_manager_t *manager,
                           const user_t *users,
                           int user_count) {
-    if (!manager || !users || !manager->registry) {
+    if (!manager || !manager->registry || !manager->profinet) {
         return 0;
     }
 
-    int success_count = 0;
+    if (users) {
+        user_sync_update_users(manager, users, user_count);
+    }
+
     rtu_device_t *devices = NULL;
     int device_count = 0;
 
@@ -380,22 +745,40 @@ int user_sync_to_all_rtus(user_sync_manager_t *manager,
         return 0;
     }
 
-    LOG_INFO(LOG_TAG, "Syncing %d users to %d RTUs", user_count, device_count);
-
+    fan_out_t fan = { .manager = manager };
+    fan.stations = calloc((size_t)(device_count > 0 ? device_count : 1),
+                          sizeof(*fan.stations));
+    if (!fan.stations) {
+        rtu_registry_free_device_list(devices, device_count);
+        return 0;
+    }
     for (int i = 0; i < device_count; i++) {
         if (devices[i].connection_state == PROFINET_STATE_RUNNING) {
-            int result = user_sync_to_rtu(
-                manager, devices[i].station_name, users, user_count);
-            if (result == 0) {
-                success_count++;
-            }
+            memcpy(fan.stations[fan.count++], devices[i].station_name,
+                   WTC_MAX_STATION_NAME);
         }
     }
+    rtu_registry_free_device_list(devices, device_count);
+
+    /* Up to max_in_flight RTUs at once; this thread is one of them */
+    pthread_t threads[MAX_SYNC_THREADS];
+    int thread_count = 0;
+    int wanted = fan.count < manager->config.max_in_flight ? fan.count
+                                                            : manager->config.max_in_flight;
+    while (thread_count < wanted - 1 &&
+           pthread_create(&threads[thread_count], NULL, fan_out_worker, &fan) == 0) {
+        thread_count++;
+    }
+    fan_out_worker(&fan);
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
 
     LOG_INFO(LOG_TAG, "User sync complete: %d/%d RTUs successful",
-             success_count, device_count);
+             fan.successes, fan.count);
 
-    return success_count;
+    free(fan.stations);
+    return fan.successes;
 }
 
 void user_sync_on_rtu_connect(user_sync_manager_t *manager,
@@ -406,31 +789,41 @@ void user_sync_on_rtu_connect(user_sync_manager_t *manager,
         return;
     }
 
-    /* Use cached users if none provided */
-    if (!users || user_count <= 0) {
-        users = manager->cached_users;
-        user_count = manager->cached_user_count;
+    if (users && user_count > 0) {
+        user_sync_update_users(manager, users, user_count);
+    }
+
+    /* The RTU may have been replaced or reset; ask it again */
+    pthread_mutex_lock(&manager->lock);
+    uint32_t revision = manager->revision;
+    rtu_sync_state_t *st = rtu_state(manager, station_name);
+    if (st) {
+        st->known = false;
     }
+    pthread_mutex_unlock(&manager->lock);
 
-    if (!users || user_count <= 0) {
+    if (revision == 0) {
         LOG_INFO(LOG_TAG, "RTU %s connected but no users cached for sync", station_name);
         return;
     }
 
-    LOG_INFO(LOG_TAG, "RTU %s connected, triggering user sync (%d users)",
-             station_name, user_count);
-    user_sync_to_rtu(manager, station_name, users, user_count);
+    LOG_INFO(LOG_TAG, "RTU %s connected, triggering user sync", station_name);
+    sync_station(manager, station_name);
 }
 
 void user_sync_on_user_change(user_sync_manager_t *manager,
                               const user_t *users,
                               int user_count) {
-    if (!manager || !manager->config.auto_sync_on_change) {
+    if (!manager || !users || !manager->config.auto_sync_on_change) {
+        return;
+    }
+
+    if (user_sync_update_users(manager, users, user_count) == 0) {
         return;
     }
 
     LOG_INFO(LOG_TAG, "User change detected, syncing to all RTUs");
-    user_sync_to_all_rtus(manager, users, user_count);
+    user_sync_to_all_rtus(manager, NULL, 0);
 }
 
 void user_sync_cache_users(user_sync_manager_t *manager,
@@ -439,12 +832,7 @@ void user_sync_cache_users(user_sync_manager_t *manager,
     if (!manager || !users || user_count <= 0) {
         return;
     }
-    if (user_count > USER_SYNC_MAX_USERS) {
-        user_count = USER_SYNC_MAX_USERS;
-    }
-    memcpy(manager->cached_users, users, user_count * sizeof(user_t));
-    manager->cached_user_count = user_count;
-    LOG_INFO(LOG_TAG, "Cached %d users for auto-sync on connect", user_count);
+    user_sync_update_users(manager, users, user_count);
 }
 
 wtc_result_t user_sync_get_stats(user_sync_manager_t *manager,
@@ -453,6 +841,9 @@ wtc_result_t user_sync_get_stats(user_sync_manager_t *manager,
         return WTC_ERROR_INVALID_PARAM;
     }
 
+    pthread_mutex_lock(&manager->lock);
     memcpy(stats, &manager->stats, sizeof(user_sync_stats_t));
+    stats->revision = manager->revision;
+    pthread_mutex_unlock(&manager->lock);
     return WTC_OK;
 }
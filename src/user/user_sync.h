@@ -8,6 +8,14 @@
  *
  * Wire protocol definitions are in shared/include/user_sync_protocol.h
  * to ensure Controller and RTU use identical formats.
+ *
+ * The manager keeps a revisioned copy of the user list. Each change
+ * (add, update, delete) gets the next store revision; an RTU that has
+ * applied revision N is sent only the users changed after N, so a
+ * password change costs one small record write per RTU. Syncs to many
+ * RTUs run max_in_flight at a time. Revisions are kept in memory only;
+ * the nonce sent with them carries an epoch chosen at each start, and
+ * an RTU whose nonce is from another epoch gets the full list.
  */
 
 #ifndef WTC_USER_SYNC_H
@@ -57,6 +65,7 @@ typedef struct {
     uint32_t sync_timeout_ms;       /* Timeout for sync operation */
     uint32_t retry_count;           /* Number of retries on failure */
     uint32_t retry_delay_ms;        /* Delay between retries */
+    int max_in_flight;              /* RTUs synced concurrently */
 } user_sync_config_t;
 
 /* Sync result callback */
@@ -69,6 +78,10 @@ typedef struct {
     uint32_t total_syncs;
     uint32_t successful_syncs;
     uint32_t failed_syncs;
+    uint32_t full_syncs;            /* Whole list sent */
+    uint32_t delta_syncs;           /* Only changed users sent */
+    uint32_t up_to_date_syncs;      /* Nothing to send */
+    uint32_t revision;              /* Current store revision */
     uint64_t last_sync_time_ms;
     char last_sync_rtu[WTC_MAX_STATION_NAME];
 } user_sync_stats_t;
@@ -112,15 +125,24 @@ bool user_sync_verify_password(const char *password,
 uint16_t user_sync_crc16(const uint8_t *data, size_t len);
 
 /**
- * Serialize users into sync payload.
+ * Epoch of this controller start, carried in the high half of every
+ * sync nonce (USER_SYNC_NONCE). Never 0.
+ */
+uint16_t user_sync_boot_epoch(void);
+
+/**
+ * Serialize users into a full sync payload.
  *
  * @param users         Array of user records (from types.h user_t)
  * @param user_count    Number of users (capped at USER_SYNC_MAX_USERS)
+ * @param nonce         Epoch and revision the payload brings the RTU to
+ *                      (USER_SYNC_NONCE)
  * @param payload       Output payload buffer
  * @return 0 on success, negative error code otherwise
  */
 int user_sync_serialize(const user_t *users,
                         int user_count,
+                        uint32_t nonce,
                         user_sync_payload_t *payload);
 
 /**
@@ -170,18 +192,34 @@ wtc_result_t user_sync_set_registry(user_sync_manager_t *manager,
                                      struct rtu_registry *registry);
 
 /**
- * Set callback for sync results.
+ * Set callback for sync results. Called from the syncing thread, which
+ * may be a fan-out worker.
  */
 void user_sync_set_callback(user_sync_manager_t *manager,
                             user_sync_callback_t callback,
                             void *ctx);
 
+/**
+ * Replace the user list. Users are matched by username; added, changed
+ * and removed users get new revisions and are sent on the next sync.
+ *
+ * @param manager       Sync manager
+ * @param users         Full user list (may be NULL when user_count is 0)
+ * @param user_count    Number of users
+ * @return Number of users added, changed or removed
+ */
+int user_sync_update_users(user_sync_manager_t *manager,
+                           const user_t *users,
+                           int user_count);
+
 /**
  * Sync users to a specific RTU.
+ * Sends only what changed since the revision the RTU last applied, or
+ * the full list when that revision is unknown.
  *
  * @param manager       Sync manager
  * @param station_name  RTU station name
- * @param users         Array of users to sync
+ * @param users         Users to store first (NULL to sync the stored list)
  * @param user_count    Number of users
  * @return 0 on success, negative error code otherwise
  */
@@ -191,10 +229,10 @@ int user_sync_to_rtu(user_sync_manager_t *manager,
                      int user_count);
 
 /**
- * Sync users to all connected RTUs.
+ * Sync users to all connected RTUs, max_in_flight at a time.
  *
  * @param manager       Sync manager
- * @param users         Array of users to sync
+ * @param users         Users to store first (NULL to sync the stored list)
  * @param user_count    Number of users
  * @return Number of RTUs successfully synced
  */
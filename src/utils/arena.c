@@ -0,0 +1,223 @@
+/*
+ * Water Treatment Controller - Arena Allocator Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+    size_t pad;                 /* Keeps data ARENA_ALIGN-aligned */
+    unsigned char data[];
+} arena_chunk_t;
+
+struct arena {
+    arena_chunk_t *first;
+    arena_chunk_t *current;
+    size_t chunk_size;
+    size_t used;                /* Across all chunks since the last reset */
+    arena_stats_t stats;
+    bool scratch;
+    uint64_t reported_allocs;   /* Allocations already added to the scratch totals */
+};
+
+/* Scratch arena totals, updated when chunks change and on reset */
+static struct {
+    int count;
+    size_t reserved;
+    size_t high_water;
+    uint64_t allocs;
+    uint64_t resets;
+    uint64_t chunk_allocs;
+} g_scratch;
+
+static pthread_key_t g_scratch_key;
+static pthread_once_t g_scratch_once = PTHREAD_ONCE_INIT;
+static __thread arena_t *t_scratch;
+
+static size_t align_up(size_t n) {
+    return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static arena_chunk_t *chunk_new(arena_t *arena, size_t size) {
+    arena_chunk_t *chunk = malloc(sizeof(arena_chunk_t) + size);
+    if (!chunk) return NULL;
+
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+
+    arena->stats.reserved += size;
+    arena->stats.chunk_allocs++;
+    if (arena->scratch) {
+        __atomic_add_fetch(&g_scratch.reserved, size, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&g_scratch.chunk_allocs, 1, __ATOMIC_RELAXED);
+    }
+    return chunk;
+}
+
+static void chunks_free(arena_t *arena, arena_chunk_t *chunk) {
+    while (chunk) {
+        arena_chunk_t *next = chunk->next;
+        arena->stats.reserved -= chunk->size;
+        if (arena->scratch) {
+            __atomic_sub_fetch(&g_scratch.reserved, chunk->size, __ATOMIC_RELAXED);
+        }
+        free(chunk);
+        chunk = next;
+    }
+}
+
+wtc_result_t arena_init(arena_t **arena, size_t chunk_size) {
+    if (!arena) return WTC_ERROR_INVALID_PARAM;
+
+    arena_t *a = calloc(1, sizeof(arena_t));
+    if (!a) return WTC_ERROR_NO_MEMORY;
+
+    a->chunk_size = align_up(chunk_size ? chunk_size : ARENA_DEFAULT_CHUNK);
+    a->first = chunk_new(a, a->chunk_size);
+    if (!a->first) {
+        free(a);
+        return WTC_ERROR_NO_MEMORY;
+    }
+    a->current = a->first;
+
+    *arena = a;
+    return WTC_OK;
+}
+
+void arena_cleanup(arena_t *arena) {
+    if (!arena) return;
+    chunks_free(arena, arena->first);
+    free(arena);
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    if (!arena) return NULL;
+
+    size = align_up(size ? size : 1);
+    arena_chunk_t *chunk = arena->current;
+
+    if (chunk->size - chunk->used < size) {
+        /* Overflow: chain a chunk big enough for this allocation */
+        size_t chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+        arena_chunk_t *next = chunk_new(arena, chunk_size);
+        if (!next) return NULL;
+        chunk->next = next;
+        arena->current = chunk = next;
+    }
+
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->used += size;
+    arena->stats.allocs++;
+    return ptr;
+}
+
+void *arena_calloc(arena_t *arena, size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) return NULL;
+
+    void *ptr = arena_alloc(arena, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void arena_reset(arena_t *arena) {
+    if (!arena) return;
+
+    if (arena->used > arena->stats.high_water) {
+        arena->stats.high_water = arena->used;
+    }
+
+    /* Fold overflow chunks into one first chunk that fits the high water */
+    if (arena->first->next) {
+        size_t size = align_up(arena->stats.high_water);
+        arena_chunk_t *grown = chunk_new(arena, size > arena->chunk_size ? size : arena->chunk_size);
+        if (grown) {
+            chunks_free(arena, arena->first);
+            arena->first = grown;
+        } else {
+            chunks_free(arena, arena->first->next);
+            arena->first->next = NULL;
+        }
+    }
+
+    if (arena->scratch) {
+        size_t high = __atomic_load_n(&g_scratch.high_water, __ATOMIC_RELAXED);
+        while (arena->used > high &&
+               !__atomic_compare_exchange_n(&g_scratch.high_water, &high, arena->used,
+                                            false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+        __atomic_add_fetch(&g_scratch.allocs, arena->stats.allocs - arena->reported_allocs,
+                           __ATOMIC_RELAXED);
+        __atomic_add_fetch(&g_scratch.resets, 1, __ATOMIC_RELAXED);
+        arena->reported_allocs = arena->stats.allocs;
+    }
+
+    arena->first->used = 0;
+    arena->current = arena->first;
+    arena->used = 0;
+    arena->stats.resets++;
+}
+
+void arena_get_stats(const arena_t *arena, arena_stats_t *stats) {
+    if (!arena || !stats) return;
+    *stats = arena->stats;
+    stats->used = arena->used;
+    if (arena->used > stats->high_water) {
+        stats->high_water = arena->used;
+    }
+}
+
+static void scratch_destroy(void *ptr) {
+    arena_t *arena = ptr;
+    __atomic_sub_fetch(&g_scratch.count, 1, __ATOMIC_RELAXED);
+    arena_cleanup(arena);
+}
+
+static void scratch_key_create(void) {
+    pthread_key_create(&g_scratch_key, scratch_destroy);
+}
+
+arena_t *arena_scratch(void) {
+    if (t_scratch) return t_scratch;
+
+    pthread_once(&g_scratch_once, scratch_key_create);
+
+    arena_t *arena = NULL;
+    if (arena_init(&arena, ARENA_DEFAULT_CHUNK) != WTC_OK) {
+        return NULL;
+    }
+    arena->scratch = true;
+    __atomic_add_fetch(&g_scratch.count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&g_scratch.reserved, arena->stats.reserved, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&g_scratch.chunk_allocs, 1, __ATOMIC_RELAXED);
+
+    pthread_setspecific(g_scratch_key, arena);
+    t_scratch = arena;
+    return arena;
+}
+
+void arena_scratch_stats(arena_stats_t *stats, int *count) {
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        stats->reserved = __atomic_load_n(&g_scratch.reserved, __ATOMIC_RELAXED);
+        stats->high_water = __atomic_load_n(&g_scratch.high_water, __ATOMIC_RELAXED);
+        stats->allocs = __atomic_load_n(&g_scratch.allocs, __ATOMIC_RELAXED);
+        stats->resets = __atomic_load_n(&g_scratch.resets, __ATOMIC_RELAXED);
+        stats->chunk_allocs = __atomic_load_n(&g_scratch.chunk_allocs, __ATOMIC_RELAXED);
+    }
+    if (count) {
+        *count = __atomic_load_n(&g_scratch.count, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Water Treatment Controller - Arena Allocator
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Bump allocator for scratch memory that lives for one cycle or one
+ * request: allocations are never freed individually, arena_reset()
+ * releases them all at once. When a cycle outgrows the arena, extra
+ * chunks are taken from the heap; the next reset folds them into one
+ * chunk sized for the high-water mark, so a steady workload stops
+ * touching the heap after its first cycles.
+ *
+ * An arena is not thread-safe. Each thread has its own scratch arena
+ * (arena_scratch()) for short-lived copies; whoever owns the cycle or
+ * request resets it.
+ */
+
+#ifndef WTC_ARENA_H
+#define WTC_ARENA_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARENA_DEFAULT_CHUNK     (64 * 1024)
+#define ARENA_ALIGN             16
+
+typedef struct arena arena_t;
+
+/* Arena statistics */
+typedef struct {
+    size_t reserved;            /* Bytes held in chunks */
+    size_t used;                /* Bytes allocated since the last reset */
+    size_t high_water;          /* Largest use between resets */
+    uint64_t allocs;
+    uint64_t resets;
+    uint64_t chunk_allocs;      /* Chunks taken from the heap */
+} arena_stats_t;
+
+/* Create an arena whose first chunk holds chunk_size bytes (0 = default) */
+wtc_result_t arena_init(arena_t **arena, size_t chunk_size);
+
+/* Free the arena and everything allocated from it */
+void arena_cleanup(arena_t *arena);
+
+/* Allocate size bytes aligned to ARENA_ALIGN; NULL if out of memory */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/* Allocate a zeroed array */
+void *arena_calloc(arena_t *arena, size_t count, size_t size);
+
+/* Release every allocation */
+void arena_reset(arena_t *arena);
+
+/* Get statistics */
+void arena_get_stats(const arena_t *arena, arena_stats_t *stats);
+
+/* The calling thread's scratch arena, created on first use and freed
+ * when the thread exits. NULL if it cannot be created. */
+arena_t *arena_scratch(void);
+
+/* Totals over all scratch arenas; *count receives the number of arenas */
+void arena_scratch_stats(arena_stats_t *stats, int *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_ARENA_H */
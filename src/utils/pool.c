@@ -0,0 +1,175 @@
+/*
+ * Water Treatment Controller - Object Pool Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+struct object_pool {
+    char name[32];
+    size_t object_size;         /* Rounded up to 16 bytes */
+    int capacity;
+    unsigned char *slab;
+    uint32_t *next;             /* Free-list link per object, index + 1 */
+    uint64_t head;              /* ABA tag << 32 | top index + 1 (0 = empty) */
+    int in_use;
+    int high_water;
+    uint64_t allocs;
+    uint64_t fallbacks;
+};
+
+/* Registered pools for diagnostics */
+static pthread_mutex_t g_pools_lock = PTHREAD_MUTEX_INITIALIZER;
+static object_pool_t *g_pools[POOL_MAX_REGISTERED];
+
+static void pool_register(object_pool_t *pool) {
+    pthread_mutex_lock(&g_pools_lock);
+    for (int i = 0; i < POOL_MAX_REGISTERED; i++) {
+        if (!g_pools[i]) {
+            g_pools[i] = pool;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_pools_lock);
+}
+
+static void pool_unregister(object_pool_t *pool) {
+    pthread_mutex_lock(&g_pools_lock);
+    for (int i = 0; i < POOL_MAX_REGISTERED; i++) {
+        if (g_pools[i] == pool) {
+            g_pools[i] = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_pools_lock);
+}
+
+wtc_result_t pool_init(object_pool_t **pool, const char *name,
+                       size_t object_size, int capacity) {
+    if (!pool || object_size == 0 || capacity <= 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    object_pool_t *p = calloc(1, sizeof(object_pool_t));
+    if (!p) return WTC_ERROR_NO_MEMORY;
+
+    snprintf(p->name, sizeof(p->name), "%s", name ? name : "pool");
+    p->object_size = (object_size + 15) & ~(size_t)15;
+    p->capacity = capacity;
+    p->slab = aligned_alloc(16, p->object_size * (size_t)capacity);
+    p->next = calloc(capacity, sizeof(uint32_t));
+    if (!p->slab || !p->next) {
+        free(p->slab);
+        free(p->next);
+        free(p);
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    /* Free list in address order */
+    for (int i = 0; i < capacity; i++) {
+        p->next[i] = (i + 1 < capacity) ? (uint32_t)(i + 2) : 0;
+    }
+    p->head = 1;
+
+    pool_register(p);
+    *pool = p;
+    return WTC_OK;
+}
+
+void pool_cleanup(object_pool_t *pool) {
+    if (!pool) return;
+    pool_unregister(pool);
+    free(pool->slab);
+    free(pool->next);
+    free(pool);
+}
+
+static void note_in_use(object_pool_t *pool, int delta) {
+    int in_use = __atomic_add_fetch(&pool->in_use, delta, __ATOMIC_RELAXED);
+    int high = __atomic_load_n(&pool->high_water, __ATOMIC_RELAXED);
+    while (in_use > high &&
+           !__atomic_compare_exchange_n(&pool->high_water, &high, in_use,
+                                        false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void *pool_alloc(object_pool_t *pool) {
+    if (!pool) return NULL;
+
+    __atomic_add_fetch(&pool->allocs, 1, __ATOMIC_RELAXED);
+
+    uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t top = (uint32_t)head;
+        if (top == 0) break;
+
+        uint32_t next = __atomic_load_n(&pool->next[top - 1], __ATOMIC_RELAXED);
+        uint64_t new_head = ((head >> 32) + 1) << 32 | next;
+        if (__atomic_compare_exchange_n(&pool->head, &head, new_head, true,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            note_in_use(pool, 1);
+            void *object = pool->slab + (size_t)(top - 1) * pool->object_size;
+            memset(object, 0, pool->object_size);
+            return object;
+        }
+    }
+
+    __atomic_add_fetch(&pool->fallbacks, 1, __ATOMIC_RELAXED);
+    return calloc(1, pool->object_size);
+}
+
+void pool_free(object_pool_t *pool, void *object) {
+    if (!pool || !object) return;
+
+    unsigned char *p = object;
+    size_t slab_bytes = pool->object_size * (size_t)pool->capacity;
+    if (p < pool->slab || p >= pool->slab + slab_bytes) {
+        free(object);
+        return;
+    }
+
+    uint32_t index = (uint32_t)((size_t)(p - pool->slab) / pool->object_size);
+    uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+    for (;;) {
+        __atomic_store_n(&pool->next[index], (uint32_t)head, __ATOMIC_RELAXED);
+        uint64_t new_head = ((head >> 32) + 1) << 32 | (index + 1);
+        if (__atomic_compare_exchange_n(&pool->head, &head, new_head, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    note_in_use(pool, -1);
+}
+
+void pool_get_stats(object_pool_t *pool, pool_stats_t *stats) {
+    if (!pool || !stats) return;
+
+    memset(stats, 0, sizeof(*stats));
+    snprintf(stats->name, sizeof(stats->name), "%s", pool->name);
+    stats->object_size = pool->object_size;
+    stats->capacity = pool->capacity;
+    stats->in_use = __atomic_load_n(&pool->in_use, __ATOMIC_RELAXED);
+    stats->high_water = __atomic_load_n(&pool->high_water, __ATOMIC_RELAXED);
+    stats->allocs = __atomic_load_n(&pool->allocs, __ATOMIC_RELAXED);
+    stats->fallbacks = __atomic_load_n(&pool->fallbacks, __ATOMIC_RELAXED);
+}
+
+int pool_list_stats(pool_stats_t *stats, int max_count) {
+    if (!stats) return 0;
+
+    int count = 0;
+    pthread_mutex_lock(&g_pools_lock);
+    for (int i = 0; i < POOL_MAX_REGISTERED && count < max_count; i++) {
+        if (g_pools[i]) {
+            pool_get_stats(g_pools[i], &stats[count++]);
+        }
+    }
+    pthread_mutex_unlock(&g_pools_lock);
+    return count;
+}
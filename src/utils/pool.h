@@ -0,0 +1,64 @@
+/*
+ * Water Treatment Controller - Object Pool
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Fixed-size objects from one preallocated slab, for objects that are
+ * allocated and freed at a high rate. The free list is a lock-free
+ * stack (index plus ABA tag in one 64-bit word), so threads never wait
+ * on each other or on the heap lock. When the slab is exhausted,
+ * pool_alloc() falls back to the heap and pool_free() recognizes such
+ * objects by address, so callers never need to care where an object
+ * came from.
+ *
+ * Pools register themselves by name for diagnostics (pool_list_stats).
+ */
+
+#ifndef WTC_POOL_H
+#define WTC_POOL_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POOL_MAX_REGISTERED     16
+
+typedef struct object_pool object_pool_t;
+
+/* Pool statistics */
+typedef struct {
+    char name[32];
+    size_t object_size;
+    int capacity;
+    int in_use;                 /* Objects out of the slab */
+    int high_water;
+    uint64_t allocs;
+    uint64_t fallbacks;         /* Allocations served by the heap */
+} pool_stats_t;
+
+/* Create a pool of capacity objects of object_size bytes */
+wtc_result_t pool_init(object_pool_t **pool, const char *name,
+                       size_t object_size, int capacity);
+
+/* Free the pool. Objects still out of the slab become invalid. */
+void pool_cleanup(object_pool_t *pool);
+
+/* Allocate a zeroed object; NULL only if the heap fallback fails */
+void *pool_alloc(object_pool_t *pool);
+
+/* Return an object from pool_alloc() */
+void pool_free(object_pool_t *pool, void *object);
+
+/* Get statistics */
+void pool_get_stats(object_pool_t *pool, pool_stats_t *stats);
+
+/* Statistics of all live pools; returns the number filled in */
+int pool_list_stats(pool_stats_t *stats, int max_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_POOL_H */
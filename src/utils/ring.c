@@ -0,0 +1,440 @@
+/*
+ * Water Treatment Controller - Lock-Free Ring Buffers Implementation
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "ring.h"
+#include "time_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/* ============== Common ============== */
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+/* Wake a consumer sleeping in ring_wait(); called after publishing */
+static void ring_wake(ring_wait_t *wait) {
+    /* Order the publish before the sleeping check (pairs with ring_wait) */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&wait->sleeping, __ATOMIC_RELAXED) == 0) {
+        return;
+    }
+
+    /* Only the first producer to see the flag pays for the syscall */
+    if (__atomic_exchange_n(&wait->sleeping, 0, __ATOMIC_RELAXED)) {
+        __atomic_add_fetch(&wait->seq, 1, __ATOMIC_RELEASE);
+        syscall(SYS_futex, &wait->seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+
+typedef wtc_result_t (*ring_pop_fn)(void *ring, void *element);
+
+/* Retry pop until it succeeds, sleeping on the futex in between */
+static wtc_result_t ring_wait(ring_wait_t *wait, ring_pop_fn pop, void *ring,
+                              void *element, int timeout_ms) {
+    uint64_t deadline_ms = timeout_ms >= 0 ?
+                           time_get_monotonic_ms() + (uint64_t)timeout_ms : 0;
+
+    for (;;) {
+        if (pop(ring, element) == WTC_OK) {
+            return WTC_OK;
+        }
+
+        uint32_t seq = __atomic_load_n(&wait->seq, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&wait->sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        /* A push between the first check and setting the flag would not wake us */
+        if (pop(ring, element) == WTC_OK) {
+            __atomic_store_n(&wait->sleeping, 0, __ATOMIC_RELAXED);
+            return WTC_OK;
+        }
+
+        struct timespec ts;
+        struct timespec *timeout = NULL;
+        if (timeout_ms >= 0) {
+            uint64_t now_ms = time_get_monotonic_ms();
+            if (now_ms >= deadline_ms) {
+                __atomic_store_n(&wait->sleeping, 0, __ATOMIC_RELAXED);
+                return WTC_ERROR_TIMEOUT;
+            }
+            uint64_t left_ms = deadline_ms - now_ms;
+            ts.tv_sec = (time_t)(left_ms / 1000);
+            ts.tv_nsec = (long)(left_ms % 1000) * 1000000L;
+            timeout = &ts;
+        }
+
+        syscall(SYS_futex, &wait->seq, FUTEX_WAIT_PRIVATE, seq, timeout, NULL, 0);
+    }
+}
+
+/* Copy count elements into the ring at pos, wrapping at the end */
+static void copy_in(uint8_t *data, size_t mask, size_t element_size,
+                    size_t pos, const void *elements, size_t count) {
+    size_t index = pos & mask;
+    size_t first = mask + 1 - index;
+    if (first > count) first = count;
+
+    memcpy(data + index * element_size, elements, first * element_size);
+    if (count > first) {
+        memcpy(data, (const uint8_t *)elements + first * element_size,
+               (count - first) * element_size);
+    }
+}
+
+/* Copy count elements out of the ring from pos, wrapping at the end */
+static void copy_out(const uint8_t *data, size_t mask, size_t element_size,
+                     size_t pos, void *elements, size_t count) {
+    size_t index = pos & mask;
+    size_t first = mask + 1 - index;
+    if (first > count) first = count;
+
+    memcpy(elements, data + index * element_size, first * element_size);
+    if (count > first) {
+        memcpy((uint8_t *)elements + first * element_size, data,
+               (count - first) * element_size);
+    }
+}
+
+/* ============== SPSC ============== */
+
+wtc_result_t spsc_ring_init(spsc_ring_t *ring, size_t element_size,
+                            size_t capacity, bool blocking) {
+    if (!ring || element_size == 0 || capacity == 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    capacity = round_up_pow2(capacity);
+
+    ring->data = calloc(capacity, element_size);
+    if (!ring->data) {
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    ring->element_size = element_size;
+    ring->mask = capacity - 1;
+    ring->blocking = blocking;
+    return WTC_OK;
+}
+
+void spsc_ring_free(spsc_ring_t *ring) {
+    if (!ring) return;
+
+    free(ring->data);
+    ring->data = NULL;
+    ring->mask = 0;
+}
+
+/* Free slots as seen by the producer, refreshing its view of tail if needed */
+static size_t spsc_free_slots(spsc_ring_t *ring, size_t head, size_t wanted) {
+    size_t capacity = ring->mask + 1;
+    size_t free_slots = capacity - (head - ring->tail_cache);
+    if (free_slots < wanted) {
+        ring->tail_cache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        free_slots = capacity - (head - ring->tail_cache);
+    }
+    return free_slots;
+}
+
+/* Queued elements as seen by the consumer, refreshing its view of head if needed */
+static size_t spsc_used_slots(spsc_ring_t *ring, size_t tail, size_t wanted) {
+    size_t used = ring->head_cache - tail;
+    if (used < wanted) {
+        ring->head_cache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        used = ring->head_cache - tail;
+    }
+    return used;
+}
+
+wtc_result_t spsc_ring_push(spsc_ring_t *ring, const void *element) {
+    if (!ring || !ring->data || !element) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    if (spsc_free_slots(ring, head, 1) == 0) {
+        return WTC_ERROR_FULL;
+    }
+
+    memcpy(ring->data + (head & ring->mask) * ring->element_size,
+           element, ring->element_size);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    if (ring->blocking) {
+        ring_wake(&ring->wait);
+    }
+    return WTC_OK;
+}
+
+wtc_result_t spsc_ring_pop(spsc_ring_t *ring, void *element) {
+    if (!ring || !ring->data || !element) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    if (spsc_used_slots(ring, tail, 1) == 0) {
+        return WTC_ERROR_EMPTY;
+    }
+
+    memcpy(element, ring->data + (tail & ring->mask) * ring->element_size,
+           ring->element_size);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return WTC_OK;
+}
+
+size_t spsc_ring_push_batch(spsc_ring_t *ring, const void *elements, size_t count) {
+    if (!ring || !ring->data || !elements || count == 0) {
+        return 0;
+    }
+
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    size_t free_slots = spsc_free_slots(ring, head, count);
+    if (count > free_slots) count = free_slots;
+    if (count == 0) return 0;
+
+    copy_in(ring->data, ring->mask, ring->element_size, head, elements, count);
+    __atomic_store_n(&ring->head, head + count, __ATOMIC_RELEASE);
+
+    if (ring->blocking) {
+        ring_wake(&ring->wait);
+    }
+    return count;
+}
+
+size_t spsc_ring_pop_batch(spsc_ring_t *ring, void *elements, size_t max_count) {
+    if (!ring || !ring->data || !elements || max_count == 0) {
+        return 0;
+    }
+
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    size_t count = spsc_used_slots(ring, tail, max_count);
+    if (count > max_count) count = max_count;
+    if (count == 0) return 0;
+
+    copy_out(ring->data, ring->mask, ring->element_size, tail, elements, count);
+    __atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+static wtc_result_t spsc_pop_any(void *ring, void *element) {
+    return spsc_ring_pop(ring, element);
+}
+
+wtc_result_t spsc_ring_pop_wait(spsc_ring_t *ring, void *element, int timeout_ms) {
+    if (!ring || !ring->data || !element || !ring->blocking) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    return ring_wait(&ring->wait, spsc_pop_any, ring, element, timeout_ms);
+}
+
+size_t spsc_ring_count(const spsc_ring_t *ring) {
+    if (!ring) return 0;
+
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    return head - tail;
+}
+
+size_t spsc_ring_capacity(const spsc_ring_t *ring) {
+    return (ring && ring->data) ? ring->mask + 1 : 0;
+}
+
+/* ============== MPSC ============== */
+
+/*
+ * Bounded queue after D. Vyukov: every slot carries a sequence number.
+ * Slot i is free for position p when seq == p, and holds the element of
+ * position p once seq == p + 1. The consumer frees it for the next lap
+ * by setting seq = p + capacity.
+ */
+
+wtc_result_t mpsc_ring_init(mpsc_ring_t *ring, size_t element_size,
+                            size_t capacity, bool blocking) {
+    if (!ring || element_size == 0 || capacity == 0) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    capacity = round_up_pow2(capacity);
+
+    ring->data = calloc(capacity, element_size);
+    ring->seq = malloc(capacity * sizeof(size_t));
+    if (!ring->data || !ring->seq) {
+        free(ring->data);
+        free(ring->seq);
+        ring->data = NULL;
+        ring->seq = NULL;
+        return WTC_ERROR_NO_MEMORY;
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        ring->seq[i] = i;
+    }
+
+    ring->element_size = element_size;
+    ring->mask = capacity - 1;
+    ring->blocking = blocking;
+    return WTC_OK;
+}
+
+void mpsc_ring_free(mpsc_ring_t *ring) {
+    if (!ring) return;
+
+    free(ring->data);
+    free(ring->seq);
+    ring->data = NULL;
+    ring->seq = NULL;
+    ring->mask = 0;
+}
+
+wtc_result_t mpsc_ring_push(mpsc_ring_t *ring, const void *element) {
+    if (!ring || !ring->data || !element) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    size_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    for (;;) {
+        size_t seq = __atomic_load_n(&ring->seq[pos & ring->mask], __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* Slot still holds the element from the previous lap */
+            return WTC_ERROR_FULL;
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    memcpy(ring->data + (pos & ring->mask) * ring->element_size,
+           element, ring->element_size);
+    __atomic_store_n(&ring->seq[pos & ring->mask], pos + 1, __ATOMIC_RELEASE);
+
+    if (ring->blocking) {
+        ring_wake(&ring->wait);
+    }
+    return WTC_OK;
+}
+
+wtc_result_t mpsc_ring_pop(mpsc_ring_t *ring, void *element) {
+    if (!ring || !ring->data || !element) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    size_t index = tail & ring->mask;
+    if (__atomic_load_n(&ring->seq[index], __ATOMIC_ACQUIRE) != tail + 1) {
+        return WTC_ERROR_EMPTY;
+    }
+
+    memcpy(element, ring->data + index * ring->element_size, ring->element_size);
+    __atomic_store_n(&ring->seq[index], tail + ring->mask + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return WTC_OK;
+}
+
+size_t mpsc_ring_push_batch(mpsc_ring_t *ring, const void *elements, size_t count) {
+    if (!ring || !ring->data || !elements || count == 0) {
+        return 0;
+    }
+
+    /*
+     * Claim count positions at once. The consumer frees slots before it
+     * advances tail, so every position below tail + capacity is free.
+     */
+    size_t capacity = ring->mask + 1;
+    size_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    size_t claimed;
+    for (;;) {
+        size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        size_t used = pos - tail;
+        if (used > capacity) {
+            /* Stale head from before the consumer caught up */
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        claimed = capacity - used;
+        if (claimed > count) claimed = count;
+        if (claimed == 0) return 0;
+
+        if (__atomic_compare_exchange_n(&ring->head, &pos, pos + claimed, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    copy_in(ring->data, ring->mask, ring->element_size, pos, elements, claimed);
+    for (size_t i = 0; i < claimed; i++) {
+        __atomic_store_n(&ring->seq[(pos + i) & ring->mask], pos + i + 1,
+                         __ATOMIC_RELEASE);
+    }
+
+    if (ring->blocking) {
+        ring_wake(&ring->wait);
+    }
+    return claimed;
+}
+
+size_t mpsc_ring_pop_batch(mpsc_ring_t *ring, void *elements, size_t max_count) {
+    if (!ring || !ring->data || !elements || max_count == 0) {
+        return 0;
+    }
+
+    /* Elements are published one slot at a time; take the ready prefix */
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    size_t count = 0;
+    while (count < max_count &&
+           __atomic_load_n(&ring->seq[(tail + count) & ring->mask], __ATOMIC_ACQUIRE) ==
+           tail + count + 1) {
+        count++;
+    }
+    if (count == 0) return 0;
+
+    copy_out(ring->data, ring->mask, ring->element_size, tail, elements, count);
+    for (size_t i = 0; i < count; i++) {
+        __atomic_store_n(&ring->seq[(tail + i) & ring->mask], tail + i + ring->mask + 1,
+                         __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+static wtc_result_t mpsc_pop_any(void *ring, void *element) {
+    return mpsc_ring_pop(ring, element);
+}
+
+wtc_result_t mpsc_ring_pop_wait(mpsc_ring_t *ring, void *element, int timeout_ms) {
+    if (!ring || !ring->data || !element || !ring->blocking) {
+        return WTC_ERROR_INVALID_PARAM;
+    }
+    return ring_wait(&ring->wait, mpsc_pop_any, ring, element, timeout_ms);
+}
+
+size_t mpsc_ring_count(const mpsc_ring_t *ring) {
+    if (!ring) return 0;
+
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    return head > tail ? head - tail : 0;
+}
+
+size_t mpsc_ring_capacity(const mpsc_ring_t *ring) {
+    return (ring && ring->data) ? ring->mask + 1 : 0;
+}
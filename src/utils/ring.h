@@ -0,0 +1,139 @@
+/*
+ * Water Treatment Controller - Lock-Free Ring Buffers
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * Bounded FIFO queues for handing fixed-size elements between threads
+ * without a lock. spsc_ring_t has exactly one producer and one consumer;
+ * mpsc_ring_t takes any number of producers and one consumer. Capacity
+ * is rounded up to a power of two, and the positions written by each
+ * side sit on their own cache line so producer and consumer do not
+ * invalidate each other's line on every element.
+ *
+ * Unlike circular_buffer_t, a full ring refuses the push (WTC_ERROR_FULL)
+ * instead of dropping the oldest element.
+ *
+ * A ring created with blocking = true lets the consumer sleep in
+ * *_pop_wait() on a futex until a producer pushes. Producers on such a
+ * ring pay one fence per push to check for a sleeping consumer; rings
+ * that are only polled should be created non-blocking.
+ */
+
+#ifndef WTC_RING_H
+#define WTC_RING_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RING_CACHE_LINE         64
+
+/* Consumer wake-up state (futex word and sleeping flag) */
+typedef struct {
+    uint32_t seq;
+    uint32_t sleeping;
+} ring_wait_t;
+
+/* Single-producer, single-consumer ring */
+typedef struct {
+    /* Read-only after init */
+    uint8_t *data;
+    size_t element_size;
+    size_t mask;
+    bool blocking;
+
+    /* Producer line */
+    _Alignas(RING_CACHE_LINE) size_t head;      /* Next position to write */
+    size_t tail_cache;                          /* Producer's last view of tail */
+
+    /* Consumer line */
+    _Alignas(RING_CACHE_LINE) size_t tail;      /* Next position to read */
+    size_t head_cache;                          /* Consumer's last view of head */
+
+    _Alignas(RING_CACHE_LINE) ring_wait_t wait;
+} spsc_ring_t;
+
+/* Multi-producer, single-consumer ring */
+typedef struct {
+    /* Read-only after init */
+    uint8_t *data;
+    size_t *seq;                                /* Per-slot publish sequence */
+    size_t element_size;
+    size_t mask;
+    bool blocking;
+
+    /* Producers' line */
+    _Alignas(RING_CACHE_LINE) size_t head;      /* Next position to claim */
+
+    /* Consumer line */
+    _Alignas(RING_CACHE_LINE) size_t tail;      /* Next position to read */
+
+    _Alignas(RING_CACHE_LINE) ring_wait_t wait;
+} mpsc_ring_t;
+
+/* Initialize SPSC ring (capacity is rounded up to a power of two) */
+wtc_result_t spsc_ring_init(spsc_ring_t *ring, size_t element_size,
+                            size_t capacity, bool blocking);
+
+/* Free SPSC ring */
+void spsc_ring_free(spsc_ring_t *ring);
+
+/* Push one element (producer only); WTC_ERROR_FULL if there is no room */
+wtc_result_t spsc_ring_push(spsc_ring_t *ring, const void *element);
+
+/* Pop one element (consumer only); WTC_ERROR_EMPTY if there is none */
+wtc_result_t spsc_ring_pop(spsc_ring_t *ring, void *element);
+
+/* Push up to count contiguous elements; returns the number pushed */
+size_t spsc_ring_push_batch(spsc_ring_t *ring, const void *elements, size_t count);
+
+/* Pop up to max_count elements; returns the number popped */
+size_t spsc_ring_pop_batch(spsc_ring_t *ring, void *elements, size_t max_count);
+
+/* Pop one element, sleeping up to timeout_ms (negative = forever) while
+ * the ring is empty. Only for rings created with blocking = true. */
+wtc_result_t spsc_ring_pop_wait(spsc_ring_t *ring, void *element, int timeout_ms);
+
+/* Get number of queued elements */
+size_t spsc_ring_count(const spsc_ring_t *ring);
+
+/* Get capacity */
+size_t spsc_ring_capacity(const spsc_ring_t *ring);
+
+/* Initialize MPSC ring (capacity is rounded up to a power of two) */
+wtc_result_t mpsc_ring_init(mpsc_ring_t *ring, size_t element_size,
+                            size_t capacity, bool blocking);
+
+/* Free MPSC ring */
+void mpsc_ring_free(mpsc_ring_t *ring);
+
+/* Push one element (any thread); WTC_ERROR_FULL if there is no room */
+wtc_result_t mpsc_ring_push(mpsc_ring_t *ring, const void *element);
+
+/* Pop one element (consumer only); WTC_ERROR_EMPTY if there is none */
+wtc_result_t mpsc_ring_pop(mpsc_ring_t *ring, void *element);
+
+/* Push up to count contiguous elements as one claim, so they stay
+ * together in the queue; returns the number pushed */
+size_t mpsc_ring_push_batch(mpsc_ring_t *ring, const void *elements, size_t count);
+
+/* Pop up to max_count elements; returns the number popped */
+size_t mpsc_ring_pop_batch(mpsc_ring_t *ring, void *elements, size_t max_count);
+
+/* Pop one element, sleeping up to timeout_ms (negative = forever) while
+ * the ring is empty. Only for rings created with blocking = true. */
+wtc_result_t mpsc_ring_pop_wait(mpsc_ring_t *ring, void *element, int timeout_ms);
+
+/* Get number of queued elements, including claims not yet published */
+size_t mpsc_ring_count(const mpsc_ring_t *ring);
+
+/* Get capacity */
+size_t mpsc_ring_capacity(const mpsc_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WTC_RING_H */
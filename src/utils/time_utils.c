@@ -91,9 +91,10 @@ void time_format_iso8601(uint64_t ms, char *buf, size_t buf_size) {
 
     time_t secs = ms / 1000;
     int millis = ms % 1000;
-    struct tm *tm_info = gmtime(&secs);
+    struct tm tm_info;
+    gmtime_r(&secs, &tm_info);
 
-    strftime(buf, buf_size, "%Y-%m-%dT%H:%M:%S", tm_info);
+    strftime(buf, buf_size, "%Y-%m-%dT%H:%M:%S", &tm_info);
     snprintf(buf + 19, buf_size - 19, ".%03dZ", millis);
 }
 
@@ -101,9 +102,10 @@ void time_format_date(uint64_t ms, char *buf, size_t buf_size) {
     if (!buf || buf_size < 11) return;  /* YYYY-MM-DD + null */
 
     time_t secs = ms / 1000;
-    struct tm *tm_info = gmtime(&secs);
+    struct tm tm_info;
+    gmtime_r(&secs, &tm_info);
 
-    strftime(buf, buf_size, "%Y-%m-%d", tm_info);
+    strftime(buf, buf_size, "%Y-%m-%d", &tm_info);
 }
 
 uint64_t time_parse_iso8601(const char *str) {
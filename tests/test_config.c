@@ -0,0 +1,348 @@
+/**
+ * Water Treatment Controller - Configuration Tests
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "../src/config/config_snapshot.h"
+#include "../src/types.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("  Running %s... ", #name); \
+    tests_run++; \
+    test_##name(); \
+    tests_passed++; \
+    printf("PASSED\n"); \
+} while(0)
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        printf("FAILED at line %d: expected %d, got %d\n", __LINE__, (int)(expected), (int)(actual)); \
+        return; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(cond) do { \
+    if (!(cond)) { \
+        printf("FAILED at line %d: condition false\n", __LINE__); \
+        return; \
+    } \
+} while(0)
+
+#define ASSERT_FLOAT_EQ(expected, actual, epsilon) do { \
+    if (fabs((expected) - (actual)) > (epsilon)) { \
+        printf("FAILED at line %d: expected %f, got %f\n", __LINE__, (expected), (actual)); \
+        return; \
+    } \
+} while(0)
+
+#define ASSERT_STR_EQ(expected, actual) do { \
+    if (strcmp((expected), (actual)) != 0) { \
+        printf("FAILED at line %d: expected '%s', got '%s'\n", __LINE__, (expected), (actual)); \
+        return; \
+    } \
+} while(0)
+
+/* ============== Configuration Snapshot ============== */
+
+/* A small configuration. Structs are filled with junk first, as stack
+ * or heap copies from the components would be, so padding and the bytes
+ * after each string's terminator differ between calls with other junk. */
+static struct {
+    slot_config_t slots[2];
+    rtu_device_t rtu;
+    alarm_rule_t rule;
+    pid_loop_t loop;
+    interlock_t interlock;
+    historian_tag_t tag;
+} sample;
+
+static config_snapshot_input_t make_sample(uint8_t junk) {
+    memset(&sample, junk, sizeof(sample));
+
+    for (int i = 0; i < 2; i++) {
+        slot_config_t *slot = &sample.slots[i];
+        slot->slot = i + 1;
+        slot->subslot = 1;
+        slot->type = i == 0 ? SLOT_TYPE_SENSOR : SLOT_TYPE_ACTUATOR;
+        snprintf(slot->name, sizeof(slot->name), "%s", i == 0 ? "pH" : "Dosing pump");
+        snprintf(slot->unit, sizeof(slot->unit), "%s", i == 0 ? "pH" : "%");
+        slot->measurement_type = MEASUREMENT_PH;
+        slot->actuator_type = ACTUATOR_PUMP;
+        slot->scale_min = 0.0f;
+        slot->scale_max = 14.0f;
+        slot->alarm_low = 6.0f;
+        slot->alarm_high = 8.5f;
+        slot->alarm_low_low = 5.0f;
+        slot->alarm_high_high = 9.5f;
+        slot->warning_low = 6.5f;
+        slot->warning_high = 8.0f;
+        slot->deadband = 0.05f;
+        slot->enabled = true;
+    }
+
+    snprintf(sample.rtu.station_name, sizeof(sample.rtu.station_name), "rtu-tank-1");
+    snprintf(sample.rtu.ip_address, sizeof(sample.rtu.ip_address), "192.168.1.10");
+    sample.rtu.slots = sample.slots;
+    sample.rtu.slot_count = 2;
+
+    snprintf(sample.rule.rtu_station, sizeof(sample.rule.rtu_station), "rtu-tank-1");
+    sample.rule.slot = 1;
+    sample.rule.condition = ALARM_CONDITION_HIGH;
+    sample.rule.threshold = 8.5f;
+    sample.rule.delay_ms = 5000;
+    sample.rule.severity = ALARM_SEVERITY_HIGH;
+    snprintf(sample.rule.message_template, sizeof(sample.rule.message_template), "pH high");
+
+    snprintf(sample.loop.name, sizeof(sample.loop.name), "pH_control");
+    sample.loop.enabled = true;
+    snprintf(sample.loop.input_rtu, sizeof(sample.loop.input_rtu), "rtu-tank-1");
+    sample.loop.input_slot = 1;
+    snprintf(sample.loop.output_rtu, sizeof(sample.loop.output_rtu), "rtu-tank-1");
+    sample.loop.output_slot = 2;
+    sample.loop.kp = 2.0f;
+    sample.loop.ki = 0.1f;
+    sample.loop.kd = 0.5f;
+    sample.loop.setpoint = 7.0f;
+    sample.loop.output_min = 0.0f;
+    sample.loop.output_max = 100.0f;
+    sample.loop.deadband = 0.0f;
+    sample.loop.integral_limit = 50.0f;
+    sample.loop.derivative_filter = 0.1f;
+    sample.loop.mode = PID_MODE_AUTO;
+
+    snprintf(sample.interlock.name, sizeof(sample.interlock.name), "Low level");
+    sample.interlock.enabled = true;
+    snprintf(sample.interlock.condition_rtu, sizeof(sample.interlock.condition_rtu), "rtu-tank-1");
+    sample.interlock.condition_slot = 1;
+    sample.interlock.condition = INTERLOCK_CONDITION_BELOW;
+    sample.interlock.threshold = 10.0f;
+    sample.interlock.delay_ms = 1000;
+    snprintf(sample.interlock.action_rtu, sizeof(sample.interlock.action_rtu), "rtu-tank-1");
+    sample.interlock.action_slot = 2;
+    sample.interlock.action = INTERLOCK_ACTION_FORCE_OFF;
+    sample.interlock.action_value = 0.0f;
+
+    snprintf(sample.tag.rtu_station, sizeof(sample.tag.rtu_station), "rtu-tank-1");
+    sample.tag.slot = 1;
+    snprintf(sample.tag.tag_name, sizeof(sample.tag.tag_name), "rtu-tank-1.pH");
+    sample.tag.sample_rate_ms = 1000;
+    sample.tag.deadband = 0.01f;
+    sample.tag.compression = COMPRESSION_SWINGING_DOOR;
+
+    config_snapshot_input_t input = {
+        .rtus = &sample.rtu,
+        .rtu_count = 1,
+        .alarm_rules = &sample.rule,
+        .alarm_rule_count = 1,
+        .pid_loops = &sample.loop,
+        .pid_loop_count = 1,
+        .interlocks = &sample.interlock,
+        .interlock_count = 1,
+        .historian_tags = &sample.tag,
+        .historian_tag_count = 1,
+    };
+    return input;
+}
+
+TEST(config_snapshot_round_trip) {
+    config_snapshot_input_t input = make_sample(0x00);
+    uint8_t *data = NULL;
+    size_t size = 0;
+    uint32_t checksum = 0;
+    ASSERT_EQ(WTC_OK, config_snapshot_encode(&input, &data, &size, &checksum));
+    ASSERT_TRUE(size % 8 == 0);
+
+    config_snapshot_view_t view;
+    ASSERT_EQ(WTC_OK, config_snapshot_decode(data, size, &view));
+    ASSERT_TRUE(view.checksum == checksum);
+
+    ASSERT_EQ(1, view.rtu_count);
+    ASSERT_STR_EQ("rtu-tank-1", view.rtus[0].station_name);
+    ASSERT_STR_EQ("192.168.1.10", view.rtus[0].ip_address);
+    ASSERT_EQ(2, view.slot_count);
+    ASSERT_EQ(0, (int)view.rtus[0].first_slot);
+    ASSERT_EQ(2, (int)view.rtus[0].slot_count);
+    ASSERT_EQ(2, view.slots[1].slot);
+    ASSERT_EQ(SLOT_TYPE_ACTUATOR, view.slots[1].type);
+    ASSERT_STR_EQ("Dosing pump", view.slots[1].name);
+    ASSERT_FLOAT_EQ(9.5, view.slots[0].alarm_high_high, 0.001);
+    ASSERT_TRUE(view.slots[0].enabled);
+
+    ASSERT_EQ(1, view.alarm_rule_count);
+    ASSERT_STR_EQ("pH high", view.alarm_rules[0].message_template);
+    ASSERT_EQ(5000, (int)view.alarm_rules[0].delay_ms);
+
+    ASSERT_EQ(1, view.pid_loop_count);
+    ASSERT_STR_EQ("pH_control", view.pid_loops[0].name);
+    ASSERT_EQ(2, view.pid_loops[0].output_slot);
+    ASSERT_FLOAT_EQ(0.1, view.pid_loops[0].ki, 0.0001);
+    ASSERT_EQ(PID_MODE_AUTO, view.pid_loops[0].mode);
+
+    ASSERT_EQ(1, view.interlock_count);
+    ASSERT_STR_EQ("Low level", view.interlocks[0].name);
+    ASSERT_EQ(INTERLOCK_ACTION_FORCE_OFF, view.interlocks[0].action);
+
+    ASSERT_EQ(1, view.historian_tag_count);
+    ASSERT_STR_EQ("rtu-tank-1.pH", view.historian_tags[0].tag_name);
+    ASSERT_EQ(COMPRESSION_SWINGING_DOOR, view.historian_tags[0].compression);
+
+    free(data);
+}
+
+TEST(config_snapshot_checksum_is_deterministic) {
+    uint8_t *a = NULL, *b = NULL;
+    size_t a_size = 0, b_size = 0;
+    uint32_t a_sum = 0, b_sum = 0;
+
+    config_snapshot_input_t input = make_sample(0x00);
+    ASSERT_EQ(WTC_OK, config_snapshot_encode(&input, &a, &a_size, &a_sum));
+    input = make_sample(0xA5);
+    ASSERT_EQ(WTC_OK, config_snapshot_encode(&input, &b, &b_size, &b_sum));
+
+    /* Only the write time in the unchecked header may differ */
+    ASSERT_TRUE(a_sum == b_sum);
+    ASSERT_TRUE(a_size == b_size);
+
+    /* A real change does move the checksum */
+    input = make_sample(0x00);
+    sample.loop.kp = 2.5f;
+    uint8_t *c = NULL;
+    size_t c_size = 0;
+    uint32_t c_sum = 0;
+    ASSERT_EQ(WTC_OK, config_snapshot_encode(&input, &c, &c_size, &c_sum));
+    ASSERT_TRUE(c_sum != a_sum);
+
+    free(a);
+    free(b);
+    free(c);
+}
+
+TEST(config_snapshot_checksum_ignores_order) {
+    config_snapshot_input_t input = make_sample(0x00);
+
+    rtu_device_t rtus[2] = { sample.rtu, sample.rtu };
+    snprintf(rtus[1].station_name, sizeof(rtus[1].station_name), "rtu-filter-2");
+    rtus[1].slot_count = 1;
+    pid_loop_t loops[2] = { sample.loop, sample.loop };
+    snprintf(loops[1].name, sizeof(loops[1].name), "Cl_control");
+    input.rtus = rtus;
+    input.rtu_count = 2;
+    input.pid_loops = loops;
+    input.pid_loop_count = 2;
+
+    uint8_t *a = NULL;
+    size_t a_size = 0;
+    uint32_t a_sum = 0;
+    ASSERT_EQ(WTC_OK, config_snapshot_encode(&input, &a, &a_size, &a_sum));
+
+    /* The same records, listed the other way round */
+    rtu_device_t rtus_swapped[2] = { rtus[1], rtus[0] };
+    pid_loop_t loops_swapped[2] = { loops[1], loops[0] };
+    input.rtus = rtus_swapped;
+    input.pid_loops = loops_swapped;
+    uint8_t *b = NULL;
+    size_t b_size = 0;
+    uint32_t b_sum = 0;
+    ASSERT_EQ(WTC_OK, config_snapshot_encode(&input, &b, &b_size, &b_sum));
+    ASSERT_TRUE(a_sum == b_sum);
+
+    /* Sorted by name; each RTU keeps its own slots */
+    config_snapshot_view_t view;
+    ASSERT_EQ(WTC_OK, config_snapshot_decode(b, b_size, &view));
+    ASSERT_STR_EQ("Cl_control", view.pid_loops[0].name);
+    ASSERT_STR_EQ("rtu-filter-2", view.rtus[0].station_name);
+    ASSERT_EQ(0, (int)view.rtus[0].first_slot);
+    ASSERT_EQ(1, (int)view.rtus[0].slot_count);
+    ASSERT_EQ(1, (int)view.rtus[1].first_slot);
+    ASSERT_EQ(2, (int)view.rtus[1].slot_count);
+
+    free(a);
+    free(b);
+}
+
+TEST(config_snapshot_rejects_corruption) {
+    config_snapshot_input_t input = make_sample(0x00);
+    uint8_t *data = NULL;
+    size_t size = 0;
+    ASSERT_EQ(WTC_OK, config_snapshot_encode(&input, &data, &size, NULL));
+
+    config_snapshot_view_t view;
+    ASSERT_EQ(WTC_ERROR_PROTOCOL, config_snapshot_decode(data, size - 8, &view));
+
+    data[size - 8] ^= 0x01;
+    ASSERT_EQ(WTC_ERROR_PROTOCOL, config_snapshot_decode(data, size, &view));
+    data[size - 8] ^= 0x01;
+    ASSERT_EQ(WTC_OK, config_snapshot_decode(data, size, &view));
+
+    /* Wrong magic */
+    data[0] ^= 0xFF;
+    ASSERT_EQ(WTC_ERROR_PROTOCOL, config_snapshot_decode(data, size, &view));
+
+    free(data);
+}
+
+TEST(config_snapshot_save_and_open) {
+    char path[] = "/tmp/wtc_snapshot_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    config_snapshot_input_t input = make_sample(0x00);
+    uint8_t *data = NULL;
+    size_t size = 0;
+    uint32_t checksum = 0;
+    ASSERT_EQ(WTC_OK, config_snapshot_encode(&input, &data, &size, &checksum));
+    ASSERT_EQ(WTC_OK, config_snapshot_save(path, data, size));
+    free(data);
+
+    config_snapshot_t *snapshot = NULL;
+    ASSERT_EQ(WTC_OK, config_snapshot_open(&snapshot, path));
+    const config_snapshot_view_t *view = config_snapshot_view(snapshot);
+    ASSERT_TRUE(view->checksum == checksum);
+    ASSERT_EQ(1, view->pid_loop_count);
+    ASSERT_STR_EQ("pH_control", view->pid_loops[0].name);
+    config_snapshot_close(snapshot);
+
+    unlink(path);
+    ASSERT_EQ(WTC_ERROR_NOT_FOUND, config_snapshot_open(&snapshot, path));
+
+    /* An unwritable location fails without leaving anything behind */
+    ASSERT_EQ(WTC_ERROR_IO, config_snapshot_save("/nonexistent-dir/config.snap",
+                                                 (const uint8_t *)"x", 1));
+}
+
+/* ============== Test Runner ============== */
+
+static void run_config_tests(void)
+{
+    printf("\n=== Configuration Tests ===\n\n");
+
+    printf("Snapshot Tests:\n");
+    RUN_TEST(config_snapshot_round_trip);
+    RUN_TEST(config_snapshot_checksum_is_deterministic);
+    RUN_TEST(config_snapshot_checksum_ignores_order);
+    RUN_TEST(config_snapshot_rejects_corruption);
+    RUN_TEST(config_snapshot_save_and_open);
+
+    printf("\n=== Results: %d/%d tests passed ===\n\n", tests_passed, tests_run);
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    run_config_tests();
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/**
+ * Water Treatment Controller - Config Sync Tests
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/config_sync/config_sync.h"
+#include "../src/types.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("  Running %s... ", #name); \
+    tests_run++; \
+    test_##name(); \
+    tests_passed++; \
+    printf("PASSED\n"); \
+} while(0)
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        printf("FAILED at line %d: expected %d, got %d\n", __LINE__, (int)(expected), (int)(actual)); \
+        return; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(cond) do { \
+    if (!(cond)) { \
+        printf("FAILED at line %d: condition false\n", __LINE__); \
+        return; \
+    } \
+} while(0)
+
+/* ============== Fan-out Tests ============== */
+
+TEST(config_sync_defaults_and_clamps_workers)
+{
+    config_sync_manager_t *mgr = NULL;
+    ASSERT_EQ(WTC_ERROR_INVALID_PARAM, config_sync_manager_init(NULL, NULL));
+    ASSERT_EQ(WTC_OK, config_sync_manager_init(&mgr, NULL));
+
+    config_sync_stats_t stats;
+    ASSERT_EQ(WTC_OK, config_sync_get_stats(mgr, &stats));
+    ASSERT_EQ(0, (int)stats.total_syncs);
+    ASSERT_EQ(0, (int)stats.pending);
+
+    /* Idle without workers, and a second start is a no-op */
+    ASSERT_EQ(WTC_OK, config_sync_wait_idle(mgr, 10));
+    ASSERT_EQ(WTC_OK, config_sync_manager_start(mgr));
+    ASSERT_EQ(WTC_OK, config_sync_manager_start(mgr));
+    config_sync_manager_cleanup(mgr);
+
+    config_sync_config_t config = CONFIG_SYNC_DEFAULT_CONFIG;
+    config.max_in_flight = 1000;
+    ASSERT_EQ(WTC_OK, config_sync_manager_init(&mgr, &config));
+    ASSERT_EQ(WTC_OK, config_sync_manager_start(mgr));
+    config_sync_manager_cleanup(mgr);
+}
+
+TEST(config_sync_workers_drain_connect_storm)
+{
+    config_sync_manager_t *mgr = NULL;
+    config_sync_config_t config = CONFIG_SYNC_DEFAULT_CONFIG;
+    config.max_in_flight = 4;
+    ASSERT_EQ(WTC_OK, config_sync_manager_init(&mgr, &config));
+    ASSERT_EQ(WTC_OK, config_sync_manager_start(mgr));
+
+    /* No PROFINET controller: every sync ends at once as not connected,
+     * so this exercises the queue and the workers only */
+    char name[WTC_MAX_STATION_NAME];
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 32; i++) {
+            snprintf(name, sizeof(name), "rtu-%d", i);
+            config_sync_on_rtu_connect(mgr, name);
+        }
+    }
+    ASSERT_EQ(WTC_OK, config_sync_wait_idle(mgr, 5000));
+
+    config_sync_stats_t stats;
+    ASSERT_EQ(WTC_OK, config_sync_get_stats(mgr, &stats));
+    ASSERT_EQ(0, (int)stats.pending);
+    ASSERT_EQ(0, (int)stats.failed_syncs);
+
+    ASSERT_EQ(WTC_OK, config_sync_manager_stop(mgr));
+    config_sync_manager_cleanup(mgr);
+}
+
+/* ============== Test Runner ============== */
+
+static void run_config_sync_tests(void)
+{
+    printf("\n=== Config Sync Tests ===\n\n");
+
+    printf("Fan-out Tests:\n");
+    RUN_TEST(config_sync_defaults_and_clamps_workers);
+    RUN_TEST(config_sync_workers_drain_connect_storm);
+
+    printf("\n=== Results: %d/%d tests passed ===\n\n", tests_passed, tests_run);
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    run_config_sync_tests();
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -10,6 +10,10 @@
 #include <math.h>
 #include <assert.h>
 #include "../src/control/control_engine.h"
+#include "../src/core/latency_trace.h"
+#include "../src/registry/rtu_registry.h"
+#include "../src/simulation/plant_model.h"
+#include "../src/utils/time_utils.h"
 #include "../src/types.h"
 
 /* Test counters */
@@ -231,6 +235,249 @@ TEST(control_engine_add_pid)
     control_engine_cleanup(engine);
 }
 
+TEST(control_engine_update_pid_keeps_state)
+{
+    control_engine_t *engine = NULL;
+    control_engine_config_t config = {0};
+    config.scan_rate_ms = 100;
+    ASSERT_EQ(WTC_OK, control_engine_init(&engine, &config));
+
+    pid_loop_t loop = {0};
+    snprintf(loop.name, sizeof(loop.name), "pH_control");
+    loop.enabled = true;
+    loop.kp = 2.0f;
+    loop.ki = 0.1f;
+    loop.setpoint = 7.0f;
+    loop.output_max = 100.0f;
+    loop.mode = PID_MODE_AUTO;
+
+    int loop_id;
+    ASSERT_EQ(WTC_OK, control_engine_add_pid_loop(engine, &loop, &loop_id));
+
+    /* Wound-up integrator, as after running for a while */
+    pid_loop_t state;
+    ASSERT_EQ(WTC_OK, control_engine_get_pid_loop(engine, loop_id, &state));
+    state.integral = 12.5f;
+    state.cv = 40.0f;
+    ASSERT_EQ(WTC_OK, control_engine_restore_pid_state(engine, &state));
+
+    /* Retuning from a reloaded configuration keeps the runtime state */
+    loop.kp = 3.0f;
+    loop.setpoint = 7.2f;
+    loop.integral = 0.0f;
+    ASSERT_EQ(WTC_OK, control_engine_update_pid_loop(engine, loop_id, &loop));
+
+    pid_loop_t updated;
+    ASSERT_EQ(WTC_OK, control_engine_get_pid_loop(engine, loop_id, &updated));
+    ASSERT_EQ(loop_id, updated.loop_id);
+    ASSERT_FLOAT_EQ(3.0, updated.kp, 0.0001);
+    ASSERT_FLOAT_EQ(7.2, updated.setpoint, 0.0001);
+    ASSERT_FLOAT_EQ(12.5, updated.integral, 0.0001);
+    ASSERT_FLOAT_EQ(40.0, updated.cv, 0.0001);
+
+    ASSERT_EQ(WTC_ERROR_NOT_FOUND, control_engine_update_pid_loop(engine, loop_id + 1, &loop));
+
+    control_engine_cleanup(engine);
+}
+
+/* ============== Process Model Tests ============== */
+
+TEST(plant_model_demo_steady)
+{
+    plant_model_t *plant = NULL;
+    ASSERT_EQ(WTC_OK, plant_model_create(&plant, 0.0f));
+    ASSERT_EQ(WTC_OK, plant_model_build_demo(plant));
+
+    int level;
+    plant_unit_kind_t kind;
+    ASSERT_EQ(WTC_OK, plant_model_find(plant, "LEVEL_01", &level, &kind));
+    ASSERT_EQ(PLANT_UNIT_SENSOR, kind);
+
+    /* Inflow and pump are balanced, so ten simulated minutes change nothing */
+    uint32_t steps = plant_model_advance(plant, 600.0);
+    ASSERT_EQ(6000, steps);
+    float value = 0.0f;
+    ASSERT_EQ(WTC_OK, plant_model_read_sensor(plant, level, &value));
+    ASSERT_FLOAT_EQ(75.0f, value, 0.5f);
+    ASSERT_FLOAT_EQ(600.0, plant_model_time(plant), 1e-3);
+
+    plant_model_destroy(plant);
+}
+
+TEST(plant_model_dead_time)
+{
+    plant_model_t *plant = NULL;
+    ASSERT_EQ(WTC_OK, plant_model_create(&plant, 0.1f));
+
+    int tank, valve, sensor;
+    plant_tank_config_t tank_cfg = {
+        .name = "T", .area_m2 = 1, .height_m = 10, .initial_level_m = 1
+    };
+    ASSERT_EQ(WTC_OK, plant_model_add_tank(plant, &tank_cfg, &tank));
+    plant_flow_config_t valve_cfg = {
+        .name = "V", .type = PLANT_FLOW_VALVE, .from = PLANT_BOUNDARY, .to = tank,
+        .max_flow_m3s = 0.1f
+    };
+    ASSERT_EQ(WTC_OK, plant_model_add_flow(plant, &valve_cfg, &valve));
+    plant_sensor_config_t sensor_cfg = {
+        .name = "L", .unit = tank, .variable = PLANT_VAR_LEVEL, .gain = 1, .dead_time_s = 10
+    };
+    ASSERT_EQ(WTC_OK, plant_model_add_sensor(plant, &sensor_cfg, &sensor));
+
+    /* Step the valve open: the tank rises at once, the sensor 10 s later */
+    ASSERT_EQ(WTC_OK, plant_model_set_input(plant, valve, 1.0f));
+    plant_model_advance(plant, 5.0);
+
+    float level = 0.0f, measured = 0.0f;
+    plant_model_get_value(plant, tank, PLANT_VAR_LEVEL, &level);
+    plant_model_read_sensor(plant, sensor, &measured);
+    ASSERT_FLOAT_EQ(1.5f, level, 0.02f);
+    ASSERT_FLOAT_EQ(1.0f, measured, 1e-4f);
+
+    plant_model_advance(plant, 10.0);
+    plant_model_read_sensor(plant, sensor, &measured);
+    ASSERT_FLOAT_EQ(1.5f, measured, 0.02f);
+
+    /* Sensors cannot be inputs */
+    ASSERT_EQ(WTC_ERROR_INVALID_PARAM, plant_model_set_input(plant, sensor, 1.0f));
+
+    plant_model_destroy(plant);
+}
+
+TEST(plant_model_level_loop)
+{
+    plant_model_t *plant = NULL;
+    ASSERT_EQ(WTC_OK, plant_model_create(&plant, 0.0f));
+    ASSERT_EQ(WTC_OK, plant_model_build_demo(plant));
+
+    int valve, pump, level;
+    ASSERT_EQ(WTC_OK, plant_model_find(plant, "VALVE_01", &valve, NULL));
+    ASSERT_EQ(WTC_OK, plant_model_find(plant, "PUMP_01", &pump, NULL));
+    ASSERT_EQ(WTC_OK, plant_model_find(plant, "LEVEL_01", &level, NULL));
+
+    /* Half inflow, proportional pump control towards 50 %, one
+     * simulated hour at a 1 s scan */
+    plant_model_set_input(plant, valve, 0.5f);
+    float value = 0.0f;
+    for (int scan = 0; scan < 3600; scan++) {
+        plant_model_read_sensor(plant, level, &value);
+        plant_model_set_input(plant, pump, 0.5f + 0.1f * (value - 50.0f));
+        plant_model_advance(plant, 1.0);
+    }
+    ASSERT_FLOAT_EQ(50.0f, value, 1.0f);
+
+    plant_model_destroy(plant);
+}
+
+/* ============== Latency Trace Tests ============== */
+
+TEST(latency_trace_buckets)
+{
+    const uint64_t samples[] = { 0, 1, 3, 4, 7, 8, 9, 100, 1000, 123456, 1000000000ull };
+
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        uint64_t v = samples[i];
+        int bucket = latency_trace_bucket(v);
+        ASSERT_EQ(1, bucket >= 0 && bucket < LATENCY_HIST_BUCKETS);
+        ASSERT_EQ(1, latency_trace_bucket_upper(bucket) >= v);
+        ASSERT_EQ(1, bucket == 0 || latency_trace_bucket_upper(bucket - 1) < v);
+        /* Four buckets per octave: at most 25 % above the sample */
+        ASSERT_EQ(1, latency_trace_bucket_upper(bucket) - v <= v / 4 + 1);
+    }
+}
+
+TEST(latency_trace_percentiles)
+{
+    latency_trace_t *trace = NULL;
+    ASSERT_EQ(WTC_OK, latency_trace_init(&trace));
+
+    uint32_t id = LATENCY_TRACE_ID(LATENCY_PATH_PID, 3);
+    for (uint64_t us = 1; us <= 1000; us++) {
+        ASSERT_EQ(WTC_OK, latency_trace_record(trace, id, LATENCY_STAGE_TOTAL, us));
+    }
+
+    latency_summary_t summary;
+    ASSERT_EQ(WTC_OK, latency_trace_get_summary(trace, id, LATENCY_STAGE_TOTAL, &summary));
+    ASSERT_EQ(1000, (int)summary.count);
+    ASSERT_EQ(1, (int)summary.min_us);
+    ASSERT_EQ(1000, (int)summary.max_us);
+    ASSERT_EQ(500, (int)summary.mean_us);
+    ASSERT_EQ(1, summary.p50_us >= 500 && summary.p50_us <= 625);
+    ASSERT_EQ(1, summary.p99_us >= 990 && summary.p99_us <= 1000);
+
+    /* Other stages of the path are empty, other paths unknown */
+    ASSERT_EQ(WTC_OK, latency_trace_get_summary(trace, id, LATENCY_STAGE_INPUT, &summary));
+    ASSERT_EQ(0, (int)summary.count);
+    ASSERT_EQ(WTC_ERROR_NOT_FOUND,
+              latency_trace_get_summary(trace, LATENCY_TRACE_ID(LATENCY_PATH_PID, 4),
+                                        LATENCY_STAGE_TOTAL, &summary));
+
+    uint32_t ids[4];
+    ASSERT_EQ(1, latency_trace_list_paths(trace, ids, 4));
+    ASSERT_EQ((int)id, (int)ids[0]);
+
+    latency_trace_cleanup(trace);
+}
+
+TEST(control_engine_latency_trace)
+{
+    rtu_registry_t *registry = NULL;
+    registry_config_t reg_config = {0};
+    reg_config.max_devices = 4;
+    ASSERT_EQ(WTC_OK, rtu_registry_init(&registry, &reg_config));
+    rtu_registry_add_device(registry, "rtu-tank-1", "192.168.1.100", NULL, 0);
+
+    latency_trace_t *trace = NULL;
+    ASSERT_EQ(WTC_OK, latency_trace_init(&trace));
+
+    control_engine_t *engine = NULL;
+    control_engine_config_t config = {0};
+    config.scan_rate_ms = 100;
+    ASSERT_EQ(WTC_OK, control_engine_init(&engine, &config));
+    control_engine_set_registry(engine, registry);
+    control_engine_set_latency_trace(engine, trace);
+
+    pid_loop_t loop = {0};
+    strncpy(loop.name, "level", sizeof(loop.name));
+    loop.enabled = true;
+    loop.mode = PID_MODE_AUTO;
+    loop.kp = 1.0f;
+    loop.setpoint = 50.0f;
+    loop.output_max = 100.0f;
+    strncpy(loop.input_rtu, "rtu-tank-1", sizeof(loop.input_rtu));
+    loop.input_slot = 1;
+    strncpy(loop.output_rtu, "rtu-tank-1", sizeof(loop.output_rtu));
+    loop.output_slot = 2;
+    int loop_id;
+    ASSERT_EQ(WTC_OK, control_engine_add_pid_loop(engine, &loop, &loop_id));
+    uint32_t id = LATENCY_TRACE_ID(LATENCY_PATH_PID, loop_id);
+
+    /* Input received 2 ms before the scan */
+    uint64_t rx_us = time_get_monotonic_us() - 2000;
+    rtu_registry_update_sensor_at(registry, "rtu-tank-1", 1, 40.0f,
+                                  IOPS_GOOD, QUALITY_GOOD, rx_us);
+    control_engine_process(engine);
+
+    actuator_state_t state = {0};
+    ASSERT_EQ(WTC_OK, rtu_registry_get_actuator(registry, "rtu-tank-1", 2, &state));
+    ASSERT_EQ(1, state.source_time_us == rx_us);
+    ASSERT_EQ((int)id, (int)state.trace_id);
+
+    latency_summary_t input;
+    ASSERT_EQ(WTC_OK, latency_trace_get_summary(trace, id, LATENCY_STAGE_INPUT, &input));
+    ASSERT_EQ(1, (int)input.count);
+    ASSERT_EQ(1, input.min_us >= 2000);
+
+    /* The same input is traced through the first output only */
+    control_engine_process(engine);
+    ASSERT_EQ(WTC_OK, latency_trace_get_summary(trace, id, LATENCY_STAGE_INPUT, &input));
+    ASSERT_EQ(1, (int)input.count);
+
+    control_engine_cleanup(engine);
+    latency_trace_cleanup(trace);
+    rtu_registry_cleanup(registry);
+}
+
 /* ============== Test Runner ============== */
 
 void run_control_tests(void)
@@ -252,6 +499,17 @@ void run_control_tests(void)
     RUN_TEST(control_engine_init_null);
     RUN_TEST(control_engine_create_and_cleanup);
     RUN_TEST(control_engine_add_pid);
+    RUN_TEST(control_engine_update_pid_keeps_state);
+
+    printf("\nProcess Model Tests:\n");
+    RUN_TEST(plant_model_demo_steady);
+    RUN_TEST(plant_model_dead_time);
+    RUN_TEST(plant_model_level_loop);
+
+    printf("\nLatency Trace Tests:\n");
+    RUN_TEST(latency_trace_buckets);
+    RUN_TEST(latency_trace_percentiles);
+    RUN_TEST(control_engine_latency_trace);
 
     printf("\n=== Results: %d/%d tests passed ===\n\n", tests_passed, tests_run);
 }
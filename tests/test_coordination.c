@@ -0,0 +1,760 @@
+/**
+ * Water Treatment Controller - Coordination Tests
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../src/coordination/failover.h"
+#include "../src/coordination/replication.h"
+#include "../src/coordination/authority_manager.h"
+#include "../src/coordination/load_balance.h"
+#include "../src/registry/rtu_registry.h"
+#include "../src/utils/logger.h"
+#include "../src/utils/time_utils.h"
+#include "../src/types.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("  Running %s... ", #name); \
+    tests_run++; \
+    test_##name(); \
+    tests_passed++; \
+    printf("PASSED\n"); \
+} while(0)
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        printf("FAILED at line %d: expected %d, got %d\n", __LINE__, (int)(expected), (int)(actual)); \
+        return; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(cond) do { \
+    if (!(cond)) { \
+        printf("FAILED at line %d: condition false\n", __LINE__); \
+        return; \
+    } \
+} while(0)
+
+#define ASSERT_FLOAT_EQ(expected, actual, epsilon) do { \
+    if (fabs((expected) - (actual)) > (epsilon)) { \
+        printf("FAILED at line %d: expected %f, got %f\n", __LINE__, (expected), (actual)); \
+        return; \
+    } \
+} while(0)
+
+/* ============== Replication ============== */
+
+#define TEST_KEY "loopback-secret"
+
+/* What the standby applied, written from its replication thread */
+static struct {
+    pthread_mutex_t lock;
+    int sets;
+    int removes;
+    float value;
+    char key[REPLICATION_MAX_KEY];
+    volatile int promotions;
+    volatile int demotions;
+} applied = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static void on_apply(replication_kind_t kind, const char *key, const void *data,
+                     size_t len, bool removed, void *ctx) {
+    (void)ctx;
+    if (kind != REPLICATION_KIND_SENSOR) return;
+
+    pthread_mutex_lock(&applied.lock);
+    snprintf(applied.key, sizeof(applied.key), "%s", key);
+    if (removed) {
+        applied.removes++;
+    } else if (len == sizeof(replication_sensor_t)) {
+        applied.sets++;
+        applied.value = ((const replication_sensor_t *)data)->value;
+    }
+    pthread_mutex_unlock(&applied.lock);
+}
+
+static void on_promote(void *ctx) {
+    (void)ctx;
+    applied.promotions++;
+}
+
+static void on_demote(void *ctx) {
+    (void)ctx;
+    applied.demotions++;
+}
+
+static void reset_applied(void) {
+    pthread_mutex_lock(&applied.lock);
+    applied.sets = applied.removes = 0;
+    applied.value = 0.0f;
+    applied.key[0] = '\0';
+    applied.promotions = applied.demotions = 0;
+    pthread_mutex_unlock(&applied.lock);
+}
+
+static int applied_sets(void) {
+    pthread_mutex_lock(&applied.lock);
+    int sets = applied.sets;
+    pthread_mutex_unlock(&applied.lock);
+    return sets;
+}
+
+static int applied_removes(void) {
+    pthread_mutex_lock(&applied.lock);
+    int removes = applied.removes;
+    pthread_mutex_unlock(&applied.lock);
+    return removes;
+}
+
+/* A port per test, so a lingering socket cannot collide */
+static uint16_t next_port(void) {
+    static int offset = 0;
+    return (uint16_t)(20000 + (getpid() % 20000) + offset++);
+}
+
+static replication_config_t primary_config(uint16_t port) {
+    replication_config_t config = {
+        .role = REPLICATION_PRIMARY,
+        .listen_port = port,
+    };
+    snprintf(config.auth_key, sizeof(config.auth_key), "%s", TEST_KEY);
+    return config;
+}
+
+static replication_config_t standby_config(uint16_t port, const char *key) {
+    replication_config_t config = {
+        .role = REPLICATION_STANDBY,
+        .peer_port = port,
+    };
+    snprintf(config.peer_host, sizeof(config.peer_host), "127.0.0.1");
+    snprintf(config.auth_key, sizeof(config.auth_key), "%s", key);
+    return config;
+}
+
+static replication_sensor_t make_sensor(float value) {
+    replication_sensor_t sensor = { .slot = 1, .value = value, .quality = QUALITY_GOOD };
+    snprintf(sensor.station, sizeof(sensor.station), "rtu-1");
+    return sensor;
+}
+
+/* Poll a condition for up to timeout_ms */
+#define WAIT_FOR(cond, timeout_ms) do { \
+    uint64_t wait_until_ = time_get_monotonic_ms() + (timeout_ms); \
+    while (!(cond) && time_get_monotonic_ms() < wait_until_) time_sleep_ms(5); \
+} while(0)
+
+TEST(replication_requires_key) {
+    replication_t *repl = NULL;
+    replication_config_t config = primary_config(next_port());
+
+    config.auth_key[0] = '\0';
+    ASSERT_EQ(WTC_ERROR_INVALID_PARAM, replication_init(&repl, &config));
+
+    config = primary_config(next_port());
+    snprintf(config.bind_addr, sizeof(config.bind_addr), "not-an-address");
+    ASSERT_EQ(WTC_ERROR_INVALID_PARAM, replication_init(&repl, &config));
+}
+
+TEST(replication_loopback_pair) {
+    uint16_t port = next_port();
+    replication_t *primary = NULL;
+    replication_t *standby = NULL;
+    reset_applied();
+
+    replication_config_t config = primary_config(port);
+    ASSERT_EQ(WTC_OK, replication_init(&primary, &config));
+    config = standby_config(port, TEST_KEY);
+    ASSERT_EQ(WTC_OK, replication_init(&standby, &config));
+    replication_set_apply_callback(standby, on_apply, NULL);
+    replication_set_promote_callback(standby, on_promote, NULL);
+
+    replication_sensor_t sensor = make_sensor(7.25f);
+    ASSERT_EQ(WTC_OK, replication_publish(primary, REPLICATION_KIND_SENSOR, "rtu-1/1",
+                                          &sensor, sizeof(sensor)));
+    ASSERT_EQ(WTC_OK, replication_start(primary));
+    ASSERT_EQ(WTC_OK, replication_start(standby));
+
+    /* Snapshot on connect */
+    WAIT_FOR(applied_sets() >= 1, 2000);
+    ASSERT_TRUE(applied_sets() >= 1);
+    ASSERT_FLOAT_EQ(7.25, applied.value, 0.001);
+
+    /* A change goes as a patch of the previous value */
+    int sets = applied_sets();
+    sensor.value = 8.5f;
+    ASSERT_EQ(WTC_OK, replication_publish(primary, REPLICATION_KIND_SENSOR, "rtu-1/1",
+                                          &sensor, sizeof(sensor)));
+    WAIT_FOR(applied_sets() > sets, 2000);
+    ASSERT_FLOAT_EQ(8.5, applied.value, 0.001);
+
+    ASSERT_EQ(WTC_OK, replication_remove(primary, REPLICATION_KIND_SENSOR, "rtu-1/1"));
+    WAIT_FOR(applied_removes() >= 1, 2000);
+    ASSERT_EQ(1, applied_removes());
+
+    replication_stats_t stats;
+    replication_get_stats(primary, &stats);
+    ASSERT_TRUE(stats.connected);
+    ASSERT_TRUE(stats.delta_records >= 1);
+    WAIT_FOR((replication_get_stats(primary, &stats), stats.acked_seq >= stats.seq), 2000);
+    ASSERT_TRUE(stats.acked_seq >= stats.seq);
+
+    /* Stopping the primary hands over at once, well before takeover_ms */
+    uint64_t stopped_ms = time_get_monotonic_ms();
+    replication_stop(primary);
+    WAIT_FOR(applied.promotions > 0, 2000);
+    ASSERT_EQ(1, applied.promotions);
+    ASSERT_TRUE(time_get_monotonic_ms() - stopped_ms < 200);
+    ASSERT_EQ(REPLICATION_PRIMARY, replication_get_role(standby));
+
+    replication_cleanup(standby);
+    replication_cleanup(primary);
+}
+
+TEST(replication_rejects_wrong_key) {
+    uint16_t port = next_port();
+    replication_t *primary = NULL;
+    replication_t *standby = NULL;
+    reset_applied();
+
+    replication_config_t config = primary_config(port);
+    ASSERT_EQ(WTC_OK, replication_init(&primary, &config));
+    config = standby_config(port, "some-other-secret");
+    ASSERT_EQ(WTC_OK, replication_init(&standby, &config));
+    replication_set_apply_callback(standby, on_apply, NULL);
+    replication_set_promote_callback(standby, on_promote, NULL);
+
+    replication_sensor_t sensor = make_sensor(1.0f);
+    replication_publish(primary, REPLICATION_KIND_SENSOR, "rtu-1/1", &sensor, sizeof(sensor));
+    ASSERT_EQ(WTC_OK, replication_start(primary));
+    ASSERT_EQ(WTC_OK, replication_start(standby));
+
+    replication_stats_t stats;
+    WAIT_FOR((replication_get_stats(primary, &stats), stats.auth_failures > 0), 2000);
+    ASSERT_TRUE(stats.auth_failures > 0);
+    ASSERT_TRUE(!stats.connected);
+
+    /* Never having followed a primary, the standby does not take over */
+    time_sleep_ms(500);
+    ASSERT_EQ(0, applied_sets());
+    ASSERT_EQ(0, applied.promotions);
+    ASSERT_EQ(REPLICATION_STANDBY, replication_get_role(standby));
+
+    replication_cleanup(standby);
+    replication_cleanup(primary);
+}
+
+TEST(replication_primary_fences_on_lost_standby) {
+    uint16_t port = next_port();
+    reset_applied();
+
+    /* The standby runs in its own process so it can die without a word */
+    pid_t child = fork();
+    ASSERT_TRUE(child >= 0);
+    if (child == 0) {
+        replication_t *standby = NULL;
+        replication_config_t config = standby_config(port, TEST_KEY);
+        if (replication_init(&standby, &config) != WTC_OK ||
+            replication_start(standby) != WTC_OK) {
+            _exit(1);
+        }
+        time_sleep_ms(10000);
+        _exit(0);
+    }
+
+    replication_t *primary = NULL;
+    replication_config_t config = primary_config(port);
+    ASSERT_EQ(WTC_OK, replication_init(&primary, &config));
+    replication_set_demote_callback(primary, on_demote, NULL);
+    ASSERT_EQ(WTC_OK, replication_start(primary));
+
+    replication_stats_t stats;
+    WAIT_FOR((replication_get_stats(primary, &stats), stats.acked_seq > 0), 3000);
+    ASSERT_TRUE(stats.acked_seq > 0);
+
+    /* The primary must fence before the dead standby would have promoted */
+    uint64_t killed_ms = time_get_monotonic_ms();
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    WAIT_FOR(applied.demotions > 0, 2000);
+    uint64_t fenced_after_ms = time_get_monotonic_ms() - killed_ms;
+    ASSERT_EQ(1, applied.demotions);
+    ASSERT_TRUE(fenced_after_ms < 300);
+    ASSERT_EQ(REPLICATION_STANDBY, replication_get_role(primary));
+
+    /* A fenced primary refuses new state */
+    replication_sensor_t sensor = make_sensor(1.0f);
+    ASSERT_EQ(WTC_ERROR_BUSY, replication_publish(primary, REPLICATION_KIND_SENSOR, "rtu-1/1",
+                                                  &sensor, sizeof(sensor)));
+
+    replication_cleanup(primary);
+}
+
+/* ============== Failover ============== */
+
+#define FAILOVER_TIMEOUT_MS 100
+
+static int failovers;
+
+static void count_failover(const char *primary, const char *backup,
+                           bool failed_over, void *ctx) {
+    (void)primary;
+    (void)backup;
+    (void)ctx;
+    if (failed_over) failovers++;
+}
+
+static failover_manager_t *create_failover(void) {
+    failover_manager_t *mgr = NULL;
+    failover_config_t config = {
+        .mode = FAILOVER_MODE_AUTO,
+        .timeout_ms = FAILOVER_TIMEOUT_MS,
+    };
+    if (failover_init(&mgr, &config) != WTC_OK) return NULL;
+    failovers = 0;
+    failover_set_callback(mgr, count_failover, NULL);
+    failover_start(mgr);
+    return mgr;
+}
+
+static bool rtu_healthy(failover_manager_t *mgr, const char *station_name) {
+    rtu_health_t health;
+    failover_process(mgr);
+    return failover_get_health(mgr, station_name, &health) == WTC_OK && health.healthy;
+}
+
+TEST(failover_watchdog_needs_consecutive_misses) {
+    failover_manager_t *mgr = create_failover();
+    ASSERT_TRUE(mgr != NULL);
+    failover_notify_state(mgr, "rtu-a", PROFINET_STATE_RUNNING);
+    ASSERT_TRUE(rtu_healthy(mgr, "rtu-a"));
+
+    /* One late frame is not a failure */
+    failover_notify_watchdog(mgr, "rtu-a", 1);
+    ASSERT_TRUE(rtu_healthy(mgr, "rtu-a"));
+    failover_notify_watchdog(mgr, "rtu-a", 0);
+    failover_notify_watchdog(mgr, "rtu-a", 1);
+    ASSERT_TRUE(rtu_healthy(mgr, "rtu-a"));
+
+    /* A second consecutive miss is */
+    failover_notify_watchdog(mgr, "rtu-a", 2);
+    ASSERT_TRUE(!rtu_healthy(mgr, "rtu-a"));
+    failover_notify_watchdog(mgr, "rtu-a", 0);
+    ASSERT_TRUE(rtu_healthy(mgr, "rtu-a"));
+
+    failover_stop(mgr);
+    failover_cleanup(mgr);
+}
+
+TEST(failover_times_out_from_schedule) {
+    failover_manager_t *mgr = create_failover();
+    ASSERT_TRUE(mgr != NULL);
+    failover_notify_state(mgr, "rtu-a", PROFINET_STATE_RUNNING);
+    failover_notify_state(mgr, "rtu-b", PROFINET_STATE_RUNNING);
+    failover_set_backup(mgr, "rtu-a", "rtu-b");
+    ASSERT_TRUE(rtu_healthy(mgr, "rtu-a"));
+    ASSERT_TRUE(rtu_healthy(mgr, "rtu-b"));
+
+    /* Leaving RUNNING starts the grace period, not a failure */
+    failover_notify_state(mgr, "rtu-a", PROFINET_STATE_DISCONNECT);
+    ASSERT_TRUE(rtu_healthy(mgr, "rtu-a"));
+    ASSERT_EQ(0, failovers);
+
+    /* Its scheduled check fails the RTU over once the period has passed */
+    time_sleep_ms(FAILOVER_TIMEOUT_MS + 20);
+    ASSERT_TRUE(!rtu_healthy(mgr, "rtu-a"));
+    ASSERT_TRUE(rtu_healthy(mgr, "rtu-b"));
+    ASSERT_EQ(1, failovers);
+
+    rtu_health_t health;
+    ASSERT_EQ(WTC_OK, failover_get_health(mgr, "rtu-a", &health));
+    ASSERT_TRUE(health.in_failover);
+    ASSERT_TRUE(strcmp(health.backup_station, "rtu-b") == 0);
+
+    /* Back within the period: no failover */
+    failover_notify_state(mgr, "rtu-b", PROFINET_STATE_DISCONNECT);
+    failover_notify_state(mgr, "rtu-b", PROFINET_STATE_RUNNING);
+    time_sleep_ms(FAILOVER_TIMEOUT_MS + 20);
+    ASSERT_TRUE(rtu_healthy(mgr, "rtu-b"));
+
+    failover_stop(mgr);
+    failover_cleanup(mgr);
+}
+
+/* ============== Authority ============== */
+
+#define AUTHORITY_CYCLES   1000
+#define AUTHORITY_READERS  3
+#define AUTHORITY_STATIONS 200
+
+/* Shared between the handoff driver and the command checkers */
+typedef struct {
+    authority_manager_t *mgr;
+    int handle;
+    volatile int running;
+    uint32_t granted;           /* Last granted epoch, stored after the grant */
+    int accepted;
+    int stale_accepted;
+} gate_load_t;
+
+static void *gate_reader(void *arg) {
+    gate_load_t *load = arg;
+    while (load->running) {
+        uint32_t granted = __atomic_load_n(&load->granted, __ATOMIC_ACQUIRE);
+        if (granted == 0) {
+            sched_yield();
+            continue;
+        }
+
+        if (authority_validate_handle(load->mgr, load->handle, granted) == WTC_OK) {
+            __atomic_fetch_add(&load->accepted, 1, __ATOMIC_RELAXED);
+        }
+        /* Once a grant is visible, no command from an earlier epoch may pass */
+        if (granted > 2 &&
+            (authority_validate_handle(load->mgr, load->handle, granted - 2) == WTC_OK ||
+             authority_validate_command(load->mgr, "rtu-a", granted - 2, NULL) == WTC_OK)) {
+            __atomic_fetch_add(&load->stale_accepted, 1, __ATOMIC_RELAXED);
+        }
+        sched_yield();
+    }
+    return NULL;
+}
+
+TEST(authority_gate_rejects_stale_epochs_under_handoffs) {
+    gate_load_t load = {0};
+    ASSERT_EQ(WTC_OK, authority_manager_init(&load.mgr, NULL));
+    load.handle = authority_get_handle(load.mgr, "rtu-a");
+    ASSERT_EQ(0, load.handle);
+
+    /* Every rejected command logs a warning */
+    log_level_t level = logger_get_level();
+    logger_set_level(LOG_LEVEL_ERROR);
+
+    load.running = 1;
+    pthread_t readers[AUTHORITY_READERS];
+    for (int i = 0; i < AUTHORITY_READERS; i++) {
+        pthread_create(&readers[i], NULL, gate_reader, &load);
+    }
+
+    /* Grants carry odd epochs, releases the following even one */
+    int failures = 0;
+    for (uint32_t k = 0; k < AUTHORITY_CYCLES; k++) {
+        uint32_t epoch = 2 * k + 1;
+        if (authority_request(load.mgr, "rtu-a", NULL) != WTC_OK ||
+            authority_handle_grant(load.mgr, "rtu-a", epoch, NULL) != WTC_OK) {
+            failures++;
+            break;
+        }
+        __atomic_store_n(&load.granted, epoch, __ATOMIC_RELEASE);
+
+        /* Hold authority until a reader has used it, or briefly */
+        int seen = __atomic_load_n(&load.accepted, __ATOMIC_RELAXED);
+        uint64_t deadline = time_get_ms() + 100;
+        while (__atomic_load_n(&load.accepted, __ATOMIC_RELAXED) == seen &&
+               time_get_ms() < deadline) {
+            sched_yield();
+        }
+
+        if (authority_release(load.mgr, "rtu-a", NULL) != WTC_OK ||
+            authority_handle_released(load.mgr, "rtu-a", epoch + 1, NULL) != WTC_OK) {
+            failures++;
+            break;
+        }
+    }
+
+    load.running = 0;
+    for (int i = 0; i < AUTHORITY_READERS; i++) {
+        pthread_join(readers[i], NULL);
+    }
+
+    wtc_result_t after = authority_validate_handle(load.mgr, load.handle, 0);
+    uint32_t epoch = authority_get_epoch(load.mgr, "rtu-a");
+    authority_state_t state = authority_get_state(load.mgr, "rtu-a");
+    logger_set_level(level);
+    authority_manager_cleanup(load.mgr);
+
+    ASSERT_EQ(0, failures);
+    ASSERT_EQ(0, load.stale_accepted);
+    ASSERT_TRUE(load.accepted > 0);
+    ASSERT_EQ(WTC_ERROR_PERMISSION, after);
+    ASSERT_EQ(2 * AUTHORITY_CYCLES, epoch);
+    ASSERT_EQ(AUTHORITY_AUTONOMOUS, state);
+}
+
+/* Two creators add the same stations while a reader looks them up */
+typedef struct {
+    authority_manager_t *mgr;
+    volatile int running;
+    int handles[2][AUTHORITY_STATIONS];
+    int created[2];             /* Handles stored so far, per creator */
+    int missing;
+} station_load_t;
+
+typedef struct {
+    station_load_t *load;
+    int creator;
+} station_creator_t;
+
+static void *station_creator(void *arg) {
+    station_creator_t *creator = arg;
+    station_load_t *load = creator->load;
+    char name[WTC_MAX_STATION_NAME];
+    for (int i = 0; i < AUTHORITY_STATIONS; i++) {
+        snprintf(name, sizeof(name), "rtu-%03d", i);
+        load->handles[creator->creator][i] = authority_get_handle(load->mgr, name);
+        __atomic_store_n(&load->created[creator->creator], i + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static void *station_reader(void *arg) {
+    station_load_t *load = arg;
+    char name[WTC_MAX_STATION_NAME];
+    while (load->running) {
+        int count = __atomic_load_n(&load->created[0], __ATOMIC_ACQUIRE);
+        for (int i = 0; i < count; i++) {
+            snprintf(name, sizeof(name), "rtu-%03d", i);
+            /* Known but autonomous: refused, never unknown */
+            if (authority_validate_command(load->mgr, name, 0, NULL) != WTC_ERROR_PERMISSION ||
+                authority_validate_handle(load->mgr, load->handles[0][i], 0) !=
+                    WTC_ERROR_PERMISSION) {
+                load->missing++;
+            }
+        }
+    }
+    return NULL;
+}
+
+TEST(authority_stations_publish_to_lock_free_lookups) {
+    static station_load_t load;
+    memset(&load, 0, sizeof(load));
+    ASSERT_EQ(WTC_OK, authority_manager_init(&load.mgr, NULL));
+
+    log_level_t level = logger_get_level();
+    logger_set_level(LOG_LEVEL_ERROR);
+
+    load.running = 1;
+    pthread_t reader;
+    pthread_create(&reader, NULL, station_reader, &load);
+
+    station_creator_t creators[2] = {{&load, 0}, {&load, 1}};
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++) {
+        pthread_create(&threads[i], NULL, station_creator, &creators[i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    load.running = 0;
+    pthread_join(reader, NULL);
+    logger_set_level(level);
+
+    /* Both creators resolved each station to the same, unique handle */
+    bool seen[AUTHORITY_STATIONS] = {false};
+    int mismatched = 0;
+    for (int i = 0; i < AUTHORITY_STATIONS; i++) {
+        int handle = load.handles[0][i];
+        if (handle < 0 || handle >= AUTHORITY_STATIONS || seen[handle] ||
+            handle != load.handles[1][i]) {
+            mismatched++;
+            continue;
+        }
+        seen[handle] = true;
+    }
+
+    /* The table holds 256 stations and refuses the next */
+    char name[WTC_MAX_STATION_NAME];
+    int last = 0;
+    for (int i = AUTHORITY_STATIONS; i <= 256; i++) {
+        snprintf(name, sizeof(name), "rtu-%03d", i);
+        last = authority_get_handle(load.mgr, name);
+    }
+    authority_manager_cleanup(load.mgr);
+
+    ASSERT_EQ(0, load.missing);
+    ASSERT_EQ(0, mismatched);
+    ASSERT_EQ(-1, last);
+}
+
+/* ============== Load Balance ============== */
+
+#define LB_DEVICES        4
+#define LB_SLOTS_PER_RTU  10
+#define LB_MEMBERS        (LB_DEVICES * LB_SLOTS_PER_RTU)
+
+static int actuator_writes;
+
+static void count_actuator_write(const char *station_name, int slot,
+                                 const actuator_state_t *state, void *ctx) {
+    (void)station_name;
+    (void)slot;
+    (void)state;
+    (void)ctx;
+    actuator_writes++;
+}
+
+/* Registry of running pump RTUs, a balancer and one group of
+ * member_count pumps spread over them */
+static bool create_pump_group(rtu_registry_t **registry, load_balancer_t **lb,
+                              int member_count) {
+    registry_config_t reg_config = {0};
+    reg_config.max_devices = LB_DEVICES;
+    reg_config.on_actuator_updated = count_actuator_write;
+    if (rtu_registry_init(registry, &reg_config) != WTC_OK) return false;
+
+    char name[WTC_MAX_STATION_NAME];
+    for (int i = 0; i < LB_DEVICES; i++) {
+        snprintf(name, sizeof(name), "pump-rtu-%d", i);
+        rtu_registry_add_device(*registry, name, "192.168.1.100", NULL, 0);
+        rtu_registry_set_device_state(*registry, name, PROFINET_STATE_RUNNING);
+    }
+
+    load_balance_config_t config = {
+        .max_groups = 4,
+        .rebalance_interval_ms = 1,
+    };
+    if (load_balance_init(lb, &config) != WTC_OK) return false;
+    load_balance_set_registry(*lb, *registry);
+
+    static load_balance_group_t group;
+    memset(&group, 0, sizeof(group));
+    group.group_id = 7;
+    snprintf(group.name, sizeof(group.name), "pumps");
+    group.enabled = true;
+    group.member_count = member_count;
+    for (int i = 0; i < member_count; i++) {
+        snprintf(group.members[i].rtu_station, sizeof(group.members[i].rtu_station),
+                 "pump-rtu-%d", i % LB_DEVICES);
+        group.members[i].slot = 1 + i / LB_DEVICES;
+        group.members[i].capacity = 10.0f;
+        group.members[i].available = true;
+    }
+    if (load_balance_add_group(*lb, &group) != WTC_OK) return false;
+    return load_balance_start(*lb) == WTC_OK;
+}
+
+static void run_balancer(load_balancer_t *lb) {
+    time_sleep_ms(2);
+    load_balance_process(lb);
+}
+
+TEST(load_balance_spreads_demand_over_dozens_of_pumps) {
+    rtu_registry_t *registry = NULL;
+    load_balancer_t *lb = NULL;
+    ASSERT_TRUE(create_pump_group(&registry, &lb, LB_MEMBERS));
+
+    /* Every pump takes an equal share and is written once */
+    actuator_writes = 0;
+    ASSERT_EQ(WTC_OK, load_balance_set_demand(lb, 7, 200.0f));
+    run_balancer(lb);
+    ASSERT_EQ(LB_MEMBERS, actuator_writes);
+
+    static load_balance_group_t group;
+    ASSERT_EQ(WTC_OK, load_balance_get_group(lb, 7, &group));
+    ASSERT_EQ(LB_MEMBERS, group.member_count);
+    for (int i = 0; i < LB_MEMBERS; i++) {
+        ASSERT_FLOAT_EQ(5.0f, group.members[i].current_load, 0.01f);
+    }
+
+    actuator_state_t actuator;
+    ASSERT_EQ(WTC_OK, rtu_registry_get_actuator(registry, "pump-rtu-3", LB_SLOTS_PER_RTU,
+                                                &actuator));
+    ASSERT_EQ(ACTUATOR_CMD_PWM, actuator.output.command);
+    ASSERT_EQ(50, actuator.output.pwm_duty);
+
+    /* Rechecks and changes inside the threshold write nothing */
+    run_balancer(lb);
+    ASSERT_EQ(WTC_OK, load_balance_set_demand(lb, 7, 202.0f));
+    run_balancer(lb);
+    ASSERT_EQ(LB_MEMBERS, actuator_writes);
+
+    load_balance_cleanup(lb);
+    rtu_registry_cleanup(registry);
+}
+
+TEST(load_balance_zeroes_members_outside_the_distribution) {
+    rtu_registry_t *registry = NULL;
+    load_balancer_t *lb = NULL;
+    ASSERT_TRUE(create_pump_group(&registry, &lb, LB_DEVICES));
+
+    ASSERT_EQ(WTC_OK, load_balance_set_demand(lb, 7, 20.0f));
+    run_balancer(lb);
+
+    /* A pump whose RTU drops out carries no load */
+    rtu_registry_set_device_state(registry, "pump-rtu-2", PROFINET_STATE_DISCONNECT);
+    run_balancer(lb);
+
+    static load_balance_group_t group;
+    ASSERT_EQ(WTC_OK, load_balance_get_group(lb, 7, &group));
+    ASSERT_TRUE(!group.members[2].available);
+    ASSERT_FLOAT_EQ(0.0f, group.members[2].current_load, 0.001f);
+    ASSERT_FLOAT_EQ(20.0f / 3, group.members[0].current_load, 0.01f);
+
+    /* No demand reaches no member: every load and running output drops to zero */
+    ASSERT_EQ(WTC_OK, load_balance_set_demand(lb, 7, 0.0f));
+    run_balancer(lb);
+    ASSERT_EQ(WTC_OK, load_balance_get_group(lb, 7, &group));
+
+    char name[WTC_MAX_STATION_NAME];
+    actuator_state_t actuator;
+    for (int i = 0; i < LB_DEVICES; i++) {
+        ASSERT_FLOAT_EQ(0.0f, group.members[i].current_load, 0.001f);
+        if (i == 2) continue;
+        snprintf(name, sizeof(name), "pump-rtu-%d", i);
+        ASSERT_EQ(WTC_OK, rtu_registry_get_actuator(registry, name, 1, &actuator));
+        ASSERT_EQ(ACTUATOR_CMD_OFF, actuator.output.command);
+        ASSERT_EQ(0, actuator.output.pwm_duty);
+    }
+
+    load_balance_cleanup(lb);
+    rtu_registry_cleanup(registry);
+}
+
+/* ============== Test Runner ============== */
+
+static void run_coordination_tests(void)
+{
+    printf("\n=== Coordination Tests ===\n\n");
+
+    printf("Replication Tests:\n");
+    RUN_TEST(replication_requires_key);
+    RUN_TEST(replication_loopback_pair);
+    RUN_TEST(replication_rejects_wrong_key);
+    RUN_TEST(replication_primary_fences_on_lost_standby);
+
+    printf("\nFailover Tests:\n");
+    RUN_TEST(failover_watchdog_needs_consecutive_misses);
+    RUN_TEST(failover_times_out_from_schedule);
+
+    printf("\nAuthority Tests:\n");
+    RUN_TEST(authority_gate_rejects_stale_epochs_under_handoffs);
+    RUN_TEST(authority_stations_publish_to_lock_free_lookups);
+
+    printf("\nLoad Balance Tests:\n");
+    RUN_TEST(load_balance_spreads_demand_over_dozens_of_pumps);
+    RUN_TEST(load_balance_zeroes_members_outside_the_distribution);
+
+    printf("\n=== Results: %d/%d tests passed ===\n\n", tests_passed, tests_run);
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    run_coordination_tests();
+    return (tests_passed == tests_run) ? 0 : 1;
+}
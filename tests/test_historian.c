@@ -9,9 +9,21 @@
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include "../src/historian/historian.h"
+#include "../src/historian/historian_export.h"
+#include "../src/historian/historian_store.h"
+#include "../src/registry/rtu_registry.h"
+#include "../src/utils/time_utils.h"
 #include "../src/types.h"
 
+#define EXPORT_T0 1700000000000ULL   /* 2023-11-14T22:13:20Z */
+
 /* Test counters */
 static int tests_run = 0;
 static int tests_passed = 0;
@@ -39,6 +51,20 @@ static int tests_passed = 0;
     } \
 } while(0)
 
+#define ASSERT_STR_EQ(expected, actual) do { \
+    if (strcmp((expected), (actual)) != 0) { \
+        printf("FAILED at line %d: expected '%s', got '%s'\n", __LINE__, (expected), (actual)); \
+        return; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(cond) do { \
+    if (!(cond)) { \
+        printf("FAILED at line %d: condition is false\n", __LINE__); \
+        return; \
+    } \
+} while(0)
+
 /* ============== Historian Creation Tests ============== */
 
 TEST(historian_init_null)
@@ -139,6 +165,51 @@ TEST(historian_add_multiple_tags)
     historian_cleanup(hist);
 }
 
+TEST(historian_find_and_remove_tags)
+{
+    historian_t *hist = NULL;
+    historian_config_t config = {0};
+    config.max_tags = 3;
+    config.buffer_size = 100;
+    ASSERT_EQ(WTC_OK, historian_init(&hist, &config));
+
+    int a, b, c, d, found;
+    ASSERT_EQ(WTC_OK, historian_add_tag(hist, "rtu-1", 1, "a", 1000, 0.0f, COMPRESSION_NONE, &a));
+    ASSERT_EQ(WTC_OK, historian_add_tag(hist, "rtu-1", 2, "b", 1000, 0.0f, COMPRESSION_NONE, &b));
+    ASSERT_EQ(WTC_OK, historian_add_tag(hist, "rtu-2", 1, "c", 1000, 0.0f, COMPRESSION_NONE, &c));
+    ASSERT_EQ(WTC_ERROR_ALREADY_EXISTS,
+              historian_add_tag(hist, "rtu-1", 2, "dup", 1000, 0.0f, COMPRESSION_NONE, &d));
+    ASSERT_EQ(WTC_ERROR_FULL,
+              historian_add_tag(hist, "rtu-3", 1, "d", 1000, 0.0f, COMPRESSION_NONE, &d));
+
+    ASSERT_EQ(WTC_OK, historian_find_tag(hist, "rtu-2", 1, &found));
+    ASSERT_EQ(c, found);
+    ASSERT_EQ(WTC_ERROR_NOT_FOUND, historian_find_tag(hist, "rtu-2", 2, &found));
+
+    /* Removing a tag frees its slot without disturbing the others */
+    ASSERT_EQ(WTC_OK, historian_record_sample(hist, c, 1000, 7.0f, 192));
+    ASSERT_EQ(WTC_OK, historian_remove_tag(hist, a));
+    ASSERT_EQ(WTC_ERROR_NOT_FOUND, historian_find_tag(hist, "rtu-1", 1, &found));
+    ASSERT_EQ(WTC_ERROR_NOT_FOUND, historian_remove_tag(hist, a));
+
+    ASSERT_EQ(WTC_OK, historian_add_tag(hist, "rtu-3", 1, "d", 1000, 0.0f, COMPRESSION_NONE, &d));
+    ASSERT_TRUE(d != a);
+    ASSERT_EQ(WTC_OK, historian_find_tag(hist, "rtu-3", 1, &found));
+    ASSERT_EQ(d, found);
+    ASSERT_EQ(WTC_OK, historian_find_tag(hist, "rtu-1", 2, &found));
+    ASSERT_EQ(b, found);
+
+    float value = 0.0f;
+    ASSERT_EQ(WTC_OK, historian_get_current(hist, c, &value, NULL, NULL));
+    ASSERT_TRUE(value == 7.0f);
+
+    historian_stats_t stats;
+    historian_get_stats(hist, &stats);
+    ASSERT_EQ(3, (int)stats.total_tags);
+
+    historian_cleanup(hist);
+}
+
 /* ============== Data Recording Tests ============== */
 
 TEST(historian_record_sample)
@@ -175,6 +246,841 @@ TEST(historian_record_sample)
     historian_cleanup(hist);
 }
 
+TEST(historian_buffer_spans_chunks_and_drops_oldest)
+{
+    historian_t *hist = NULL;
+    historian_config_t config = {0};
+    config.max_tags = 4;
+    config.buffer_size = 1000;
+    config.overflow = HISTORIAN_OVERFLOW_DROP_OLDEST;
+    ASSERT_EQ(WTC_OK, historian_init(&hist, &config));
+
+    int tag;
+    historian_add_tag(hist, "rtu-1", 1, "flow", 1000, 0.0f, COMPRESSION_NONE, &tag);
+
+    /* More than two chunks' worth, so the oldest 200 are dropped */
+    for (int i = 0; i < 1200; i++) {
+        historian_record_sample(hist, tag, EXPORT_T0 + (uint64_t)i * 10, (float)i, 192);
+    }
+    /* Out-of-order timestamp starts a new chunk */
+    historian_record_sample(hist, tag, EXPORT_T0 - 5, -1.0f, 64);
+
+    static historian_sample_t samples[1100];
+    int count = 0;
+    ASSERT_EQ(WTC_OK, historian_query(hist, tag, 0, UINT64_MAX, samples, &count, 1100));
+    ASSERT_EQ(1000, count);
+    /* Oldest first, so the late sample leads */
+    ASSERT_TRUE(samples[0].timestamp_ms == EXPORT_T0 - 5);
+    ASSERT_EQ(64, samples[0].quality);
+    ASSERT_EQ(tag, samples[0].tag_id);
+    ASSERT_TRUE(samples[1].timestamp_ms == EXPORT_T0 + 2010);
+    ASSERT_TRUE(samples[1].value == 201.0f);
+    ASSERT_TRUE(samples[999].timestamp_ms == EXPORT_T0 + 11990);
+
+    historian_stats_t stats;
+    historian_get_stats(hist, &stats);
+    ASSERT_EQ(1000, (int)stats.samples_in_buffer);
+    ASSERT_EQ(201, (int)stats.samples_dropped);
+
+    historian_cleanup(hist);
+}
+
+TEST(historian_process_samples_due_tags)
+{
+    rtu_registry_t *reg = NULL;
+    registry_config_t reg_config = {0};
+    reg_config.max_devices = 4;
+    ASSERT_EQ(WTC_OK, rtu_registry_init(&reg, &reg_config));
+    rtu_registry_add_device(reg, "rtu-1", "192.168.1.10", NULL, 0);
+    rtu_registry_add_device(reg, "rtu-2", "192.168.1.11", NULL, 0);
+    rtu_registry_update_sensor(reg, "rtu-1", 1, 1.5f, IOPS_GOOD, QUALITY_GOOD);
+    rtu_registry_update_sensor(reg, "rtu-1", 2, 2.5f, IOPS_GOOD, QUALITY_GOOD);
+    rtu_registry_update_sensor(reg, "rtu-2", 1, 3.5f, IOPS_GOOD, QUALITY_GOOD);
+
+    historian_t *hist = NULL;
+    historian_config_t config = {0};
+    config.max_tags = 10;
+    config.buffer_size = 100;
+    ASSERT_EQ(WTC_OK, historian_init(&hist, &config));
+    historian_set_registry(hist, reg);
+
+    int fast, slow, other, missing;
+    historian_add_tag(hist, "rtu-1", 1, "fast", 20, 0.0f, COMPRESSION_NONE, &fast);
+    historian_add_tag(hist, "rtu-1", 2, "slow", 60000, 0.0f, COMPRESSION_NONE, &slow);
+    historian_add_tag(hist, "rtu-2", 1, "other", 60000, 0.0f, COMPRESSION_NONE, &other);
+    historian_add_tag(hist, "rtu-9", 1, "missing", 60000, 0.0f, COMPRESSION_NONE, &missing);
+
+    /* Everything is due on the first pass; the unknown RTU yields nothing */
+    ASSERT_EQ(WTC_OK, historian_process(hist));
+    historian_stats_t stats;
+    historian_get_stats(hist, &stats);
+    ASSERT_EQ(3, (int)stats.total_samples);
+
+    float value = 0.0f;
+    historian_get_current(hist, other, &value, NULL, NULL);
+    ASSERT_TRUE(value == 3.5f);
+
+    /* Only the 20 ms tag comes due again, removal keeps the schedule intact */
+    ASSERT_EQ(WTC_OK, historian_remove_tag(hist, slow));
+    time_sleep_ms(30);
+    ASSERT_EQ(WTC_OK, historian_process(hist));
+    time_sleep_ms(30);
+    ASSERT_EQ(WTC_OK, historian_process(hist));
+
+    historian_tag_t tag;
+    ASSERT_EQ(WTC_OK, historian_get_tag(hist, fast, &tag));
+    ASSERT_EQ(3, (int)tag.total_samples);
+    ASSERT_EQ(WTC_OK, historian_get_tag(hist, other, &tag));
+    ASSERT_EQ(1, (int)tag.total_samples);
+
+    historian_cleanup(hist);
+    rtu_registry_cleanup(reg);
+}
+
+/* ============== Export Tests ============== */
+
+static void remove_dir(const char *path)
+{
+    DIR *dir = opendir(path);
+    if (!dir) return;
+    struct dirent *entry;
+    char file[512];
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        unlink(file);
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+static int read_lines(const char *filename, char lines[][256], int max_lines)
+{
+    FILE *fp = fopen(filename, "r");
+    if (!fp) return -1;
+    int n = 0;
+    while (n < max_lines && fgets(lines[n], 256, fp)) {
+        lines[n][strcspn(lines[n], "\n")] = '\0';
+        n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+/* Two tags with interleaved timestamps, flushed to a scratch store */
+static historian_t *create_export_fixture(char *dir, int *tag_a, int *tag_b)
+{
+    strcpy(dir, "/tmp/wtc_hist_XXXXXX");
+    if (!mkdtemp(dir)) return NULL;
+
+    historian_t *hist = NULL;
+    historian_config_t config = {0};
+    config.database_path = dir;
+    config.max_tags = 10;
+    config.buffer_size = 100;
+    if (historian_init(&hist, &config) != WTC_OK) return NULL;
+
+    historian_add_tag(hist, "rtu-1", 1, "flow", 1000, 0.0f, COMPRESSION_NONE, tag_a);
+    historian_add_tag(hist, "rtu-1", 2, "level", 1000, 0.0f, COMPRESSION_NONE, tag_b);
+
+    historian_record_sample(hist, *tag_a, EXPORT_T0, 0.0f, 192);
+    historian_record_sample(hist, *tag_a, EXPORT_T0 + 1000, 1.0f, 192);
+    historian_record_sample(hist, *tag_a, EXPORT_T0 + 2000, 2.0f, 192);
+    historian_record_sample(hist, *tag_b, EXPORT_T0 + 1000, 10.5f, 192);
+    historian_record_sample(hist, *tag_b, EXPORT_T0 + 3000, -3.24f, 192);
+    historian_flush(hist);
+    return hist;
+}
+
+TEST(historian_export_raw_union)
+{
+    char dir[64], out[128], lines[8][256];
+    int tag_a, tag_b;
+    historian_t *hist = create_export_fixture(dir, &tag_a, &tag_b);
+    ASSERT_NOT_NULL(hist);
+
+    int ids[2] = { tag_a, tag_b };
+    snprintf(out, sizeof(out), "%s/export.csv", dir);
+    ASSERT_EQ(WTC_OK, historian_export_csv(hist, ids, 2, EXPORT_T0, EXPORT_T0 + 5000, out));
+
+    ASSERT_EQ(5, read_lines(out, lines, 8));
+    ASSERT_STR_EQ("timestamp,flow,level", lines[0]);
+    ASSERT_STR_EQ("2023-11-14T22:13:20.000Z,0.0000,", lines[1]);
+    ASSERT_STR_EQ("2023-11-14T22:13:21.000Z,1.0000,10.5000", lines[2]);
+    ASSERT_STR_EQ("2023-11-14T22:13:23.000Z,,-3.2400", lines[4]);
+
+    historian_cleanup(hist);
+    remove_dir(dir);
+}
+
+TEST(historian_export_carry_forward_and_interpolate)
+{
+    char dir[64], out[128], lines[8][256];
+    int tag_a, tag_b;
+    historian_t *hist = create_export_fixture(dir, &tag_a, &tag_b);
+    ASSERT_NOT_NULL(hist);
+
+    int ids[2] = { tag_a, tag_b };
+    snprintf(out, sizeof(out), "%s/export.csv", dir);
+
+    historian_export_options_t opts = {0};
+    opts.align = HISTORIAN_ALIGN_CARRY_FORWARD;
+    opts.decimals = 1;
+    ASSERT_EQ(WTC_OK, historian_export(hist, ids, 2, EXPORT_T0, EXPORT_T0 + 5000, &opts, out));
+    ASSERT_EQ(5, read_lines(out, lines, 8));
+    ASSERT_STR_EQ("2023-11-14T22:13:23.000Z,2.0,-3.2", lines[4]);
+
+    opts.align = HISTORIAN_ALIGN_INTERPOLATE;
+    opts.interval_ms = 500;
+    ASSERT_EQ(WTC_OK, historian_export(hist, ids, 2, EXPORT_T0, EXPORT_T0 + 2000, &opts, out));
+    ASSERT_EQ(6, read_lines(out, lines, 8));
+    ASSERT_STR_EQ("2023-11-14T22:13:20.500Z,0.5,", lines[2]);
+    ASSERT_STR_EQ("2023-11-14T22:13:21.500Z,1.5,7.1", lines[4]);
+
+    /* Zero decimals is honoured, not taken as unset */
+    opts.decimals = 0;
+    ASSERT_EQ(WTC_OK, historian_export(hist, ids, 2, EXPORT_T0, EXPORT_T0 + 2000, &opts, out));
+    ASSERT_EQ(6, read_lines(out, lines, 8));
+    ASSERT_STR_EQ("2023-11-14T22:13:21.500Z,2,7", lines[4]);
+
+    opts.interval_ms = 0;
+    ASSERT_EQ(WTC_ERROR_INVALID_PARAM,
+              historian_export(hist, ids, 2, EXPORT_T0, EXPORT_T0 + 2000, &opts, out));
+
+    historian_cleanup(hist);
+    remove_dir(dir);
+}
+
+TEST(historian_export_large_values)
+{
+    char dir[64], out[128], lines[8][256], expected[256];
+    int tag_a, tag_b;
+    historian_t *hist = create_export_fixture(dir, &tag_a, &tag_b);
+    ASSERT_NOT_NULL(hist);
+
+    /* Too large for the fixed-point path at full precision */
+    const float big = 123456789012.0f;
+    historian_record_sample(hist, tag_a, EXPORT_T0 + 4000, big, 192);
+    historian_record_sample(hist, tag_a, EXPORT_T0 + 5000, -big, 192);
+    historian_flush(hist);
+
+    int ids[1] = { tag_a };
+    snprintf(out, sizeof(out), "%s/export.csv", dir);
+    historian_export_options_t opts = {0};
+    opts.decimals = 9;
+    ASSERT_EQ(WTC_OK, historian_export(hist, ids, 1, EXPORT_T0 + 4000, EXPORT_T0 + 5000, &opts, out));
+    ASSERT_EQ(3, read_lines(out, lines, 8));
+    snprintf(expected, sizeof(expected), "2023-11-14T22:13:24.000Z,%.9f", (double)big);
+    ASSERT_STR_EQ(expected, lines[1]);
+    snprintf(expected, sizeof(expected), "2023-11-14T22:13:25.000Z,%.9f", -(double)big);
+    ASSERT_STR_EQ(expected, lines[2]);
+
+    historian_cleanup(hist);
+    remove_dir(dir);
+}
+
+TEST(historian_export_columnar)
+{
+    char dir[64], out[128];
+    int tag_a, tag_b;
+    historian_t *hist = create_export_fixture(dir, &tag_a, &tag_b);
+    ASSERT_NOT_NULL(hist);
+
+    int ids[2] = { tag_a, tag_b };
+    snprintf(out, sizeof(out), "%s/export.bin", dir);
+
+    historian_export_options_t opts = {0};
+    opts.format = HISTORIAN_EXPORT_COLUMNAR;
+    ASSERT_EQ(WTC_OK, historian_export(hist, ids, 2, EXPORT_T0, EXPORT_T0 + 5000, &opts, out));
+
+    FILE *fp = fopen(out, "rb");
+    ASSERT_NOT_NULL(fp);
+    uint32_t magic = 0;
+    uint16_t version = 0, columns = 0;
+    size_t header_reads = fread(&magic, sizeof(magic), 1, fp);
+    header_reads += fread(&version, sizeof(version), 1, fp);
+    header_reads += fread(&columns, sizeof(columns), 1, fp);
+    fclose(fp);
+    ASSERT_EQ(3, header_reads);
+
+    ASSERT_EQ(HISTORIAN_COLUMNAR_MAGIC, magic);
+    ASSERT_EQ(HISTORIAN_COLUMNAR_VERSION, version);
+    ASSERT_EQ(2, columns);
+
+    historian_cleanup(hist);
+    remove_dir(dir);
+}
+
+/* ============== Segment Read Tests ============== */
+
+static int count_cursor(const char *dir, int tag, uint64_t start, uint64_t end,
+                        historian_sample_t *first)
+{
+    historian_cursor_t *cursor = NULL;
+    if (historian_cursor_open(&cursor, dir, tag, start, end) != WTC_OK) return -1;
+    historian_sample_t sample;
+    int n = 0;
+    while (historian_cursor_next(cursor, &sample) == WTC_OK) {
+        if (n == 0 && first) *first = sample;
+        n++;
+    }
+    historian_cursor_close(cursor);
+    return n;
+}
+
+TEST(historian_cursor_maps_segments)
+{
+    char dir[] = "/tmp/wtc_hist_mapXXXXXX";
+    ASSERT_NOT_NULL(mkdtemp(dir));
+
+    /* Day 0 in the base segment, a later day with a sorted run */
+    historian_sample_t samples[1000];
+    for (int i = 0; i < 1000; i++) {
+        samples[i].timestamp_ms = EXPORT_T0 + (uint64_t)i * 1000;
+        samples[i].tag_id = 1;
+        samples[i].value = (float)i;
+        samples[i].quality = 192;
+    }
+    ASSERT_EQ(WTC_OK, historian_store_append(dir, 1, samples, 1000, NULL));
+
+    historian_map_stats_t before, after;
+    historian_store_get_map_stats(&before);
+
+    /* A range inside the file starts at the right record */
+    historian_sample_t first;
+    ASSERT_EQ(101, count_cursor(dir, 1, EXPORT_T0 + 499500, EXPORT_T0 + 600000, &first));
+    ASSERT_EQ(500, (int)first.value);
+
+    /* The second query reuses the mapping */
+    ASSERT_EQ(1000, count_cursor(dir, 1, EXPORT_T0, EXPORT_T0 + 1000000, NULL));
+    historian_store_get_map_stats(&after);
+    ASSERT_EQ(1, (int)(after.misses - before.misses));
+    ASSERT_EQ(1, (int)(after.hits - before.hits));
+
+    /* An append is seen by the next cursor */
+    historian_sample_t late = samples[999];
+    late.timestamp_ms += 1000;
+    ASSERT_EQ(WTC_OK, historian_store_append(dir, 1, &late, 1, NULL));
+    ASSERT_EQ(1001, count_cursor(dir, 1, EXPORT_T0, EXPORT_T0 + 1000000, NULL));
+
+    /* Idle mappings are evicted down to the limit */
+    samples[0].timestamp_ms = EXPORT_T0 + 2 * HISTORIAN_MS_PER_DAY;
+    ASSERT_EQ(WTC_OK, historian_store_write_run(dir, 1, samples, 1, NULL));
+    historian_store_set_map_limits(1, 0);
+    ASSERT_EQ(1002, count_cursor(dir, 1, EXPORT_T0, EXPORT_T0 + 3 * HISTORIAN_MS_PER_DAY, NULL));
+    historian_store_get_map_stats(&after);
+    ASSERT_EQ(1, after.mappings);
+
+    /* Removing the day drops its mapping */
+    historian_store_remove_day(dir, EXPORT_T0 + 2 * HISTORIAN_MS_PER_DAY, 1, NULL);
+    historian_store_get_map_stats(&after);
+    ASSERT_EQ(0, after.mappings);
+
+    historian_store_set_map_limits(0, 0);
+    remove_dir(dir);
+}
+
+TEST(historian_store_append_keeps_segments_sorted)
+{
+    char dir[] = "/tmp/wtc_hist_sortXXXXXX";
+    ASSERT_NOT_NULL(mkdtemp(dir));
+
+    /* Even seconds in order, then odd seconds arriving late and shuffled */
+    historian_sample_t samples[100];
+    for (int i = 0; i < 100; i++) {
+        samples[i].timestamp_ms = EXPORT_T0 + (uint64_t)i * 2000;
+        samples[i].tag_id = 1;
+        samples[i].value = (float)(i * 2);
+        samples[i].quality = 192;
+    }
+    ASSERT_EQ(WTC_OK, historian_store_append(dir, 1, samples, 100, NULL));
+    for (int i = 0; i < 100; i++) {
+        int k = (i * 37) % 100;
+        samples[i].timestamp_ms = EXPORT_T0 + (uint64_t)k * 2000 + 1000;
+        samples[i].value = (float)(k * 2 + 1);
+    }
+    ASSERT_EQ(WTC_OK, historian_store_append(dir, 1, samples, 100, NULL));
+
+    /* The base segment stays searchable: a range in the middle finds
+     * exactly its samples, in time order */
+    historian_cursor_t *cursor = NULL;
+    ASSERT_EQ(WTC_OK, historian_cursor_open(&cursor, dir, 1, EXPORT_T0 + 50000,
+                                            EXPORT_T0 + 59000));
+    historian_sample_t sample;
+    int n = 0;
+    while (historian_cursor_next(cursor, &sample) == WTC_OK) {
+        ASSERT_EQ(50 + n, (int)sample.value);
+        n++;
+    }
+    historian_cursor_close(cursor);
+    ASSERT_EQ(10, n);
+    ASSERT_EQ(200, count_cursor(dir, 1, EXPORT_T0, EXPORT_T0 + 200000, NULL));
+
+    /* A day's worth of late batches compacts instead of running out of runs */
+    for (int r = 0; r < HISTORIAN_MAX_SEGMENT_RUNS + 2; r++) {
+        samples[0].timestamp_ms = EXPORT_T0 + 500 + (uint64_t)r;
+        samples[0].value = -1.0f;
+        ASSERT_EQ(WTC_OK, historian_store_append(dir, 1, samples, 1, NULL));
+    }
+    ASSERT_EQ(200 + HISTORIAN_MAX_SEGMENT_RUNS + 2,
+              count_cursor(dir, 1, EXPORT_T0, EXPORT_T0 + 200000, NULL));
+
+    remove_dir(dir);
+}
+
+TEST(historian_store_append_drops_partial_records)
+{
+    char dir[] = "/tmp/wtc_hist_shortXXXXXX";
+    ASSERT_NOT_NULL(mkdtemp(dir));
+
+    historian_sample_t samples[4];
+    for (int i = 0; i < 4; i++) {
+        samples[i].timestamp_ms = EXPORT_T0 + (uint64_t)i * 1000;
+        samples[i].tag_id = 1;
+        samples[i].value = (float)i;
+        samples[i].quality = 192;
+    }
+    ASSERT_EQ(WTC_OK, historian_store_append(dir, 1, samples, 2, NULL));
+
+    char path[256];
+    struct stat st;
+    historian_store_segment_path(dir, EXPORT_T0, 1, path, sizeof(path));
+    ASSERT_EQ(0, stat(path, &st));
+    off_t whole = st.st_size;
+
+    /* The file size limit lets only half of the next record reach disk */
+    struct rlimit saved, limited;
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &saved));
+    limited = saved;
+    limited.rlim_cur = (rlim_t)whole + HISTORIAN_RECORD_SIZE / 2;
+    void (*saved_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limited));
+    wtc_result_t res = historian_store_append(dir, 1, &samples[2], 2, NULL);
+    setrlimit(RLIMIT_FSIZE, &saved);
+    signal(SIGXFSZ, saved_handler);
+
+    ASSERT_EQ(WTC_ERROR_IO, res);
+    ASSERT_EQ(0, stat(path, &st));
+    ASSERT_EQ((int)whole, (int)st.st_size);
+    ASSERT_EQ(2, count_cursor(dir, 1, EXPORT_T0, EXPORT_T0 + 10000, NULL));
+
+    /* Later appends land on a record boundary */
+    ASSERT_EQ(WTC_OK, historian_store_append(dir, 1, &samples[2], 2, NULL));
+    ASSERT_EQ(4, count_cursor(dir, 1, EXPORT_T0, EXPORT_T0 + 10000, NULL));
+
+    remove_dir(dir);
+}
+
+TEST(historian_query_spans_store_and_buffer)
+{
+    char dir[] = "/tmp/wtc_hist_queryXXXXXX";
+    ASSERT_NOT_NULL(mkdtemp(dir));
+
+    historian_t *hist = NULL;
+    historian_config_t config = {0};
+    config.max_tags = 4;
+    config.buffer_size = 100;
+    config.database_path = dir;
+    ASSERT_EQ(WTC_OK, historian_init(&hist, &config));
+
+    int tag;
+    historian_add_tag(hist, "rtu-1", 1, "flow", 1000, 0.0f, COMPRESSION_NONE, &tag);
+
+    /* Three samples flushed to the store, two still buffered */
+    for (int i = 0; i < 3; i++) {
+        historian_record_sample(hist, tag, EXPORT_T0 + (uint64_t)i * 1000, (float)i, 192);
+    }
+    ASSERT_EQ(WTC_OK, historian_flush(hist));
+    historian_record_sample(hist, tag, EXPORT_T0 + 3000, 3.0f, 192);
+    historian_record_sample(hist, tag, EXPORT_T0 + 4000, 4.0f, 0);
+
+    historian_sample_t samples[10];
+    int count = 0;
+    ASSERT_EQ(WTC_OK, historian_query(hist, tag, EXPORT_T0, EXPORT_T0 + 10000,
+                                      samples, &count, 10));
+    ASSERT_EQ(5, count);
+    for (int i = 0; i < count; i++) {
+        ASSERT_EQ(i, (int)samples[i].value);
+    }
+
+    /* A range inside the store, and a bounded result */
+    ASSERT_EQ(WTC_OK, historian_query(hist, tag, EXPORT_T0 + 1000, EXPORT_T0 + 3000,
+                                      samples, &count, 10));
+    ASSERT_EQ(3, count);
+    ASSERT_EQ(1, (int)samples[0].value);
+    ASSERT_EQ(WTC_OK, historian_query(hist, tag, EXPORT_T0, EXPORT_T0 + 10000,
+                                      samples, &count, 2));
+    ASSERT_EQ(2, count);
+
+    /* The current value reports the quality it was recorded with */
+    float value;
+    uint64_t timestamp_ms;
+    uint8_t quality = 192;
+    ASSERT_EQ(WTC_OK, historian_get_current(hist, tag, &value, &timestamp_ms, &quality));
+    ASSERT_EQ(0, quality);
+    ASSERT_EQ(4, (int)value);
+
+    historian_cleanup(hist);
+    remove_dir(dir);
+}
+
+/* ============== Write-Ahead Log Tests ============== */
+
+TEST(historian_wal_recovers_unflushed_samples)
+{
+    char dir[] = "/tmp/wtc_hist_walXXXXXX";
+    ASSERT_NOT_NULL(mkdtemp(dir));
+
+    historian_t *hist = NULL;
+    historian_config_t config = {0};
+    config.max_tags = 4;
+    config.buffer_size = 100;
+    config.database_path = dir;
+    config.wal_enabled = true;
+    ASSERT_EQ(WTC_OK, historian_init(&hist, &config));
+
+    int tag;
+    historian_add_tag(hist, "rtu-1", 1, "flow", 1000, 0.0f, COMPRESSION_NONE, &tag);
+
+    /* A full buffer spills to the writer instead of dropping */
+    for (int i = 0; i < 250; i++) {
+        historian_record_sample(hist, tag, EXPORT_T0 + (uint64_t)i * 10, (float)i, 192);
+    }
+    ASSERT_EQ(WTC_OK, historian_flush(hist));
+
+    historian_stats_t stats;
+    historian_get_stats(hist, &stats);
+    ASSERT_EQ(200, (int)stats.samples_spilled);
+    ASSERT_EQ(0, (int)stats.samples_dropped);
+    ASSERT_EQ(250, (int)stats.samples_flushed);
+
+    /* Never flushed: only the log holds these */
+    for (int i = 250; i < 280; i++) {
+        historian_record_sample(hist, tag, EXPORT_T0 + (uint64_t)i * 10, (float)i, 192);
+    }
+    historian_cleanup(hist);
+    ASSERT_EQ(250, count_cursor(dir, tag, EXPORT_T0, EXPORT_T0 + 10000, NULL));
+
+    /* The next start replays them, once */
+    ASSERT_EQ(WTC_OK, historian_init(&hist, &config));
+    historian_get_stats(hist, &stats);
+    ASSERT_EQ(30, (int)stats.samples_recovered);
+    historian_cleanup(hist);
+
+    historian_sample_t first;
+    ASSERT_EQ(30, count_cursor(dir, tag, EXPORT_T0 + 2500, EXPORT_T0 + 10000, &first));
+    ASSERT_EQ(250, (int)first.value);
+    ASSERT_EQ(280, count_cursor(dir, tag, EXPORT_T0, EXPORT_T0 + 10000, NULL));
+
+    ASSERT_EQ(WTC_OK, historian_init(&hist, &config));
+    historian_get_stats(hist, &stats);
+    ASSERT_EQ(0, (int)stats.samples_recovered);
+    historian_cleanup(hist);
+
+    remove_dir(dir);
+}
+
+/* ============== Import Tests ============== */
+
+TEST(historian_import_merges_unordered_csv)
+{
+    char dir[64], in[128], out[128], lines[8][256];
+    int tag_a, tag_b;
+    historian_t *hist = create_export_fixture(dir, &tag_a, &tag_b);
+    ASSERT_NOT_NULL(hist);
+
+    /* Out of order, one row already in the store, one repeated in-file,
+     * one unparsable value and an unknown column */
+    snprintf(in, sizeof(in), "%s/import.csv", dir);
+    FILE *fp = fopen(in, "w");
+    ASSERT_NOT_NULL(fp);
+    fprintf(fp, "timestamp,flow,spare\n");
+    fprintf(fp, "2023-11-14T22:13:21.500Z,1.5,9\n");
+    fprintf(fp, "1700000000500,0.5,\n");
+    fprintf(fp, "2023-11-14T22:13:21.000Z,7.0,\n");
+    fprintf(fp, "1700000000500,0.6,\n");
+    fprintf(fp, "2023-11-14T22:13:22.500Z,bogus,\n");
+    fclose(fp);
+
+    historian_import_result_t result;
+    ASSERT_EQ(WTC_OK, historian_import(hist, in, 2, &result));
+    ASSERT_EQ(5, (int)result.rows_parsed);
+    ASSERT_EQ(2, (int)result.samples_imported);
+    ASSERT_EQ(2, (int)result.duplicates_skipped);
+    ASSERT_EQ(1, (int)result.parse_errors);
+    ASSERT_EQ(1, result.segments_written);
+
+    int ids[1] = { tag_a };
+    snprintf(out, sizeof(out), "%s/export.csv", dir);
+    ASSERT_EQ(WTC_OK, historian_export_csv(hist, ids, 1, EXPORT_T0, EXPORT_T0 + 5000, out));
+    ASSERT_EQ(6, read_lines(out, lines, 8));
+    ASSERT_STR_EQ("2023-11-14T22:13:20.500Z,0.6000", lines[2]);
+    ASSERT_STR_EQ("2023-11-14T22:13:21.000Z,1.0000", lines[3]);
+    ASSERT_STR_EQ("2023-11-14T22:13:21.500Z,1.5000", lines[4]);
+
+    /* Importing the same file again adds nothing */
+    ASSERT_EQ(WTC_OK, historian_import(hist, in, 1, &result));
+    ASSERT_EQ(0, (int)result.samples_imported);
+    ASSERT_EQ(0, result.segments_written);
+
+    historian_cleanup(hist);
+    remove_dir(dir);
+}
+
+TEST(historian_export_quotes_names_for_import)
+{
+    char dir[64], path[128], lines[8][256];
+    int tag_a, tag_b, tag_c;
+    historian_t *hist = create_export_fixture(dir, &tag_a, &tag_b);
+    ASSERT_NOT_NULL(hist);
+    ASSERT_EQ(WTC_OK, historian_add_tag(hist, "rtu-1", 3, "flow, \"raw\"", 1000, 0.0f,
+                                        COMPRESSION_NONE, &tag_c));
+    historian_record_sample(hist, tag_c, EXPORT_T0, 4.0f, 192);
+    historian_flush(hist);
+
+    int ids[2] = { tag_c, tag_b };
+    snprintf(path, sizeof(path), "%s/export.csv", dir);
+    ASSERT_EQ(WTC_OK, historian_export_csv(hist, ids, 2, EXPORT_T0, EXPORT_T0 + 1000, path));
+    ASSERT_EQ(3, read_lines(path, lines, 8));
+    ASSERT_STR_EQ("timestamp,\"flow, \"\"raw\"\"\",level", lines[0]);
+
+    /* The importer maps the quoted header back to its tag */
+    snprintf(path, sizeof(path), "%s/import.csv", dir);
+    FILE *fp = fopen(path, "w");
+    ASSERT_NOT_NULL(fp);
+    fprintf(fp, "%s\n", lines[0]);
+    fprintf(fp, "1700000009000,4.5,6.5\n");
+    fclose(fp);
+
+    historian_import_result_t result;
+    ASSERT_EQ(WTC_OK, historian_import(hist, path, 1, &result));
+    ASSERT_EQ(2, (int)result.samples_imported);
+    ASSERT_EQ(0, (int)result.parse_errors);
+
+    snprintf(path, sizeof(path), "%s/export.csv", dir);
+    ASSERT_EQ(WTC_OK, historian_export_csv(hist, ids, 1, EXPORT_T0 + 9000, EXPORT_T0 + 9000, path));
+    ASSERT_EQ(2, read_lines(path, lines, 8));
+    ASSERT_STR_EQ("2023-11-14T22:13:29.000Z,4.5000", lines[1]);
+
+    historian_cleanup(hist);
+    remove_dir(dir);
+}
+
+/* ============== Retention Tests ============== */
+
+static historian_t *create_retention_historian(const char *dir, uint64_t max_bytes)
+{
+    historian_t *hist = NULL;
+    historian_config_t config = {0};
+    config.database_path = dir;
+    config.max_tags = 10;
+    config.buffer_size = 100;
+    config.retention_days = 365;
+    config.max_storage_bytes = max_bytes;
+    if (historian_init(&hist, &config) != WTC_OK) return NULL;
+    return hist;
+}
+
+static bool segment_exists(const char *dir, uint64_t day_ms, int tag_id)
+{
+    char path[256];
+    historian_store_segment_path(dir, day_ms, tag_id, path, sizeof(path));
+    return access(path, F_OK) == 0;
+}
+
+TEST(historian_retention_rollup_and_purge)
+{
+    char dir[64];
+    strcpy(dir, "/tmp/wtc_hist_XXXXXX");
+    ASSERT_NOT_NULL(mkdtemp(dir));
+
+    uint64_t today = time_get_ms() / HISTORIAN_MS_PER_DAY * HISTORIAN_MS_PER_DAY;
+    uint64_t expired = today - 400 * HISTORIAN_MS_PER_DAY;
+    uint64_t recent = today - 2 * HISTORIAN_MS_PER_DAY;
+
+    historian_t *hist = create_retention_historian(dir, 0);
+    ASSERT_NOT_NULL(hist);
+    int tag;
+    historian_add_tag(hist, "rtu-1", 1, "flow", 1000, 0.0f, COMPRESSION_NONE, &tag);
+
+    historian_record_sample(hist, tag, expired, 1.0f, 192);
+    historian_record_sample(hist, tag, expired + 30000, 3.0f, 192);
+    historian_record_sample(hist, tag, expired + 60000, 10.0f, 192);
+    historian_record_sample(hist, tag, expired + 90000, 100.0f, 0);   /* Bad quality */
+    historian_record_sample(hist, tag, recent, 5.0f, 192);
+    historian_record_sample(hist, tag, today, 6.0f, 192);
+
+    ASSERT_EQ(WTC_OK, historian_purge_old_data(hist, 0));
+
+    /* Expired raw day dropped, its rollups kept */
+    ASSERT_EQ(false, segment_exists(dir, expired, tag));
+    ASSERT_EQ(true, segment_exists(dir, recent, tag));
+    ASSERT_EQ(true, segment_exists(dir, today, tag));
+
+    historian_aggregate_t agg[4];
+    int count = 0;
+    ASSERT_EQ(WTC_OK, historian_read_rollup(hist, tag, HISTORIAN_ROLLUP_MINUTE, expired,
+                                            agg, &count, 4));
+    ASSERT_EQ(2, count);
+    ASSERT_TRUE(agg[0].timestamp_ms == expired);
+    ASSERT_TRUE(agg[0].min == 1.0f && agg[0].max == 3.0f && agg[0].avg == 2.0f);
+    ASSERT_EQ(2, agg[0].count);
+    ASSERT_TRUE(agg[1].timestamp_ms == expired + 60000 && agg[1].avg == 10.0f);
+
+    ASSERT_EQ(WTC_OK, historian_read_rollup(hist, tag, HISTORIAN_ROLLUP_HOUR, expired,
+                                            agg, &count, 4));
+    ASSERT_EQ(1, count);
+    ASSERT_EQ(3, agg[0].count);
+    ASSERT_TRUE(agg[0].max == 10.0f);
+
+    /* Completed days are rolled up, the current one is not */
+    ASSERT_EQ(WTC_OK, historian_read_rollup(hist, tag, HISTORIAN_ROLLUP_MINUTE, recent,
+                                            agg, &count, 4));
+    ASSERT_EQ(WTC_ERROR_NOT_FOUND, historian_read_rollup(hist, tag, HISTORIAN_ROLLUP_MINUTE,
+                                                         today, agg, &count, 4));
+
+    historian_stats_t stats;
+    historian_get_stats(hist, &stats);
+    ASSERT_EQ(1, (int)stats.segments_purged);
+    ASSERT_EQ(4 * HISTORIAN_RECORD_SIZE, (int)stats.bytes_reclaimed);
+    historian_cleanup(hist);
+
+    /* Over the high-water mark everything but today's raw data goes */
+    hist = create_retention_historian(dir, 1);
+    ASSERT_NOT_NULL(hist);
+    ASSERT_EQ(WTC_OK, historian_purge_old_data(hist, 0));
+    ASSERT_EQ(false, segment_exists(dir, recent, tag));
+    ASSERT_EQ(true, segment_exists(dir, today, tag));
+    ASSERT_EQ(WTC_ERROR_NOT_FOUND, historian_read_rollup(hist, tag, HISTORIAN_ROLLUP_HOUR,
+                                                         expired, agg, &count, 4));
+    historian_get_stats(hist, &stats);
+    ASSERT_EQ(HISTORIAN_RECORD_SIZE, (int)stats.storage_bytes);
+
+    historian_cleanup(hist);
+    remove_dir(dir);
+}
+
+/* ============== Concurrency Tests ============== */
+
+typedef struct {
+    historian_t *hist;
+    int tag_id;
+    volatile bool stop;
+    volatile int reads;
+    volatile int recorded;
+    int torn;
+    int missing;
+} query_load_t;
+
+/* Every recorded sample has value == timestamp - EXPORT_T0 */
+static void *query_load_thread(void *arg)
+{
+    query_load_t *load = arg;
+    static historian_sample_t samples[2000];
+
+    while (!load->stop) {
+        int count = 0;
+        int recorded = load->recorded;
+        historian_query(load->hist, load->tag_id, 0, UINT64_MAX, samples, &count, 2000);
+        /* Samples recorded before the query started must all come back,
+         * whether they sit in the buffer, the queue or the store */
+        if (count < recorded && count < 2000) {
+            load->missing++;
+        }
+        for (int i = 0; i < count; i++) {
+            if (samples[i].value != (float)(samples[i].timestamp_ms - EXPORT_T0) ||
+                (i > 0 && samples[i].timestamp_ms <= samples[i - 1].timestamp_ms)) {
+                load->torn++;
+            }
+        }
+
+        float value;
+        uint64_t timestamp_ms = 0;
+        if (historian_get_current(load->hist, load->tag_id, &value, &timestamp_ms, NULL) == WTC_OK &&
+            timestamp_ms != 0 && value != (float)(timestamp_ms - EXPORT_T0)) {
+            load->torn++;
+        }
+        load->reads++;
+    }
+    return NULL;
+}
+
+static uint64_t rollup_bytes(const char *dir)
+{
+    historian_store_file_t *files = NULL;
+    int count = 0;
+    uint64_t total = 0;
+    if (historian_store_scan(dir, &files, &count) != WTC_OK) return 0;
+    for (int i = 0; i < count; i++) {
+        if (files[i].kind == HISTORIAN_FILE_ROLLUP) total += files[i].size;
+    }
+    free(files);
+    return total;
+}
+
+TEST(historian_queries_run_beside_collection)
+{
+    char dir[] = "/tmp/wtc_hist_concurrentXXXXXX";
+    ASSERT_NOT_NULL(mkdtemp(dir));
+
+    historian_t *hist = NULL;
+    historian_config_t config = {0};
+    config.max_tags = 4;
+    config.buffer_size = 2000;
+    config.database_path = dir;
+    /* Keep the sweep started with the historian off the 2023 samples */
+    config.retention_days = 36500;
+    ASSERT_EQ(WTC_OK, historian_init(&hist, &config));
+
+    int tag;
+    historian_add_tag(hist, "rtu-1", 1, "flow", 1000, 0.0f, COMPRESSION_NONE, &tag);
+    ASSERT_EQ(WTC_OK, historian_start(hist));
+
+    query_load_t load = { .hist = hist, .tag_id = tag };
+    pthread_t reader;
+    pthread_create(&reader, NULL, query_load_thread, &load);
+
+    /* Flushes seal the buffer and wait on the I/O thread while the
+     * reader keeps copying it */
+    for (int i = 0; i < 5000; i++) {
+        historian_record_sample(hist, tag, EXPORT_T0 + i, (float)i, 192);
+        load.recorded = i + 1;
+        if (i % 1000 == 999) {
+            ASSERT_EQ(WTC_OK, historian_flush(hist));
+        }
+    }
+    historian_record_sample(hist, tag, EXPORT_T0 + 5000, 5000.0f, 192);
+    while (load.reads < 10) {
+        time_sleep_ms(1);
+    }
+    load.stop = true;
+    pthread_join(reader, NULL);
+    ASSERT_EQ(0, load.torn);
+    ASSERT_EQ(0, load.missing);
+
+    historian_stop(hist);
+    historian_stats_t stats;
+    historian_get_stats(hist, &stats);
+    ASSERT_EQ(5001, (int)stats.samples_flushed);
+    ASSERT_EQ(0, (int)stats.samples_in_buffer);
+    /* Less whatever the startup sweep rolled up, depending on when it ran */
+    ASSERT_EQ(5001 * HISTORIAN_RECORD_SIZE, (int)(stats.storage_bytes - rollup_bytes(dir)));
+
+    historian_cursor_t *cursor = NULL;
+    ASSERT_EQ(WTC_OK, historian_cursor_open(&cursor, dir, tag, EXPORT_T0, EXPORT_T0 + 10000));
+    historian_sample_t sample;
+    int on_disk = 0;
+    while (historian_cursor_next(cursor, &sample) == WTC_OK) {
+        ASSERT_EQ(on_disk, (int)sample.value);
+        on_disk++;
+    }
+    historian_cursor_close(cursor);
+    ASSERT_EQ(5001, on_disk);
+
+    historian_cleanup(hist);
+    remove_dir(dir);
+}
+
 /* ============== Quality Code Tests ============== */
 
 TEST(historian_quality_codes)
@@ -219,9 +1125,37 @@ void run_historian_tests(void)
     printf("\nTag Management Tests:\n");
     RUN_TEST(historian_add_tag);
     RUN_TEST(historian_add_multiple_tags);
+    RUN_TEST(historian_find_and_remove_tags);
 
     printf("\nData Recording Tests:\n");
     RUN_TEST(historian_record_sample);
+    RUN_TEST(historian_buffer_spans_chunks_and_drops_oldest);
+    RUN_TEST(historian_process_samples_due_tags);
+
+    printf("\nExport Tests:\n");
+    RUN_TEST(historian_export_raw_union);
+    RUN_TEST(historian_export_carry_forward_and_interpolate);
+    RUN_TEST(historian_export_large_values);
+    RUN_TEST(historian_export_columnar);
+
+    printf("\nSegment Read Tests:\n");
+    RUN_TEST(historian_cursor_maps_segments);
+    RUN_TEST(historian_store_append_keeps_segments_sorted);
+    RUN_TEST(historian_store_append_drops_partial_records);
+    RUN_TEST(historian_query_spans_store_and_buffer);
+
+    printf("\nWrite-Ahead Log Tests:\n");
+    RUN_TEST(historian_wal_recovers_unflushed_samples);
+
+    printf("\nImport Tests:\n");
+    RUN_TEST(historian_import_merges_unordered_csv);
+    RUN_TEST(historian_export_quotes_names_for_import);
+
+    printf("\nRetention Tests:\n");
+    RUN_TEST(historian_retention_rollup_and_purge);
+
+    printf("\nConcurrency Tests:\n");
+    RUN_TEST(historian_queries_run_beside_collection);
 
     printf("\nQuality Code Tests:\n");
     RUN_TEST(historian_quality_codes);
@@ -0,0 +1,249 @@
+/**
+ * Water Treatment Controller - Load Shedding Tests
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/core/load_shedding.h"
+#include "../src/types.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("  Running %s... ", #name); \
+    tests_run++; \
+    test_##name(); \
+    tests_passed++; \
+    printf("PASSED\n"); \
+} while(0)
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        printf("FAILED at line %d: expected %d, got %d\n", __LINE__, (int)(expected), (int)(actual)); \
+        return; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(cond) do { \
+    if (!(cond)) { \
+        printf("FAILED at line %d: condition false\n", __LINE__); \
+        return; \
+    } \
+} while(0)
+
+/* ============== Fixtures ============== */
+
+#define STEP_UP_MS      100
+#define STEP_DOWN_MS    1000
+#define CYCLE_BUDGET_US 1000
+#define CALM_WINDOWS    10      /* Smoothed 3000us back under budget */
+
+/* No health monitor: only the shed level is exercised */
+static load_shedder_t *create_shedder(void)
+{
+    load_shedder_t *shedder = NULL;
+    load_shed_config_t config = {
+        .step_up_ms = STEP_UP_MS,
+        .step_down_ms = STEP_DOWN_MS,
+        .trip_windows = 2,
+    };
+    if (load_shed_init(&shedder, NULL, &config) != WTC_OK) return NULL;
+
+    load_shed_policy_t policy = { .priority = 0, .budget_us = CYCLE_BUDGET_US };
+    load_shed_set_policy(shedder, COMPONENT_PROFINET, &policy);
+    return shedder;
+}
+
+/* Cumulative PROFINET cycle statistics, advanced one window at a time */
+typedef struct {
+    uint64_t count;
+    uint64_t total_us;
+    uint64_t overruns;
+} cycle_totals_t;
+
+static void report_window(load_shedder_t *shedder, cycle_totals_t *totals,
+                          uint64_t cycles, uint64_t avg_us, uint64_t overruns)
+{
+    totals->count += cycles;
+    totals->total_us += cycles * avg_us;
+    totals->overruns += overruns;
+    load_shed_report_cycles(shedder, COMPONENT_PROFINET, totals->count,
+                            totals->total_us, totals->overruns);
+}
+
+static void report_calm(load_shedder_t *shedder, cycle_totals_t *totals)
+{
+    for (int i = 0; i < CALM_WINDOWS; i++) {
+        report_window(shedder, totals, 1000, 200, 0);
+    }
+}
+
+static int shed_level(load_shedder_t *shedder)
+{
+    load_shed_status_t status;
+    load_shed_get_status(shedder, &status);
+    return status.level;
+}
+
+/* ============== Load Shedding Tests ============== */
+
+TEST(load_shed_windows_ignore_history)
+{
+    load_shedder_t *shedder = create_shedder();
+    ASSERT_TRUE(shedder != NULL);
+    cycle_totals_t totals = {0};
+
+    /* A long calm history does not hide slow recent windows */
+    report_window(shedder, &totals, 100000, 200, 0);
+    report_window(shedder, &totals, 1000, 3000, 0);
+    load_shed_evaluate(shedder, 0);
+    ASSERT_EQ(0, shed_level(shedder));
+    report_window(shedder, &totals, 1000, 3000, 0);
+    load_shed_evaluate(shedder, 0);
+    ASSERT_EQ(1, shed_level(shedder));
+
+    /* ...and the slow windows do not linger in the average once calm */
+    report_calm(shedder, &totals);
+    load_shed_status_t status;
+    load_shed_get_status(shedder, &status);
+    ASSERT_TRUE(status.latency_us[COMPONENT_PROFINET] < CYCLE_BUDGET_US);
+    load_shed_evaluate(shedder, 10);
+    load_shed_get_status(shedder, &status);
+    ASSERT_TRUE(!status.overloaded);
+
+    load_shed_cleanup(shedder);
+}
+
+TEST(load_shed_overruns_trip_overload)
+{
+    load_shedder_t *shedder = create_shedder();
+    ASSERT_TRUE(shedder != NULL);
+    cycle_totals_t totals = {0};
+
+    /* Within budget on average, but overrunning every window */
+    report_window(shedder, &totals, 1000, 200, 0);
+    report_window(shedder, &totals, 1000, 200, 3);
+    report_window(shedder, &totals, 1000, 200, 1);
+    load_shed_evaluate(shedder, 0);
+    ASSERT_EQ(1, shed_level(shedder));
+
+    load_shed_cleanup(shedder);
+}
+
+TEST(load_shed_steps_up_and_down)
+{
+    load_shedder_t *shedder = create_shedder();
+    ASSERT_TRUE(shedder != NULL);
+    cycle_totals_t totals = {0};
+
+    report_window(shedder, &totals, 1000, 200, 0);
+    report_window(shedder, &totals, 1000, 3000, 0);
+    report_window(shedder, &totals, 1000, 3000, 0);
+
+    /* First step at once, later ones no faster than step_up_ms */
+    load_shed_evaluate(shedder, 1000);
+    ASSERT_EQ(1, shed_level(shedder));
+    ASSERT_EQ(2, (int)load_shed_divisor(shedder, COMPONENT_HISTORIAN));
+    ASSERT_EQ(1, (int)load_shed_divisor(shedder, COMPONENT_IPC_SERVER));
+    load_shed_evaluate(shedder, 1000 + STEP_UP_MS - 1);
+    ASSERT_EQ(1, shed_level(shedder));
+    load_shed_evaluate(shedder, 1000 + STEP_UP_MS);
+    ASSERT_EQ(2, shed_level(shedder));
+    ASSERT_EQ(4, (int)load_shed_divisor(shedder, COMPONENT_HISTORIAN));
+    ASSERT_EQ(2, (int)load_shed_divisor(shedder, COMPONENT_IPC_SERVER));
+
+    /* The database stops at its first step; protected work never sheds */
+    ASSERT_TRUE(!load_shed_allow(shedder, COMPONENT_DATABASE));
+    ASSERT_TRUE(load_shed_allow(shedder, COMPONENT_PROFINET));
+    ASSERT_EQ(1, (int)load_shed_divisor(shedder, COMPONENT_CONTROL_ENGINE));
+
+    /* Back within budget: one step down per step_down_ms */
+    report_calm(shedder, &totals);
+    uint64_t calm = 1000 + STEP_UP_MS;
+    load_shed_evaluate(shedder, calm + STEP_DOWN_MS - 1);
+    ASSERT_EQ(2, shed_level(shedder));
+    load_shed_evaluate(shedder, calm + STEP_DOWN_MS);
+    ASSERT_EQ(1, shed_level(shedder));
+    ASSERT_TRUE(load_shed_allow(shedder, COMPONENT_DATABASE));
+    load_shed_evaluate(shedder, calm + 2 * STEP_DOWN_MS - 1);
+    ASSERT_EQ(1, shed_level(shedder));
+    load_shed_evaluate(shedder, calm + 2 * STEP_DOWN_MS);
+    ASSERT_EQ(0, shed_level(shedder));
+    ASSERT_EQ(1, (int)load_shed_divisor(shedder, COMPONENT_HISTORIAN));
+
+    load_shed_status_t status;
+    load_shed_get_status(shedder, &status);
+    ASSERT_EQ(4, (int)status.level_changes);
+
+    load_shed_cleanup(shedder);
+}
+
+static int step_calls;
+static int last_step[COMPONENT_COUNT];
+
+static void on_step(component_id_t id, int step, void *ctx)
+{
+    (void)ctx;
+    step_calls++;
+    last_step[id] = step;
+}
+
+TEST(load_shed_callback_and_counter_reset)
+{
+    load_shedder_t *shedder = create_shedder();
+    ASSERT_TRUE(shedder != NULL);
+    step_calls = 0;
+    memset(last_step, 0, sizeof(last_step));
+    load_shed_set_callback(shedder, on_step, NULL);
+    cycle_totals_t totals = {0};
+
+    report_window(shedder, &totals, 1000, 200, 0);
+    report_window(shedder, &totals, 1000, 3000, 0);
+    report_window(shedder, &totals, 1000, 3000, 0);
+    load_shed_evaluate(shedder, 0);
+    ASSERT_EQ(1, step_calls);
+    ASSERT_EQ(1, last_step[COMPONENT_HISTORIAN]);
+
+    /* A restarted component reports smaller totals: no sample from that */
+    load_shed_status_t before, after;
+    load_shed_get_status(shedder, &before);
+    load_shed_report_cycles(shedder, COMPONENT_PROFINET, 10, 10 * 200, 0);
+    load_shed_get_status(shedder, &after);
+    ASSERT_EQ(before.latency_us[COMPONENT_PROFINET], after.latency_us[COMPONENT_PROFINET]);
+
+    /* Nothing changes while the level holds */
+    load_shed_evaluate(shedder, STEP_UP_MS / 2);
+    ASSERT_EQ(1, step_calls);
+
+    load_shed_cleanup(shedder);
+}
+
+/* ============== Test Runner ============== */
+
+static void run_load_shedding_tests(void)
+{
+    printf("\n=== Load Shedding Tests ===\n\n");
+
+    printf("Shed Level Tests:\n");
+    RUN_TEST(load_shed_windows_ignore_history);
+    RUN_TEST(load_shed_overruns_trip_overload);
+    RUN_TEST(load_shed_steps_up_and_down);
+    RUN_TEST(load_shed_callback_and_counter_reset);
+
+    printf("\n=== Results: %d/%d tests passed ===\n\n", tests_passed, tests_run);
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    run_load_shedding_tests();
+    return (tests_passed == tests_run) ? 0 : 1;
+}
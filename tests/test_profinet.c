@@ -8,11 +8,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include "../src/profinet/profinet_controller.h"
 #include "../src/profinet/profinet_identity.h"
 #include "../src/profinet/dcp_discovery.h"
 #include "../src/profinet/ar_manager.h"
 #include "../src/profinet/profinet_frame.h"
+#include "../src/profinet/profinet_rpc.h"
+#include "../src/profinet/gsdml_modules.h"
 #include "../src/utils/crc.h"
 
 /* Test counters */
@@ -174,6 +182,201 @@ TEST(ar_manager_get_ar_null)
     assert(ar == NULL);
 }
 
+/* ============== RPC Device Side Tests ============== */
+
+static void add_expected(connect_request_params_t *params, uint16_t slot, uint16_t subslot,
+                         uint32_t module_ident, uint32_t submodule_ident,
+                         uint16_t data_length, bool is_input)
+{
+    int n = params->expected_count++;
+    params->expected_config[n].slot = slot;
+    params->expected_config[n].subslot = subslot;
+    params->expected_config[n].module_ident = module_ident;
+    params->expected_config[n].submodule_ident = submodule_ident;
+    params->expected_config[n].data_length = data_length;
+    params->expected_config[n].is_input = is_input;
+}
+
+TEST(rpc_connect_round_trip)
+{
+    /* Controller builds Connect, device parses it and answers, controller
+     * parses the answer: the emulator's view must match the controller's. */
+    static connect_request_params_t params;
+    static incoming_connect_request_t incoming;
+    static connect_response_t answer;
+    static connect_response_t parsed;
+    uint8_t buffer[RPC_MAX_PDU_SIZE];
+    size_t len = sizeof(buffer);
+
+    rpc_context_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.socket_fd = -1;
+
+    memset(&params, 0, sizeof(params));
+    rpc_generate_uuid(params.ar_uuid);
+    params.session_key = 7;
+    params.ar_type = AR_TYPE_IOCAR;
+    strcpy(params.station_name, PN_STATION_NAME);
+    params.iocr_count = 2;
+    params.iocr[0].type = IOCR_TYPE_INPUT;
+    params.iocr[0].reference = 1;
+    params.iocr[0].frame_id = 0xC001;
+    params.iocr[0].data_length = 40;
+    params.iocr[0].send_clock_factor = 64;
+    params.iocr[0].reduction_ratio = 128;
+    params.iocr[0].watchdog_factor = 10;
+    params.iocr[1] = params.iocr[0];
+    params.iocr[1].type = IOCR_TYPE_OUTPUT;
+    params.iocr[1].reference = 2;
+    params.iocr[1].frame_id = 0xFFFF;
+    add_expected(&params, 0, 0x0001, GSDML_MOD_DAP, GSDML_SUBMOD_DAP, 0, true);
+    add_expected(&params, 0, 0x8000, GSDML_MOD_DAP, GSDML_SUBMOD_INTERFACE, 0, true);
+    add_expected(&params, 0, 0x8001, GSDML_MOD_DAP, GSDML_SUBMOD_PORT, 0, true);
+    add_expected(&params, 1, 1, GSDML_MOD_PH, GSDML_SUBMOD_PH, GSDML_INPUT_DATA_SIZE, true);
+    add_expected(&params, 2, 1, GSDML_MOD_PUMP, GSDML_SUBMOD_PUMP, GSDML_OUTPUT_DATA_SIZE, false);
+    params.max_alarm_data_length = 200;
+
+    ASSERT_EQ(WTC_OK, rpc_build_connect_request(&ctx, &params, buffer, &len));
+    ASSERT_EQ(WTC_OK, rpc_parse_connect_request(buffer, len, &incoming));
+
+    ASSERT_EQ(0, memcmp(params.ar_uuid, incoming.params.ar_uuid, 16));
+    ASSERT_EQ(7, incoming.params.session_key);
+    ASSERT_STR_EQ(PN_STATION_NAME, incoming.params.station_name);
+    ASSERT_EQ(2, incoming.params.iocr_count);
+    ASSERT_EQ(IOCR_TYPE_INPUT, incoming.params.iocr[0].type);
+    ASSERT_EQ(40, incoming.params.iocr[0].data_length);
+    ASSERT_EQ(128, incoming.params.iocr[0].reduction_ratio);
+    ASSERT_EQ(5, incoming.params.expected_count);
+    ASSERT_EQ(GSDML_SUBMOD_PH, incoming.params.expected_config[3].submodule_ident);
+    ASSERT_EQ(GSDML_INPUT_DATA_SIZE, incoming.params.expected_config[3].data_length);
+    ASSERT_TRUE(!incoming.params.expected_config[4].is_input);
+
+    /* Input CR carries the DAP and pH data plus the pump's IOCS */
+    ASSERT_EQ(4, incoming.layout[0].iodata_count);
+    ASSERT_EQ(1, incoming.layout[0].iocs_count);
+    ASSERT_EQ(2, incoming.layout[0].iocs[0].slot);
+
+    memset(&answer, 0, sizeof(answer));
+    answer.success = true;
+    memcpy(answer.device_mac, "\x02\x57\x54\x00\x00\x01", 6);
+    answer.frame_id_count = 2;
+    answer.frame_ids[0].assigned = 0xC003;
+    answer.frame_ids[1].assigned = 0xC004;
+    answer.device_alarm_ref = 3;
+
+    len = sizeof(buffer);
+    ASSERT_EQ(WTC_OK, rpc_build_connect_response(&incoming, &answer, buffer, &len));
+    ASSERT_EQ(WTC_OK, rpc_parse_connect_response(buffer, len, &parsed));
+
+    ASSERT_TRUE(parsed.success);
+    ASSERT_EQ(0, memcmp(params.ar_uuid, parsed.ar_uuid, 16));
+    ASSERT_EQ(0, memcmp(answer.device_mac, parsed.device_mac, 6));
+    ASSERT_EQ(2, parsed.frame_id_count);
+    ASSERT_EQ(0xC003, parsed.frame_ids[0].assigned);
+    ASSERT_EQ(0xC004, parsed.frame_ids[1].assigned);
+    ASSERT_TRUE(!parsed.has_diff);
+
+    /* A ModuleDiffBlock hands the real configuration back to the controller */
+    answer.has_diff = true;
+    answer.discovered_count = 2;
+    answer.discovered_modules[0].slot = 1;
+    answer.discovered_modules[0].subslot = 1;
+    answer.discovered_modules[0].module_ident = GSDML_MOD_TDS;
+    answer.discovered_modules[0].submodule_ident = GSDML_SUBMOD_TDS;
+    answer.discovered_modules[1].slot = 2;
+    answer.discovered_modules[1].subslot = 1;
+    answer.discovered_modules[1].module_ident = GSDML_MOD_VALVE;
+    answer.discovered_modules[1].submodule_ident = GSDML_SUBMOD_VALVE;
+
+    len = sizeof(buffer);
+    ASSERT_EQ(WTC_OK, rpc_build_connect_response(&incoming, &answer, buffer, &len));
+    ASSERT_EQ(WTC_OK, rpc_parse_connect_response(buffer, len, &parsed));
+    ASSERT_TRUE(parsed.has_diff);
+    ASSERT_EQ(2, parsed.discovered_count);
+    ASSERT_EQ(GSDML_SUBMOD_VALVE, parsed.discovered_modules[1].submodule_ident);
+}
+
+/* ============== Record Exchange Tests ============== */
+
+#define RECORD_CALLERS 4
+#define LOOPBACK_IP 0x7F000001u
+
+typedef struct {
+    int id;
+    wtc_result_t result;
+    bool own_response;
+} record_caller_t;
+
+static void *record_caller_thread(void *arg)
+{
+    record_caller_t *caller = arg;
+    uint8_t request[32];
+    uint8_t response[64];
+    size_t resp_len = sizeof(response);
+
+    memset(request, 0, sizeof(request));
+    snprintf((char *)request, sizeof(request), "record-request-%d", caller->id);
+    caller->result = rpc_record_exchange("", LOOPBACK_IP, request, sizeof(request),
+                                         response, &resp_len, 2000);
+    caller->own_response = caller->result == WTC_OK && resp_len == sizeof(request) &&
+                           memcmp(request, response, sizeof(request)) == 0;
+    return NULL;
+}
+
+TEST(rpc_record_exchange_keeps_responses_apart)
+{
+    /* A device that collects every request before answering, last first:
+     * a caller sharing a socket with another would take its response */
+    int device = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_TRUE(device >= 0);
+    int on = 1;
+    setsockopt(device, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PNIO_RPC_PORT);
+    addr.sin_addr.s_addr = htonl(LOOPBACK_IP);
+    if (bind(device, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(device);
+        ASSERT_TRUE(false);
+    }
+
+    record_caller_t callers[RECORD_CALLERS];
+    pthread_t threads[RECORD_CALLERS];
+    for (int i = 0; i < RECORD_CALLERS; i++) {
+        callers[i].id = i;
+        pthread_create(&threads[i], NULL, record_caller_thread, &callers[i]);
+    }
+
+    uint8_t requests[RECORD_CALLERS][32];
+    struct sockaddr_in from[RECORD_CALLERS];
+    int received = 0;
+    while (received < RECORD_CALLERS) {
+        struct pollfd pfd = { .fd = device, .events = POLLIN };
+        if (poll(&pfd, 1, 1000) <= 0) break;
+        socklen_t from_len = sizeof(from[received]);
+        if (recvfrom(device, requests[received], sizeof(requests[received]), 0,
+                     (struct sockaddr *)&from[received], &from_len) == sizeof(requests[received])) {
+            received++;
+        }
+    }
+    for (int i = received - 1; i >= 0; i--) {
+        sendto(device, requests[i], sizeof(requests[i]), 0,
+               (struct sockaddr *)&from[i], sizeof(from[i]));
+    }
+
+    for (int i = 0; i < RECORD_CALLERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    close(device);
+
+    ASSERT_EQ(RECORD_CALLERS, received);
+    for (int i = 0; i < RECORD_CALLERS; i++) {
+        ASSERT_EQ(WTC_OK, callers[i].result);
+        ASSERT_TRUE(callers[i].own_response);
+    }
+}
+
 /* ============== Test Runner ============== */
 
 void run_profinet_tests(void)
@@ -200,6 +403,12 @@ void run_profinet_tests(void)
     RUN_TEST(ar_manager_init_null);
     RUN_TEST(ar_manager_get_ar_null);
 
+    printf("\nRPC Device Side Tests:\n");
+    RUN_TEST(rpc_connect_round_trip);
+
+    printf("\nRecord Exchange Tests:\n");
+    RUN_TEST(rpc_record_exchange_keeps_responses_apart);
+
     printf("\n=== Results: %d/%d tests passed ===\n\n", tests_passed, tests_run);
 }
 
@@ -10,6 +10,7 @@
 #include <math.h>
 #include <assert.h>
 #include "../src/registry/rtu_registry.h"
+#include "../src/utils/arena.h"
 #include "../src/types.h"
 
 /* Test counters */
@@ -254,6 +255,45 @@ TEST(registry_update_sensor)
     rtu_registry_cleanup(reg);
 }
 
+TEST(registry_update_sensors_bulk)
+{
+    rtu_registry_t *reg = create_test_registry();
+    ASSERT_NOT_NULL(reg);
+
+    rtu_registry_add_device(reg, "rtu-tank-1", "192.168.1.100", NULL, 0);
+
+    int slots[3] = { 1, 2, 5 };
+    float values[3] = { 7.2f, 3.5f, 55.0f };
+    data_quality_t quality[3] = { QUALITY_GOOD, QUALITY_UNCERTAIN, QUALITY_GOOD };
+
+    wtc_result_t result = rtu_registry_update_sensors(reg, "rtu-tank-1", slots, values,
+                                                      quality, 3, IOPS_GOOD);
+    ASSERT_EQ(WTC_OK, result);
+
+    for (int i = 0; i < 3; i++) {
+        sensor_data_t read_data = {0};
+        ASSERT_EQ(WTC_OK, rtu_registry_get_sensor(reg, "rtu-tank-1", slots[i], &read_data));
+        ASSERT_FLOAT_EQ(values[i], read_data.value, 0.001f);
+        ASSERT_EQ(quality[i], read_data.quality);
+    }
+
+    /* Out-of-range slots are skipped, the rest still land */
+    int bad_slots[2] = { 3, 100000 };
+    float bad_values[2] = { 1.0f, 2.0f };
+    result = rtu_registry_update_sensors(reg, "rtu-tank-1", bad_slots, bad_values,
+                                         quality, 2, IOPS_GOOD);
+    ASSERT_EQ(WTC_ERROR_INVALID_PARAM, result);
+
+    sensor_data_t read_data = {0};
+    rtu_registry_get_sensor(reg, "rtu-tank-1", 3, &read_data);
+    ASSERT_FLOAT_EQ(1.0f, read_data.value, 0.001f);
+
+    ASSERT_EQ(WTC_ERROR_NOT_FOUND,
+              rtu_registry_update_sensors(reg, "missing", slots, values, quality, 3, IOPS_GOOD));
+
+    rtu_registry_cleanup(reg);
+}
+
 /* ============== Actuator Control Tests ============== */
 
 TEST(registry_update_actuator)
@@ -284,6 +324,59 @@ TEST(registry_update_actuator)
     rtu_registry_cleanup(reg);
 }
 
+static int actuator_updates = 0;
+static actuator_state_t last_actuator_update;
+
+static void count_actuator_update(const char *station_name, int slot,
+                                  const actuator_state_t *state, void *ctx) {
+    (void)station_name;
+    (void)slot;
+    (void)ctx;
+    actuator_updates++;
+    last_actuator_update = *state;
+}
+
+TEST(registry_actuator_traced)
+{
+    rtu_registry_t *reg = NULL;
+    registry_config_t config = {0};
+    config.max_devices = 16;
+    config.on_actuator_updated = count_actuator_update;
+    ASSERT_EQ(WTC_OK, rtu_registry_init(&reg, &config));
+
+    rtu_registry_add_device(reg, "rtu-tank-1", "192.168.1.100", NULL, 0);
+    actuator_updates = 0;
+
+    actuator_output_t output = {0};
+    output.command = ACTUATOR_CMD_PWM;
+    output.pwm_duty = 40;
+    ASSERT_EQ(WTC_OK, rtu_registry_update_actuator_traced(reg, "rtu-tank-1", 2, &output,
+                                                          12345, 0x01000007));
+    ASSERT_EQ(1, actuator_updates);
+    ASSERT_EQ(12345, (int)last_actuator_update.source_time_us);
+    ASSERT_EQ(0x01000007, (int)last_actuator_update.trace_id);
+
+    /* An untraced write changes the output but keeps the last trace */
+    output.pwm_duty = 60;
+    ASSERT_EQ(WTC_OK, rtu_registry_update_actuator(reg, "rtu-tank-1", 2, &output));
+    ASSERT_EQ(2, actuator_updates);
+
+    actuator_state_t state = {0};
+    ASSERT_EQ(WTC_OK, rtu_registry_get_actuator(reg, "rtu-tank-1", 2, &state));
+    ASSERT_EQ(60, state.output.pwm_duty);
+    ASSERT_EQ(12345, (int)state.source_time_us);
+    ASSERT_EQ(0x01000007, (int)state.trace_id);
+
+    /* Sensors carry their receive time */
+    ASSERT_EQ(WTC_OK, rtu_registry_update_sensor_at(reg, "rtu-tank-1", 1, 7.0f,
+                                                    IOPS_GOOD, QUALITY_GOOD, 777));
+    sensor_data_t sensor = {0};
+    ASSERT_EQ(WTC_OK, rtu_registry_get_sensor(reg, "rtu-tank-1", 1, &sensor));
+    ASSERT_EQ(777, (int)sensor.rx_time_us);
+
+    rtu_registry_cleanup(reg);
+}
+
 TEST(registry_actuator_pwm)
 {
     rtu_registry_t *reg = create_test_registry();
@@ -363,6 +456,64 @@ TEST(registry_get_statistics)
     rtu_registry_cleanup(reg);
 }
 
+/* ============== Arena Copy Tests ============== */
+
+TEST(registry_list_devices_arena)
+{
+    rtu_registry_t *reg = create_test_registry();
+    ASSERT_NOT_NULL(reg);
+
+    rtu_registry_add_device(reg, "rtu-tank-1", "192.168.1.100", NULL, 0);
+    rtu_registry_add_device(reg, "rtu-tank-2", "192.168.1.101", NULL, 0);
+
+    slot_config_t slot = {0};
+    slot.slot = 1;
+    slot.subslot = 1;
+    slot.type = SLOT_TYPE_SENSOR;
+    slot.measurement_type = MEASUREMENT_PH;
+    slot.enabled = true;
+    rtu_registry_set_device_config(reg, "rtu-tank-1", &slot, 1);
+    rtu_registry_update_sensor(reg, "rtu-tank-1", 1, 7.0f, IOPS_GOOD, QUALITY_GOOD);
+
+    arena_t *arena = NULL;
+    ASSERT_EQ(WTC_OK, arena_init(&arena, 0));
+
+    /* After the first pass, repeated snapshots reuse the same arena memory */
+    arena_stats_t stats;
+    uint64_t chunk_allocs = 0;
+    for (int pass = 0; pass < 3; pass++) {
+        rtu_device_t *devices = NULL;
+        int count = 0;
+        wtc_result_t result = rtu_registry_list_devices_arena(reg, arena, &devices,
+                                                              &count, WTC_MAX_RTUS);
+        ASSERT_EQ(WTC_OK, result);
+        ASSERT_EQ(2, count);
+        ASSERT_NOT_NULL(devices);
+
+        rtu_device_t *dev = &devices[0];
+        if (strcmp(dev->station_name, "rtu-tank-1") != 0) {
+            dev = &devices[1];
+        }
+        ASSERT_STR_EQ("rtu-tank-1", dev->station_name);
+        ASSERT_EQ(1, dev->slot_count);
+        ASSERT_NOT_NULL(dev->slots);
+        ASSERT_NOT_NULL(dev->sensors);
+        ASSERT_FLOAT_EQ(7.0f, dev->sensors[1].value, 0.001f);
+
+        arena_reset(arena);
+        arena_get_stats(arena, &stats);
+        if (pass == 0) {
+            chunk_allocs = stats.chunk_allocs;
+        }
+    }
+
+    ASSERT_EQ(3, (int)stats.resets);
+    ASSERT_EQ((int)chunk_allocs, (int)stats.chunk_allocs);
+
+    arena_cleanup(arena);
+    rtu_registry_cleanup(reg);
+}
+
 /* ============== Test Runner ============== */
 
 void run_registry_tests(void)
@@ -386,10 +537,12 @@ void run_registry_tests(void)
 
     printf("\nSensor Data Tests:\n");
     RUN_TEST(registry_update_sensor);
+    RUN_TEST(registry_update_sensors_bulk);
 
     printf("\nActuator Control Tests:\n");
     RUN_TEST(registry_update_actuator);
     RUN_TEST(registry_actuator_pwm);
+    RUN_TEST(registry_actuator_traced);
 
     printf("\nConnection State Tests:\n");
     RUN_TEST(registry_connection_states);
@@ -398,6 +551,9 @@ void run_registry_tests(void)
     printf("\nStatistics Tests:\n");
     RUN_TEST(registry_get_statistics);
 
+    printf("\nArena Copy Tests:\n");
+    RUN_TEST(registry_list_devices_arena);
+
     printf("\n=== Results: %d/%d tests passed ===\n\n", tests_passed, tests_run);
 }
 
@@ -0,0 +1,511 @@
+/**
+ * Water Treatment Controller - Ring Buffer Tests
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "../src/utils/ring.h"
+#include "../src/utils/time_utils.h"
+#include "../src/types.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("  Running %s... ", #name); \
+    tests_run++; \
+    test_##name(); \
+    tests_passed++; \
+    printf("PASSED\n"); \
+} while(0)
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        printf("FAILED at line %d: expected %d, got %d\n", __LINE__, (int)(expected), (int)(actual)); \
+        return; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(cond) do { \
+    if (!(cond)) { \
+        printf("FAILED at line %d: condition false\n", __LINE__); \
+        return; \
+    } \
+} while(0)
+
+#define THREADED_COUNT   100000
+#define MPSC_PRODUCERS   4
+#define MPSC_PER_PRODUCER 20000
+
+/* ============== SPSC Tests ============== */
+
+TEST(spsc_full_and_empty)
+{
+    spsc_ring_t ring;
+    ASSERT_EQ(WTC_ERROR_INVALID_PARAM, spsc_ring_init(&ring, 0, 4, false));
+    ASSERT_EQ(WTC_ERROR_INVALID_PARAM, spsc_ring_init(&ring, sizeof(uint32_t), 0, false));
+    ASSERT_EQ(WTC_OK, spsc_ring_init(&ring, sizeof(uint32_t), 5, false));
+    ASSERT_EQ(8, spsc_ring_capacity(&ring));
+
+    uint32_t value = 0;
+    ASSERT_EQ(WTC_ERROR_EMPTY, spsc_ring_pop(&ring, &value));
+    ASSERT_EQ(0, spsc_ring_pop_batch(&ring, &value, 1));
+
+    for (uint32_t i = 0; i < 8; i++) {
+        ASSERT_EQ(WTC_OK, spsc_ring_push(&ring, &i));
+    }
+    ASSERT_EQ(8, spsc_ring_count(&ring));
+
+    /* A full ring refuses the push rather than dropping the oldest */
+    value = 99;
+    ASSERT_EQ(WTC_ERROR_FULL, spsc_ring_push(&ring, &value));
+    ASSERT_EQ(0, spsc_ring_push_batch(&ring, &value, 1));
+    ASSERT_EQ(WTC_OK, spsc_ring_pop(&ring, &value));
+    ASSERT_EQ(0, value);
+
+    /* Not a blocking ring */
+    ASSERT_EQ(WTC_ERROR_INVALID_PARAM, spsc_ring_pop_wait(&ring, &value, 0));
+
+    spsc_ring_free(&ring);
+}
+
+TEST(spsc_batches_wrap_around)
+{
+    spsc_ring_t ring;
+    ASSERT_EQ(WTC_OK, spsc_ring_init(&ring, sizeof(uint32_t), 8, false));
+
+    /* Walk the positions round the ring several times with batches that
+     * straddle the end of the buffer */
+    uint32_t in[8];
+    uint32_t out[8];
+    uint32_t next_in = 0;
+    uint32_t next_out = 0;
+    for (int lap = 0; lap < 20; lap++) {
+        size_t n = (size_t)(lap % 6) + 2;
+        for (size_t i = 0; i < n; i++) {
+            in[i] = next_in + (uint32_t)i;
+        }
+        ASSERT_EQ(n, spsc_ring_push_batch(&ring, in, n));
+        next_in += (uint32_t)n;
+
+        /* Leave one element behind every other lap so tail drifts too */
+        size_t take = (lap % 2) ? spsc_ring_count(&ring) : n - 1;
+        ASSERT_EQ(take, spsc_ring_pop_batch(&ring, out, take));
+        for (size_t i = 0; i < take; i++) {
+            ASSERT_EQ(next_out, out[i]);
+            next_out++;
+        }
+    }
+
+    /* Partial batch when only part fits */
+    while (spsc_ring_count(&ring) < 5) {
+        ASSERT_EQ(WTC_OK, spsc_ring_push(&ring, &next_in));
+        next_in++;
+    }
+    for (size_t i = 0; i < 8; i++) {
+        in[i] = next_in + (uint32_t)i;
+    }
+    ASSERT_EQ(3, spsc_ring_push_batch(&ring, in, 8));
+    next_in += 3;
+    ASSERT_EQ(8, spsc_ring_pop_batch(&ring, out, 8));
+    for (size_t i = 0; i < 8; i++) {
+        ASSERT_EQ(next_out, out[i]);
+        next_out++;
+    }
+    ASSERT_EQ(next_in, next_out);
+
+    spsc_ring_free(&ring);
+}
+
+typedef struct {
+    spsc_ring_t *ring;
+    bool blocking;
+} spsc_producer_t;
+
+static void *spsc_producer(void *arg) {
+    spsc_producer_t *p = arg;
+    uint32_t batch[16];
+    uint32_t next = 0;
+    int rounds = 0;
+    while (next < THREADED_COUNT) {
+        size_t n = (next % 5 == 0) ? 1 : (size_t)(next % 16) + 1;
+        if (n > THREADED_COUNT - next) n = THREADED_COUNT - next;
+        for (size_t i = 0; i < n; i++) {
+            batch[i] = next + (uint32_t)i;
+        }
+
+        size_t pushed;
+        if (n == 1) {
+            pushed = spsc_ring_push(p->ring, batch) == WTC_OK ? 1 : 0;
+        } else {
+            pushed = spsc_ring_push_batch(p->ring, batch, n);
+        }
+        next += (uint32_t)pushed;
+        if (pushed < n) {
+            sched_yield();
+        }
+        /* Let a blocking consumer fall asleep now and then */
+        if (p->blocking && ++rounds % 512 == 0) {
+            time_sleep_ms(1);
+        }
+    }
+    return NULL;
+}
+
+TEST(spsc_threads_keep_order)
+{
+    spsc_ring_t ring;
+    ASSERT_EQ(WTC_OK, spsc_ring_init(&ring, sizeof(uint32_t), 64, false));
+
+    spsc_producer_t producer = { &ring, false };
+    pthread_t thread;
+    pthread_create(&thread, NULL, spsc_producer, &producer);
+
+    uint32_t out[32];
+    uint32_t expected = 0;
+    int disorder = 0;
+    while (expected < THREADED_COUNT) {
+        size_t n = spsc_ring_pop_batch(&ring, out, (expected % 3) ? 32 : 1);
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (out[i] != expected) disorder++;
+            expected++;
+        }
+    }
+
+    pthread_join(thread, NULL);
+    ASSERT_EQ(0, disorder);
+    ASSERT_EQ(0, spsc_ring_count(&ring));
+    spsc_ring_free(&ring);
+}
+
+/* ============== MPSC Tests ============== */
+
+/* A batch's elements are pushed as one claim, so after the first one
+ * the consumer must see the rest straight after it */
+typedef struct {
+    uint16_t producer;
+    uint16_t batch_start;
+    uint32_t seq;
+} mpsc_item_t;
+
+TEST(mpsc_full_empty_and_wrap)
+{
+    mpsc_ring_t ring;
+    ASSERT_EQ(WTC_OK, mpsc_ring_init(&ring, sizeof(uint32_t), 3, false));
+    ASSERT_EQ(4, mpsc_ring_capacity(&ring));
+
+    uint32_t value = 0;
+    uint32_t out[8];
+    ASSERT_EQ(WTC_ERROR_EMPTY, mpsc_ring_pop(&ring, &value));
+    ASSERT_EQ(0, mpsc_ring_pop_batch(&ring, out, 8));
+
+    uint32_t next_in = 0;
+    uint32_t next_out = 0;
+    for (int lap = 0; lap < 10; lap++) {
+        /* Fill with a single push and a batch, then check it is full */
+        ASSERT_EQ(WTC_OK, mpsc_ring_push(&ring, &next_in));
+        next_in++;
+        uint32_t in[4] = { next_in, next_in + 1, next_in + 2, next_in + 3 };
+        ASSERT_EQ(3, mpsc_ring_push_batch(&ring, in, 4));
+        next_in += 3;
+        ASSERT_EQ(4, mpsc_ring_count(&ring));
+        ASSERT_EQ(WTC_ERROR_FULL, mpsc_ring_push(&ring, &value));
+        ASSERT_EQ(0, mpsc_ring_push_batch(&ring, in, 1));
+
+        /* Drain by ones and batches, shifting the start each lap */
+        size_t singles = (size_t)(lap % 4);
+        for (size_t i = 0; i < singles; i++) {
+            ASSERT_EQ(WTC_OK, mpsc_ring_pop(&ring, &value));
+            ASSERT_EQ(next_out, value);
+            next_out++;
+        }
+        size_t rest = 4 - singles;
+        ASSERT_EQ(rest, mpsc_ring_pop_batch(&ring, out, 8));
+        for (size_t i = 0; i < rest; i++) {
+            ASSERT_EQ(next_out, out[i]);
+            next_out++;
+        }
+        ASSERT_EQ(0, mpsc_ring_count(&ring));
+
+        /* Offset the next lap's start position by one */
+        ASSERT_EQ(WTC_OK, mpsc_ring_push(&ring, &next_in));
+        next_in++;
+        ASSERT_EQ(WTC_OK, mpsc_ring_pop(&ring, &value));
+        ASSERT_EQ(next_out, value);
+        next_out++;
+    }
+
+    ASSERT_EQ(WTC_ERROR_INVALID_PARAM, mpsc_ring_pop_wait(&ring, &value, 0));
+    mpsc_ring_free(&ring);
+}
+
+typedef struct {
+    mpsc_ring_t *ring;
+    uint16_t producer;
+} mpsc_producer_t;
+
+static void *mpsc_producer(void *arg) {
+    mpsc_producer_t *p = arg;
+    mpsc_item_t batch[8];
+    uint32_t next = 0;
+    unsigned int rng = p->producer * 2654435761u + 1;
+
+    while (next < MPSC_PER_PRODUCER) {
+        rng = rng * 1103515245u + 12345u;
+        size_t n = (rng >> 16) % 8 + 1;
+        if (n > MPSC_PER_PRODUCER - next) n = MPSC_PER_PRODUCER - next;
+        for (size_t i = 0; i < n; i++) {
+            batch[i].producer = p->producer;
+            batch[i].batch_start = i == 0;
+            batch[i].seq = next + (uint32_t)i;
+        }
+
+        if (n == 1) {
+            while (mpsc_ring_push(p->ring, batch) != WTC_OK) {
+                sched_yield();
+            }
+        } else {
+            /* A partial claim leaves the rest as a new batch */
+            size_t off = 0;
+            while (off < n) {
+                size_t pushed = mpsc_ring_push_batch(p->ring, batch + off, n - off);
+                off += pushed;
+                if (off < n) {
+                    batch[off].batch_start = 1;
+                    if (pushed == 0) sched_yield();
+                }
+            }
+        }
+        next += (uint32_t)n;
+    }
+    return NULL;
+}
+
+TEST(mpsc_mixed_pushes_keep_order_and_batches)
+{
+    mpsc_ring_t ring;
+    ASSERT_EQ(WTC_OK, mpsc_ring_init(&ring, sizeof(mpsc_item_t), 32, false));
+
+    mpsc_producer_t producers[MPSC_PRODUCERS];
+    pthread_t threads[MPSC_PRODUCERS];
+    for (int i = 0; i < MPSC_PRODUCERS; i++) {
+        producers[i].ring = &ring;
+        producers[i].producer = (uint16_t)i;
+        pthread_create(&threads[i], NULL, mpsc_producer, &producers[i]);
+    }
+
+    uint32_t expected[MPSC_PRODUCERS] = {0};
+    mpsc_item_t out[16];
+    mpsc_item_t prev = { .producer = UINT16_MAX };
+    int total = 0;
+    int disorder = 0;
+    int split = 0;
+    while (total < MPSC_PRODUCERS * MPSC_PER_PRODUCER) {
+        size_t n;
+        if (total % 2) {
+            n = mpsc_ring_pop(&ring, out) == WTC_OK ? 1 : 0;
+        } else {
+            n = mpsc_ring_pop_batch(&ring, out, 16);
+        }
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        for (size_t i = 0; i < n; i++) {
+            mpsc_item_t item = out[i];
+            if (item.producer >= MPSC_PRODUCERS || item.seq != expected[item.producer]) {
+                disorder++;
+            } else {
+                expected[item.producer]++;
+            }
+            if (!item.batch_start &&
+                (prev.producer != item.producer || prev.seq + 1 != item.seq)) {
+                split++;
+            }
+            prev = item;
+            total++;
+        }
+    }
+
+    for (int i = 0; i < MPSC_PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    ASSERT_EQ(0, disorder);
+    ASSERT_EQ(0, split);
+    ASSERT_EQ(0, mpsc_ring_count(&ring));
+    ASSERT_EQ(WTC_ERROR_EMPTY, mpsc_ring_pop(&ring, out));
+    mpsc_ring_free(&ring);
+}
+
+/* ============== Wake-up Tests ============== */
+
+typedef struct {
+    spsc_ring_t *ring;
+    uint32_t value;
+    wtc_result_t result;
+    uint64_t woken_ms;
+} waiter_t;
+
+static void *spsc_waiter(void *arg) {
+    waiter_t *w = arg;
+    w->result = spsc_ring_pop_wait(w->ring, &w->value, 5000);
+    w->woken_ms = time_get_monotonic_ms();
+    return NULL;
+}
+
+TEST(pop_wait_sleeps_until_push)
+{
+    spsc_ring_t ring;
+    ASSERT_EQ(WTC_OK, spsc_ring_init(&ring, sizeof(uint32_t), 8, true));
+
+    /* Nothing pushed: the wait times out */
+    uint32_t value = 0;
+    uint64_t start = time_get_monotonic_ms();
+    ASSERT_EQ(WTC_ERROR_TIMEOUT, spsc_ring_pop_wait(&ring, &value, 20));
+    ASSERT_TRUE(time_get_monotonic_ms() - start >= 20);
+    ASSERT_EQ(0, __atomic_load_n(&ring.wait.sleeping, __ATOMIC_RELAXED));
+
+    /* A consumer asleep on the futex is woken by the push */
+    waiter_t waiter = { .ring = &ring, .result = WTC_ERROR };
+    pthread_t thread;
+    pthread_create(&thread, NULL, spsc_waiter, &waiter);
+    uint64_t deadline = time_get_monotonic_ms() + 2000;
+    while (__atomic_load_n(&ring.wait.sleeping, __ATOMIC_ACQUIRE) == 0 &&
+           time_get_monotonic_ms() < deadline) {
+        time_sleep_ms(1);
+    }
+    ASSERT_EQ(1, __atomic_load_n(&ring.wait.sleeping, __ATOMIC_ACQUIRE));
+    time_sleep_ms(10);
+
+    /* Woken by the push, well before its own timeout */
+    value = 42;
+    uint64_t pushed_ms = time_get_monotonic_ms();
+    ASSERT_EQ(WTC_OK, spsc_ring_push(&ring, &value));
+    pthread_join(thread, NULL);
+    ASSERT_EQ(WTC_OK, waiter.result);
+    ASSERT_EQ(42, waiter.value);
+    ASSERT_TRUE(waiter.woken_ms - pushed_ms < 1000);
+    ASSERT_EQ(0, __atomic_load_n(&ring.wait.sleeping, __ATOMIC_RELAXED));
+
+    spsc_ring_free(&ring);
+}
+
+/* A wait that outlasts this was not woken by a push but ran out its
+ * own timeout; the producers never pause that long */
+#define MISSED_WAKE_MS  500
+
+/* Pop with pop_wait, counting waits that missed their wake-up. After a
+ * miss, only poll so a broken wake-up cannot stall the test. */
+static wtc_result_t pop_timed(wtc_result_t (*pop_wait)(void *, void *, int),
+                              void *ring, void *element, int *missed) {
+    for (;;) {
+        uint64_t start = time_get_monotonic_ms();
+        wtc_result_t res = pop_wait(ring, element, *missed ? 0 : 2 * MISSED_WAKE_MS);
+        if (time_get_monotonic_ms() - start >= MISSED_WAKE_MS) {
+            (*missed)++;
+        }
+        if (res == WTC_OK) return WTC_OK;
+        if (res != WTC_ERROR_TIMEOUT) return res;
+        sched_yield();
+    }
+}
+
+static wtc_result_t spsc_pop_wait_any(void *ring, void *element, int timeout_ms) {
+    return spsc_ring_pop_wait(ring, element, timeout_ms);
+}
+
+static wtc_result_t mpsc_pop_wait_any(void *ring, void *element, int timeout_ms) {
+    return mpsc_ring_pop_wait(ring, element, timeout_ms);
+}
+
+TEST(pop_wait_misses_no_wakeup)
+{
+    /* The producer pauses often enough for the consumer to fall asleep */
+    spsc_ring_t ring;
+    ASSERT_EQ(WTC_OK, spsc_ring_init(&ring, sizeof(uint32_t), 16, true));
+
+    spsc_producer_t producer = { &ring, true };
+    pthread_t thread;
+    pthread_create(&thread, NULL, spsc_producer, &producer);
+
+    uint32_t value = 0;
+    int missed = 0;
+    int disorder = 0;
+    for (uint32_t expected = 0; expected < THREADED_COUNT; expected++) {
+        if (pop_timed(spsc_pop_wait_any, &ring, &value, &missed) != WTC_OK) {
+            break;
+        }
+        if (value != expected) disorder++;
+    }
+
+    pthread_join(thread, NULL);
+    ASSERT_EQ(0, missed);
+    ASSERT_EQ(0, disorder);
+    spsc_ring_free(&ring);
+
+    /* Same for the MPSC ring, fed by several producers */
+    mpsc_ring_t mring;
+    ASSERT_EQ(WTC_OK, mpsc_ring_init(&mring, sizeof(mpsc_item_t), 32, true));
+    mpsc_producer_t producers[MPSC_PRODUCERS];
+    pthread_t threads[MPSC_PRODUCERS];
+    for (int i = 0; i < MPSC_PRODUCERS; i++) {
+        producers[i].ring = &mring;
+        producers[i].producer = (uint16_t)i;
+        pthread_create(&threads[i], NULL, mpsc_producer, &producers[i]);
+    }
+
+    mpsc_item_t item;
+    int total = 0;
+    while (total < MPSC_PRODUCERS * MPSC_PER_PRODUCER &&
+           pop_timed(mpsc_pop_wait_any, &mring, &item, &missed) == WTC_OK) {
+        total++;
+    }
+    for (int i = 0; i < MPSC_PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    ASSERT_EQ(0, missed);
+    ASSERT_EQ(MPSC_PRODUCERS * MPSC_PER_PRODUCER, total);
+    mpsc_ring_free(&mring);
+}
+
+/* ============== Test Runner ============== */
+
+static void run_ring_tests(void)
+{
+    printf("\n=== Ring Buffer Tests ===\n\n");
+
+    printf("SPSC Tests:\n");
+    RUN_TEST(spsc_full_and_empty);
+    RUN_TEST(spsc_batches_wrap_around);
+    RUN_TEST(spsc_threads_keep_order);
+
+    printf("\nMPSC Tests:\n");
+    RUN_TEST(mpsc_full_empty_and_wrap);
+    RUN_TEST(mpsc_mixed_pushes_keep_order_and_batches);
+
+    printf("\nWake-up Tests:\n");
+    RUN_TEST(pop_wait_sleeps_until_push);
+    RUN_TEST(pop_wait_misses_no_wakeup);
+
+    printf("\n=== Results: %d/%d tests passed ===\n\n", tests_passed, tests_run);
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    run_ring_tests();
+    return (tests_passed == tests_run) ? 0 : 1;
+}
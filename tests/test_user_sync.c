@@ -0,0 +1,384 @@
+/**
+ * Water Treatment Controller - User Sync Tests
+ * Copyright (C) 2024
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/user/user_sync.h"
+#include "../src/profinet/profinet_controller.h"
+#include "../src/types.h"
+
+/* Test counters */
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name) static void test_##name(void)
+#define RUN_TEST(name) do { \
+    printf("  Running %s... ", #name); \
+    tests_run++; \
+    test_##name(); \
+    tests_passed++; \
+    printf("PASSED\n"); \
+} while(0)
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        printf("FAILED at line %d: expected %d, got %d\n", __LINE__, (int)(expected), (int)(actual)); \
+        return; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(cond) do { \
+    if (!(cond)) { \
+        printf("FAILED at line %d: condition false\n", __LINE__); \
+        return; \
+    } \
+} while(0)
+
+/* ============== Fake RTU ============== */
+
+#define FAKE_MAX_WRITES 8
+
+/* One RTU's user store. The manager's PROFINET controller pointer is
+ * this struct; the record calls below stand in for the real ones. */
+typedef struct {
+    user_sync_record_t users[USER_SYNC_MAX_USERS * 2];
+    int user_count;
+    uint32_t nonce;
+    bool state_readable;
+
+    /* Writes since the last fake_rtu_clear_writes() */
+    int writes;
+    uint8_t ops[FAKE_MAX_WRITES];
+    int counts[FAKE_MAX_WRITES];
+    uint32_t nonces[FAKE_MAX_WRITES];
+} fake_rtu_t;
+
+static fake_rtu_t rtu;
+
+static void fake_rtu_reset(void) {
+    memset(&rtu, 0, sizeof(rtu));
+    rtu.state_readable = true;
+}
+
+static void fake_rtu_clear_writes(void) {
+    rtu.writes = 0;
+}
+
+static int fake_rtu_find(uint32_t user_id) {
+    for (int i = 0; i < rtu.user_count; i++) {
+        if (rtu.users[i].user_id == user_id) return i;
+    }
+    return -1;
+}
+
+static const user_sync_record_t *fake_rtu_user(const char *username) {
+    for (int i = 0; i < rtu.user_count; i++) {
+        if (strcmp(rtu.users[i].username, username) == 0) return &rtu.users[i];
+    }
+    return NULL;
+}
+
+static void fake_rtu_apply(const user_sync_payload_t *payload) {
+    const user_sync_header_t *header = &payload->header;
+
+    if (header->operation == USER_SYNC_OP_FULL_SYNC) {
+        rtu.user_count = 0;
+    }
+    for (int i = 0; i < header->user_count; i++) {
+        const user_sync_record_t *record = &payload->users[i];
+        int at = fake_rtu_find(record->user_id);
+        if (header->operation == USER_SYNC_OP_DELETE) {
+            if (at >= 0) rtu.users[at] = rtu.users[--rtu.user_count];
+        } else if (at >= 0) {
+            rtu.users[at] = *record;
+        } else {
+            rtu.users[rtu.user_count++] = *record;
+        }
+    }
+    rtu.nonce = header->nonce;
+}
+
+wtc_result_t profinet_controller_read_record(profinet_controller_t *controller,
+                                              const char *station_name,
+                                              uint32_t api,
+                                              uint16_t slot,
+                                              uint16_t subslot,
+                                              uint16_t index,
+                                              void *data,
+                                              size_t *len) {
+    (void)controller;
+    (void)station_name;
+    (void)api;
+    (void)slot;
+    (void)subslot;
+    if (index != USER_SYNC_STATE_INDEX || !rtu.state_readable ||
+        *len < sizeof(user_sync_state_t)) {
+        return WTC_ERROR_IO;
+    }
+
+    user_sync_state_t state = {
+        .magic = USER_SYNC_MAGIC,
+        .version = USER_SYNC_PROTOCOL_VERSION,
+        .user_count = (uint8_t)rtu.user_count,
+        .nonce = rtu.nonce,
+    };
+    state.checksum = user_sync_crc16_ccitt((const uint8_t *)&state.nonce,
+                                           sizeof(state.nonce));
+    memcpy(data, &state, sizeof(state));
+    *len = sizeof(state);
+    return WTC_OK;
+}
+
+wtc_result_t profinet_controller_write_record(profinet_controller_t *controller,
+                                               const char *station_name,
+                                               uint32_t api,
+                                               uint16_t slot,
+                                               uint16_t subslot,
+                                               uint16_t index,
+                                               const void *data,
+                                               size_t len) {
+    (void)controller;
+    (void)station_name;
+    (void)api;
+    (void)slot;
+    (void)subslot;
+    const user_sync_payload_t *payload = data;
+    if (index != USER_SYNC_RECORD_INDEX || len < sizeof(user_sync_header_t) ||
+        len != user_sync_payload_size(payload->header.user_count) ||
+        user_sync_validate_payload(payload) != USER_SYNC_OK) {
+        return WTC_ERROR_PROTOCOL;
+    }
+
+    if (rtu.writes < FAKE_MAX_WRITES) {
+        rtu.ops[rtu.writes] = payload->header.operation;
+        rtu.counts[rtu.writes] = payload->header.user_count;
+        rtu.nonces[rtu.writes] = payload->header.nonce;
+    }
+    rtu.writes++;
+    fake_rtu_apply(payload);
+    return WTC_OK;
+}
+
+/* ============== Helpers ============== */
+
+static void make_user(user_t *user, const char *username, const char *password,
+                      user_role_t role) {
+    memset(user, 0, sizeof(*user));
+    snprintf(user->username, sizeof(user->username), "%s", username);
+    user_sync_hash_password(password, user->password_hash, sizeof(user->password_hash));
+    user->role = role;
+    user->active = true;
+}
+
+/* Manager syncing to the fake RTU, with users a, b and c already on it */
+static user_sync_manager_t *create_synced_manager(user_t users[3]) {
+    fake_rtu_reset();
+    make_user(&users[0], "alice", "alice-pass", USER_ROLE_ADMIN);
+    make_user(&users[1], "bob", "bob-pass", USER_ROLE_OPERATOR);
+    make_user(&users[2], "carol", "carol-pass", USER_ROLE_VIEWER);
+
+    user_sync_manager_t *mgr = NULL;
+    if (user_sync_manager_init(&mgr, NULL) != WTC_OK) return NULL;
+    user_sync_set_profinet(mgr, (struct profinet_controller *)&rtu);
+    if (user_sync_to_rtu(mgr, "rtu-a", users, 3) != 0) {
+        user_sync_manager_cleanup(mgr);
+        return NULL;
+    }
+    fake_rtu_clear_writes();
+    return mgr;
+}
+
+/* ============== Delta Tests ============== */
+
+TEST(user_sync_first_sync_is_full)
+{
+    user_t users[3];
+    user_sync_manager_t *mgr = create_synced_manager(users);
+    ASSERT_TRUE(mgr != NULL);
+
+    /* The RTU reported no nonce of this epoch, so it got the whole list */
+    ASSERT_EQ(3, rtu.user_count);
+    ASSERT_EQ(user_sync_boot_epoch(), USER_SYNC_NONCE_EPOCH(rtu.nonce));
+    ASSERT_EQ(3, USER_SYNC_NONCE_REVISION(rtu.nonce));
+
+    user_sync_stats_t stats;
+    ASSERT_EQ(WTC_OK, user_sync_get_stats(mgr, &stats));
+    ASSERT_EQ(1, (int)stats.full_syncs);
+    ASSERT_EQ(0, (int)stats.delta_syncs);
+    ASSERT_EQ(3, (int)stats.revision);
+
+    user_sync_manager_cleanup(mgr);
+}
+
+TEST(user_sync_sends_only_users_changed_after_revision)
+{
+    user_t users[3];
+    user_sync_manager_t *mgr = create_synced_manager(users);
+    ASSERT_TRUE(mgr != NULL);
+
+    /* A password change bumps one revision and sends one record */
+    make_user(&users[1], "bob", "bob-new-pass", USER_ROLE_OPERATOR);
+    ASSERT_EQ(1, user_sync_update_users(mgr, users, 3));
+    ASSERT_EQ(0, user_sync_to_rtu(mgr, "rtu-a", NULL, 0));
+
+    ASSERT_EQ(1, rtu.writes);
+    ASSERT_EQ(USER_SYNC_OP_ADD_UPDATE, rtu.ops[0]);
+    ASSERT_EQ(1, rtu.counts[0]);
+    ASSERT_EQ(4, USER_SYNC_NONCE_REVISION(rtu.nonces[0]));
+    ASSERT_EQ(3, rtu.user_count);
+    const user_sync_record_t *bob = fake_rtu_user("bob");
+    ASSERT_TRUE(bob != NULL);
+    ASSERT_TRUE(strcmp(bob->password_hash, users[1].password_hash) == 0);
+
+    /* Nothing changed since: no write at all */
+    fake_rtu_clear_writes();
+    ASSERT_EQ(0, user_sync_update_users(mgr, users, 3));
+    ASSERT_EQ(0, user_sync_to_rtu(mgr, "rtu-a", NULL, 0));
+    ASSERT_EQ(0, rtu.writes);
+
+    user_sync_stats_t stats;
+    ASSERT_EQ(WTC_OK, user_sync_get_stats(mgr, &stats));
+    ASSERT_EQ(1, (int)stats.delta_syncs);
+    ASSERT_EQ(1, (int)stats.up_to_date_syncs);
+
+    user_sync_manager_cleanup(mgr);
+}
+
+TEST(user_sync_sends_removals_as_deletes)
+{
+    user_t users[3];
+    user_sync_manager_t *mgr = create_synced_manager(users);
+    ASSERT_TRUE(mgr != NULL);
+    uint32_t carol_id = fake_rtu_user("carol")->user_id;
+
+    /* Dropping carol leaves a tombstone, sent as a delete of her id */
+    ASSERT_EQ(1, user_sync_update_users(mgr, users, 2));
+    ASSERT_EQ(0, user_sync_to_rtu(mgr, "rtu-a", NULL, 0));
+    ASSERT_EQ(1, rtu.writes);
+    ASSERT_EQ(USER_SYNC_OP_DELETE, rtu.ops[0]);
+    ASSERT_EQ(1, rtu.counts[0]);
+    ASSERT_EQ(2, rtu.user_count);
+    ASSERT_TRUE(fake_rtu_user("carol") == NULL);
+
+    /* Adding her back reuses her id */
+    fake_rtu_clear_writes();
+    ASSERT_EQ(1, user_sync_update_users(mgr, users, 3));
+    ASSERT_EQ(0, user_sync_to_rtu(mgr, "rtu-a", NULL, 0));
+    ASSERT_EQ(1, rtu.writes);
+    ASSERT_EQ(USER_SYNC_OP_ADD_UPDATE, rtu.ops[0]);
+    ASSERT_TRUE(fake_rtu_user("carol") != NULL);
+    ASSERT_EQ(carol_id, fake_rtu_user("carol")->user_id);
+
+    user_sync_manager_cleanup(mgr);
+}
+
+TEST(user_sync_splits_removals_over_writes)
+{
+    user_t users[3];
+    user_sync_manager_t *mgr = create_synced_manager(users);
+    ASSERT_TRUE(mgr != NULL);
+    uint32_t acked = rtu.nonce;
+
+    /* Two full lists come and go before the RTU syncs again: more
+     * tombstones than one payload holds */
+    static user_t batch[USER_SYNC_MAX_USERS];
+    char name[32];
+    for (int i = 0; i < USER_SYNC_MAX_USERS; i++) {
+        snprintf(name, sizeof(name), "op-%02d", i);
+        make_user(&batch[i], name, "op-pass", USER_ROLE_OPERATOR);
+    }
+    ASSERT_EQ(3, user_sync_update_users(mgr, NULL, 0));
+    ASSERT_EQ(USER_SYNC_MAX_USERS, user_sync_update_users(mgr, batch, USER_SYNC_MAX_USERS));
+    ASSERT_EQ(USER_SYNC_MAX_USERS, user_sync_update_users(mgr, NULL, 0));
+    ASSERT_EQ(0, user_sync_to_rtu(mgr, "rtu-a", NULL, 0));
+
+    /* Only the last write moves the RTU to the new revision */
+    ASSERT_EQ(2, rtu.writes);
+    ASSERT_EQ(USER_SYNC_OP_DELETE, rtu.ops[0]);
+    ASSERT_EQ(USER_SYNC_OP_DELETE, rtu.ops[1]);
+    ASSERT_EQ(USER_SYNC_MAX_USERS, rtu.counts[0]);
+    ASSERT_EQ(3, rtu.counts[1]);
+    ASSERT_TRUE(rtu.nonces[0] == acked);
+    ASSERT_EQ(3 + 3 + 2 * USER_SYNC_MAX_USERS, USER_SYNC_NONCE_REVISION(rtu.nonces[1]));
+    ASSERT_EQ(0, rtu.user_count);
+
+    user_sync_manager_cleanup(mgr);
+}
+
+/* ============== Full Sync Tests ============== */
+
+TEST(user_sync_full_sync_when_epoch_changes)
+{
+    user_t users[3];
+    user_sync_manager_t *mgr = create_synced_manager(users);
+    ASSERT_TRUE(mgr != NULL);
+
+    /* Reconnecting at the same revision sends nothing */
+    user_sync_on_rtu_connect(mgr, "rtu-a", NULL, 0);
+    ASSERT_EQ(0, rtu.writes);
+
+    /* An RTU last synced under another epoch gets the whole list, even
+     * though its revision matches */
+    uint16_t other = (uint16_t)(user_sync_boot_epoch() + 1);
+    if (other == 0) other = 1;
+    rtu.nonce = USER_SYNC_NONCE(other, USER_SYNC_NONCE_REVISION(rtu.nonce));
+    rtu.user_count = 1;
+    user_sync_on_rtu_connect(mgr, "rtu-a", NULL, 0);
+    ASSERT_EQ(1, rtu.writes);
+    ASSERT_EQ(USER_SYNC_OP_FULL_SYNC, rtu.ops[0]);
+    ASSERT_EQ(3, rtu.counts[0]);
+    ASSERT_EQ(3, rtu.user_count);
+    ASSERT_EQ(user_sync_boot_epoch(), USER_SYNC_NONCE_EPOCH(rtu.nonce));
+
+    /* So does one whose revision is ahead of the store */
+    fake_rtu_clear_writes();
+    rtu.nonce = USER_SYNC_NONCE(user_sync_boot_epoch(), 100);
+    user_sync_on_rtu_connect(mgr, "rtu-a", NULL, 0);
+    ASSERT_EQ(1, rtu.writes);
+    ASSERT_EQ(USER_SYNC_OP_FULL_SYNC, rtu.ops[0]);
+
+    /* And one whose state cannot be read */
+    fake_rtu_clear_writes();
+    rtu.state_readable = false;
+    user_sync_on_rtu_connect(mgr, "rtu-a", NULL, 0);
+    ASSERT_EQ(1, rtu.writes);
+    ASSERT_EQ(USER_SYNC_OP_FULL_SYNC, rtu.ops[0]);
+
+    user_sync_stats_t stats;
+    ASSERT_EQ(WTC_OK, user_sync_get_stats(mgr, &stats));
+    ASSERT_EQ(4, (int)stats.full_syncs);
+    ASSERT_EQ(1, (int)stats.up_to_date_syncs);
+
+    user_sync_manager_cleanup(mgr);
+}
+
+/* ============== Test Runner ============== */
+
+static void run_user_sync_tests(void)
+{
+    printf("\n=== User Sync Tests ===\n\n");
+
+    printf("Delta Tests:\n");
+    RUN_TEST(user_sync_first_sync_is_full);
+    RUN_TEST(user_sync_sends_only_users_changed_after_revision);
+    RUN_TEST(user_sync_sends_removals_as_deletes);
+    RUN_TEST(user_sync_splits_removals_over_writes);
+
+    printf("\nFull Sync Tests:\n");
+    RUN_TEST(user_sync_full_sync_when_epoch_changes);
+
+    printf("\n=== Results: %d/%d tests passed ===\n\n", tests_passed, tests_run);
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    run_user_sync_tests();
+    return (tests_passed == tests_run) ? 0 : 1;
+}